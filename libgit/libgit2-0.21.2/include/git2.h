@@ -22,10 +22,12 @@
 #include "git2/diff.h"
 #include "git2/errors.h"
 #include "git2/filter.h"
+#include "git2/fsmonitor.h"
 #include "git2/graph.h"
 #include "git2/ignore.h"
 #include "git2/index.h"
 #include "git2/indexer.h"
+#include "git2/lfs.h"
 #include "git2/merge.h"
 #include "git2/message.h"
 #include "git2/net.h"
@@ -104,6 +104,12 @@ GIT_BEGIN_DECL
  *   overwritten.  Normally, files that are ignored in the working directory
  *   are not considered "precious" and may be overwritten if the checkout
  *   target contains that file.
+ *
+ * When `core.sparseCheckout` is set, files that the patterns in
+ * `.git/info/sparse-checkout` leave out are not written to the working
+ * directory (unmodified copies are removed) and their index entries get
+ * the `GIT_IDXENTRY_SKIP_WORKTREE` bit, so diff and status do not report
+ * them as deleted.
  */
 typedef enum {
 	GIT_CHECKOUT_NONE = 0, /**< default is a dry run, no actual updates */
@@ -261,8 +267,18 @@ typedef struct git_checkout_options {
 	const char *ancestor_label; /** the name of the common ancestor side of conflicts */
 	const char *our_label; /** the name of the "our" side of conflicts */
 	const char *their_label; /** the name of the "their" side of conflicts */
+
+	/** Number of threads reading blobs and writing files.  0 or 1 writes
+	 *  them one by one on the calling thread; GIT_CHECKOUT_THREADS_AUTO
+	 *  uses one thread per CPU.  The index is updated and progress is
+	 *  reported on the calling thread, in the same order whatever the
+	 *  number of threads.
+	 */
+	unsigned int threads;
 } git_checkout_options;
 
+#define GIT_CHECKOUT_THREADS_AUTO ((unsigned int)-1)
+
 #define GIT_CHECKOUT_OPTIONS_VERSION 1
 #define GIT_CHECKOUT_OPTIONS_INIT {GIT_CHECKOUT_OPTIONS_VERSION}
 
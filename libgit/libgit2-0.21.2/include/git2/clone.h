@@ -110,6 +110,13 @@ typedef struct git_clone_options {
 	 * use the default signature using the config.
 	 */
 	git_signature *signature;
+
+	/**
+	 * Create a shallow clone holding only this many commits of the
+	 * branch history. 0 means the complete history. Local clones copy
+	 * the whole object database and ignore this.
+	 */
+	int depth;
 } git_clone_options;
 
 #define GIT_CLONE_OPTIONS_VERSION 1
@@ -136,7 +136,11 @@ typedef enum {
 	GIT_OPT_ENABLE_CACHING,
 	GIT_OPT_GET_CACHED_MEMORY,
 	GIT_OPT_GET_TEMPLATE_PATH,
-	GIT_OPT_SET_TEMPLATE_PATH
+	GIT_OPT_SET_TEMPLATE_PATH,
+	GIT_OPT_SET_PACK_CACHE_MAX_SIZE,
+	GIT_OPT_SET_PACK_CACHE_OBJECT_LIMIT,
+	GIT_OPT_GET_PACK_CACHE_STATS,
+	GIT_OPT_RESET_PACK_CACHE_STATS
 } git_libgit2_opt_t;
 
 /**
@@ -150,7 +154,8 @@ typedef enum {
  *
  *	* opts(GIT_OPT_SET_MWINDOW_SIZE, size_t):
  *
- *		> Set the maximum mmap window size
+ *		> Set the maximum mmap window size.  On 64-bit platforms a
+ *		> packfile that fits under the mapped limit is mapped whole.
  *
  *	* opts(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT, size_t *):
  *
@@ -221,6 +226,30 @@ typedef enum {
  *		>
  *		> - `path` directory of template.
  *
+ *	* opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, size_t max_storage_bytes)
+ *
+ *		> Set the memory budget of the delta base cache.  Bases of
+ *		> deltas unpacked from any packfile in the process are kept in
+ *		> one least-recently-used cache, so reading along a long delta
+ *		> chain does not inflate the same bases over and over.  Lowering
+ *		> the budget evicts entries right away; zero disables the cache.
+ *		> The default is 96MB.
+ *
+ *	* opts(GIT_OPT_SET_PACK_CACHE_OBJECT_LIMIT, size_t size)
+ *
+ *		> Set the size of the largest delta base that will be kept in
+ *		> the delta base cache.  The default is 16MB.
+ *
+ *	* opts(GIT_OPT_GET_PACK_CACHE_STATS, size_t *current, size_t *allowed,
+ *	       size_t *hits, size_t *misses)
+ *
+ *		> Get the bytes in the delta base cache, its budget, and how many
+ *		> lookups found or missed a base since the counters were reset.
+ *
+ *	* opts(GIT_OPT_RESET_PACK_CACHE_STATS)
+ *
+ *		> Reset the hit and miss counters of the delta base cache.
+ *
  * @param option Option key
  * @param ... value to set the option
  * @return 0 on success, <0 on failure
@@ -47,13 +47,16 @@ typedef enum {
  * file data.  Libgit2 includes one built in filter and it is possible to
  * write your own (see git2/sys/filter.h for information on that).
  *
- * The two builtin filters are:
+ * The builtin filters are:
  *
  * * "crlf" which uses the complex rules with the "text", "eol", and
  *   "crlf" file attributes to decide how to convert between LF and CRLF
  *   line endings
  * * "ident" which replaces "$Id$" in a blob with "$Id: <blob OID>$" upon
  *   checkout and replaced "$Id: <anything>$" with "$Id$" on checkin.
+ * * "lfs" which stores the content of files with the "filter=lfs"
+ *   attribute outside of the repository and commits pointers to it, in
+ *   the format of Git LFS (see git2/lfs.h)
  */
 typedef struct git_filter git_filter;
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_git_fsmonitor_h__
+#define INCLUDE_git_fsmonitor_h__
+
+#include "common.h"
+#include "types.h"
+#include "strarray.h"
+
+/**
+ * @file git2/fsmonitor.h
+ * @brief Working directory change monitor
+ * @defgroup git_fsmonitor Working directory change monitor
+ * @ingroup Git
+ * @{
+ */
+GIT_BEGIN_DECL
+
+/**
+ * Monitor of the changes made to a repository's working directory
+ *
+ * Only available on Linux (through inotify); elsewhere
+ * `git_fsmonitor_new` fails and status keeps scanning the whole
+ * working directory.
+ */
+typedef struct git_fsmonitor git_fsmonitor;
+
+/**
+ * Start monitoring the working directory of a repository
+ *
+ * Every directory of the working directory (except `.git`) is watched,
+ * so this costs one inotify watch per directory.  The monitor only
+ * speeds up status and diff once it is attached to the repository with
+ * `git_repository_set_fsmonitor`.
+ *
+ * @param out pointer to the new monitor
+ * @param repo repository with a working directory
+ * @return 0 or an error code
+ */
+GIT_EXTERN(int) git_fsmonitor_new(git_fsmonitor **out, git_repository *repo);
+
+/**
+ * Free a monitor
+ *
+ * The monitor keeps running as long as a repository it is attached to
+ * is open.
+ *
+ * @param mon the monitor
+ */
+GIT_EXTERN(void) git_fsmonitor_free(git_fsmonitor *mon);
+
+/**
+ * List the paths changed since a token
+ *
+ * Paths are relative to the working directory; directories end with a
+ * slash.  Pass a token of 0 to get the changes since the monitor was
+ * started, then the token returned by the previous call.
+ *
+ * @param out sorted list of changed paths, free with `git_strarray_free`
+ * @param token set to the token for the next call
+ * @param mon the monitor
+ * @param since token returned by a previous call, or 0
+ * @return 0 on success, GIT_ENOTFOUND if some changes since `since`
+ *         were lost (too many of them, or a directory could not be
+ *         watched) and the whole working directory has to be treated as
+ *         changed, or an error code
+ */
+GIT_EXTERN(int) git_fsmonitor_changes(
+	git_strarray *out,
+	uint64_t *token,
+	git_fsmonitor *mon,
+	uint64_t since);
+
+/**
+ * Use a monitor for the status and diff of a repository
+ *
+ * Workdir scans then reuse the listings of the directories nothing was
+ * added to or removed from, only calling `lstat` for the files that
+ * were written to.  This includes untracked directories.  Whenever the
+ * monitor may have missed changes, everything is scanned again.
+ *
+ * The repository keeps a reference to the monitor.
+ *
+ * @param repo the repository
+ * @param mon monitor created for `repo`, or NULL to stop using one
+ * @return 0 or an error code
+ */
+GIT_EXTERN(int) git_repository_set_fsmonitor(
+	git_repository *repo, git_fsmonitor *mon);
+
+/** @} */
+GIT_END_DECL
+#endif
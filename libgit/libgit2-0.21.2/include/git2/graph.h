@@ -50,6 +50,25 @@ GIT_EXTERN(int) git_graph_descendant_of(
 	const git_oid *commit,
 	const git_oid *ancestor);
 
+/**
+ * Write a commit-graph file for the repository
+ *
+ * Every commit reachable from HEAD or a reference is recorded in
+ * `objects/info/commit-graph` along with its parents, commit time and
+ * generation number, in the same format git uses. Revision walks,
+ * merge-base and ahead/behind computations then read parents from this
+ * table instead of inflating each commit, and use the generation
+ * numbers to stop early where they can.
+ *
+ * Commits created after the file was written are still found through
+ * the object database; write it again from time to time to keep it
+ * useful.
+ *
+ * @param repo the repository
+ * @return 0 or an error code
+ */
+GIT_EXTERN(int) git_graph_write_commit_graph(git_repository *repo);
+
 /** @} */
 GIT_END_DECL
 #endif
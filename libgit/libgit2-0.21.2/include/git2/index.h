@@ -229,6 +229,30 @@ GIT_EXTERN(int) git_index_caps(const git_index *index);
  */
 GIT_EXTERN(int) git_index_set_caps(git_index *index, int caps);
 
+/**
+ * Get the on-disk format version of the index.
+ *
+ * This is the version the index was read in with, or last set to.
+ * Versions 2 and 3 are written as whichever of them the entries need.
+ *
+ * @param index An existing index object
+ * @return the index version, from 2 to 4
+ */
+GIT_EXTERN(unsigned int) git_index_version(git_index *index);
+
+/**
+ * Set the on-disk format version of the index.
+ *
+ * Version 4 stores each entry's path as the part which differs from
+ * the entry before it, which makes the index of a large tree much
+ * smaller to write and read. It requires git 1.8.0 or later.
+ *
+ * @param index An existing index object
+ * @param version The new version number, from 2 to 4
+ * @return 0 on success, -1 on failure
+ */
+GIT_EXTERN(int) git_index_set_version(git_index *index, unsigned int version);
+
 /**
  * Update the contents of an existing index object in memory by reading
  * from the hard disk.
@@ -35,6 +35,21 @@ GIT_EXTERN(int) git_indexer_new(
 		git_transfer_progress_cb progress_cb,
 		void *progress_cb_payload);
 
+/**
+ * Set number of threads used to resolve deltas
+ *
+ * Independent delta chains are resolved concurrently when the pack
+ * is committed. By default (or when set to 0) libgit2 will
+ * autodetect the number of CPUs; set it to 1 to resolve every
+ * delta on the calling thread. The resulting index is the same
+ * whatever the number of threads.
+ *
+ * @param idx the indexer
+ * @param n Number of threads to use
+ * @return number of actual threads to be used
+ */
+GIT_EXTERN(unsigned int) git_indexer_set_threads(git_indexer *idx, unsigned int n);
+
 /**
  * Add data to the indexer
  *
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_git_lfs_h__
+#define INCLUDE_git_lfs_h__
+
+#include "common.h"
+#include "types.h"
+
+/**
+ * @file git2/lfs.h
+ * @brief Large files stored outside of the repository
+ * @defgroup git_lfs Large files stored outside of the repository
+ * @ingroup Git
+ * @{
+ *
+ * Files with the `filter=lfs` attribute are committed as small pointer
+ * files, in the format used by Git LFS, while their content lives in
+ * `.git/lfs/objects` and on an LFS server.  The builtin "lfs" filter
+ * stores the content there when a file is added, and puts it back on
+ * checkout, downloading what is missing.
+ *
+ * Checkouts download the objects of all the files they write in
+ * parallel before writing them.  Interrupted downloads are kept in
+ * `.git/lfs/incomplete` and resumed by the next fetch.
+ *
+ * The server is found from the `lfs.url` config, then
+ * `remote.origin.lfsurl`, then derived from an HTTP(S)
+ * `remote.origin.url`.  Without one, checkouts leave the pointer files
+ * of the missing objects in place.  Only downloads are supported.
+ */
+GIT_BEGIN_DECL
+
+/**
+ * Download progress, reported after each object
+ *
+ * Return a non-zero value to cancel the fetch.
+ */
+typedef int (*git_lfs_progress_cb)(
+	size_t completed_objects,
+	size_t total_objects,
+	uint64_t received_bytes,
+	void *payload);
+
+typedef struct {
+	unsigned int version;
+
+	/**
+	 * Number of objects downloaded at once.  0 uses the
+	 * `lfs.concurrenttransfers` config, which defaults to 8.
+	 */
+	unsigned int parallel;
+
+	git_lfs_progress_cb progress_cb;
+	void *progress_payload;
+} git_lfs_fetch_options;
+
+#define GIT_LFS_FETCH_OPTIONS_VERSION 1
+#define GIT_LFS_FETCH_OPTIONS_INIT {GIT_LFS_FETCH_OPTIONS_VERSION}
+
+/**
+ * Initializes a `git_lfs_fetch_options` with default values. Equivalent
+ * to creating an instance with GIT_LFS_FETCH_OPTIONS_INIT.
+ *
+ * @param opts the `git_lfs_fetch_options` instance to initialize.
+ * @param version the version of the struct; you should pass
+ *        `GIT_LFS_FETCH_OPTIONS_VERSION` here.
+ * @return Zero on success; -1 on failure.
+ */
+GIT_EXTERN(int) git_lfs_init_fetch_options(
+	git_lfs_fetch_options *opts,
+	unsigned int version);
+
+/**
+ * Download the large files of a tree that are not stored locally yet
+ *
+ * Checkouts do this by themselves for the files they write; this is
+ * for fetching ahead of time, e.g. before switching branches offline.
+ *
+ * @param repo the repository
+ * @param tree tree whose `filter=lfs` files to fetch
+ * @param opts download options, or NULL for the defaults
+ * @return 0 on success, GIT_ENOTFOUND if no LFS server is configured,
+ *         GIT_EUSER if the progress callback cancelled, or an error code
+ */
+GIT_EXTERN(int) git_lfs_fetch_tree(
+	git_repository *repo,
+	const git_tree *tree,
+	const git_lfs_fetch_options *opts);
+
+/** @} */
+GIT_END_DECL
+#endif
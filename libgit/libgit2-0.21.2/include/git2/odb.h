@@ -280,7 +280,11 @@ GIT_EXTERN(int) git_odb_stream_finalize_write(git_oid *out, git_odb_stream *stre
 /**
  * Read from an odb stream
  *
- * Most backends don't implement streaming reads
+ * @param stream the stream
+ * @param buffer where to store the data
+ * @param len size of `buffer`
+ * @return the number of bytes read, 0 at the end of the object, or an
+ *         error code
  */
 GIT_EXTERN(int) git_odb_stream_read(git_odb_stream *stream, char *buffer, size_t len);
 
@@ -294,11 +298,13 @@ GIT_EXTERN(void) git_odb_stream_free(git_odb_stream *stream);
 /**
  * Open a stream to read an object from the ODB
  *
- * Note that most backends do *not* support streaming reads
- * because they store their objects as compressed/delta'ed blobs.
+ * The loose and pack backends inflate the object as it is read, so
+ * large blobs never have to be held in memory whole.  Deltified
+ * objects in a pack are the exception: they are resolved in memory
+ * when the stream is opened.  Custom backends may not support
+ * streaming reads at all; `git_odb_read` works everywhere.
  *
- * It's recommended to use `git_odb_read` instead, which is
- * assured to work on all backends.
+ * The size of the object is available as `stream->declared_size`.
  *
  * The returned stream will be of type `GIT_STREAM_RDONLY` and
  * will have the following methods:
@@ -9,6 +9,7 @@
 
 #include "common.h"
 #include "types.h"
+#include "oid.h"
 
 /**
  * @file git2/backend.h
@@ -66,6 +67,87 @@ GIT_EXTERN(int) git_odb_backend_loose(
  */
 GIT_EXTERN(int) git_odb_backend_one_pack(git_odb_backend **out, const char *index_file);
 
+/**
+ * Options for a bulk import backend
+ */
+typedef struct {
+	unsigned int version;
+
+	/**
+	 * Number of threads compressing objects. With 0 or 1 each object
+	 * is compressed by the thread writing it.
+	 */
+	unsigned int threads;
+
+	/** zlib compression level, or -1 for the default */
+	int compression_level;
+} git_odb_bulk_options;
+
+#define GIT_ODB_BULK_OPTIONS_VERSION 1
+#define GIT_ODB_BULK_OPTIONS_INIT {GIT_ODB_BULK_OPTIONS_VERSION, 0, -1}
+
+/**
+ * Create a backend which writes new objects into a single packfile
+ *
+ * Meant for importing many objects at once: added to an odb with a
+ * priority above the loose (2) and packed (1) backends', it takes
+ * every object written to the odb and appends it to a temporary
+ * packfile instead of creating a loose object file for it. The
+ * objects can be read back right away, but only become part of the
+ * repository once the pack is committed with `git_odb_bulk_commit()`.
+ *
+ * After a commit or a discard, the backend passes writes on to the
+ * next backend until `git_odb_bulk_restart()` starts another import,
+ * so one backend can stay in the odb for any number of imports.
+ *
+ * @param out location to store the odb backend pointer
+ * @param objects_dir the Git repository's objects directory
+ * @param opts the options, or NULL for the defaults
+ *
+ * @return 0 or an error code
+ */
+GIT_EXTERN(int) git_odb_backend_bulk(
+	git_odb_backend **out,
+	const char *objects_dir,
+	const git_odb_bulk_options *opts);
+
+/**
+ * Write the index of a bulk import's packfile and move both into
+ * the repository
+ *
+ * The odb the backend was added to is refreshed, so its pack backend
+ * finds the objects. Nothing is written if no object was imported.
+ *
+ * @param out set to the name of the new pack, or zeroed if there is
+ *        none; may be NULL
+ * @param backend a backend created by `git_odb_backend_bulk()`
+ *
+ * @return 0 or an error code
+ */
+GIT_EXTERN(int) git_odb_bulk_commit(git_oid *out, git_odb_backend *backend);
+
+/**
+ * Throw away the objects of a bulk import
+ *
+ * This is what freeing the backend does with a pack that was not
+ * committed.
+ *
+ * @param backend a backend created by `git_odb_backend_bulk()`
+ */
+GIT_EXTERN(void) git_odb_bulk_discard(git_odb_backend *backend);
+
+/**
+ * Start a new import with a backend that was committed or discarded
+ *
+ * @param backend a backend created by `git_odb_backend_bulk()`
+ * @param opts the options, or NULL for the defaults
+ *
+ * @return 0, or an error code if an import is still in progress
+ */
+GIT_EXTERN(int) git_odb_bulk_restart(
+	git_odb_backend *backend,
+	const git_odb_bulk_options *opts);
+
 /** Streaming mode */
 typedef enum {
 	GIT_STREAM_RDONLY = (1 << 1),
@@ -114,6 +114,40 @@ GIT_EXTERN(int) git_packbuilder_insert_tree(git_packbuilder *pb, const git_oid *
  */
 GIT_EXTERN(int) git_packbuilder_insert_commit(git_packbuilder *pb, const git_oid *id);
 
+/**
+ * Insert the objects needed for a revision walk
+ *
+ * This adds the commits the walk would return, with the trees and
+ * blobs they need which are not reachable from the commits hidden from
+ * the walk. The walk is consumed, as if it had been iterated.
+ *
+ * When a pack of the repository has a bitmap index, and the walk has
+ * no hide callback or first-parent simplification, the objects are
+ * found by combining bitmaps instead of walking trees. Set the config
+ * variable `pack.useBitmaps` to false to always walk the trees.
+ *
+ * @param pb The packbuilder
+ * @param walk The revision walk, with the wanted commits pushed and the
+ *        ones the other side has hidden
+ *
+ * @return 0 or an error code
+ */
+GIT_EXTERN(int) git_packbuilder_insert_walk(git_packbuilder *pb, git_revwalk *walk);
+
+/**
+ * Write a bitmap index along with the pack
+ *
+ * `git_packbuilder_write` then also writes a `.bitmap` file recording,
+ * for the tips of the pack's history and commits spaced along it, the
+ * objects reachable from them. Only commits whose whole history is in
+ * the pack are recorded, so this is meant for packs of every object
+ * reachable from the references.
+ *
+ * @param pb The packbuilder
+ * @param enabled Whether to write the bitmap index
+ */
+GIT_EXTERN(void) git_packbuilder_set_write_bitmap(git_packbuilder *pb, int enabled);
+
 /**
  * Write the contents of the packfile to an in-memory buffer
  *
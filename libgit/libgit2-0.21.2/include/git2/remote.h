@@ -601,6 +601,39 @@ GIT_EXTERN(int) git_remote_update_fetchhead(git_remote *remote);
  */
 GIT_EXTERN(void) git_remote_set_update_fetchhead(git_remote *remote, int value);
 
+/**
+ * Depth which converts a shallow repository back into a complete one
+ */
+#define GIT_REMOTE_DEPTH_UNSHALLOW 0x7fffffff
+
+/**
+ * Retrieve the depth used when fetching.
+ *
+ * @param remote the remote to query
+ * @return the number of commits fetched from each tip, or 0 for the
+ *         complete history
+ */
+GIT_EXTERN(int) git_remote_depth(const git_remote *remote);
+
+/**
+ * Limit the history downloaded by a fetch.
+ *
+ * With a depth of N the server only sends the latest N commits of
+ * each fetched branch, and the oldest of them are recorded in
+ * `.git/shallow` as the boundary of the repository's history.
+ * Fetching into a shallow repository with a larger depth deepens it;
+ * pass `GIT_REMOTE_DEPTH_UNSHALLOW` to fetch everything that is
+ * missing.  The default of 0 keeps whatever history the repository
+ * already has.
+ *
+ * Only the git, ssh and http transports support this; it is ignored
+ * when fetching from a local path.
+ *
+ * @param remote the remote to configure
+ * @param depth the number of commits to fetch, or 0
+ */
+GIT_EXTERN(void) git_remote_set_depth(git_remote *remote, int depth);
+
 /**
  * Ensure the remote name is well-formed.
  *
@@ -28,6 +28,7 @@ GIT_EXTERN(git_filter *) git_filter_lookup(const char *name);
 
 #define GIT_FILTER_CRLF  "crlf"
 #define GIT_FILTER_IDENT "ident"
+#define GIT_FILTER_LFS   "lfs"
 
 /**
  * This is priority that the internal CRLF filter will be registered with
@@ -46,6 +47,12 @@ GIT_EXTERN(git_filter *) git_filter_lookup(const char *name);
  */
 #define GIT_FILTER_DRIVER_PRIORITY 200
 
+/**
+ * This is priority that the internal large file filter will be registered
+ * with, the one of the filter driver it stands in for
+ */
+#define GIT_FILTER_LFS_PRIORITY GIT_FILTER_DRIVER_PRIORITY
+
 /**
  * Create a new empty filter list
  *
@@ -262,9 +269,10 @@ struct git_filter {
  * issued in order of `priority` on smudge (to workdir), and in reverse
  * order of `priority` on clean (to odb).
  *
- * Two filters are preregistered with libgit2:
+ * Three filters are preregistered with libgit2:
  * - GIT_FILTER_CRLF with priority 0
  * - GIT_FILTER_IDENT with priority 100
+ * - GIT_FILTER_LFS with priority 200
  *
  * Currently the filter registry is not thread safe, so any registering or
  * deregistering of filters must be done outside of any possible usage of
@@ -285,7 +293,8 @@ GIT_EXTERN(int) git_filter_register(
  * Remove the filter with the given name
  *
  * Attempting to remove the builtin libgit2 filters is not permitted and
- * will return an error.
+ * will return an error, except for GIT_FILTER_LFS, which can be removed
+ * to run an external large file filter instead.
  *
  * Currently the filter registry is not thread safe, so any registering or
  * deregistering of filters must be done outside of any possible usage of
@@ -17,6 +17,7 @@
 #include "git2/diff.h"
 #include "git2/submodule.h"
 #include "git2/sys/index.h"
+#include "git2/sys/filter.h"
 
 #include "refs.h"
 #include "repository.h"
@@ -28,6 +29,8 @@
 #include "buf_text.h"
 #include "merge_file.h"
 #include "path.h"
+#include "sparse.h"
+#include "lfs.h"
 
 /* See docs/checkout-internals.md for more information */
 
@@ -40,6 +43,7 @@ enum {
 	CHECKOUT_ACTION__UPDATE_CONFLICT = 16,
 	CHECKOUT_ACTION__MAX = 16,
 	CHECKOUT_ACTION__DEFER_REMOVE = 32,
+	CHECKOUT_ACTION__SKIP_WORKTREE = 64,
 	CHECKOUT_ACTION__REMOVE_AND_UPDATE =
 		(CHECKOUT_ACTION__UPDATE_BLOB | CHECKOUT_ACTION__REMOVE),
 };
@@ -51,6 +55,7 @@ typedef struct {
 	bool opts_free_baseline;
 	char *pfx;
 	git_index *index;
+	git_sparse *sparse;
 	git_pool pool;
 	git_vector removes;
 	git_vector conflicts;
@@ -222,15 +227,68 @@ static int checkout_action_common(
 	return checkout_notify(data, notify, delta, wd);
 }
 
+static bool checkout_is_skip_worktree(checkout_data *data, const char *path)
+{
+	const git_index_entry *ie;
+
+	return data->index != NULL &&
+		(ie = git_index_get_bypath(data->index, path, 0)) != NULL &&
+		(ie->flags_extended & GIT_IDXENTRY_SKIP_WORKTREE) != 0;
+}
+
+/* files the sparse checkout patterns leave out of the working directory */
+static int checkout_is_sparse_excluded(
+	bool *excluded, checkout_data *data, const git_diff_delta *delta)
+{
+	int error, included;
+
+	*excluded = false;
+
+	if (!data->sparse ||
+		(delta->status != GIT_DELTA_UNMODIFIED &&
+		 delta->status != GIT_DELTA_ADDED &&
+		 delta->status != GIT_DELTA_MODIFIED))
+		return 0;
+
+	if ((error = git_sparse__lookup(
+			&included, data->sparse, delta->new_file.path)) < 0)
+		return error;
+
+	*excluded = !included;
+	return 0;
+}
+
 static int checkout_action_no_wd(
 	int *action,
 	checkout_data *data,
 	const git_diff_delta *delta)
 {
 	int error = 0;
+	bool excluded;
 
 	*action = CHECKOUT_ACTION__NONE;
 
+	if ((error = checkout_is_sparse_excluded(&excluded, data, delta)) < 0)
+		return error;
+
+	if (excluded) {
+		*action = CHECKOUT_ACTION__SKIP_WORKTREE;
+		return 0;
+	}
+
+	/* a file the sparse patterns used to leave out has been brought back;
+	 * it is missing because we never wrote it, not because it was deleted,
+	 * so it is written whether or not the target also changes it
+	 */
+	if (data->sparse &&
+		(delta->status == GIT_DELTA_UNMODIFIED ||
+		 delta->status == GIT_DELTA_MODIFIED ||
+		 delta->status == GIT_DELTA_TYPECHANGE) &&
+		checkout_is_skip_worktree(data, delta->old_file.path)) {
+		*action = CHECKOUT_ACTION_IF(SAFE, UPDATE_BLOB, NONE);
+		return checkout_action_common(action, data, delta, NULL);
+	}
+
 	switch (delta->status) {
 	case GIT_DELTA_UNMODIFIED: /* case 12 */
 		error = checkout_notify(data, GIT_CHECKOUT_NOTIFY_DIRTY, delta, NULL);
@@ -397,8 +455,24 @@ static int checkout_action_with_wd(
 	git_iterator *workdir,
 	const git_index_entry *wd)
 {
+	int error;
+	bool excluded;
+
 	*action = CHECKOUT_ACTION__NONE;
 
+	if ((error = checkout_is_sparse_excluded(&excluded, data, delta)) < 0)
+		return error;
+
+	/* clean files the sparse patterns leave out are removed, while
+	 * modified or untracked ones are handled like any other file
+	 */
+	if (excluded && delta->status != GIT_DELTA_ADDED &&
+		!checkout_is_workdir_modified(data, &delta->old_file, wd)) {
+		*action = CHECKOUT_ACTION_IF(SAFE, REMOVE, NONE) |
+			CHECKOUT_ACTION__SKIP_WORKTREE;
+		return checkout_action_common(action, data, delta, wd);
+	}
+
 	switch (delta->status) {
 	case GIT_DELTA_UNMODIFIED: /* case 14/15 or 33 */
 		if (checkout_is_workdir_modified(data, &delta->old_file, wd)) {
@@ -1171,15 +1245,11 @@ static int buffer_to_file(
 	struct stat *st,
 	git_buf *buf,
 	const char *path,
-	mode_t dir_mode,
 	int file_open_flags,
 	mode_t file_mode)
 {
 	int error;
 
-	if ((error = git_futils_mkpath2file(path, dir_mode)) < 0)
-		return error;
-
 	if ((error = git_futils_writebuffer(
 			buf, path, file_open_flags, file_mode)) < 0)
 		return error;
@@ -1222,7 +1292,7 @@ static int blob_content_to_file(
 
 	if (!error) {
 		error = buffer_to_file(
-			st, &out, path, opts->dir_mode, opts->file_open_flags, file_mode);
+			st, &out, path, opts->file_open_flags, file_mode);
 
 		st->st_mode = entry_filemode;
 
@@ -1236,15 +1306,11 @@ static int blob_content_to_link(
 	struct stat *st,
 	git_blob *blob,
 	const char *path,
-	mode_t dir_mode,
 	int can_symlink)
 {
 	git_buf linktarget = GIT_BUF_INIT;
 	int error;
 
-	if ((error = git_futils_mkpath2file(path, dir_mode)) < 0)
-		return error;
-
 	if ((error = git_blob__getbuf(&linktarget, blob)) < 0)
 		return error;
 
@@ -1380,7 +1446,8 @@ static int checkout_safe_for_update_only(const char *path, mode_t expected_mode)
 	return 0;
 }
 
-static int checkout_write_content(
+/* Write a blob whose parent directories already exist */
+static int checkout_write_blob(
 	checkout_data *data,
 	const git_oid *oid,
 	const char *full_path,
@@ -1396,13 +1463,18 @@ static int checkout_write_content(
 
 	if (S_ISLNK(mode))
 		error = blob_content_to_link(
-			st, blob, full_path, data->opts.dir_mode, data->can_symlink);
+			st, blob, full_path, data->can_symlink);
 	else
 		error = blob_content_to_file(
 			st, blob, full_path, hint_path, mode, &data->opts);
 
 	git_blob_free(blob);
 
+	return error;
+}
+
+static int checkout_write_error(checkout_data *data, int error)
+{
 	/* if we try to create the blob and an existing directory blocks it from
 	 * being written, then there must have been a typechange conflict in a
 	 * parent directory - suppress the error and try to continue.
@@ -1417,6 +1489,23 @@ static int checkout_write_content(
 	return error;
 }
 
+static int checkout_write_content(
+	checkout_data *data,
+	const git_oid *oid,
+	const char *full_path,
+	const char *hint_path,
+	unsigned int mode,
+	struct stat *st)
+{
+	int error;
+
+	if ((error = git_futils_mkpath2file(full_path, data->opts.dir_mode)) >= 0)
+		error = checkout_write_blob(
+			data, oid, full_path, hint_path, mode, st);
+
+	return checkout_write_error(data, error);
+}
+
 static int checkout_blob(
 	checkout_data *data,
 	const git_diff_file *file)
@@ -1505,6 +1594,81 @@ static int checkout_remove_the_old(
 	return 0;
 }
 
+static int checkout_skip_the_sparse(
+	unsigned int *actions,
+	checkout_data *data)
+{
+	int error = 0;
+	git_diff_delta *delta;
+	git_index_entry entry;
+	const git_index_entry *ie;
+	size_t i;
+
+	/* dry runs leave the index alone */
+	if (!data->index ||
+		(data->strategy & GIT_CHECKOUT_SAFE) == 0 ||
+		(data->strategy & GIT_CHECKOUT_DONT_UPDATE_INDEX) != 0)
+		return 0;
+
+	git_vector_foreach(&data->diff->deltas, i, delta) {
+		if ((actions[i] & CHECKOUT_ACTION__SKIP_WORKTREE) == 0)
+			continue;
+
+		if ((ie = git_index_get_bypath(data->index, delta->new_file.path, 0)) &&
+			(ie->flags_extended & GIT_IDXENTRY_SKIP_WORKTREE) != 0 &&
+			ie->mode == delta->new_file.mode &&
+			git_oid_equal(&ie->id, &delta->new_file.id))
+			continue;
+
+		/* no stat data, the file is not expected in the working directory */
+		memset(&entry, 0, sizeof(entry));
+		entry.path = (char *)delta->new_file.path;
+		entry.mode = delta->new_file.mode;
+		entry.flags_extended = GIT_IDXENTRY_SKIP_WORKTREE;
+		git_oid_cpy(&entry.id, &delta->new_file.id);
+
+		if ((error = git_index_add(data->index, &entry)) < 0)
+			break;
+	}
+
+	return error;
+}
+
+/* download the large files about to be written, all at once */
+static int checkout_fetch_large_files(
+	unsigned int *actions,
+	checkout_data *data)
+{
+	git_lfs_pointer_array wanted = GIT_ARRAY_INIT;
+	git_diff_delta *delta;
+	size_t i;
+	int error = 0;
+
+	/* the filter may have been replaced by an external one */
+	if (git_filter_lookup(GIT_FILTER_LFS) == NULL)
+		return 0;
+
+	git_vector_foreach(&data->diff->deltas, i, delta) {
+		if ((actions[i] & CHECKOUT_ACTION__UPDATE_BLOB) == 0 ||
+			!S_ISREG(delta->new_file.mode))
+			continue;
+
+		if ((error = git_lfs__want(&wanted, data->repo,
+				delta->new_file.path, &delta->new_file.id)) < 0)
+			break;
+	}
+
+	if (!error && wanted.size > 0 &&
+		(error = git_lfs__fetch(data->repo, wanted.ptr, wanted.size, NULL)) == GIT_ENOTFOUND) {
+		/* without a server, the pointers are checked out as they are */
+		giterr_clear();
+		error = 0;
+	}
+
+	git_array_clear(wanted);
+	return error;
+}
+
 static int checkout_deferred_remove(git_repository *repo, const char *path)
 {
 #if 0
@@ -1525,14 +1689,260 @@ static int checkout_deferred_remove(git_repository *repo, const char *path)
 #endif
 }
 
+#ifdef GIT_THREADS
+
+/*
+ * Parallel checkout
+ *
+ * Parent directories are created up front on the calling thread (once
+ * per directory, the deltas are sorted by path), then a pool of threads
+ * reads, filters and writes the blobs. Results are consumed in delta
+ * order on the calling thread, which updates the index and reports
+ * progress exactly as the serial loop does.
+ */
+
+/* Below this many files the threads cost more than they save */
+#define CHECKOUT_THREADED_MIN_FILES 32
+
+typedef struct {
+	const git_diff_file *file;
+	char *path;
+	struct stat st;
+	int error;
+	int error_class;
+	char *error_msg;
+	unsigned int skip :1,
+		written :1,
+		done :1;
+} checkout_job;
+
+typedef struct {
+	checkout_data *data;
+	checkout_job *jobs;
+	size_t njobs;
+	git_atomic next;
+	git_atomic cancel;
+	git_mutex lock;
+	git_cond done;
+} checkout_pool;
+
+static void checkout_job_run(checkout_data *data, checkout_job *job)
+{
+	const git_diff_file *file = job->file;
+	int error = 0;
+
+	if (job->skip)
+		return;
+
+	if ((data->strategy & GIT_CHECKOUT_UPDATE_ONLY) != 0) {
+		int rval = checkout_safe_for_update_only(job->path, file->mode);
+		if (rval <= 0) {
+			error = rval;
+			goto done;
+		}
+	}
+
+	error = checkout_write_blob(
+		data, &file->id, job->path, NULL, file->mode, &job->st);
+	if (!error)
+		job->written = 1;
+
+	error = checkout_write_error(data, error);
+
+done:
+	if (error < 0) {
+		const git_error *e = giterr_last();
+
+		if (e) {
+			job->error_class = e->klass;
+			job->error_msg = git__strdup(e->message);
+		}
+		giterr_clear();
+	}
+
+	job->error = error;
+}
+
+static void *checkout_worker(void *arg)
+{
+	checkout_pool *pool = arg;
+	size_t i;
+
+	while (!pool->cancel.val &&
+		(i = (size_t)git_atomic_inc(&pool->next) - 1) < pool->njobs) {
+		checkout_job *job = &pool->jobs[i];
+
+		checkout_job_run(pool->data, job);
+
+		git_mutex_lock(&pool->lock);
+		job->done = 1;
+		git_cond_signal(&pool->done);
+		git_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+static int checkout_jobs_prepare(
+	checkout_job *jobs, size_t *njobs, unsigned int *actions, checkout_data *data)
+{
+	git_buf lastdir = GIT_BUF_INIT;
+	git_diff_delta *delta;
+	size_t i, n = 0;
+	int error = 0;
+
+	git_vector_foreach(&data->diff->deltas, i, delta) {
+		checkout_job *job;
+		const char *slash;
+		size_t dirlen;
+
+		if (actions[i] & CHECKOUT_ACTION__DEFER_REMOVE) {
+			if ((error = checkout_deferred_remove(
+					data->repo, delta->old_file.path)) < 0)
+				break;
+		}
+
+		if ((actions[i] & CHECKOUT_ACTION__UPDATE_BLOB) == 0)
+			continue;
+
+		job = &jobs[n++];
+		job->file = &delta->new_file;
+
+		git_buf_truncate(&data->path, data->workdir_len);
+		if ((error = git_buf_puts(&data->path, job->file->path)) < 0 ||
+			(job->path = git__strdup(data->path.ptr)) == NULL) {
+			error = -1;
+			break;
+		}
+
+		slash = strrchr(job->file->path, '/');
+		dirlen = slash ? (size_t)(slash - job->file->path) : 0;
+		if (dirlen == git_buf_len(&lastdir) &&
+			!memcmp(job->file->path, lastdir.ptr, dirlen))
+			continue;
+
+		if ((error = git_futils_mkpath2file(job->path, data->opts.dir_mode)) < 0) {
+			/* a blocked parent is suppressed the same way the serial loop does */
+			if ((error = checkout_write_error(data, error)) < 0)
+				break;
+			job->skip = 1;
+			continue;
+		}
+
+		if ((error = git_buf_set(&lastdir, job->file->path, dirlen)) < 0)
+			break;
+	}
+
+	git_buf_free(&lastdir);
+	*njobs = n;
+	return error;
+}
+
+static int checkout_create_the_new_threaded(
+	unsigned int *actions,
+	checkout_data *data,
+	size_t count,
+	unsigned int nr_threads)
+{
+	checkout_pool pool;
+	git_thread *threads = NULL;
+	size_t i, spawned = 0;
+	int error = 0;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.data = data;
+
+	pool.jobs = git__calloc(count, sizeof(checkout_job));
+	GITERR_CHECK_ALLOC(pool.jobs);
+
+	if ((error = checkout_jobs_prepare(pool.jobs, &pool.njobs, actions, data)) < 0)
+		goto cleanup;
+
+	threads = git__calloc(nr_threads, sizeof(git_thread));
+	GITERR_CHECK_ALLOC(threads);
+
+	git_mutex_init(&pool.lock);
+	git_cond_init(&pool.done);
+
+	for (spawned = 0; spawned < nr_threads; spawned++) {
+		if (git_thread_create(&threads[spawned], NULL, checkout_worker, &pool) != 0)
+			break;
+	}
+
+	/* could not start any thread, do the work here */
+	if (!spawned)
+		checkout_worker(&pool);
+
+	for (i = 0; i < pool.njobs; i++) {
+		checkout_job *job = &pool.jobs[i];
+
+		git_mutex_lock(&pool.lock);
+		while (!job->done)
+			git_cond_wait(&pool.done, &pool.lock);
+		git_mutex_unlock(&pool.lock);
+
+		if ((error = job->error) < 0) {
+			if (job->error_msg)
+				giterr_set(job->error_class, "%s", job->error_msg);
+			break;
+		}
+
+		/* update the index unless prevented */
+		if (job->written &&
+			(data->strategy & GIT_CHECKOUT_DONT_UPDATE_INDEX) == 0 &&
+			(error = checkout_update_index(data, job->file, &job->st)) < 0)
+			break;
+
+		/* update the submodule data if this was a new .gitmodules file */
+		if (job->written && strcmp(job->file->path, ".gitmodules") == 0)
+			data->reload_submodules = true;
+
+		data->completed_steps++;
+		report_progress(data, job->file->path);
+	}
+
+	git_atomic_set(&pool.cancel, 1);
+	for (i = 0; i < spawned; i++)
+		git_thread_join(&threads[i], NULL);
+
+	git_cond_free(&pool.done);
+	git_mutex_free(&pool.lock);
+
+cleanup:
+	for (i = 0; i < pool.njobs; i++) {
+		git__free(pool.jobs[i].path);
+		git__free(pool.jobs[i].error_msg);
+	}
+	git__free(pool.jobs);
+	git__free(threads);
+	return error;
+}
+
+#endif
+
 static int checkout_create_the_new(
 	unsigned int *actions,
-	checkout_data *data)
+	checkout_data *data,
+	size_t *counts)
 {
 	int error = 0;
 	git_diff_delta *delta;
 	size_t i;
 
+#ifdef GIT_THREADS
+	unsigned int nr_threads = data->opts.threads;
+
+	if (nr_threads == GIT_CHECKOUT_THREADS_AUTO)
+		nr_threads = (unsigned int)git_online_cpus();
+
+	if (nr_threads > 1 &&
+		counts[CHECKOUT_ACTION__UPDATE_BLOB] >= CHECKOUT_THREADED_MIN_FILES)
+		return checkout_create_the_new_threaded(
+			actions, data, counts[CHECKOUT_ACTION__UPDATE_BLOB], nr_threads);
+#else
+	GIT_UNUSED(counts);
+#endif
+
 	git_vector_foreach(&data->diff->deltas, i, delta) {
 		if (actions[i] & CHECKOUT_ACTION__DEFER_REMOVE) {
 			/* this had a blocker directory that should only be removed iff
@@ -1905,6 +2315,9 @@ static void checkout_data_clear(checkout_data *data)
 	git_vector_free(&data->removes);
 	git_pool_clear(&data->pool);
 
+	git_sparse__free(data->sparse);
+	data->sparse = NULL;
+
 	git_vector_free_deep(&data->conflicts);
 
 	git__free(data->pfx);
@@ -2005,6 +2418,11 @@ static int checkout_data_init(
 
 	data->pfx = git_pathspec_prefix(&data->opts.paths);
 
+	/* sparse checkout only applies to the repository's own workdir */
+	if ((!proposed || !proposed->target_directory) &&
+		(error = git_sparse__load(&data->sparse, repo)) < 0)
+		goto cleanup;
+
 	if ((error = git_repository__cvar(
 			 &data->can_symlink, repo, GIT_CVAR_SYMLINKS)) < 0)
 		goto cleanup;
@@ -2138,8 +2556,13 @@ int git_checkout_iterator(
 		(error = checkout_remove_the_old(actions, &data)) < 0)
 		goto cleanup;
 
+	if (data.sparse != NULL &&
+		(error = checkout_skip_the_sparse(actions, &data)) < 0)
+		goto cleanup;
+
 	if (counts[CHECKOUT_ACTION__UPDATE_BLOB] > 0 &&
-		(error = checkout_create_the_new(actions, &data)) < 0)
+		((error = checkout_fetch_large_files(actions, &data)) < 0 ||
+		 (error = checkout_create_the_new(actions, &data, counts)) < 0))
 		goto cleanup;
 
 	if (counts[CHECKOUT_ACTION__UPDATE_SUBMODULE] > 0 &&
@@ -0,0 +1,595 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "commit_graph.h"
+#include "fileops.h"
+#include "filebuf.h"
+#include "hash.h"
+#include "odb.h"
+#include "oidmap.h"
+#include "repository.h"
+#include "sha1_lookup.h"
+#include "vector.h"
+
+#include "git2/commit.h"
+#include "git2/graph.h"
+#include "git2/revwalk.h"
+
+GIT__USE_OIDMAP;
+
+#define COMMIT_GRAPH_SIGNATURE 0x43475048 /* "CGPH" */
+#define COMMIT_GRAPH_VERSION 1
+#define COMMIT_GRAPH_HASH_VERSION 1 /* SHA-1 */
+
+#define COMMIT_GRAPH_CHUNK_OIDF 0x4f494446 /* "OIDF" */
+#define COMMIT_GRAPH_CHUNK_OIDL 0x4f49444c /* "OIDL" */
+#define COMMIT_GRAPH_CHUNK_CDAT 0x43444154 /* "CDAT" */
+#define COMMIT_GRAPH_CHUNK_EDGE 0x45444745 /* "EDGE" */
+
+#define COMMIT_GRAPH_HEADER_SIZE 8
+#define COMMIT_GRAPH_CHUNK_ENTRY_SIZE 12
+#define COMMIT_GRAPH_FANOUT_SIZE (256 * 4)
+#define COMMIT_GRAPH_DATA_SIZE (GIT_OID_RAWSZ + 16)
+
+#define COMMIT_GRAPH_PARENT_NONE 0x70000000
+#define COMMIT_GRAPH_EXTRA_EDGES 0x80000000
+#define COMMIT_GRAPH_LAST_EDGE 0x80000000
+
+static int commit_graph_error(const char *message)
+{
+	giterr_set(GITERR_ODB, "Invalid commit-graph file - %s", message);
+	return -1;
+}
+
+GIT_INLINE(uint32_t) get_be32(const unsigned char *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+		((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+GIT_INLINE(uint64_t) get_be64(const unsigned char *p)
+{
+	return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+static void commit_graph_free(git_commit_graph *graph)
+{
+	git_futils_mmap_free(&graph->map);
+	git__free(graph);
+}
+
+static int commit_graph_parse(git_commit_graph *graph)
+{
+	const unsigned char *data = graph->map.data, *entry;
+	size_t size = graph->map.len, nchunks, table_end, i;
+	size_t oids_len = 0, data_len = 0;
+	uint64_t offset, next_offset, trailer;
+	uint32_t prev = 0, count;
+
+	if (size < COMMIT_GRAPH_HEADER_SIZE + COMMIT_GRAPH_CHUNK_ENTRY_SIZE + GIT_OID_RAWSZ)
+		return commit_graph_error("file is too short");
+
+	if (get_be32(data) != COMMIT_GRAPH_SIGNATURE)
+		return commit_graph_error("bad signature");
+	if (data[4] != COMMIT_GRAPH_VERSION)
+		return commit_graph_error("unsupported version");
+	if (data[5] != COMMIT_GRAPH_HASH_VERSION)
+		return commit_graph_error("unsupported hash");
+	if (data[7] != 0)
+		return commit_graph_error("split commit-graphs are not supported");
+
+	nchunks = data[6];
+	trailer = size - GIT_OID_RAWSZ;
+	table_end = COMMIT_GRAPH_HEADER_SIZE + (nchunks + 1) * COMMIT_GRAPH_CHUNK_ENTRY_SIZE;
+	if (table_end > trailer)
+		return commit_graph_error("chunk table is truncated");
+
+	for (i = 0; i < nchunks; i++) {
+		entry = data + COMMIT_GRAPH_HEADER_SIZE + i * COMMIT_GRAPH_CHUNK_ENTRY_SIZE;
+		offset = get_be64(entry + 4);
+		next_offset = get_be64(entry + COMMIT_GRAPH_CHUNK_ENTRY_SIZE + 4);
+
+		if (offset < table_end || next_offset < offset || next_offset > trailer)
+			return commit_graph_error("invalid chunk offset");
+
+		switch (get_be32(entry)) {
+		case COMMIT_GRAPH_CHUNK_OIDF:
+			if (next_offset - offset != COMMIT_GRAPH_FANOUT_SIZE)
+				return commit_graph_error("invalid fanout chunk");
+			graph->fanout = data + offset;
+			break;
+		case COMMIT_GRAPH_CHUNK_OIDL:
+			graph->oids = data + offset;
+			oids_len = (size_t)(next_offset - offset);
+			break;
+		case COMMIT_GRAPH_CHUNK_CDAT:
+			graph->data = data + offset;
+			data_len = (size_t)(next_offset - offset);
+			break;
+		case COMMIT_GRAPH_CHUNK_EDGE:
+			graph->extra_edges = data + offset;
+			graph->num_extra_edges = (size_t)(next_offset - offset) / 4;
+			break;
+		default:
+			/* optional chunks we do not know about */
+			break;
+		}
+	}
+
+	if (!graph->fanout || !graph->oids || !graph->data)
+		return commit_graph_error("missing required chunk");
+
+	for (i = 0; i < 256; i++) {
+		count = get_be32(graph->fanout + i * 4);
+		if (count < prev)
+			return commit_graph_error("fanout table is not sorted");
+		prev = count;
+	}
+
+	graph->num_commits = prev;
+	if (oids_len != (size_t)graph->num_commits * GIT_OID_RAWSZ ||
+		data_len != (size_t)graph->num_commits * COMMIT_GRAPH_DATA_SIZE)
+		return commit_graph_error("chunk sizes do not match the commit count");
+
+	return 0;
+}
+
+int git_commit_graph_open(git_commit_graph **out, const char *objects_dir)
+{
+	git_commit_graph *graph;
+	git_buf path = GIT_BUF_INIT;
+	int error;
+
+	assert(out && objects_dir);
+
+	*out = NULL;
+
+	if (git_buf_joinpath(&path, objects_dir, GIT_COMMIT_GRAPH_FILE) < 0)
+		return -1;
+
+	if (!git_path_isfile(path.ptr)) {
+		git_buf_free(&path);
+		return GIT_ENOTFOUND;
+	}
+
+	graph = git__calloc(1, sizeof(git_commit_graph));
+	GITERR_CHECK_ALLOC(graph);
+
+	error = git_futils_mmap_ro_file(&graph->map, path.ptr);
+	git_buf_free(&path);
+
+	if (error < 0) {
+		git__free(graph);
+		return error;
+	}
+
+	if ((error = commit_graph_parse(graph)) < 0) {
+		commit_graph_free(graph);
+		return error;
+	}
+
+	GIT_REFCOUNT_INC(graph);
+	*out = graph;
+	return 0;
+}
+
+void git_commit_graph_free(git_commit_graph *graph)
+{
+	if (graph == NULL)
+		return;
+
+	GIT_REFCOUNT_DEC(graph, commit_graph_free);
+}
+
+int git_commit_graph_find(
+	size_t *pos, const git_commit_graph *graph, const git_oid *id)
+{
+	uint32_t lo, hi;
+	int found;
+
+	hi = get_be32(graph->fanout + id->id[0] * 4);
+	lo = id->id[0] ? get_be32(graph->fanout + (id->id[0] - 1) * 4) : 0;
+
+	found = sha1_position(graph->oids, GIT_OID_RAWSZ, lo, hi, id->id);
+	if (found < 0)
+		return GIT_ENOTFOUND;
+
+	*pos = (size_t)found;
+	return 0;
+}
+
+const git_oid *git_commit_graph_oid(const git_commit_graph *graph, size_t pos)
+{
+	assert(pos < graph->num_commits);
+	return (const git_oid *)(graph->oids + pos * GIT_OID_RAWSZ);
+}
+
+int git_commit_graph_entry_get(
+	git_commit_graph_entry *out, const git_commit_graph *graph, size_t pos)
+{
+	const unsigned char *data;
+	uint32_t parent1, parent2, edge;
+	size_t i;
+
+	assert(out && graph && pos < graph->num_commits);
+
+	data = graph->data + pos * COMMIT_GRAPH_DATA_SIZE;
+	git_oid_fromraw(&out->tree_id, data);
+
+	parent1 = get_be32(data + GIT_OID_RAWSZ);
+	parent2 = get_be32(data + GIT_OID_RAWSZ + 4);
+	out->generation = get_be32(data + GIT_OID_RAWSZ + 8) >> 2;
+	out->commit_time = (git_time_t)(get_be64(data + GIT_OID_RAWSZ + 8) & 0x3ffffffffULL);
+	out->parent_count = 0;
+	out->extra_edge = 0;
+
+	if (parent1 == COMMIT_GRAPH_PARENT_NONE)
+		return 0;
+
+	if (parent1 >= graph->num_commits)
+		return commit_graph_error("parent out of range");
+
+	out->parent_pos[0] = parent1;
+	out->parent_count = 1;
+
+	if (parent2 == COMMIT_GRAPH_PARENT_NONE)
+		return 0;
+
+	if (!(parent2 & COMMIT_GRAPH_EXTRA_EDGES)) {
+		if (parent2 >= graph->num_commits)
+			return commit_graph_error("parent out of range");
+
+		out->parent_pos[1] = parent2;
+		out->parent_count = 2;
+		return 0;
+	}
+
+	/* an octopus merge: the other parents are in the extra edge list */
+	out->extra_edge = parent2 & ~COMMIT_GRAPH_EXTRA_EDGES;
+
+	for (i = out->extra_edge; i < graph->num_extra_edges; i++) {
+		edge = get_be32(graph->extra_edges + i * 4);
+		if ((edge & ~COMMIT_GRAPH_LAST_EDGE) >= graph->num_commits)
+			return commit_graph_error("parent out of range");
+
+		out->parent_count++;
+		if (edge & COMMIT_GRAPH_LAST_EDGE)
+			return 0;
+	}
+
+	return commit_graph_error("unterminated extra edge list");
+}
+
+int git_commit_graph_parent(
+	size_t *parent_pos,
+	const git_commit_graph *graph,
+	const git_commit_graph_entry *entry,
+	size_t n)
+{
+	assert(parent_pos && graph && entry);
+
+	if (n >= entry->parent_count)
+		return GIT_ENOTFOUND;
+
+	if (n == 0)
+		*parent_pos = entry->parent_pos[0];
+	else if (entry->parent_count == 2)
+		*parent_pos = entry->parent_pos[1];
+	else
+		*parent_pos = get_be32(graph->extra_edges + (entry->extra_edge + n - 1) * 4) &
+			~COMMIT_GRAPH_LAST_EDGE;
+
+	return 0;
+}
+
+/*
+ * Writing
+ */
+
+typedef struct {
+	git_oid id;
+	git_oid tree_id;
+	git_time_t time;
+	uint32_t generation;
+	uint32_t pos;
+	size_t parent_count;
+	git_oid *parents;
+} commit_graph_wentry;
+
+static int wentry_cmp(const void *a, const void *b)
+{
+	const commit_graph_wentry *entry_a = a, *entry_b = b;
+	return git_oid_cmp(&entry_a->id, &entry_b->id);
+}
+
+static void wentries_free(git_vector *entries)
+{
+	commit_graph_wentry *entry;
+	size_t i;
+
+	git_vector_foreach(entries, i, entry) {
+		git__free(entry->parents);
+		git__free(entry);
+	}
+
+	git_vector_free(entries);
+}
+
+static int wentry_parent_pos(
+	uint32_t *out, git_oidmap *map, const git_oid *id)
+{
+	khiter_t k = kh_get(oid, map, id);
+	commit_graph_wentry *parent;
+
+	if (k == kh_end(map)) {
+		char str[GIT_OID_HEXSZ + 1];
+		giterr_set(GITERR_ODB, "Parent commit %s is missing",
+			git_oid_tostr(str, sizeof(str), id));
+		return -1;
+	}
+
+	parent = kh_value(map, k);
+	*out = parent->pos;
+	return 0;
+}
+
+/* Collect every commit reachable from HEAD and the references, parents first */
+static int collect_commits(
+	git_vector *entries, git_oidmap *map, git_repository *repo)
+{
+	git_revwalk *walk;
+	git_commit *commit;
+	commit_graph_wentry *entry, *parent;
+	git_oid id;
+	khiter_t k;
+	size_t i;
+	int error;
+
+	if ((error = git_revwalk_new(&walk, repo)) < 0)
+		return error;
+
+	git_revwalk_sorting(walk, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+
+	if ((error = git_revwalk_push_glob(walk, "*")) < 0)
+		goto done;
+
+	if ((error = git_revwalk_push_head(walk)) < 0) {
+		if (error != GIT_ENOTFOUND && error != GIT_EUNBORNBRANCH)
+			goto done;
+		giterr_clear();
+	}
+
+	while ((error = git_revwalk_next(&id, walk)) == 0) {
+		if ((error = git_commit_lookup(&commit, repo, &id)) < 0)
+			goto done;
+
+		entry = git__calloc(1, sizeof(commit_graph_wentry));
+		if (entry != NULL && (entry->parent_count = git_commit_parentcount(commit)) > 0 &&
+			(entry->parents = git__calloc(entry->parent_count, sizeof(git_oid))) == NULL) {
+			git__free(entry);
+			entry = NULL;
+		}
+
+		if (entry == NULL) {
+			git_commit_free(commit);
+			error = -1;
+			goto done;
+		}
+
+		git_oid_cpy(&entry->id, &id);
+		git_oid_cpy(&entry->tree_id, git_commit_tree_id(commit));
+		entry->time = git_commit_time(commit);
+		entry->generation = 1;
+
+		for (i = 0; i < entry->parent_count; i++) {
+			git_oid_cpy(&entry->parents[i], git_commit_parent_id(commit, (unsigned int)i));
+
+			/* parents were seen first, so their generation is final */
+			k = kh_get(oid, map, &entry->parents[i]);
+			if (k != kh_end(map)) {
+				parent = kh_value(map, k);
+				if (parent->generation >= entry->generation)
+					entry->generation = parent->generation + 1;
+			}
+		}
+
+		if (entry->generation > GIT_COMMIT_GRAPH_GENERATION_MAX)
+			entry->generation = GIT_COMMIT_GRAPH_GENERATION_MAX;
+
+		git_commit_free(commit);
+
+		if ((error = git_vector_insert(entries, entry)) < 0) {
+			git__free(entry->parents);
+			git__free(entry);
+			goto done;
+		}
+
+		k = kh_put(oid, map, &entry->id, &error);
+		if (error < 0)
+			goto done;
+		kh_value(map, k) = entry;
+	}
+
+	if (error == GIT_ITEROVER)
+		error = 0;
+
+done:
+	git_revwalk_free(walk);
+	return error;
+}
+
+static void put_be32(git_buf *buf, uint32_t value)
+{
+	uint32_t be = htonl(value);
+	git_buf_put(buf, (const char *)&be, 4);
+}
+
+static void put_chunk(git_buf *buf, uint32_t id, uint64_t offset)
+{
+	put_be32(buf, id);
+	put_be32(buf, (uint32_t)(offset >> 32));
+	put_be32(buf, (uint32_t)offset);
+}
+
+static int write_graph(git_buf *out, git_vector *entries, git_oidmap *map)
+{
+	commit_graph_wentry *entry;
+	git_buf edges = GIT_BUF_INIT;
+	uint32_t fanout[256], parent, num_edges = 0;
+	uint64_t offset;
+	size_t i, n, nchunks;
+	git_oid checksum;
+	int error = 0;
+
+	memset(fanout, 0, sizeof(fanout));
+	git_vector_foreach(entries, i, entry) {
+		for (n = entry->id.id[0]; n < 256; n++)
+			fanout[n]++;
+	}
+
+	/* extra edges of octopus merges, every list ends with the high bit set */
+	git_vector_foreach(entries, i, entry) {
+		if (entry->parent_count <= 2)
+			continue;
+
+		for (n = 1; n < entry->parent_count; n++) {
+			if ((error = wentry_parent_pos(&parent, map, &entry->parents[n])) < 0)
+				goto done;
+			if (n == entry->parent_count - 1)
+				parent |= COMMIT_GRAPH_LAST_EDGE;
+			put_be32(&edges, parent);
+		}
+	}
+
+	nchunks = edges.size ? 4 : 3;
+
+	/* header */
+	put_be32(out, COMMIT_GRAPH_SIGNATURE);
+	git_buf_putc(out, COMMIT_GRAPH_VERSION);
+	git_buf_putc(out, COMMIT_GRAPH_HASH_VERSION);
+	git_buf_putc(out, (char)nchunks);
+	git_buf_putc(out, 0);
+
+	/* chunk table */
+	offset = COMMIT_GRAPH_HEADER_SIZE + (nchunks + 1) * COMMIT_GRAPH_CHUNK_ENTRY_SIZE;
+	put_chunk(out, COMMIT_GRAPH_CHUNK_OIDF, offset);
+	offset += COMMIT_GRAPH_FANOUT_SIZE;
+	put_chunk(out, COMMIT_GRAPH_CHUNK_OIDL, offset);
+	offset += entries->length * GIT_OID_RAWSZ;
+	put_chunk(out, COMMIT_GRAPH_CHUNK_CDAT, offset);
+	offset += entries->length * COMMIT_GRAPH_DATA_SIZE;
+	if (edges.size) {
+		put_chunk(out, COMMIT_GRAPH_CHUNK_EDGE, offset);
+		offset += edges.size;
+	}
+	put_chunk(out, 0, offset);
+
+	for (i = 0; i < 256; i++)
+		put_be32(out, fanout[i]);
+
+	git_vector_foreach(entries, i, entry)
+		git_buf_put(out, (const char *)entry->id.id, GIT_OID_RAWSZ);
+
+	git_vector_foreach(entries, i, entry) {
+		git_buf_put(out, (const char *)entry->tree_id.id, GIT_OID_RAWSZ);
+
+		if (entry->parent_count == 0) {
+			put_be32(out, COMMIT_GRAPH_PARENT_NONE);
+		} else {
+			if ((error = wentry_parent_pos(&parent, map, &entry->parents[0])) < 0)
+				goto done;
+			put_be32(out, parent);
+		}
+
+		if (entry->parent_count <= 1) {
+			put_be32(out, COMMIT_GRAPH_PARENT_NONE);
+		} else if (entry->parent_count == 2) {
+			if ((error = wentry_parent_pos(&parent, map, &entry->parents[1])) < 0)
+				goto done;
+			put_be32(out, parent);
+		} else {
+			put_be32(out, COMMIT_GRAPH_EXTRA_EDGES | num_edges);
+			num_edges += (uint32_t)(entry->parent_count - 1);
+		}
+
+		put_be32(out, (entry->generation << 2) |
+			(uint32_t)(((uint64_t)entry->time >> 32) & 0x3));
+		put_be32(out, (uint32_t)entry->time);
+	}
+
+	git_buf_put(out, edges.ptr, edges.size);
+
+	if (git_buf_oom(out)) {
+		error = -1;
+		goto done;
+	}
+
+	if ((error = git_hash_buf(&checksum, out->ptr, out->size)) < 0)
+		goto done;
+
+	git_buf_put(out, (const char *)checksum.id, GIT_OID_RAWSZ);
+	error = git_buf_oom(out) ? -1 : 0;
+
+done:
+	git_buf_free(&edges);
+	return error;
+}
+
+int git_graph_write_commit_graph(git_repository *repo)
+{
+	git_vector entries = GIT_VECTOR_INIT;
+	git_oidmap *map;
+	git_buf path = GIT_BUF_INIT, contents = GIT_BUF_INIT;
+	git_filebuf file = GIT_FILEBUF_INIT;
+	commit_graph_wentry *entry;
+	size_t i;
+	int error;
+
+	assert(repo);
+
+	if ((error = git_repository_is_shallow(repo)) != 0) {
+		if (error > 0) {
+			giterr_set(GITERR_INVALID,
+				"Cannot write a commit-graph for a shallow repository");
+			error = -1;
+		}
+		return error;
+	}
+
+	map = git_oidmap_alloc();
+	GITERR_CHECK_ALLOC(map);
+
+	if ((error = git_vector_init(&entries, 0, wentry_cmp)) < 0 ||
+		(error = collect_commits(&entries, map, repo)) < 0)
+		goto done;
+
+	git_vector_sort(&entries);
+	git_vector_foreach(&entries, i, entry)
+		entry->pos = (uint32_t)i;
+
+	if ((error = write_graph(&contents, &entries, map)) < 0)
+		goto done;
+
+	if ((error = git_buf_joinpath(&path, repo->path_repository, GIT_OBJECTS_DIR)) < 0 ||
+		(error = git_buf_joinpath(&path, path.ptr, GIT_COMMIT_GRAPH_FILE)) < 0 ||
+		(error = git_futils_mkpath2file(path.ptr, GIT_OBJECT_DIR_MODE)) < 0 ||
+		(error = git_filebuf_open(&file, path.ptr, 0, GIT_OBJECT_FILE_MODE)) < 0 ||
+		(error = git_filebuf_write(&file, contents.ptr, contents.size)) < 0 ||
+		(error = git_filebuf_commit(&file)) < 0)
+		goto done;
+
+	/* make the next walk pick up the new file */
+	git_repository__set_commit_graph(repo, NULL);
+
+done:
+	git_filebuf_cleanup(&file);
+	git_buf_free(&contents);
+	git_buf_free(&path);
+	wentries_free(&entries);
+	git_oidmap_free(map);
+	return error;
+}
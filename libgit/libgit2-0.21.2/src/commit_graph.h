@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_commit_graph_h__
+#define INCLUDE_commit_graph_h__
+
+#include "common.h"
+#include "map.h"
+#include "git2/oid.h"
+
+/*
+ * Reader for git's commit-graph file (objects/info/commit-graph): a
+ * sorted table of commit ids with their parents, commit time and
+ * generation number, so history can be walked without inflating
+ * commit objects.
+ */
+
+#define GIT_COMMIT_GRAPH_FILE "info/commit-graph"
+
+/* commits missing from the graph count as newer than every commit in it */
+#define GIT_COMMIT_GRAPH_GENERATION_INFINITY 0xffffffff
+#define GIT_COMMIT_GRAPH_GENERATION_MAX 0x3fffffff
+
+typedef struct {
+	git_refcount rc;
+	git_map map;
+
+	const unsigned char *fanout;
+	const unsigned char *oids;
+	const unsigned char *data;
+	const unsigned char *extra_edges;
+	size_t num_extra_edges;
+	uint32_t num_commits;
+} git_commit_graph;
+
+typedef struct {
+	git_oid tree_id;
+	uint32_t generation;
+	git_time_t commit_time;
+	size_t parent_count;
+
+	/* private */
+	uint32_t parent_pos[2];
+	uint32_t extra_edge;
+} git_commit_graph_entry;
+
+/* Returns GIT_ENOTFOUND when the repository has no commit-graph */
+int git_commit_graph_open(git_commit_graph **out, const char *objects_dir);
+void git_commit_graph_free(git_commit_graph *graph);
+
+int git_commit_graph_find(
+	size_t *pos, const git_commit_graph *graph, const git_oid *id);
+const git_oid *git_commit_graph_oid(
+	const git_commit_graph *graph, size_t pos);
+int git_commit_graph_entry_get(
+	git_commit_graph_entry *out, const git_commit_graph *graph, size_t pos);
+int git_commit_graph_parent(
+	size_t *parent_pos,
+	const git_commit_graph *graph,
+	const git_commit_graph_entry *entry,
+	size_t n);
+
+#endif
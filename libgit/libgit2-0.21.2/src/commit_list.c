@@ -19,6 +19,22 @@ int git_commit_list_time_cmp(const void *a, const void *b)
 	return (commit_a->time < commit_b->time);
 }
 
+/*
+ * Like git_commit_list_time_cmp, but a commit never comes out of the queue
+ * before its descendants when generation numbers are known, whatever the
+ * clocks of their authors said.
+ */
+int git_commit_list_generation_cmp(const void *a, const void *b)
+{
+	const git_commit_list_node *commit_a = a;
+	const git_commit_list_node *commit_b = b;
+
+	if (commit_a->generation != commit_b->generation)
+		return (commit_a->generation < commit_b->generation);
+
+	return (commit_a->time < commit_b->time);
+}
+
 git_commit_list *git_commit_list_insert(git_commit_list_node *item, git_commit_list **list_p)
 {
 	git_commit_list *new_list = git__malloc(sizeof(git_commit_list));
@@ -108,7 +124,7 @@ static int commit_quick_parse(
 {
 	const size_t parent_len = strlen("parent ") + GIT_OID_HEXSZ + 1;
 	const uint8_t *buffer_end = buffer + buffer_len;
-	const uint8_t *parents_start, *committer_start;
+	const uint8_t *parents_start, *parents_end, *committer_start;
 	int i, parents = 0;
 	int commit_time;
 
@@ -120,6 +136,12 @@ static int commit_quick_parse(
 		buffer += parent_len;
 	}
 
+	parents_end = buffer;
+
+	/* the parents of a shallow clone's boundary were never fetched */
+	if (git_repository__is_shallow_root(&walk->shallow_roots, &commit->oid))
+		parents = 0;
+
 	commit->parents = alloc_parents(walk, commit, parents);
 	GITERR_CHECK_ALLOC(commit->parents);
 
@@ -138,6 +160,7 @@ static int commit_quick_parse(
 	}
 
 	commit->out_degree = (unsigned short)parents;
+	buffer = parents_end;
 
 	if ((committer_start = buffer = memchr(buffer, '\n', buffer_end - buffer)) == NULL)
 		return commit_error(commit, "object is corrupted");
@@ -174,14 +197,47 @@ static int commit_quick_parse(
 	return 0;
 }
 
+static int commit_graph_parse(
+	git_revwalk *walk, git_commit_list_node *commit, size_t pos)
+{
+	git_commit_graph_entry entry;
+	size_t i, parent_pos;
+
+	if (git_commit_graph_entry_get(&entry, walk->graph, pos) < 0)
+		return -1;
+
+	commit->parents = alloc_parents(walk, commit, entry.parent_count);
+	GITERR_CHECK_ALLOC(commit->parents);
+
+	for (i = 0; i < entry.parent_count; ++i) {
+		if (git_commit_graph_parent(&parent_pos, walk->graph, &entry, i) < 0)
+			return -1;
+
+		commit->parents[i] = git_revwalk__commit_lookup(
+			walk, git_commit_graph_oid(walk->graph, parent_pos));
+		if (commit->parents[i] == NULL)
+			return -1;
+	}
+
+	commit->out_degree = (unsigned short)entry.parent_count;
+	commit->time = (uint32_t)entry.commit_time;
+	commit->generation = entry.generation;
+	commit->parsed = 1;
+	return 0;
+}
+
 int git_commit_list_parse(git_revwalk *walk, git_commit_list_node *commit)
 {
 	git_odb_object *obj;
+	size_t pos;
 	int error;
 
 	if (commit->parsed)
 		return 0;
 
+	if (walk->graph && git_commit_graph_find(&pos, walk->graph, &commit->oid) == 0)
+		return commit_graph_parse(walk, commit, pos);
+
 	if ((error = git_odb_read(&obj, walk->odb, &commit->oid)) < 0)
 		return error;
 
@@ -979,8 +979,15 @@ static int handle_unmatched_new_item(
 static int handle_unmatched_old_item(
 	git_diff *diff, diff_in_progress *info)
 {
-	int error = diff_delta__from_one(diff, GIT_DELTA_DELETED, info->oitem);
-	if (error != 0)
+	int error;
+
+	/* files outside of the sparse checkout are not expected in the workdir */
+	if ((info->oitem->flags_extended & GIT_IDXENTRY_SKIP_WORKTREE) != 0 &&
+		info->new_iter->type == GIT_ITERATOR_TYPE_WORKDIR)
+		return git_iterator_advance(&info->oitem, info->old_iter);
+
+	if ((error = diff_delta__from_one(
+			diff, GIT_DELTA_DELETED, info->oitem)) != 0)
 		return error;
 
 	/* if we are generating TYPECHANGE records then check for that
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "ewah.h"
+
+#define EWAH_RUNNING_BITS 32
+#define EWAH_LITERAL_BITS 31
+#define EWAH_MAX_RUNNING ((((uint64_t)1) << EWAH_RUNNING_BITS) - 1)
+#define EWAH_MAX_LITERAL ((((uint64_t)1) << EWAH_LITERAL_BITS) - 1)
+
+GIT_INLINE(unsigned int) lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctzll(word);
+#else
+	unsigned int n = 0;
+
+	while (!(word & 1)) {
+		word >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+GIT_INLINE(unsigned int) bit_count(uint64_t word)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_popcountll(word);
+#else
+	unsigned int n = 0;
+
+	for (; word; word &= word - 1)
+		n++;
+	return n;
+#endif
+}
+
+static int bitmap_grow(git_bitmap *bitmap, size_t words)
+{
+	size_t alloc;
+	uint64_t *grown;
+
+	if (words <= bitmap->word_alloc)
+		return 0;
+
+	alloc = bitmap->word_alloc ? bitmap->word_alloc : 32;
+	while (alloc < words)
+		alloc *= 2;
+
+	grown = git__realloc(bitmap->words, alloc * sizeof(uint64_t));
+	GITERR_CHECK_ALLOC(grown);
+
+	memset(grown + bitmap->word_alloc, 0,
+		(alloc - bitmap->word_alloc) * sizeof(uint64_t));
+
+	bitmap->words = grown;
+	bitmap->word_alloc = alloc;
+	return 0;
+}
+
+int git_bitmap_set(git_bitmap *bitmap, size_t pos)
+{
+	size_t word = pos / 64;
+
+	if (bitmap_grow(bitmap, word + 1) < 0)
+		return -1;
+
+	bitmap->words[word] |= (uint64_t)1 << (pos % 64);
+	return 0;
+}
+
+void git_bitmap_clear(git_bitmap *bitmap)
+{
+	if (bitmap->words)
+		memset(bitmap->words, 0, bitmap->word_alloc * sizeof(uint64_t));
+}
+
+void git_bitmap_free(git_bitmap *bitmap)
+{
+	git__free(bitmap->words);
+	bitmap->words = NULL;
+	bitmap->word_alloc = 0;
+}
+
+int git_bitmap_or(git_bitmap *bitmap, const git_bitmap *other)
+{
+	size_t i;
+
+	if (bitmap_grow(bitmap, other->word_alloc) < 0)
+		return -1;
+
+	for (i = 0; i < other->word_alloc; i++)
+		bitmap->words[i] |= other->words[i];
+
+	return 0;
+}
+
+int git_bitmap_xor(git_bitmap *bitmap, const git_bitmap *other)
+{
+	size_t i;
+
+	if (bitmap_grow(bitmap, other->word_alloc) < 0)
+		return -1;
+
+	for (i = 0; i < other->word_alloc; i++)
+		bitmap->words[i] ^= other->words[i];
+
+	return 0;
+}
+
+void git_bitmap_and_not(git_bitmap *bitmap, const git_bitmap *other)
+{
+	size_t i, n = min(bitmap->word_alloc, other->word_alloc);
+
+	for (i = 0; i < n; i++)
+		bitmap->words[i] &= ~other->words[i];
+}
+
+bool git_bitmap_contains(const git_bitmap *bitmap, const git_bitmap *other)
+{
+	size_t i;
+
+	for (i = 0; i < other->word_alloc; i++) {
+		uint64_t have = i < bitmap->word_alloc ? bitmap->words[i] : 0;
+
+		if (other->words[i] & ~have)
+			return false;
+	}
+
+	return true;
+}
+
+size_t git_bitmap_count(const git_bitmap *bitmap)
+{
+	size_t i, count = 0;
+
+	for (i = 0; i < bitmap->word_alloc; i++)
+		count += bit_count(bitmap->words[i]);
+
+	return count;
+}
+
+int git_bitmap_foreach(
+	const git_bitmap *bitmap,
+	int (*cb)(size_t pos, void *payload),
+	void *payload)
+{
+	size_t i;
+	uint64_t word;
+	int error;
+
+	for (i = 0; i < bitmap->word_alloc; i++) {
+		for (word = bitmap->words[i]; word; word &= word - 1) {
+			if ((error = cb(i * 64 + lowest_bit(word), payload)) != 0)
+				return error;
+		}
+	}
+
+	return 0;
+}
+
+GIT_INLINE(uint32_t) get_be32(const unsigned char *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+		((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+GIT_INLINE(uint64_t) get_be64(const unsigned char *p)
+{
+	return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+static int ewah_error(const char *message)
+{
+	giterr_set(GITERR_ODB, "Invalid EWAH bitmap - %s", message);
+	return -1;
+}
+
+ssize_t git_ewah_size(const unsigned char *data, size_t len)
+{
+	size_t nwords;
+
+	if (len < 12)
+		return ewah_error("header is truncated");
+
+	nwords = get_be32(data + 4);
+	if (nwords > (len - 12) / 8)
+		return ewah_error("data is truncated");
+
+	return (ssize_t)(8 + nwords * 8 + 4);
+}
+
+ssize_t git_ewah_read(
+	git_bitmap *out,
+	const unsigned char *data,
+	size_t len,
+	size_t max_bits)
+{
+	const unsigned char *words;
+	size_t nwords, max_words, i, out_pos = 0;
+	uint64_t marker, run, literals;
+	ssize_t size;
+
+	assert(out && !out->words);
+
+	if ((size = git_ewah_size(data, len)) < 0)
+		return size;
+
+	/* the bit count only matters to git's own in-memory operations */
+	nwords = get_be32(data + 4);
+	words = data + 8;
+	max_words = (max_bits + 63) / 64;
+
+	for (i = 0; i < nwords; ) {
+		marker = get_be64(words + i * 8);
+		run = (marker >> 1) & EWAH_MAX_RUNNING;
+		literals = marker >> (1 + EWAH_RUNNING_BITS);
+		i++;
+
+		if (run > max_words - out_pos || literals > nwords - i ||
+			literals > max_words - out_pos - run)
+			return ewah_error("bitmap is too long");
+
+		if (marker & 1) {
+			if (bitmap_grow(out, out_pos + (size_t)run) < 0)
+				return -1;
+			memset(out->words + out_pos, 0xff, (size_t)run * sizeof(uint64_t));
+		}
+		out_pos += (size_t)run;
+
+		if (literals && bitmap_grow(out, out_pos + (size_t)literals) < 0)
+			return -1;
+
+		for (; literals; literals--, i++, out_pos++)
+			out->words[out_pos] = get_be64(words + i * 8);
+	}
+
+	/* the position of the last marker word follows, which we do not need */
+	return size;
+}
+
+static void put_be32(git_buf *buf, uint32_t value)
+{
+	uint32_t be = htonl(value);
+	git_buf_put(buf, (const char *)&be, 4);
+}
+
+static void put_be64(git_buf *buf, uint64_t value)
+{
+	put_be32(buf, (uint32_t)(value >> 32));
+	put_be32(buf, (uint32_t)value);
+}
+
+GIT_INLINE(bool) is_clean(uint64_t word)
+{
+	return word == 0 || word == ~(uint64_t)0;
+}
+
+int git_ewah_write(git_buf *out, const git_bitmap *bitmap)
+{
+	size_t nwords = bitmap->word_alloc, i = 0, start, written = 0, last_marker = 0;
+	size_t header = out->size;
+	uint64_t clean, run, literals, run_bit;
+	uint32_t count;
+
+	/* trailing zeroes are implied */
+	while (nwords && bitmap->words[nwords - 1] == 0)
+		nwords--;
+
+	put_be32(out, (uint32_t)(nwords * 64));
+	put_be32(out, 0); /* word count, filled in below */
+
+	do {
+		run = 0;
+		run_bit = 0;
+
+		if (i < nwords && is_clean(bitmap->words[i])) {
+			clean = bitmap->words[i];
+			run_bit = clean & 1;
+
+			while (i < nwords && run < EWAH_MAX_RUNNING && bitmap->words[i] == clean) {
+				run++;
+				i++;
+			}
+		}
+
+		start = i;
+		while (i < nwords && !is_clean(bitmap->words[i]) &&
+			(uint64_t)(i - start) < EWAH_MAX_LITERAL)
+			i++;
+		literals = i - start;
+
+		last_marker = written;
+		put_be64(out, run_bit | (run << 1) | (literals << (1 + EWAH_RUNNING_BITS)));
+		written++;
+
+		for (; start < i; start++, written++)
+			put_be64(out, bitmap->words[start]);
+	} while (i < nwords);
+
+	put_be32(out, (uint32_t)last_marker);
+
+	if (git_buf_oom(out))
+		return -1;
+
+	count = htonl((uint32_t)written);
+	memcpy(out->ptr + header + 4, &count, 4);
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_ewah_h__
+#define INCLUDE_ewah_h__
+
+#include "common.h"
+#include "buffer.h"
+
+/*
+ * A growable, uncompressed bitmap, and its EWAH compressed on-disk form
+ * as used by git's pack bitmap indexes.
+ *
+ * EWAH stores a sequence of marker words, each followed by literal
+ * words: the marker gives a run of all-zero or all-one words (bit 0 is
+ * the run's bit, bits 1-32 its length) and the number of literal words
+ * that follow it (bits 33-63). Bit `n` of the bitmap is bit `n % 64` of
+ * word `n / 64`.
+ */
+
+typedef struct {
+	uint64_t *words;
+	size_t word_alloc;
+} git_bitmap;
+
+#define GIT_BITMAP_INIT {NULL, 0}
+
+GIT_INLINE(bool) git_bitmap_get(const git_bitmap *bitmap, size_t pos)
+{
+	size_t word = pos / 64;
+
+	return word < bitmap->word_alloc &&
+		(bitmap->words[word] & ((uint64_t)1 << (pos % 64))) != 0;
+}
+
+extern int git_bitmap_set(git_bitmap *bitmap, size_t pos);
+extern void git_bitmap_clear(git_bitmap *bitmap);
+extern void git_bitmap_free(git_bitmap *bitmap);
+
+extern int git_bitmap_or(git_bitmap *bitmap, const git_bitmap *other);
+extern int git_bitmap_xor(git_bitmap *bitmap, const git_bitmap *other);
+extern void git_bitmap_and_not(git_bitmap *bitmap, const git_bitmap *other);
+
+/* Whether every bit of `other` is set in `bitmap` */
+extern bool git_bitmap_contains(const git_bitmap *bitmap, const git_bitmap *other);
+extern size_t git_bitmap_count(const git_bitmap *bitmap);
+
+/*
+ * Call `cb` with the position of every set bit, in increasing order;
+ * a non-zero return stops the iteration and is returned
+ */
+extern int git_bitmap_foreach(
+	const git_bitmap *bitmap,
+	int (*cb)(size_t pos, void *payload),
+	void *payload);
+
+/* Size of the EWAH bitmap at the start of `data`, or -1 if it is truncated */
+extern ssize_t git_ewah_size(const unsigned char *data, size_t len);
+
+/*
+ * Decode the EWAH bitmap at the start of `data` into `out`, which must be
+ * empty. Bitmaps longer than `max_bits` are rejected. Returns the number
+ * of bytes read, or -1 on error.
+ */
+extern ssize_t git_ewah_read(
+	git_bitmap *out,
+	const unsigned char *data,
+	size_t len,
+	size_t max_bits);
+
+/* Append `bitmap` to `out` in EWAH form */
+extern int git_ewah_write(git_buf *out, const git_bitmap *bitmap);
+
+#endif
@@ -19,7 +19,7 @@
 #include "repository.h"
 #include "refs.h"
 
-static int maybe_want(git_remote *remote, git_remote_head *head, git_odb *odb, git_refspec *tagspec)
+static int maybe_want(git_remote *remote, git_remote_head *head, git_odb *odb, git_refspec *tagspec, int deepen)
 {
 	int match = 0;
 
@@ -41,8 +41,11 @@ static int maybe_want(git_remote *remote, git_remote_head *head, git_odb *odb, g
 	if (!match)
 		return 0;
 
-	/* If we have the object, mark it so we don't ask for it */
-	if (git_odb_exists(odb, &head->oid)) {
+	/*
+	 * If we have the object, mark it so we don't ask for it, unless
+	 * the history behind it is what we're after
+	 */
+	if (!deepen && git_odb_exists(odb, &head->oid)) {
 		head->local = 1;
 	}
 	else
@@ -58,6 +61,7 @@ static int filter_wants(git_remote *remote)
 	int error = 0;
 	git_odb *odb;
 	size_t i, heads_len;
+	int deepen;
 
 	git_vector_clear(&remote->refs);
 	if ((error = git_refspec__parse(&tagspec, GIT_REFSPEC_TAGS, true)) < 0)
@@ -86,8 +90,15 @@ static int filter_wants(git_remote *remote)
 	if (git_remote_ls((const git_remote_head ***)&heads, &heads_len, remote) < 0)
 		goto cleanup;
 
+	/* Deepening a shallow repository can fetch history behind our tips */
+	if ((deepen = git_remote_depth(remote) > 0) &&
+		(deepen = git_repository_is_shallow(remote->repo)) < 0) {
+		error = deepen;
+		goto cleanup;
+	}
+
 	for (i = 0; i < heads_len; i++) {
-		if ((error = maybe_want(remote, heads[i], odb, &tagspec)) < 0)
+		if ((error = maybe_want(remote, heads[i], odb, &tagspec, deepen)) < 0)
 			break;
 	}
 
@@ -105,10 +105,11 @@ static int filter_registry_initialize(void)
 
 	git__on_shutdown(filter_registry_shutdown);
 
-	/* try to register both default filters */
+	/* try to register all default filters */
 	{
 		git_filter *crlf = git_crlf_filter_new();
 		git_filter *ident = git_ident_filter_new();
+		git_filter *lfs = git_lfs_filter_new();
 
 		if (crlf && git_filter_register(
 				GIT_FILTER_CRLF, crlf, GIT_FILTER_CRLF_PRIORITY) < 0)
@@ -116,8 +117,11 @@ static int filter_registry_initialize(void)
 		if (ident && git_filter_register(
 				GIT_FILTER_IDENT, ident, GIT_FILTER_IDENT_PRIORITY) < 0)
 			ident = NULL;
+		if (lfs && git_filter_register(
+				GIT_FILTER_LFS, lfs, GIT_FILTER_LFS_PRIORITY) < 0)
+			lfs = NULL;
 
-		if (!crlf || !ident)
+		if (!crlf || !ident || !lfs)
 			return -1;
 	}
 
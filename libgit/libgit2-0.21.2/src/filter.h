@@ -31,5 +31,6 @@ extern void git_filter_free(git_filter *filter);
 
 extern git_filter *git_crlf_filter_new(void);
 extern git_filter *git_ident_filter_new(void);
+extern git_filter *git_lfs_filter_new(void);
 
 #endif
@@ -0,0 +1,701 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "common.h"
+#include "fsmonitor.h"
+#include "repository.h"
+#include "path.h"
+#include "posix.h"
+
+#ifdef GIT_USE_INOTIFY
+
+#include <sys/inotify.h>
+
+GIT__USE_STRMAP;
+
+#define FSMONITOR_MASK \
+	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | \
+	 IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | \
+	 IN_ONLYDIR | IN_DONT_FOLLOW)
+
+/* events that add or remove directory entries */
+#define FSMONITOR_STRUCTURE \
+	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+typedef struct {
+	char *path; /* relative to the workdir, "" or ending with a slash */
+	int wd;
+	uint32_t flags; /* git_path_dirload flags the listing was read with */
+	unsigned int loaded :1;
+	git_vector entries; /* cached listing, git_path_with_stat */
+	git_vector stale; /* names of the entries that need a new lstat */
+} fsmonitor_dir;
+
+typedef struct {
+	uint64_t token;
+	char path[GIT_FLEX_ARRAY];
+} fsmonitor_change;
+
+static void dir_unload(fsmonitor_dir *dir)
+{
+	git_vector_free_deep(&dir->entries);
+	git_vector_free_deep(&dir->stale);
+	dir->loaded = 0;
+}
+
+static void dir_free(fsmonitor_dir *dir)
+{
+	dir_unload(dir);
+	git__free(dir->path);
+	git__free(dir);
+}
+
+static fsmonitor_dir *dir_lookup(git_fsmonitor *mon, const char *path)
+{
+	khiter_t pos = git_strmap_lookup_index(mon->dirs, path);
+
+	if (!git_strmap_valid_index(mon->dirs, pos))
+		return NULL;
+
+	return git_strmap_value_at(mon->dirs, pos);
+}
+
+static void watch_forget(git_fsmonitor *mon, fsmonitor_dir *dir)
+{
+	void **slot;
+
+	if (dir->wd < 0)
+		return;
+
+	if ((slot = git_array_get(mon->watches, (uint32_t)dir->wd)) != NULL)
+		*slot = NULL;
+
+	inotify_rm_watch(mon->fd, dir->wd);
+	dir->wd = -1;
+}
+
+static int watch_set(git_fsmonitor *mon, int wd, fsmonitor_dir *dir)
+{
+	void **slot;
+
+	while (git_array_size(mon->watches) <= (uint32_t)wd) {
+		slot = git_array_alloc(mon->watches);
+		GITERR_CHECK_ALLOC(slot);
+		*slot = NULL;
+	}
+
+	*git_array_get(mon->watches, (uint32_t)wd) = dir;
+	return 0;
+}
+
+/* Forget the directories under `prefix` (including `prefix` itself) */
+static void drop_dirs(git_fsmonitor *mon, const char *prefix)
+{
+	khiter_t pos;
+	fsmonitor_dir *dir;
+
+	for (pos = git_strmap_begin(mon->dirs); pos != git_strmap_end(mon->dirs); pos++) {
+		if (!git_strmap_has_data(mon->dirs, pos))
+			continue;
+
+		dir = git_strmap_value_at(mon->dirs, pos);
+		if (git__prefixcmp(dir->path, prefix) != 0)
+			continue;
+
+		watch_forget(mon, dir);
+		git_strmap_delete_at(mon->dirs, pos);
+		dir_free(dir);
+	}
+}
+
+static int log_change(git_fsmonitor *mon, const char *path)
+{
+	fsmonitor_change *change;
+	size_t len = strlen(path);
+
+	if (mon->changes.length >= GIT_FSMONITOR_MAX_CHANGES) {
+		git_vector_free_deep(&mon->changes);
+		mon->log_start = mon->token;
+	}
+
+	change = git__malloc(sizeof(fsmonitor_change) + len + 1);
+	GITERR_CHECK_ALLOC(change);
+
+	change->token = ++mon->token;
+	memcpy(change->path, path, len + 1);
+
+	return git_vector_insert(&mon->changes, change);
+}
+
+/*
+ * Start watching a directory.  Failing to add the watch is not an error,
+ * the directory is then scanned every time.
+ */
+static int watch_dir(
+	fsmonitor_dir **out, git_fsmonitor *mon, const char *path, const char *full)
+{
+	fsmonitor_dir *dir;
+	int error = 0;
+
+	if ((dir = dir_lookup(mon, path)) == NULL) {
+		dir = git__calloc(1, sizeof(fsmonitor_dir));
+		GITERR_CHECK_ALLOC(dir);
+
+		dir->wd = -1;
+		if ((dir->path = git__strdup(path)) == NULL) {
+			git__free(dir);
+			return -1;
+		}
+
+		git_strmap_insert(mon->dirs, dir->path, dir, error);
+		if (error < 0) {
+			dir_free(dir);
+			giterr_set_oom();
+			return -1;
+		}
+	}
+
+	if (dir->wd < 0) {
+		int wd = inotify_add_watch(mon->fd, full, FSMONITOR_MASK);
+
+		if (wd >= 0) {
+			dir->wd = wd;
+			if (watch_set(mon, wd, dir) < 0)
+				return -1;
+		} else if (errno != ENOENT && errno != ENOTDIR)
+			mon->unwatched = 1;
+	}
+
+	if (out)
+		*out = dir;
+	return 0;
+}
+
+typedef struct {
+	git_fsmonitor *mon;
+	size_t root_len;
+	bool log;
+} watch_tree_data;
+
+static int watch_tree_cb(void *payload, git_buf *path)
+{
+	watch_tree_data *data = payload;
+	const char *relpath = path->ptr + data->root_len;
+	const char *name = strrchr(path->ptr, '/');
+	struct stat st;
+	int error;
+
+	name = name ? name + 1 : path->ptr;
+
+	if (!strcmp(name, DOT_GIT) ||
+		p_lstat(path->ptr, &st) < 0)
+		return 0;
+
+	if (!S_ISDIR(st.st_mode))
+		return data->log ? log_change(data->mon, relpath) : 0;
+
+	if (git_buf_putc(path, '/') < 0)
+		return -1;
+	relpath = path->ptr + data->root_len;
+
+	if ((data->log && (error = log_change(data->mon, relpath)) < 0) ||
+		(error = watch_dir(NULL, data->mon, relpath, path->ptr)) < 0)
+		return error;
+
+	error = git_path_direach(path, 0, watch_tree_cb, data);
+	if (error == GIT_ENOTFOUND) {
+		giterr_clear();
+		error = 0;
+	}
+
+	return error;
+}
+
+/* Watch `path` and everything under it, optionally logging the contents */
+static int watch_tree(git_fsmonitor *mon, const char *path, bool log)
+{
+	git_buf full = GIT_BUF_INIT;
+	watch_tree_data data;
+	int error;
+
+	data.mon = mon;
+	data.root_len = strlen(mon->workdir);
+	data.log = log;
+
+	if ((error = git_buf_joinpath(&full, mon->workdir, path)) < 0 ||
+		(error = watch_dir(NULL, mon, path, full.ptr)) < 0)
+		goto done;
+
+	error = git_path_direach(&full, 0, watch_tree_cb, &data);
+	if (error == GIT_ENOTFOUND) {
+		giterr_clear();
+		error = 0;
+	}
+
+done:
+	git_buf_free(&full);
+	return error;
+}
+
+/* Events were lost: start over from a fresh set of watches */
+static int forget_everything(git_fsmonitor *mon)
+{
+	drop_dirs(mon, "");
+	git_vector_free_deep(&mon->changes);
+	mon->log_start = mon->token;
+	mon->unwatched = 0;
+
+	return watch_tree(mon, "", false);
+}
+
+static int process_event(
+	git_fsmonitor *mon, const struct inotify_event *ev, git_buf *path)
+{
+	fsmonitor_dir *dir;
+	void **slot;
+	int error = 0;
+
+	if (ev->mask & IN_Q_OVERFLOW)
+		return forget_everything(mon);
+
+	if (ev->wd < 0 ||
+		(slot = git_array_get(mon->watches, (uint32_t)ev->wd)) == NULL ||
+		(dir = *slot) == NULL)
+		return 0;
+
+	/* the parent directory reports the removal itself */
+	if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+		if ((error = git_buf_sets(path, dir->path)) == 0)
+			drop_dirs(mon, path->ptr);
+		return error;
+	}
+
+	if (!ev->len)
+		return 0;
+
+	if (git_buf_sets(path, dir->path) < 0 ||
+		git_buf_puts(path, ev->name) < 0 ||
+		((ev->mask & IN_ISDIR) && git_buf_putc(path, '/') < 0) ||
+		log_change(mon, path->ptr) < 0)
+		return -1;
+
+	if (ev->mask & FSMONITOR_STRUCTURE) {
+		dir_unload(dir);
+
+		if (ev->mask & IN_ISDIR) {
+			drop_dirs(mon, path->ptr);
+
+			/* its contents were created before it could be watched */
+			if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+				error = watch_tree(mon, path->ptr, true);
+		}
+	} else if (dir->loaded) {
+		const char *last = git_vector_last(&dir->stale);
+		char *name;
+
+		if (last && !strcmp(last, ev->name))
+			return 0;
+
+		/* past this point reading the whole directory again is cheaper */
+		if (dir->stale.length > dir->entries.length / 4) {
+			dir_unload(dir);
+			return 0;
+		}
+
+		name = git__strdup(ev->name);
+		GITERR_CHECK_ALLOC(name);
+		error = git_vector_insert(&dir->stale, name);
+	}
+
+	return error;
+}
+
+int git_fsmonitor__refresh(git_fsmonitor *mon)
+{
+	union {
+		struct inotify_event ev;
+		char data[16 * 1024];
+	} buf;
+	git_buf path = GIT_BUF_INIT;
+	const struct inotify_event *ev;
+	ssize_t len, pos;
+	int error = 0;
+
+	if (git_mutex_lock(&mon->lock) < 0) {
+		giterr_set(GITERR_OS, "Failed to lock fsmonitor");
+		return -1;
+	}
+
+	while (!error) {
+		if ((len = read(mon->fd, buf.data, sizeof(buf.data))) < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN) {
+				giterr_set(GITERR_OS, "Failed to read inotify events");
+				error = -1;
+			}
+			break;
+		}
+
+		for (pos = 0; !error && pos < len;
+			pos += sizeof(struct inotify_event) + ev->len) {
+			ev = (const struct inotify_event *)(buf.data + pos);
+			error = process_event(mon, ev, &path);
+		}
+	}
+
+	git_mutex_unlock(&mon->lock);
+	git_buf_free(&path);
+
+	return error;
+}
+
+static int copy_entries(git_vector *out, const git_vector *entries)
+{
+	const git_path_with_stat *ps;
+	git_path_with_stat *copy;
+	size_t i, size;
+
+	git_vector_foreach(entries, i, ps) {
+		size = sizeof(git_path_with_stat) + ps->path_len + 1;
+
+		/* one spare byte, like git_path_dirload_with_stat allocates */
+		copy = git__malloc(size + 1);
+		GITERR_CHECK_ALLOC(copy);
+		memcpy(copy, ps, size);
+
+		if (git_vector_insert(out, copy) < 0) {
+			git__free(copy);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* lstat the entries that were written to; GIT_ENOTFOUND to reload */
+static int restat_entries(
+	size_t *stat_calls, fsmonitor_dir *dir, const char *full)
+{
+	git_buf path = GIT_BUF_INIT;
+	git_path_with_stat *ps = NULL;
+	size_t dirlen = strlen(dir->path), namelen, i, j;
+	const char *name, *end;
+	struct stat st;
+	int error = 0;
+
+	git_vector_foreach(&dir->stale, i, name) {
+		namelen = strlen(name);
+
+		git_vector_foreach(&dir->entries, j, ps) {
+			end = ps->path + dirlen + namelen;
+			if (ps->path_len >= dirlen + namelen &&
+				!memcmp(ps->path + dirlen, name, namelen) &&
+				(!end[0] || (end[0] == '/' && !end[1])))
+				break;
+		}
+
+		if (j == dir->entries.length) {
+			error = GIT_ENOTFOUND;
+			break;
+		}
+
+		if ((error = git_buf_joinpath(&path, full, name)) < 0)
+			break;
+
+		(*stat_calls)++;
+		if (p_lstat(path.ptr, &st) < 0 ||
+			S_ISDIR(st.st_mode) != S_ISDIR(ps->st.st_mode)) {
+			error = GIT_ENOTFOUND;
+			break;
+		}
+
+		ps->st = st;
+	}
+
+	git_vector_free_deep(&dir->stale);
+	git_buf_free(&path);
+
+	return error;
+}
+
+int git_fsmonitor__dirload(
+	size_t *stat_calls,
+	git_fsmonitor *mon,
+	const char *path,
+	size_t prefix_len,
+	uint32_t flags,
+	git_vector *contents)
+{
+	fsmonitor_dir *dir = NULL;
+	int error;
+
+	*stat_calls = 0;
+
+	if (git_mutex_lock(&mon->lock) < 0) {
+		giterr_set(GITERR_OS, "Failed to lock fsmonitor");
+		return -1;
+	}
+
+	/* the watch goes in before reading so no change is missed */
+	if ((error = watch_dir(&dir, mon, path + prefix_len, path)) < 0)
+		goto done;
+
+	if (dir->wd >= 0 && dir->loaded && dir->flags == flags) {
+		error = restat_entries(stat_calls, dir, path);
+
+		if (!error) {
+			if ((error = copy_entries(contents, &dir->entries)) == 0)
+				git_vector_sort(contents);
+			goto done;
+		}
+
+		if (error != GIT_ENOTFOUND)
+			goto done;
+	}
+
+	dir_unload(dir);
+
+	error = git_path_dirload_with_stat(
+		path, prefix_len, flags, NULL, NULL, contents);
+	*stat_calls += contents->length;
+
+	if (!error && dir->wd >= 0) {
+		if ((error = git_vector_init(&dir->entries, contents->length, NULL)) < 0 ||
+			(error = copy_entries(&dir->entries, contents)) < 0)
+			dir_unload(dir);
+		else {
+			dir->flags = flags;
+			dir->loaded = 1;
+		}
+	}
+
+done:
+	git_mutex_unlock(&mon->lock);
+	return error;
+}
+
+static void fsmonitor_free(git_fsmonitor *mon)
+{
+	if (mon->dirs) {
+		drop_dirs(mon, "");
+		git_strmap_free(mon->dirs);
+	}
+
+	if (mon->fd >= 0)
+		p_close(mon->fd);
+
+	git_array_clear(mon->watches);
+	git_vector_free_deep(&mon->changes);
+	git_mutex_free(&mon->lock);
+	git__free(mon->workdir);
+	git__free(mon);
+}
+
+int git_fsmonitor_new(git_fsmonitor **out, git_repository *repo)
+{
+	git_fsmonitor *mon;
+	int error;
+
+	assert(out && repo);
+
+	*out = NULL;
+
+	if ((error = git_repository__ensure_not_bare(
+			repo, "monitor the working directory")) < 0)
+		return error;
+
+	mon = git__calloc(1, sizeof(git_fsmonitor));
+	GITERR_CHECK_ALLOC(mon);
+
+	if (git_mutex_init(&mon->lock)) {
+		giterr_set(GITERR_OS, "Failed to initialize fsmonitor mutex");
+		git__free(mon);
+		return -1;
+	}
+
+	GIT_REFCOUNT_INC(mon);
+	mon->fd = -1;
+
+	if ((mon->workdir = git__strdup(git_repository_workdir(repo))) == NULL ||
+		git_strmap_alloc(&mon->dirs) < 0 ||
+		git_vector_init(&mon->changes, 0, NULL) < 0) {
+		error = -1;
+		goto fail;
+	}
+
+	if ((mon->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+		giterr_set(GITERR_OS, "Failed to initialize inotify");
+		error = -1;
+		goto fail;
+	}
+
+	if ((error = watch_tree(mon, "", false)) < 0)
+		goto fail;
+
+	*out = mon;
+	return 0;
+
+fail:
+	fsmonitor_free(mon);
+	return error;
+}
+
+void git_fsmonitor_free(git_fsmonitor *mon)
+{
+	if (mon == NULL)
+		return;
+
+	GIT_REFCOUNT_DEC(mon, fsmonitor_free);
+}
+
+static int change_token_cmp(const void *key, const void *item)
+{
+	uint64_t token = *(const uint64_t *)key;
+	const fsmonitor_change *change = item;
+
+	return (token < change->token) ? -1 : (token > change->token) ? 1 : 0;
+}
+
+int git_fsmonitor_changes(
+	git_strarray *out,
+	uint64_t *token,
+	git_fsmonitor *mon,
+	uint64_t since)
+{
+	git_vector paths = GIT_VECTOR_INIT;
+	const fsmonitor_change *change;
+	char *path;
+	size_t pos;
+	int error;
+
+	assert(out && token && mon);
+
+	memset(out, 0, sizeof(*out));
+
+	if ((error = git_fsmonitor__refresh(mon)) < 0)
+		return error;
+
+	if (git_mutex_lock(&mon->lock) < 0) {
+		giterr_set(GITERR_OS, "Failed to lock fsmonitor");
+		return -1;
+	}
+
+	*token = mon->token;
+
+	if (since < mon->log_start || mon->unwatched) {
+		giterr_set(GITERR_INVALID,
+			"Changes to the working directory were not all recorded");
+		error = GIT_ENOTFOUND;
+		goto done;
+	}
+
+	/* tokens increase, find the first change after `since` */
+	if (git__bsearch(mon->changes.contents, mon->changes.length,
+			&since, change_token_cmp, &pos) == 0)
+		pos++;
+
+	git_vector_set_cmp(&paths, git__strcmp_cb);
+
+	for (; pos < mon->changes.length; pos++) {
+		change = git_vector_get(&mon->changes, pos);
+
+		if ((path = git__strdup(change->path)) == NULL ||
+			(error = git_vector_insert(&paths, path)) < 0) {
+			git__free(path);
+			error = -1;
+			goto done;
+		}
+	}
+
+	git_vector_uniq(&paths, git__free);
+	out->strings = (char **)git_vector_detach(&out->count, NULL, &paths);
+
+done:
+	git_mutex_unlock(&mon->lock);
+	git_vector_free_deep(&paths);
+	return error;
+}
+
+#else
+
+int git_fsmonitor__refresh(git_fsmonitor *mon)
+{
+	GIT_UNUSED(mon);
+	return 0;
+}
+
+int git_fsmonitor__dirload(
+	size_t *stat_calls,
+	git_fsmonitor *mon,
+	const char *path,
+	size_t prefix_len,
+	uint32_t flags,
+	git_vector *contents)
+{
+	GIT_UNUSED(mon);
+
+	if (git_path_dirload_with_stat(
+			path, prefix_len, flags, NULL, NULL, contents) < 0)
+		return -1;
+
+	*stat_calls = contents->length;
+	return 0;
+}
+
+int git_fsmonitor_new(git_fsmonitor **out, git_repository *repo)
+{
+	GIT_UNUSED(repo);
+
+	*out = NULL;
+	giterr_set(GITERR_INVALID,
+		"Monitoring the working directory is not supported on this platform");
+	return -1;
+}
+
+void git_fsmonitor_free(git_fsmonitor *mon)
+{
+	GIT_UNUSED(mon);
+}
+
+int git_fsmonitor_changes(
+	git_strarray *out,
+	uint64_t *token,
+	git_fsmonitor *mon,
+	uint64_t since)
+{
+	GIT_UNUSED(out);
+	GIT_UNUSED(token);
+	GIT_UNUSED(mon);
+	GIT_UNUSED(since);
+
+	giterr_set(GITERR_INVALID,
+		"Monitoring the working directory is not supported on this platform");
+	return -1;
+}
+
+#endif
+
+int git_repository_set_fsmonitor(git_repository *repo, git_fsmonitor *mon)
+{
+	assert(repo);
+
+	if (mon) {
+		if (!repo->workdir || strcmp(repo->workdir, mon->workdir) != 0) {
+			giterr_set(GITERR_INVALID,
+				"The monitor watches another working directory");
+			return -1;
+		}
+
+		GIT_REFCOUNT_INC(mon);
+	}
+
+	if ((mon = git__swap(repo->_fsmonitor, mon)) != NULL)
+		git_fsmonitor_free(mon);
+
+	return 0;
+}
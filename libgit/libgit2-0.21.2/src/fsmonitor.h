@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_fsmonitor_h__
+#define INCLUDE_fsmonitor_h__
+
+#include "common.h"
+#include "git2/fsmonitor.h"
+#include "array.h"
+#include "strmap.h"
+#include "vector.h"
+
+/*
+ * Working directory monitor
+ *
+ * An inotify watch is kept on each directory of the workdir.  Pending
+ * events are read whenever a workdir iterator is created; they feed a
+ * bounded log of changed paths (for git_fsmonitor_changes) and
+ * invalidate a cache of directory listings with their stat data, so an
+ * iterator only reads the directories that had entries added or
+ * removed and lstats the files that were written to.  Listings of
+ * untracked directories are cached the same way.
+ *
+ * When the kernel event queue overflows, every cached listing is
+ * dropped and the next scan reads the whole workdir again.
+ */
+
+/* Past this many changes the oldest ones are forgotten */
+#define GIT_FSMONITOR_MAX_CHANGES 65536
+
+struct git_fsmonitor {
+	git_refcount rc;
+	git_mutex lock;
+	int fd;
+	char *workdir;
+	git_strmap *dirs; /* workdir relative path -> fsmonitor_dir */
+	git_array_t(void *) watches; /* watch descriptor -> fsmonitor_dir */
+	git_vector changes; /* fsmonitor_change, oldest first */
+	uint64_t token;
+	uint64_t log_start; /* changes up to this token were forgotten */
+	unsigned int unwatched :1;
+};
+
+/* Read the pending events */
+extern int git_fsmonitor__refresh(git_fsmonitor *mon);
+
+/*
+ * Drop-in replacement for git_path_dirload_with_stat (without the
+ * start/end range, every entry gets its stat data) that serves the
+ * listing from the cache when it is still valid.  `stat_calls` is set
+ * to the number of entries actually stat'ed.
+ */
+extern int git_fsmonitor__dirload(
+	size_t *stat_calls,
+	git_fsmonitor *mon,
+	const char *path,
+	size_t prefix_len,
+	uint32_t flags,
+	git_vector *contents);
+
+#endif
@@ -13,6 +13,7 @@
 
 
 git_mutex git__mwindow_mutex;
+git_mutex git__pack_cache_mutex;
 
 #define MAX_SHUTDOWN_CB 8
 
@@ -164,7 +165,8 @@ static int synchronized_threads_init(void)
 	int error;
 
 	_tls_index = TlsAlloc();
-	if (git_mutex_init(&git__mwindow_mutex))
+	if (git_mutex_init(&git__mwindow_mutex) ||
+		git_mutex_init(&git__pack_cache_mutex))
 		return -1;
 
 	/* Initialize any other subsystems that have global state */
@@ -199,6 +201,7 @@ static void synchronized_threads_shutdown(void)
 	git__shutdown();
 	TlsFree(_tls_index);
 	git_mutex_free(&git__mwindow_mutex);
+	git_mutex_free(&git__pack_cache_mutex);
 }
 
 void git_threads_shutdown(void)
@@ -248,7 +251,8 @@ static void cb__free_status(void *st)
 
 static void init_once(void)
 {
-	if ((init_error = git_mutex_init(&git__mwindow_mutex)) != 0)
+	if ((init_error = git_mutex_init(&git__mwindow_mutex)) != 0 ||
+		(init_error = git_mutex_init(&git__pack_cache_mutex)) != 0)
 		return;
 	pthread_key_create(&_tls_key, &cb__free_status);
 
@@ -286,6 +290,7 @@ void git_threads_shutdown(void)
 
 	pthread_key_delete(_tls_key);
 	git_mutex_free(&git__mwindow_mutex);
+	git_mutex_free(&git__pack_cache_mutex);
 	_once_init = new_once;
 }
 
@@ -314,12 +319,18 @@ static git_global_st __state;
 int git_threads_init(void)
 {
 	static int ssl_inited = 0;
+	int error;
 
 	if (!ssl_inited) {
 		init_ssl();
 		ssl_inited = 1;
 	}
 
+	/* Initialize any other subsystems that have global state */
+	if (git_atomic_get(&git__n_inits) == 0 &&
+		(error = git_hash_global_init()) < 0)
+		return error;
+
 	git_atomic_inc(&git__n_inits);
 	return 0;
 }
@@ -23,6 +23,7 @@ extern SSL_CTX *git__ssl_ctx;
 git_global_st *git__global_state(void);
 
 extern git_mutex git__mwindow_mutex;
+extern git_mutex git__pack_cache_mutex;
 
 #define GIT_GLOBAL (git__global_state())
 
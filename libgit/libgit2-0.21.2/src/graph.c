@@ -41,7 +41,7 @@ static int mark_parents(git_revwalk *walk, git_commit_list_node *one,
 		return 0;
 	}
 
-	if (git_pqueue_init(&list, 0, 2, git_commit_list_time_cmp) < 0)
+	if (git_pqueue_init(&list, 0, 2, git_commit_list_generation_cmp) < 0)
 		return -1;
 
 	if (git_commit_list_parse(walk, one) < 0)
@@ -112,7 +112,7 @@ static int ahead_behind(git_commit_list_node *one, git_commit_list_node *two,
 	*ahead = 0;
 	*behind = 0;
 
-	if (git_pqueue_init(&pq, 0, 2, git_commit_list_time_cmp) < 0)
+	if (git_pqueue_init(&pq, 0, 2, git_commit_list_generation_cmp) < 0)
 		return -1;
 
 	if ((error = git_pqueue_insert(&pq, one)) < 0 ||
@@ -172,6 +172,36 @@ on_error:
 	return -1;
 }
 
+/*
+ * A commit's generation is higher than that of all its ancestors, so
+ * when both are in the commit-graph the answer may be known without
+ * walking anything.
+ */
+static int generation_excludes(
+	git_repository *repo, const git_oid *commit, const git_oid *ancestor)
+{
+	git_revwalk *walk;
+	git_commit_list_node *one, *two;
+	int excluded = 0;
+
+	if (git_revwalk_new(&walk, repo) < 0)
+		return -1;
+
+	if (walk->graph != NULL) {
+		if ((one = git_revwalk__commit_lookup(walk, commit)) == NULL ||
+			(two = git_revwalk__commit_lookup(walk, ancestor)) == NULL ||
+			git_commit_list_parse(walk, one) < 0 ||
+			git_commit_list_parse(walk, two) < 0)
+			excluded = -1;
+		else if (one->generation != GIT_COMMIT_GRAPH_GENERATION_INFINITY &&
+			one->generation <= two->generation)
+			excluded = 1;
+	}
+
+	git_revwalk_free(walk);
+	return excluded;
+}
+
 int git_graph_descendant_of(git_repository *repo, const git_oid *commit, const git_oid *ancestor)
 {
 	git_oid merge_base;
@@ -180,6 +210,9 @@ int git_graph_descendant_of(git_repository *repo, const git_oid *commit, const g
 	if (git_oid_equal(commit, ancestor))
 		return 0;
 
+	if ((error = generation_excludes(repo, commit, ancestor)) != 0)
+		return error < 0 ? error : 0;
+
 	error = git_merge_base(&merge_base, repo, commit, ancestor);
 	/* No merge-base found, it's not a descendant */
 	if (error == GIT_ENOTFOUND)
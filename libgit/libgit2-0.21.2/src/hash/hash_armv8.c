@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "common.h"
+#include "hash.h"
+#include "hash/hash_generic.h"
+
+/*
+ * The crypto extensions are optional in ARMv8, so this file is built
+ * with them enabled (see CMakeLists.txt) and only used once the kernel
+ * says the CPU has them.
+ */
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+
+#include <arm_neon.h>
+
+#if defined(__linux__)
+# include <sys/auxv.h>
+# include <asm/hwcap.h>
+#endif
+
+static void hash__armv8(unsigned int H[5], const unsigned char *data, size_t blocks)
+{
+	const uint32x4_t K0 = vdupq_n_u32(0x5a827999);
+	const uint32x4_t K1 = vdupq_n_u32(0x6ed9eba1);
+	const uint32x4_t K2 = vdupq_n_u32(0x8f1bbcdc);
+	const uint32x4_t K3 = vdupq_n_u32(0xca62c1d6);
+	uint32x4_t ABCD, ABCD_SAVE;
+	uint32x4_t TMP0, TMP1;
+	uint32x4_t MSG0, MSG1, MSG2, MSG3;
+	uint32_t E0, E0_SAVE, E1;
+
+	ABCD = vld1q_u32(H);
+	E0 = H[4];
+
+	while (blocks--) {
+		ABCD_SAVE = ABCD;
+		E0_SAVE = E0;
+
+		MSG0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 0)));
+		MSG1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+		MSG2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+		MSG3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+		TMP0 = vaddq_u32(MSG0, K0);
+		TMP1 = vaddq_u32(MSG1, K0);
+
+		/* Rounds 0-3 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1cq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG2, K0);
+		MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+
+		/* Rounds 4-7 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1cq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG3, K0);
+		MSG0 = vsha1su1q_u32(MSG0, MSG3);
+		MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+
+		/* Rounds 8-11 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1cq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG0, K0);
+		MSG1 = vsha1su1q_u32(MSG1, MSG0);
+		MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+
+		/* Rounds 12-15 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1cq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG1, K1);
+		MSG2 = vsha1su1q_u32(MSG2, MSG1);
+		MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+
+		/* Rounds 16-19 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1cq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG2, K1);
+		MSG3 = vsha1su1q_u32(MSG3, MSG2);
+		MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+
+		/* Rounds 20-23 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG3, K1);
+		MSG0 = vsha1su1q_u32(MSG0, MSG3);
+		MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+
+		/* Rounds 24-27 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG0, K1);
+		MSG1 = vsha1su1q_u32(MSG1, MSG0);
+		MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+
+		/* Rounds 28-31 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG1, K1);
+		MSG2 = vsha1su1q_u32(MSG2, MSG1);
+		MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+
+		/* Rounds 32-35 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG2, K2);
+		MSG3 = vsha1su1q_u32(MSG3, MSG2);
+		MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+
+		/* Rounds 36-39 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG3, K2);
+		MSG0 = vsha1su1q_u32(MSG0, MSG3);
+		MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+
+		/* Rounds 40-43 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1mq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG0, K2);
+		MSG1 = vsha1su1q_u32(MSG1, MSG0);
+		MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+
+		/* Rounds 44-47 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1mq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG1, K2);
+		MSG2 = vsha1su1q_u32(MSG2, MSG1);
+		MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+
+		/* Rounds 48-51 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1mq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG2, K2);
+		MSG3 = vsha1su1q_u32(MSG3, MSG2);
+		MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+
+		/* Rounds 52-55 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1mq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG3, K3);
+		MSG0 = vsha1su1q_u32(MSG0, MSG3);
+		MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+
+		/* Rounds 56-59 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1mq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG0, K3);
+		MSG1 = vsha1su1q_u32(MSG1, MSG0);
+		MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+
+		/* Rounds 60-63 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG1, K3);
+		MSG2 = vsha1su1q_u32(MSG2, MSG1);
+		MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+
+		/* Rounds 64-67 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+		TMP0 = vaddq_u32(MSG2, K3);
+		MSG3 = vsha1su1q_u32(MSG3, MSG2);
+
+		/* Rounds 68-71 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+		TMP1 = vaddq_u32(MSG3, K3);
+
+		/* Rounds 72-75 */
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+
+		/* Rounds 76-79 */
+		E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+
+		E0 += E0_SAVE;
+		ABCD = vaddq_u32(ABCD_SAVE, ABCD);
+
+		data += 64;
+	}
+
+	vst1q_u32(H, ABCD);
+	H[4] = E0;
+}
+
+git_hash_block_fn git_hash_armv8__sha1(void)
+{
+#if defined(__linux__)
+	if (getauxval(AT_HWCAP) & HWCAP_SHA1)
+		return hash__armv8;
+	return NULL;
+#elif defined(__APPLE__)
+	/* every 64-bit Apple CPU has them */
+	return hash__armv8;
+#else
+	return NULL;
+#endif
+}
+
+#else
+
+git_hash_block_fn git_hash_armv8__sha1(void)
+{
+	return NULL;
+}
+
+#endif
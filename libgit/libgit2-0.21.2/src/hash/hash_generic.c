@@ -113,16 +113,16 @@
 #define T_40_59(t, A, B, C, D, E) SHA_ROUND(t, SHA_MIX, ((B&C)+(D&(B^C))) , 0x8f1bbcdc, A, B, C, D, E )
 #define T_60_79(t, A, B, C, D, E) SHA_ROUND(t, SHA_MIX, (B^C^D) , 0xca62c1d6, A, B, C, D, E )
 
-static void hash__block(git_hash_ctx *ctx, const unsigned int *data)
+static void hash__block(unsigned int *H, const unsigned int *data)
 {
 	unsigned int A,B,C,D,E;
 	unsigned int array[16];
 
-	A = ctx->H[0];
-	B = ctx->H[1];
-	C = ctx->H[2];
-	D = ctx->H[3];
-	E = ctx->H[4];
+	A = H[0];
+	B = H[1];
+	C = H[2];
+	D = H[3];
+	E = H[4];
 
 	/* Round 1 - iterations 0-16 take their input from 'data' */
 	T_0_15( 0, A, B, C, D, E);
@@ -214,11 +214,84 @@ static void hash__block(git_hash_ctx *ctx, const unsigned int *data)
 	T_60_79(78, C, D, E, A, B);
 	T_60_79(79, B, C, D, E, A);
 
-	ctx->H[0] += A;
-	ctx->H[1] += B;
-	ctx->H[2] += C;
-	ctx->H[3] += D;
-	ctx->H[4] += E;
+	H[0] += A;
+	H[1] += B;
+	H[2] += C;
+	H[3] += D;
+	H[4] += E;
+}
+
+static void hash__blocks(unsigned int H[5], const unsigned char *data, size_t blocks)
+{
+	while (blocks--) {
+		hash__block(H, (const unsigned int *)data);
+		data += 64;
+	}
+}
+
+static const char *hash__impl_names[GIT_HASH_IMPL__COUNT] = {
+	"generic", "ssse3", "sha-ni", "armv8-ce"
+};
+
+static git_hash_block_fn hash__impls[GIT_HASH_IMPL__COUNT];
+static git_hash_impl hash__current = GIT_HASH_IMPL_GENERIC;
+static git_hash_block_fn hash__blocks_fn = hash__blocks;
+
+static void hash__detect(void)
+{
+	if (hash__impls[GIT_HASH_IMPL_GENERIC])
+		return;
+
+	hash__impls[GIT_HASH_IMPL_SSSE3] = git_hash_x86__ssse3();
+	hash__impls[GIT_HASH_IMPL_SHANI] = git_hash_x86__shani();
+	hash__impls[GIT_HASH_IMPL_ARMV8] = git_hash_armv8__sha1();
+	hash__impls[GIT_HASH_IMPL_GENERIC] = hash__blocks;
+}
+
+int git_hash_global_init(void)
+{
+	int impl;
+
+	hash__detect();
+
+	/* the dedicated instructions beat anything else */
+	for (impl = GIT_HASH_IMPL__COUNT - 1; impl > GIT_HASH_IMPL_GENERIC; impl--)
+		if (hash__impls[impl] != NULL)
+			break;
+
+	return git_hash_impl_set((git_hash_impl)impl);
+}
+
+int git_hash_impl_supported(git_hash_impl impl)
+{
+	if ((int)impl < 0 || impl >= GIT_HASH_IMPL__COUNT)
+		return 0;
+
+	hash__detect();
+	return hash__impls[impl] != NULL;
+}
+
+int git_hash_impl_set(git_hash_impl impl)
+{
+	if (!git_hash_impl_supported(impl))
+		return -1;
+
+	hash__current = impl;
+	hash__blocks_fn = hash__impls[impl];
+	return 0;
+}
+
+git_hash_impl git_hash_impl_get(void)
+{
+	return hash__current;
+}
+
+const char *git_hash_impl_name(git_hash_impl impl)
+{
+	if ((int)impl < 0 || impl >= GIT_HASH_IMPL__COUNT)
+		return NULL;
+
+	return hash__impl_names[impl];
 }
 
 int git_hash_init(git_hash_ctx *ctx)
@@ -252,12 +325,12 @@ int git_hash_update(git_hash_ctx *ctx, const void *data, size_t len)
 		data = ((const char *)data + left);
 		if (lenW)
 			return 0;
-		hash__block(ctx, ctx->W);
+		hash__blocks_fn(ctx->H, (const unsigned char *)ctx->W, 1);
 	}
-	while (len >= 64) {
-		hash__block(ctx, data);
-		data = ((const char *)data + 64);
-		len -= 64;
+	if (len >= 64) {
+		hash__blocks_fn(ctx->H, data, len / 64);
+		data = ((const char *)data + (len & ~(size_t)63));
+		len &= 63;
 	}
 	if (len)
 		memcpy(ctx->W, data, len);
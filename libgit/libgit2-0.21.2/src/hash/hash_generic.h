@@ -16,8 +16,34 @@ struct git_hash_ctx {
 	unsigned int W[16];
 };
 
-#define git_hash_global_init() 0
 #define git_hash_ctx_init(ctx) git_hash_init(ctx)
 #define git_hash_ctx_cleanup(ctx)
 
+/*
+ * Compression functions run `blocks` consecutive 64-byte blocks through
+ * the state `H`. The portable one is always there; the accelerated ones
+ * are picked at runtime by git_hash_global_init() depending on the CPU.
+ */
+typedef void (*git_hash_block_fn)(unsigned int H[5], const unsigned char *data, size_t blocks);
+
+typedef enum {
+	GIT_HASH_IMPL_GENERIC = 0,
+	GIT_HASH_IMPL_SSSE3,
+	GIT_HASH_IMPL_SHANI,
+	GIT_HASH_IMPL_ARMV8,
+	GIT_HASH_IMPL__COUNT
+} git_hash_impl;
+
+/* Whether `impl` was built in and the CPU supports it */
+int git_hash_impl_supported(git_hash_impl impl);
+/* Force an implementation, mostly for testing; returns -1 if unsupported */
+int git_hash_impl_set(git_hash_impl impl);
+git_hash_impl git_hash_impl_get(void);
+const char *git_hash_impl_name(git_hash_impl impl);
+
+/* Return NULL when not built for this architecture or not supported by the CPU */
+git_hash_block_fn git_hash_x86__shani(void);
+git_hash_block_fn git_hash_x86__ssse3(void);
+git_hash_block_fn git_hash_armv8__sha1(void);
+
 #endif /* INCLUDE_hash_generic_h__ */
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "common.h"
+#include "hash.h"
+#include "hash/hash_generic.h"
+
+#if (defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))) || \
+	(defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+
+#ifdef _MSC_VER
+# include <intrin.h>
+# include <immintrin.h>
+# define HASH_TARGET(x)
+#else
+# include <cpuid.h>
+# include <immintrin.h>
+# define HASH_TARGET(x) __attribute__((target(x)))
+#endif
+
+static void hash__cpuid(int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	__cpuidex((int *)regs, leaf, 0);
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	if ((unsigned int)leaf <= __get_cpuid_max(0, NULL))
+		__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+#define CPUID1_ECX_SSSE3 (1u << 9)
+#define CPUID1_ECX_SSE41 (1u << 19)
+#define CPUID7_EBX_SHA (1u << 29)
+
+/*
+ * SHA extensions: the whole compression function is done by
+ * sha1rnds4/sha1nexte/sha1msg1/sha1msg2, four rounds at a time.
+ */
+HASH_TARGET("sha,sse4.1,ssse3")
+static void hash__shani(unsigned int H[5], const unsigned char *data, size_t blocks)
+{
+	const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+	__m128i MSG0, MSG1, MSG2, MSG3;
+
+	ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)H), 0x1B);
+	E0 = _mm_set_epi32((int)H[4], 0, 0, 0);
+
+	while (blocks--) {
+		ABCD_SAVE = ABCD;
+		E0_SAVE = E0;
+
+		/* Rounds 0-3 */
+		MSG0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), MASK);
+		E0 = _mm_add_epi32(E0, MSG0);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+		/* Rounds 4-7 */
+		MSG1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), MASK);
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+		/* Rounds 8-11 */
+		MSG2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), MASK);
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 12-15 */
+		MSG3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), MASK);
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 16-19 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 20-23 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 24-27 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 28-31 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 32-35 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 36-39 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 40-43 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 44-47 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 48-51 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 52-55 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 56-59 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 60-63 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 64-67 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 68-71 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 72-75 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+		/* Rounds 76-79 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+		E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+		ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+
+		data += 64;
+	}
+
+	_mm_storeu_si128((__m128i *)H, _mm_shuffle_epi32(ABCD, 0x1B));
+	H[4] = (unsigned int)_mm_extract_epi32(E0, 3);
+}
+
+/*
+ * SSSE3: the message schedule is expanded four words at a time in
+ * vector registers, with the round constants already added, while the
+ * rounds themselves stay scalar; each group of four words is computed
+ * sixteen rounds ahead so the two overlap. W[t+3] depends on W[t],
+ * which is in the same vector, so that lane is fixed up after the
+ * rotate.
+ */
+#define HASH_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define HASH_F1(B, C, D) (((C ^ D) & B) ^ D)
+#define HASH_F2(B, C, D) (B ^ C ^ D)
+#define HASH_F3(B, C, D) ((B & C) + (D & (B ^ C)))
+
+#define HASH_ROUND(t, F, A, B, C, D, E) do { \
+	E += wk[t] + HASH_ROL(A, 5) + F(B, C, D); \
+	B = HASH_ROL(B, 30); } while (0)
+
+#define HASH_VROL1(x) _mm_or_si128(_mm_slli_epi32(x, 1), _mm_srli_epi32(x, 31))
+
+/* W[t-16] ^ W[t-14] ^ W[t-8] ^ W[t-3], with W[t] missing from the last lane */
+#define HASH_SCHEDULE(i) do { \
+	__m128i tmp = _mm_xor_si128(W[(i) & 3], _mm_alignr_epi8(W[((i) + 1) & 3], W[(i) & 3], 8)); \
+	tmp = _mm_xor_si128(tmp, W[((i) + 2) & 3]); \
+	tmp = _mm_xor_si128(tmp, _mm_srli_si128(W[((i) + 3) & 3], 4)); \
+	tmp = HASH_VROL1(tmp); \
+	W[(i) & 3] = _mm_xor_si128(tmp, HASH_VROL1(_mm_slli_si128(tmp, 12))); \
+	_mm_storeu_si128((__m128i *)&wk[4 * (i)], _mm_add_epi32(W[(i) & 3], K[(i) / 5])); \
+} while (0)
+
+HASH_TARGET("ssse3")
+static void hash__ssse3(unsigned int H[5], const unsigned char *data, size_t blocks)
+{
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	const __m128i K[4] = {
+		_mm_set1_epi32(0x5a827999), _mm_set1_epi32(0x6ed9eba1),
+		_mm_set1_epi32((int)0x8f1bbcdc), _mm_set1_epi32((int)0xca62c1d6)
+	};
+	__m128i W[4];
+	unsigned int wk[80];
+	unsigned int A, B, C, D, E;
+	int i;
+
+	while (blocks--) {
+		for (i = 0; i < 4; i++) {
+			W[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), MASK);
+			_mm_storeu_si128((__m128i *)&wk[4 * i], _mm_add_epi32(W[i], K[0]));
+		}
+
+		A = H[0];
+		B = H[1];
+		C = H[2];
+		D = H[3];
+		E = H[4];
+
+		HASH_ROUND( 0, HASH_F1, A, B, C, D, E);
+		HASH_ROUND( 1, HASH_F1, E, A, B, C, D);
+		HASH_ROUND( 2, HASH_F1, D, E, A, B, C);
+		HASH_ROUND( 3, HASH_F1, C, D, E, A, B);
+		HASH_SCHEDULE(4);
+		HASH_ROUND( 4, HASH_F1, B, C, D, E, A);
+		HASH_ROUND( 5, HASH_F1, A, B, C, D, E);
+		HASH_ROUND( 6, HASH_F1, E, A, B, C, D);
+		HASH_ROUND( 7, HASH_F1, D, E, A, B, C);
+		HASH_SCHEDULE(5);
+		HASH_ROUND( 8, HASH_F1, C, D, E, A, B);
+		HASH_ROUND( 9, HASH_F1, B, C, D, E, A);
+		HASH_ROUND(10, HASH_F1, A, B, C, D, E);
+		HASH_ROUND(11, HASH_F1, E, A, B, C, D);
+		HASH_SCHEDULE(6);
+		HASH_ROUND(12, HASH_F1, D, E, A, B, C);
+		HASH_ROUND(13, HASH_F1, C, D, E, A, B);
+		HASH_ROUND(14, HASH_F1, B, C, D, E, A);
+		HASH_ROUND(15, HASH_F1, A, B, C, D, E);
+		HASH_SCHEDULE(7);
+		HASH_ROUND(16, HASH_F1, E, A, B, C, D);
+		HASH_ROUND(17, HASH_F1, D, E, A, B, C);
+		HASH_ROUND(18, HASH_F1, C, D, E, A, B);
+		HASH_ROUND(19, HASH_F1, B, C, D, E, A);
+		HASH_SCHEDULE(8);
+		HASH_ROUND(20, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(21, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(22, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(23, HASH_F2, C, D, E, A, B);
+		HASH_SCHEDULE(9);
+		HASH_ROUND(24, HASH_F2, B, C, D, E, A);
+		HASH_ROUND(25, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(26, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(27, HASH_F2, D, E, A, B, C);
+		HASH_SCHEDULE(10);
+		HASH_ROUND(28, HASH_F2, C, D, E, A, B);
+		HASH_ROUND(29, HASH_F2, B, C, D, E, A);
+		HASH_ROUND(30, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(31, HASH_F2, E, A, B, C, D);
+		HASH_SCHEDULE(11);
+		HASH_ROUND(32, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(33, HASH_F2, C, D, E, A, B);
+		HASH_ROUND(34, HASH_F2, B, C, D, E, A);
+		HASH_ROUND(35, HASH_F2, A, B, C, D, E);
+		HASH_SCHEDULE(12);
+		HASH_ROUND(36, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(37, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(38, HASH_F2, C, D, E, A, B);
+		HASH_ROUND(39, HASH_F2, B, C, D, E, A);
+		HASH_SCHEDULE(13);
+		HASH_ROUND(40, HASH_F3, A, B, C, D, E);
+		HASH_ROUND(41, HASH_F3, E, A, B, C, D);
+		HASH_ROUND(42, HASH_F3, D, E, A, B, C);
+		HASH_ROUND(43, HASH_F3, C, D, E, A, B);
+		HASH_SCHEDULE(14);
+		HASH_ROUND(44, HASH_F3, B, C, D, E, A);
+		HASH_ROUND(45, HASH_F3, A, B, C, D, E);
+		HASH_ROUND(46, HASH_F3, E, A, B, C, D);
+		HASH_ROUND(47, HASH_F3, D, E, A, B, C);
+		HASH_SCHEDULE(15);
+		HASH_ROUND(48, HASH_F3, C, D, E, A, B);
+		HASH_ROUND(49, HASH_F3, B, C, D, E, A);
+		HASH_ROUND(50, HASH_F3, A, B, C, D, E);
+		HASH_ROUND(51, HASH_F3, E, A, B, C, D);
+		HASH_SCHEDULE(16);
+		HASH_ROUND(52, HASH_F3, D, E, A, B, C);
+		HASH_ROUND(53, HASH_F3, C, D, E, A, B);
+		HASH_ROUND(54, HASH_F3, B, C, D, E, A);
+		HASH_ROUND(55, HASH_F3, A, B, C, D, E);
+		HASH_SCHEDULE(17);
+		HASH_ROUND(56, HASH_F3, E, A, B, C, D);
+		HASH_ROUND(57, HASH_F3, D, E, A, B, C);
+		HASH_ROUND(58, HASH_F3, C, D, E, A, B);
+		HASH_ROUND(59, HASH_F3, B, C, D, E, A);
+		HASH_SCHEDULE(18);
+		HASH_ROUND(60, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(61, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(62, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(63, HASH_F2, C, D, E, A, B);
+		HASH_SCHEDULE(19);
+		HASH_ROUND(64, HASH_F2, B, C, D, E, A);
+		HASH_ROUND(65, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(66, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(67, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(68, HASH_F2, C, D, E, A, B);
+		HASH_ROUND(69, HASH_F2, B, C, D, E, A);
+		HASH_ROUND(70, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(71, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(72, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(73, HASH_F2, C, D, E, A, B);
+		HASH_ROUND(74, HASH_F2, B, C, D, E, A);
+		HASH_ROUND(75, HASH_F2, A, B, C, D, E);
+		HASH_ROUND(76, HASH_F2, E, A, B, C, D);
+		HASH_ROUND(77, HASH_F2, D, E, A, B, C);
+		HASH_ROUND(78, HASH_F2, C, D, E, A, B);
+		HASH_ROUND(79, HASH_F2, B, C, D, E, A);
+
+		H[0] += A;
+		H[1] += B;
+		H[2] += C;
+		H[3] += D;
+		H[4] += E;
+
+		data += 64;
+	}
+}
+
+git_hash_block_fn git_hash_x86__shani(void)
+{
+	unsigned int leaf1[4], leaf7[4];
+
+	hash__cpuid(1, leaf1);
+	hash__cpuid(7, leaf7);
+
+	if ((leaf1[2] & CPUID1_ECX_SSSE3) && (leaf1[2] & CPUID1_ECX_SSE41) &&
+		(leaf7[1] & CPUID7_EBX_SHA))
+		return hash__shani;
+
+	return NULL;
+}
+
+git_hash_block_fn git_hash_x86__ssse3(void)
+{
+	unsigned int leaf1[4];
+
+	hash__cpuid(1, leaf1);
+
+	if (leaf1[2] & CPUID1_ECX_SSSE3)
+		return hash__ssse3;
+
+	return NULL;
+}
+
+#else
+
+git_hash_block_fn git_hash_x86__shani(void)
+{
+	return NULL;
+}
+
+git_hash_block_fn git_hash_x86__ssse3(void)
+{
+	return NULL;
+}
+
+#endif
@@ -17,6 +17,8 @@
 #include "pathspec.h"
 #include "ignore.h"
 #include "blob.h"
+#include "thread-utils.h"
+#include "varint.h"
 
 #include "git2/odb.h"
 #include "git2/oid.h"
@@ -35,6 +37,7 @@ static const size_t INDEX_HEADER_SIZE = 12;
 
 static const unsigned int INDEX_VERSION_NUMBER = 2;
 static const unsigned int INDEX_VERSION_NUMBER_EXT = 3;
+static const unsigned int INDEX_VERSION_NUMBER_COMP = 4;
 
 static const unsigned int INDEX_HEADER_SIG = 0x44495243;
 static const char INDEX_EXT_TREECACHE_SIG[] = {'T', 'R', 'E', 'E'};
@@ -43,6 +46,9 @@ static const char INDEX_EXT_CONFLICT_NAME_SIG[] = {'N', 'A', 'M', 'E'};
 
 #define INDEX_OWNER(idx) ((git_repository *)(GIT_REFCOUNT_OWNER(idx)))
 
+/* below this many entries, parsing them is not worth a thread */
+#define INDEX_THREADED_MIN_ENTRIES 10000
+
 struct index_header {
 	uint32_t signature;
 	uint32_t version;
@@ -425,6 +431,7 @@ int git_index_open(git_index **index_out, const char *index_path)
 	index->entries_search = git_index_entry_srch;
 	index->entries_search_path = index_entry_srch_path;
 	index->reuc_search = reuc_srch;
+	index->version = INDEX_VERSION_NUMBER;
 
 	if (index_path != NULL && (error = git_index_read(index, true)) < 0)
 		goto fail;
@@ -1037,7 +1044,8 @@ static int index_insert(
 	if (error < 0) {
 		index_entry_free(*entry_ptr);
 		*entry_ptr = NULL;
-	}
+	} else
+		git_tree_cache_invalidate_path(index->tree, entry->path);
 
 	git_mutex_unlock(&index->lock);
 
@@ -1085,7 +1093,6 @@ int git_index_add_bypath(git_index *index, const char *path)
 	if ((ret = index_conflict_to_reuc(index, path)) < 0 && ret != GIT_ENOTFOUND)
 		return ret;
 
-	git_tree_cache_invalidate_path(index->tree, entry->path);
 	return 0;
 }
 
@@ -1129,7 +1136,6 @@ int git_index_add(git_index *index, const git_index_entry *source_entry)
 		(ret = index_insert(index, &entry, 1)) < 0)
 		return ret;
 
-	git_tree_cache_invalidate_path(index->tree, entry->path);
 	return 0;
 }
 
@@ -1763,10 +1769,104 @@ static int read_conflict_names(git_index *index, const char *buffer, size_t size
 	return 0;
 }
 
+/*
+ * Find the path of the on-disk entry at `buffer`, whose flags are
+ * `flags`, and return the size of the entry. Version 4 paths are stored
+ * relative to the previous entry's, which `path` holds; it is updated
+ * to the new path.
+ */
+static size_t read_entry_path(
+	const char **out,
+	unsigned int version,
+	uint16_t flags,
+	const char *buffer,
+	size_t buffer_size,
+	git_buf *path)
+{
+	const char *path_ptr, *path_end, *buffer_end = buffer + buffer_size;
+	size_t path_length, entry_size;
+
+	if (flags & GIT_IDXENTRY_EXTENDED)
+		path_ptr = buffer + offsetof(struct entry_long, path);
+	else
+		path_ptr = buffer + offsetof(struct entry_short, path);
+
+	if (path_ptr >= buffer_end)
+		return 0;
+
+	if (version < INDEX_VERSION_NUMBER_COMP) {
+		path_length = flags & GIT_IDXENTRY_NAMEMASK;
+
+		/* if this is a very long string, we must find its
+		 * real length without overflowing */
+		if (path_length == 0xFFF) {
+			path_end = memchr(path_ptr, '\0', buffer_end - path_ptr);
+			if (path_end == NULL)
+				return 0;
+
+			path_length = path_end - path_ptr;
+		}
+
+		if (flags & GIT_IDXENTRY_EXTENDED)
+			entry_size = long_entry_size(path_length);
+		else
+			entry_size = short_entry_size(path_length);
+
+		*out = path_ptr;
+	} else {
+		size_t strip_length, varint_length;
+
+		/* the number of bytes to drop from the previous path... */
+		strip_length = git_decode_varint(&varint_length,
+			(const unsigned char *)path_ptr, buffer_end - path_ptr);
+		if (!varint_length || strip_length > path->size)
+			return 0;
+
+		/* ...followed by what to append to it, and no padding */
+		path_ptr += varint_length;
+		path_end = memchr(path_ptr, '\0', buffer_end - path_ptr);
+		if (path_end == NULL)
+			return 0;
+
+		git_buf_truncate(path, path->size - strip_length);
+		if (git_buf_put(path, path_ptr, path_end - path_ptr) < 0)
+			return 0;
+
+		entry_size = (path_end + 1) - buffer;
+		*out = path->ptr;
+	}
+
+	if (INDEX_FOOTER_SIZE + entry_size > buffer_size)
+		return 0;
+
+	return entry_size;
+}
+
+/* The size of the on-disk entry at `buffer`, without reading it in */
+static size_t entry_disk_size(
+	unsigned int version, const char *buffer, size_t buffer_size, git_buf *path)
+{
+	const char *path_ptr;
+	uint16_t flags;
+
+	if (INDEX_FOOTER_SIZE + minimal_entry_size > buffer_size)
+		return 0;
+
+	/* buffer is not guaranteed to be aligned */
+	memcpy(&flags, buffer + offsetof(struct entry_short, flags), sizeof(flags));
+
+	return read_entry_path(
+		&path_ptr, version, ntohs(flags), buffer, buffer_size, path);
+}
+
 static size_t read_entry(
-	git_index_entry **out, const void *buffer, size_t buffer_size)
+	git_index_entry **out,
+	unsigned int version,
+	const char *buffer,
+	size_t buffer_size,
+	git_buf *path)
 {
-	size_t path_length, entry_size;
+	size_t entry_size;
 	const char *path_ptr;
 	struct entry_short source;
 	git_index_entry entry = {{0}};
@@ -1795,35 +1895,15 @@ static size_t read_entry(
 		size_t flags_offset;
 
 		flags_offset = offsetof(struct entry_long, flags_extended);
-		memcpy(&flags_raw, (const char *) buffer + flags_offset,
-			sizeof(flags_raw));
+		memcpy(&flags_raw, buffer + flags_offset, sizeof(flags_raw));
 		flags_raw = ntohs(flags_raw);
 
 		memcpy(&entry.flags_extended, &flags_raw, sizeof(flags_raw));
-		path_ptr = (const char *) buffer + offsetof(struct entry_long, path);
-	} else
-		path_ptr = (const char *) buffer + offsetof(struct entry_short, path);
-
-	path_length = entry.flags & GIT_IDXENTRY_NAMEMASK;
-
-	/* if this is a very long string, we must find its
-	 * real length without overflowing */
-	if (path_length == 0xFFF) {
-		const char *path_end;
-
-		path_end = memchr(path_ptr, '\0', buffer_size);
-		if (path_end == NULL)
-			return 0;
-
-		path_length = path_end - path_ptr;
 	}
 
-	if (entry.flags & GIT_IDXENTRY_EXTENDED)
-		entry_size = long_entry_size(path_length);
-	else
-		entry_size = short_entry_size(path_length);
-
-	if (INDEX_FOOTER_SIZE + entry_size > buffer_size)
+	entry_size = read_entry_path(
+		&path_ptr, version, entry.flags, buffer, buffer_size, path);
+	if (!entry_size)
 		return 0;
 
 	entry.path = (char *)path_ptr;
@@ -1834,6 +1914,177 @@ static size_t read_entry(
 	return entry_size;
 }
 
+/* A run of consecutive entries, which a thread reads in */
+struct entry_chunk {
+	unsigned int version;
+	const char *buffer;
+	size_t buffer_size;
+	size_t count;
+	git_index_entry **entries;
+	git_buf path; /* the path of the entry before the first */
+	size_t read; /* bytes read */
+	int error;
+};
+
+static void *read_entry_chunk(void *payload)
+{
+	struct entry_chunk *chunk = payload;
+	size_t i, entry_size;
+
+	for (i = 0; i < chunk->count; i++) {
+		entry_size = read_entry(&chunk->entries[i], chunk->version,
+			chunk->buffer + chunk->read, chunk->buffer_size - chunk->read,
+			&chunk->path);
+
+		/* 0 bytes read means an object corruption */
+		if (entry_size == 0) {
+			chunk->error = -1;
+			break;
+		}
+
+		chunk->read += entry_size;
+	}
+
+	return NULL;
+}
+
+/*
+ * Read the `count` entries at the start of `buffer` into the index,
+ * returning the number of bytes they take up. Large indexes are split
+ * into one run of entries per CPU, the runs found by a quick pass over
+ * the entries' lengths, and read in by as many threads.
+ */
+static int read_entries(
+	size_t *out,
+	git_index *index,
+	unsigned int version,
+	size_t count,
+	const char *buffer,
+	size_t buffer_size)
+{
+	git_index_entry **entries = NULL;
+	struct entry_chunk *chunks = NULL;
+	git_buf path = GIT_BUF_INIT;
+	size_t nr_chunks = 1, per_chunk, i, offset = 0, entry_size, spawned = 0;
+	int error = 0;
+
+#ifdef GIT_THREADS
+	git_thread *threads = NULL;
+
+	if (count >= INDEX_THREADED_MIN_ENTRIES)
+		nr_chunks = (size_t)git_online_cpus();
+#endif
+
+	if (nr_chunks < 1)
+		nr_chunks = 1;
+
+	per_chunk = (count + nr_chunks - 1) / nr_chunks;
+	if (per_chunk == 0)
+		per_chunk = 1;
+	nr_chunks = max(1, (count + per_chunk - 1) / per_chunk);
+
+	entries = git__calloc(max(1, count), sizeof(git_index_entry *));
+	chunks = git__calloc(nr_chunks, sizeof(struct entry_chunk));
+	if (!entries || !chunks) {
+		error = -1;
+		goto done;
+	}
+
+	for (i = 0; i < nr_chunks; i++) {
+		chunks[i].version = version;
+		chunks[i].entries = entries + i * per_chunk;
+		chunks[i].count = min(per_chunk, count - i * per_chunk);
+		git_buf_init(&chunks[i].path, 0);
+	}
+
+	chunks[0].buffer = buffer;
+	chunks[0].buffer_size = buffer_size;
+
+	/* find where each run starts, and the path before it */
+	for (i = 0; nr_chunks > 1 && i < count; i++) {
+		if (i % per_chunk == 0 && i > 0) {
+			struct entry_chunk *chunk = &chunks[i / per_chunk];
+
+			chunk->buffer = buffer + offset;
+			chunk->buffer_size = buffer_size - offset;
+
+			if (git_buf_set(&chunk->path, path.ptr, path.size) < 0) {
+				error = -1;
+				goto done;
+			}
+		}
+
+		entry_size = entry_disk_size(
+			version, buffer + offset, buffer_size - offset, &path);
+		if (entry_size == 0) {
+			error = index_error_invalid("invalid entry");
+			goto done;
+		}
+
+		offset += entry_size;
+	}
+
+#ifdef GIT_THREADS
+	if (nr_chunks > 1) {
+		threads = git__calloc(nr_chunks - 1, sizeof(git_thread));
+		if (!threads) {
+			error = -1;
+			goto done;
+		}
+
+		for (spawned = 0; spawned < nr_chunks - 1; spawned++) {
+			if (git_thread_create(&threads[spawned], NULL,
+					read_entry_chunk, &chunks[spawned + 1]) != 0)
+				break;
+		}
+	}
+#endif
+
+	/* the calling thread reads the first run, and any left without a thread */
+	read_entry_chunk(&chunks[0]);
+	for (i = spawned + 1; i < nr_chunks; i++)
+		read_entry_chunk(&chunks[i]);
+
+#ifdef GIT_THREADS
+	for (i = 0; i < spawned; i++)
+		git_thread_join(&threads[i], NULL);
+#endif
+
+	for (i = 0; i < nr_chunks; i++) {
+		if (chunks[i].error < 0) {
+			error = index_error_invalid("invalid entry");
+			goto done;
+		}
+	}
+
+	if (nr_chunks == 1)
+		offset = chunks[0].read;
+
+	for (i = 0; i < count; i++) {
+		if ((error = git_vector_insert(&index->entries, entries[i])) < 0)
+			goto done;
+		entries[i] = NULL;
+	}
+
+	*out = offset;
+
+done:
+	for (i = 0; entries && i < count; i++) {
+		if (entries[i])
+			index_entry_free(entries[i]);
+	}
+	for (i = 0; chunks && i < nr_chunks; i++)
+		git_buf_free(&chunks[i].path);
+
+#ifdef GIT_THREADS
+	git__free(threads);
+#endif
+	git__free(chunks);
+	git__free(entries);
+	git_buf_free(&path);
+	return error;
+}
+
 static int read_header(struct index_header *dest, const void *buffer)
 {
 	const struct index_header *source = buffer;
@@ -1843,7 +2094,8 @@ static int read_header(struct index_header *dest, const void *buffer)
 		return index_error_invalid("incorrect header signature");
 
 	dest->version = ntohl(source->version);
-	if (dest->version != INDEX_VERSION_NUMBER_EXT &&
+	if (dest->version != INDEX_VERSION_NUMBER_COMP &&
+		dest->version != INDEX_VERSION_NUMBER_EXT &&
 		dest->version != INDEX_VERSION_NUMBER)
 		return index_error_invalid("incorrect header version");
 
@@ -1894,7 +2146,7 @@ static size_t read_extension(git_index *index, const char *buffer, size_t buffer
 static int parse_index(git_index *index, const char *buffer, size_t buffer_size)
 {
 	int error = 0;
-	unsigned int i;
+	size_t entries_size;
 	struct index_header header = { 0 };
 	git_oid checksum_calculated, checksum_expected;
 
@@ -1926,29 +2178,14 @@ static int parse_index(git_index *index, const char *buffer, size_t buffer_size)
 
 	assert(!index->entries.length);
 
-	/* Parse all the entries */
-	for (i = 0; i < header.entry_count && buffer_size > INDEX_FOOTER_SIZE; ++i) {
-		git_index_entry *entry;
-		size_t entry_size = read_entry(&entry, buffer, buffer_size);
-
-		/* 0 bytes read means an object corruption */
-		if (entry_size == 0) {
-			error = index_error_invalid("invalid entry");
-			goto done;
-		}
-
-		if ((error = git_vector_insert(&index->entries, entry)) < 0) {
-			index_entry_free(entry);
-			goto done;
-		}
-
-		seek_forward(entry_size);
-	}
+	index->version = header.version;
 
-	if (i != header.entry_count) {
-		error = index_error_invalid("header entries changed while parsing");
+	/* Parse all the entries */
+	if ((error = read_entries(&entries_size, index,
+			header.version, header.entry_count, buffer, buffer_size)) < 0)
 		goto done;
-	}
+
+	seek_forward(entries_size);
 
 	/* There's still space for some extensions! */
 	while (buffer_size > INDEX_FOOTER_SIZE) {
@@ -2011,16 +2248,38 @@ static bool is_index_extended(git_index *index)
 	return (extended > 0);
 }
 
-static int write_disk_entry(git_filebuf *file, git_index_entry *entry)
+/*
+ * Write `entry` out; with path compression, its path is written relative
+ * to `last`, the path of the entry before it, or NULL for the first.
+ */
+static int write_disk_entry(
+	git_filebuf *file, git_index_entry *entry, const char *last)
 {
 	void *mem = NULL;
 	struct entry_short *ondisk;
-	size_t path_len, disk_size;
+	size_t path_len, disk_size, same_len = 0;
+	unsigned char varint[16];
+	int varint_len = 0;
 	char *path;
 
 	path_len = ((struct entry_internal *)entry)->pathlen;
 
-	if (entry->flags & GIT_IDXENTRY_EXTENDED)
+	if (last) {
+		/* the number of bytes to drop from the end of the last path,
+		 * followed by the rest of this one, unpadded */
+		while (last[same_len] && last[same_len] == entry->path[same_len])
+			same_len++;
+
+		varint_len = git_encode_varint(
+			varint, sizeof(varint), strlen(last + same_len));
+
+		if (entry->flags & GIT_IDXENTRY_EXTENDED)
+			disk_size = offsetof(struct entry_long, path);
+		else
+			disk_size = offsetof(struct entry_short, path);
+
+		disk_size += varint_len + (path_len - same_len) + 1;
+	} else if (entry->flags & GIT_IDXENTRY_EXTENDED)
 		disk_size = long_entry_size(path_len);
 	else
 		disk_size = short_entry_size(path_len);
@@ -2066,17 +2325,22 @@ static int write_disk_entry(git_filebuf *file, git_index_entry *entry)
 	else
 		path = ondisk->path;
 
-	memcpy(path, entry->path, path_len);
+	if (last) {
+		memcpy(path, varint, varint_len);
+		memcpy(path + varint_len, entry->path + same_len, path_len - same_len);
+	} else
+		memcpy(path, entry->path, path_len);
 
 	return 0;
 }
 
-static int write_entries(git_index *index, git_filebuf *file)
+static int write_entries(git_index *index, git_filebuf *file, unsigned int version)
 {
 	int error = 0;
 	size_t i;
 	git_vector case_sorted, *entries;
 	git_index_entry *entry;
+	const char *last = NULL;
 
 	if (git_mutex_lock(&index->lock) < 0) {
 		giterr_set(GITERR_OS, "Failed to lock index");
@@ -2093,9 +2357,16 @@ static int write_entries(git_index *index, git_filebuf *file)
 		entries = &index->entries;
 	}
 
-	git_vector_foreach(entries, i, entry)
-		if ((error = write_disk_entry(file, entry)) < 0)
+	/* the first entry's path is compressed against the empty path */
+	if (version >= INDEX_VERSION_NUMBER_COMP)
+		last = "";
+
+	git_vector_foreach(entries, i, entry) {
+		if ((error = write_disk_entry(file, entry, last)) < 0)
 			break;
+		if (last)
+			last = entry->path;
+	}
 
 	git_mutex_unlock(&index->lock);
 
@@ -2120,6 +2391,25 @@ static int write_extension(git_filebuf *file, struct index_extension *header, gi
 	return error;
 }
 
+static int write_tree_extension(git_index *index, git_filebuf *file)
+{
+	struct index_extension extension;
+	git_buf buf = GIT_BUF_INIT;
+	int error;
+
+	if ((error = git_tree_cache_write(&buf, index->tree)) < 0)
+		return error;
+
+	memset(&extension, 0x0, sizeof(struct index_extension));
+	memcpy(&extension.signature, INDEX_EXT_TREECACHE_SIG, 4);
+	extension.extension_size = (uint32_t)buf.size;
+
+	error = write_extension(file, &extension, &buf);
+
+	git_buf_free(&buf);
+	return error;
+}
+
 static int create_name_extension_data(git_buf *name_buf, git_index_name_entry *conflict_name)
 {
 	int error = 0;
@@ -2233,7 +2523,13 @@ static int write_index(git_index *index, git_filebuf *file)
 	assert(index && file);
 
 	is_extended = is_index_extended(index);
-	index_version_number = is_extended ? INDEX_VERSION_NUMBER_EXT : INDEX_VERSION_NUMBER;
+
+	/* path compression is kept once chosen; otherwise use the oldest
+	 * format which can hold the entries */
+	if (index->version >= INDEX_VERSION_NUMBER_COMP)
+		index_version_number = INDEX_VERSION_NUMBER_COMP;
+	else
+		index_version_number = is_extended ? INDEX_VERSION_NUMBER_EXT : INDEX_VERSION_NUMBER;
 
 	header.signature = htonl(INDEX_HEADER_SIG);
 	header.version = htonl(index_version_number);
@@ -2242,10 +2538,12 @@ static int write_index(git_index *index, git_filebuf *file)
 	if (git_filebuf_write(file, &header, sizeof(struct index_header)) < 0)
 		return -1;
 
-	if (write_entries(index, file) < 0)
+	if (write_entries(index, file, index_version_number) < 0)
 		return -1;
 
-	/* TODO: write tree cache extension */
+	/* write the tree cache extension */
+	if (index->tree != NULL && write_tree_extension(index, file) < 0)
+		return -1;
 
 	/* write the rename conflict extension */
 	if (index->names.length > 0 && write_name_extension(index, file) < 0)
@@ -2262,6 +2560,25 @@ static int write_index(git_index *index, git_filebuf *file)
 	return git_filebuf_write(file, hash_final.id, GIT_OID_RAWSZ);
 }
 
+unsigned int git_index_version(git_index *index)
+{
+	assert(index);
+	return index->version;
+}
+
+int git_index_set_version(git_index *index, unsigned int version)
+{
+	assert(index);
+
+	if (version < INDEX_VERSION_NUMBER || version > INDEX_VERSION_NUMBER_COMP) {
+		giterr_set(GITERR_INDEX, "Invalid index version %u", version);
+		return -1;
+	}
+
+	index->version = version;
+	return 0;
+}
+
 int git_index_entry_stage(const git_index_entry *entry)
 {
 	return GIT_IDXENTRY_STAGE(entry);
@@ -2302,7 +2619,7 @@ static int read_tree_cb(
 		git_oid_equal(&entry->id, &old_entry->id))
 	{
 		index_entry_cpy(entry, old_entry);
-		entry->flags_extended = 0;
+		entry->flags_extended &= GIT_IDXENTRY_SKIP_WORKTREE;
 	}
 
 	if (path.size < GIT_IDXENTRY_NAMEMASK)
@@ -2351,6 +2668,10 @@ int git_index_read_tree(git_index *index, const git_tree *tree)
 		}
 	}
 
+	/* the index now holds exactly this tree's contents */
+	if (!error)
+		error = git_tree_cache_read_tree(&index->tree, tree);
+
 	git_vector_free(&entries);
 
 	return error;
@@ -2371,7 +2692,7 @@ int git_index_add_all(
 	int error;
 	git_repository *repo;
 	git_iterator *wditer = NULL;
-	const git_index_entry *wd = NULL;
+	const git_index_entry *wd = NULL, *ie;
 	git_index_entry *entry;
 	git_pathspec ps;
 	const char *match;
@@ -2421,6 +2742,11 @@ int git_index_add_all(
 			index_find(&existing, index, wd->path, 0, 0, true) < 0)
 			continue;
 
+		/* leave entries outside of the sparse checkout alone */
+		if ((ie = git_index_get_bypath(index, wd->path, 0)) != NULL &&
+			(ie->flags_extended & GIT_IDXENTRY_SKIP_WORKTREE) != 0)
+			continue;
+
 		/* issue notification callback if requested */
 		if (cb && (error = cb(wd->path, match, payload)) != 0) {
 			if (error > 0) /* return > 0 means skip this one */
@@ -2449,8 +2775,6 @@ int git_index_add_all(
 		if ((error = index_insert(index, &entry, 1)) < 0)
 			break;
 
-		git_tree_cache_invalidate_path(index->tree, wd->path);
-
 		/* add implies conflict resolved, move conflict entries to REUC */
 		if ((error = index_conflict_to_reuc(index, wd->path)) < 0) {
 			if (error != GIT_ENOTFOUND)
@@ -2504,6 +2828,11 @@ static int index_apply_to_all(
 				&match, NULL))
 			continue;
 
+		/* files outside of the sparse checkout are not in the workdir */
+		if (action == INDEX_ACTION_UPDATE &&
+			(entry->flags_extended & GIT_IDXENTRY_SKIP_WORKTREE) != 0)
+			continue;
+
 		/* issue notification callback if requested */
 		if (cb && (error = cb(entry->path, match, payload)) != 0) {
 			if (error > 0) { /* return > 0 means skip this one */
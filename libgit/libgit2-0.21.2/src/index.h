@@ -36,6 +36,8 @@ struct git_index {
 
 	git_tree_cache *tree;
 
+	unsigned int version; /* on-disk format version, 2 to 4 */
+
 	git_vector names;
 	git_vector reuc;
 
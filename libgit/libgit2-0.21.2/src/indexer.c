@@ -17,15 +17,12 @@
 #include "oid.h"
 #include "oidmap.h"
 #include "zstream.h"
+#include "delta-apply.h"
+#include "thread-utils.h"
+#include "indexer.h"
 
-#define UINT31_MAX (0x7FFFFFFF)
-
-struct entry {
-	git_oid oid;
-	uint32_t crc;
-	uint32_t offset;
-	uint64_t offset_long;
-};
+/* Below this many deltas spawning threads costs more than it saves */
+#define GIT_INDEXER_THREADED_MIN_DELTAS 64
 
 struct git_indexer {
 	unsigned int parsed_header :1,
@@ -41,11 +38,11 @@ struct git_indexer {
 	size_t nr_objects;
 	git_vector objects;
 	git_vector deltas;
-	unsigned int fanout[256];
 	git_hash_ctx hash_ctx;
 	git_oid hash;
 	git_transfer_progress_cb progress_cb;
 	void *progress_payload;
+	unsigned int nr_threads;
 	char objbuf[8*1024];
 
 	/* Needed to look up objects which we want to inject to fix a thin pack */
@@ -91,10 +88,10 @@ static int parse_header(struct git_pack_header *hdr, struct git_pack_file *pack)
 	return 0;
 }
 
-static int objects_cmp(const void *a, const void *b)
+int git_indexer__entry_cmp(const void *a, const void *b)
 {
-	const struct entry *entrya = a;
-	const struct entry *entryb = b;
+	const struct git_indexer_entry *entrya = a;
+	const struct git_indexer_entry *entryb = b;
 
 	return git_oid__cmp(&entrya->oid, &entryb->oid);
 }
@@ -152,6 +149,20 @@ cleanup:
 	return -1;
 }
 
+unsigned int git_indexer_set_threads(git_indexer *idx, unsigned int n)
+{
+	assert(idx);
+
+#ifdef GIT_THREADS
+	idx->nr_threads = n;
+#else
+	GIT_UNUSED(n);
+	idx->nr_threads = 1;
+#endif
+
+	return idx->nr_threads;
+}
+
 /* Try to store the delta so we can try to resolve it later */
 static int store_delta(git_indexer *idx)
 {
@@ -257,10 +268,10 @@ static int crc_object(uint32_t *crc_out, git_mwindow_file *mwf, git_off_t start,
 
 static int store_object(git_indexer *idx)
 {
-	int i, error;
+	int error;
 	khiter_t k;
 	git_oid oid;
-	struct entry *entry;
+	struct git_indexer_entry *entry;
 	git_off_t entry_size;
 	struct git_pack_entry *pentry;
 	git_hash_ctx *ctx = &idx->hash_ctx;
@@ -301,10 +312,6 @@ static int store_object(git_indexer *idx)
 	if (git_vector_insert(&idx->objects, entry) < 0)
 		goto on_error;
 
-	for (i = oid.id[0]; i < 256; ++i) {
-		idx->fanout[i]++;
-	}
-
 	return 0;
 
 on_error:
@@ -313,9 +320,9 @@ on_error:
 	return -1;
 }
 
-static int save_entry(git_indexer *idx, struct entry *entry, struct git_pack_entry *pentry, git_off_t entry_start)
+static int save_entry(git_indexer *idx, struct git_indexer_entry *entry, struct git_pack_entry *pentry, git_off_t entry_start)
 {
-	int i, error;
+	int error;
 	khiter_t k;
 
 	if (entry_start > UINT31_MAX) {
@@ -336,10 +343,6 @@ static int save_entry(git_indexer *idx, struct entry *entry, struct git_pack_ent
 	if (git_vector_insert(&idx->objects, entry) < 0)
 		return -1;
 
-	for (i = entry->oid.id[0]; i < 256; ++i) {
-		idx->fanout[i]++;
-	}
-
 	return 0;
 }
 
@@ -347,7 +350,7 @@ static int hash_and_save(git_indexer *idx, git_rawobj *obj, git_off_t entry_star
 {
 	git_oid oid;
 	size_t entry_size;
-	struct entry *entry;
+	struct git_indexer_entry *entry;
 	struct git_pack_entry *pentry = NULL;
 
 	entry = git__calloc(1, sizeof(*entry));
@@ -503,7 +506,7 @@ int git_indexer_append(git_indexer *idx, const void *data, size_t size, git_tran
 		GITERR_CHECK_ALLOC(idx->pack->idx_cache);
 
 		idx->pack->has_cache = 1;
-		if (git_vector_init(&idx->objects, total_objects, objects_cmp) < 0)
+		if (git_vector_init(&idx->objects, total_objects, git_indexer__entry_cmp) < 0)
 			return -1;
 
 		if (git_vector_init(&idx->deltas, total_objects / 2, NULL) < 0)
@@ -647,7 +650,7 @@ static void seek_back_trailer(git_indexer *idx)
 static int inject_object(git_indexer *idx, git_oid *id)
 {
 	git_odb_object *obj;
-	struct entry *entry;
+	struct git_indexer_entry *entry;
 	struct git_pack_entry *pentry = NULL;
 	git_oid foo = {{0}};
 	unsigned char hdr[64];
@@ -776,12 +779,348 @@ static int fix_thin_pack(git_indexer *idx, git_transfer_progress *stats)
 	return 0;
 }
 
+#ifdef GIT_THREADS
+
+/*
+ * Threaded delta resolution
+ *
+ * Every delta whose base is known when the pack is committed belongs
+ * to a tree rooted at an object which can already be read from the
+ * pack. Those trees don't depend on each other, so they are handed
+ * out to a pool of threads which unpack the root once (through the
+ * pack's shared, bounded base cache) and then walk it depth-first,
+ * applying each delta to its parent's data and hashing the result.
+ * Only the oid and CRC of each delta are kept; they are saved on the
+ * calling thread afterwards, so the objects, fanout and idx_cache
+ * are never written concurrently.
+ *
+ * A REF delta can only be placed once its base has a name, so this
+ * runs in rounds until nothing more resolves. Whatever is left
+ * (thin packs, corrupt data) goes through the serial loop, which
+ * also reports the errors.
+ */
+
+struct delta_link {
+	git_off_t base_off;
+	size_t pos;
+};
+
+struct delta_result {
+	git_oid oid;
+	uint32_t crc;
+	unsigned int resolved :1;
+};
+
+struct resolve_ctx {
+	git_indexer *idx;
+	git_off_t *pending;
+	size_t npending;
+	struct delta_link *links;
+	size_t nlinks;
+	git_off_t *roots;
+	size_t nroots;
+	struct delta_result *results;
+	git_atomic next_root;
+};
+
+static int link_cmp(const void *a, const void *b)
+{
+	const struct delta_link *la = a, *lb = b;
+
+	if (la->base_off != lb->base_off)
+		return la->base_off < lb->base_off ? -1 : 1;
+	if (la->pos != lb->pos)
+		return la->pos < lb->pos ? -1 : 1;
+	return 0;
+}
+
+static int is_pending_delta(struct resolve_ctx *ctx, git_off_t off)
+{
+	size_t lo = 0, hi = ctx->npending;
+
+	/* deltas are stored in the order they appear in the pack */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ctx->pending[mid] == off)
+			return 1;
+		if (ctx->pending[mid] < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return 0;
+}
+
+/* Find where the base of a delta lives without touching the pack index */
+static git_off_t find_delta_base(git_indexer *idx, struct delta_info *delta)
+{
+	git_mwindow *w = NULL;
+	git_off_t curpos = delta->delta_off, base_off = 0;
+	unsigned char *base_info;
+	unsigned int left = 0;
+	git_otype type;
+	size_t size;
+
+	if (git_packfile_unpack_header(&size, &type, &idx->pack->mwf, &w, &curpos) < 0) {
+		git_mwindow_close(&w);
+		return 0;
+	}
+
+	if (type == GIT_OBJ_OFS_DELTA) {
+		base_off = get_delta_base(idx->pack, &w, &curpos, type, delta->delta_off);
+	} else if (type == GIT_OBJ_REF_DELTA) {
+		git_oid base;
+		khiter_t k;
+
+		base_info = git_mwindow_open(&idx->pack->mwf, &w, curpos, GIT_OID_RAWSZ, &left);
+		if (base_info != NULL) {
+			git_oid_fromraw(&base, base_info);
+			k = kh_get(oid, idx->pack->idx_cache, &base);
+			if (k != kh_end(idx->pack->idx_cache))
+				base_off = ((struct git_pack_entry *)kh_value(idx->pack->idx_cache, k))->offset;
+		}
+	}
+
+	git_mwindow_close(&w);
+	return base_off > 0 ? base_off : 0;
+}
+
+static int resolve_one(
+	git_rawobj *out, struct resolve_ctx *ctx, const git_rawobj *base, size_t pos)
+{
+	git_indexer *idx = ctx->idx;
+	struct delta_info *delta = git_vector_get(&idx->deltas, pos);
+	struct delta_result *result = &ctx->results[pos];
+	git_mwindow *w = NULL;
+	git_off_t curpos = delta->delta_off;
+	git_rawobj diff;
+	git_otype type;
+	size_t size;
+	int error;
+
+	error = git_packfile_unpack_header(&size, &type, &idx->pack->mwf, &w, &curpos);
+	if (!error && get_delta_base(idx->pack, &w, &curpos, type, delta->delta_off) <= 0)
+		error = -1;
+	git_mwindow_close(&w);
+
+	if (error < 0 ||
+		(error = packfile_unpack_compressed(&diff, idx->pack, &w, &curpos, size, type)) < 0)
+		return error;
+
+	error = git__delta_apply(out, base->data, base->len, diff.data, diff.len);
+	git__free(diff.data);
+	if (error < 0)
+		return error;
+
+	out->type = base->type;
+	if ((error = git_odb__hashobj(&result->oid, out)) < 0 ||
+		(error = crc_object(&result->crc, &idx->pack->mwf,
+			delta->delta_off, curpos - delta->delta_off)) < 0) {
+		git__free(out->data);
+		return error;
+	}
+
+	result->resolved = 1;
+	return 0;
+}
+
+static void resolve_children(
+	struct resolve_ctx *ctx, const git_rawobj *base, git_off_t base_off)
+{
+	size_t lo = 0, hi = ctx->nlinks;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (ctx->links[mid].base_off < base_off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < ctx->nlinks && ctx->links[lo].base_off == base_off; lo++) {
+		size_t pos = ctx->links[lo].pos;
+		struct delta_info *delta = git_vector_get(&ctx->idx->deltas, pos);
+		git_rawobj obj;
+
+		if (resolve_one(&obj, ctx, base, pos) < 0) {
+			giterr_clear();
+			continue;
+		}
+
+		resolve_children(ctx, &obj, delta->delta_off);
+		git__free(obj.data);
+	}
+}
+
+static void *resolve_thread(void *arg)
+{
+	struct resolve_ctx *ctx = arg;
+	size_t i;
+
+	while ((i = (size_t)git_atomic_inc(&ctx->next_root) - 1) < ctx->nroots) {
+		git_off_t off = ctx->roots[i];
+		git_rawobj base;
+
+		if (git_packfile_unpack(&base, ctx->idx->pack, &off) < 0) {
+			giterr_clear();
+			continue;
+		}
+
+		resolve_children(ctx, &base, ctx->roots[i]);
+		git__free(base.data);
+	}
+
+	return NULL;
+}
+
+static int resolve_round(
+	size_t *saved, git_indexer *idx, struct resolve_ctx *ctx,
+	git_thread *threads, unsigned int nr_threads, git_transfer_progress *stats)
+{
+	struct delta_info *delta;
+	unsigned int i, spawned;
+	int error;
+
+	ctx->npending = ctx->nlinks = ctx->nroots = 0;
+	git_atomic_set(&ctx->next_root, 0);
+	memset(ctx->results, 0, idx->deltas.length * sizeof(struct delta_result));
+
+	git_vector_foreach(&idx->deltas, i, delta) {
+		if (delta)
+			ctx->pending[ctx->npending++] = delta->delta_off;
+	}
+
+	git_vector_foreach(&idx->deltas, i, delta) {
+		git_off_t base_off;
+
+		if (!delta || !(base_off = find_delta_base(idx, delta)))
+			continue;
+
+		ctx->links[ctx->nlinks].base_off = base_off;
+		ctx->links[ctx->nlinks].pos = i;
+		ctx->nlinks++;
+	}
+
+	/* group the deltas by base; the roots are the bases we can already read */
+	qsort(ctx->links, ctx->nlinks, sizeof(struct delta_link), link_cmp);
+	for (i = 0; i < ctx->nlinks; i++) {
+		git_off_t base_off = ctx->links[i].base_off;
+
+		if (i > 0 && ctx->links[i - 1].base_off == base_off)
+			continue;
+		if (!is_pending_delta(ctx, base_off))
+			ctx->roots[ctx->nroots++] = base_off;
+	}
+
+	for (spawned = 0; spawned < nr_threads - 1 && spawned < ctx->nroots; spawned++) {
+		if (git_thread_create(&threads[spawned], NULL, resolve_thread, ctx) != 0)
+			break;
+	}
+
+	/* the calling thread takes its share of the trees as well */
+	resolve_thread(ctx);
+
+	for (i = 0; i < spawned; i++)
+		git_thread_join(&threads[i], NULL);
+
+	*saved = 0;
+	git_vector_foreach(&idx->deltas, i, delta) {
+		struct delta_result *result = &ctx->results[i];
+		struct git_indexer_entry *entry;
+		struct git_pack_entry *pentry;
+
+		if (!delta || !result->resolved)
+			continue;
+
+		entry = git__calloc(1, sizeof(*entry));
+		GITERR_CHECK_ALLOC(entry);
+
+		pentry = git__calloc(1, sizeof(struct git_pack_entry));
+		if (!pentry) {
+			git__free(entry);
+			return -1;
+		}
+
+		git_oid_cpy(&entry->oid, &result->oid);
+		git_oid_cpy(&pentry->sha1, &result->oid);
+		entry->crc = result->crc;
+
+		if (save_entry(idx, entry, pentry, delta->delta_off) < 0) {
+			git__free(entry);
+			git__free(pentry);
+			continue;
+		}
+
+		stats->indexed_objects++;
+		stats->indexed_deltas++;
+		(*saved)++;
+		if ((error = do_progress_callback(idx, stats)) < 0)
+			return error;
+
+		/* remove from the list */
+		git_vector_set(NULL, &idx->deltas, i, NULL);
+		git__free(delta);
+	}
+
+	return 0;
+}
+
+static int resolve_deltas_threaded(git_indexer *idx, git_transfer_progress *stats)
+{
+	struct resolve_ctx ctx;
+	git_thread *threads = NULL;
+	unsigned int nr_threads = idx->nr_threads;
+	size_t count = idx->deltas.length, saved;
+	int error = 0;
+
+	if (!nr_threads)
+		nr_threads = git_online_cpus();
+
+	if (nr_threads <= 1 || count < GIT_INDEXER_THREADED_MIN_DELTAS)
+		return 0;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.idx = idx;
+	ctx.pending = git__calloc(count, sizeof(git_off_t));
+	ctx.links = git__calloc(count, sizeof(struct delta_link));
+	ctx.roots = git__calloc(count, sizeof(git_off_t));
+	ctx.results = git__calloc(count, sizeof(struct delta_result));
+	threads = git__calloc(nr_threads - 1, sizeof(git_thread));
+	if (!ctx.pending || !ctx.links || !ctx.roots || !ctx.results || !threads) {
+		error = -1;
+		goto cleanup;
+	}
+
+	do {
+		if ((error = resolve_round(&saved, idx, &ctx, threads, nr_threads, stats)) < 0)
+			break;
+		count -= saved;
+	} while (saved > 0 && count > 0);
+
+cleanup:
+	git__free(threads);
+	git__free(ctx.results);
+	git__free(ctx.roots);
+	git__free(ctx.links);
+	git__free(ctx.pending);
+	return error;
+}
+
+#endif
+
 static int resolve_deltas(git_indexer *idx, git_transfer_progress *stats)
 {
 	unsigned int i;
 	struct delta_info *delta;
 	int progressed = 0, non_null = 0, progress_cb_result;
 
+#ifdef GIT_THREADS
+	if ((progress_cb_result = resolve_deltas_threaded(idx, stats)) < 0)
+		return progress_cb_result;
+#endif
+
 	while (idx->deltas.length > 0) {
 		progressed = 0;
 		non_null = 0;
@@ -867,22 +1206,102 @@ static int update_header_and_rehash(git_indexer *idx, git_transfer_progress *sta
 	return 0;
 }
 
+int git_indexer__write_index(
+	git_filebuf *file,
+	git_oid *name,
+	git_vector *entries,
+	const git_oid *pack_trailer)
+{
+	struct git_pack_idx_header hdr;
+	struct git_indexer_entry *entry;
+	unsigned int i, long_offsets = 0;
+	uint32_t fanout[256] = {0};
+	git_oid idx_hash;
+	git_hash_ctx ctx;
+
+	assert(git_vector_is_sorted(entries));
+
+	if (git_hash_ctx_init(&ctx) < 0)
+		return -1;
+
+	/* Write out the header */
+	hdr.idx_signature = htonl(PACK_IDX_SIGNATURE);
+	hdr.idx_version = htonl(2);
+	git_filebuf_write(file, &hdr, sizeof(hdr));
+
+	/* Write out the fanout table */
+	git_vector_foreach(entries, i, entry)
+		fanout[entry->oid.id[0]]++;
+
+	for (i = 0; i < 256; ++i) {
+		uint32_t n;
+
+		if (i > 0)
+			fanout[i] += fanout[i - 1];
+
+		n = htonl(fanout[i]);
+		git_filebuf_write(file, &n, sizeof(n));
+	}
+
+	/* Write out the object names (SHA-1 hashes) */
+	git_vector_foreach(entries, i, entry) {
+		git_filebuf_write(file, &entry->oid, sizeof(git_oid));
+		git_hash_update(&ctx, &entry->oid, GIT_OID_RAWSZ);
+	}
+	git_hash_final(name, &ctx);
+	git_hash_ctx_cleanup(&ctx);
+
+	/* Write out the CRC32 values */
+	git_vector_foreach(entries, i, entry) {
+		git_filebuf_write(file, &entry->crc, sizeof(uint32_t));
+	}
+
+	/* Write out the offsets */
+	git_vector_foreach(entries, i, entry) {
+		uint32_t n;
+
+		if (entry->offset == UINT32_MAX)
+			n = htonl(0x80000000 | long_offsets++);
+		else
+			n = htonl(entry->offset);
+
+		git_filebuf_write(file, &n, sizeof(uint32_t));
+	}
+
+	/* Write out the long offsets */
+	git_vector_foreach(entries, i, entry) {
+		uint32_t split[2];
+
+		if (entry->offset != UINT32_MAX)
+			continue;
+
+		split[0] = htonl(entry->offset_long >> 32);
+		split[1] = htonl(entry->offset_long & 0xffffffff);
+
+		git_filebuf_write(file, &split, sizeof(uint32_t) * 2);
+	}
+
+	/* Write out the packfile trailer to the index */
+	if (git_filebuf_write(file, pack_trailer, GIT_OID_RAWSZ) < 0)
+		return -1;
+
+	/* Write out the hash of the idx */
+	if (git_filebuf_hash(&idx_hash, file) < 0)
+		return -1;
+
+	return git_filebuf_write(file, &idx_hash, sizeof(git_oid));
+}
+
 int git_indexer_commit(git_indexer *idx, git_transfer_progress *stats)
 {
 	git_mwindow *w = NULL;
-	unsigned int i, long_offsets = 0, left;
+	unsigned int left;
 	int error;
-	struct git_pack_idx_header hdr;
 	git_buf filename = GIT_BUF_INIT;
-	struct entry *entry;
 	git_oid trailer_hash, file_hash;
-	git_hash_ctx ctx;
 	git_filebuf index_file = {0};
 	void *packfile_trailer;
 
-	if (git_hash_ctx_init(&ctx) < 0)
-		return -1;
-
 	/* Test for this before resolve_deltas(), as it plays with idx->off */
 	if (idx->off < idx->pack->mwf.size - 20) {
 		giterr_set(GITERR_INDEXER, "Unexpected data at the end of the pack");
@@ -936,64 +1355,9 @@ int git_indexer_commit(git_indexer *idx, git_transfer_progress *stats)
 		GIT_FILEBUF_HASH_CONTENTS, idx->mode) < 0)
 		goto on_error;
 
-	/* Write out the header */
-	hdr.idx_signature = htonl(PACK_IDX_SIGNATURE);
-	hdr.idx_version = htonl(2);
-	git_filebuf_write(&index_file, &hdr, sizeof(hdr));
-
-	/* Write out the fanout table */
-	for (i = 0; i < 256; ++i) {
-		uint32_t n = htonl(idx->fanout[i]);
-		git_filebuf_write(&index_file, &n, sizeof(n));
-	}
-
-	/* Write out the object names (SHA-1 hashes) */
-	git_vector_foreach(&idx->objects, i, entry) {
-		git_filebuf_write(&index_file, &entry->oid, sizeof(git_oid));
-		git_hash_update(&ctx, &entry->oid, GIT_OID_RAWSZ);
-	}
-	git_hash_final(&idx->hash, &ctx);
-
-	/* Write out the CRC32 values */
-	git_vector_foreach(&idx->objects, i, entry) {
-		git_filebuf_write(&index_file, &entry->crc, sizeof(uint32_t));
-	}
-
-	/* Write out the offsets */
-	git_vector_foreach(&idx->objects, i, entry) {
-		uint32_t n;
-
-		if (entry->offset == UINT32_MAX)
-			n = htonl(0x80000000 | long_offsets++);
-		else
-			n = htonl(entry->offset);
-
-		git_filebuf_write(&index_file, &n, sizeof(uint32_t));
-	}
-
-	/* Write out the long offsets */
-	git_vector_foreach(&idx->objects, i, entry) {
-		uint32_t split[2];
-
-		if (entry->offset != UINT32_MAX)
-			continue;
-
-		split[0] = htonl(entry->offset_long >> 32);
-		split[1] = htonl(entry->offset_long & 0xffffffff);
-
-		git_filebuf_write(&index_file, &split, sizeof(uint32_t) * 2);
-	}
-
-	/* Write out the packfile trailer to the index */
-	if (git_filebuf_write(&index_file, &trailer_hash, GIT_OID_RAWSZ) < 0)
-		goto on_error;
-
-	/* Write out the hash of the idx */
-	if (git_filebuf_hash(&trailer_hash, &index_file) < 0)
+	if (git_indexer__write_index(&index_file, &idx->hash, &idx->objects, &trailer_hash) < 0)
 		goto on_error;
 
-	git_filebuf_write(&index_file, &trailer_hash, sizeof(git_oid));
-
 	/* Figure out what the final name should be */
 	if (index_path(&filename, idx, ".idx") < 0)
 		goto on_error;
@@ -1024,7 +1388,6 @@ on_error:
 	git_mwindow_free_all(&idx->pack->mwf);
 	git_filebuf_cleanup(&index_file);
 	git_buf_free(&filename);
-	git_hash_ctx_cleanup(&ctx);
 	return -1;
 }
 
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_indexer_h__
+#define INCLUDE_indexer_h__
+
+#include "git2/indexer.h"
+#include "filebuf.h"
+#include "vector.h"
+
+#define UINT31_MAX (0x7FFFFFFF)
+
+/* An object of a packfile, as listed in its index */
+struct git_indexer_entry {
+	git_oid oid;
+	uint32_t crc;
+	uint32_t offset;
+	uint64_t offset_long;
+};
+
+/* Order `struct git_indexer_entry` by object id */
+extern int git_indexer__entry_cmp(const void *a, const void *b);
+
+/*
+ * Write a version 2 pack index listing `entries`, which must be sorted,
+ * into `file`. `pack_trailer` is the checksum of the packfile; `name`
+ * receives the hash of the object names, which the pack is named after.
+ */
+extern int git_indexer__write_index(
+	git_filebuf *file,
+	git_oid *name,
+	git_vector *entries,
+	const git_oid *pack_trailer);
+
+#endif
@@ -11,6 +11,7 @@
 #include "ignore.h"
 #include "buffer.h"
 #include "submodule.h"
+#include "fsmonitor.h"
 #include <ctype.h>
 
 #define ITERATOR_SET_CB(P,NAME_LC) do { \
@@ -910,6 +911,7 @@ struct fs_iterator {
 	size_t root_len;
 	uint32_t dirload_flags;
 	int depth;
+	git_fsmonitor *fsmonitor;
 
 	int (*enter_dir_cb)(fs_iterator *self);
 	int (*leave_dir_cb)(fs_iterator *self);
@@ -985,6 +987,7 @@ static void fs_iterator__seek_frame_start(
 static int fs_iterator__expand_dir(fs_iterator *fi)
 {
 	int error;
+	size_t stat_calls;
 	fs_iterator_frame *ff;
 
 	if (fi->depth > FS_MAX_DEPTH) {
@@ -996,9 +999,16 @@ static int fs_iterator__expand_dir(fs_iterator *fi)
 	ff = fs_iterator__alloc_frame(fi);
 	GITERR_CHECK_ALLOC(ff);
 
-	error = git_path_dirload_with_stat(
-		fi->path.ptr, fi->root_len, fi->dirload_flags,
-		fi->base.start, fi->base.end, &ff->entries);
+	if (fi->fsmonitor)
+		error = git_fsmonitor__dirload(
+			&stat_calls, fi->fsmonitor, fi->path.ptr, fi->root_len,
+			fi->dirload_flags, &ff->entries);
+	else {
+		error = git_path_dirload_with_stat(
+			fi->path.ptr, fi->root_len, fi->dirload_flags,
+			fi->base.start, fi->base.end, &ff->entries);
+		stat_calls = ff->entries.length;
+	}
 
 	if (error < 0) {
 		git_error_state last_error = { 0 };
@@ -1017,7 +1027,7 @@ static int fs_iterator__expand_dir(fs_iterator *fi)
 		fs_iterator__free_frame(ff);
 		return GIT_ENOTFOUND;
 	}
-	fi->base.stat_calls += ff->entries.length;
+	fi->base.stat_calls += stat_calls;
 
 	fs_iterator__seek_frame_start(fi, ff);
 
@@ -1365,6 +1375,7 @@ static void workdir_iterator__free(git_iterator *self)
 	workdir_iterator *wi = (workdir_iterator *)self;
 	fs_iterator__free(self);
 	git_ignore__free(&wi->ignores);
+	git_fsmonitor_free(wi->fi.fsmonitor);
 }
 
 int git_iterator_for_workdir_ext(
@@ -1408,6 +1419,17 @@ int git_iterator_for_workdir_ext(
 	else if (precompose)
 		wi->fi.base.flags |= GIT_ITERATOR_PRECOMPOSE_UNICODE;
 
+	/* a monitor that failed to catch up is ignored, not an error */
+	if (repo->_fsmonitor != NULL &&
+		!strcmp(repo_workdir, repo->_fsmonitor->workdir)) {
+		if (git_fsmonitor__refresh(repo->_fsmonitor) < 0)
+			giterr_clear();
+		else {
+			GIT_REFCOUNT_INC(repo->_fsmonitor);
+			wi->fi.fsmonitor = repo->_fsmonitor;
+		}
+	}
+
 	return fs_iterator__initialize(out, &wi->fi, repo_workdir);
 }
 
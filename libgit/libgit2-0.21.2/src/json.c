@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "json.h"
+
+#define JSON_MAX_DEPTH 64
+
+typedef struct {
+	const char *p;
+	const char *end;
+	int depth;
+} json_parser;
+
+static int json_error(json_parser *parser, const char *what)
+{
+	GIT_UNUSED(parser);
+	giterr_set(GITERR_INVALID, "Invalid JSON: %s", what);
+	return -1;
+}
+
+static void skip_space(json_parser *parser)
+{
+	while (parser->p < parser->end &&
+		(*parser->p == ' ' || *parser->p == '\t' ||
+		 *parser->p == '\n' || *parser->p == '\r'))
+		parser->p++;
+}
+
+static int consume(json_parser *parser, const char *word)
+{
+	size_t len = strlen(word);
+
+	if ((size_t)(parser->end - parser->p) < len ||
+		memcmp(parser->p, word, len) != 0)
+		return json_error(parser, "unexpected token");
+
+	parser->p += len;
+	return 0;
+}
+
+static int hex4(uint32_t *out, json_parser *parser)
+{
+	int i, v;
+
+	if (parser->end - parser->p < 4)
+		return json_error(parser, "truncated escape");
+
+	for (*out = 0, i = 0; i < 4; i++) {
+		if ((v = git__fromhex(parser->p[i])) < 0)
+			return json_error(parser, "bad escape");
+		*out = (*out << 4) | (uint32_t)v;
+	}
+
+	parser->p += 4;
+	return 0;
+}
+
+static void put_utf8(git_buf *buf, uint32_t c)
+{
+	if (c < 0x80)
+		git_buf_putc(buf, (char)c);
+	else if (c < 0x800) {
+		git_buf_putc(buf, (char)(0xc0 | (c >> 6)));
+		git_buf_putc(buf, (char)(0x80 | (c & 0x3f)));
+	} else if (c < 0x10000) {
+		git_buf_putc(buf, (char)(0xe0 | (c >> 12)));
+		git_buf_putc(buf, (char)(0x80 | ((c >> 6) & 0x3f)));
+		git_buf_putc(buf, (char)(0x80 | (c & 0x3f)));
+	} else {
+		git_buf_putc(buf, (char)(0xf0 | (c >> 18)));
+		git_buf_putc(buf, (char)(0x80 | ((c >> 12) & 0x3f)));
+		git_buf_putc(buf, (char)(0x80 | ((c >> 6) & 0x3f)));
+		git_buf_putc(buf, (char)(0x80 | (c & 0x3f)));
+	}
+}
+
+static int parse_string(char **out, json_parser *parser)
+{
+	git_buf buf = GIT_BUF_INIT;
+	uint32_t c, low;
+
+	parser->p++; /* opening quote */
+
+	while (parser->p < parser->end && *parser->p != '"') {
+		const char *start = parser->p;
+
+		while (parser->p < parser->end &&
+			*parser->p != '"' && *parser->p != '\\')
+			parser->p++;
+		git_buf_put(&buf, start, parser->p - start);
+
+		if (parser->p >= parser->end || *parser->p == '"')
+			break;
+
+		if (++parser->p >= parser->end)
+			goto invalid;
+
+		switch (*parser->p++) {
+		case '"':  git_buf_putc(&buf, '"'); break;
+		case '\\': git_buf_putc(&buf, '\\'); break;
+		case '/':  git_buf_putc(&buf, '/'); break;
+		case 'b':  git_buf_putc(&buf, '\b'); break;
+		case 'f':  git_buf_putc(&buf, '\f'); break;
+		case 'n':  git_buf_putc(&buf, '\n'); break;
+		case 'r':  git_buf_putc(&buf, '\r'); break;
+		case 't':  git_buf_putc(&buf, '\t'); break;
+		case 'u':
+			if (hex4(&c, parser) < 0)
+				goto on_error;
+
+			/* a surrogate pair encodes one character */
+			if (c >= 0xd800 && c < 0xdc00 &&
+				parser->end - parser->p >= 6 &&
+				parser->p[0] == '\\' && parser->p[1] == 'u') {
+				parser->p += 2;
+				if (hex4(&low, parser) < 0)
+					goto on_error;
+				if (low < 0xdc00 || low > 0xdfff)
+					goto invalid;
+				c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+			}
+
+			put_utf8(&buf, c);
+			break;
+		default:
+			goto invalid;
+		}
+	}
+
+	if (parser->p >= parser->end)
+		goto invalid;
+	parser->p++; /* closing quote */
+
+	if (git_buf_oom(&buf))
+		goto on_error;
+
+	/* keep empty strings distinguishable from missing ones */
+	if (!buf.ptr || !buf.asize)
+		*out = git__strdup("");
+	else
+		*out = git_buf_detach(&buf);
+
+	GITERR_CHECK_ALLOC(*out);
+	return 0;
+
+invalid:
+	json_error(parser, "bad string");
+on_error:
+	git_buf_free(&buf);
+	return -1;
+}
+
+static int parse_number(git_json *value, json_parser *parser)
+{
+	const char *start = parser->p;
+	bool negative = false;
+	int64_t n = 0;
+
+	if (*parser->p == '-') {
+		negative = true;
+		parser->p++;
+	}
+
+	while (parser->p < parser->end && git__isdigit(*parser->p)) {
+		if (n > (INT64_MAX - 9) / 10)
+			return json_error(parser, "number too large");
+		n = n * 10 + (*parser->p++ - '0');
+	}
+
+	if (parser->p == start + negative)
+		return json_error(parser, "bad number");
+
+	/* fractions and exponents are accepted, but not kept */
+	while (parser->p < parser->end &&
+		(git__isdigit(*parser->p) || *parser->p == '.' ||
+		 *parser->p == 'e' || *parser->p == 'E' ||
+		 *parser->p == '+' || *parser->p == '-'))
+		parser->p++;
+
+	value->type = GIT_JSON_NUMBER;
+	value->number = negative ? -n : n;
+	return 0;
+}
+
+static int parse_value(git_json *value, json_parser *parser);
+
+static int parse_members(git_json *value, json_parser *parser, char close)
+{
+	git_json **tail = &value->child;
+	bool is_object = (close == '}');
+
+	if (++parser->depth > JSON_MAX_DEPTH)
+		return json_error(parser, "nested too deeply");
+
+	parser->p++; /* opening bracket */
+	skip_space(parser);
+
+	if (parser->p < parser->end && *parser->p == close) {
+		parser->p++;
+		parser->depth--;
+		return 0;
+	}
+
+	while (1) {
+		git_json *member = git__calloc(1, sizeof(git_json));
+		GITERR_CHECK_ALLOC(member);
+
+		*tail = member;
+		tail = &member->next;
+
+		skip_space(parser);
+
+		if (is_object) {
+			if (parser->p >= parser->end || *parser->p != '"')
+				return json_error(parser, "expected a member name");
+			if (parse_string(&member->key, parser) < 0)
+				return -1;
+
+			skip_space(parser);
+			if (parser->p >= parser->end || *parser->p != ':')
+				return json_error(parser, "expected ':'");
+			parser->p++;
+		}
+
+		if (parse_value(member, parser) < 0)
+			return -1;
+
+		skip_space(parser);
+		if (parser->p >= parser->end)
+			return json_error(parser, "unterminated container");
+
+		if (*parser->p == close)
+			break;
+		if (*parser->p != ',')
+			return json_error(parser, "expected ','");
+		parser->p++;
+	}
+
+	parser->p++;
+	parser->depth--;
+	return 0;
+}
+
+static int parse_value(git_json *value, json_parser *parser)
+{
+	skip_space(parser);
+
+	if (parser->p >= parser->end)
+		return json_error(parser, "unexpected end");
+
+	switch (*parser->p) {
+	case '{':
+		value->type = GIT_JSON_OBJECT;
+		return parse_members(value, parser, '}');
+	case '[':
+		value->type = GIT_JSON_ARRAY;
+		return parse_members(value, parser, ']');
+	case '"':
+		value->type = GIT_JSON_STRING;
+		return parse_string(&value->string, parser);
+	case 't':
+		value->type = GIT_JSON_BOOL;
+		value->number = 1;
+		return consume(parser, "true");
+	case 'f':
+		value->type = GIT_JSON_BOOL;
+		return consume(parser, "false");
+	case 'n':
+		value->type = GIT_JSON_NULL;
+		return consume(parser, "null");
+	default:
+		return parse_number(value, parser);
+	}
+}
+
+int git_json_parse(git_json **out, const char *data, size_t len)
+{
+	json_parser parser;
+	git_json *value;
+
+	*out = NULL;
+
+	parser.p = data;
+	parser.end = data + len;
+	parser.depth = 0;
+
+	value = git__calloc(1, sizeof(git_json));
+	GITERR_CHECK_ALLOC(value);
+
+	if (parse_value(value, &parser) < 0)
+		goto on_error;
+
+	skip_space(&parser);
+	if (parser.p != parser.end) {
+		json_error(&parser, "trailing data");
+		goto on_error;
+	}
+
+	*out = value;
+	return 0;
+
+on_error:
+	git_json_free(value);
+	return -1;
+}
+
+void git_json_free(git_json *json)
+{
+	while (json) {
+		git_json *next = json->next;
+
+		git_json_free(json->child);
+		git__free(json->key);
+		git__free(json->string);
+		git__free(json);
+
+		json = next;
+	}
+}
+
+const git_json *git_json_get(const git_json *json, const char *key)
+{
+	const git_json *member;
+
+	if (!json || json->type != GIT_JSON_OBJECT)
+		return NULL;
+
+	for (member = json->child; member; member = member->next)
+		if (!strcmp(member->key, key))
+			return member;
+
+	return NULL;
+}
+
+const char *git_json_get_string(const git_json *json, const char *key)
+{
+	const git_json *member = git_json_get(json, key);
+	return (member && member->type == GIT_JSON_STRING) ? member->string : NULL;
+}
+
+int git_json_puts(git_buf *buf, const char *str)
+{
+	const unsigned char *c;
+
+	git_buf_putc(buf, '"');
+
+	for (c = (const unsigned char *)str; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			git_buf_putc(buf, '\\');
+			git_buf_putc(buf, (char)*c);
+		} else if (*c < 0x20)
+			git_buf_printf(buf, "\\u%04x", *c);
+		else
+			git_buf_putc(buf, (char)*c);
+	}
+
+	git_buf_putc(buf, '"');
+
+	return git_buf_oom(buf) ? -1 : 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_json_h__
+#define INCLUDE_json_h__
+
+#include "common.h"
+#include "buffer.h"
+
+/*
+ * Small JSON reader for the HTTP APIs we talk to.  A document becomes a
+ * tree of values; members of objects and arrays are chained by `next`.
+ */
+
+typedef enum {
+	GIT_JSON_NULL = 0,
+	GIT_JSON_BOOL,
+	GIT_JSON_NUMBER,
+	GIT_JSON_STRING,
+	GIT_JSON_ARRAY,
+	GIT_JSON_OBJECT,
+} git_json_t;
+
+typedef struct git_json git_json;
+
+struct git_json {
+	git_json_t type;
+	char *key;      /* member name, when inside an object */
+	char *string;   /* GIT_JSON_STRING, NUL-terminated */
+	int64_t number; /* GIT_JSON_NUMBER (fractions are dropped) and GIT_JSON_BOOL */
+	git_json *child; /* first member of an array or object */
+	git_json *next;
+};
+
+int git_json_parse(git_json **out, const char *data, size_t len);
+void git_json_free(git_json *json);
+
+/* Member `key` of an object, if `json` is one and has it */
+const git_json *git_json_get(const git_json *json, const char *key);
+
+/* Value of the string member `key`, or NULL */
+const char *git_json_get_string(const git_json *json, const char *key);
+
+/* Append `str` as a quoted JSON string */
+int git_json_puts(git_buf *buf, const char *str);
+
+#endif
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "git2/attr.h"
+#include "git2/sys/filter.h"
+
+#include "lfs.h"
+#include "filter.h"
+#include "filebuf.h"
+#include "fileops.h"
+#include "odb.h"
+#include "repository.h"
+#include "tree.h"
+
+static const char *lfs_spec_v1 = "https://git-lfs.github.com/spec/v1";
+/* written by the first releases, before the project was renamed */
+static const char *lfs_spec_hawser = "https://hawser.github.com/spec/v1";
+
+static bool lfs_key_valid(const char *key, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (!(key[i] >= 'a' && key[i] <= 'z') &&
+			!git__isdigit(key[i]) && key[i] != '.' && key[i] != '-')
+			return false;
+	}
+
+	return len > 0;
+}
+
+static bool lfs_oid_valid(const char *oid, size_t len)
+{
+	size_t i;
+
+	if (len != GIT_SHA256_HEXSZ)
+		return false;
+
+	for (i = 0; i < len; i++) {
+		if (!git__isdigit(oid[i]) && !(oid[i] >= 'a' && oid[i] <= 'f'))
+			return false;
+	}
+
+	return true;
+}
+
+int git_lfs_pointer_parse(git_lfs_pointer *out, const char *data, size_t len)
+{
+	const char *line = data, *end = data + len, *eol, *value;
+	bool have_oid = false, have_size = false;
+	size_t keylen, valuelen;
+	int64_t size;
+
+	memset(out, 0, sizeof(*out));
+
+	if (len < 8 || len > GIT_LFS_POINTER_MAX || memcmp(data, "version ", 8))
+		return GIT_ENOTFOUND;
+
+	for (; line < end; line = eol + 1) {
+		if ((eol = memchr(line, '\n', end - line)) == NULL ||
+			(value = memchr(line, ' ', eol - line)) == NULL)
+			return GIT_ENOTFOUND;
+
+		keylen = value - line;
+		value++;
+		valuelen = eol - value;
+
+		if (line == data) {
+			if ((valuelen != strlen(lfs_spec_v1) ||
+				 memcmp(value, lfs_spec_v1, valuelen)) &&
+				(valuelen != strlen(lfs_spec_hawser) ||
+				 memcmp(value, lfs_spec_hawser, valuelen)))
+				return GIT_ENOTFOUND;
+		} else if (keylen == 3 && !memcmp(line, "oid", 3)) {
+			if (valuelen < 7 || memcmp(value, "sha256:", 7) ||
+				!lfs_oid_valid(value + 7, valuelen - 7))
+				return GIT_ENOTFOUND;
+
+			memcpy(out->oid, value + 7, GIT_SHA256_HEXSZ);
+			have_oid = true;
+		} else if (keylen == 4 && !memcmp(line, "size", 4)) {
+			const char *digits_end;
+
+			if (!valuelen || !git__isdigit(*value) ||
+				git__strtol64(&size, value, &digits_end, 10) < 0 ||
+				digits_end != eol || size < 0)
+				return GIT_ENOTFOUND;
+
+			out->size = (git_off_t)size;
+			have_size = true;
+		} else if (!lfs_key_valid(line, keylen))
+			return GIT_ENOTFOUND;
+	}
+
+	return (have_oid && have_size) ? 0 : GIT_ENOTFOUND;
+}
+
+int git_lfs_pointer_format(git_buf *out, const git_lfs_pointer *ptr)
+{
+	git_buf_printf(out, "version %s\noid sha256:%s\nsize %" PRId64 "\n",
+		lfs_spec_v1, ptr->oid, (int64_t)ptr->size);
+
+	return git_buf_oom(out) ? -1 : 0;
+}
+
+int git_lfs__object_path(git_buf *out, git_repository *repo, const char *oid)
+{
+	git_buf_joinpath(out, git_repository_path(repo), "lfs/objects");
+	git_buf_printf(out, "/%.2s/%.2s/%s", oid, oid + 2, oid);
+
+	return git_buf_oom(out) ? -1 : 0;
+}
+
+bool git_lfs__has_object(git_repository *repo, const git_lfs_pointer *ptr)
+{
+	git_buf path = GIT_BUF_INIT;
+	struct stat st;
+	bool found;
+
+	found = !git_lfs__object_path(&path, repo, ptr->oid) &&
+		!p_stat(path.ptr, &st) && st.st_size == ptr->size;
+
+	git_buf_free(&path);
+	return found;
+}
+
+int git_lfs__store(
+	git_lfs_pointer *out, git_repository *repo, const char *data, size_t len)
+{
+	git_sha256_ctx ctx;
+	git_filebuf file = GIT_FILEBUF_INIT;
+	git_buf path = GIT_BUF_INIT;
+	int error;
+
+	git_sha256_init(&ctx);
+	git_sha256_update(&ctx, data, len);
+	git_sha256_final_hex(out->oid, &ctx);
+	out->size = (git_off_t)len;
+
+	if (git_lfs__has_object(repo, out))
+		return 0;
+
+	if ((error = git_lfs__object_path(&path, repo, out->oid)) < 0 ||
+		(error = git_futils_mkpath2file(path.ptr, GIT_OBJECT_DIR_MODE)) < 0 ||
+		(error = git_filebuf_open(&file, path.ptr, 0, GIT_OBJECT_FILE_MODE)) < 0)
+		goto done;
+
+	if ((error = git_filebuf_write(&file, data, len)) < 0 ||
+		(error = git_filebuf_commit(&file)) < 0)
+		git_filebuf_cleanup(&file);
+
+done:
+	git_buf_free(&path);
+	return error;
+}
+
+static int lfs_read(git_buf *out, git_repository *repo, const git_lfs_pointer *ptr)
+{
+	git_buf path = GIT_BUF_INIT;
+	int error;
+
+	if ((error = git_lfs__object_path(&path, repo, ptr->oid)) >= 0 &&
+		(error = git_futils_readbuffer(out, path.ptr)) >= 0 &&
+		(git_off_t)out->size != ptr->size) {
+		giterr_set(GITERR_FILTER,
+			"Stored content of large file %s has the wrong size", ptr->oid);
+		error = -1;
+	}
+
+	git_buf_free(&path);
+	return error;
+}
+
+int git_lfs__want(
+	git_lfs_pointer_array *wanted,
+	git_repository *repo,
+	const char *path,
+	const git_oid *id)
+{
+	const char *filter;
+	git_odb *odb;
+	git_odb_object *obj;
+	git_otype type;
+	git_lfs_pointer ptr, *slot;
+	size_t len;
+	int error;
+
+	if ((error = git_attr_get(&filter, repo, 0, path, "filter")) < 0)
+		return error;
+
+	if (!filter || strcmp(filter, GIT_FILTER_LFS) != 0)
+		return 0;
+
+	/* a pointer can be told apart from its size, without reading it */
+	if ((error = git_repository_odb__weakptr(&odb, repo)) < 0 ||
+		(error = git_odb_read_header(&len, &type, odb, id)) < 0)
+		return error;
+
+	if (type != GIT_OBJ_BLOB || len > GIT_LFS_POINTER_MAX)
+		return 0;
+
+	if ((error = git_odb_read(&obj, odb, id)) < 0)
+		return error;
+
+	error = git_lfs_pointer_parse(&ptr,
+		git_odb_object_data(obj), git_odb_object_size(obj));
+	git_odb_object_free(obj);
+
+	if (error == GIT_ENOTFOUND || (!error && git_lfs__has_object(repo, &ptr)))
+		return 0;
+
+	slot = git_array_alloc(*wanted);
+	GITERR_CHECK_ALLOC(slot);
+	memcpy(slot, &ptr, sizeof(ptr));
+
+	return 0;
+}
+
+typedef struct {
+	git_repository *repo;
+	git_lfs_pointer_array wanted;
+	git_buf path;
+} lfs_tree_walk;
+
+static int lfs_tree_walk_cb(const char *root, const git_tree_entry *entry, void *payload)
+{
+	lfs_tree_walk *walk = payload;
+
+	if (git_tree_entry_type(entry) != GIT_OBJ_BLOB ||
+		git_tree_entry_filemode(entry) == GIT_FILEMODE_LINK)
+		return 0;
+
+	git_buf_clear(&walk->path);
+	if (git_buf_printf(&walk->path, "%s%s", root, git_tree_entry_name(entry)) < 0)
+		return -1;
+
+	return git_lfs__want(&walk->wanted, walk->repo,
+		walk->path.ptr, git_tree_entry_id(entry));
+}
+
+int git_lfs_fetch_tree(
+	git_repository *repo,
+	const git_tree *tree,
+	const git_lfs_fetch_options *opts)
+{
+	lfs_tree_walk walk;
+	int error;
+
+	assert(repo && tree);
+	GITERR_CHECK_VERSION(opts, GIT_LFS_FETCH_OPTIONS_VERSION, "git_lfs_fetch_options");
+
+	memset(&walk, 0, sizeof(walk));
+	walk.repo = repo;
+
+	if ((error = git_tree_walk(tree, GIT_TREEWALK_PRE, lfs_tree_walk_cb, &walk)) >= 0 &&
+		walk.wanted.size > 0)
+		error = git_lfs__fetch(repo, walk.wanted.ptr, walk.wanted.size, opts);
+
+	git_array_clear(walk.wanted);
+	git_buf_free(&walk.path);
+	return error;
+}
+
+int git_lfs_init_fetch_options(git_lfs_fetch_options *opts, unsigned int version)
+{
+	GIT_INIT_STRUCTURE_FROM_TEMPLATE(
+		opts, version, git_lfs_fetch_options, GIT_LFS_FETCH_OPTIONS_INIT);
+	return 0;
+}
+
+/*
+ * The filter itself: "clean" moves the content into the store and
+ * commits a pointer to it, "smudge" swaps pointers for their content,
+ * downloading it when it is missing.
+ */
+
+static int lfs_clean(git_buf *to, const git_buf *from, git_repository *repo)
+{
+	git_lfs_pointer ptr;
+	int error;
+
+	/* empty files stay empty, and pointers are already clean */
+	if (!from->size || !git_lfs_pointer_parse(&ptr, from->ptr, from->size))
+		return GIT_PASSTHROUGH;
+
+	if ((error = git_lfs__store(&ptr, repo, from->ptr, from->size)) < 0)
+		return error;
+
+	git_buf_clear(to);
+	return git_lfs_pointer_format(to, &ptr);
+}
+
+static int lfs_smudge(git_buf *to, const git_buf *from, git_repository *repo)
+{
+	git_lfs_pointer ptr;
+	int error;
+
+	if (git_lfs_pointer_parse(&ptr, from->ptr, from->size) < 0)
+		return GIT_PASSTHROUGH;
+
+	if (!git_lfs__has_object(repo, &ptr) &&
+		(error = git_lfs__fetch(repo, &ptr, 1, NULL)) < 0) {
+		/* with nowhere to download from, keep the pointer */
+		if (error != GIT_ENOTFOUND)
+			return error;
+
+		giterr_clear();
+		return GIT_PASSTHROUGH;
+	}
+
+	git_buf_clear(to);
+	return lfs_read(to, repo, &ptr);
+}
+
+static int lfs_apply(
+	git_filter     *self,
+	void          **payload,
+	git_buf        *to,
+	const git_buf  *from,
+	const git_filter_source *src)
+{
+	GIT_UNUSED(self); GIT_UNUSED(payload);
+
+	if (git_filter_source_mode(src) == GIT_FILTER_SMUDGE)
+		return lfs_smudge(to, from, git_filter_source_repo(src));
+	else
+		return lfs_clean(to, from, git_filter_source_repo(src));
+}
+
+git_filter *git_lfs_filter_new(void)
+{
+	git_filter *f = git__calloc(1, sizeof(git_filter));
+
+	f->version = GIT_FILTER_VERSION;
+	f->attributes = "filter=lfs";
+	f->shutdown = git_filter_free;
+	f->apply    = lfs_apply;
+
+	return f;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_lfs_h__
+#define INCLUDE_lfs_h__
+
+#include "common.h"
+#include "array.h"
+#include "buffer.h"
+#include "sha256.h"
+
+#include "git2/lfs.h"
+#include "git2/oid.h"
+
+/* Pointer files are at most this big, larger blobs are never pointers */
+#define GIT_LFS_POINTER_MAX 1024
+
+#define GIT_LFS_DEFAULT_TRANSFERS 8
+
+typedef struct {
+	char oid[GIT_SHA256_HEXSZ + 1]; /* lowercase hex sha256 of the content */
+	git_off_t size;
+} git_lfs_pointer;
+
+typedef git_array_t(git_lfs_pointer) git_lfs_pointer_array;
+
+/* Returns GIT_ENOTFOUND when `data` is not a pointer file */
+int git_lfs_pointer_parse(git_lfs_pointer *out, const char *data, size_t len);
+int git_lfs_pointer_format(git_buf *out, const git_lfs_pointer *ptr);
+
+/* Path of the stored content, `.git/lfs/objects/ab/cd/abcd...` */
+int git_lfs__object_path(git_buf *out, git_repository *repo, const char *oid);
+bool git_lfs__has_object(git_repository *repo, const git_lfs_pointer *ptr);
+
+/* Store `data` (unless already there) and describe it in `out` */
+int git_lfs__store(
+	git_lfs_pointer *out, git_repository *repo, const char *data, size_t len);
+
+/*
+ * Queue the large file behind the blob `id` checked out at `path` when
+ * it is missing from the store; does nothing for other blobs.
+ */
+int git_lfs__want(
+	git_lfs_pointer_array *wanted,
+	git_repository *repo,
+	const char *path,
+	const git_oid *id);
+
+/*
+ * Download `objects` into the store, several at a time.  GIT_ENOTFOUND
+ * if the repository has no LFS server.
+ */
+int git_lfs__fetch(
+	git_repository *repo,
+	const git_lfs_pointer *objects,
+	size_t count,
+	const git_lfs_fetch_options *opts);
+
+/* The LFS server of the repository (without a trailing slash) */
+int git_lfs__endpoint(git_buf *out, git_repository *repo);
+
+#endif
@@ -0,0 +1,845 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "git2/config.h"
+#include "git2/version.h"
+
+#include "lfs.h"
+#include "fileops.h"
+#include "json.h"
+#include "netops.h"
+#include "odb.h"
+#include "repository.h"
+#include "thread-utils.h"
+#include "http_parser.h"
+
+/*
+ * Downloads from an LFS server: one batch API request per hundred
+ * objects tells where each object can be downloaded from, then several
+ * threads download them, each over its own connection.
+ *
+ * Downloads go to `.git/lfs/incomplete/<oid>` and are only moved into
+ * the store once their content matches the oid.  An interrupted
+ * download is resumed from where it stopped with a range request, by
+ * the next attempt or by the next fetch.
+ */
+
+#define LFS_BATCH_SIZE 100
+#define LFS_DOWNLOAD_ATTEMPTS 3
+#define LFS_MEDIA_TYPE "application/vnd.git-lfs+json"
+#define LFS_ERROR_BODY_MAX 1024
+
+/* A connection to an HTTP server, kept open across requests */
+typedef struct lfs_http lfs_http;
+
+typedef int (*lfs_http_body_cb)(lfs_http *http, const char *data, size_t len, void *payload);
+
+struct lfs_http {
+	gitno_socket socket;
+	gitno_connection_data conn;
+	bool connected;
+	bool keep_alive;
+
+	http_parser parser;
+	http_parser_settings settings;
+	char data[16384];
+
+	/* state of the current response */
+	lfs_http_body_cb body_cb;
+	void *body_payload;
+	int body_error;
+	bool complete;
+};
+
+typedef struct {
+	git_lfs_pointer ptr;
+
+	char *href;
+	git_buf headers; /* "Name: value\r\n" lines sent with the download */
+	char *path;      /* destination in the store */
+	char *partial;   /* download in progress */
+
+	int error;
+	int error_class;
+	char *error_msg;
+	bool done;
+} lfs_download;
+
+typedef struct {
+	lfs_download *downloads;
+	size_t count;
+
+	git_atomic next;
+	git_atomic cancel;
+	git_mutex lock;
+	git_cond done;
+} lfs_pool;
+
+/*
+ * HTTP
+ */
+
+static int lfs_http_on_body(http_parser *parser, const char *str, size_t len)
+{
+	lfs_http *http = parser->data;
+
+	if (http->body_cb && (http->body_error = http->body_cb(http, str, len, http->body_payload)) < 0)
+		return -1;
+
+	return 0;
+}
+
+static int lfs_http_on_message_complete(http_parser *parser)
+{
+	lfs_http *http = parser->data;
+
+	http->complete = true;
+	return 0;
+}
+
+static void lfs_http_init(lfs_http *http)
+{
+	memset(http, 0, sizeof(*http));
+	http->settings.on_body = lfs_http_on_body;
+	http->settings.on_message_complete = lfs_http_on_message_complete;
+}
+
+static void lfs_http_close(lfs_http *http)
+{
+	if (http->connected)
+		gitno_close(&http->socket);
+
+	http->connected = false;
+	gitno_connection_data_free_ptrs(&http->conn);
+}
+
+static int lfs_http_connect(lfs_http *http, const gitno_connection_data *conn)
+{
+	if (http->connected && http->keep_alive &&
+		http->conn.use_ssl == conn->use_ssl &&
+		!strcmp(http->conn.host, conn->host) &&
+		!strcmp(http->conn.port, conn->port))
+		return 0;
+
+	lfs_http_close(http);
+
+	if (gitno_connect(&http->socket, conn->host, conn->port,
+			conn->use_ssl ? GITNO_CONNECT_SSL : 0) < 0)
+		return -1;
+
+	http->conn.host = git__strdup(conn->host);
+	http->conn.port = git__strdup(conn->port);
+	http->conn.use_ssl = conn->use_ssl;
+	GITERR_CHECK_ALLOC(http->conn.host);
+	GITERR_CHECK_ALLOC(http->conn.port);
+
+	http->connected = true;
+	return 0;
+}
+
+static int lfs_http_send(
+	lfs_http *http,
+	const char *verb,
+	const char *url,
+	const gitno_connection_data *conn,
+	const char *headers,
+	const char *body,
+	size_t body_len)
+{
+	git_buf request = GIT_BUF_INIT, userpass = GIT_BUF_INIT;
+	const char *target;
+	int error = -1;
+
+	/* the path of the URL, with its query */
+	target = strchr(strstr(url, "://") + 3, '/');
+
+	git_buf_printf(&request, "%s %.*s HTTP/1.1\r\n", verb,
+		(int)strcspn(target, "#"), target);
+	git_buf_printf(&request, "Host: %s\r\n", conn->host);
+	git_buf_puts(&request, "User-Agent: git/1.0 (libgit2 " LIBGIT2_VERSION ")\r\n");
+	git_buf_puts(&request, headers);
+
+	if (conn->user && conn->pass && !strstr(headers, "Authorization:")) {
+		git_buf_printf(&userpass, "%s:%s", conn->user, conn->pass);
+		git_buf_puts(&request, "Authorization: Basic ");
+		git_buf_put_base64(&request, userpass.ptr, userpass.size);
+		git_buf_puts(&request, "\r\n");
+	}
+
+	if (body)
+		git_buf_printf(&request, "Content-Length: %"PRIuZ"\r\n", body_len);
+	git_buf_puts(&request, "\r\n");
+
+	if (git_buf_oom(&request) || git_buf_oom(&userpass))
+		goto done;
+
+	if (gitno_send(&http->socket, request.ptr, request.size, 0) < 0 ||
+		(body && gitno_send(&http->socket, body, body_len, 0) < 0))
+		goto done;
+
+	error = 0;
+
+done:
+	if (userpass.size)
+		memset(userpass.ptr, 0x0, userpass.size);
+	git_buf_free(&userpass);
+	git_buf_free(&request);
+	return error;
+}
+
+/* Returns the HTTP status of the response, or an error code */
+static int lfs_http_request(
+	lfs_http *http,
+	const char *verb,
+	const char *url,
+	const char *headers,
+	const char *body,
+	size_t body_len,
+	lfs_http_body_cb body_cb,
+	void *body_payload)
+{
+	gitno_connection_data conn;
+	gitno_buffer buf;
+	bool reused, received = false;
+	int error = -1, len;
+
+	http->body_error = 0;
+
+	memset(&conn, 0, sizeof(conn));
+	if (gitno_connection_data_from_url(&conn, url, NULL) < 0)
+		goto done;
+
+replay:
+	reused = http->connected && http->keep_alive;
+
+	if (lfs_http_connect(http, &conn) < 0)
+		goto done;
+
+	if (lfs_http_send(http, verb, url, &conn, headers, body, body_len) < 0) {
+		if (!reused)
+			goto done;
+
+		/* the server may have closed a connection we kept open */
+		giterr_clear();
+		http->keep_alive = false;
+		goto replay;
+	}
+
+	http_parser_init(&http->parser, HTTP_RESPONSE);
+	http->parser.data = http;
+	http->body_cb = body_cb;
+	http->body_payload = body_payload;
+	http->complete = false;
+
+	gitno_buffer_setup(&http->socket, &buf, http->data, sizeof(http->data));
+
+	while (!http->complete) {
+		buf.offset = 0;
+
+		if ((len = gitno_recv(&buf)) < 0)
+			goto done;
+
+		if (!len && !received && reused) {
+			http->keep_alive = false;
+			goto replay;
+		}
+
+		received = true;
+
+		if (http_parser_execute(&http->parser, &http->settings, buf.data, buf.offset) != buf.offset) {
+			if (http->body_error < 0) {
+				error = http->body_error;
+				goto done;
+			}
+
+			giterr_set(GITERR_NET, "HTTP parser error: %s",
+				http_errno_description((enum http_errno)http->parser.http_errno));
+			goto done;
+		}
+
+		if (!len && !http->complete) {
+			giterr_set(GITERR_NET, "Connection to '%s' closed before the end of the response", conn.host);
+			goto done;
+		}
+	}
+
+	http->keep_alive = http_should_keep_alive(&http->parser) != 0;
+	error = http->parser.status_code;
+
+done:
+	if (error < 0)
+		lfs_http_close(http);
+
+	gitno_connection_data_free_ptrs(&conn);
+	return error;
+}
+
+static int lfs_http_collect(lfs_http *http, const char *data, size_t len, void *payload)
+{
+	GIT_UNUSED(http);
+	return git_buf_put(payload, data, len);
+}
+
+/*
+ * Batch API
+ */
+
+int git_lfs__endpoint(git_buf *out, git_repository *repo)
+{
+	git_config *cfg;
+	const char *url = NULL;
+	int error;
+
+	if ((error = git_repository_config__weakptr(&cfg, repo)) < 0)
+		return error;
+
+	if ((error = git_config_get_string(&url, cfg, "lfs.url")) == GIT_ENOTFOUND)
+		error = git_config_get_string(&url, cfg, "remote.origin.lfsurl");
+
+	if (!error)
+		git_buf_sets(out, url);
+	else if (error == GIT_ENOTFOUND &&
+		!git_config_get_string(&url, cfg, "remote.origin.url") &&
+		(!git__prefixcmp(url, "http://") || !git__prefixcmp(url, "https://"))) {
+		/* next to the repository: <url>.git/info/lfs */
+		git_buf_sets(out, url);
+		while (out->size && out->ptr[out->size - 1] == '/')
+			git_buf_truncate(out, out->size - 1);
+
+		git_buf_puts(out, git__suffixcmp(out->ptr, ".git") ? ".git/info/lfs" : "/info/lfs");
+		error = 0;
+	}
+
+	if (error == GIT_ENOTFOUND) {
+		giterr_set(GITERR_FILTER, "No LFS server configured (lfs.url)");
+		return error;
+	}
+
+	if (error < 0)
+		return error;
+
+	while (out->size && out->ptr[out->size - 1] == '/')
+		git_buf_truncate(out, out->size - 1);
+
+	return git_buf_oom(out) ? -1 : 0;
+}
+
+static int lfs_download_cmp(const void *a, const void *b)
+{
+	return strcmp(((const lfs_download *)a)->ptr.oid, ((const lfs_download *)b)->ptr.oid);
+}
+
+static lfs_download *lfs_download_find(
+	lfs_download *downloads, size_t count, const char *oid)
+{
+	lfs_download key;
+
+	if (strlen(oid) != GIT_SHA256_HEXSZ)
+		return NULL;
+
+	memcpy(key.ptr.oid, oid, GIT_SHA256_HEXSZ + 1);
+	return bsearch(&key, downloads, count, sizeof(lfs_download), lfs_download_cmp);
+}
+
+static void lfs_download_fail(lfs_download *dl, const char *fmt, const char *detail)
+{
+	git_buf msg = GIT_BUF_INIT;
+
+	git_buf_printf(&msg, "Cannot download large file %s: ", dl->ptr.oid);
+	git_buf_printf(&msg, fmt, detail);
+
+	dl->error = -1;
+	dl->error_class = GITERR_NET;
+	dl->error_msg = git_buf_detach(&msg);
+}
+
+static int lfs_batch_object(lfs_download *downloads, size_t count, const git_json *obj)
+{
+	const git_json *download, *headers, *header;
+	const char *oid = git_json_get_string(obj, "oid"), *href;
+	lfs_download *dl;
+
+	if (!oid || (dl = lfs_download_find(downloads, count, oid)) == NULL)
+		return 0;
+
+	if (git_json_get(obj, "error")) {
+		const char *message = git_json_get_string(git_json_get(obj, "error"), "message");
+		lfs_download_fail(dl, "%s", message ? message : "unknown error");
+		return 0;
+	}
+
+	download = git_json_get(git_json_get(obj, "actions"), "download");
+	if ((href = git_json_get_string(download, "href")) == NULL ||
+		(git__prefixcmp(href, "http://") && git__prefixcmp(href, "https://"))) {
+		lfs_download_fail(dl, "%s", "the server gave no download location");
+		return 0;
+	}
+
+	dl->href = git__strdup(href);
+	GITERR_CHECK_ALLOC(dl->href);
+
+	if ((headers = git_json_get(download, "header")) != NULL &&
+		headers->type == GIT_JSON_OBJECT) {
+		for (header = headers->child; header; header = header->next) {
+			/* a header must not smuggle in another one */
+			if (header->type != GIT_JSON_STRING ||
+				strpbrk(header->key, "\r\n:") || strpbrk(header->string, "\r\n"))
+				continue;
+
+			git_buf_printf(&dl->headers, "%s: %s\r\n", header->key, header->string);
+		}
+	}
+
+	return git_buf_oom(&dl->headers) ? -1 : 0;
+}
+
+static int lfs_batch(
+	lfs_http *http, const char *endpoint, lfs_download *downloads, size_t count)
+{
+	git_buf url = GIT_BUF_INIT, request = GIT_BUF_INIT, response = GIT_BUF_INIT;
+	git_json *json = NULL;
+	const git_json *objects, *obj;
+	size_t i;
+	int status, error = -1;
+
+	git_buf_puts(&request, "{\"operation\":\"download\",\"transfers\":[\"basic\"],\"objects\":[");
+	for (i = 0; i < count; i++) {
+		git_buf_puts(&request, i ? ",{\"oid\":" : "{\"oid\":");
+		git_json_puts(&request, downloads[i].ptr.oid);
+		git_buf_printf(&request, ",\"size\":%" PRId64 "}", (int64_t)downloads[i].ptr.size);
+	}
+	git_buf_puts(&request, "]}");
+
+	git_buf_printf(&url, "%s/objects/batch", endpoint);
+
+	if (git_buf_oom(&request) || git_buf_oom(&url))
+		goto done;
+
+	if ((status = lfs_http_request(http, "POST", url.ptr,
+			"Accept: " LFS_MEDIA_TYPE "\r\nContent-Type: " LFS_MEDIA_TYPE "\r\n",
+			request.ptr, request.size, lfs_http_collect, &response)) < 0)
+		goto done;
+
+	if (status != 200) {
+		git_buf_truncate(&response, LFS_ERROR_BODY_MAX);
+		giterr_set(GITERR_NET, "LFS batch request to '%s' failed (%d): %s",
+			url.ptr, status, git_buf_cstr(&response));
+		goto done;
+	}
+
+	if (git_json_parse(&json, response.ptr, response.size) < 0)
+		goto done;
+
+	if ((objects = git_json_get(json, "objects")) == NULL ||
+		objects->type != GIT_JSON_ARRAY) {
+		giterr_set(GITERR_NET, "Invalid LFS batch response from '%s'", url.ptr);
+		goto done;
+	}
+
+	for (obj = objects->child; obj; obj = obj->next) {
+		if (lfs_batch_object(downloads, count, obj) < 0)
+			goto done;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!downloads[i].href && !downloads[i].error)
+			lfs_download_fail(&downloads[i], "%s", "not in the server's answer");
+	}
+
+	error = 0;
+
+done:
+	git_json_free(json);
+	git_buf_free(&response);
+	git_buf_free(&request);
+	git_buf_free(&url);
+	return error;
+}
+
+/*
+ * Downloads
+ */
+
+typedef struct {
+	lfs_download *dl;
+	git_file fd;
+	git_off_t offset;
+	git_sha256_ctx ctx;
+	bool first;
+} lfs_transfer;
+
+static int lfs_transfer_open(lfs_transfer *t, bool truncate)
+{
+	char buffer[16384];
+	ssize_t n;
+
+	if (t->fd >= 0)
+		p_close(t->fd);
+
+	t->offset = 0;
+	git_sha256_init(&t->ctx);
+
+	if ((t->fd = p_open(t->dl->partial,
+			O_RDWR | O_CREAT | O_BINARY | (truncate ? O_TRUNC : 0), 0666)) < 0) {
+		giterr_set(GITERR_OS, "Failed to open '%s'", t->dl->partial);
+		return -1;
+	}
+
+	/* what an earlier attempt got is hashed again, then appended to */
+	while ((n = p_read(t->fd, buffer, sizeof(buffer))) > 0) {
+		git_sha256_update(&t->ctx, buffer, (size_t)n);
+		t->offset += n;
+	}
+
+	if (n < 0) {
+		giterr_set(GITERR_OS, "Failed to read '%s'", t->dl->partial);
+		return -1;
+	}
+
+	if (t->offset > t->dl->ptr.size)
+		return lfs_transfer_open(t, true);
+
+	return 0;
+}
+
+static int lfs_transfer_body(lfs_http *http, const char *data, size_t len, void *payload)
+{
+	lfs_transfer *t = payload;
+	int status = http->parser.status_code;
+
+	if (status != 200 && status != 206)
+		return 0;
+
+	/* the server ignored our range and sends everything again */
+	if (t->first && status == 200 && t->offset > 0 &&
+		lfs_transfer_open(t, true) < 0)
+		return -1;
+
+	t->first = false;
+
+	if (t->offset + (git_off_t)len > t->dl->ptr.size) {
+		giterr_set(GITERR_NET, "Large file %s is bigger than expected", t->dl->ptr.oid);
+		return -1;
+	}
+
+	if (p_write(t->fd, data, len) < 0) {
+		giterr_set(GITERR_OS, "Failed to write '%s'", t->dl->partial);
+		return -1;
+	}
+
+	git_sha256_update(&t->ctx, data, len);
+	t->offset += len;
+	return 0;
+}
+
+static int lfs_download_one(lfs_http *http, lfs_download *dl)
+{
+	lfs_transfer t;
+	git_buf headers = GIT_BUF_INIT;
+	char oid[GIT_SHA256_HEXSZ + 1];
+	int attempt, status = -1, error;
+
+	memset(&t, 0, sizeof(t));
+	t.dl = dl;
+	t.fd = -1;
+
+	if ((error = git_futils_mkpath2file(dl->partial, GIT_OBJECT_DIR_MODE)) < 0 ||
+		(error = lfs_transfer_open(&t, false)) < 0)
+		goto done;
+
+	for (attempt = 0; t.offset < dl->ptr.size && attempt < LFS_DOWNLOAD_ATTEMPTS; attempt++) {
+		git_buf_set(&headers, dl->headers.ptr, dl->headers.size);
+		if (t.offset > 0)
+			git_buf_printf(&headers, "Range: bytes=%" PRId64 "-\r\n", (int64_t)t.offset);
+
+		if (git_buf_oom(&headers)) {
+			error = -1;
+			goto done;
+		}
+
+		t.first = true;
+		status = lfs_http_request(http, "GET", dl->href, headers.ptr,
+			NULL, 0, lfs_transfer_body, &t);
+
+		/* our partial download does not fit what the server has */
+		if (status == 416) {
+			if ((error = lfs_transfer_open(&t, true)) < 0)
+				goto done;
+			continue;
+		}
+
+		/* what was received before a network error is kept */
+		if ((status >= 500 && status < 600) ||
+			(status < 0 && http->body_error == 0))
+			continue;
+
+		if (status < 0) {
+			error = status;
+			goto done;
+		}
+
+		if (status != 200 && status != 206)
+			break;
+	}
+
+	if (t.offset < dl->ptr.size) {
+		if (status >= 0)
+			giterr_set(GITERR_NET, "Cannot download large file %s (%d)", dl->ptr.oid, status);
+		error = -1;
+		goto done;
+	}
+
+	git_sha256_final_hex(oid, &t.ctx);
+	p_close(t.fd);
+	t.fd = -1;
+
+	if (strcmp(oid, dl->ptr.oid) != 0) {
+		giterr_set(GITERR_NET, "Downloaded content of large file %s does not match it", dl->ptr.oid);
+		p_unlink(dl->partial);
+		error = -1;
+		goto done;
+	}
+
+	if ((error = git_futils_mkpath2file(dl->path, GIT_OBJECT_DIR_MODE)) < 0)
+		goto done;
+
+	if ((error = p_rename(dl->partial, dl->path)) < 0)
+		giterr_set(GITERR_OS, "Failed to move '%s' into place", dl->partial);
+
+done:
+	if (t.fd >= 0)
+		p_close(t.fd);
+	git_buf_free(&headers);
+	return error;
+}
+
+static void lfs_download_finish(lfs_pool *pool, lfs_download *dl)
+{
+#ifdef GIT_THREADS
+	git_mutex_lock(&pool->lock);
+	dl->done = true;
+	git_cond_signal(&pool->done);
+	git_mutex_unlock(&pool->lock);
+#else
+	GIT_UNUSED(pool);
+	dl->done = true;
+#endif
+}
+
+static void lfs_download_wait(lfs_pool *pool, lfs_download *dl)
+{
+#ifdef GIT_THREADS
+	git_mutex_lock(&pool->lock);
+	while (!dl->done)
+		git_cond_wait(&pool->done, &pool->lock);
+	git_mutex_unlock(&pool->lock);
+#else
+	GIT_UNUSED(pool); GIT_UNUSED(dl);
+#endif
+}
+
+static void *lfs_download_worker(void *arg)
+{
+	lfs_pool *pool = arg;
+	lfs_http http;
+	size_t i;
+
+	lfs_http_init(&http);
+
+	while (!pool->cancel.val &&
+		(i = (size_t)git_atomic_inc(&pool->next) - 1) < pool->count) {
+		lfs_download *dl = &pool->downloads[i];
+
+		if (!dl->error && (dl->error = lfs_download_one(&http, dl)) < 0) {
+			const git_error *e = giterr_last();
+
+			dl->error_class = e ? e->klass : GITERR_NET;
+			dl->error_msg = git__strdup(e ? e->message : "download failed");
+			giterr_clear();
+		}
+
+		lfs_download_finish(pool, dl);
+	}
+
+	lfs_http_close(&http);
+	return NULL;
+}
+
+static int lfs_download_all(
+	lfs_pool *pool, unsigned int nr_threads, const git_lfs_fetch_options *opts)
+{
+	uint64_t received = 0;
+	size_t i;
+	int error = 0;
+
+#ifdef GIT_THREADS
+	git_thread *threads;
+	size_t spawned;
+
+	if (nr_threads > pool->count)
+		nr_threads = (unsigned int)pool->count;
+
+	threads = git__calloc(nr_threads, sizeof(git_thread));
+	GITERR_CHECK_ALLOC(threads);
+
+	git_mutex_init(&pool->lock);
+	git_cond_init(&pool->done);
+
+	for (spawned = 0; spawned < nr_threads; spawned++) {
+		if (git_thread_create(&threads[spawned], NULL, lfs_download_worker, pool) != 0)
+			break;
+	}
+
+	/* could not start any thread, do the work here */
+	if (!spawned)
+		lfs_download_worker(pool);
+#else
+	GIT_UNUSED(nr_threads);
+	lfs_download_worker(pool);
+#endif
+
+	for (i = 0; i < pool->count; i++) {
+		lfs_download *dl = &pool->downloads[i];
+
+		lfs_download_wait(pool, dl);
+
+		/* the other downloads go on, so that less is left for a retry */
+		if (dl->error < 0 && !error) {
+			error = dl->error;
+			giterr_set(dl->error_class, "%s", dl->error_msg);
+		}
+
+		received += (uint64_t)dl->ptr.size;
+
+		if (opts && opts->progress_cb && !error &&
+			opts->progress_cb(i + 1, pool->count, received, opts->progress_payload)) {
+			giterr_clear();
+			error = GIT_EUSER;
+		}
+
+		if (error == GIT_EUSER) {
+			git_atomic_set(&pool->cancel, 1);
+			break;
+		}
+	}
+
+#ifdef GIT_THREADS
+	git_atomic_set(&pool->cancel, 1);
+	for (i = 0; i < spawned; i++)
+		git_thread_join(&threads[i], NULL);
+
+	git_cond_free(&pool->done);
+	git_mutex_free(&pool->lock);
+	git__free(threads);
+#endif
+
+	return error;
+}
+
+static unsigned int lfs_transfers(git_repository *repo, const git_lfs_fetch_options *opts)
+{
+	git_config *cfg;
+	int32_t n;
+
+	if (opts && opts->parallel)
+		return opts->parallel;
+
+	if (!git_repository_config__weakptr(&cfg, repo) &&
+		!git_config_get_int32(&n, cfg, "lfs.concurrenttransfers") && n > 0)
+		return (unsigned int)n;
+
+	giterr_clear();
+	return GIT_LFS_DEFAULT_TRANSFERS;
+}
+
+int git_lfs__fetch(
+	git_repository *repo,
+	const git_lfs_pointer *objects,
+	size_t count,
+	const git_lfs_fetch_options *opts)
+{
+	git_buf endpoint = GIT_BUF_INIT, path = GIT_BUF_INIT;
+	lfs_pool pool;
+	lfs_http http;
+	size_t i, n;
+	int error;
+
+	GITERR_CHECK_VERSION(opts, GIT_LFS_FETCH_OPTIONS_VERSION, "git_lfs_fetch_options");
+
+	memset(&pool, 0, sizeof(pool));
+	lfs_http_init(&http);
+
+	if ((error = git_lfs__endpoint(&endpoint, repo)) < 0)
+		goto done;
+
+	pool.downloads = git__calloc(count, sizeof(lfs_download));
+	GITERR_CHECK_ALLOC(pool.downloads);
+
+	for (i = 0; i < count; i++) {
+		if (!git_lfs__has_object(repo, &objects[i]))
+			memcpy(&pool.downloads[pool.count++].ptr, &objects[i], sizeof(git_lfs_pointer));
+	}
+
+	/* each object is downloaded once, however many files it is in */
+	qsort(pool.downloads, pool.count, sizeof(lfs_download), lfs_download_cmp);
+	for (i = 0, n = 0; i < pool.count; i++) {
+		if (!n || strcmp(pool.downloads[n - 1].ptr.oid, pool.downloads[i].ptr.oid))
+			pool.downloads[n++] = pool.downloads[i];
+	}
+	pool.count = n;
+
+	for (i = 0; i < pool.count; i++) {
+		lfs_download *dl = &pool.downloads[i];
+
+		git_buf_clear(&path);
+		if ((error = git_lfs__object_path(&path, repo, dl->ptr.oid)) < 0 ||
+			(dl->path = git__strdup(path.ptr)) == NULL)
+			goto oom;
+
+		git_buf_clear(&path);
+		if ((error = git_buf_joinpath(&path, git_repository_path(repo), "lfs/incomplete")) < 0 ||
+			(error = git_buf_joinpath(&path, path.ptr, dl->ptr.oid)) < 0 ||
+			(dl->partial = git__strdup(path.ptr)) == NULL)
+			goto oom;
+	}
+
+	for (i = 0; i < pool.count; i += LFS_BATCH_SIZE) {
+		if ((error = lfs_batch(&http, endpoint.ptr, pool.downloads + i,
+				min(LFS_BATCH_SIZE, pool.count - i))) < 0)
+			goto done;
+	}
+
+	lfs_http_close(&http);
+
+	if (pool.count)
+		error = lfs_download_all(&pool, lfs_transfers(repo, opts), opts);
+
+	goto done;
+
+oom:
+	error = -1;
+	giterr_set_oom();
+
+done:
+	/* a missing object is an error, only a missing server is not */
+	if (error == GIT_ENOTFOUND && git_buf_len(&endpoint) > 0)
+		error = -1;
+
+	for (i = 0; i < pool.count; i++) {
+		git__free(pool.downloads[i].href);
+		git_buf_free(&pool.downloads[i].headers);
+		git__free(pool.downloads[i].path);
+		git__free(pool.downloads[i].partial);
+		git__free(pool.downloads[i].error_msg);
+	}
+	git__free(pool.downloads);
+
+	lfs_http_close(&http);
+	git_buf_free(&path);
+	git_buf_free(&endpoint);
+	return error;
+}
@@ -23,8 +23,48 @@
 size_t git_mwindow__window_size = DEFAULT_WINDOW_SIZE;
 size_t git_mwindow__mapped_limit = DEFAULT_MAPPED_LIMIT;
 
-/* Whenever you want to read or modify this, grab git__mwindow_mutex */
-static git_mwindow_ctl mem_ctl;
+git_mwindow_ctl git_mwindow__mem_ctl;
+
+/*
+ * Locking: each file's list of windows is protected by its own lock,
+ * taken before the global git__mwindow_mutex when both are needed.
+ * Using the window a cursor already points at takes no lock at all:
+ * the cursor's reference keeps the window mapped.  When over the
+ * mapped limit, the windows of other files are only considered if
+ * their lock is free.
+ */
+
+/*
+ * Read-modify-write rather than a plain load: it orders the last
+ * user's reads of the window before it is unmapped.
+ */
+GIT_INLINE(bool) window_unused(git_mwindow *w)
+{
+	return git_atomic_add(&w->inuse_cnt, 0) == 0;
+}
+
+int git_mwindow_file_init(git_mwindow_file *mwf)
+{
+#ifdef GIT_THREADS
+	if (git_mutex_init(&mwf->lock)) {
+		giterr_set(GITERR_OS, "Failed to initialize mwindow mutex");
+		return -1;
+	}
+#else
+	GIT_UNUSED(mwf);
+#endif
+
+	return 0;
+}
+
+void git_mwindow_file_free(git_mwindow_file *mwf)
+{
+#ifdef GIT_THREADS
+	git_mutex_free(&mwf->lock);
+#else
+	GIT_UNUSED(mwf);
+#endif
+}
 
 /*
  * Free all the windows in a sequence, typically because we're done
@@ -32,10 +72,16 @@ static git_mwindow_ctl mem_ctl;
  */
 void git_mwindow_free_all(git_mwindow_file *mwf)
 {
-	git_mwindow_ctl *ctl = &mem_ctl;
+	git_mwindow_ctl *ctl = &git_mwindow__mem_ctl;
 	size_t i;
 
+	if (git_mutex_lock(&mwf->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock mwindow file mutex");
+		return;
+	}
+
 	if (git_mutex_lock(&git__mwindow_mutex)) {
+		git_mutex_unlock(&mwf->lock);
 		giterr_set(GITERR_THREAD, "unable to lock mwindow mutex");
 		return;
 	}
@@ -57,7 +103,7 @@ void git_mwindow_free_all(git_mwindow_file *mwf)
 
 	while (mwf->windows) {
 		git_mwindow *w = mwf->windows;
-		assert(w->inuse_cnt == 0);
+		assert(window_unused(w));
 
 		ctl->mapped -= w->window_map.len;
 		ctl->open_windows--;
@@ -69,6 +115,7 @@ void git_mwindow_free_all(git_mwindow_file *mwf)
 	}
 
 	git_mutex_unlock(&git__mwindow_mutex);
+	git_mutex_unlock(&mwf->lock);
 }
 
 /*
@@ -92,7 +139,7 @@ static void git_mwindow_scan_lru(
 	git_mwindow *w, *w_l;
 
 	for (w_l = NULL, w = mwf->windows; w; w = w->next) {
-		if (!w->inuse_cnt) {
+		if (window_unused(w)) {
 			/*
 			 * If the current one is more recent than the last one,
 			 * store it in the output parameter. If lru_w is NULL,
@@ -109,25 +156,37 @@ static void git_mwindow_scan_lru(
 
 /*
  * Close the least recently used window. You should check to see if
- * the file descriptors need closing from time to time. Called under
- * lock from new_window.
+ * the file descriptors need closing from time to time. Called from
+ * new_window with the global lock and the lock of `mwf` held.
  */
 static int git_mwindow_close_lru(git_mwindow_file *mwf)
 {
-	git_mwindow_ctl *ctl = &mem_ctl;
+	git_mwindow_ctl *ctl = &git_mwindow__mem_ctl;
 	size_t i;
-	git_mwindow *lru_w = NULL, *lru_l = NULL, **list = &mwf->windows;
+	git_mwindow *lru_w = NULL, *lru_l = NULL;
+	git_mwindow_file *lru_f = NULL, *cur;
 
-	/* FIXME: Does this give us any advantage? */
-	if(mwf->windows)
-		git_mwindow_scan_lru(mwf, &lru_w, &lru_l);
+	git_mwindow_scan_lru(mwf, &lru_w, &lru_l);
+	if (lru_w)
+		lru_f = mwf;
 
-	for (i = 0; i < ctl->windowfiles.length; ++i) {
+	/* keep the file holding the best candidate so far locked */
+	git_vector_foreach(&ctl->windowfiles, i, cur) {
 		git_mwindow *last = lru_w;
-		git_mwindow_file *cur = git_vector_get(&ctl->windowfiles, i);
+
+		if (cur == mwf || git_mutex_trylock(&cur->lock))
+			continue;
+
 		git_mwindow_scan_lru(cur, &lru_w, &lru_l);
-		if (lru_w != last)
-			list = &cur->windows;
+
+		if (lru_w == last) {
+			git_mutex_unlock(&cur->lock);
+			continue;
+		}
+
+		if (lru_f && lru_f != mwf)
+			git_mutex_unlock(&lru_f->lock);
+		lru_f = cur;
 	}
 
 	if (!lru_w) {
@@ -141,7 +200,10 @@ static int git_mwindow_close_lru(git_mwindow_file *mwf)
 	if (lru_l)
 		lru_l->next = lru_w->next;
 	else
-		*list = lru_w->next;
+		lru_f->windows = lru_w->next;
+
+	if (lru_f != mwf)
+		git_mutex_unlock(&lru_f->lock);
 
 	git__free(lru_w);
 	ctl->open_windows--;
@@ -149,14 +211,14 @@ static int git_mwindow_close_lru(git_mwindow_file *mwf)
 	return 0;
 }
 
-/* This gets called under lock from git_mwindow_open */
+/* This gets called with the lock of `mwf` held from git_mwindow_open */
 static git_mwindow *new_window(
 	git_mwindow_file *mwf,
 	git_file fd,
 	git_off_t size,
 	git_off_t offset)
 {
-	git_mwindow_ctl *ctl = &mem_ctl;
+	git_mwindow_ctl *ctl = &git_mwindow__mem_ctl;
 	size_t walign = git_mwindow__window_size / 2;
 	git_off_t len;
 	git_mwindow *w;
@@ -167,11 +229,28 @@ static git_mwindow *new_window(
 		return NULL;
 
 	memset(w, 0x0, sizeof(*w));
-	w->offset = (offset / walign) * walign;
 
-	len = size - w->offset;
-	if (len > (git_off_t)git_mwindow__window_size)
-		len = (git_off_t)git_mwindow__window_size;
+	/*
+	 * With a 64-bit address space there is no reason to map a pack
+	 * in pieces when all of it fits under the limit; a single window
+	 * is never switched away from.
+	 */
+	if (sizeof(void *) >= 8 && size <= (git_off_t)git_mwindow__mapped_limit) {
+		w->offset = 0;
+		len = size;
+	} else {
+		w->offset = (offset / walign) * walign;
+
+		len = size - w->offset;
+		if (len > (git_off_t)git_mwindow__window_size)
+			len = (git_off_t)git_mwindow__window_size;
+	}
+
+	if (git_mutex_lock(&git__mwindow_mutex)) {
+		giterr_set(GITERR_THREAD, "unable to lock mwindow mutex");
+		git__free(w);
+		return NULL;
+	}
 
 	ctl->mapped += (size_t)len;
 
@@ -185,6 +264,8 @@ static git_mwindow *new_window(
 	 */
 
 	if (git_futils_mmap_ro(&w->window_map, fd, w->offset, (size_t)len) < 0) {
+		ctl->mapped -= (size_t)len;
+		git_mutex_unlock(&git__mwindow_mutex);
 		git__free(w);
 		return NULL;
 	}
@@ -198,6 +279,8 @@ static git_mwindow *new_window(
 	if (ctl->open_windows > ctl->peak_open_windows)
 		ctl->peak_open_windows = ctl->open_windows;
 
+	git_mutex_unlock(&git__mwindow_mutex);
+
 	return w;
 }
 
@@ -212,17 +295,18 @@ unsigned char *git_mwindow_open(
 	size_t extra,
 	unsigned int *left)
 {
-	git_mwindow_ctl *ctl = &mem_ctl;
+	git_mwindow_ctl *ctl = &git_mwindow__mem_ctl;
 	git_mwindow *w = *cursor;
 
-	if (git_mutex_lock(&git__mwindow_mutex)) {
-		giterr_set(GITERR_THREAD, "unable to lock mwindow mutex");
-		return NULL;
-	}
-
 	if (!w || !(git_mwindow_contains(w, offset) && git_mwindow_contains(w, offset + extra))) {
+		if (git_mutex_lock(&mwf->lock)) {
+			giterr_set(GITERR_THREAD, "unable to lock mwindow file mutex");
+			return NULL;
+		}
+
 		if (w) {
-			w->inuse_cnt--;
+			git_atomic_dec(&w->inuse_cnt);
+			*cursor = NULL;
 		}
 
 		for (w = mwf->windows; w; w = w->next) {
@@ -238,33 +322,34 @@ unsigned char *git_mwindow_open(
 		if (!w) {
 			w = new_window(mwf, mwf->fd, mwf->size, offset);
 			if (w == NULL) {
-				git_mutex_unlock(&git__mwindow_mutex);
+				git_mutex_unlock(&mwf->lock);
 				return NULL;
 			}
 			w->next = mwf->windows;
 			mwf->windows = w;
 		}
-	}
 
-	/* If we changed w, store it in the cursor */
-	if (w != *cursor) {
-		w->last_used = ctl->used_ctr++;
-		w->inuse_cnt++;
+		/* Store the new window in the cursor */
+		w->last_used = (size_t)git_atomic_ssize_add(&ctl->used_ctr, 1);
+		git_atomic_inc(&w->inuse_cnt);
 		*cursor = w;
+
+		git_mutex_unlock(&mwf->lock);
 	}
 
 	offset -= w->offset;
 
-	if (left)
-		*left = (unsigned int)(w->window_map.len - offset);
+	if (left) {
+		git_off_t avail = (git_off_t)w->window_map.len - offset;
+		*left = avail > UINT_MAX ? UINT_MAX : (unsigned int)avail;
+	}
 
-	git_mutex_unlock(&git__mwindow_mutex);
 	return (unsigned char *) w->window_map.data + offset;
 }
 
 int git_mwindow_file_register(git_mwindow_file *mwf)
 {
-	git_mwindow_ctl *ctl = &mem_ctl;
+	git_mwindow_ctl *ctl = &git_mwindow__mem_ctl;
 	int ret;
 
 	if (git_mutex_lock(&git__mwindow_mutex)) {
@@ -286,7 +371,7 @@ int git_mwindow_file_register(git_mwindow_file *mwf)
 
 void git_mwindow_file_deregister(git_mwindow_file *mwf)
 {
-	git_mwindow_ctl *ctl = &mem_ctl;
+	git_mwindow_ctl *ctl = &git_mwindow__mem_ctl;
 	git_mwindow_file *cur;
 	size_t i;
 
@@ -307,13 +392,7 @@ void git_mwindow_close(git_mwindow **window)
 {
 	git_mwindow *w = *window;
 	if (w) {
-		if (git_mutex_lock(&git__mwindow_mutex)) {
-			giterr_set(GITERR_THREAD, "unable to lock mwindow mutex");
-			return;
-		}
-
-		w->inuse_cnt--;
-		git_mutex_unlock(&git__mwindow_mutex);
+		git_atomic_dec(&w->inuse_cnt);
 		*window = NULL;
 	}
 }
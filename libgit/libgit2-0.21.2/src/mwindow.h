@@ -16,10 +16,11 @@ typedef struct git_mwindow {
 	git_map window_map;
 	git_off_t offset;
 	size_t last_used;
-	size_t inuse_cnt;
+	git_atomic inuse_cnt; /* cursors pointing at the window */
 } git_mwindow;
 
 typedef struct git_mwindow_file {
+	git_mutex lock; /* protects the list of windows */
 	git_mwindow *windows;
 	int fd;
 	git_off_t size;
@@ -31,13 +32,18 @@ typedef struct git_mwindow_ctl {
 	unsigned int mmap_calls;
 	unsigned int peak_open_windows;
 	size_t peak_mapped;
-	size_t used_ctr;
+	git_atomic_ssize used_ctr;
 	git_vector windowfiles;
 } git_mwindow_ctl;
 
+/* Whenever you want to read or modify this, grab git__mwindow_mutex */
+extern git_mwindow_ctl git_mwindow__mem_ctl;
+
 int git_mwindow_contains(git_mwindow *win, git_off_t offset);
 void git_mwindow_free_all(git_mwindow_file *mwf);
 unsigned char *git_mwindow_open(git_mwindow_file *mwf, git_mwindow **cursor, git_off_t offset, size_t extra, unsigned int *left);
+int git_mwindow_file_init(git_mwindow_file *mwf);
+void git_mwindow_file_free(git_mwindow_file *mwf);
 int git_mwindow_file_register(git_mwindow_file *mwf);
 void git_mwindow_file_deregister(git_mwindow_file *mwf);
 void git_mwindow_close(git_mwindow **w_cursor);
@@ -0,0 +1,1042 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "common.h"
+#include <zlib.h>
+#include "git2/sys/odb_backend.h"
+#include "fileops.h"
+#include "hash.h"
+#include "odb.h"
+#include "pack.h"
+#include "indexer.h"
+#include "thread-utils.h"
+
+#include "git2/odb_backend.h"
+
+/* Stop accepting objects while this much data waits for a thread */
+#define BULK_MAX_QUEUED (64 * 1024 * 1024)
+
+/*
+ * Objects are appended to a temporary packfile as whole (undeltified)
+ * entries, in whatever order they finish compressing. The header only
+ * gets its object count, and the pack its trailer, on commit; this is
+ * what git fast-import does as well.
+ */
+typedef struct {
+	struct git_indexer_entry entry; /* first, so the list sorts as entries */
+	git_otype type;
+	size_t size;
+	git_off_t offset; /* -1 until the object is in the pack */
+	size_t hdr_len;
+	size_t packed_len;
+} bulk_object;
+
+typedef struct bulk_job {
+	struct bulk_job *next;
+	bulk_object *obj;
+	void *data;
+} bulk_job;
+
+typedef struct {
+	git_odb_backend parent;
+
+	git_mutex lock;
+	git_cond job_cond; /* a job was queued, or the threads must stop */
+	git_cond done_cond; /* an object made it into the pack (or failed) */
+
+	git_oidmap *objects;
+	git_vector list;
+	size_t nr_pending;
+	size_t queued_bytes;
+	bulk_job *queue, *queue_tail;
+
+	git_buf pack_path;
+	git_file fd;
+	git_off_t pack_size;
+
+	int error;
+	char *error_msg;
+
+	int compression_level;
+	unsigned int nr_threads;
+	git_thread *threads;
+	unsigned int done :1,
+		stopping :1;
+
+	char objects_dir[GIT_FLEX_ARRAY];
+} bulk_backend;
+
+typedef struct {
+	git_odb_stream stream;
+	char *buffer;
+	size_t size, written;
+	git_otype type;
+} bulk_writestream;
+
+/* Remember the first failure, as `giterr_last` is per thread */
+static void bulk_set_error(bulk_backend *b, int error)
+{
+	const git_error *e = giterr_last();
+
+	if (b->error)
+		return;
+
+	b->error = error;
+	b->error_msg = git__strdup(e ? e->message : "failed to write object into bulk pack");
+}
+
+static int bulk_error(bulk_backend *b)
+{
+	giterr_set(GITERR_ODB, "%s", b->error_msg ? b->error_msg : "bulk pack failed");
+	return b->error;
+}
+
+static void bulk_set_options(bulk_backend *b, const git_odb_bulk_options *opts)
+{
+	b->compression_level = Z_DEFAULT_COMPRESSION;
+	b->nr_threads = 0;
+
+	if (opts) {
+		if (opts->compression_level >= 0)
+			b->compression_level = opts->compression_level;
+		b->nr_threads = opts->threads;
+	}
+}
+
+/* Build the pack entry for an object: its header, then the deflated data */
+static int bulk_deflate(git_buf *out, bulk_backend *b, bulk_object *obj, const void *data)
+{
+	unsigned char hdr[10];
+	uLongf zlen;
+	int zerr;
+
+	if ((uLong)obj->size != obj->size) {
+		giterr_set(GITERR_ODB, "object is too large for the bulk pack");
+		return -1;
+	}
+
+	obj->hdr_len = git_packfile__object_header(hdr, obj->size, obj->type);
+	zlen = compressBound((uLong)obj->size);
+
+	git_buf_clear(out);
+	if (git_buf_grow(out, obj->hdr_len + zlen) < 0)
+		return -1;
+
+	memcpy(out->ptr, hdr, obj->hdr_len);
+	zerr = compress2((Bytef *)out->ptr + obj->hdr_len, &zlen,
+		data, (uLong)obj->size, b->compression_level);
+
+	if (zerr != Z_OK) {
+		if (zerr == Z_MEM_ERROR)
+			giterr_set_oom();
+		else
+			giterr_set(GITERR_ZLIB, "failed to deflate object");
+		return -1;
+	}
+
+	out->size = obj->hdr_len + zlen;
+	obj->entry.crc = htonl(crc32(crc32(0L, Z_NULL, 0),
+		(const Bytef *)out->ptr, (uInt)out->size));
+
+	return 0;
+}
+
+/* Append a deflated entry; called with the lock held */
+static int bulk_append(bulk_backend *b, bulk_object *obj, const git_buf *packed)
+{
+	struct git_pack_header hdr;
+	git_buf path = GIT_BUF_INIT;
+
+	if (b->fd < 0) {
+		if (git_buf_joinpath(&path, b->objects_dir, "pack/pack_bulk") < 0)
+			return -1;
+
+		b->fd = git_futils_mktmp(&b->pack_path, path.ptr, GIT_PACK_FILE_MODE);
+		git_buf_free(&path);
+
+		if (b->fd < 0)
+			return -1;
+
+		/* the object count is filled in by commit */
+		hdr.hdr_signature = htonl(PACK_SIGNATURE);
+		hdr.hdr_version = htonl(PACK_VERSION);
+		hdr.hdr_entries = 0;
+
+		if (p_write(b->fd, &hdr, sizeof(hdr)) < 0) {
+			giterr_set(GITERR_OS, "failed to write pack header");
+			return -1;
+		}
+
+		b->pack_size = sizeof(hdr);
+	}
+
+	if (p_lseek(b->fd, b->pack_size, SEEK_SET) < 0 ||
+		p_write(b->fd, packed->ptr, packed->size) < 0) {
+		giterr_set(GITERR_OS, "failed to write to '%s'", b->pack_path.ptr);
+		return -1;
+	}
+
+	if (b->pack_size > UINT31_MAX) {
+		obj->entry.offset = UINT32_MAX;
+		obj->entry.offset_long = b->pack_size;
+	} else {
+		obj->entry.offset = (uint32_t)b->pack_size;
+	}
+
+	obj->offset = b->pack_size;
+	obj->packed_len = packed->size;
+	b->pack_size += packed->size;
+
+	return 0;
+}
+
+/*
+ * Deflate an object outside of the lock and append it; the lock is held
+ * on return unless it could not be taken again.
+ */
+static int bulk_pack_object(bulk_backend *b, bulk_object *obj, const void *data, git_buf *packed)
+{
+	int error;
+
+	git_mutex_unlock(&b->lock);
+	error = bulk_deflate(packed, b, obj, data);
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+
+	if (!error)
+		error = bulk_append(b, obj, packed);
+
+	if (error < 0)
+		bulk_set_error(b, error);
+
+	b->nr_pending--;
+	git_cond_broadcast(&b->done_cond);
+	return 0;
+}
+
+#ifdef GIT_THREADS
+
+static void *bulk_thread(void *arg)
+{
+	bulk_backend *b = arg;
+	git_buf packed = GIT_BUF_INIT;
+	bulk_job *job;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return NULL;
+	}
+
+	for (;;) {
+		while (!b->queue && !b->stopping)
+			git_cond_wait(&b->job_cond, &b->lock);
+
+		if ((job = b->queue) == NULL)
+			break;
+
+		if ((b->queue = job->next) == NULL)
+			b->queue_tail = NULL;
+
+		if (bulk_pack_object(b, job->obj, job->data, &packed) < 0) {
+			git__free(job->data);
+			git__free(job);
+			goto done;
+		}
+
+		/* writers may be waiting for room in the queue */
+		b->queued_bytes -= job->obj->size;
+		git_cond_broadcast(&b->done_cond);
+
+		git__free(job->data);
+		git__free(job);
+	}
+
+	git_mutex_unlock(&b->lock);
+done:
+	git_buf_free(&packed);
+
+	return NULL;
+}
+
+static int bulk_start_threads(bulk_backend *b)
+{
+	unsigned int i;
+
+	b->threads = git__calloc(b->nr_threads, sizeof(git_thread));
+	GITERR_CHECK_ALLOC(b->threads);
+
+	for (i = 0; i < b->nr_threads; ++i) {
+		if (git_thread_create(&b->threads[i], NULL, bulk_thread, b) != 0) {
+			giterr_set(GITERR_THREAD, "unable to create bulk pack thread");
+			b->nr_threads = i;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+#endif
+
+/* Wait until nothing is queued or compressing; called with the lock held */
+static void bulk_drain(bulk_backend *b)
+{
+	while (b->nr_pending > 0)
+		git_cond_wait(&b->done_cond, &b->lock);
+}
+
+/*
+ * Stop accepting objects and let the threads finish; called with the lock
+ * held, which is still held on return unless it could not be taken again.
+ */
+static int bulk_stop(bulk_backend *b)
+{
+#ifdef GIT_THREADS
+	unsigned int i;
+#endif
+
+	b->done = 1;
+	bulk_drain(b);
+
+#ifdef GIT_THREADS
+	if (b->threads) {
+		b->stopping = 1;
+		git_cond_broadcast(&b->job_cond);
+		git_mutex_unlock(&b->lock);
+
+		for (i = 0; i < b->nr_threads; ++i)
+			git_thread_join(&b->threads[i], NULL);
+
+		if (git_mutex_lock(&b->lock)) {
+			giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+			return -1;
+		}
+		git__free(b->threads);
+		b->threads = NULL;
+	}
+#endif
+
+	return 0;
+}
+
+static void bulk_clear(bulk_backend *b)
+{
+	bulk_object *obj;
+	size_t i;
+
+	if (b->fd >= 0) {
+		p_close(b->fd);
+		b->fd = -1;
+	}
+
+	if (b->pack_path.size) {
+		p_unlink(b->pack_path.ptr);
+		git_buf_free(&b->pack_path);
+	}
+
+	git_vector_foreach(&b->list, i, obj)
+		git__free(obj);
+	git_vector_clear(&b->list);
+
+	git_oidmap_free(b->objects);
+}
+
+/*
+ * Add an object to the pack. `owned`, if given, is a copy of `data`
+ * which is taken over.
+ */
+static int bulk_add(
+	bulk_backend *b,
+	const git_oid *oid,
+	const void *data,
+	size_t len,
+	git_otype type,
+	void *owned)
+{
+	git_buf packed = GIT_BUF_INIT;
+	bulk_object *obj = NULL;
+	khiter_t pos;
+	int error = 0;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		error = -1;
+		goto done;
+	}
+
+	if (b->done) {
+		error = GIT_PASSTHROUGH;
+		goto unlock;
+	}
+
+	if (b->error) {
+		error = bulk_error(b);
+		goto unlock;
+	}
+
+	pos = kh_get(oid, b->objects, oid);
+	if (pos != kh_end(b->objects))
+		goto unlock;
+
+	obj = git__calloc(1, sizeof(bulk_object));
+	if (!obj || git_vector_insert(&b->list, obj) < 0) {
+		git__free(obj);
+		error = -1;
+		goto unlock;
+	}
+
+	git_oid_cpy(&obj->entry.oid, oid);
+	obj->type = type;
+	obj->size = len;
+	obj->offset = -1;
+
+	pos = kh_put(oid, b->objects, &obj->entry.oid, &error);
+	if (error < 0) {
+		giterr_set_oom();
+		goto unlock;
+	}
+	kh_val(b->objects, pos) = obj;
+	error = 0;
+
+	b->nr_pending++;
+
+#ifdef GIT_THREADS
+	if (b->threads) {
+		bulk_job *job = git__calloc(1, sizeof(bulk_job));
+
+		if (job && !owned && (owned = git__malloc(len ? len : 1)) != NULL)
+			memcpy(owned, data, len);
+
+		if (!job || !owned) {
+			git__free(job);
+			bulk_set_error(b, -1);
+			b->nr_pending--;
+			error = -1;
+			goto unlock;
+		}
+
+		job->obj = obj;
+		job->data = owned;
+		owned = NULL;
+
+		/* bound the memory held by data waiting for a thread */
+		while (b->queued_bytes > 0 && b->queued_bytes + len > BULK_MAX_QUEUED)
+			git_cond_wait(&b->done_cond, &b->lock);
+
+		b->queued_bytes += len;
+
+		if (b->queue_tail)
+			b->queue_tail->next = job;
+		else
+			b->queue = job;
+		b->queue_tail = job;
+
+		git_cond_signal(&b->job_cond);
+		goto unlock;
+	}
+#endif
+
+	if (bulk_pack_object(b, obj, data, &packed) < 0) {
+		error = -1;
+		goto done;
+	}
+
+	if (b->error)
+		error = bulk_error(b);
+
+unlock:
+	git_mutex_unlock(&b->lock);
+done:
+	git_buf_free(&packed);
+	git__free(owned);
+	return error;
+}
+
+/* Find an object by id or unique prefix; called with the lock held */
+static int bulk_lookup(bulk_object **out, bulk_backend *b, const git_oid *short_id, size_t len)
+{
+	bulk_object *obj, *found = NULL;
+	khiter_t pos;
+	size_t i;
+
+	if (b->done)
+		return GIT_ENOTFOUND;
+
+	if (len >= GIT_OID_HEXSZ) {
+		pos = kh_get(oid, b->objects, short_id);
+		if (pos == kh_end(b->objects))
+			return GIT_ENOTFOUND;
+
+		*out = kh_val(b->objects, pos);
+		return 0;
+	}
+
+	git_vector_foreach(&b->list, i, obj) {
+		if (git_oid_ncmp(short_id, &obj->entry.oid, len))
+			continue;
+
+		if (found)
+			return git_odb__error_ambiguous("multiple matches in bulk pack");
+		found = obj;
+	}
+
+	if (!found)
+		return GIT_ENOTFOUND;
+
+	*out = found;
+	return 0;
+}
+
+static int bulk_read(
+	void **buffer_p,
+	size_t *len_p,
+	git_otype *type_p,
+	git_oid *out_oid,
+	bulk_backend *b,
+	const git_oid *short_id,
+	size_t short_len)
+{
+	bulk_object *obj;
+	unsigned char *packed = NULL;
+	void *data = NULL;
+	uLongf len;
+	int error;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+
+	if ((error = bulk_lookup(&obj, b, short_id, short_len)) < 0) {
+		git_mutex_unlock(&b->lock);
+		if (error == GIT_ENOTFOUND)
+			return git_odb__error_notfound("no matching object in bulk pack", short_id);
+		return error;
+	}
+
+	/* it may still be waiting for a thread */
+	while (obj->offset < 0 && !b->error)
+		git_cond_wait(&b->done_cond, &b->lock);
+
+	if (obj->offset < 0) {
+		error = bulk_error(b);
+		git_mutex_unlock(&b->lock);
+		return error;
+	}
+
+	packed = git__malloc(obj->packed_len);
+	if (!packed) {
+		git_mutex_unlock(&b->lock);
+		return -1;
+	}
+
+	if (p_lseek(b->fd, obj->offset, SEEK_SET) < 0 ||
+		p_read(b->fd, packed, obj->packed_len) != (ssize_t)obj->packed_len) {
+		git_mutex_unlock(&b->lock);
+		giterr_set(GITERR_OS, "failed to read from '%s'", b->pack_path.ptr);
+		error = -1;
+		goto done;
+	}
+
+	git_mutex_unlock(&b->lock);
+
+	data = git_odb_backend_malloc(&b->parent, obj->size + 1);
+	if (!data) {
+		error = -1;
+		goto done;
+	}
+
+	len = (uLongf)obj->size;
+	if (uncompress(data, &len, packed + obj->hdr_len,
+			(uLong)(obj->packed_len - obj->hdr_len)) != Z_OK ||
+		len != obj->size) {
+		giterr_set(GITERR_ZLIB, "bulk pack entry is corrupt");
+		git__free(data);
+		error = -1;
+		goto done;
+	}
+
+	((char *)data)[obj->size] = '\0';
+
+	*buffer_p = data;
+	*len_p = obj->size;
+	*type_p = obj->type;
+
+	if (out_oid)
+		git_oid_cpy(out_oid, &obj->entry.oid);
+
+done:
+	git__free(packed);
+	return error;
+}
+
+static int bulk_backend__read(
+	void **buffer_p,
+	size_t *len_p,
+	git_otype *type_p,
+	git_odb_backend *_backend,
+	const git_oid *oid)
+{
+	return bulk_read(buffer_p, len_p, type_p, NULL,
+		(bulk_backend *)_backend, oid, GIT_OID_HEXSZ);
+}
+
+static int bulk_backend__read_prefix(
+	git_oid *out_oid,
+	void **buffer_p,
+	size_t *len_p,
+	git_otype *type_p,
+	git_odb_backend *_backend,
+	const git_oid *short_oid,
+	size_t len)
+{
+	return bulk_read(buffer_p, len_p, type_p, out_oid,
+		(bulk_backend *)_backend, short_oid, len);
+}
+
+static int bulk_backend__read_header(
+	size_t *len_p,
+	git_otype *type_p,
+	git_odb_backend *_backend,
+	const git_oid *oid)
+{
+	bulk_backend *b = (bulk_backend *)_backend;
+	bulk_object *obj;
+	int error;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+
+	if ((error = bulk_lookup(&obj, b, oid, GIT_OID_HEXSZ)) == 0) {
+		*len_p = obj->size;
+		*type_p = obj->type;
+	}
+
+	git_mutex_unlock(&b->lock);
+
+	if (error == GIT_ENOTFOUND)
+		return git_odb__error_notfound("no matching object in bulk pack", oid);
+	return error;
+}
+
+static int bulk_backend__exists(git_odb_backend *_backend, const git_oid *oid)
+{
+	bulk_backend *b = (bulk_backend *)_backend;
+	bulk_object *obj;
+	int error;
+
+	if (git_mutex_lock(&b->lock))
+		return 0;
+
+	error = bulk_lookup(&obj, b, oid, GIT_OID_HEXSZ);
+
+	git_mutex_unlock(&b->lock);
+	return error == 0;
+}
+
+static int bulk_backend__exists_prefix(
+	git_oid *out,
+	git_odb_backend *_backend,
+	const git_oid *short_id,
+	size_t len)
+{
+	bulk_backend *b = (bulk_backend *)_backend;
+	bulk_object *obj;
+	int error;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+
+	if ((error = bulk_lookup(&obj, b, short_id, len)) == 0)
+		git_oid_cpy(out, &obj->entry.oid);
+
+	git_mutex_unlock(&b->lock);
+
+	if (error == GIT_ENOTFOUND)
+		return git_odb__error_notfound("no matching object in bulk pack", short_id);
+	return error;
+}
+
+static int bulk_backend__write(
+	git_odb_backend *_backend,
+	const git_oid *oid,
+	const void *data,
+	size_t len,
+	git_otype type)
+{
+	return bulk_add((bulk_backend *)_backend, oid, data, len, type, NULL);
+}
+
+static int bulk_writestream__write(git_odb_stream *_stream, const char *data, size_t len)
+{
+	bulk_writestream *stream = (bulk_writestream *)_stream;
+
+	if (stream->written + len > stream->size)
+		return -1;
+
+	memcpy(stream->buffer + stream->written, data, len);
+	stream->written += len;
+	return 0;
+}
+
+static int bulk_writestream__finalize_write(git_odb_stream *_stream, const git_oid *oid)
+{
+	bulk_writestream *stream = (bulk_writestream *)_stream;
+	char *buffer = stream->buffer;
+
+	stream->buffer = NULL;
+	return bulk_add((bulk_backend *)_stream->backend,
+		oid, buffer, stream->size, stream->type, buffer);
+}
+
+static void bulk_writestream__free(git_odb_stream *_stream)
+{
+	bulk_writestream *stream = (bulk_writestream *)_stream;
+
+	git__free(stream->buffer);
+	git__free(stream);
+}
+
+static int bulk_backend__writestream(
+	git_odb_stream **stream_out,
+	git_odb_backend *_backend,
+	size_t length,
+	git_otype type)
+{
+	bulk_backend *b = (bulk_backend *)_backend;
+	bulk_writestream *stream;
+	bool done;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+	done = b->done;
+	git_mutex_unlock(&b->lock);
+
+	if (done)
+		return GIT_PASSTHROUGH;
+
+	stream = git__calloc(1, sizeof(bulk_writestream));
+	GITERR_CHECK_ALLOC(stream);
+
+	stream->size = length;
+	stream->type = type;
+	stream->buffer = git__malloc(length ? length : 1);
+	if (stream->buffer == NULL) {
+		git__free(stream);
+		return -1;
+	}
+
+	stream->stream.backend = _backend;
+	stream->stream.read = NULL; /* read only */
+	stream->stream.write = &bulk_writestream__write;
+	stream->stream.finalize_write = &bulk_writestream__finalize_write;
+	stream->stream.free = &bulk_writestream__free;
+	stream->stream.mode = GIT_STREAM_WRONLY;
+
+	*stream_out = (git_odb_stream *)stream;
+	return 0;
+}
+
+static void bulk_backend__free(git_odb_backend *_backend)
+{
+	bulk_backend *b = (bulk_backend *)_backend;
+
+	git_odb_bulk_discard(_backend);
+
+	git__free(b->error_msg);
+	git_vector_free(&b->list);
+	git_cond_free(&b->done_cond);
+	git_cond_free(&b->job_cond);
+	git_mutex_free(&b->lock);
+	git__free(b);
+}
+
+static bool is_bulk_backend(git_odb_backend *backend)
+{
+	if (backend->free == &bulk_backend__free)
+		return true;
+
+	giterr_set(GITERR_INVALID, "not a bulk pack backend");
+	return false;
+}
+
+/* Fill in the object count and append the trailer */
+static int bulk_finish_pack(git_oid *trailer, bulk_backend *b)
+{
+	struct git_pack_header hdr;
+	git_hash_ctx ctx;
+	char buf[64 * 1024];
+	git_off_t hashed = 0;
+	int read = 0, error = -1;
+
+	hdr.hdr_signature = htonl(PACK_SIGNATURE);
+	hdr.hdr_version = htonl(PACK_VERSION);
+	hdr.hdr_entries = htonl((uint32_t)b->list.length);
+
+	if (git_hash_ctx_init(&ctx) < 0)
+		return -1;
+
+	if (p_lseek(b->fd, 0, SEEK_SET) < 0 ||
+		p_write(b->fd, &hdr, sizeof(hdr)) < 0 ||
+		p_lseek(b->fd, 0, SEEK_SET) < 0)
+		goto on_error;
+
+	while (hashed < b->pack_size &&
+		(read = p_read(b->fd, buf, sizeof(buf))) > 0) {
+		git_hash_update(&ctx, buf, read);
+		hashed += read;
+	}
+
+	if (read < 0 || hashed != b->pack_size)
+		goto on_error;
+
+	git_hash_final(trailer, &ctx);
+
+	if (p_write(b->fd, trailer->id, GIT_OID_RAWSZ) < 0)
+		goto on_error;
+
+	error = 0;
+
+on_error:
+	if (error < 0)
+		giterr_set(GITERR_OS, "failed to finish '%s'", b->pack_path.ptr);
+
+	git_hash_ctx_cleanup(&ctx);
+	return error;
+}
+
+/* Name the pack after its objects, next to the other packs */
+static int bulk_pack_path(git_buf *out, bulk_backend *b, const git_oid *name, const char *ext)
+{
+	char hex[GIT_OID_HEXSZ + 1];
+
+	git_oid_tostr(hex, sizeof(hex), name);
+
+	git_buf_clear(out);
+	git_buf_printf(out, "%spack/pack-%s%s", b->objects_dir, hex, ext);
+
+	return git_buf_oom(out) ? -1 : 0;
+}
+
+int git_odb_bulk_commit(git_oid *out, git_odb_backend *backend)
+{
+	bulk_backend *b = (bulk_backend *)backend;
+	git_filebuf index_file = GIT_FILEBUF_INIT;
+	git_buf path = GIT_BUF_INIT;
+	git_oid trailer, name;
+	int error = 0;
+
+	assert(backend);
+
+	if (!is_bulk_backend(backend))
+		return -1;
+
+	if (out)
+		memset(out, 0, sizeof(git_oid));
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+
+	if (b->done && !b->objects) {
+		giterr_set(GITERR_INVALID, "bulk pack was already committed or discarded");
+		error = -1;
+		goto done;
+	}
+
+	if (bulk_stop(b) < 0)
+		return -1;
+
+	if (b->error) {
+		error = bulk_error(b);
+		goto done;
+	}
+
+	if (b->list.length == 0)
+		goto done;
+
+	git_vector_sort(&b->list);
+
+	if ((error = bulk_finish_pack(&trailer, b)) < 0 ||
+		(error = git_buf_printf(&path, "%s.idx", b->pack_path.ptr)) < 0 ||
+		(error = git_filebuf_open(&index_file, path.ptr,
+			GIT_FILEBUF_HASH_CONTENTS, GIT_PACK_FILE_MODE)) < 0 ||
+		(error = git_indexer__write_index(
+			&index_file, &name, &b->list, &trailer)) < 0)
+		goto done;
+
+	p_close(b->fd);
+	b->fd = -1;
+
+	/* the pack goes first, as the pack backend looks for indexes */
+	if ((error = bulk_pack_path(&path, b, &name, ".pack")) < 0)
+		goto done;
+
+	if ((error = p_rename(b->pack_path.ptr, path.ptr)) < 0) {
+		giterr_set(GITERR_OS, "failed to rename '%s'", b->pack_path.ptr);
+		goto done;
+	}
+	git_buf_free(&b->pack_path);
+
+	if ((error = bulk_pack_path(&path, b, &name, ".idx")) < 0 ||
+		(error = git_filebuf_commit_at(&index_file, path.ptr)) < 0)
+		goto done;
+
+	if (out)
+		git_oid_cpy(out, &name);
+
+done:
+	git_filebuf_cleanup(&index_file);
+	git_buf_free(&path);
+
+	if (b->done)
+		bulk_clear(b);
+
+	git_mutex_unlock(&b->lock);
+
+	/* make the new pack visible to the pack backend */
+	if (!error && backend->odb)
+		error = git_odb_refresh(backend->odb);
+
+	return error;
+}
+
+void git_odb_bulk_discard(git_odb_backend *backend)
+{
+	bulk_backend *b = (bulk_backend *)backend;
+
+	if (backend == NULL || !is_bulk_backend(backend))
+		return;
+
+	if (git_mutex_lock(&b->lock))
+		return;
+
+	if (b->objects) {
+		if (bulk_stop(b) < 0)
+			return;
+		bulk_clear(b);
+	}
+
+	git_mutex_unlock(&b->lock);
+}
+
+int git_odb_bulk_restart(git_odb_backend *backend, const git_odb_bulk_options *opts)
+{
+	bulk_backend *b = (bulk_backend *)backend;
+	int error = 0;
+
+	assert(backend);
+
+	GITERR_CHECK_VERSION(opts, GIT_ODB_BULK_OPTIONS_VERSION, "git_odb_bulk_options");
+
+	if (!is_bulk_backend(backend))
+		return -1;
+
+	if (git_mutex_lock(&b->lock)) {
+		giterr_set(GITERR_THREAD, "unable to lock bulk pack");
+		return -1;
+	}
+
+	if (b->objects) {
+		giterr_set(GITERR_INVALID, "bulk pack import is still in progress");
+		error = -1;
+		goto done;
+	}
+
+	if ((b->objects = git_oidmap_alloc()) == NULL) {
+		giterr_set_oom();
+		error = -1;
+		goto done;
+	}
+
+	bulk_set_options(b, opts);
+
+	git__free(b->error_msg);
+	b->error_msg = NULL;
+	b->error = 0;
+	b->pack_size = 0;
+	b->queued_bytes = 0;
+	b->stopping = 0;
+	b->done = 0;
+
+#ifdef GIT_THREADS
+	if (b->nr_threads > 1 && (error = bulk_start_threads(b)) < 0) {
+		if (bulk_stop(b) < 0)
+			return -1;
+		bulk_clear(b);
+	}
+#endif
+
+done:
+	git_mutex_unlock(&b->lock);
+	return error;
+}
+
+int git_odb_backend_bulk(
+	git_odb_backend **out,
+	const char *objects_dir,
+	const git_odb_bulk_options *opts)
+{
+	bulk_backend *backend;
+	size_t objects_dirlen;
+
+	assert(out && objects_dir);
+
+	GITERR_CHECK_VERSION(opts, GIT_ODB_BULK_OPTIONS_VERSION, "git_odb_bulk_options");
+
+	objects_dirlen = strlen(objects_dir);
+
+	backend = git__calloc(1, sizeof(bulk_backend) + objects_dirlen + 2);
+	GITERR_CHECK_ALLOC(backend);
+
+	backend->parent.version = GIT_ODB_BACKEND_VERSION;
+	memcpy(backend->objects_dir, objects_dir, objects_dirlen);
+	if (objects_dirlen && objects_dir[objects_dirlen - 1] != '/')
+		backend->objects_dir[objects_dirlen] = '/';
+
+	backend->fd = -1;
+	bulk_set_options(backend, opts);
+
+	if (git_mutex_init(&backend->lock) < 0 ||
+		git_vector_init(&backend->list, 0, git_indexer__entry_cmp) < 0 ||
+		(backend->objects = git_oidmap_alloc()) == NULL) {
+		git_vector_free(&backend->list);
+		git__free(backend);
+		return -1;
+	}
+
+#ifdef GIT_THREADS
+	git_cond_init(&backend->job_cond);
+	git_cond_init(&backend->done_cond);
+
+	if (backend->nr_threads > 1 && bulk_start_threads(backend) < 0) {
+		bulk_backend__free((git_odb_backend *)backend);
+		return -1;
+	}
+#endif
+
+	backend->parent.read = &bulk_backend__read;
+	backend->parent.read_prefix = &bulk_backend__read_prefix;
+	backend->parent.read_header = &bulk_backend__read_header;
+	backend->parent.write = &bulk_backend__write;
+	backend->parent.writestream = &bulk_backend__writestream;
+	backend->parent.exists = &bulk_backend__exists;
+	backend->parent.exists_prefix = &bulk_backend__exists_prefix;
+	backend->parent.free = &bulk_backend__free;
+
+	*out = (git_odb_backend *)backend;
+	return 0;
+}
@@ -28,6 +28,18 @@ typedef struct {
 	git_filebuf fbuf;
 } loose_writestream;
 
+typedef struct {
+	git_odb_stream stream;
+	git_file fd;
+	z_stream zs;
+	unsigned char head[64]; /* header and the first inflated bytes */
+	size_t head_offset, head_len;
+	size_t remaining; /* bytes of object data left to read */
+	git_rawobj raw; /* pack-like loose objects are read whole */
+	unsigned int inflating :1;
+	unsigned char in[16 * 1024];
+} loose_readstream;
+
 typedef struct loose_backend {
 	git_odb_backend parent;
 
@@ -866,6 +878,166 @@ static int loose_backend__stream(git_odb_stream **stream_out, git_odb_backend *_
 	return !stream ? -1 : 0;
 }
 
+static int loose_backend__readstream_read(
+	git_odb_stream *_stream, char *buffer, size_t len)
+{
+	loose_readstream *stream = (loose_readstream *)_stream;
+	size_t copied = 0, chunk;
+	ssize_t read_bytes;
+	int status;
+
+	if (len > INT_MAX)
+		len = INT_MAX;
+	if (len > stream->remaining)
+		len = stream->remaining;
+
+	if (!stream->inflating) {
+		memcpy(buffer,
+			(char *)stream->raw.data + stream->raw.len - stream->remaining, len);
+		stream->remaining -= len;
+		return (int)len;
+	}
+
+	if (stream->head_offset < stream->head_len) {
+		chunk = min(len, stream->head_len - stream->head_offset);
+		memcpy(buffer, stream->head + stream->head_offset, chunk);
+		stream->head_offset += chunk;
+		copied = chunk;
+	}
+
+	while (copied < len) {
+		if (stream->zs.avail_in == 0) {
+			if ((read_bytes = p_read(stream->fd, stream->in, sizeof(stream->in))) < 0) {
+				giterr_set(GITERR_OS, "Failed to read loose object");
+				return -1;
+			}
+			if (read_bytes == 0)
+				break;
+
+			set_stream_input(&stream->zs, stream->in, (size_t)read_bytes);
+		}
+
+		set_stream_output(&stream->zs, buffer + copied, len - copied);
+		status = inflate(&stream->zs, Z_NO_FLUSH);
+		copied = len - stream->zs.avail_out;
+
+		if (status != Z_OK && status != Z_BUF_ERROR)
+			break;
+	}
+
+	stream->remaining -= copied;
+
+	if (copied < len) {
+		giterr_set(GITERR_ZLIB, "Loose object is truncated or corrupt");
+		return -1;
+	}
+
+	return (int)copied;
+}
+
+static void loose_backend__readstream_free(git_odb_stream *_stream)
+{
+	loose_readstream *stream = (loose_readstream *)_stream;
+
+	if (stream->inflating)
+		inflateEnd(&stream->zs);
+	if (stream->fd >= 0)
+		p_close(stream->fd);
+
+	git__free(stream->raw.data);
+	git__free(stream);
+}
+
+static int loose_readstream_init(loose_readstream *stream, git_buf *path)
+{
+	ssize_t read_bytes;
+	obj_hdr hdr;
+	size_t used;
+
+	if ((stream->fd = git_futils_open_ro(path->ptr)) < 0)
+		return stream->fd;
+
+	if ((read_bytes = p_read(stream->fd, stream->in, sizeof(stream->in))) < 2) {
+		giterr_set(GITERR_ODB, "Failed to read loose object");
+		return -1;
+	}
+
+	if (!is_zlib_compressed_data(stream->in)) {
+		p_close(stream->fd);
+		stream->fd = -1;
+
+		if (read_loose(&stream->raw, path) < 0)
+			return -1;
+
+		stream->remaining = stream->raw.len;
+		return 0;
+	}
+
+	/*
+	 * inflate the initial part of the file in order to parse the
+	 * object header (type and size), just like inflate_disk_obj.
+	 */
+	init_stream(&stream->zs, stream->head, sizeof(stream->head));
+	set_stream_input(&stream->zs, stream->in, (size_t)read_bytes);
+
+	if (inflateInit(&stream->zs) < Z_OK) {
+		giterr_set(GITERR_ZLIB, "Failed to inflate loose object");
+		return -1;
+	}
+	stream->inflating = 1;
+
+	if (inflate(&stream->zs, 0) < Z_OK ||
+		(used = get_object_header(&hdr, stream->head)) == 0 ||
+		!git_object_typeisloose(hdr.type))
+	{
+		giterr_set(GITERR_ODB, "Failed to inflate disk object.");
+		return -1;
+	}
+
+	stream->head_offset = used;
+	stream->head_len = min(stream->zs.total_out, used + hdr.size);
+	stream->remaining = hdr.size;
+	return 0;
+}
+
+static int loose_backend__readstream(
+	git_odb_stream **stream_out, git_odb_backend *_backend, const git_oid *oid)
+{
+	git_buf object_path = GIT_BUF_INIT;
+	loose_readstream *stream;
+	int error;
+
+	assert(_backend && oid);
+
+	*stream_out = NULL;
+
+	if (locate_object(&object_path, (loose_backend *)_backend, oid) < 0) {
+		git_buf_free(&object_path);
+		return git_odb__error_notfound("no matching loose object", oid);
+	}
+
+	stream = git__calloc(1, sizeof(loose_readstream));
+	if (stream == NULL) {
+		git_buf_free(&object_path);
+		return -1;
+	}
+
+	stream->stream.backend = _backend;
+	stream->stream.read = &loose_backend__readstream_read;
+	stream->stream.free = &loose_backend__readstream_free;
+	stream->stream.mode = GIT_STREAM_RDONLY;
+
+	if ((error = loose_readstream_init(stream, &object_path)) < 0)
+		loose_backend__readstream_free((git_odb_stream *)stream);
+	else {
+		stream->stream.declared_size = stream->remaining;
+		*stream_out = (git_odb_stream *)stream;
+	}
+
+	git_buf_free(&object_path);
+	return error;
+}
+
 static int loose_backend__write(git_odb_backend *_backend, const git_oid *oid, const void *data, size_t len, git_otype type)
 {
 	int error = 0, header_len;
@@ -956,6 +1128,7 @@ int git_odb_backend_loose(
 	backend->parent.read_prefix = &loose_backend__read_prefix;
 	backend->parent.read_header = &loose_backend__read_header;
 	backend->parent.writestream = &loose_backend__stream;
+	backend->parent.readstream = &loose_backend__readstream;
 	backend->parent.exists = &loose_backend__exists;
 	backend->parent.exists_prefix = &loose_backend__exists_prefix;
 	backend->parent.foreach = &loose_backend__foreach;
@@ -32,6 +32,14 @@ struct pack_writepack {
 	git_indexer *indexer;
 };
 
+struct pack_readstream {
+	git_odb_stream parent;
+	git_packfile_stream packstream;
+	git_rawobj raw; /* deltified objects are resolved up front */
+	size_t raw_offset;
+	unsigned int inflating :1;
+};
+
 /**
  * The wonderful tale of a Packed Object lookup query
  * ===================================================
@@ -532,6 +540,120 @@ static int pack_backend__foreach(git_odb_backend *_backend, git_odb_foreach_cb c
 	return 0;
 }
 
+static int pack_backend__readstream_read(
+	git_odb_stream *_stream, char *buffer, size_t len)
+{
+	struct pack_readstream *stream = (struct pack_readstream *)_stream;
+	git_off_t curpos;
+	ssize_t read;
+
+	if (len > INT_MAX)
+		len = INT_MAX;
+
+	if (!stream->inflating) {
+		if (len > stream->raw.len - stream->raw_offset)
+			len = stream->raw.len - stream->raw_offset;
+
+		memcpy(buffer, (char *)stream->raw.data + stream->raw_offset, len);
+		stream->raw_offset += len;
+		return (int)len;
+	}
+
+	/* the pack is complete on disk: no output only means a window ended */
+	do {
+		curpos = stream->packstream.curpos;
+		read = git_packfile_stream_read(&stream->packstream, buffer, len);
+	} while (read == GIT_EBUFS && stream->packstream.curpos != curpos);
+
+	if (read == GIT_EBUFS) {
+		giterr_set(GITERR_ODB, "Packed object data is truncated");
+		return -1;
+	}
+
+	return (int)read;
+}
+
+static void pack_backend__readstream_free(git_odb_stream *_stream)
+{
+	struct pack_readstream *stream = (struct pack_readstream *)_stream;
+
+	if (stream->inflating)
+		git_packfile_stream_free(&stream->packstream);
+
+	git__free(stream->raw.data);
+	git__free(stream);
+}
+
+static int pack_backend__readstream_internal(
+	git_odb_stream **stream_out, git_odb_backend *backend, const git_oid *oid)
+{
+	struct git_pack_entry e;
+	struct pack_readstream *stream;
+	git_mwindow *w_curs = NULL;
+	git_off_t curpos;
+	git_otype type;
+	size_t size;
+	int error;
+
+	if ((error = pack_entry_find(&e, (struct pack_backend *)backend, oid)) < 0)
+		return error;
+
+	curpos = e.offset;
+	error = git_packfile_unpack_header(&size, &type, &e.p->mwf, &w_curs, &curpos);
+	git_mwindow_close(&w_curs);
+
+	if (error < 0)
+		return error;
+
+	stream = git__calloc(1, sizeof(struct pack_readstream));
+	GITERR_CHECK_ALLOC(stream);
+
+	/*
+	 * Only whole objects are stored as a single zlib stream that can be
+	 * inflated bit by bit; a delta needs its base, so it is read whole.
+	 */
+	if (type == GIT_OBJ_OFS_DELTA || type == GIT_OBJ_REF_DELTA) {
+		if ((error = git_packfile_unpack(&stream->raw, e.p, &e.offset)) < 0) {
+			git__free(stream);
+			return error;
+		}
+
+		size = stream->raw.len;
+	} else {
+		if ((error = git_packfile_stream_open(&stream->packstream, e.p, curpos)) < 0) {
+			git__free(stream);
+			return error;
+		}
+
+		stream->inflating = 1;
+	}
+
+	stream->parent.backend = backend;
+	stream->parent.mode = GIT_STREAM_RDONLY;
+	stream->parent.declared_size = size;
+	stream->parent.read = &pack_backend__readstream_read;
+	stream->parent.free = &pack_backend__readstream_free;
+
+	*stream_out = (git_odb_stream *)stream;
+	return 0;
+}
+
+static int pack_backend__readstream(
+	git_odb_stream **stream_out, git_odb_backend *backend, const git_oid *oid)
+{
+	int error;
+
+	error = pack_backend__readstream_internal(stream_out, backend, oid);
+
+	if (error != GIT_ENOTFOUND)
+		return error;
+
+	if ((error = pack_backend__refresh(backend)) < 0)
+		return error;
+
+	return pack_backend__readstream_internal(stream_out, backend, oid);
+}
+
 static int pack_backend__writepack_append(struct git_odb_writepack *_writepack, const void *data, size_t size, git_transfer_progress *stats)
 {
 	struct pack_writepack *writepack = (struct pack_writepack *)_writepack;
@@ -628,6 +750,7 @@ static int pack_backend__alloc(struct pack_backend **out, size_t initial_size)
 	backend->parent.read = &pack_backend__read;
 	backend->parent.read_prefix = &pack_backend__read_prefix;
 	backend->parent.read_header = &pack_backend__read_header;
+	backend->parent.readstream = &pack_backend__readstream;
 	backend->parent.exists = &pack_backend__exists;
 	backend->parent.exists_prefix = &pack_backend__exists_prefix;
 	backend->parent.refresh = &pack_backend__refresh;
@@ -0,0 +1,930 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "pack-bitmap.h"
+#include "array.h"
+#include "fileops.h"
+#include "filebuf.h"
+#include "hash.h"
+#include "pack.h"
+#include "path.h"
+#include "repository.h"
+#include "vector.h"
+
+#include "git2/commit.h"
+#include "git2/revwalk.h"
+#include "git2/tree.h"
+
+#define BITMAP_SIGNATURE "BITM"
+#define BITMAP_VERSION 1
+#define BITMAP_HEADER_SIZE (4 + 2 + 2 + 4 + GIT_OID_RAWSZ)
+#define BITMAP_ENTRY_HEADER_SIZE (4 + 1 + 1)
+
+#define BITMAP_OPT_FULL_DAG 0x1
+#define BITMAP_OPT_HASH_CACHE 0x4
+#define BITMAP_OPT_LOOKUP_TABLE 0x10
+#define BITMAP_LOOKUP_TABLE_ENTRY_SIZE (4 + 8 + 4)
+
+/* commits are bitmapped at least this often along the history */
+#define BITMAP_COMMIT_INTERVAL 100
+
+enum {
+	BITMAP_COMMITS,
+	BITMAP_TREES,
+	BITMAP_BLOBS,
+	BITMAP_TAGS,
+	BITMAP_TYPES
+};
+
+static const git_otype bitmap_types[BITMAP_TYPES] = {
+	GIT_OBJ_COMMIT, GIT_OBJ_TREE, GIT_OBJ_BLOB, GIT_OBJ_TAG
+};
+
+typedef struct bitmap_entry {
+	git_oid id;
+
+	/* the stored bitmap, decoded and XORed with its base on first use */
+	const unsigned char *data;
+	size_t len;
+	struct bitmap_entry *xor_base;
+	git_bitmap bitmap;
+	unsigned int loaded:1;
+} bitmap_entry;
+
+typedef struct {
+	git_oid id;
+	git_otype type;
+	size_t pos;
+} bitmap_ext_object;
+
+struct git_pack_bitmap {
+	struct git_pack_file *pack;
+	git_map map;
+
+	uint32_t num_objects;
+	uint32_t *pack_order; /* pack position -> index position */
+	uint32_t *positions; /* index position -> pack position */
+
+	git_bitmap types[BITMAP_TYPES];
+	git_vector entries;
+	git_oidmap *commits;
+	const unsigned char *hashes;
+
+	/* objects outside of the pack, numbered from `num_objects` on */
+	git_vector ext;
+	git_oidmap *ext_ix;
+
+	/* when writing, every object must be in the pack */
+	bool pack_only;
+};
+
+static int bitmap_error(const char *message)
+{
+	giterr_set(GITERR_ODB, "Invalid pack bitmap - %s", message);
+	return -1;
+}
+
+GIT_INLINE(uint32_t) get_be32(const unsigned char *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+		((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+typedef struct {
+	git_off_t offset;
+	uint32_t index_pos;
+} pack_order_entry;
+
+static int pack_order_cmp(const void *a, const void *b)
+{
+	const pack_order_entry *ea = a, *eb = b;
+
+	if (ea->offset < eb->offset)
+		return -1;
+	return ea->offset > eb->offset;
+}
+
+static git_pack_bitmap *bitmap_alloc(void)
+{
+	git_pack_bitmap *b = git__calloc(1, sizeof(git_pack_bitmap));
+
+	if (!b)
+		return NULL;
+
+	if ((b->commits = git_oidmap_alloc()) == NULL ||
+		(b->ext_ix = git_oidmap_alloc()) == NULL) {
+		giterr_set_oom();
+		git_pack_bitmap_free(b);
+		return NULL;
+	}
+
+	return b;
+}
+
+/* Order the objects of the pack the way bitmaps number them */
+static int bitmap_load_pack(git_pack_bitmap *b, const char *index_path)
+{
+	pack_order_entry *order = NULL;
+	uint32_t i;
+	int error;
+
+	if ((error = git_packfile_alloc(&b->pack, index_path)) < 0 ||
+		(error = git_pack_object_count(&b->num_objects, b->pack)) < 0)
+		return error;
+
+	order = git__malloc(b->num_objects * sizeof(pack_order_entry) + 1);
+	b->pack_order = git__malloc(b->num_objects * sizeof(uint32_t) + 1);
+	b->positions = git__malloc(b->num_objects * sizeof(uint32_t) + 1);
+	if (!order || !b->pack_order || !b->positions) {
+		error = -1;
+		goto done;
+	}
+
+	for (i = 0; i < b->num_objects; i++) {
+		order[i].index_pos = i;
+		if ((error = git_pack_nth_entry(NULL, &order[i].offset, b->pack, i)) < 0)
+			goto done;
+	}
+
+	qsort(order, b->num_objects, sizeof(pack_order_entry), pack_order_cmp);
+
+	for (i = 0; i < b->num_objects; i++) {
+		b->pack_order[i] = order[i].index_pos;
+		b->positions[order[i].index_pos] = i;
+	}
+
+done:
+	git__free(order);
+	return error;
+}
+
+static int bitmap_add_entry(
+	bitmap_entry **out, git_pack_bitmap *b, const git_oid *id)
+{
+	bitmap_entry *entry;
+	khiter_t pos;
+	int ret;
+
+	entry = git__calloc(1, sizeof(bitmap_entry));
+	GITERR_CHECK_ALLOC(entry);
+
+	git_oid_cpy(&entry->id, id);
+
+	if (git_vector_insert(&b->entries, entry) < 0) {
+		git__free(entry);
+		return -1;
+	}
+
+	pos = kh_put(oid, b->commits, &entry->id, &ret);
+	if (ret < 0) {
+		giterr_set_oom();
+		return -1;
+	}
+	kh_val(b->commits, pos) = entry;
+
+	*out = entry;
+	return 0;
+}
+
+static int bitmap_parse(git_pack_bitmap *b)
+{
+	const unsigned char *data = b->map.data, *cur, *end;
+	uint32_t options, nentries, i, index_pos;
+	bitmap_entry *entry;
+	git_oid checksum, id;
+	ssize_t size;
+	size_t n;
+	int error;
+
+	if (b->map.len < BITMAP_HEADER_SIZE + GIT_OID_RAWSZ)
+		return bitmap_error("file is too short");
+
+	if (memcmp(data, BITMAP_SIGNATURE, 4) != 0)
+		return bitmap_error("bad signature");
+	if (((data[4] << 8) | data[5]) != BITMAP_VERSION)
+		return bitmap_error("unsupported version");
+
+	options = (data[6] << 8) | data[7];
+	if (!(options & BITMAP_OPT_FULL_DAG))
+		return bitmap_error("only full DAG bitmaps are supported");
+
+	nentries = get_be32(data + 8);
+
+	if ((error = git_pack_checksum(&checksum, b->pack)) < 0)
+		return error;
+	if (memcmp(checksum.id, data + 12, GIT_OID_RAWSZ) != 0)
+		return bitmap_error("it does not belong to its pack");
+
+	/* optional tables at the end, before the trailer */
+	end = data + b->map.len - GIT_OID_RAWSZ;
+
+	if (options & BITMAP_OPT_LOOKUP_TABLE) {
+		n = (size_t)nentries * BITMAP_LOOKUP_TABLE_ENTRY_SIZE;
+		if (n > (size_t)(end - data) - BITMAP_HEADER_SIZE)
+			return bitmap_error("lookup table is truncated");
+		end -= n;
+	}
+
+	if (options & BITMAP_OPT_HASH_CACHE) {
+		n = (size_t)b->num_objects * 4;
+		if (n > (size_t)(end - data) - BITMAP_HEADER_SIZE)
+			return bitmap_error("name-hash cache is truncated");
+		end -= n;
+		b->hashes = end;
+	}
+
+	cur = data + BITMAP_HEADER_SIZE;
+
+	for (i = 0; i < BITMAP_TYPES; i++) {
+		if ((size = git_ewah_read(&b->types[i], cur, end - cur, b->num_objects)) < 0)
+			return -1;
+		cur += size;
+	}
+
+	if (git_vector_init(&b->entries, nentries, NULL) < 0)
+		return -1;
+
+	for (i = 0; i < nentries; i++) {
+		if ((size_t)(end - cur) < BITMAP_ENTRY_HEADER_SIZE)
+			return bitmap_error("entry is truncated");
+
+		index_pos = get_be32(cur);
+		if (index_pos >= b->num_objects)
+			return bitmap_error("entry is not in the pack");
+		if (cur[4] > i)
+			return bitmap_error("entry is XORed with a missing bitmap");
+
+		if ((error = git_pack_nth_entry(&id, NULL, b->pack, index_pos)) < 0 ||
+			(error = bitmap_add_entry(&entry, b, &id)) < 0)
+			return error;
+
+		if (cur[4])
+			entry->xor_base = git_vector_get(&b->entries, i - cur[4]);
+		cur += BITMAP_ENTRY_HEADER_SIZE;
+
+		if ((size = git_ewah_size(cur, end - cur)) < 0)
+			return -1;
+
+		entry->data = cur;
+		entry->len = (size_t)size;
+		cur += size;
+	}
+
+	return 0;
+}
+
+static int find_bitmap(git_buf *out, const char *pack_dir)
+{
+	git_vector names = GIT_VECTOR_INIT;
+	char *name;
+	size_t i;
+	int error;
+
+	if ((error = git_vector_init(&names, 8, git__strcmp_cb)) < 0 ||
+		(error = git_path_dirload(pack_dir, strlen(pack_dir), 0, 0, &names)) < 0) {
+		git_vector_free_deep(&names);
+		return error;
+	}
+
+	error = GIT_ENOTFOUND;
+
+	/* the same pack git would pick: the first with a bitmap */
+	git_vector_sort(&names);
+	git_vector_foreach(&names, i, name) {
+		if (git__suffixcmp(name, GIT_PACK_BITMAP_EXT) != 0 ||
+			git__prefixcmp(name, "pack-") != 0)
+			continue;
+
+		if ((error = git_buf_joinpath(out, pack_dir, name)) < 0)
+			break;
+
+		git_buf_truncate(out, out->size - strlen(GIT_PACK_BITMAP_EXT));
+		if ((error = git_buf_puts(out, ".idx")) < 0 || git_path_exists(out->ptr))
+			break;
+
+		error = GIT_ENOTFOUND;
+	}
+
+	git_vector_free_deep(&names);
+	return error;
+}
+
+int git_pack_bitmap_open(git_pack_bitmap **out, const char *objects_dir)
+{
+	git_pack_bitmap *b;
+	git_buf pack_dir = GIT_BUF_INIT, path = GIT_BUF_INIT;
+	git_file fd = -1;
+	git_off_t size;
+	int error;
+
+	*out = NULL;
+
+	if ((error = git_buf_joinpath(&pack_dir, objects_dir, "pack")) < 0)
+		return error;
+
+	error = git_path_isdir(pack_dir.ptr) ?
+		find_bitmap(&path, pack_dir.ptr) : GIT_ENOTFOUND;
+	git_buf_free(&pack_dir);
+
+	if (error == GIT_ENOTFOUND)
+		giterr_clear();
+
+	if (error < 0 || (b = bitmap_alloc()) == NULL) {
+		git_buf_free(&path);
+		return error < 0 ? error : -1;
+	}
+
+	if ((error = bitmap_load_pack(b, path.ptr)) < 0)
+		goto done;
+
+	git_buf_truncate(&path, path.size - strlen(".idx"));
+	if ((error = git_buf_puts(&path, GIT_PACK_BITMAP_EXT)) < 0)
+		goto done;
+
+	if ((fd = git_futils_open_ro(path.ptr)) < 0 ||
+		(size = git_futils_filesize(fd)) < 0) {
+		error = -1;
+		goto done;
+	}
+
+	if ((error = git_futils_mmap_ro(&b->map, fd, 0, (size_t)size)) < 0)
+		goto done;
+
+	error = bitmap_parse(b);
+
+done:
+	if (fd >= 0)
+		p_close(fd);
+	git_buf_free(&path);
+
+	if (error < 0)
+		git_pack_bitmap_free(b);
+	else
+		*out = b;
+
+	return error;
+}
+
+void git_pack_bitmap_free(git_pack_bitmap *b)
+{
+	bitmap_entry *entry;
+	size_t i;
+
+	if (!b)
+		return;
+
+	git_vector_foreach(&b->entries, i, entry) {
+		git_bitmap_free(&entry->bitmap);
+		git__free(entry);
+	}
+	git_vector_free(&b->entries);
+	git_oidmap_free(b->commits);
+
+	git_vector_free_deep(&b->ext);
+	git_oidmap_free(b->ext_ix);
+
+	for (i = 0; i < BITMAP_TYPES; i++)
+		git_bitmap_free(&b->types[i]);
+
+	if (b->map.data)
+		git_futils_mmap_free(&b->map);
+
+	git__free(b->pack_order);
+	git__free(b->positions);
+	git_packfile_free(b->pack);
+	git__free(b);
+}
+
+static int entry_bitmap(const git_bitmap **out, git_pack_bitmap *b, bitmap_entry *entry)
+{
+	const git_bitmap *base;
+
+	if (!entry->loaded) {
+		if (git_ewah_read(&entry->bitmap, entry->data, entry->len, b->num_objects) < 0)
+			return -1;
+
+		if (entry->xor_base &&
+			(entry_bitmap(&base, b, entry->xor_base) < 0 ||
+			 git_bitmap_xor(&entry->bitmap, base) < 0))
+			return -1;
+
+		entry->loaded = 1;
+	}
+
+	*out = &entry->bitmap;
+	return 0;
+}
+
+static int object_position(
+	size_t *out, git_pack_bitmap *b, const git_oid *id, git_otype type)
+{
+	bitmap_ext_object *obj;
+	uint32_t index_pos;
+	khiter_t pos;
+	int error, ret;
+
+	if ((error = git_pack_entry_position(&index_pos, b->pack, id)) == 0) {
+		*out = b->positions[index_pos];
+		return 0;
+	}
+
+	if (error != GIT_ENOTFOUND)
+		return error;
+
+	pos = kh_get(oid, b->ext_ix, id);
+	if (pos != kh_end(b->ext_ix)) {
+		obj = kh_val(b->ext_ix, pos);
+		*out = obj->pos;
+		return 0;
+	}
+
+	/* the writer only bitmaps commits whose history is in the pack */
+	if (b->pack_only)
+		return git_odb__error_notfound("object is not in the pack", id);
+
+	obj = git__malloc(sizeof(bitmap_ext_object));
+	GITERR_CHECK_ALLOC(obj);
+
+	git_oid_cpy(&obj->id, id);
+	obj->type = type;
+	obj->pos = b->num_objects + b->ext.length;
+
+	if (git_vector_insert(&b->ext, obj) < 0) {
+		git__free(obj);
+		return -1;
+	}
+
+	pos = kh_put(oid, b->ext_ix, &obj->id, &ret);
+	if (ret < 0) {
+		giterr_set_oom();
+		return -1;
+	}
+	kh_val(b->ext_ix, pos) = obj;
+
+	*out = obj->pos;
+	return 0;
+}
+
+GIT_INLINE(bool) has_bit(const git_bitmap *a, const git_bitmap *b, size_t pos)
+{
+	return git_bitmap_get(a, pos) || (b && git_bitmap_get(b, pos));
+}
+
+static int add_tree(
+	git_bitmap *out,
+	git_pack_bitmap *b,
+	git_repository *repo,
+	const git_oid *tree_id,
+	const git_bitmap *seen)
+{
+	git_tree *tree;
+	const git_tree_entry *entry;
+	size_t i, pos;
+	int error;
+
+	if ((error = object_position(&pos, b, tree_id, GIT_OBJ_TREE)) < 0)
+		return error;
+
+	if (has_bit(out, seen, pos))
+		return 0;
+
+	if ((error = git_bitmap_set(out, pos)) < 0 ||
+		(error = git_tree_lookup(&tree, repo, tree_id)) < 0)
+		return error;
+
+	for (i = 0; i < git_tree_entrycount(tree); i++) {
+		entry = git_tree_entry_byindex(tree, i);
+
+		switch (git_tree_entry_type(entry)) {
+		case GIT_OBJ_TREE:
+			error = add_tree(out, b, repo, git_tree_entry_id(entry), seen);
+			break;
+		case GIT_OBJ_BLOB:
+			if ((error = object_position(&pos, b,
+					git_tree_entry_id(entry), GIT_OBJ_BLOB)) == 0 &&
+				!has_bit(out, seen, pos))
+				error = git_bitmap_set(out, pos);
+			break;
+		default:
+			/* submodule commits are not ours to send */
+			break;
+		}
+
+		if (error < 0)
+			break;
+	}
+
+	git_tree_free(tree);
+	return error;
+}
+
+int git_pack_bitmap_find_reachable(
+	git_bitmap *out,
+	git_pack_bitmap *b,
+	git_repository *repo,
+	const git_oid *tips,
+	size_t ntips,
+	const git_bitmap *seen)
+{
+	git_array_oid_t stack = GIT_ARRAY_INIT, trees = GIT_ARRAY_INIT;
+	const git_bitmap *stored;
+	git_commit *commit;
+	git_oid id, *slot;
+	khiter_t kpos;
+	size_t i, pos;
+	int error = 0;
+
+	for (i = 0; i < ntips; i++) {
+		slot = git_array_alloc(stack);
+		GITERR_CHECK_ALLOC(slot);
+		git_oid_cpy(slot, &tips[i]);
+	}
+
+	/*
+	 * Walk the commits down to the bitmapped ones first, so the trees
+	 * their bitmaps already cover are not walked again below
+	 */
+	while (git_array_size(stack) > 0) {
+		git_oid_cpy(&id, git_array_last(stack));
+		git_array_pop(stack);
+
+		kpos = kh_get(oid, b->commits, &id);
+		if (kpos != kh_end(b->commits)) {
+			if ((error = entry_bitmap(&stored, b, kh_val(b->commits, kpos))) < 0 ||
+				(error = git_bitmap_or(out, stored)) < 0)
+				goto done;
+			continue;
+		}
+
+		if ((error = object_position(&pos, b, &id, GIT_OBJ_COMMIT)) < 0)
+			goto done;
+
+		if (has_bit(out, seen, pos))
+			continue;
+
+		if ((error = git_bitmap_set(out, pos)) < 0 ||
+			(error = git_commit_lookup(&commit, repo, &id)) < 0)
+			goto done;
+
+		slot = git_array_alloc(trees);
+		GITERR_CHECK_ALLOC(slot);
+		git_oid_cpy(slot, git_commit_tree_id(commit));
+
+		for (i = 0; i < git_commit_parentcount(commit); i++) {
+			if ((slot = git_array_alloc(stack)) == NULL) {
+				git_commit_free(commit);
+				error = -1;
+				goto done;
+			}
+			git_oid_cpy(slot, git_commit_parent_id(commit, (unsigned int)i));
+		}
+
+		git_commit_free(commit);
+	}
+
+	for (i = 0; i < git_array_size(trees); i++) {
+		if ((error = add_tree(out, b, repo, git_array_get(trees, i), seen)) < 0)
+			break;
+	}
+
+done:
+	git_array_clear(stack);
+	git_array_clear(trees);
+	return error;
+}
+
+typedef struct {
+	git_pack_bitmap *bitmap;
+	git_pack_bitmap_foreach_cb cb;
+	void *payload;
+} foreach_data;
+
+static int foreach_object(size_t pos, void *payload)
+{
+	foreach_data *data = payload;
+	git_pack_bitmap *b = data->bitmap;
+	bitmap_ext_object *obj;
+	git_otype type = GIT_OBJ_BAD;
+	uint32_t hash = 0;
+	git_oid id;
+	size_t i;
+	int error;
+
+	if (pos >= b->num_objects) {
+		obj = git_vector_get(&b->ext, pos - b->num_objects);
+		return data->cb(&obj->id, obj->type, 0, data->payload);
+	}
+
+	if ((error = git_pack_nth_entry(&id, NULL, b->pack, b->pack_order[pos])) < 0)
+		return error;
+
+	for (i = 0; i < BITMAP_TYPES; i++) {
+		if (git_bitmap_get(&b->types[i], pos)) {
+			type = bitmap_types[i];
+			break;
+		}
+	}
+
+	if (b->hashes)
+		hash = get_be32(b->hashes + pos * 4);
+
+	return data->cb(&id, type, hash, data->payload);
+}
+
+int git_pack_bitmap_foreach(
+	git_pack_bitmap *bitmap,
+	const git_bitmap *objects,
+	git_pack_bitmap_foreach_cb cb,
+	void *payload)
+{
+	foreach_data data;
+
+	data.bitmap = bitmap;
+	data.cb = cb;
+	data.payload = payload;
+
+	return git_bitmap_foreach(objects, foreach_object, &data);
+}
+
+/*
+ * Writing
+ */
+
+static int type_index(git_otype type)
+{
+	size_t i;
+
+	for (i = 0; i < BITMAP_TYPES; i++)
+		if (bitmap_types[i] == type)
+			return (int)i;
+
+	return -1;
+}
+
+/* The commits of the pack, parents first */
+static int pack_commits(git_vector *out, git_packbuilder *pb)
+{
+	git_revwalk *walk;
+	git_oid id, *copy;
+	uint32_t i;
+	int error;
+
+	if ((error = git_revwalk_new(&walk, pb->repo)) < 0)
+		return error;
+
+	git_revwalk_sorting(walk, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+
+	for (i = 0; i < pb->nr_objects; i++) {
+		if (pb->object_list[i].type == GIT_OBJ_COMMIT &&
+			(error = git_revwalk_push(walk, &pb->object_list[i].id)) < 0)
+			goto done;
+	}
+
+	while ((error = git_revwalk_next(&id, walk)) == 0) {
+		if (kh_get(oid, pb->object_ix, &id) == kh_end(pb->object_ix))
+			continue;
+
+		copy = git__malloc(sizeof(git_oid));
+		GITERR_CHECK_ALLOC(copy);
+		git_oid_cpy(copy, &id);
+
+		if ((error = git_vector_insert(out, copy)) < 0) {
+			git__free(copy);
+			goto done;
+		}
+	}
+
+	if (error == GIT_ITEROVER)
+		error = 0;
+
+done:
+	git_revwalk_free(walk);
+	return error;
+}
+
+/* The tips of the pack's history, and commits spaced along it */
+static int select_commits(bool **out, git_packbuilder *pb, git_vector *commits)
+{
+	git_oidmap *parents;
+	git_commit *commit;
+	git_oid *id;
+	bool *selected;
+	size_t i;
+	unsigned int n;
+	int error = 0, ret;
+
+	selected = git__calloc(commits->length + 1, sizeof(bool));
+	GITERR_CHECK_ALLOC(selected);
+
+	if ((parents = git_oidmap_alloc()) == NULL) {
+		git__free(selected);
+		giterr_set_oom();
+		return -1;
+	}
+
+	/* newest first, so a commit is seen before its parents */
+	for (i = commits->length; i > 0; i--) {
+		id = git_vector_get(commits, i - 1);
+
+		if (kh_get(oid, parents, id) == kh_end(parents) ||
+			(commits->length - i) % BITMAP_COMMIT_INTERVAL == 0)
+			selected[i - 1] = true;
+
+		if ((error = git_commit_lookup(&commit, pb->repo, id)) < 0)
+			break;
+
+		for (n = 0; n < git_commit_parentcount(commit); n++) {
+			khiter_t pos = kh_get(oid, pb->object_ix, git_commit_parent_id(commit, n));
+			git_pobject *po;
+
+			/* key with the packbuilder's copy of the id, which outlives the map */
+			if (pos != kh_end(pb->object_ix)) {
+				po = kh_val(pb->object_ix, pos);
+				kh_put(oid, parents, &po->id, &ret);
+				if (ret < 0) {
+					giterr_set_oom();
+					error = -1;
+					break;
+				}
+			}
+		}
+
+		git_commit_free(commit);
+		if (error < 0)
+			break;
+	}
+
+	git_oidmap_free(parents);
+
+	if (error < 0)
+		git__free(selected);
+	else
+		*out = selected;
+
+	return error;
+}
+
+static void put_be32(git_buf *buf, uint32_t value)
+{
+	uint32_t be = htonl(value);
+	git_buf_put(buf, (const char *)&be, 4);
+}
+
+static int write_bitmap_file(
+	git_buf *out, git_pack_bitmap *b, git_packbuilder *pb)
+{
+	git_bitmap types[BITMAP_TYPES];
+	uint32_t *hashes = NULL, index_pos;
+	bitmap_entry *entry;
+	git_pobject *po;
+	git_oid checksum;
+	size_t i, pos;
+	int error = 0, type;
+
+	memset(types, 0, sizeof(types));
+
+	hashes = git__calloc(b->num_objects + 1, sizeof(uint32_t));
+	GITERR_CHECK_ALLOC(hashes);
+
+	for (i = 0; i < pb->nr_objects; i++) {
+		po = &pb->object_list[i];
+
+		if ((error = object_position(&pos, b, &po->id, po->type)) < 0)
+			goto done;
+
+		if ((type = type_index(po->type)) < 0) {
+			error = bitmap_error("unexpected object type");
+			goto done;
+		}
+
+		if ((error = git_bitmap_set(&types[type], pos)) < 0)
+			goto done;
+
+		hashes[pos] = htonl(po->hash);
+	}
+
+	if ((error = git_pack_checksum(&checksum, b->pack)) < 0)
+		goto done;
+
+	git_buf_put(out, BITMAP_SIGNATURE, 4);
+	git_buf_putc(out, 0);
+	git_buf_putc(out, BITMAP_VERSION);
+	git_buf_putc(out, 0);
+	git_buf_putc(out, BITMAP_OPT_FULL_DAG | BITMAP_OPT_HASH_CACHE);
+	put_be32(out, (uint32_t)b->entries.length);
+	git_buf_put(out, (const char *)checksum.id, GIT_OID_RAWSZ);
+
+	for (i = 0; i < BITMAP_TYPES; i++) {
+		if ((error = git_ewah_write(out, &types[i])) < 0)
+			goto done;
+	}
+
+	/* stored whole: no entry is XORed with another */
+	git_vector_foreach(&b->entries, i, entry) {
+		if ((error = git_pack_entry_position(&index_pos, b->pack, &entry->id)) < 0)
+			goto done;
+
+		put_be32(out, index_pos);
+		git_buf_putc(out, 0);
+		git_buf_putc(out, 0);
+
+		if ((error = git_ewah_write(out, &entry->bitmap)) < 0)
+			goto done;
+	}
+
+	git_buf_put(out, (const char *)hashes, b->num_objects * sizeof(uint32_t));
+
+	if (git_buf_oom(out) ||
+		(error = git_hash_buf(&checksum, out->ptr, out->size)) < 0) {
+		error = -1;
+		goto done;
+	}
+
+	git_buf_put(out, (const char *)checksum.id, GIT_OID_RAWSZ);
+	error = git_buf_oom(out) ? -1 : 0;
+
+done:
+	for (i = 0; i < BITMAP_TYPES; i++)
+		git_bitmap_free(&types[i]);
+	git__free(hashes);
+	return error;
+}
+
+int git_pack_bitmap_write(git_packbuilder *pb, const char *pack_dir)
+{
+	git_pack_bitmap *b;
+	git_vector commits = GIT_VECTOR_INIT;
+	git_buf path = GIT_BUF_INIT, contents = GIT_BUF_INIT;
+	git_filebuf file = GIT_FILEBUF_INIT;
+	git_bitmap reachable = GIT_BITMAP_INIT;
+	bitmap_entry *entry;
+	bool *selected = NULL;
+	char name[GIT_OID_HEXSZ + 1];
+	git_oid *id;
+	size_t i;
+	int error;
+
+	if ((b = bitmap_alloc()) == NULL)
+		return -1;
+
+	b->pack_only = true;
+
+	git_oid_tostr(name, sizeof(name), &pb->pack_oid);
+
+	if ((error = git_buf_joinpath(&path, pack_dir, "pack-")) < 0 ||
+		(error = git_buf_printf(&path, "%s.idx", name)) < 0 ||
+		(error = bitmap_load_pack(b, path.ptr)) < 0 ||
+		(error = pack_commits(&commits, pb)) < 0 ||
+		(error = select_commits(&selected, pb, &commits)) < 0)
+		goto done;
+
+	/*
+	 * Parents come first, so every bitmap is built on top of the
+	 * bitmaps of its selected ancestors
+	 */
+	git_vector_foreach(&commits, i, id) {
+		if (!selected[i])
+			continue;
+
+		error = git_pack_bitmap_find_reachable(&reachable, b, pb->repo, id, 1, NULL);
+
+		if (error == GIT_ENOTFOUND) {
+			/* part of its history is missing from the pack */
+			giterr_clear();
+			git_bitmap_free(&reachable);
+			continue;
+		}
+
+		if (error < 0 || (error = bitmap_add_entry(&entry, b, id)) < 0)
+			goto done;
+
+		entry->bitmap = reachable;
+		entry->loaded = 1;
+		memset(&reachable, 0, sizeof(reachable));
+	}
+
+	if ((error = write_bitmap_file(&contents, b, pb)) < 0)
+		goto done;
+
+	git_buf_truncate(&path, path.size - strlen(".idx"));
+
+	if ((error = git_buf_puts(&path, GIT_PACK_BITMAP_EXT)) < 0 ||
+		(error = git_filebuf_open(&file, path.ptr, 0, GIT_PACK_FILE_MODE)) < 0 ||
+		(error = git_filebuf_write(&file, contents.ptr, contents.size)) < 0 ||
+		(error = git_filebuf_commit(&file)) < 0)
+		goto done;
+
+done:
+	git_filebuf_cleanup(&file);
+	git_bitmap_free(&reachable);
+	git_buf_free(&contents);
+	git_buf_free(&path);
+	git_vector_free_deep(&commits);
+	git__free(selected);
+	git_pack_bitmap_free(b);
+	return error;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_pack_bitmap_h__
+#define INCLUDE_pack_bitmap_h__
+
+#include "common.h"
+#include "ewah.h"
+#include "pack-objects.h"
+
+#include "git2/oid.h"
+
+/*
+ * Reader and writer for git's pack bitmap index (pack-*.bitmap): for a
+ * selection of the commits in a pack, the set of objects reachable from
+ * each of them, as a bitmap over the objects of the pack in pack order.
+ * With it, the objects to send for a set of wants and haves are found
+ * by combining bitmaps rather than walking every tree.
+ */
+
+#define GIT_PACK_BITMAP_EXT ".bitmap"
+
+typedef struct git_pack_bitmap git_pack_bitmap;
+
+/*
+ * Open the bitmap index of the first pack in `objects_dir` which has
+ * one; GIT_ENOTFOUND when there is none.
+ */
+int git_pack_bitmap_open(git_pack_bitmap **out, const char *objects_dir);
+void git_pack_bitmap_free(git_pack_bitmap *bitmap);
+
+/*
+ * Set the bit of every object reachable from the commits `tips` in
+ * `out`, not descending into objects whose bit is set in `seen`, which
+ * may be NULL. Objects missing from the bitmapped pack are given
+ * positions after the pack's own.
+ */
+int git_pack_bitmap_find_reachable(
+	git_bitmap *out,
+	git_pack_bitmap *bitmap,
+	git_repository *repo,
+	const git_oid *tips,
+	size_t ntips,
+	const git_bitmap *seen);
+
+typedef int (*git_pack_bitmap_foreach_cb)(
+	const git_oid *id, git_otype type, uint32_t name_hash, void *payload);
+
+/*
+ * Call `cb` for every object set in `objects`; the name hash is 0 when
+ * the index has none for the object
+ */
+int git_pack_bitmap_foreach(
+	git_pack_bitmap *bitmap,
+	const git_bitmap *objects,
+	git_pack_bitmap_foreach_cb cb,
+	void *payload);
+
+/*
+ * Write the bitmap index of the pack `pb` has just written into
+ * `pack_dir`. Commits whose history is not entirely in the pack are
+ * left out.
+ */
+int git_pack_bitmap_write(git_packbuilder *pb, const char *pack_dir);
+
+#endif
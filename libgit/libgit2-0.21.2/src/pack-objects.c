@@ -12,6 +12,10 @@
 #include "iterator.h"
 #include "netops.h"
 #include "pack.h"
+#include "pack-bitmap.h"
+#include "pool.h"
+#include "repository.h"
+#include "revwalk.h"
 #include "thread-utils.h"
 #include "tree.h"
 #include "util.h"
@@ -87,7 +91,7 @@ static unsigned name_hash(const char *name)
 static int packbuilder_config(git_packbuilder *pb)
 {
 	git_config *config;
-	int ret;
+	int ret, use_bitmaps;
 	int64_t val;
 
 	if ((ret = git_repository_config_snapshot(&config, pb->repo)) < 0)
@@ -109,6 +113,13 @@ static int packbuilder_config(git_packbuilder *pb)
 
 #undef config_get
 
+	ret = git_config_get_bool(&use_bitmaps, config, "pack.useBitmaps");
+	if (ret == GIT_ENOTFOUND)
+		use_bitmaps = 1;
+	else if (ret < 0)
+		return -1;
+	pb->use_bitmaps = !!use_bitmaps;
+
 	git_config_free(config);
 
 	return 0;
@@ -185,8 +196,8 @@ static void rehash(git_packbuilder *pb)
 	}
 }
 
-int git_packbuilder_insert(git_packbuilder *pb, const git_oid *oid,
-			   const char *name)
+static int insert_object(git_packbuilder *pb, const git_oid *oid,
+			 unsigned int hash)
 {
 	git_pobject *po;
 	khiter_t pos;
@@ -216,7 +227,7 @@ int git_packbuilder_insert(git_packbuilder *pb, const git_oid *oid,
 
 	pb->nr_objects++;
 	git_oid_cpy(&po->id, oid);
-	po->hash = name_hash(name);
+	po->hash = hash;
 
 	pos = kh_put(oid, pb->object_ix, &po->id, &ret);
 	if (ret < 0) {
@@ -247,6 +258,12 @@ int git_packbuilder_insert(git_packbuilder *pb, const git_oid *oid,
 	return 0;
 }
 
+int git_packbuilder_insert(git_packbuilder *pb, const git_oid *oid,
+			   const char *name)
+{
+	return insert_object(pb, oid, name_hash(name));
+}
+
 static int get_delta(void **out, git_odb *odb, git_pobject *po)
 {
 	git_odb_object *src = NULL, *trg = NULL;
@@ -1317,6 +1334,10 @@ int git_packbuilder_write(
 	git_oid_cpy(&pb->pack_oid, git_indexer_hash(indexer));
 
 	git_indexer_free(indexer);
+
+	if (pb->write_bitmap && git_pack_bitmap_write(pb, path) < 0)
+		return -1;
+
 	return 0;
 }
 
@@ -1375,6 +1396,289 @@ int git_packbuilder_insert_tree(git_packbuilder *pb, const git_oid *oid)
 	return error;
 }
 
+void git_packbuilder_set_write_bitmap(git_packbuilder *pb, int enabled)
+{
+	assert(pb);
+	pb->write_bitmap = !!enabled;
+}
+
+/* The commits pushed into a walk which has not started, and those hidden */
+static int walk_tips(
+	git_array_oid_t *wants, git_array_oid_t *haves, git_revwalk *walk)
+{
+	git_commit_list_node *tip;
+	git_oid *slot;
+	size_t i;
+
+	if (walk->one) {
+		slot = git_array_alloc(*wants);
+		GITERR_CHECK_ALLOC(slot);
+		git_oid_cpy(slot, &walk->one->oid);
+	}
+
+	git_vector_foreach(&walk->twos, i, tip) {
+		slot = tip->uninteresting ? git_array_alloc(*haves) : git_array_alloc(*wants);
+		GITERR_CHECK_ALLOC(slot);
+		git_oid_cpy(slot, &tip->oid);
+	}
+
+	return 0;
+}
+
+static int insert_bitmap_object(
+	const git_oid *id, git_otype type, uint32_t hash, void *payload)
+{
+	GIT_UNUSED(type);
+	return insert_object(payload, id, hash);
+}
+
+static int insert_walk_bitmaps(git_packbuilder *pb, git_revwalk *walk)
+{
+	git_array_oid_t wants = GIT_ARRAY_INIT, haves = GIT_ARRAY_INIT;
+	git_bitmap want_objects = GIT_BITMAP_INIT, have_objects = GIT_BITMAP_INIT;
+	git_pack_bitmap *bitmap = NULL;
+	git_buf objects_dir = GIT_BUF_INIT;
+	int error;
+
+	if ((error = git_buf_joinpath(&objects_dir,
+			git_repository_path(pb->repo), GIT_OBJECTS_DIR)) < 0)
+		return error;
+
+	error = git_pack_bitmap_open(&bitmap, objects_dir.ptr);
+	git_buf_free(&objects_dir);
+
+	if (error < 0) {
+		/* a missing or unreadable bitmap index only costs us time */
+		giterr_clear();
+		return GIT_PASSTHROUGH;
+	}
+
+	if ((error = walk_tips(&wants, &haves, walk)) < 0 ||
+		(error = git_pack_bitmap_find_reachable(&have_objects, bitmap,
+			pb->repo, haves.ptr, haves.size, NULL)) < 0 ||
+		(error = git_pack_bitmap_find_reachable(&want_objects, bitmap,
+			pb->repo, wants.ptr, wants.size, &have_objects)) < 0)
+		goto done;
+
+	git_bitmap_and_not(&want_objects, &have_objects);
+
+	if ((error = git_pack_bitmap_foreach(
+			bitmap, &want_objects, insert_bitmap_object, pb)) < 0)
+		goto done;
+
+	git_revwalk_reset(walk);
+
+done:
+	git_bitmap_free(&want_objects);
+	git_bitmap_free(&have_objects);
+	git_array_clear(wants);
+	git_array_clear(haves);
+	git_pack_bitmap_free(bitmap);
+	return error;
+}
+
+struct walk_context {
+	git_packbuilder *pb;
+	git_oidmap *done; /* trees and blobs needing no more work */
+	git_pool ids;
+};
+
+static int mark_done(struct walk_context *ctx, const git_oid *id)
+{
+	git_oid *copy;
+	int ret;
+
+	if ((copy = git_pool_malloc(&ctx->ids, 1)) == NULL)
+		return -1;
+
+	git_oid_cpy(copy, id);
+	kh_put(oid, ctx->done, copy, &ret);
+	if (ret < 0) {
+		giterr_set_oom();
+		return -1;
+	}
+
+	return 0;
+}
+
+GIT_INLINE(bool) is_done(struct walk_context *ctx, const git_oid *id)
+{
+	return kh_get(oid, ctx->done, id) != kh_end(ctx->done);
+}
+
+/* The other side has this tree, and so everything in it */
+static int mark_tree_uninteresting(struct walk_context *ctx, const git_oid *id)
+{
+	git_tree *tree;
+	const git_tree_entry *entry;
+	size_t i;
+	int error;
+
+	if (is_done(ctx, id))
+		return 0;
+
+	if ((error = mark_done(ctx, id)) < 0 ||
+		(error = git_tree_lookup(&tree, ctx->pb->repo, id)) < 0)
+		return error;
+
+	for (i = 0; i < git_tree_entrycount(tree) && !error; i++) {
+		entry = git_tree_entry_byindex(tree, i);
+
+		if (git_tree_entry_type(entry) == GIT_OBJ_TREE)
+			error = mark_tree_uninteresting(ctx, git_tree_entry_id(entry));
+		else if (git_tree_entry_type(entry) == GIT_OBJ_BLOB &&
+			!is_done(ctx, git_tree_entry_id(entry)))
+			error = mark_done(ctx, git_tree_entry_id(entry));
+	}
+
+	git_tree_free(tree);
+	return error;
+}
+
+static int cb_tree_walk_uninteresting(
+	const char *root, const git_tree_entry *entry, void *payload)
+{
+	struct walk_context *ctx = payload;
+	git_buf name = GIT_BUF_INIT;
+	int error;
+
+	/* A commit inside a tree represents a submodule commit and should be skipped. */
+	if (git_tree_entry_type(entry) == GIT_OBJ_COMMIT)
+		return 0;
+
+	/* skip the other side's objects, and trees whose contents we added */
+	if (is_done(ctx, git_tree_entry_id(entry)))
+		return 1;
+
+	if (!(error = git_buf_sets(&name, root)) &&
+		!(error = git_buf_puts(&name, git_tree_entry_name(entry))))
+		error = git_packbuilder_insert(
+			ctx->pb, git_tree_entry_id(entry), git_buf_cstr(&name));
+
+	if (!error && git_tree_entry_type(entry) == GIT_OBJ_TREE)
+		error = mark_done(ctx, git_tree_entry_id(entry));
+
+	git_buf_free(&name);
+	return error;
+}
+
+static int insert_tree_uninteresting(struct walk_context *ctx, const git_oid *id)
+{
+	git_tree *tree;
+	int error;
+
+	if (is_done(ctx, id))
+		return 0;
+
+	if ((error = git_packbuilder_insert(ctx->pb, id, NULL)) < 0 ||
+		(error = mark_done(ctx, id)) < 0 ||
+		(error = git_tree_lookup(&tree, ctx->pb->repo, id)) < 0)
+		return error;
+
+	error = git_tree_walk(tree, GIT_TREEWALK_PRE, cb_tree_walk_uninteresting, ctx);
+
+	git_tree_free(tree);
+	return error;
+}
+
+static int commit_tree_id(git_oid *out, git_repository *repo, const git_oid *id)
+{
+	git_commit *commit;
+	int error;
+
+	if ((error = git_commit_lookup(&commit, repo, id)) < 0)
+		return error;
+
+	git_oid_cpy(out, git_commit_tree_id(commit));
+	git_commit_free(commit);
+	return 0;
+}
+
+static int insert_walk_trees(git_packbuilder *pb, git_revwalk *walk)
+{
+	git_array_oid_t commits = GIT_ARRAY_INIT, edges = GIT_ARRAY_INIT;
+	git_array_oid_t wants = GIT_ARRAY_INIT;
+	struct walk_context ctx;
+	git_commit_list_node *node;
+	git_oid id, tree_id, *slot;
+	unsigned short i;
+	size_t n;
+	int error;
+
+	ctx.pb = pb;
+	if ((ctx.done = git_oidmap_alloc()) == NULL) {
+		giterr_set_oom();
+		return -1;
+	}
+
+	if ((error = git_pool_init(&ctx.ids, sizeof(git_oid), 0)) < 0)
+		goto done;
+
+	/* the hidden tips are among the edges too */
+	if (!walk->walking && (error = walk_tips(&wants, &edges, walk)) < 0)
+		goto done;
+
+	while ((error = git_revwalk_next(&id, walk)) == 0) {
+		if ((error = git_packbuilder_insert(pb, &id, NULL)) < 0)
+			goto done;
+
+		slot = git_array_alloc(commits);
+		GITERR_CHECK_ALLOC(slot);
+		git_oid_cpy(slot, &id);
+
+		/* the hidden parents are where the other side's history starts */
+		node = git_revwalk__commit_lookup(walk, &id);
+		for (i = 0; node && i < node->out_degree; i++) {
+			if (!node->parents[i]->uninteresting)
+				continue;
+
+			slot = git_array_alloc(edges);
+			GITERR_CHECK_ALLOC(slot);
+			git_oid_cpy(slot, &node->parents[i]->oid);
+		}
+	}
+
+	if (error != GIT_ITEROVER)
+		goto done;
+
+	for (n = 0; n < git_array_size(edges); n++) {
+		if ((error = commit_tree_id(&tree_id, pb->repo, git_array_get(edges, n))) < 0 ||
+			(error = mark_tree_uninteresting(&ctx, &tree_id)) < 0)
+			goto done;
+	}
+
+	for (n = 0; n < git_array_size(commits); n++) {
+		if ((error = commit_tree_id(&tree_id, pb->repo, git_array_get(commits, n))) < 0 ||
+			(error = insert_tree_uninteresting(&ctx, &tree_id)) < 0)
+			goto done;
+	}
+
+	error = 0;
+
+done:
+	git_array_clear(commits);
+	git_array_clear(edges);
+	git_array_clear(wants);
+	git_pool_clear(&ctx.ids);
+	git_oidmap_free(ctx.done);
+	return error;
+}
+
+int git_packbuilder_insert_walk(git_packbuilder *pb, git_revwalk *walk)
+{
+	int error;
+
+	assert(pb && walk);
+
+	if (pb->use_bitmaps && !walk->walking &&
+		!walk->hide_cb && !walk->first_parent) {
+		if ((error = insert_walk_bitmaps(pb, walk)) != GIT_PASSTHROUGH)
+			return error;
+	}
+
+	return insert_walk_trees(pb, walk);
+}
+
 uint32_t git_packbuilder_object_count(git_packbuilder *pb)
 {
 	return pb->nr_objects;
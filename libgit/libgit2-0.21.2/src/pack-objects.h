@@ -87,6 +87,8 @@ struct git_packbuilder {
 	double last_progress_report_time; /* the time progress was last reported */
 
 	bool done;
+	bool use_bitmaps; /* find objects with pack bitmaps when there are some */
+	bool write_bitmap; /* write a bitmap index along with the pack */
 };
 
 int git_packbuilder_write_buf(git_buf *buf, git_packbuilder *pb);
@@ -13,6 +13,7 @@
 #include "mwindow.h"
 #include "fileops.h"
 #include "oid.h"
+#include "global.h"
 
 #include <zlib.h>
 
@@ -50,13 +51,35 @@ static int packfile_error(const char *message)
  * Delta base cache
  ********************/
 
-static git_pack_cache_entry *new_cache_object(git_rawobj *source)
+/*
+ * A single cache is shared by every pack in the process, so the budget
+ * covers all of them. Each pack keeps its own offset -> entry map for
+ * lookups; the entries themselves sit in one LRU list, most recently
+ * used first, and are evicted from the tail. Everything below is
+ * protected by git__pack_cache_mutex.
+ */
+static struct {
+	size_t memory_used;
+	size_t memory_limit;
+	size_t object_limit;
+	size_t hits;
+	size_t misses;
+	git_pack_cache_entry *head;
+	git_pack_cache_entry *tail;
+} pack_cache = {
+	0, GIT_PACK_CACHE_MEMORY_LIMIT, GIT_PACK_CACHE_SIZE_LIMIT, 0, 0, NULL, NULL
+};
+
+static git_pack_cache_entry *new_cache_object(
+	git_rawobj *source, struct git_pack_file *p, git_off_t offset)
 {
 	git_pack_cache_entry *e = git__calloc(1, sizeof(git_pack_cache_entry));
 	if (!e)
 		return NULL;
 
 	memcpy(&e->raw, source, sizeof(git_rawobj));
+	e->pack = p;
+	e->offset = offset;
 
 	return e;
 }
@@ -72,16 +95,81 @@ static void free_cache_object(void *o)
 	}
 }
 
+/* Run with the cache lock held */
+static void lru_unlink(git_pack_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		pack_cache.head = entry->next;
+
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		pack_cache.tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+}
+
+/* Run with the cache lock held */
+static void lru_push_front(git_pack_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = pack_cache.head;
+
+	if (pack_cache.head)
+		pack_cache.head->prev = entry;
+	else
+		pack_cache.tail = entry;
+
+	pack_cache.head = entry;
+}
+
+/* Run with the cache lock held */
+static void evict_until(size_t target)
+{
+	git_pack_cache_entry *entry = pack_cache.tail, *prev;
+	khiter_t k;
+
+	while (entry && pack_cache.memory_used > target) {
+		prev = entry->prev;
+
+		/* somebody is applying a delta on top of it right now */
+		if (entry->refcount.val == 0) {
+			k = kh_get(off, entry->pack->bases.entries, entry->offset);
+			if (k != kh_end(entry->pack->bases.entries))
+				kh_del(off, entry->pack->bases.entries, k);
+
+			lru_unlink(entry);
+			pack_cache.memory_used -= entry->raw.len;
+			free_cache_object(entry);
+		}
+
+		entry = prev;
+	}
+}
+
 static void cache_free(git_pack_cache *cache)
 {
+	git_pack_cache_entry *entry;
 	khiter_t k;
 
 	if (cache->entries) {
+		if (git_mutex_lock(&git__pack_cache_mutex) < 0)
+			return;
+
 		for (k = kh_begin(cache->entries); k != kh_end(cache->entries); k++) {
-			if (kh_exist(cache->entries, k))
-				free_cache_object(kh_value(cache->entries, k));
+			if (!kh_exist(cache->entries, k))
+				continue;
+
+			entry = kh_value(cache->entries, k);
+			lru_unlink(entry);
+			pack_cache.memory_used -= entry->raw.len;
+			free_cache_object(entry);
 		}
 
+		git_mutex_unlock(&git__pack_cache_mutex);
+
 		git_offmap_free(cache->entries);
 		cache->entries = NULL;
 	}
@@ -92,17 +180,6 @@ static int cache_init(git_pack_cache *cache)
 	cache->entries = git_offmap_alloc();
 	GITERR_CHECK_ALLOC(cache->entries);
 
-	cache->memory_limit = GIT_PACK_CACHE_MEMORY_LIMIT;
-
-	if (git_mutex_init(&cache->lock)) {
-		giterr_set(GITERR_OS, "Failed to initialize pack cache mutex");
-
-		git__free(cache->entries);
-		cache->entries = NULL;
-
-		return -1;
-	}
-
 	return 0;
 }
 
@@ -111,67 +188,58 @@ static git_pack_cache_entry *cache_get(git_pack_cache *cache, git_off_t offset)
 	khiter_t k;
 	git_pack_cache_entry *entry = NULL;
 
-	if (git_mutex_lock(&cache->lock) < 0)
+	if (git_mutex_lock(&git__pack_cache_mutex) < 0)
 		return NULL;
 
 	k = kh_get(off, cache->entries, offset);
 	if (k != kh_end(cache->entries)) { /* found it */
 		entry = kh_value(cache->entries, k);
 		git_atomic_inc(&entry->refcount);
-		entry->last_usage = cache->use_ctr++;
+		lru_unlink(entry);
+		lru_push_front(entry);
+		pack_cache.hits++;
+	} else {
+		pack_cache.misses++;
 	}
-	git_mutex_unlock(&cache->lock);
+	git_mutex_unlock(&git__pack_cache_mutex);
 
 	return entry;
 }
 
-/* Run with the cache lock held */
-static void free_lowest_entry(git_pack_cache *cache)
-{
-	git_pack_cache_entry *entry;
-	khiter_t k;
-
-	for (k = kh_begin(cache->entries); k != kh_end(cache->entries); k++) {
-		if (!kh_exist(cache->entries, k))
-			continue;
-
-		entry = kh_value(cache->entries, k);
-
-		if (entry && entry->refcount.val == 0) {
-			cache->memory_used -= entry->raw.len;
-			kh_del(off, cache->entries, k);
-			free_cache_object(entry);
-		}
-	}
-}
-
-static int cache_add(git_pack_cache *cache, git_rawobj *base, git_off_t offset)
+static int cache_add(struct git_pack_file *p, git_rawobj *base, git_off_t offset)
 {
+	git_pack_cache *cache = &p->bases;
 	git_pack_cache_entry *entry;
 	int error, exists = 0;
 	khiter_t k;
 
-	if (base->len > GIT_PACK_CACHE_SIZE_LIMIT)
+	/* reading the limits without the lock is fine, they are only hints */
+	if (base->len > pack_cache.object_limit ||
+		base->len >= pack_cache.memory_limit)
 		return -1;
 
-	entry = new_cache_object(base);
+	entry = new_cache_object(base, p, offset);
 	if (entry) {
-		if (git_mutex_lock(&cache->lock) < 0) {
+		if (git_mutex_lock(&git__pack_cache_mutex) < 0) {
 			giterr_set(GITERR_OS, "failed to lock cache");
+			git__free(entry);
 			return -1;
 		}
 		/* Add it to the cache if nobody else has */
 		exists = kh_get(off, cache->entries, offset) != kh_end(cache->entries);
-		if (!exists) {
-			while (cache->memory_used + base->len > cache->memory_limit)
-				free_lowest_entry(cache);
+		if (!exists && base->len < pack_cache.memory_limit) {
+			if (pack_cache.memory_used + base->len > pack_cache.memory_limit)
+				evict_until(pack_cache.memory_limit - base->len);
 
 			k = kh_put(off, cache->entries, offset, &error);
 			assert(error != 0);
 			kh_value(cache->entries, k) = entry;
-			cache->memory_used += entry->raw.len;
+			lru_push_front(entry);
+			pack_cache.memory_used += entry->raw.len;
+		} else {
+			exists = 1;
 		}
-		git_mutex_unlock(&cache->lock);
+		git_mutex_unlock(&git__pack_cache_mutex);
 		/* Somebody beat us to adding it into the cache */
 		if (exists) {
 			git__free(entry);
@@ -182,6 +250,51 @@ static int cache_add(git_pack_cache *cache, git_rawobj *base, git_off_t offset)
 	return 0;
 }
 
+int git_pack_cache_set_max_size(size_t bytes)
+{
+	if (git_mutex_lock(&git__pack_cache_mutex) < 0) {
+		giterr_set(GITERR_OS, "failed to lock cache");
+		return -1;
+	}
+
+	pack_cache.memory_limit = bytes;
+	evict_until(bytes);
+
+	git_mutex_unlock(&git__pack_cache_mutex);
+	return 0;
+}
+
+void git_pack_cache_set_object_limit(size_t bytes)
+{
+	pack_cache.object_limit = bytes;
+}
+
+int git_pack_cache_stats(
+	size_t *used, size_t *limit, size_t *hits, size_t *misses)
+{
+	if (git_mutex_lock(&git__pack_cache_mutex) < 0) {
+		giterr_set(GITERR_OS, "failed to lock cache");
+		return -1;
+	}
+
+	*used = pack_cache.memory_used;
+	*limit = pack_cache.memory_limit;
+	*hits = pack_cache.hits;
+	*misses = pack_cache.misses;
+
+	git_mutex_unlock(&git__pack_cache_mutex);
+	return 0;
+}
+
+void git_pack_cache_reset_stats(void)
+{
+	if (git_mutex_lock(&git__pack_cache_mutex) < 0)
+		return;
+
+	pack_cache.hits = pack_cache.misses = 0;
+	git_mutex_unlock(&git__pack_cache_mutex);
+}
+
 /***********************************************************
  *
  * PACK INDEX METHODS
@@ -698,7 +811,7 @@ int git_packfile_unpack(
 		 * long as it's not already the cached one.
 		 */
 		if (!cached)
-			free_base = !!cache_add(&p->bases, obj, elem->base_key);
+			free_base = !!cache_add(p, obj, elem->base_key);
 
 		elem = &stack[elem_pos - 1];
 		curpos = elem->offset;
@@ -775,7 +888,6 @@ int git_packfile_stream_open(git_packfile_stream *obj, struct git_pack_file *p,
 	obj->zstream.next_out = Z_NULL;
 	st = inflateInit(&obj->zstream);
 	if (st != Z_OK) {
-		git__free(obj);
 		giterr_set(GITERR_ZLIB, "failed to init packfile stream");
 		return -1;
 	}
@@ -977,8 +1089,8 @@ void git_packfile_free(struct git_pack_file *p)
 
 	git__free(p->bad_object_sha1);
 
+	git_mwindow_file_free(&p->mwf);
 	git_mutex_free(&p->lock);
-	git_mutex_free(&p->bases.lock);
 	git__free(p);
 }
 
@@ -1114,7 +1226,15 @@ int git_packfile_alloc(struct git_pack_file **pack_out, const char *path)
 		return -1;
 	}
 
+	if (git_mwindow_file_init(&p->mwf) < 0) {
+		git_mutex_free(&p->lock);
+		git__free(p);
+		return -1;
+	}
+
 	if (cache_init(&p->bases) < 0) {
+		git_mwindow_file_free(&p->mwf);
+		git_mutex_free(&p->lock);
 		git__free(p);
 		return -1;
 	}
@@ -1344,3 +1464,90 @@ int git_pack_entry_find(
 	git_oid_cpy(&e->sha1, &found_oid);
 	return 0;
 }
+
+int git_pack_object_count(uint32_t *out, struct git_pack_file *p)
+{
+	int error;
+
+	if ((error = pack_index_open(p)) < 0)
+		return error;
+
+	*out = p->num_objects;
+	return 0;
+}
+
+int git_pack_nth_entry(
+	git_oid *id, git_off_t *offset, struct git_pack_file *p, uint32_t n)
+{
+	const unsigned char *index;
+	int error;
+
+	if ((error = pack_index_open(p)) < 0)
+		return error;
+
+	if (n >= p->num_objects) {
+		giterr_set(GITERR_ODB, "Pack index position %u is out of range", n);
+		return -1;
+	}
+
+	index = (const unsigned char *)p->index_map.data + 4 * 256;
+
+	if (id) {
+		if (p->index_version > 1)
+			git_oid_fromraw(id, index + 8 + 20 * n);
+		else
+			git_oid_fromraw(id, index + 24 * n + 4);
+	}
+
+	if (offset)
+		*offset = nth_packed_object_offset(p, n);
+
+	return 0;
+}
+
+int git_pack_entry_position(
+	uint32_t *pos, struct git_pack_file *p, const git_oid *id)
+{
+	const uint32_t *level1_ofs;
+	const unsigned char *index;
+	unsigned hi, lo, stride;
+	int found, error;
+
+	if ((error = pack_index_open(p)) < 0)
+		return error;
+
+	level1_ofs = p->index_map.data;
+	index = p->index_map.data;
+
+	if (p->index_version > 1) {
+		level1_ofs += 2;
+		index += 8;
+		stride = 20;
+	} else {
+		index += 4;
+		stride = 24;
+	}
+
+	index += 4 * 256;
+	hi = ntohl(level1_ofs[(int)id->id[0]]);
+	lo = ((id->id[0] == 0x0) ? 0 : ntohl(level1_ofs[(int)id->id[0] - 1]));
+
+	if ((found = sha1_position(index, stride, lo, hi, id->id)) < 0)
+		return GIT_ENOTFOUND;
+
+	*pos = (uint32_t)found;
+	return 0;
+}
+
+int git_pack_checksum(git_oid *out, struct git_pack_file *p)
+{
+	int error;
+
+	if ((error = pack_index_open(p)) < 0)
+		return error;
+
+	/* the index ends with the pack's checksum and its own */
+	git_oid_fromraw(out, (const unsigned char *)p->index_map.data +
+		p->index_map.len - 2 * GIT_OID_RAWSZ);
+	return 0;
+}
@@ -56,7 +56,9 @@ struct git_pack_idx_header {
 };
 
 typedef struct git_pack_cache_entry {
-	size_t last_usage; /* enough? */
+	struct git_pack_cache_entry *prev, *next; /* LRU order, newest first */
+	struct git_pack_file *pack;
+	git_off_t offset;
 	git_atomic refcount;
 	git_rawobj raw;
 } git_pack_cache_entry;
@@ -75,14 +77,12 @@ typedef git_array_t(struct pack_chain_elem) git_dependency_chain;
 GIT__USE_OFFMAP;
 GIT__USE_OIDMAP;
 
-#define GIT_PACK_CACHE_MEMORY_LIMIT 16 * 1024 * 1024
-#define GIT_PACK_CACHE_SIZE_LIMIT 1024 * 1024 /* don't bother caching anything over 1MB */
+/* defaults for the delta base cache shared by all packs */
+#define GIT_PACK_CACHE_MEMORY_LIMIT 96 * 1024 * 1024
+#define GIT_PACK_CACHE_SIZE_LIMIT 16 * 1024 * 1024 /* don't bother caching anything over 16MB */
 
+/* a pack's view into the shared delta base cache */
 typedef struct {
-	size_t memory_used;
-	size_t memory_limit;
-	size_t use_ctr;
-	git_mutex lock;
 	git_offmap *entries;
 } git_pack_cache;
 
@@ -156,6 +156,12 @@ git_off_t get_delta_base(struct git_pack_file *p, git_mwindow **w_curs,
 void git_packfile_free(struct git_pack_file *p);
 int git_packfile_alloc(struct git_pack_file **pack_out, const char *path);
 
+/* Settings of the delta base cache shared by all packs */
+int git_pack_cache_set_max_size(size_t bytes);
+void git_pack_cache_set_object_limit(size_t bytes);
+int git_pack_cache_stats(size_t *used, size_t *limit, size_t *hits, size_t *misses);
+void git_pack_cache_reset_stats(void);
+
 int git_pack_entry_find(
 		struct git_pack_entry *e,
 		struct git_pack_file *p,
@@ -166,4 +172,23 @@ int git_pack_foreach_entry(
 		git_odb_foreach_cb cb,
 		void *data);
 
+/* Number of objects listed in the pack's index */
+int git_pack_object_count(uint32_t *out, struct git_pack_file *p);
+
+/* The id and offset of the `n`th object in index (object id) order */
+int git_pack_nth_entry(
+		git_oid *id,
+		git_off_t *offset,
+		struct git_pack_file *p,
+		uint32_t n);
+
+/* Position of an object in the index; GIT_ENOTFOUND if it is not there */
+int git_pack_entry_position(
+		uint32_t *pos,
+		struct git_pack_file *p,
+		const git_oid *id);
+
+/* The checksum at the end of the packfile, as recorded in its index */
+int git_pack_checksum(git_oid *out, struct git_pack_file *p);
+
 #endif
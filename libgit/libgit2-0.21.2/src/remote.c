@@ -274,6 +274,7 @@ int git_remote_dup(git_remote **dest, git_remote *source)
 	remote->download_tags = source->download_tags;
 	remote->check_cert = source->check_cert;
 	remote->update_fetchhead = source->update_fetchhead;
+	remote->depth = source->depth;
 
 	if (git_vector_init(&remote->refs, 32, NULL) < 0 ||
 	    git_vector_init(&remote->refspecs, 2, NULL) < 0 ||
@@ -1579,6 +1580,16 @@ void git_remote_set_update_fetchhead(git_remote *remote, int value)
 	remote->update_fetchhead = (value != 0);
 }
 
+int git_remote_depth(const git_remote *remote)
+{
+	return remote->depth;
+}
+
+void git_remote_set_depth(git_remote *remote, int depth)
+{
+	remote->depth = depth > 0 ? depth : 0;
+}
+
 int git_remote_is_valid_name(
 	const char *remote_name)
 {
@@ -30,6 +30,7 @@ struct git_remote {
 	git_remote_autotag_option_t download_tags;
 	int check_cert;
 	int update_fetchhead;
+	int depth;
 };
 
 const char* git_remote__urlfordirection(struct git_remote *remote, int direction);
@@ -26,6 +26,7 @@
 #include "remote.h"
 #include "merge.h"
 #include "diff_driver.h"
+#include "oid.h"
 
 #ifdef GIT_WIN32
 # include "win32/w32_util.h"
@@ -50,6 +51,19 @@ static void set_odb(git_repository *repo, git_odb *odb)
 	}
 }
 
+static void set_commit_graph(git_repository *repo, git_commit_graph *graph)
+{
+	if (graph) {
+		GIT_REFCOUNT_OWN(graph, repo);
+		GIT_REFCOUNT_INC(graph);
+	}
+
+	if ((graph = git__swap(repo->_commit_graph, graph)) != NULL) {
+		GIT_REFCOUNT_OWN(graph, NULL);
+		git_commit_graph_free(graph);
+	}
+}
+
 static void set_refdb(git_repository *repo, git_refdb *refdb)
 {
 	if (refdb) {
@@ -103,6 +117,8 @@ void git_repository__cleanup(git_repository *repo)
 	set_index(repo, NULL);
 	set_odb(repo, NULL);
 	set_refdb(repo, NULL);
+	set_commit_graph(repo, NULL);
+	git_repository_set_fsmonitor(repo, NULL);
 }
 
 void git_repository_free(git_repository *repo)
@@ -687,6 +703,42 @@ void git_repository_set_odb(git_repository *repo, git_odb *odb)
 	set_odb(repo, odb);
 }
 
+int git_repository_commit_graph__weakptr(git_commit_graph **out, git_repository *repo)
+{
+	assert(repo && out);
+
+	if (repo->_commit_graph == NULL && repo->path_repository != NULL) {
+		git_buf odb_path = GIT_BUF_INIT;
+		git_commit_graph *graph;
+
+		git_buf_joinpath(&odb_path, repo->path_repository, GIT_OBJECTS_DIR);
+
+		/* history can always be read from the objects themselves */
+		if (git_commit_graph_open(&graph, odb_path.ptr) < 0) {
+			giterr_clear();
+		} else {
+			GIT_REFCOUNT_OWN(graph, repo);
+
+			graph = git__compare_and_swap(&repo->_commit_graph, NULL, graph);
+			if (graph != NULL) {
+				GIT_REFCOUNT_OWN(graph, NULL);
+				git_commit_graph_free(graph);
+			}
+		}
+
+		git_buf_free(&odb_path);
+	}
+
+	*out = repo->_commit_graph;
+	return 0;
+}
+
+void git_repository__set_commit_graph(git_repository *repo, git_commit_graph *graph)
+{
+	assert(repo);
+	set_commit_graph(repo, graph);
+}
+
 int git_repository_refdb__weakptr(git_refdb **out, git_repository *repo)
 {
 	int error = 0;
@@ -1979,7 +2031,7 @@ int git_repository_is_shallow(git_repository *repo)
 	struct stat st;
 	int error;
 
-	git_buf_joinpath(&path, repo->path_repository, "shallow");
+	git_buf_joinpath(&path, repo->path_repository, GIT_SHALLOW_FILE);
 	error = git_path_lstat(path.ptr, &st);
 	git_buf_free(&path);
 
@@ -1993,6 +2045,123 @@ int git_repository_is_shallow(git_repository *repo)
 	return st.st_size == 0 ? 0 : 1;
 }
 
+static int shallow_root_cmp(const void *a, const void *b)
+{
+	return git_oid__cmp(a, b);
+}
+
+int git_repository__shallow_roots(git_array_oid_t *out, git_repository *repo)
+{
+	git_buf path = GIT_BUF_INIT, contents = GIT_BUF_INIT;
+	const char *line, *end, *eol;
+	git_oid *id;
+	int error;
+
+	assert(out && repo);
+
+	git_array_init(*out);
+
+	if ((error = git_buf_joinpath(&path, repo->path_repository, GIT_SHALLOW_FILE)) < 0)
+		return error;
+
+	error = git_futils_readbuffer(&contents, path.ptr);
+	git_buf_free(&path);
+
+	if (error == GIT_ENOTFOUND) {
+		giterr_clear();
+		return 0;
+	}
+
+	if (error < 0)
+		return error;
+
+	line = contents.ptr;
+	end = contents.ptr + contents.size;
+
+	while (line < end) {
+		if ((eol = memchr(line, '\n', end - line)) == NULL)
+			eol = end;
+
+		if (eol - line != GIT_OID_HEXSZ) {
+			giterr_set(GITERR_REPOSITORY, "Invalid entry in the shallow file");
+			error = -1;
+			break;
+		}
+
+		if ((id = git_array_alloc(*out)) == NULL) {
+			error = -1;
+			break;
+		}
+
+		if ((error = git_oid_fromstrn(id, line, GIT_OID_HEXSZ)) < 0)
+			break;
+
+		line = eol + 1;
+	}
+
+	git_buf_free(&contents);
+
+	if (error < 0) {
+		git_array_clear(*out);
+		return error;
+	}
+
+	if (out->size > 1)
+		qsort(out->ptr, out->size, sizeof(git_oid), shallow_root_cmp);
+
+	return 0;
+}
+
+int git_repository__shallow_roots_write(git_repository *repo, const git_array_oid_t *roots)
+{
+	git_buf path = GIT_BUF_INIT;
+	git_filebuf file = GIT_FILEBUF_INIT;
+	char line[GIT_OID_HEXSZ + 1];
+	uint32_t i;
+	int error;
+
+	assert(repo && roots);
+
+	if ((error = git_buf_joinpath(&path, repo->path_repository, GIT_SHALLOW_FILE)) < 0)
+		return error;
+
+	/* a complete history is recorded by not having the file at all */
+	if (roots->size == 0) {
+		if (git_path_isfile(path.ptr) && (error = p_unlink(path.ptr)) < 0)
+			giterr_set(GITERR_OS, "Failed to remove '%s'", path.ptr);
+
+		git_buf_free(&path);
+		return error;
+	}
+
+	if ((error = git_filebuf_open(&file, path.ptr, 0, GIT_SHALLOW_FILE_MODE)) < 0)
+		goto done;
+
+	line[GIT_OID_HEXSZ] = '\n';
+
+	for (i = 0; i < roots->size; i++) {
+		git_oid_fmt(line, &roots->ptr[i]);
+
+		if ((error = git_filebuf_write(&file, line, sizeof(line))) < 0)
+			goto done;
+	}
+
+	error = git_filebuf_commit(&file);
+
+done:
+	git_filebuf_cleanup(&file);
+	git_buf_free(&path);
+	return error;
+}
+
+bool git_repository__is_shallow_root(const git_array_oid_t *roots, const git_oid *id)
+{
+	if (roots->size == 0)
+		return false;
+
+	return bsearch(id, roots->ptr, roots->size, sizeof(git_oid), shallow_root_cmp) != NULL;
+}
+
 int git_repository_init_init_options(
 	git_repository_init_options *opts, unsigned int version)
 {
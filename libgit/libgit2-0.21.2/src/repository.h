@@ -13,6 +13,7 @@
 #include "git2/repository.h"
 #include "git2/object.h"
 #include "git2/config.h"
+#include "git2/fsmonitor.h"
 
 #include "cache.h"
 #include "refs.h"
@@ -21,12 +22,17 @@
 #include "attrcache.h"
 #include "submodule.h"
 #include "diff_driver.h"
+#include "commit_graph.h"
+#include "array.h"
 
 #define DOT_GIT ".git"
 #define GIT_DIR DOT_GIT "/"
 #define GIT_DIR_MODE 0755
 #define GIT_BARE_DIR_MODE 0777
 
+#define GIT_SHALLOW_FILE "shallow"
+#define GIT_SHALLOW_FILE_MODE 0666
+
 /** Cvar cache identifiers */
 typedef enum {
 	GIT_CVAR_AUTO_CRLF = 0, /* core.autocrlf */
@@ -40,6 +46,7 @@ typedef enum {
 	GIT_CVAR_PRECOMPOSE,    /* core.precomposeunicode */
 	GIT_CVAR_SAFE_CRLF,		/* core.safecrlf */
 	GIT_CVAR_LOGALLREFUPDATES, /* core.logallrefupdates */
+	GIT_CVAR_SPARSECHECKOUT, /* core.sparsecheckout */
 	GIT_CVAR_CACHE_MAX
 } git_cvar_cached;
 
@@ -96,6 +103,8 @@ typedef enum {
 	/* core.logallrefupdates */
 	GIT_LOGALLREFUPDATES_UNSET = 2,
 	GIT_LOGALLREFUPDATES_DEFAULT = GIT_LOGALLREFUPDATES_UNSET,
+	/* core.sparsecheckout */
+	GIT_SPARSECHECKOUT_DEFAULT = GIT_CVAR_FALSE,
 } git_cvar_value;
 
 /* internal repository init flags */
@@ -112,6 +121,8 @@ struct git_repository {
 	git_config *_config;
 	git_index *_index;
 	git_submodule_cache *_submodules;
+	git_commit_graph *_commit_graph;
+	git_fsmonitor *_fsmonitor;
 
 	git_cache objects;
 	git_attr_cache *attrcache;
@@ -134,6 +145,25 @@ GIT_INLINE(git_attr_cache *) git_repository_attr_cache(git_repository *repo)
 
 int git_repository_head_tree(git_tree **tree, git_repository *repo);
 
+/*
+ * The commit-graph is optional: `out` is set to NULL when the repository
+ * does not have one, or it cannot be used.
+ */
+int git_repository_commit_graph__weakptr(git_commit_graph **out, git_repository *repo);
+void git_repository__set_commit_graph(git_repository *repo, git_commit_graph *graph);
+
+typedef git_array_t(git_oid) git_array_oid_t;
+
+/*
+ * The commits listed in `.git/shallow` are the boundary of a shallow
+ * clone: their parents were never fetched.  The roots are returned
+ * sorted; a repository without the file has none.  Writing an empty
+ * list removes the file.
+ */
+int git_repository__shallow_roots(git_array_oid_t *out, git_repository *repo);
+int git_repository__shallow_roots_write(git_repository *repo, const git_array_oid_t *roots);
+bool git_repository__is_shallow_root(const git_array_oid_t *roots, const git_oid *id);
+
 /*
  * Weak pointers to repository internals.
  *
@@ -14,6 +14,8 @@
 #include "git2/revparse.h"
 #include "merge.h"
 
+GIT__USE_OIDMAP;
+
 git_commit_list_node *git_revwalk__commit_lookup(
 	git_revwalk *walk, const git_oid *oid)
 {
@@ -31,6 +33,7 @@ git_commit_list_node *git_revwalk__commit_lookup(
 		return NULL;
 
 	git_oid_cpy(&commit->oid, oid);
+	commit->generation = GIT_COMMIT_GRAPH_GENERATION_INFINITY;
 
 	pos = kh_put(oid, walk->commits, &commit->oid, &ret);
 	assert(ret != 0);
@@ -450,11 +453,26 @@ int git_revwalk_new(git_revwalk **revwalk_out, git_repository *repo)
 
 	walk->repo = repo;
 
-	if (git_repository_odb(&walk->odb, repo) < 0) {
+	if (git_repository_odb(&walk->odb, repo) < 0 ||
+		git_repository__shallow_roots(&walk->shallow_roots, repo) < 0) {
 		git_revwalk_free(walk);
 		return -1;
 	}
 
+	/*
+	 * The commit-graph records the full parent list, which a shallow
+	 * clone does not have the objects for
+	 */
+	if (!git_array_size(walk->shallow_roots)) {
+		if (git_repository_commit_graph__weakptr(&walk->graph, repo) < 0) {
+			git_revwalk_free(walk);
+			return -1;
+		}
+
+		if (walk->graph)
+			GIT_REFCOUNT_INC(walk->graph);
+	}
+
 	*revwalk_out = walk;
 	return 0;
 }
@@ -466,6 +484,8 @@ void git_revwalk_free(git_revwalk *walk)
 
 	git_revwalk_reset(walk);
 	git_odb_free(walk->odb);
+	git_commit_graph_free(walk->graph);
+	git_array_clear(walk->shallow_roots);
 
 	git_oidmap_free(walk->commits);
 	git_pool_clear(&walk->commit_pool);
@@ -13,12 +13,14 @@
 #include "pqueue.h"
 #include "pool.h"
 #include "vector.h"
-
-GIT__USE_OIDMAP;
+#include "commit_graph.h"
+#include "repository.h"
 
 struct git_revwalk {
 	git_repository *repo;
 	git_odb *odb;
+	git_commit_graph *graph;
+	git_array_oid_t shallow_roots;
 
 	git_oidmap *commits;
 	git_pool commit_pool;
@@ -9,6 +9,7 @@
 #include "common.h"
 #include "sysdir.h"
 #include "cache.h"
+#include "pack.h"
 
 void git_libgit2_version(int *major, int *minor, int *rev)
 {
@@ -131,6 +132,28 @@ int git_libgit2_opts(int key, ...)
 	case GIT_OPT_SET_TEMPLATE_PATH:
 		error = git_sysdir_set(GIT_SYSDIR_TEMPLATE, va_arg(ap, const char *));
 		break;
+
+	case GIT_OPT_SET_PACK_CACHE_MAX_SIZE:
+		error = git_pack_cache_set_max_size(va_arg(ap, size_t));
+		break;
+
+	case GIT_OPT_SET_PACK_CACHE_OBJECT_LIMIT:
+		git_pack_cache_set_object_limit(va_arg(ap, size_t));
+		break;
+
+	case GIT_OPT_GET_PACK_CACHE_STATS:
+		{
+			size_t *used = va_arg(ap, size_t *);
+			size_t *limit = va_arg(ap, size_t *);
+			size_t *hits = va_arg(ap, size_t *);
+			size_t *misses = va_arg(ap, size_t *);
+			error = git_pack_cache_stats(used, limit, hits, misses);
+			break;
+		}
+
+	case GIT_OPT_RESET_PACK_CACHE_STATS:
+		git_pack_cache_reset_stats();
+		break;
 	}
 
 	va_end(ap);
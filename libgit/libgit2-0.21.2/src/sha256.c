@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "sha256.h"
+
+static const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define CH(x, y, z)  (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define S0(x) (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define S1(x) (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define G0(x) (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define G1(x) (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+static void sha256_block(uint32_t H[8], const unsigned char *data)
+{
+	uint32_t W[64], a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		W[i] = ((uint32_t)data[i * 4] << 24) |
+			((uint32_t)data[i * 4 + 1] << 16) |
+			((uint32_t)data[i * 4 + 2] << 8) |
+			(uint32_t)data[i * 4 + 3];
+
+	for (; i < 64; i++)
+		W[i] = G1(W[i - 2]) + W[i - 7] + G0(W[i - 15]) + W[i - 16];
+
+	a = H[0]; b = H[1]; c = H[2]; d = H[3];
+	e = H[4]; f = H[5]; g = H[6]; h = H[7];
+
+	for (i = 0; i < 64; i++) {
+		t1 = h + S1(e) + CH(e, f, g) + K[i] + W[i];
+		t2 = S0(a) + MAJ(a, b, c);
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+	H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+}
+
+void git_sha256_init(git_sha256_ctx *ctx)
+{
+	ctx->size = 0;
+	ctx->H[0] = 0x6a09e667;
+	ctx->H[1] = 0xbb67ae85;
+	ctx->H[2] = 0x3c6ef372;
+	ctx->H[3] = 0xa54ff53a;
+	ctx->H[4] = 0x510e527f;
+	ctx->H[5] = 0x9b05688c;
+	ctx->H[6] = 0x1f83d9ab;
+	ctx->H[7] = 0x5be0cd19;
+}
+
+void git_sha256_update(git_sha256_ctx *ctx, const void *data, size_t len)
+{
+	const unsigned char *in = data;
+	size_t used = (size_t)(ctx->size & 63);
+
+	ctx->size += len;
+
+	if (used) {
+		size_t left = 64 - used;
+
+		if (len < left) {
+			memcpy(ctx->block + used, in, len);
+			return;
+		}
+
+		memcpy(ctx->block + used, in, left);
+		sha256_block(ctx->H, ctx->block);
+		in += left;
+		len -= left;
+	}
+
+	for (; len >= 64; in += 64, len -= 64)
+		sha256_block(ctx->H, in);
+
+	if (len)
+		memcpy(ctx->block, in, len);
+}
+
+void git_sha256_final(unsigned char out[GIT_SHA256_RAWSZ], git_sha256_ctx *ctx)
+{
+	static const unsigned char pad[64] = { 0x80 };
+	unsigned char length[8];
+	uint64_t bits = ctx->size << 3;
+	size_t used = (size_t)(ctx->size & 63);
+	int i;
+
+	for (i = 0; i < 8; i++)
+		length[i] = (unsigned char)(bits >> (56 - i * 8));
+
+	git_sha256_update(ctx, pad, used < 56 ? 56 - used : 120 - used);
+	git_sha256_update(ctx, length, 8);
+
+	for (i = 0; i < 8; i++) {
+		out[i * 4] = (unsigned char)(ctx->H[i] >> 24);
+		out[i * 4 + 1] = (unsigned char)(ctx->H[i] >> 16);
+		out[i * 4 + 2] = (unsigned char)(ctx->H[i] >> 8);
+		out[i * 4 + 3] = (unsigned char)ctx->H[i];
+	}
+}
+
+void git_sha256_final_hex(char out[GIT_SHA256_HEXSZ + 1], git_sha256_ctx *ctx)
+{
+	static const char hex[] = "0123456789abcdef";
+	unsigned char raw[GIT_SHA256_RAWSZ];
+	int i;
+
+	git_sha256_final(raw, ctx);
+
+	for (i = 0; i < GIT_SHA256_RAWSZ; i++) {
+		out[i * 2] = hex[raw[i] >> 4];
+		out[i * 2 + 1] = hex[raw[i] & 0xf];
+	}
+	out[GIT_SHA256_HEXSZ] = '\0';
+}
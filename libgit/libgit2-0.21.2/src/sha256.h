@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_sha256_h__
+#define INCLUDE_sha256_h__
+
+#include "common.h"
+
+#define GIT_SHA256_RAWSZ 32
+#define GIT_SHA256_HEXSZ (GIT_SHA256_RAWSZ * 2)
+
+/*
+ * Portable SHA-256, used where a format outside of git's own object
+ * model asks for it (large file pointers).  Objects keep using SHA-1.
+ */
+typedef struct {
+	uint64_t size;
+	uint32_t H[8];
+	unsigned char block[64];
+} git_sha256_ctx;
+
+void git_sha256_init(git_sha256_ctx *ctx);
+void git_sha256_update(git_sha256_ctx *ctx, const void *data, size_t len);
+void git_sha256_final(unsigned char out[GIT_SHA256_RAWSZ], git_sha256_ctx *ctx);
+
+/* Lowercase hex digest of the data hashed so far; `out` gets a NUL */
+void git_sha256_final_hex(char out[GIT_SHA256_HEXSZ + 1], git_sha256_ctx *ctx);
+
+#endif
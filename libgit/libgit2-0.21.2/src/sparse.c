@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "common.h"
+#include "sparse.h"
+#include "attr_file.h"
+#include "fileops.h"
+
+static int parse_sparse_file(
+	git_sparse *sparse, const char *data, int ignore_case)
+{
+	int error = 0;
+	const char *scan = data;
+	git_attr_fnmatch *match = NULL;
+
+	while (!error && *scan) {
+		if (!match && !(match = git__calloc(1, sizeof(*match)))) {
+			error = -1;
+			break;
+		}
+
+		match->flags = GIT_ATTR_FNMATCH_ALLOWSPACE | GIT_ATTR_FNMATCH_ALLOWNEG;
+
+		if (!(error = git_attr_fnmatch__parse(
+			match, &sparse->pool, NULL, &scan)))
+		{
+			if (ignore_case)
+				match->flags |= GIT_ATTR_FNMATCH_ICASE;
+
+			scan = git__next_line(scan);
+			error = git_vector_insert(&sparse->rules, match);
+		}
+
+		if (error != 0) {
+			match->pattern = NULL;
+
+			if (error == GIT_ENOTFOUND)
+				error = 0;
+		} else {
+			match = NULL; /* vector now "owns" the match */
+		}
+	}
+
+	git__free(match);
+
+	return error;
+}
+
+int git_sparse__load(git_sparse **out, git_repository *repo)
+{
+	int error, enabled, ignore_case;
+	git_buf path = GIT_BUF_INIT, data = GIT_BUF_INIT;
+	git_sparse *sparse = NULL;
+
+	assert(out && repo);
+
+	*out = NULL;
+
+	if ((error = git_repository__cvar(
+			&enabled, repo, GIT_CVAR_SPARSECHECKOUT)) < 0 || !enabled)
+		return error;
+
+	if ((error = git_repository__cvar(
+			&ignore_case, repo, GIT_CVAR_IGNORECASE)) < 0 ||
+		(error = git_buf_joinpath(&path,
+			git_repository_path(repo), GIT_SPARSE_CHECKOUT_FILE)) < 0)
+		goto done;
+
+	if ((error = git_futils_readbuffer(&data, path.ptr)) < 0) {
+		if (error == GIT_ENOTFOUND) {
+			giterr_clear();
+			error = 0;
+		}
+		goto done;
+	}
+
+	sparse = git__calloc(1, sizeof(git_sparse));
+	GITERR_CHECK_ALLOC(sparse);
+
+	if ((error = git_vector_init(&sparse->rules, 0, NULL)) < 0 ||
+		(error = git_pool_init(&sparse->pool, 1, 0)) < 0 ||
+		(error = parse_sparse_file(sparse, data.ptr, ignore_case)) < 0)
+		goto done;
+
+	*out = sparse;
+	sparse = NULL;
+
+done:
+	git_sparse__free(sparse);
+	git_buf_free(&path);
+	git_buf_free(&data);
+	return error;
+}
+
+int git_sparse__lookup(int *included, git_sparse *sparse, const char *path)
+{
+	git_attr_path info;
+	git_attr_fnmatch *match;
+	char *slash;
+	size_t i;
+
+	*included = 1;
+
+	if (!sparse)
+		return 0;
+
+	if (git_buf_sets(&sparse->scratch, path) < 0)
+		return -1;
+
+	while (sparse->scratch.size > 0 &&
+		sparse->scratch.ptr[sparse->scratch.size - 1] == '/')
+		sparse->scratch.ptr[--sparse->scratch.size] = '\0';
+
+	memset(&info, 0, sizeof(info));
+	info.path = sparse->scratch.ptr;
+
+	/* try the path itself, then each of its parent directories */
+	while (1) {
+		slash = strrchr(info.path, '/');
+		info.basename = slash ? slash + 1 : info.path;
+
+		git_vector_rforeach(&sparse->rules, i, match) {
+			if (git_attr_fnmatch__match(match, &info)) {
+				*included = !(match->flags & GIT_ATTR_FNMATCH_NEGATIVE);
+				return 0;
+			}
+		}
+
+		if (!slash)
+			break;
+
+		*slash = '\0';
+		info.is_dir = 1;
+	}
+
+	*included = 0;
+	return 0;
+}
+
+void git_sparse__free(git_sparse *sparse)
+{
+	if (!sparse)
+		return;
+
+	git_vector_free_deep(&sparse->rules);
+	git_pool_clear(&sparse->pool);
+	git_buf_free(&sparse->scratch);
+	git__free(sparse);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_sparse_h__
+#define INCLUDE_sparse_h__
+
+#include "repository.h"
+#include "vector.h"
+#include "pool.h"
+#include "buffer.h"
+
+#define GIT_SPARSE_CHECKOUT_FILE "info/sparse-checkout"
+
+/*
+ * Sparse checkout patterns from `.git/info/sparse-checkout`, used when
+ * `core.sparseCheckout` is set.  The file uses gitignore syntax but
+ * selects the paths to keep in the working directory: the last pattern
+ * that matches a path (or failing that, one of its parent directories)
+ * decides, and paths no pattern matches are left out.
+ *
+ * Index entries for paths that are left out carry the skip-worktree bit.
+ */
+typedef struct {
+	git_vector rules; /* vector of <git_attr_fnmatch*> */
+	git_pool pool;
+	git_buf scratch;
+} git_sparse;
+
+/*
+ * Loads the patterns for `repo`.  Sets `*out` to NULL when sparse
+ * checkout is not enabled or there is no sparse-checkout file.
+ */
+extern int git_sparse__load(git_sparse **out, git_repository *repo);
+
+/* Sets `*included` to 1 if `path` belongs in the working directory */
+extern int git_sparse__lookup(
+	int *included, git_sparse *sparse, const char *path);
+
+extern void git_sparse__free(git_sparse *sparse);
+
+#endif
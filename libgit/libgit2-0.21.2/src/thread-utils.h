@@ -63,6 +63,7 @@ typedef struct {
 #define git_mutex pthread_mutex_t
 #define git_mutex_init(a)	pthread_mutex_init(a, NULL)
 #define git_mutex_lock(a)	pthread_mutex_lock(a)
+#define git_mutex_trylock(a)	pthread_mutex_trylock(a)
 #define git_mutex_unlock(a) pthread_mutex_unlock(a)
 #define git_mutex_free(a)	pthread_mutex_destroy(a)
 
@@ -192,6 +193,7 @@ GIT_INLINE(int64_t) git_atomic64_add(git_atomic64 *a, int64_t addend)
 #define git_mutex unsigned int
 #define git_mutex_init(a) 0
 #define git_mutex_lock(a) 0
+#define git_mutex_trylock(a) 0
 #define git_mutex_unlock(a) (void)0
 #define git_mutex_free(a) (void)0
 
@@ -36,8 +36,10 @@ typedef struct {
 	git_atomic cancelled;
 	git_repository *repo;
 	git_vector refs;
+	git_array_oid_t haves; /* commits both sides have */
 	unsigned connected : 1,
-		have_refs : 1;
+		have_refs : 1,
+		shallow : 1;
 } transport_local;
 
 static void free_head(git_remote_head *head)
@@ -242,6 +244,53 @@ static int local_ls(const git_remote_head ***out, size_t *size, git_transport *t
 	return 0;
 }
 
+/* Every commit the local refs point to which the remote has too */
+static int find_haves(transport_local *t, git_repository *repo)
+{
+	git_strarray names = {0};
+	git_reference *ref;
+	git_object *commit;
+	git_odb *odb;
+	git_oid *have;
+	size_t i;
+	int error;
+
+	if ((error = git_repository_odb__weakptr(&odb, t->repo)) < 0 ||
+		(error = git_reference_list(&names, repo)) < 0)
+		return error;
+
+	for (i = 0; i < names.count; i++) {
+		if (git_reference_lookup(&ref, repo, names.strings[i]) < 0) {
+			giterr_clear();
+			continue;
+		}
+
+		error = git_reference_peel(&commit, ref, GIT_OBJ_COMMIT);
+		git_reference_free(ref);
+
+		if (error < 0) {
+			giterr_clear();
+			error = 0;
+			continue;
+		}
+
+		if (git_odb_exists(odb, git_object_id(commit))) {
+			have = git_array_alloc(t->haves);
+			if (!have) {
+				git_object_free(commit);
+				error = -1;
+				break;
+			}
+			git_oid_cpy(have, git_object_id(commit));
+		}
+
+		git_object_free(commit);
+	}
+
+	git_strarray_free(&names);
+	return error;
+}
+
 static int local_negotiate_fetch(
 	git_transport *transport,
 	git_repository *repo,
@@ -251,6 +300,7 @@ static int local_negotiate_fetch(
 	transport_local *t = (transport_local*)transport;
 	git_remote_head *rhead;
 	unsigned int i;
+	int error;
 
 	GIT_UNUSED(refs);
 	GIT_UNUSED(count);
@@ -269,7 +319,17 @@ static int local_negotiate_fetch(
 		git_object_free(obj);
 	}
 
-	return 0;
+	git_array_clear(t->haves);
+
+	/*
+	 * A shallow repository lacks the history behind its commits, so we
+	 * can only rely on the tips of the branches being fetched
+	 */
+	if ((error = git_repository_is_shallow(repo)) < 0)
+		return error;
+	t->shallow = !!error;
+
+	return t->shallow ? 0 : find_haves(t, repo);
 }
 
 static int local_push_copy_object(
@@ -498,18 +558,25 @@ static int local_download_pack(
 	git_remote_head *rhead;
 	unsigned int i;
 	int error = -1;
-	git_oid oid;
 	git_packbuilder *pack = NULL;
 	git_odb_writepack *writepack = NULL;
-	git_odb *odb = NULL;
+	git_odb *odb = NULL, *remote_odb;
 
 	if ((error = git_revwalk_new(&walk, t->repo)) < 0)
 		goto cleanup;
 	git_revwalk_sorting(walk, GIT_SORT_TIME);
 
-	if ((error = git_packbuilder_new(&pack, t->repo)) < 0)
+	if ((error = git_packbuilder_new(&pack, t->repo)) < 0 ||
+		(error = git_repository_odb__weakptr(&remote_odb, t->repo)) < 0)
 		goto cleanup;
 
+	/*
+	 * What a shallow repository has stops at its shallow roots, which
+	 * the bitmaps know nothing about
+	 */
+	if (t->shallow)
+		pack->use_bitmaps = false;
+
 	stats->total_objects = 0;
 	stats->indexed_objects = 0;
 	stats->received_objects = 0;
@@ -523,38 +590,31 @@ static int local_download_pack(
 		if (git_object_type(obj) == GIT_OBJ_COMMIT) {
 			/* Revwalker includes only wanted commits */
 			error = git_revwalk_push(walk, &rhead->oid);
-			if (!git_oid_iszero(&rhead->loid))
+			if (!error && !git_oid_iszero(&rhead->loid) &&
+				git_odb_exists(remote_odb, &rhead->loid))
 				error = git_revwalk_hide(walk, &rhead->loid);
 		} else {
 			/* Tag or some other wanted object. Add it on its own */
 			error = git_packbuilder_insert(pack, &rhead->oid, rhead->name);
 		}
 		git_object_free(obj);
-	}
-
-	/* Walk the objects, building a packfile */
-	if ((error = git_repository_odb__weakptr(&odb, repo)) < 0)
-		goto cleanup;
 
-	while ((error = git_revwalk_next(&oid, walk)) == 0) {
-		git_commit *commit;
-
-		/* Skip commits we already have */
-		if (git_odb_exists(odb, &oid)) continue;
+		if (error < 0)
+			goto cleanup;
+	}
 
-		if (!git_object_lookup((git_object**)&commit, t->repo, &oid, GIT_OBJ_COMMIT)) {
-			const git_oid *tree_oid = git_commit_tree_id(commit);
+	/* Everything reachable from what we have needs no sending */
+	for (i = 0; i < git_array_size(t->haves); i++) {
+		if ((error = git_revwalk_hide(walk, git_array_get(t->haves, i))) < 0)
+			goto cleanup;
+	}
 
-			/* Add the commit and its tree */
-			if ((error = git_packbuilder_insert(pack, &oid, NULL)) < 0 ||
-				 (error = git_packbuilder_insert_tree(pack, tree_oid)) < 0) {
-				git_commit_free(commit);
-				goto cleanup;
-			}
+	/* Find the objects, building a packfile */
+	if ((error = git_packbuilder_insert_walk(pack, walk)) < 0)
+		goto cleanup;
 
-			git_commit_free(commit);
-		}
-	}
+	if ((error = git_repository_odb__weakptr(&odb, repo)) < 0)
+		goto cleanup;
 
 	if ((error = git_odb_write_pack(&writepack, odb, progress_cb, progress_payload)) != 0)
 		goto cleanup;
@@ -631,6 +691,7 @@ static void local_free(git_transport *transport)
 		free_head(head);
 
 	git_vector_free(&t->refs);
+	git_array_clear(t->haves);
 
 	/* Close the transport, if it's still open. */
 	local_close(transport);
@@ -250,7 +250,12 @@ int git_smart__negotiation_step(git_transport *transport, void *data, size_t len
 	if ((error = stream->write(stream, (const char *)data, len)) < 0)
 		return error;
 
-	gitno_buffer_setup_callback(NULL, &t->buffer, t->buffer_data, sizeof(t->buffer_data), git_smart__recv_cb, t);
+	/*
+	 * A stateful server may still be answering an earlier step, so keep
+	 * whatever is buffered of that; every RPC request starts afresh.
+	 */
+	if (t->rpc)
+		gitno_buffer_setup_callback(NULL, &t->buffer, t->buffer_data, sizeof(t->buffer_data), git_smart__recv_cb, t);
 
 	return 0;
 }
@@ -331,6 +336,10 @@ static int git_smart__close(git_transport *transport)
 
 	git_vector_free(common);
 
+	git_array_clear(t->shallow_roots);
+	git_array_clear(t->shallow_added);
+	git_array_clear(t->shallow_removed);
+
 	if (t->url) {
 		git__free(t->url);
 		t->url = NULL;
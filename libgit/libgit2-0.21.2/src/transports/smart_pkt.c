@@ -25,6 +25,7 @@ static const char pkt_done_str[] = "0009done\n";
 static const char pkt_flush_str[] = "0000";
 static const char pkt_have_prefix[] = "0032have ";
 static const char pkt_want_prefix[] = "0032want ";
+static const char pkt_shallow_prefix[] = "0035shallow ";
 
 static int flush_pkt(git_pkt **out)
 {
@@ -73,6 +74,31 @@ static int ack_pkt(git_pkt **out, const char *line, size_t len)
 	return 0;
 }
 
+/* "shallow <oid>" and "unshallow <oid>" both carry a single commit id */
+static int shallow_pkt(git_pkt **out, enum git_pkt_type type, const char *line, size_t len)
+{
+	git_pkt_shallow *pkt;
+	const char *id = line + (type == GIT_PKT_SHALLOW ? strlen("shallow ") : strlen("unshallow "));
+
+	if (len < (size_t)(id - line) + GIT_OID_HEXSZ) {
+		giterr_set(GITERR_NET, "Error parsing shallow pkt-line");
+		return -1;
+	}
+
+	pkt = git__malloc(sizeof(git_pkt_shallow));
+	GITERR_CHECK_ALLOC(pkt);
+
+	pkt->type = type;
+	if (git_oid_fromstrn(&pkt->oid, id, GIT_OID_HEXSZ) < 0) {
+		git__free(pkt);
+		return -1;
+	}
+
+	*out = (git_pkt *) pkt;
+
+	return 0;
+}
+
 static int nak_pkt(git_pkt **out)
 {
 	git_pkt *pkt;
@@ -420,6 +446,10 @@ int git_pkt_parse_line(
 		ret = ng_pkt(head, line, len);
 	else if (!git__prefixcmp(line, "unpack"))
 		ret = unpack_pkt(head, line, len);
+	else if (!git__prefixcmp(line, "shallow "))
+		ret = shallow_pkt(head, GIT_PKT_SHALLOW, line, len);
+	else if (!git__prefixcmp(line, "unshallow "))
+		ret = shallow_pkt(head, GIT_PKT_UNSHALLOW, line, len);
 	else
 		ret = ref_pkt(head, line, len);
 
@@ -496,6 +526,30 @@ static int buffer_want_with_caps(const git_remote_head *head, transport_smart_ca
 	return git_buf_oom(buf);
 }
 
+static int buffer_shallow(const git_array_oid_t *shallow_roots, int depth, git_buf *buf)
+{
+	char oid[GIT_OID_HEXSZ];
+	uint32_t i;
+
+	/* Tell the server where our history stops... */
+	for (i = 0; i < git_array_size(*shallow_roots); ++i) {
+		git_oid_fmt(oid, git_array_get(*shallow_roots, i));
+		git_buf_put(buf, pkt_shallow_prefix, strlen(pkt_shallow_prefix));
+		git_buf_put(buf, oid, GIT_OID_HEXSZ);
+		git_buf_putc(buf, '\n');
+	}
+
+	/* ...and where it should stop after this fetch */
+	if (depth > 0) {
+		char line[32];
+		int len = p_snprintf(line, sizeof(line), "deepen %d\n", depth);
+
+		git_buf_printf(buf, "%04x%s", len + PKT_LEN_SIZE, line);
+	}
+
+	return git_buf_oom(buf) ? -1 : 0;
+}
+
 /*
  * All "want" packets have the same length and format, so what we do
  * is overwrite the OID each time.
@@ -505,6 +559,8 @@ int git_pkt_buffer_wants(
 	const git_remote_head * const *refs,
 	size_t count,
 	transport_smart_caps *caps,
+	const git_array_oid_t *shallow_roots,
+	int depth,
 	git_buf *buf)
 {
 	size_t i = 0;
@@ -538,6 +594,9 @@ int git_pkt_buffer_wants(
 			return -1;
 	}
 
+	if (buffer_shallow(shallow_roots, depth, buf) < 0)
+		return -1;
+
 	return git_pkt_buffer_flush(buf);
 }
 
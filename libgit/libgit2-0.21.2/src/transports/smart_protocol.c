@@ -13,6 +13,7 @@
 #include "push.h"
 #include "pack-objects.h"
 #include "remote.h"
+#include "revwalk.h"
 #include "util.h"
 
 #define NETWORK_XFER_THRESHOLD (100*1024)
@@ -185,6 +186,12 @@ int git_smart__detect_caps(git_pkt_ref *pkt, transport_smart_caps *caps, git_vec
 			continue;
 		}
 
+		if (!git__prefixcmp(ptr, GIT_CAP_SHALLOW)) {
+			caps->common = caps->shallow = 1;
+			ptr += strlen(GIT_CAP_SHALLOW);
+			continue;
+		}
+
 		if (!git__prefixcmp(ptr, GIT_CAP_SYMREF)) {
 			int error;
 
@@ -233,44 +240,350 @@ static int recv_pkt(git_pkt **out, gitno_buffer *buf)
 	return pkt_type;
 }
 
-static int store_common(transport_smart *t)
+/*
+ * A deepen request is answered with the commits which become (or stop
+ * being) the boundary of our history, terminated by a flush.
+ */
+static int store_shallow(transport_smart *t)
 {
 	git_pkt *pkt = NULL;
-	gitno_buffer *buf = &t->buffer;
+	git_oid *id;
 	int error;
 
-	do {
-		if ((error = recv_pkt(&pkt, buf)) < 0)
-			return error;
+	/* A stateless server repeats the whole list in every response */
+	git_array_clear(t->shallow_added);
+	git_array_clear(t->shallow_removed);
 
-		if (pkt->type == GIT_PKT_ACK) {
-			if (git_vector_insert(&t->common, pkt) < 0)
-				return -1;
-		} else {
+	while ((error = recv_pkt(&pkt, &t->buffer)) >= 0) {
+		if (pkt->type == GIT_PKT_FLUSH) {
 			git__free(pkt);
+			t->shallow_changed = 1;
 			return 0;
 		}
 
-	} while (1);
+		if (pkt->type == GIT_PKT_SHALLOW)
+			id = git_array_alloc(t->shallow_added);
+		else if (pkt->type == GIT_PKT_UNSHALLOW)
+			id = git_array_alloc(t->shallow_removed);
+		else {
+			if (pkt->type == GIT_PKT_ERR)
+				giterr_set(GITERR_NET, "Remote error: %s", ((git_pkt_err *)pkt)->error);
+			else
+				giterr_set(GITERR_NET, "Unexpected pkt type in the shallow list");
+			git_pkt_free(pkt);
+			return -1;
+		}
 
-	return 0;
+		if (id == NULL) {
+			git_pkt_free(pkt);
+			return -1;
+		}
+
+		git_oid_cpy(id, &((git_pkt_shallow *)pkt)->oid);
+		git_pkt_free(pkt);
+	}
+
+	return error;
+}
+
+static bool shallow_contains(const git_array_oid_t *list, const git_oid *id)
+{
+	uint32_t i;
+
+	for (i = 0; i < git_array_size(*list); i++)
+		if (git_oid_equal(git_array_get(*list, i), id))
+			return true;
+
+	return false;
 }
 
-static int fetch_setup_walk(git_revwalk **out, git_repository *repo)
+/* Record the boundary the server reported once the pack is safely stored */
+static int update_shallow(transport_smart *t, git_repository *repo)
 {
+	git_array_oid_t roots = GIT_ARRAY_INIT;
+	const git_oid *id;
+	git_oid *out;
+	uint32_t i;
+	int error;
+
+	for (i = 0; i < git_array_size(t->shallow_roots); i++) {
+		id = git_array_get(t->shallow_roots, i);
+		if (shallow_contains(&t->shallow_removed, id))
+			continue;
+
+		if ((out = git_array_alloc(roots)) == NULL)
+			return -1;
+		git_oid_cpy(out, id);
+	}
+
+	for (i = 0; i < git_array_size(t->shallow_added); i++) {
+		id = git_array_get(t->shallow_added, i);
+		if (git_repository__is_shallow_root(&t->shallow_roots, id) ||
+			shallow_contains(&t->shallow_removed, id))
+			continue;
+
+		if ((out = git_array_alloc(roots)) == NULL)
+			return -1;
+		git_oid_cpy(out, id);
+	}
+
+	error = git_repository__shallow_roots_write(repo, &roots);
+	git_array_clear(roots);
+
+	return error;
+}
+
+/*
+ * The haves are chosen like git's "skipping" negotiator does: our
+ * history is walked newest first from the tips of our branches, and
+ * every commit sent makes the walk skip more of the commits below it
+ * (half as many again each time) before the next one goes out.  A
+ * long line of commits the server doesn't have is crossed in a
+ * logarithmic number of haves instead of one have per commit.  Once
+ * the server acknowledges a commit, it and all its ancestors are
+ * known to be common and are never sent.  The commits our refs point
+ * to are never skipped: a remote-tracking branch in particular is
+ * where we most likely left off with the server.
+ */
+
+#define NEGOTIATE_SEEN       (1 << 0)
+#define NEGOTIATE_POPPED     (1 << 1)
+#define NEGOTIATE_COMMON     (1 << 2)
+#define NEGOTIATE_ADVERTISED (1 << 3)
+
+/* The number of haves before the first flush, and how that grows */
+#define NEGOTIATE_INITIAL_FLUSH  16
+#define NEGOTIATE_PIPESAFE_FLUSH 32
+#define NEGOTIATE_LARGE_FLUSH    16384
+
+/* Haves sent since the last new common commit before we give up */
+#define NEGOTIATE_MAX_IN_VAIN 256
+
+typedef struct {
+	git_commit_list_node *commit;
+	unsigned int original_ttl;
+	unsigned int ttl;
+	/* the target of a ref, which is never skipped */
+	unsigned int tip : 1;
+} negotiate_entry;
+
+typedef struct {
 	git_revwalk *walk;
+	git_pqueue queue;
+	/* commits in the queue which aren't known to be common */
+	size_t non_common;
+
+	size_t in_vain;
+	unsigned int got_continue : 1,
+		got_ready : 1;
+} fetch_negotiator;
+
+static int negotiate_entry_cmp(const void *a, const void *b)
+{
+	const negotiate_entry *entry_a = a, *entry_b = b;
+
+	return git_commit_list_time_cmp(entry_a->commit, entry_b->commit);
+}
+
+static negotiate_entry *negotiate_push(
+	fetch_negotiator *n, git_commit_list_node *commit, int mark)
+{
+	negotiate_entry *entry;
+
+	if (git_commit_list_parse(n->walk, commit) < 0)
+		return NULL;
+
+	entry = git__calloc(1, sizeof(negotiate_entry));
+	if (entry == NULL)
+		return NULL;
+
+	entry->commit = commit;
+	if (git_pqueue_insert(&n->queue, entry) < 0) {
+		git__free(entry);
+		return NULL;
+	}
+
+	commit->flags |= mark | NEGOTIATE_SEEN;
+	if (!(commit->flags & NEGOTIATE_COMMON))
+		n->non_common++;
+
+	return entry;
+}
+
+static int negotiate_mark_common(fetch_negotiator *n, git_commit_list_node *commit)
+{
+	git_commit_list *todo = NULL;
+	git_commit_list_node *parent;
+	unsigned short i;
+
+	if (git_commit_list_insert(commit, &todo) == NULL)
+		return -1;
+
+	while ((commit = git_commit_list_pop(&todo)) != NULL) {
+		if (commit->flags & NEGOTIATE_COMMON)
+			continue;
+
+		commit->flags |= NEGOTIATE_COMMON;
+		if ((commit->flags & NEGOTIATE_SEEN) && !(commit->flags & NEGOTIATE_POPPED))
+			n->non_common--;
+
+		if (!commit->parsed)
+			continue;
+
+		for (i = 0; i < commit->out_degree; i++) {
+			parent = commit->parents[i];
+
+			if ((parent->flags & NEGOTIATE_SEEN) &&
+				!(parent->flags & NEGOTIATE_COMMON) &&
+				git_commit_list_insert(parent, &todo) == NULL) {
+				git_commit_list_free(&todo);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Returns 1 if `parent` is still to be walked, 0 if it was already */
+static int negotiate_push_parent(
+	fetch_negotiator *n, negotiate_entry *entry, git_commit_list_node *parent)
+{
+	negotiate_entry *parent_entry = NULL;
+	unsigned int original_ttl, ttl;
+	size_t i;
+
+	if (parent->flags & NEGOTIATE_SEEN) {
+		/* clock skew made us pop it before this child */
+		if (parent->flags & NEGOTIATE_POPPED)
+			return 0;
+
+		git_vector_foreach(&n->queue, i, parent_entry) {
+			if (parent_entry->commit == parent)
+				break;
+		}
+		assert(parent_entry && parent_entry->commit == parent);
+	} else if ((parent_entry = negotiate_push(n, parent, 0)) == NULL)
+		return -1;
+
+	if (entry->commit->flags & (NEGOTIATE_COMMON | NEGOTIATE_ADVERTISED))
+		return negotiate_mark_common(n, parent) < 0 ? -1 : 1;
+
+	/* after each commit sent, skip half as many again as last time */
+	original_ttl = entry->ttl ? entry->original_ttl : entry->original_ttl * 3 / 2 + 1;
+	ttl = entry->ttl ? entry->ttl - 1 : original_ttl;
+
+	if (!parent_entry->tip && parent_entry->original_ttl < original_ttl) {
+		parent_entry->original_ttl = original_ttl;
+		parent_entry->ttl = ttl;
+	}
+
+	return 1;
+}
+
+static int negotiate_next(git_oid *out, fetch_negotiator *n)
+{
+	negotiate_entry *entry;
+	git_commit_list_node *commit, *to_send;
+	unsigned short i;
+	int error, parent_pushed;
+
+	while (n->non_common > 0 && (entry = git_pqueue_pop(&n->queue)) != NULL) {
+		commit = entry->commit;
+		commit->flags |= NEGOTIATE_POPPED;
+		to_send = NULL;
+		parent_pushed = 0;
+
+		if (!(commit->flags & NEGOTIATE_COMMON)) {
+			n->non_common--;
+			if (!entry->ttl)
+				to_send = commit;
+		}
+
+		for (i = 0; i < commit->out_degree; i++) {
+			if ((error = negotiate_push_parent(n, entry, commit->parents[i])) < 0) {
+				git__free(entry);
+				return error;
+			}
+			parent_pushed |= error;
+		}
+
+		/* the end of a line is always worth telling about */
+		if (!(commit->flags & NEGOTIATE_COMMON) && !parent_pushed)
+			to_send = commit;
+
+		git__free(entry);
+
+		if (to_send) {
+			git_oid_cpy(out, &to_send->oid);
+			return 0;
+		}
+	}
+
+	return GIT_ITEROVER;
+}
+
+static int negotiate_push_ref(
+	fetch_negotiator *n, const git_oid *id, int mark)
+{
+	git_commit_list_node *commit;
+	negotiate_entry *entry;
+	size_t len;
+	git_otype type;
+	int error;
+
+	/* only commits take part, and the server's may be unknown to us */
+	if ((error = git_odb_read_header(&len, &type, n->walk->odb, id)) < 0) {
+		if (error != GIT_ENOTFOUND || mark != NEGOTIATE_ADVERTISED)
+			return error;
+
+		giterr_clear();
+		return 0;
+	}
+
+	if (type != GIT_OBJ_COMMIT)
+		return 0;
+
+	if ((commit = git_revwalk__commit_lookup(n->walk, id)) == NULL)
+		return -1;
+
+	if (commit->flags & NEGOTIATE_SEEN)
+		return 0;
+
+	if ((entry = negotiate_push(n, commit, mark)) == NULL)
+		return -1;
+
+	entry->tip = 1;
+	return 0;
+}
+
+static void negotiator_free(fetch_negotiator *n)
+{
+	negotiate_entry *entry;
+
+	while ((entry = git_pqueue_pop(&n->queue)) != NULL)
+		git__free(entry);
+
+	git_pqueue_free(&n->queue);
+	git_revwalk_free(n->walk);
+}
+
+static int negotiator_init(fetch_negotiator *n, transport_smart *t, git_repository *repo)
+{
 	git_strarray refs;
-	unsigned int i;
-	git_reference *ref;
+	git_reference *ref = NULL;
+	git_pkt_ref *pkt;
+	size_t i;
 	int error;
 
-	if ((error = git_reference_list(&refs, repo)) < 0)
-		return error;
+	memset(n, 0, sizeof(*n));
 
-	if ((error = git_revwalk_new(&walk, repo)) < 0)
+	if ((error = git_revwalk_new(&n->walk, repo)) < 0)
 		return error;
 
-	git_revwalk_sorting(walk, GIT_SORT_TIME);
+	if ((error = git_pqueue_init(&n->queue, 0, 8, negotiate_entry_cmp)) < 0 ||
+		(error = git_reference_list(&refs, repo)) < 0)
+		return error;
 
 	for (i = 0; i < refs.count; ++i) {
 		/* No tags */
@@ -278,51 +591,150 @@ static int fetch_setup_walk(git_revwalk **out, git_repository *repo)
 			continue;
 
 		if ((error = git_reference_lookup(&ref, repo, refs.strings[i])) < 0)
-			goto on_error;
-
-		if (git_reference_type(ref) == GIT_REF_SYMBOLIC)
-			continue;
+			break;
 
-		if ((error = git_revwalk_push(walk, git_reference_target(ref))) < 0)
-			goto on_error;
+		if (git_reference_type(ref) != GIT_REF_SYMBOLIC &&
+			(error = negotiate_push_ref(n, git_reference_target(ref), 0)) < 0)
+			break;
 
 		git_reference_free(ref);
+		ref = NULL;
 	}
 
+	git_reference_free(ref);
 	git_strarray_free(&refs);
-	*out = walk;
+
+	if (error < 0)
+		return error;
+
+	/* What the server advertised and we have is common already */
+	git_vector_foreach(&t->refs, i, pkt) {
+		if (pkt->type == GIT_PKT_REF &&
+			(error = negotiate_push_ref(n, &pkt->head.oid, NEGOTIATE_ADVERTISED)) < 0)
+			return error;
+	}
+
 	return 0;
+}
+
+/*
+ * Read the server's answer to one batch of haves: the ACKs for the
+ * commits it has, up to the NAK which ends each answer.
+ */
+static int negotiate_recv_acks(fetch_negotiator *n, transport_smart *t)
+{
+	git_pkt_ack *pkt;
+	git_commit_list_node *commit;
+	int error, was_common;
+
+	while ((error = recv_pkt((git_pkt **)&pkt, &t->buffer)) >= 0) {
+		if (pkt->type == GIT_PKT_NAK) {
+			git__free(pkt);
+			return 0;
+		}
+
+		if (pkt->type != GIT_PKT_ACK) {
+			if (pkt->type == GIT_PKT_ERR)
+				giterr_set(GITERR_NET, "Remote error: %s", ((git_pkt_err *)pkt)->error);
+			else
+				giterr_set(GITERR_NET, "Unexpected pkt type");
+			git_pkt_free((git_pkt *)pkt);
+			return -1;
+		}
+
+		if (pkt->status == GIT_ACK_READY)
+			n->got_ready = 1;
+
+		if ((commit = git_revwalk__commit_lookup(n->walk, &pkt->oid)) == NULL) {
+			git__free(pkt);
+			return -1;
+		}
+
+		was_common = (commit->flags & NEGOTIATE_COMMON) != 0;
+
+		if (negotiate_mark_common(n, commit) < 0) {
+			git__free(pkt);
+			return -1;
+		}
+
+		if (was_common) {
+			git__free(pkt);
+			continue;
+		}
+
+		n->in_vain = 0;
+		n->got_continue = 1;
+
+		/*
+		 * A stateless server has to be told of common commits again
+		 * with each request. "ready" may come with a have the server
+		 * doesn't know, to tell it has heard enough.
+		 */
+		if (pkt->status == GIT_ACK_READY ||
+			(pkt->status == GIT_ACK_CONTINUE && t->caps.multi_ack_detailed)) {
+			git__free(pkt);
+			continue;
+		}
+
+		if (git_vector_insert(&t->common, pkt) < 0) {
+			git__free(pkt);
+			return -1;
+		}
+	}
 
-on_error:
-	git_reference_free(ref);
-	git_strarray_free(&refs);
 	return error;
 }
 
-static int wait_while_ack(gitno_buffer *buf)
+/* After "done", the server ends negotiation with a last ACK or a NAK */
+static int negotiate_recv_final(gitno_buffer *buf)
 {
+	git_pkt_ack *pkt;
 	int error;
-	git_pkt_ack *pkt = NULL;
 
-	while (1) {
+	while ((error = recv_pkt((git_pkt **)&pkt, buf)) >= 0) {
+		if (pkt->type == GIT_PKT_NAK ||
+			(pkt->type == GIT_PKT_ACK && pkt->status == GIT_ACK_NONE)) {
+			git__free(pkt);
+			return 0;
+		}
+
+		if (pkt->type != GIT_PKT_ACK) {
+			giterr_set(GITERR_NET, "Unexpected pkt type");
+			git_pkt_free((git_pkt *)pkt);
+			return -1;
+		}
+
 		git__free(pkt);
+	}
 
-		if ((error = recv_pkt((git_pkt **)&pkt, buf)) < 0)
-			return error;
+	return error;
+}
 
-		if (pkt->type == GIT_PKT_NAK)
-			break;
+static size_t negotiate_next_flush(transport_smart *t, size_t count)
+{
+	if (t->rpc)
+		return count < NEGOTIATE_LARGE_FLUSH ? count * 2 : count * 11 / 10;
 
-		if (pkt->type == GIT_PKT_ACK &&
-		    (pkt->status != GIT_ACK_CONTINUE ||
-		     pkt->status != GIT_ACK_COMMON)) {
-			git__free(pkt);
-			return 0;
-		}
+	return count < NEGOTIATE_PIPESAFE_FLUSH ? count * 2 : count + NEGOTIATE_PIPESAFE_FLUSH;
+}
+
+/* Start a stateless request over with the wants and what we know to be common */
+static int negotiate_rpc_request(
+	git_buf *data, transport_smart *t, const git_remote_head * const *wants, size_t count, int depth)
+{
+	git_pkt_ack *pkt;
+	size_t i;
+	int error;
+
+	if ((error = git_pkt_buffer_wants(wants, count, &t->caps, &t->shallow_roots, depth, data)) < 0)
+		return error;
+
+	git_vector_foreach(&t->common, i, pkt) {
+		if ((error = git_pkt_buffer_have(&pkt->oid, data)) < 0)
+			return error;
 	}
 
-	git__free(pkt);
-	return 0;
+	return git_buf_oom(data) ? -1 : 0;
 }
 
 int git_smart__negotiate_fetch(git_transport *transport, git_repository *repo, const git_remote_head * const *wants, size_t count)
@@ -330,116 +742,131 @@ int git_smart__negotiate_fetch(git_transport *transport, git_repository *repo, c
 	transport_smart *t = (transport_smart *)transport;
 	gitno_buffer *buf = &t->buffer;
 	git_buf data = GIT_BUF_INIT;
-	git_revwalk *walk = NULL;
-	int error = -1, pkt_type;
-	unsigned int i;
+	fetch_negotiator n;
+	int error = -1, pkt_type, depth, multi_ack;
+	size_t haves = 0, flush_at = NEGOTIATE_INITIAL_FLUSH, flushes = 0, i;
+	git_pkt *pkt;
 	git_oid oid;
 
-	if ((error = git_pkt_buffer_wants(wants, count, &t->caps, &data)) < 0)
+	memset(&n, 0, sizeof(n));
+	depth = t->owner ? git_remote_depth(t->owner) : 0;
+	multi_ack = t->caps.multi_ack || t->caps.multi_ack_detailed;
+
+	git_vector_foreach(&t->common, i, pkt)
+		git_pkt_free(pkt);
+	git_vector_clear(&t->common);
+
+	git_array_clear(t->shallow_roots);
+	git_array_clear(t->shallow_added);
+	git_array_clear(t->shallow_removed);
+	t->shallow_changed = 0;
+
+	if ((error = git_repository__shallow_roots(&t->shallow_roots, repo)) < 0)
 		return error;
 
-	if ((error = fetch_setup_walk(&walk, repo)) < 0)
-		goto on_error;
+	if ((depth > 0 || git_array_size(t->shallow_roots) > 0) && !t->caps.shallow) {
+		giterr_set(GITERR_NET, "The remote does not support shallow clients");
+		return -1;
+	}
+
+	if ((error = git_pkt_buffer_wants(wants, count, &t->caps, &t->shallow_roots, depth, &data)) < 0)
+		return error;
 
 	/*
-	 * Our support for ACK extensions is simply to parse them. On
-	 * the first ACK we will accept that as enough common
-	 * objects. We give up if we haven't found an answer in the
-	 * first 256 we send.
+	 * The server answers a deepen request with the new boundary of our
+	 * history before it looks at any haves, so that has to be a round
+	 * trip of its own.
 	 */
-	i = 0;
-	while (i < 256) {
-		error = git_revwalk_next(&oid, walk);
+	if (depth > 0) {
+		/* For RPC an empty set of haves ends the request */
+		if (t->rpc && (error = git_pkt_buffer_flush(&data)) < 0)
+			goto on_error;
 
-		if (error < 0) {
-			if (GIT_ITEROVER == error)
-				break;
+		if ((error = git_smart__negotiation_step(&t->parent, data.ptr, data.size)) < 0 ||
+			(error = store_shallow(t)) < 0)
+			goto on_error;
+
+		git_buf_clear(&data);
 
+		/* ...and a stateless server needs to be told everything again */
+		if (t->rpc &&
+			(error = git_pkt_buffer_wants(wants, count, &t->caps, &t->shallow_roots, depth, &data)) < 0)
 			goto on_error;
-		}
+	}
 
-		git_pkt_buffer_have(&oid, &data);
-		i++;
-		if (i % 20 == 0) {
-			if (t->cancelled.val) {
-				giterr_set(GITERR_NET, "The fetch was cancelled by the user");
-				error = GIT_EUSER;
-				goto on_error;
-			}
+	if ((error = negotiator_init(&n, t, repo)) < 0)
+		goto on_error;
 
-			git_pkt_buffer_flush(&data);
-			if (git_buf_oom(&data)) {
-				error = -1;
-				goto on_error;
-			}
+	while ((error = negotiate_next(&oid, &n)) == 0) {
+		if ((error = git_pkt_buffer_have(&oid, &data)) < 0)
+			goto on_error;
 
-			if ((error = git_smart__negotiation_step(&t->parent, data.ptr, data.size)) < 0)
-				goto on_error;
+		n.in_vain++;
+		if (++haves < flush_at)
+			continue;
 
-			git_buf_clear(&data);
-			if (t->caps.multi_ack || t->caps.multi_ack_detailed) {
-				if ((error = store_common(t)) < 0)
-					goto on_error;
-			} else {
-				pkt_type = recv_pkt(NULL, buf);
-
-				if (pkt_type == GIT_PKT_ACK) {
-					break;
-				} else if (pkt_type == GIT_PKT_NAK) {
-					continue;
-				} else if (pkt_type < 0) {
-					/* recv_pkt returned an error */
-					error = pkt_type;
-					goto on_error;
-				} else {
-					giterr_set(GITERR_NET, "Unexpected pkt type");
-					error = -1;
-					goto on_error;
-				}
-			}
+		if (t->cancelled.val) {
+			giterr_set(GITERR_NET, "The fetch was cancelled by the user");
+			error = GIT_EUSER;
+			goto on_error;
 		}
 
-		if (t->common.length > 0)
-			break;
+		if ((error = git_pkt_buffer_flush(&data)) < 0 ||
+			(error = git_smart__negotiation_step(&t->parent, data.ptr, data.size)) < 0)
+			goto on_error;
+
+		git_buf_clear(&data);
+		flushes++;
+		flush_at = negotiate_next_flush(t, haves);
 
-		if (i % 20 == 0 && t->rpc) {
-			git_pkt_ack *pkt;
-			unsigned int i;
+		/*
+		 * A stateful server can work on one batch while we send the
+		 * next, so we're always one answer behind.
+		 */
+		if (!t->rpc && multi_ack && flushes == 1)
+			continue;
+
+		if (t->rpc && depth > 0 && (error = store_shallow(t)) < 0)
+			goto on_error;
 
-			if ((error = git_pkt_buffer_wants(wants, count, &t->caps, &data)) < 0)
+		if (multi_ack) {
+			if ((error = negotiate_recv_acks(&n, t)) < 0)
+				goto on_error;
+		} else {
+			if ((error = recv_pkt(&pkt, buf)) < 0)
 				goto on_error;
 
-			git_vector_foreach(&t->common, i, pkt) {
-				if ((error = git_pkt_buffer_have(&pkt->oid, &data)) < 0)
+			if (pkt->type == GIT_PKT_ACK) {
+				/* without multi_ack the first common commit is all we get */
+				n.got_ready = 1;
+				if ((error = git_vector_insert(&t->common, pkt)) < 0) {
+					git__free(pkt);
 					goto on_error;
-			}
-
-			if (git_buf_oom(&data)) {
+				}
+			} else if (pkt->type == GIT_PKT_NAK) {
+				git__free(pkt);
+			} else {
+				giterr_set(GITERR_NET, "Unexpected pkt type");
+				git_pkt_free(pkt);
 				error = -1;
 				goto on_error;
 			}
 		}
-	}
 
-	/* Tell the other end that we're done negotiating */
-	if (t->rpc && t->common.length > 0) {
-		git_pkt_ack *pkt;
-		unsigned int i;
+		flushes--;
 
-		if ((error = git_pkt_buffer_wants(wants, count, &t->caps, &data)) < 0)
+		if (t->rpc && (error = negotiate_rpc_request(&data, t, wants, count, depth)) < 0)
 			goto on_error;
 
-		git_vector_foreach(&t->common, i, pkt) {
-			if ((error = git_pkt_buffer_have(&pkt->oid, &data)) < 0)
-				goto on_error;
-		}
-
-		if (git_buf_oom(&data)) {
-			error = -1;
-			goto on_error;
-		}
+		/* The server has enough to go on, or we aren't getting anywhere */
+		if (n.got_ready || (n.got_continue && n.in_vain > NEGOTIATE_MAX_IN_VAIN))
+			break;
 	}
 
+	if (error < 0 && error != GIT_ITEROVER)
+		goto on_error;
+
+	/* Tell the other end that we're done negotiating */
 	if ((error = git_pkt_buffer_done(&data)) < 0)
 		goto on_error;
 
@@ -451,27 +878,36 @@ int git_smart__negotiate_fetch(git_transport *transport, git_repository *repo, c
 	if ((error = git_smart__negotiation_step(&t->parent, data.ptr, data.size)) < 0)
 		goto on_error;
 
-	git_buf_free(&data);
-	git_revwalk_free(walk);
+	if (t->rpc && depth > 0 && (error = store_shallow(t)) < 0)
+		goto on_error;
 
 	/* Now let's eat up whatever the server gives us */
-	if (!t->caps.multi_ack && !t->caps.multi_ack_detailed) {
-		pkt_type = recv_pkt(NULL, buf);
+	if (!multi_ack) {
+		/* ...which is nothing more once it has acknowledged a commit */
+		if (!n.got_ready) {
+			pkt_type = recv_pkt(NULL, buf);
 
-		if (pkt_type < 0) {
-			return pkt_type;
-		} else if (pkt_type != GIT_PKT_ACK && pkt_type != GIT_PKT_NAK) {
-			giterr_set(GITERR_NET, "Unexpected pkt type");
-			return -1;
+			if (pkt_type < 0) {
+				error = pkt_type;
+				goto on_error;
+			} else if (pkt_type != GIT_PKT_ACK && pkt_type != GIT_PKT_NAK) {
+				giterr_set(GITERR_NET, "Unexpected pkt type");
+				error = -1;
+				goto on_error;
+			}
 		}
 	} else {
-		error = wait_while_ack(buf);
-	}
+		/* answers to the batches still on their way come first */
+		for (; flushes > 0; flushes--) {
+			if ((error = negotiate_recv_acks(&n, t)) < 0)
+				goto on_error;
+		}
 
-	return error;
+		error = negotiate_recv_final(buf);
+	}
 
 on_error:
-	git_revwalk_free(walk);
+	negotiator_free(&n);
 	git_buf_free(&data);
 	return error;
 }
@@ -624,6 +1060,9 @@ int git_smart__download_pack(
 	error = writepack->commit(writepack, stats);
 
 done:
+	if (!error && t->shallow_changed)
+		error = update_shallow(t, repo);
+
 	if (writepack)
 		writepack->free(writepack);
 	if (transfer_progress_cb) {
@@ -6,6 +6,7 @@
  */
 
 #include "tree-cache.h"
+#include "tree.h"
 
 static git_tree_cache *find_child(
 	const git_tree_cache *tree, const char *path, const char *end)
@@ -61,7 +62,7 @@ const git_tree_cache *git_tree_cache_get(const git_tree_cache *tree, const char
 		if (tree == NULL) /* Can't find it */
 			return NULL;
 
-		if (end == NULL || *end + 1 == '\0')
+		if (end == NULL || *(end + 1) == '\0')
 			return tree;
 
 		ptr = end + 1;
@@ -164,6 +165,163 @@ int git_tree_cache_read(git_tree_cache **tree, const char *buffer, size_t buffer
 	return 0;
 }
 
+static int write_tree(git_buf *out, git_tree_cache *tree)
+{
+	size_t i;
+
+	/* NUL-terminated name, then the counts of entries and subtrees */
+	git_buf_put(out, tree->name, tree->namelen + 1);
+	git_buf_printf(out, "%d %d\n", (int)tree->entries, (int)tree->children_count);
+
+	/* the id is only there for a valid tree */
+	if (tree->entries >= 0)
+		git_buf_put(out, (const char *)tree->oid.id, GIT_OID_RAWSZ);
+
+	for (i = 0; i < tree->children_count; i++)
+		write_tree(out, tree->children[i]);
+
+	return git_buf_oom(out) ? -1 : 0;
+}
+
+int git_tree_cache_write(git_buf *out, git_tree_cache *tree)
+{
+	return write_tree(out, tree);
+}
+
+int git_tree_cache_new(
+	git_tree_cache **out, const char *name, size_t namelen, git_tree_cache *parent)
+{
+	git_tree_cache *tree;
+
+	tree = git__calloc(1, sizeof(git_tree_cache) + namelen + 1);
+	GITERR_CHECK_ALLOC(tree);
+
+	tree->parent = parent;
+	tree->entries = -1;
+	tree->namelen = namelen;
+	memcpy(tree->name, name, namelen);
+	tree->name[namelen] = '\0';
+
+	*out = tree;
+	return 0;
+}
+
+static int read_tree_recursive(git_tree_cache *cache, const git_tree *tree)
+{
+	git_repository *repo = git_tree_owner(tree);
+	const git_tree_entry *entry;
+	git_tree *subtree;
+	size_t i, nchildren = 0, ntrees = 0;
+	int error;
+
+	git_oid_cpy(&cache->oid, git_tree_id(tree));
+	cache->entries = 0;
+
+	for (i = 0; i < git_tree_entrycount(tree); i++) {
+		if (git_tree_entry__is_tree(git_tree_entry_byindex(tree, i)))
+			ntrees++;
+	}
+
+	if (ntrees) {
+		cache->children = git__calloc(ntrees, sizeof(git_tree_cache *));
+		GITERR_CHECK_ALLOC(cache->children);
+	}
+
+	for (i = 0; i < git_tree_entrycount(tree); i++) {
+		entry = git_tree_entry_byindex(tree, i);
+
+		/* every non-tree entry becomes an index entry */
+		if (!git_tree_entry__is_tree(entry)) {
+			cache->entries++;
+			continue;
+		}
+
+		if ((error = git_tree_cache_new(&cache->children[nchildren],
+				entry->filename, entry->filename_len, cache)) < 0)
+			return error;
+
+		cache->children_count = ++nchildren;
+
+		if ((error = git_tree_lookup(&subtree, repo, &entry->oid)) < 0)
+			return error;
+
+		error = read_tree_recursive(cache->children[nchildren - 1], subtree);
+		git_tree_free(subtree);
+
+		if (error < 0)
+			return error;
+
+		cache->entries += cache->children[nchildren - 1]->entries;
+	}
+
+	return 0;
+}
+
+int git_tree_cache_read_tree(git_tree_cache **out, const git_tree *tree)
+{
+	git_tree_cache *cache;
+
+	if (git_tree_cache_new(&cache, "", 0, NULL) < 0)
+		return -1;
+
+	if (read_tree_recursive(cache, tree) < 0) {
+		git_tree_cache_free(cache);
+		return -1;
+	}
+
+	*out = cache;
+	return 0;
+}
+
+int git_tree_cache_use_child(
+	git_tree_cache **out, git_tree_cache *tree, size_t *used,
+	const char *name, size_t namelen)
+{
+	git_tree_cache *child = NULL, **children;
+	size_t i;
+
+	for (i = *used; i < tree->children_count; ++i) {
+		if (tree->children[i]->namelen == namelen &&
+			!memcmp(name, tree->children[i]->name, namelen)) {
+			child = tree->children[i];
+			break;
+		}
+	}
+
+	if (child == NULL) {
+		if (git_tree_cache_new(&child, name, namelen, tree) < 0)
+			return -1;
+
+		children = git__realloc(tree->children,
+			(tree->children_count + 1) * sizeof(git_tree_cache *));
+		if (!children) {
+			git_tree_cache_free(child);
+			return -1;
+		}
+
+		tree->children = children;
+		i = tree->children_count++;
+		tree->children[i] = child;
+	}
+
+	/* swap it in with the children already used */
+	tree->children[i] = tree->children[*used];
+	tree->children[(*used)++] = child;
+
+	*out = child;
+	return 0;
+}
+
+void git_tree_cache_prune(git_tree_cache *tree, size_t used)
+{
+	size_t i;
+
+	for (i = used; i < tree->children_count; ++i)
+		git_tree_cache_free(tree->children[i]);
+
+	tree->children_count = used;
+}
+
 void git_tree_cache_free(git_tree_cache *tree)
 {
 	unsigned int i;
@@ -9,7 +9,9 @@
 #define INCLUDE_tree_cache_h__
 
 #include "common.h"
+#include "buffer.h"
 #include "git2/oid.h"
+#include "git2/tree.h"
 
 struct git_tree_cache {
 	struct git_tree_cache *parent;
@@ -25,8 +27,23 @@ struct git_tree_cache {
 typedef struct git_tree_cache git_tree_cache;
 
 int git_tree_cache_read(git_tree_cache **tree, const char *buffer, size_t buffer_size);
+int git_tree_cache_write(git_buf *out, git_tree_cache *tree);
+int git_tree_cache_new(git_tree_cache **out, const char *name, size_t namelen, git_tree_cache *parent);
+int git_tree_cache_read_tree(git_tree_cache **out, const git_tree *tree);
 void git_tree_cache_invalidate_path(git_tree_cache *tree, const char *path);
 const git_tree_cache *git_tree_cache_get(const git_tree_cache *tree, const char *path);
+
+/*
+ * Find the child `name` of `tree`, adding an invalidated one if there is
+ * none, and move it among the first `*used` children, which it counts
+ * in. Once all of a tree's subtrees have been looked up this way,
+ * `git_tree_cache_prune` drops the children which were not.
+ */
+int git_tree_cache_use_child(
+	git_tree_cache **out, git_tree_cache *tree, size_t *used,
+	const char *name, size_t namelen);
+void git_tree_cache_prune(git_tree_cache *tree, size_t used);
+
 void git_tree_cache_free(git_tree_cache *tree);
 
 #endif
@@ -474,16 +474,15 @@ static int write_tree(
 	git_repository *repo,
 	git_index *index,
 	const char *dirname,
-	size_t start)
+	size_t start,
+	git_tree_cache *cache)
 {
 	git_treebuilder *bld = NULL;
-	size_t i, entries = git_index_entrycount(index);
+	size_t i, entries = git_index_entrycount(index), used = 0;
 	int error;
 	size_t dirname_len = strlen(dirname);
-	const git_tree_cache *cache;
 
-	cache = git_tree_cache_get(index->tree, dirname);
-	if (cache != NULL && cache->entries >= 0){
+	if (cache->entries >= 0) {
 		git_oid_cpy(oid, &cache->oid);
 		return (int)find_next_dir(dirname, index, start);
 	}
@@ -522,12 +521,18 @@ static int write_tree(
 			git_oid sub_oid;
 			int written;
 			char *subdir, *last_comp;
+			git_tree_cache *subcache;
 
 			subdir = git__strndup(entry->path, next_slash - entry->path);
 			GITERR_CHECK_ALLOC(subdir);
 
-			/* Write out the subtree */
-			written = write_tree(&sub_oid, repo, index, subdir, i);
+			/* Write out the subtree, or reuse it if it is cached */
+			if (git_tree_cache_use_child(&subcache, cache, &used,
+					filename, next_slash - filename) < 0)
+				written = -1;
+			else
+				written = write_tree(&sub_oid, repo, index, subdir, i, subcache);
+
 			if (written < 0) {
 				git__free(subdir);
 				goto on_error;
@@ -562,6 +567,11 @@ static int write_tree(
 	if (git_treebuilder_write(oid, repo, bld) < 0)
 		goto on_error;
 
+	/* remember the tree, and forget subtrees which are gone */
+	git_oid_cpy(&cache->oid, oid);
+	cache->entries = (ssize_t)(i - start);
+	git_tree_cache_prune(cache, used);
+
 	git_treebuilder_free(bld);
 	return (int)i;
 
@@ -589,6 +599,11 @@ int git_tree__write_index(
 		return 0;
 	}
 
+	/* the trees we write are cached for next time */
+	if (index->tree == NULL &&
+		git_tree_cache_new(&index->tree, "", 0, NULL) < 0)
+		return -1;
+
 	/* The tree cache didn't help us; we'll have to write
 	 * out a tree. If the index is ignore_case, we must
 	 * make it case-sensitive for the duration of the tree-write
@@ -599,7 +614,7 @@ int git_tree__write_index(
 		git_index__set_ignore_case(index, false);
 	}
 
-	ret = write_tree(oid, repo, index, "", 0);
+	ret = write_tree(oid, repo, index, "", 0, index->tree);
 
 	if (old_ignore_case)
 		git_index__set_ignore_case(index, true);
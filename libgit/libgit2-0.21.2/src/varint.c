@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+
+#include "varint.h"
+
+#define VARINT_MAX_LEN ((sizeof(uintmax_t) * 8 + 6) / 7)
+
+int git_encode_varint(unsigned char *buf, size_t bufsize, uintmax_t value)
+{
+	unsigned char varint[VARINT_MAX_LEN];
+	size_t pos = sizeof(varint) - 1;
+
+	varint[pos] = value & 127;
+	while (value >>= 7)
+		varint[--pos] = 128 | (--value & 127);
+
+	if (buf) {
+		if (bufsize < sizeof(varint) - pos)
+			return -1;
+		memcpy(buf, varint + pos, sizeof(varint) - pos);
+	}
+
+	return (int)(sizeof(varint) - pos);
+}
+
+uintmax_t git_decode_varint(
+	size_t *varint_len, const unsigned char *buf, size_t bufsize)
+{
+	const unsigned char *p = buf, *end = buf + bufsize;
+	unsigned char c;
+	uintmax_t value;
+
+	*varint_len = 0;
+
+	if (p >= end)
+		return 0;
+
+	c = *p++;
+	value = c & 127;
+
+	while (c & 128) {
+		value += 1;
+
+		/* the value would not survive the next shift */
+		if (!value || (value >> (sizeof(uintmax_t) * 8 - 7)) || p >= end)
+			return 0;
+
+		c = *p++;
+		value = (value << 7) + (c & 127);
+	}
+
+	*varint_len = p - buf;
+	return value;
+}
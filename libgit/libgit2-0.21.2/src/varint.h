@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) the libgit2 contributors. All rights reserved.
+ *
+ * This file is part of libgit2, distributed under the GNU GPL v2 with
+ * a Linking Exception. For full terms see the included COPYING file.
+ */
+#ifndef INCLUDE_varint_h__
+#define INCLUDE_varint_h__
+
+#include "common.h"
+
+/*
+ * The variable length integers of git's index version 4: seven bits per
+ * byte, most significant first, the high bit set on every byte but the
+ * last, and one added to the value carried on to each following byte.
+ */
+
+/*
+ * Encode `value` into `buf`, returning the number of bytes used, or -1
+ * if `bufsize` is too small. With a NULL `buf`, only count the bytes.
+ */
+extern int git_encode_varint(unsigned char *buf, size_t bufsize, uintmax_t value);
+
+/*
+ * Decode the integer at the start of `buf`, setting `varint_len` to its
+ * length in bytes, or to 0 when it is truncated or overflows.
+ */
+extern uintmax_t git_decode_varint(
+	size_t *varint_len, const unsigned char *buf, size_t bufsize);
+
+#endif
@@ -0,0 +1,268 @@
+#include "clar_libgit2.h"
+#include "git2/checkout.h"
+#include "fileops.h"
+#include "repository.h"
+#include "sparse.h"
+
+static git_repository *g_repo;
+
+static const char *g_files[] = {
+	"README.md",
+	"assets/android/icon.png",
+	"assets/common/logo.png",
+	"assets/ios/icon.png",
+	"src/main.c",
+	NULL
+};
+
+void test_checkout_sparse__initialize(void)
+{
+	git_index *index;
+	git_buf path = GIT_BUF_INIT;
+	const char **file;
+
+	cl_git_pass(git_repository_init(&g_repo, "sparse", false));
+	cl_git_pass(git_repository_index(&index, g_repo));
+
+	for (file = g_files; *file; file++) {
+		git_buf_clear(&path);
+		cl_git_pass(git_buf_joinpath(&path, "sparse", *file));
+		cl_git_pass(git_futils_mkpath2file(path.ptr, 0777));
+		cl_git_mkfile(path.ptr, *file);
+		cl_git_pass(git_index_add_bypath(index, *file));
+	}
+
+	cl_git_pass(git_index_write(index));
+	cl_repo_commit_from_index(NULL, g_repo, NULL, 0, "assets");
+
+	git_index_free(index);
+	git_buf_free(&path);
+}
+
+void test_checkout_sparse__cleanup(void)
+{
+	git_repository_free(g_repo);
+	g_repo = NULL;
+	cl_fixture_cleanup("sparse");
+}
+
+static void set_patterns(const char *patterns)
+{
+	git_config *cfg;
+
+	cl_git_mkfile("sparse/.git/" GIT_SPARSE_CHECKOUT_FILE, patterns);
+
+	cl_git_pass(git_repository_config(&cfg, g_repo));
+	cl_git_pass(git_config_set_bool(cfg, "core.sparseCheckout", true));
+	git_config_free(cfg);
+}
+
+static void checkout_head(unsigned int strategy)
+{
+	git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+
+	opts.checkout_strategy = strategy;
+	cl_git_pass(git_checkout_head(g_repo, &opts));
+}
+
+static bool is_skip_worktree(const char *path)
+{
+	git_index *index;
+	const git_index_entry *entry;
+	bool skipped;
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	cl_git_pass(git_index_read(index, true));
+	cl_assert((entry = git_index_get_bypath(index, path, 0)) != NULL);
+
+	skipped = (entry->flags_extended & GIT_IDXENTRY_SKIP_WORKTREE) != 0;
+
+	git_index_free(index);
+	return skipped;
+}
+
+static size_t status_count(void)
+{
+	git_status_list *status;
+	size_t count;
+
+	cl_git_pass(git_status_list_new(&status, g_repo, NULL));
+	count = git_status_list_entrycount(status);
+	git_status_list_free(status);
+
+	return count;
+}
+
+void test_checkout_sparse__patterns(void)
+{
+	git_sparse *sparse;
+	int included;
+
+	cl_git_pass(git_sparse__load(&sparse, g_repo));
+	cl_assert(sparse == NULL);
+
+	set_patterns("/*\n!/assets/*/\n/assets/common/\nsrc/*.c\n");
+	cl_git_pass(git_sparse__load(&sparse, g_repo));
+	cl_assert(sparse != NULL);
+
+	cl_git_pass(git_sparse__lookup(&included, sparse, "README.md"));
+	cl_assert_equal_i(1, included);
+	cl_git_pass(git_sparse__lookup(&included, sparse, "assets/common/logo.png"));
+	cl_assert_equal_i(1, included);
+	cl_git_pass(git_sparse__lookup(&included, sparse, "assets/ios/icon.png"));
+	cl_assert_equal_i(0, included);
+	cl_git_pass(git_sparse__lookup(&included, sparse, "src/main.c"));
+	cl_assert_equal_i(1, included);
+	cl_git_pass(git_sparse__lookup(&included, sparse, "src/main.h"));
+	cl_assert_equal_i(1, included); /* by the top level pattern, through its parent dir */
+
+	git_sparse__free(sparse);
+
+	set_patterns("assets/ios/\n");
+	cl_git_pass(git_sparse__load(&sparse, g_repo));
+
+	cl_git_pass(git_sparse__lookup(&included, sparse, "README.md"));
+	cl_assert_equal_i(0, included);
+	cl_git_pass(git_sparse__lookup(&included, sparse, "assets/ios/icon.png"));
+	cl_assert_equal_i(1, included);
+	cl_git_pass(git_sparse__lookup(&included, sparse, "assets/ios/retina/icon.png"));
+	cl_assert_equal_i(1, included);
+
+	git_sparse__free(sparse);
+}
+
+void test_checkout_sparse__leaves_out_excluded_files(void)
+{
+	set_patterns("/*\n!/assets/*/\n/assets/common/\n/assets/ios/\n");
+	checkout_head(GIT_CHECKOUT_SAFE);
+
+	cl_assert(git_path_exists("sparse/README.md"));
+	cl_assert(git_path_exists("sparse/assets/common/logo.png"));
+	cl_assert(git_path_exists("sparse/assets/ios/icon.png"));
+	cl_assert(!git_path_exists("sparse/assets/android/icon.png"));
+	cl_assert(!git_path_exists("sparse/assets/android"));
+
+	cl_assert(is_skip_worktree("assets/android/icon.png"));
+	cl_assert(!is_skip_worktree("assets/ios/icon.png"));
+
+	/* missing files outside of the sparse checkout are not deletions */
+	cl_assert_equal_i(0, status_count());
+}
+
+void test_checkout_sparse__fresh_checkout_does_not_write_excluded_files(void)
+{
+	cl_git_pass(git_futils_rmdir_r("sparse/assets", NULL, GIT_RMDIR_REMOVE_FILES));
+
+	set_patterns("/*\n!/assets/*/\n/assets/common/\n");
+	checkout_head(GIT_CHECKOUT_FORCE);
+
+	cl_assert(git_path_exists("sparse/assets/common/logo.png"));
+	cl_assert(!git_path_exists("sparse/assets/android/icon.png"));
+	cl_assert(!git_path_exists("sparse/assets/ios/icon.png"));
+
+	cl_assert(is_skip_worktree("assets/android/icon.png"));
+	cl_assert(is_skip_worktree("assets/ios/icon.png"));
+	cl_assert_equal_i(0, status_count());
+}
+
+void test_checkout_sparse__widening_restores_files(void)
+{
+	set_patterns("/*\n!/assets/*/\n/assets/common/\n");
+	checkout_head(GIT_CHECKOUT_SAFE);
+	cl_assert(!git_path_exists("sparse/assets/ios/icon.png"));
+
+	set_patterns("/*\n!/assets/*/\n/assets/common/\n/assets/ios/\n");
+	checkout_head(GIT_CHECKOUT_SAFE);
+
+	cl_assert(git_path_exists("sparse/assets/ios/icon.png"));
+	cl_assert(!git_path_exists("sparse/assets/android/icon.png"));
+	cl_assert(!is_skip_worktree("assets/ios/icon.png"));
+	cl_assert(is_skip_worktree("assets/android/icon.png"));
+	cl_assert_equal_i(0, status_count());
+}
+
+static void checkout_commit(const git_oid *id, unsigned int strategy)
+{
+	git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+	git_object *commit;
+
+	opts.checkout_strategy = strategy;
+	cl_git_pass(git_object_lookup(&commit, g_repo, id, GIT_OBJ_COMMIT));
+	cl_git_pass(git_checkout_tree(g_repo, commit, &opts));
+	cl_git_pass(git_repository_set_head_detached(g_repo, id, NULL, NULL));
+	git_object_free(commit);
+}
+
+void test_checkout_sparse__widening_writes_files_the_target_changes(void)
+{
+	git_index *index;
+	git_buf content = GIT_BUF_INIT;
+	git_oid before, after;
+
+	cl_git_pass(git_reference_name_to_id(&before, g_repo, "HEAD"));
+
+	cl_git_rewritefile("sparse/assets/ios/icon.png", "new icon");
+	cl_git_pass(git_repository_index(&index, g_repo));
+	cl_git_pass(git_index_add_bypath(index, "assets/ios/icon.png"));
+	cl_git_pass(git_index_write(index));
+	git_index_free(index);
+	cl_repo_commit_from_index(&after, g_repo, NULL, 0, "new icon");
+
+	set_patterns("/*\n!/assets/*/\n/assets/common/\n");
+	checkout_commit(&before, GIT_CHECKOUT_FORCE);
+	cl_assert(!git_path_exists("sparse/assets/ios/icon.png"));
+	cl_assert(is_skip_worktree("assets/ios/icon.png"));
+
+	set_patterns("/*\n!/assets/*/\n/assets/common/\n/assets/ios/\n");
+	checkout_commit(&after, GIT_CHECKOUT_SAFE);
+
+	cl_git_pass(git_futils_readbuffer(&content, "sparse/assets/ios/icon.png"));
+	cl_assert_equal_s("new icon", content.ptr);
+	cl_assert(!is_skip_worktree("assets/ios/icon.png"));
+	cl_assert_equal_i(0, status_count());
+
+	git_buf_free(&content);
+}
+
+void test_checkout_sparse__keeps_modified_files(void)
+{
+	cl_git_rewritefile("sparse/assets/android/icon.png", "local change");
+
+	set_patterns("/*\n!/assets/*/\n");
+	checkout_head(GIT_CHECKOUT_SAFE);
+
+	cl_assert(git_path_exists("sparse/assets/android/icon.png"));
+	cl_assert(!git_path_exists("sparse/assets/ios/icon.png"));
+	cl_assert(!is_skip_worktree("assets/android/icon.png"));
+	cl_assert(is_skip_worktree("assets/ios/icon.png"));
+	cl_assert_equal_i(1, status_count());
+}
+
+void test_checkout_sparse__update_all_keeps_skipped_entries(void)
+{
+	git_index *index;
+
+	set_patterns("/*\n!/assets/*/\n");
+	checkout_head(GIT_CHECKOUT_SAFE);
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	cl_git_pass(git_index_update_all(index, NULL, NULL, NULL));
+	cl_git_pass(git_index_add_all(index, NULL, 0, NULL, NULL));
+	cl_git_pass(git_index_write(index));
+	git_index_free(index);
+
+	cl_assert(is_skip_worktree("assets/android/icon.png"));
+	cl_assert(is_skip_worktree("assets/ios/icon.png"));
+	cl_assert_equal_i(0, status_count());
+}
+
+void test_checkout_sparse__ignored_without_config(void)
+{
+	cl_git_pass(git_futils_rmdir_r("sparse/assets", NULL, GIT_RMDIR_REMOVE_FILES));
+	cl_git_mkfile("sparse/.git/" GIT_SPARSE_CHECKOUT_FILE, "/*\n!/assets/\n");
+
+	checkout_head(GIT_CHECKOUT_FORCE);
+
+	cl_assert(git_path_exists("sparse/assets/android/icon.png"));
+	cl_assert(!is_skip_worktree("assets/android/icon.png"));
+}
@@ -0,0 +1,133 @@
+#include "clar_libgit2.h"
+#include "git2/checkout.h"
+#include "fileops.h"
+#include "repository.h"
+
+static git_repository *g_repo;
+
+#define NDIRS 12
+#define NFILES 20
+
+void test_checkout_threads__initialize(void)
+{
+	git_index *index;
+	git_buf path = GIT_BUF_INIT, content = GIT_BUF_INIT;
+	int d, f;
+
+	cl_git_pass(git_repository_init(&g_repo, "threaded", false));
+	cl_git_pass(git_repository_index(&index, g_repo));
+
+	cl_git_mkfile("threaded/.gitattributes", "*.txt ident\n");
+	cl_git_pass(git_index_add_bypath(index, ".gitattributes"));
+
+	for (d = 0; d < NDIRS; d++) {
+		for (f = 0; f < NFILES; f++) {
+			git_buf_clear(&path);
+			git_buf_clear(&content);
+			cl_git_pass(git_buf_printf(&path, "threaded/dir%02d/sub%d/file%02d.%s",
+				d, f % 3, f, (f % 2) ? "txt" : "bin"));
+			cl_git_pass(git_buf_printf(&content, "$Id$\nfile %d in dir %d\n", f, d));
+
+			cl_git_pass(git_futils_mkpath2file(path.ptr, 0777));
+			cl_git_mkfile(path.ptr, content.ptr);
+			cl_git_pass(git_index_add_bypath(index, path.ptr + strlen("threaded/")));
+		}
+	}
+
+	cl_git_pass(git_index_write(index));
+	cl_repo_commit_from_index(NULL, g_repo, NULL, 0, "synthetic");
+
+	git_index_free(index);
+	git_buf_free(&path);
+	git_buf_free(&content);
+}
+
+void test_checkout_threads__cleanup(void)
+{
+	git_repository_free(g_repo);
+	g_repo = NULL;
+	cl_fixture_cleanup("threaded");
+}
+
+static void progress_to_buf(
+	const char *path, size_t completed, size_t total, void *payload)
+{
+	GIT_UNUSED(total);
+
+	if (path)
+		git_buf_printf((git_buf *)payload, "%u:%s\n", (unsigned)completed, path);
+}
+
+/* Check out HEAD from scratch and describe the workdir, index and progress */
+static void checkout_fresh(git_buf *out, unsigned int threads)
+{
+	git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+	git_index *index;
+	const git_index_entry *entry;
+	git_buf path = GIT_BUF_INIT, content = GIT_BUF_INIT;
+	char oid[GIT_OID_HEXSZ + 1];
+	size_t i;
+	int d;
+
+	for (d = 0; d < NDIRS; d++) {
+		git_buf_clear(&path);
+		cl_git_pass(git_buf_printf(&path, "threaded/dir%02d", d));
+		cl_git_pass(git_futils_rmdir_r(path.ptr, NULL, GIT_RMDIR_REMOVE_FILES));
+	}
+
+	opts.checkout_strategy = GIT_CHECKOUT_FORCE;
+	opts.progress_cb = progress_to_buf;
+	opts.progress_payload = out;
+	opts.threads = threads;
+
+	cl_git_pass(git_checkout_head(g_repo, &opts));
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	cl_git_pass(git_index_read(index, true));
+
+	for (i = 0; i < git_index_entrycount(index); i++) {
+		entry = git_index_get_byindex(index, i);
+
+		git_buf_clear(&path);
+		cl_git_pass(git_buf_joinpath(&path, "threaded", entry->path));
+		cl_git_pass(git_futils_readbuffer(&content, path.ptr));
+		cl_assert_equal_i(entry->file_size, content.size);
+
+		git_oid_tostr(oid, sizeof(oid), &entry->id);
+		git_buf_printf(out, "%s %o %s %u\n%s",
+			entry->path, entry->mode, oid, (unsigned)entry->file_size, content.ptr);
+	}
+
+	cl_assert(!git_buf_oom(out));
+
+	git_index_free(index);
+	git_buf_free(&path);
+	git_buf_free(&content);
+}
+
+void test_checkout_threads__matches_serial_checkout(void)
+{
+	git_buf serial = GIT_BUF_INIT, threaded = GIT_BUF_INIT;
+
+	checkout_fresh(&serial, 1);
+	checkout_fresh(&threaded, 4);
+
+	cl_assert(strstr(serial.ptr, "$Id: ") != NULL);
+	cl_assert_equal_s(serial.ptr, threaded.ptr);
+
+	git_buf_free(&serial);
+	git_buf_free(&threaded);
+}
+
+void test_checkout_threads__auto(void)
+{
+	git_buf serial = GIT_BUF_INIT, threaded = GIT_BUF_INIT;
+
+	checkout_fresh(&serial, 0);
+	checkout_fresh(&threaded, GIT_CHECKOUT_THREADS_AUTO);
+
+	cl_assert_equal_s(serial.ptr, threaded.ptr);
+
+	git_buf_free(&serial);
+	git_buf_free(&threaded);
+}
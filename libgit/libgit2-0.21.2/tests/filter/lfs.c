@@ -0,0 +1,819 @@
+#include "clar_libgit2.h"
+#include "git2/sys/filter.h"
+#include "buffer.h"
+#include "fileops.h"
+#include "json.h"
+#include "lfs.h"
+#include "thread-utils.h"
+#include "repo/history.h"
+
+#ifndef GIT_WIN32
+# include <signal.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+#endif
+
+/* the fetching tests need the local stand-in server further down */
+#if defined(GIT_THREADS) && !defined(GIT_WIN32)
+# define LFS_SERVER
+#endif
+
+static git_repository *g_repo;
+
+void test_filter_lfs__initialize(void)
+{
+	cl_git_pass(git_repository_init(&g_repo, "lfs_repo", 0));
+	cl_git_mkfile("lfs_repo/.gitattributes", "*.bin filter=lfs\n");
+}
+
+static void stop_server(void);
+
+void test_filter_lfs__cleanup(void)
+{
+	stop_server();
+
+	git_repository_free(g_repo);
+	g_repo = NULL;
+
+	cl_fixture_cleanup("lfs_repo");
+}
+
+static const char *spec_pointer =
+	"version https://git-lfs.github.com/spec/v1\n"
+	"oid sha256:4d7a214614ab2935c943f9e0ff69d22eadbb8f32b1258daaa5e2ca24d17e2393\n"
+	"size 12345\n";
+
+static void assert_sha256(const char *expected, const char *data, size_t len)
+{
+	git_sha256_ctx ctx;
+	char hex[GIT_SHA256_HEXSZ + 1];
+	size_t i;
+
+	git_sha256_init(&ctx);
+	/* in uneven pieces, to cross the block boundaries */
+	for (i = 0; i < len; i += 7)
+		git_sha256_update(&ctx, data + i, min(7, len - i));
+	git_sha256_final_hex(hex, &ctx);
+
+	cl_assert_equal_s(expected, hex);
+}
+
+void test_filter_lfs__sha256(void)
+{
+	assert_sha256("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", "", 0);
+	assert_sha256("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", "abc", 3);
+	assert_sha256("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56);
+}
+
+static int parse(const char *data)
+{
+	git_lfs_pointer ptr;
+	return git_lfs_pointer_parse(&ptr, data, strlen(data));
+}
+
+void test_filter_lfs__parses_pointers(void)
+{
+	git_lfs_pointer ptr;
+	git_buf buf = GIT_BUF_INIT;
+
+	cl_git_pass(git_lfs_pointer_parse(&ptr, spec_pointer, strlen(spec_pointer)));
+	cl_assert_equal_s("4d7a214614ab2935c943f9e0ff69d22eadbb8f32b1258daaa5e2ca24d17e2393", ptr.oid);
+	cl_assert_equal_i(12345, (int)ptr.size);
+
+	cl_git_pass(git_lfs_pointer_format(&buf, &ptr));
+	cl_assert_equal_s(spec_pointer, buf.ptr);
+	git_buf_free(&buf);
+
+	/* extensions are skipped */
+	cl_git_pass(parse("version https://git-lfs.github.com/spec/v1\n"
+		"ext-0-foo sha256:ffff\n"
+		"oid sha256:4d7a214614ab2935c943f9e0ff69d22eadbb8f32b1258daaa5e2ca24d17e2393\n"
+		"size 1\n"));
+
+	cl_assert_equal_i(GIT_ENOTFOUND, parse(""));
+	cl_assert_equal_i(GIT_ENOTFOUND, parse("just text\n"));
+	cl_assert_equal_i(GIT_ENOTFOUND, git_lfs_pointer_parse(&ptr, spec_pointer, strlen(spec_pointer) - 1));
+	cl_assert_equal_i(GIT_ENOTFOUND, parse(
+		"version https://example.com/spec/v9\n"
+		"oid sha256:4d7a214614ab2935c943f9e0ff69d22eadbb8f32b1258daaa5e2ca24d17e2393\n"
+		"size 12345\n"));
+	cl_assert_equal_i(GIT_ENOTFOUND, parse(
+		"version https://git-lfs.github.com/spec/v1\n"
+		"oid sha256:4D7A214614AB2935C943F9E0FF69D22EADBB8F32B1258DAAA5E2CA24D17E2393\n"
+		"size 12345\n"));
+	cl_assert_equal_i(GIT_ENOTFOUND, parse(
+		"version https://git-lfs.github.com/spec/v1\n"
+		"oid sha256:4d7a214614ab2935c943f9e0ff69d22eadbb8f32b1258daaa5e2ca24d17e2393\n"
+		"size -5\n"));
+	cl_assert_equal_i(GIT_ENOTFOUND, parse(
+		"version https://git-lfs.github.com/spec/v1\n"
+		"oid sha256:4d7a214614ab2935c943f9e0ff69d22eadbb8f32b1258daaa5e2ca24d17e2393\n"));
+}
+
+/* Some content, different for each `seed` */
+static void make_content(git_buf *out, int seed, size_t len)
+{
+	size_t i;
+
+	git_buf_clear(out);
+	for (i = 0; i < len; i++)
+		cl_git_pass(git_buf_putc(out, (char)((i * 31 + seed * 7 + i / 251) & 0xff)));
+}
+
+static void write_file(const char *name, const git_buf *content)
+{
+	git_buf path = GIT_BUF_INIT;
+
+	cl_git_pass(git_buf_joinpath(&path, "lfs_repo", name));
+	cl_git_pass(git_futils_writebuffer(content, path.ptr, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+	git_buf_free(&path);
+}
+
+static void assert_file(const char *name, const git_buf *content)
+{
+	git_buf path = GIT_BUF_INIT;
+
+	cl_git_pass(git_buf_joinpath(&path, "lfs_repo", name));
+	cl_assert_equal_file(content->ptr, content->size, path.ptr);
+	git_buf_free(&path);
+}
+
+static void assert_stored(const git_buf *content, bool stored)
+{
+	git_lfs_pointer ptr;
+	git_sha256_ctx ctx;
+
+	git_sha256_init(&ctx);
+	git_sha256_update(&ctx, content->ptr, content->size);
+	git_sha256_final_hex(ptr.oid, &ctx);
+	ptr.size = content->size;
+
+	cl_assert_equal_b(stored, git_lfs__has_object(g_repo, &ptr));
+}
+
+static void remove_store(void)
+{
+	git_buf path = GIT_BUF_INIT;
+
+	cl_git_pass(git_buf_joinpath(&path, git_repository_path(g_repo), "lfs"));
+	cl_git_pass(git_futils_rmdir_r(path.ptr, NULL, GIT_RMDIR_REMOVE_FILES));
+	git_buf_free(&path);
+}
+
+/* Commit the files of the working directory */
+static void commit_all(void)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+	git_index *index;
+	git_oid tree_id;
+	git_strarray all = { NULL, 0 };
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	cl_git_pass(git_index_add_all(index, &all, 0, NULL, NULL));
+	cl_git_pass(git_index_write(index));
+	cl_git_pass(git_index_write_tree(&tree_id, index));
+
+	opts.refname = "HEAD";
+	opts.message = "large files\n";
+	opts.tree = &tree_id;
+	cl_history_build(NULL, g_repo, NULL, 1, &opts);
+
+	git_index_free(index);
+}
+
+/* Remove the working directory files and check them out again */
+static int checkout_again(const char *only)
+{
+	git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+	char *paths[1];
+
+	opts.checkout_strategy = GIT_CHECKOUT_FORCE;
+	if (only) {
+		paths[0] = (char *)only;
+		opts.paths.strings = paths;
+		opts.paths.count = 1;
+	}
+
+	cl_git_pass(git_futils_rmdir_r("lfs_repo/assets", NULL, GIT_RMDIR_REMOVE_FILES));
+	cl_must_pass(p_unlink("lfs_repo/big.bin"));
+
+	return git_checkout_head(g_repo, &opts);
+}
+
+void test_filter_lfs__clean_stores_the_content(void)
+{
+	git_buf big = GIT_BUF_INIT, pointer = GIT_BUF_INIT;
+	git_oid id;
+	git_blob *blob;
+	git_lfs_pointer ptr;
+
+	make_content(&big, 1, 100000);
+	write_file("big.bin", &big);
+	cl_git_mkfile("lfs_repo/small.txt", "not a large file\n");
+
+	cl_git_pass(git_blob_create_fromworkdir(&id, g_repo, "big.bin"));
+	cl_git_pass(git_blob_lookup(&blob, g_repo, &id));
+
+	cl_git_pass(git_lfs_pointer_parse(&ptr, git_blob_rawcontent(blob), (size_t)git_blob_rawsize(blob)));
+	cl_assert_equal_i(100000, (int)ptr.size);
+	assert_stored(&big, true);
+	git_blob_free(blob);
+
+	/* the pointer is what is committed, and cleaning it does nothing */
+	cl_git_pass(git_lfs_pointer_format(&pointer, &ptr));
+	write_file("pointer.bin", &pointer);
+	cl_git_pass(git_blob_create_fromworkdir(&id, g_repo, "pointer.bin"));
+	cl_git_pass(git_blob_lookup(&blob, g_repo, &id));
+	cl_assert_equal_s(pointer.ptr, git_blob_rawcontent(blob));
+	git_blob_free(blob);
+
+	/* files without the attribute are left alone */
+	cl_git_pass(git_blob_create_fromworkdir(&id, g_repo, "small.txt"));
+	cl_git_pass(git_blob_lookup(&blob, g_repo, &id));
+	cl_assert_equal_s("not a large file\n", git_blob_rawcontent(blob));
+	git_blob_free(blob);
+
+	git_buf_free(&pointer);
+	git_buf_free(&big);
+}
+
+void test_filter_lfs__checkout_uses_the_store(void)
+{
+	git_buf big = GIT_BUF_INIT;
+
+	make_content(&big, 2, 50000);
+	write_file("big.bin", &big);
+	cl_git_pass(p_mkdir("lfs_repo/assets", 0777));
+	commit_all();
+
+	cl_git_pass(checkout_again(NULL));
+	assert_file("big.bin", &big);
+
+	git_buf_free(&big);
+}
+
+void test_filter_lfs__checkout_without_server_keeps_pointers(void)
+{
+	git_buf big = GIT_BUF_INIT, file = GIT_BUF_INIT;
+	git_lfs_pointer ptr;
+
+	make_content(&big, 3, 5000);
+	write_file("big.bin", &big);
+	cl_git_pass(p_mkdir("lfs_repo/assets", 0777));
+	commit_all();
+	remove_store();
+
+	cl_git_pass(checkout_again(NULL));
+
+	cl_git_pass(git_futils_readbuffer(&file, "lfs_repo/big.bin"));
+	cl_git_pass(git_lfs_pointer_parse(&ptr, file.ptr, file.size));
+	cl_assert_equal_i(5000, (int)ptr.size);
+
+	git_buf_free(&file);
+	git_buf_free(&big);
+}
+
+#ifdef LFS_SERVER
+
+/*
+ * A local stand-in for an LFS server: the batch API, and downloads
+ * which require the header the batch API hands out.  Each connection
+ * gets its own thread.
+ */
+
+#define SERVER_MAX_CONNECTIONS 64
+#define SERVER_MAX_OBJECTS 16
+
+typedef struct {
+	char oid[GIT_SHA256_HEXSZ + 1];
+	git_buf content;
+	bool dropped;
+} server_object;
+
+typedef struct {
+	int listener;
+	int port;
+	git_thread acceptor;
+	git_thread connections[SERVER_MAX_CONNECTIONS];
+	int sockets[SERVER_MAX_CONNECTIONS];
+	size_t nconnections;
+	git_mutex lock;
+	volatile int stop;
+
+	server_object objects[SERVER_MAX_OBJECTS];
+	size_t nobjects;
+
+	/* what to do wrong */
+	bool drop_midway; /* close the first download of each object half-way */
+	bool corrupt;     /* send the wrong content */
+
+	/* what was asked */
+	int batches;
+	int downloads;
+	int ranges;
+	int active, max_active;
+} lfs_server;
+
+static lfs_server *g_server;
+static void (*_old_sigpipe)(int);
+
+static bool recv_request(int fd, git_buf *head, git_buf *body)
+{
+	char data[4096];
+	const char *end, *length;
+	ssize_t n;
+	size_t needed;
+
+	git_buf_clear(head);
+
+	while ((end = strstr(git_buf_cstr(head), "\r\n\r\n")) == NULL) {
+		if ((n = recv(fd, data, sizeof(data), 0)) <= 0)
+			return false;
+		git_buf_put(head, data, n);
+	}
+
+	/* the body, and any part of it that came with the head */
+	git_buf_sets(body, end + 4);
+	git_buf_truncate(head, end - head->ptr + 2);
+
+	length = strstr(head->ptr, "Content-Length: ");
+	needed = length ? (size_t)atoi(length + 16) : 0;
+
+	while (body->size < needed) {
+		if ((n = recv(fd, data, sizeof(data), 0)) <= 0)
+			return false;
+		git_buf_put(body, data, n);
+	}
+
+	return true;
+}
+
+static void send_response(int fd, int status, const char *extra, const char *body, size_t len)
+{
+	git_buf response = GIT_BUF_INIT;
+
+	git_buf_printf(&response, "HTTP/1.1 %d Whatever\r\nContent-Length: %d\r\n%s\r\n",
+		status, (int)len, extra ? extra : "");
+	git_buf_put(&response, body, len);
+
+	send(fd, response.ptr, response.size, 0);
+	git_buf_free(&response);
+}
+
+static void serve_batch(lfs_server *server, int fd, const git_buf *body)
+{
+	git_json *request;
+	const git_json *obj;
+	git_buf response = GIT_BUF_INIT;
+	size_t i;
+	bool first = true;
+
+	git_mutex_lock(&server->lock);
+	server->batches++;
+	git_mutex_unlock(&server->lock);
+
+	if (git_json_parse(&request, body->ptr, body->size) < 0) {
+		send_response(fd, 400, NULL, "", 0);
+		return;
+	}
+
+	git_buf_puts(&response, "{\"transfer\":\"basic\",\"objects\":[");
+
+	for (obj = git_json_get(request, "objects")->child; obj; obj = obj->next) {
+		const char *oid = git_json_get_string(obj, "oid");
+
+		git_buf_printf(&response, "%s{\"oid\":\"%s\",", first ? "" : ",", oid);
+		first = false;
+
+		for (i = 0; i < server->nobjects; i++)
+			if (!strcmp(server->objects[i].oid, oid))
+				break;
+
+		if (i == server->nobjects)
+			git_buf_puts(&response, "\"error\":{\"code\":404,\"message\":\"Object does not exist\"}}");
+		else
+			git_buf_printf(&response, "\"size\":%d,\"actions\":{\"download\":{"
+				"\"href\":\"http://127.0.0.1:%d/objects/%s?signed=1\","
+				"\"header\":{\"X-Token\":\"secret\"}}}}",
+				(int)server->objects[i].content.size, server->port, oid);
+	}
+
+	git_buf_puts(&response, "]}");
+	send_response(fd, 200, "Content-Type: application/vnd.git-lfs+json\r\n",
+		response.ptr, response.size);
+
+	git_buf_free(&response);
+	git_json_free(request);
+}
+
+/* Returns false when the connection was dropped */
+static bool serve_object(lfs_server *server, int fd, const char *head, const char *oid)
+{
+	server_object *obj = NULL;
+	git_buf content = GIT_BUF_INIT, extra = GIT_BUF_INIT;
+	const char *range;
+	size_t i, start = 0;
+	bool drop = false;
+
+	for (i = 0; i < server->nobjects; i++)
+		if (!strncmp(server->objects[i].oid, oid, GIT_SHA256_HEXSZ))
+			obj = &server->objects[i];
+
+	if (!obj || !strstr(head, "\r\nX-Token: secret\r\n")) {
+		send_response(fd, obj ? 401 : 404, NULL, "", 0);
+		return true;
+	}
+
+	git_mutex_lock(&server->lock);
+	server->downloads++;
+	if (++server->active > server->max_active)
+		server->max_active = server->active;
+	if (server->drop_midway && !obj->dropped)
+		drop = obj->dropped = true;
+	if ((range = strstr(head, "\r\nRange: bytes=")) != NULL) {
+		server->ranges++;
+		start = (size_t)atoi(range + 15);
+	}
+	git_mutex_unlock(&server->lock);
+
+	/* long enough for the downloads to overlap */
+	usleep(50000);
+
+	git_buf_set(&content, obj->content.ptr, obj->content.size);
+	if (server->corrupt)
+		content.ptr[content.size / 2] ^= 0x55;
+
+	if (start >= content.size)
+		send_response(fd, 416, NULL, "", 0);
+	else if (drop) {
+		git_buf_printf(&extra, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n", (int)content.size);
+		git_buf_put(&extra, content.ptr, content.size / 2);
+		send(fd, extra.ptr, extra.size, 0);
+	} else if (start) {
+		git_buf_printf(&extra, "Content-Range: bytes %d-%d/%d\r\n",
+			(int)start, (int)content.size - 1, (int)content.size);
+		send_response(fd, 206, extra.ptr, content.ptr + start, content.size - start);
+	} else
+		send_response(fd, 200, NULL, content.ptr, content.size);
+
+	git_mutex_lock(&server->lock);
+	server->active--;
+	git_mutex_unlock(&server->lock);
+
+	git_buf_free(&extra);
+	git_buf_free(&content);
+	return !drop;
+}
+
+static void *serve_connection(void *arg)
+{
+	int fd = (int)(intptr_t)arg;
+	lfs_server *server = g_server;
+	git_buf head = GIT_BUF_INIT, body = GIT_BUF_INIT;
+
+	while (!server->stop && recv_request(fd, &head, &body)) {
+		if (!git__prefixcmp(head.ptr, "POST /lfs/objects/batch "))
+			serve_batch(server, fd, &body);
+		else if (!git__prefixcmp(head.ptr, "GET /objects/")) {
+			if (!serve_object(server, fd, head.ptr, head.ptr + strlen("GET /objects/")))
+				break;
+		} else
+			send_response(fd, 404, NULL, "", 0);
+	}
+
+	shutdown(fd, SHUT_RDWR);
+	git_buf_free(&head);
+	git_buf_free(&body);
+	return NULL;
+}
+
+static void *serve(void *arg)
+{
+	lfs_server *server = arg;
+	int fd;
+
+	while (!server->stop && (fd = accept(server->listener, NULL, NULL)) >= 0) {
+		git_mutex_lock(&server->lock);
+		if (server->stop || server->nconnections == SERVER_MAX_CONNECTIONS ||
+			git_thread_create(&server->connections[server->nconnections], NULL,
+				serve_connection, (void *)(intptr_t)fd) != 0)
+			close(fd);
+		else
+			server->sockets[server->nconnections++] = fd;
+		git_mutex_unlock(&server->lock);
+	}
+
+	return NULL;
+}
+
+static void start_server(void)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	git_buf url = GIT_BUF_INIT;
+
+	g_server = git__calloc(1, sizeof(lfs_server));
+	cl_assert(g_server);
+	git_mutex_init(&g_server->lock);
+
+	_old_sigpipe = signal(SIGPIPE, SIG_IGN);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	cl_assert((g_server->listener = socket(AF_INET, SOCK_STREAM, 0)) >= 0);
+	cl_must_pass(bind(g_server->listener, (struct sockaddr *)&addr, sizeof(addr)));
+	cl_must_pass(listen(g_server->listener, 16));
+	cl_must_pass(getsockname(g_server->listener, (struct sockaddr *)&addr, &addrlen));
+	g_server->port = ntohs(addr.sin_port);
+
+	cl_git_pass(git_thread_create(&g_server->acceptor, NULL, serve, g_server));
+
+	cl_git_pass(git_buf_printf(&url, "http://127.0.0.1:%d/lfs", g_server->port));
+	cl_repo_set_string(g_repo, "lfs.url", url.ptr);
+	git_buf_free(&url);
+}
+
+static void stop_server(void)
+{
+	size_t i;
+
+	if (!g_server)
+		return;
+
+	g_server->stop = 1;
+	shutdown(g_server->listener, SHUT_RDWR);
+	close(g_server->listener);
+	git_thread_join(&g_server->acceptor, NULL);
+
+	for (i = 0; i < g_server->nconnections; i++) {
+		shutdown(g_server->sockets[i], SHUT_RDWR);
+		git_thread_join(&g_server->connections[i], NULL);
+		close(g_server->sockets[i]);
+	}
+
+	for (i = 0; i < g_server->nobjects; i++)
+		git_buf_free(&g_server->objects[i].content);
+
+	git_mutex_free(&g_server->lock);
+	git__free(g_server);
+	g_server = NULL;
+
+	signal(SIGPIPE, _old_sigpipe);
+}
+
+/* Serve `content`, and commit it as a large file */
+static void add_large_file(const char *name, const git_buf *content)
+{
+	server_object *obj = &g_server->objects[g_server->nobjects++];
+	git_sha256_ctx ctx;
+
+	git_sha256_init(&ctx);
+	git_sha256_update(&ctx, content->ptr, content->size);
+	git_sha256_final_hex(obj->oid, &ctx);
+	cl_git_pass(git_buf_set(&obj->content, content->ptr, content->size));
+
+	write_file(name, content);
+}
+
+static void add_large_files(git_buf *contents, size_t count)
+{
+	git_buf name = GIT_BUF_INIT;
+	size_t i;
+
+	cl_git_pass(p_mkdir("lfs_repo/assets", 0777));
+
+	for (i = 0; i < count; i++) {
+		make_content(&contents[i], (int)i + 10, 20000 + i * 1000);
+
+		git_buf_clear(&name);
+		cl_git_pass(git_buf_printf(&name, i ? "assets/video%d.bin" : "big.bin", (int)i));
+		add_large_file(name.ptr, &contents[i]);
+	}
+
+	commit_all();
+	remove_store();
+
+	git_buf_free(&name);
+}
+
+#define NFILES 8
+
+static void free_contents(git_buf *contents, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		git_buf_free(&contents[i]);
+}
+
+#endif
+
+void test_filter_lfs__checkout_fetches_in_parallel(void)
+{
+#ifndef LFS_SERVER
+	cl_skip();
+#else
+	git_buf contents[NFILES];
+	git_buf name = GIT_BUF_INIT;
+	size_t i;
+
+	memset(contents, 0, sizeof(contents));
+
+	start_server();
+	cl_repo_set_string(g_repo, "lfs.concurrenttransfers", "4");
+	add_large_files(contents, NFILES);
+
+	cl_git_pass(checkout_again(NULL));
+
+	for (i = 0; i < NFILES; i++) {
+		git_buf_clear(&name);
+		cl_git_pass(git_buf_printf(&name, i ? "assets/video%d.bin" : "big.bin", (int)i));
+		assert_file(name.ptr, &contents[i]);
+	}
+
+	cl_assert_equal_i(1, g_server->batches);
+	cl_assert_equal_i(NFILES, g_server->downloads);
+	cl_assert(g_server->max_active > 1);
+	cl_assert(g_server->max_active <= 4);
+
+	/* everything is there now */
+	cl_git_pass(checkout_again(NULL));
+	cl_assert_equal_i(1, g_server->batches);
+
+	git_buf_free(&name);
+	free_contents(contents, NFILES);
+#endif
+}
+
+void test_filter_lfs__checkout_fetches_only_what_it_writes(void)
+{
+#ifndef LFS_SERVER
+	cl_skip();
+#else
+	git_buf contents[3];
+
+	memset(contents, 0, sizeof(contents));
+
+	start_server();
+	add_large_files(contents, 3);
+
+	cl_git_pass(checkout_again("assets/video2.bin"));
+
+	assert_file("assets/video2.bin", &contents[2]);
+	cl_assert_equal_i(1, g_server->downloads);
+	assert_stored(&contents[0], false);
+	assert_stored(&contents[1], false);
+
+	free_contents(contents, 3);
+#endif
+}
+
+#ifdef LFS_SERVER
+
+static int count_progress(size_t completed, size_t total, uint64_t received, void *payload)
+{
+	size_t *calls = payload;
+
+	cl_assert(completed <= total);
+	cl_assert(received > 0);
+	(*calls)++;
+	return 0;
+}
+
+static void fetch_head(int expected_error)
+{
+	git_lfs_fetch_options opts = GIT_LFS_FETCH_OPTIONS_INIT;
+	git_object *tree;
+	size_t calls = 0;
+
+	opts.parallel = 2;
+	opts.progress_cb = count_progress;
+	opts.progress_payload = &calls;
+
+	cl_git_pass(git_revparse_single(&tree, g_repo, "HEAD^{tree}"));
+	cl_assert_equal_i(expected_error, git_lfs_fetch_tree(g_repo, (git_tree *)tree, &opts));
+	if (!expected_error)
+		cl_assert(calls > 0);
+
+	git_object_free(tree);
+}
+
+#endif
+
+void test_filter_lfs__fetch_resumes_interrupted_downloads(void)
+{
+#ifndef LFS_SERVER
+	cl_skip();
+#else
+	git_buf contents[3];
+
+	memset(contents, 0, sizeof(contents));
+
+	start_server();
+	add_large_files(contents, 3);
+	g_server->drop_midway = true;
+
+	fetch_head(0);
+
+	/* every download was cut, then picked up where it stopped */
+	cl_assert_equal_i(6, g_server->downloads);
+	cl_assert_equal_i(3, g_server->ranges);
+	assert_stored(&contents[0], true);
+	assert_stored(&contents[1], true);
+	assert_stored(&contents[2], true);
+
+	free_contents(contents, 3);
+#endif
+}
+
+void test_filter_lfs__fetch_resumes_an_earlier_partial_download(void)
+{
+#ifndef LFS_SERVER
+	cl_skip();
+#else
+	git_buf contents[1], partial = GIT_BUF_INIT, start = GIT_BUF_INIT;
+
+	memset(contents, 0, sizeof(contents));
+
+	start_server();
+	add_large_files(contents, 1);
+
+	/* as left by a process which was killed */
+	cl_git_pass(git_buf_printf(&partial, "%s/lfs/incomplete/%s",
+		git_repository_path(g_repo), g_server->objects[0].oid));
+	cl_git_pass(git_futils_mkpath2file(partial.ptr, 0777));
+	cl_git_pass(git_buf_set(&start, contents[0].ptr, 1000));
+	cl_git_pass(git_futils_writebuffer(&start, partial.ptr, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+
+	fetch_head(0);
+
+	cl_assert_equal_i(1, g_server->downloads);
+	cl_assert_equal_i(1, g_server->ranges);
+	assert_stored(&contents[0], true);
+	cl_assert(!git_path_exists(partial.ptr));
+
+	git_buf_free(&start);
+	git_buf_free(&partial);
+	free_contents(contents, 1);
+#endif
+}
+
+void test_filter_lfs__rejects_corrupt_downloads(void)
+{
+#ifndef LFS_SERVER
+	cl_skip();
+#else
+	git_buf contents[2];
+
+	memset(contents, 0, sizeof(contents));
+
+	start_server();
+	add_large_files(contents, 2);
+	g_server->corrupt = true;
+
+	fetch_head(-1);
+	assert_stored(&contents[0], false);
+	assert_stored(&contents[1], false);
+
+	/* checkout fails rather than writing the wrong content */
+	cl_git_fail(checkout_again(NULL));
+
+	free_contents(contents, 2);
+#endif
+}
+
+void test_filter_lfs__reports_objects_missing_on_the_server(void)
+{
+#ifndef LFS_SERVER
+	cl_skip();
+#else
+	git_buf contents[2];
+
+	memset(contents, 0, sizeof(contents));
+
+	start_server();
+	add_large_files(contents, 2);
+	g_server->nobjects = 1;
+
+	fetch_head(-1);
+	cl_assert(strstr(giterr_last()->message, "Object does not exist") != NULL);
+
+	/* the object the server has was still fetched */
+	assert_stored(&contents[0], true);
+
+	git_buf_free(&g_server->objects[1].content);
+	free_contents(contents, 2);
+#endif
+}
+
+#ifndef LFS_SERVER
+
+static void stop_server(void)
+{
+}
+
+#endif
@@ -0,0 +1,343 @@
+#include "clar_libgit2.h"
+#include "commit_graph.h"
+#include "fileops.h"
+#include "posix.h"
+#include "repository.h"
+#include "git2/graph.h"
+#include "repo/history.h"
+
+static git_repository *_repo;
+static git_oid _tree_id;
+static git_vector _commits;
+
+void test_graph_commitgraph__initialize(void)
+{
+	git_treebuilder *builder;
+
+	cl_git_pass(git_repository_init(&_repo, "graph.git", true));
+	cl_git_pass(git_vector_init(&_commits, 0, NULL));
+
+	cl_git_pass(git_treebuilder_create(&builder, NULL));
+	cl_git_pass(git_treebuilder_write(&_tree_id, _repo, builder));
+	git_treebuilder_free(builder);
+}
+
+void test_graph_commitgraph__cleanup(void)
+{
+	git_vector_free_deep(&_commits);
+
+	git_repository_free(_repo);
+	_repo = NULL;
+
+	cl_fixture_cleanup("graph.git");
+}
+
+static git_oid *commit(const char *ref, git_time_t when, size_t n, ...)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+	const git_oid *parents[8];
+	va_list ap;
+	size_t i;
+	char message[32];
+
+	cl_assert(n <= ARRAY_SIZE(parents));
+
+	va_start(ap, n);
+	for (i = 0; i < n; i++)
+		parents[i] = va_arg(ap, git_oid *);
+	va_end(ap);
+
+	p_snprintf(message, sizeof(message), "commit %u\n", (unsigned)_commits.length);
+
+	opts.refname = ref;
+	opts.message = message;
+	opts.time = when;
+	opts.tree = &_tree_id;
+	opts.merge = parents + 1;
+	opts.nmerge = n > 0 ? n - 1 : 0;
+	opts.commits = &_commits;
+	cl_history_build(NULL, _repo, n > 0 ? parents[0] : NULL, 1, &opts);
+
+	return git_vector_get(&_commits, _commits.length - 1);
+}
+
+/*
+ * A main line with side branches merged back, an octopus merge and a
+ * few commits whose clocks run backwards.
+ */
+static void build_history(size_t length)
+{
+	git_oid *tip, *side = NULL, *a, *b, *c;
+	git_time_t when = 1400000000;
+	size_t i;
+
+	tip = commit("refs/heads/master", when, 0);
+
+	for (i = 1; i < length; i++) {
+		/* every tenth commit was made on a machine with a bad clock */
+		when += (i % 10 == 0) ? -86400 : 60;
+
+		if (i % 7 == 0) {
+			side = commit(NULL, when, 1, tip);
+			side = commit(NULL, when + 10, 1, side);
+		}
+
+		if (side && i % 7 == 3) {
+			tip = commit("refs/heads/master", when, 2, tip, side);
+			side = NULL;
+		} else {
+			tip = commit("refs/heads/master", when, 1, tip);
+		}
+	}
+
+	a = commit(NULL, when + 1, 1, tip);
+	b = commit(NULL, when + 2, 1, tip);
+	c = commit(NULL, when + 3, 1, tip);
+	commit("refs/heads/octopus", when + 4, 3, a, b, c);
+	commit("refs/heads/topic", when + 5, 1, a);
+}
+
+static void walk_to_buf(git_buf *out, unsigned int sorting)
+{
+	git_revwalk *walk;
+	git_oid id;
+	char str[GIT_OID_HEXSZ + 1];
+
+	cl_git_pass(git_revwalk_new(&walk, _repo));
+	git_revwalk_sorting(walk, sorting);
+	cl_git_pass(git_revwalk_push_glob(walk, "heads/*"));
+
+	while (git_revwalk_next(&id, walk) == 0)
+		git_buf_printf(out, "%s\n", git_oid_tostr(str, sizeof(str), &id));
+
+	cl_assert(!git_buf_oom(out));
+	git_revwalk_free(walk);
+}
+
+static void graph_queries_to_buf(git_buf *out)
+{
+	git_oid *one, *two, base;
+	size_t i, ahead, behind;
+	char str[GIT_OID_HEXSZ + 1];
+	int error;
+
+	for (i = 0; i + 5 < _commits.length; i += 3) {
+		one = git_vector_get(&_commits, i);
+		two = git_vector_get(&_commits, _commits.length - 1 - (i % 11));
+
+		error = git_merge_base(&base, _repo, one, two);
+		cl_assert(error == 0 || error == GIT_ENOTFOUND);
+		git_buf_printf(out, "%s ", error ? "none" : git_oid_tostr(str, sizeof(str), &base));
+
+		cl_git_pass(git_graph_ahead_behind(&ahead, &behind, _repo, one, two));
+		git_buf_printf(out, "%u %u %d %d\n", (unsigned)ahead, (unsigned)behind,
+			git_graph_descendant_of(_repo, one, two),
+			git_graph_descendant_of(_repo, two, one));
+	}
+
+	cl_assert(!git_buf_oom(out));
+}
+
+void test_graph_commitgraph__records_parents_and_generations(void)
+{
+	git_commit_graph *graph;
+	git_commit_graph_entry entry, parent_entry;
+	git_commit *c;
+	git_oid *id;
+	size_t i, n, pos, parent_pos;
+	uint32_t generation;
+
+	build_history(40);
+	cl_git_pass(git_graph_write_commit_graph(_repo));
+	cl_git_pass(git_commit_graph_open(&graph, "graph.git/objects"));
+	cl_assert_equal_i(_commits.length, graph->num_commits);
+
+	git_vector_foreach(&_commits, i, id) {
+		cl_git_pass(git_commit_lookup(&c, _repo, id));
+		cl_git_pass(git_commit_graph_find(&pos, graph, id));
+		cl_git_pass(git_commit_graph_entry_get(&entry, graph, pos));
+
+		cl_assert(git_oid_equal(&_tree_id, &entry.tree_id));
+		cl_assert_equal_i(git_commit_time(c), entry.commit_time);
+		cl_assert_equal_i(git_commit_parentcount(c), entry.parent_count);
+
+		generation = 1;
+		for (n = 0; n < entry.parent_count; n++) {
+			cl_git_pass(git_commit_graph_parent(&parent_pos, graph, &entry, n));
+			cl_assert(git_oid_equal(git_commit_parent_id(c, (unsigned int)n),
+				git_commit_graph_oid(graph, parent_pos)));
+
+			cl_git_pass(git_commit_graph_entry_get(&parent_entry, graph, parent_pos));
+			if (parent_entry.generation >= generation)
+				generation = parent_entry.generation + 1;
+		}
+		cl_assert_equal_i(generation, entry.generation);
+
+		git_commit_free(c);
+	}
+
+	cl_assert_equal_i(GIT_ENOTFOUND, git_commit_graph_find(&pos, graph, &_tree_id));
+	git_commit_graph_free(graph);
+}
+
+void test_graph_commitgraph__walks_and_queries_match(void)
+{
+	git_buf before = GIT_BUF_INIT, after = GIT_BUF_INIT;
+
+	build_history(60);
+
+	walk_to_buf(&before, GIT_SORT_TIME);
+	walk_to_buf(&before, GIT_SORT_TOPOLOGICAL);
+	walk_to_buf(&before, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+	graph_queries_to_buf(&before);
+
+	cl_git_pass(git_graph_write_commit_graph(_repo));
+
+	walk_to_buf(&after, GIT_SORT_TIME);
+	walk_to_buf(&after, GIT_SORT_TOPOLOGICAL);
+	walk_to_buf(&after, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+	graph_queries_to_buf(&after);
+
+	cl_assert_equal_s(before.ptr, after.ptr);
+
+	git_buf_free(&before);
+	git_buf_free(&after);
+}
+
+void test_graph_commitgraph__commits_after_the_graph_are_still_walked(void)
+{
+	git_buf before = GIT_BUF_INIT, after = GIT_BUF_INIT;
+	git_oid *tip;
+
+	build_history(20);
+	cl_git_pass(git_graph_write_commit_graph(_repo));
+
+	tip = git_vector_get(&_commits, _commits.length - 1);
+	tip = commit("refs/heads/topic", 1500000000, 1, tip);
+	commit("refs/heads/topic", 1500000100, 1, tip);
+
+	walk_to_buf(&after, GIT_SORT_TOPOLOGICAL);
+	cl_git_pass(p_unlink("graph.git/objects/info/commit-graph"));
+	git_repository__set_commit_graph(_repo, NULL);
+	walk_to_buf(&before, GIT_SORT_TOPOLOGICAL);
+
+	cl_assert_equal_s(before.ptr, after.ptr);
+
+	git_buf_free(&before);
+	git_buf_free(&after);
+}
+
+void test_graph_commitgraph__walk_does_not_read_commits(void)
+{
+	git_buf before = GIT_BUF_INIT, after = GIT_BUF_INIT, path = GIT_BUF_INIT;
+	git_reference_iterator *iter;
+	git_reference *ref;
+	git_oid *id;
+	char str[GIT_OID_HEXSZ + 1];
+	size_t i;
+	int is_tip;
+
+	build_history(30);
+	walk_to_buf(&before, GIT_SORT_TOPOLOGICAL);
+	cl_git_pass(git_graph_write_commit_graph(_repo));
+
+	/* only the branch tips are left for the walk to look up */
+	git_vector_foreach(&_commits, i, id) {
+		is_tip = 0;
+		cl_git_pass(git_reference_iterator_new(&iter, _repo));
+		while (git_reference_next(&ref, iter) == 0) {
+			if (git_oid_equal(git_reference_target(ref), id))
+				is_tip = 1;
+			git_reference_free(ref);
+		}
+		git_reference_iterator_free(iter);
+
+		if (is_tip)
+			continue;
+
+		git_oid_tostr(str, sizeof(str), id);
+		git_buf_clear(&path);
+		cl_git_pass(git_buf_printf(&path, "graph.git/objects/%.2s/%s", str, str + 2));
+		cl_git_pass(p_unlink(path.ptr));
+	}
+
+	walk_to_buf(&after, GIT_SORT_TOPOLOGICAL);
+	cl_assert_equal_s(before.ptr, after.ptr);
+
+	git_buf_free(&before);
+	git_buf_free(&after);
+	git_buf_free(&path);
+}
+
+void test_graph_commitgraph__rejects_corrupt_files(void)
+{
+	git_commit_graph *graph;
+	git_buf contents = GIT_BUF_INIT, walked = GIT_BUF_INIT;
+
+	build_history(10);
+	cl_git_pass(git_graph_write_commit_graph(_repo));
+
+	cl_git_pass(git_futils_readbuffer(&contents, "graph.git/objects/info/commit-graph"));
+	contents.size /= 2;
+	cl_git_pass(p_unlink("graph.git/objects/info/commit-graph"));
+	cl_git_mkfile("graph.git/objects/info/commit-graph", git_buf_cstr(&contents));
+
+	cl_git_fail(git_commit_graph_open(&graph, "graph.git/objects"));
+
+	/* the walk falls back to the objects */
+	git_repository__set_commit_graph(_repo, NULL);
+	walk_to_buf(&walked, GIT_SORT_TOPOLOGICAL);
+	cl_assert(walked.size > 0);
+
+	git_buf_free(&contents);
+	git_buf_free(&walked);
+}
+
+/*
+ * Opt-in benchmark: GITTEST_COMMIT_GRAPH_BENCH=<number of commits> walks
+ * a synthetic history and computes a merge base with and without the
+ * commit-graph.
+ */
+void test_graph_commitgraph__benchmark(void)
+{
+	const char *env = cl_getenv("GITTEST_COMMIT_GRAPH_BENCH");
+	git_buf walked = GIT_BUF_INIT;
+	git_oid base;
+	size_t length;
+	double plain, graph, plain_base, graph_base;
+
+	if (!env)
+		cl_skip();
+
+	length = (size_t)strtoul(env, NULL, 10);
+	if (!length)
+		length = 20000;
+
+	build_history(length);
+
+	plain = git__timer();
+	walk_to_buf(&walked, GIT_SORT_TOPOLOGICAL);
+	plain = git__timer() - plain;
+
+	plain_base = git__timer();
+	cl_git_pass(git_merge_base(&base, _repo,
+		git_vector_get(&_commits, 1), git_vector_get(&_commits, _commits.length - 1)));
+	plain_base = git__timer() - plain_base;
+
+	cl_git_pass(git_graph_write_commit_graph(_repo));
+
+	graph = git__timer();
+	git_buf_clear(&walked);
+	walk_to_buf(&walked, GIT_SORT_TOPOLOGICAL);
+	graph = git__timer() - graph;
+
+	graph_base = git__timer();
+	cl_git_pass(git_merge_base(&base, _repo,
+		git_vector_get(&_commits, 1), git_vector_get(&_commits, _commits.length - 1)));
+	graph_base = git__timer() - graph_base;
+
+	printf("\n%u commits: walk %.3fs -> %.3fs, merge-base %.3fs -> %.3fs\n",
+		(unsigned)_commits.length, plain, graph, plain_base, graph_base);
+
+	git_buf_free(&walked);
+}
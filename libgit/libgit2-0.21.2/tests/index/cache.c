@@ -0,0 +1,226 @@
+#include "clar_libgit2.h"
+#include "index.h"
+#include "tree-cache.h"
+
+static git_repository *g_repo;
+static git_index *g_index;
+
+void test_index_cache__initialize(void)
+{
+	cl_git_pass(git_repository_init(&g_repo, "./index_cache", 0));
+	cl_git_pass(git_repository_index(&g_index, g_repo));
+}
+
+void test_index_cache__cleanup(void)
+{
+	git_index_free(g_index);
+	g_index = NULL;
+
+	git_repository_free(g_repo);
+	g_repo = NULL;
+
+	cl_fixture_cleanup("index_cache");
+}
+
+static void add_file(const char *path, const char *content)
+{
+	git_index_entry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.path = (char *)path;
+	entry.mode = GIT_FILEMODE_BLOB;
+	cl_git_pass(git_blob_create_frombuffer(&entry.id, g_repo, content, strlen(content)));
+
+	cl_git_pass(git_index_add(g_index, &entry));
+}
+
+static void add_files(void)
+{
+	add_file("README", "readme\n");
+	add_file("art/a.png", "a\n");
+	add_file("art/b.png", "b\n");
+	add_file("art/ui/button.png", "button\n");
+	add_file("audio/voice/line1.ogg", "line1\n");
+	add_file("audio/voice/line2.ogg", "line2\n");
+	add_file("src/main.c", "main\n");
+}
+
+static const git_tree_cache *cached(const char *path)
+{
+	return *path ? git_tree_cache_get(g_index->tree, path) : g_index->tree;
+}
+
+static void assert_valid(const char *path, int entries)
+{
+	const git_tree_cache *tree = cached(path);
+
+	cl_assert(tree != NULL);
+	cl_assert_equal_i(entries, tree->entries);
+}
+
+static void assert_invalid(const char *path)
+{
+	const git_tree_cache *tree = cached(path);
+
+	cl_assert(tree != NULL);
+	cl_assert_equal_i(-1, tree->entries);
+}
+
+/* The tree written from scratch, without the cache */
+static void assert_tree_matches_uncached(const git_oid *id)
+{
+	git_tree_cache *saved = g_index->tree;
+	git_oid uncached;
+
+	g_index->tree = NULL;
+	cl_git_pass(git_index_write_tree(&uncached, g_index));
+	git_tree_cache_free(g_index->tree);
+	g_index->tree = saved;
+
+	cl_assert(git_oid_equal(id, &uncached));
+}
+
+void test_index_cache__write_tree_fills_the_cache(void)
+{
+	git_oid id;
+	const git_tree_cache *art;
+
+	add_files();
+	cl_assert(g_index->tree == NULL);
+
+	cl_git_pass(git_index_write_tree(&id, g_index));
+
+	assert_valid("", 7);
+	assert_valid("art", 3);
+	assert_valid("art/ui", 1);
+	assert_valid("audio", 2);
+	assert_valid("audio/voice", 2);
+	assert_valid("src", 1);
+	cl_assert(git_oid_equal(&id, &g_index->tree->oid));
+
+	art = cached("art");
+	cl_assert_equal_i(1, art->children_count);
+}
+
+void test_index_cache__changes_invalidate_only_their_path(void)
+{
+	git_oid before, after;
+	git_oid audio;
+
+	add_files();
+	cl_git_pass(git_index_write_tree(&before, g_index));
+	git_oid_cpy(&audio, &cached("audio")->oid);
+
+	add_file("art/ui/button.png", "new button\n");
+
+	assert_invalid("");
+	assert_invalid("art");
+	assert_invalid("art/ui");
+	assert_valid("audio", 2);
+	assert_valid("src", 1);
+
+	cl_git_pass(git_index_write_tree(&after, g_index));
+	cl_assert(!git_oid_equal(&before, &after));
+	cl_assert(git_oid_equal(&audio, &cached("audio")->oid));
+	assert_tree_matches_uncached(&after);
+
+	cl_git_pass(git_index_remove(g_index, "src/main.c", 0));
+	assert_invalid("");
+	assert_invalid("src");
+	assert_valid("art", 3);
+}
+
+void test_index_cache__removed_directories_are_pruned(void)
+{
+	git_oid id;
+
+	add_files();
+	cl_git_pass(git_index_write_tree(&id, g_index));
+
+	cl_git_pass(git_index_remove_directory(g_index, "audio", 0));
+	cl_git_pass(git_index_write_tree(&id, g_index));
+
+	assert_valid("", 5);
+	cl_assert(cached("audio") == NULL);
+	cl_assert_equal_i(2, g_index->tree->children_count);
+	assert_tree_matches_uncached(&id);
+}
+
+void test_index_cache__read_tree_fills_the_cache(void)
+{
+	git_oid id;
+	git_tree *tree;
+
+	add_files();
+	cl_git_pass(git_index_write_tree(&id, g_index));
+	cl_git_pass(git_tree_lookup(&tree, g_repo, &id));
+
+	cl_git_pass(git_index_clear(g_index));
+	cl_assert(g_index->tree == NULL);
+
+	cl_git_pass(git_index_read_tree(g_index, tree));
+
+	assert_valid("", 7);
+	assert_valid("art/ui", 1);
+	assert_valid("audio/voice", 2);
+	cl_assert(git_oid_equal(&id, &g_index->tree->oid));
+
+	git_tree_free(tree);
+}
+
+void test_index_cache__survives_writing_the_index(void)
+{
+	git_oid id, reread_id;
+	git_index *reread;
+
+	add_files();
+	cl_git_pass(git_index_write_tree(&id, g_index));
+	add_file("src/main.c", "changed\n");
+	cl_git_pass(git_index_write(g_index));
+
+	cl_git_pass(git_index_open(&reread, git_index_path(g_index)));
+	cl_assert(reread->tree != NULL);
+	cl_assert_equal_i(-1, reread->tree->entries);
+	cl_assert_equal_i(3, git_tree_cache_get(reread->tree, "art")->entries);
+	cl_assert_equal_i(-1, git_tree_cache_get(reread->tree, "src")->entries);
+
+	cl_git_pass(git_index_write_tree(&id, g_index));
+	cl_git_pass(git_index_write_tree_to(&reread_id, reread, g_repo));
+	cl_assert(git_oid_equal(&id, &reread_id));
+
+	git_index_free(reread);
+}
+
+void test_index_cache__is_compatible_with_git(void)
+{
+	git_oid id;
+	git_buf cmd = GIT_BUF_INIT, out = GIT_BUF_INIT, out_path = GIT_BUF_INIT;
+	char hex[GIT_OID_HEXSZ + 1];
+
+	if (system("git --version >/dev/null 2>&1") != 0)
+		cl_skip();
+
+	add_files();
+	cl_git_pass(git_index_write_tree(&id, g_index));
+	add_file("audio/voice/line3.ogg", "line3\n");
+	cl_git_pass(git_index_write_tree(&id, g_index));
+	add_file("art/c.png", "c\n");
+	cl_git_pass(git_index_write(g_index));
+
+	/* git trusts the valid trees of the cache when writing one itself */
+	cl_git_pass(git_buf_joinpath(&out_path, git_repository_path(g_repo), "write-tree.out"));
+	cl_git_pass(git_buf_printf(&cmd, "cd '%s' && git write-tree >'%s' 2>/dev/null",
+		git_repository_workdir(g_repo), out_path.ptr));
+	cl_assert_equal_i(0, system(cmd.ptr));
+
+	cl_git_pass(git_index_write_tree(&id, g_index));
+	git_oid_tostr(hex, sizeof(hex), &id);
+
+	cl_git_pass(git_futils_readbuffer(&out, out_path.ptr));
+	git_buf_rtrim(&out);
+	cl_assert_equal_s(hex, out.ptr);
+
+	git_buf_free(&out_path);
+	git_buf_free(&out);
+	git_buf_free(&cmd);
+}
@@ -0,0 +1,250 @@
+#include "clar_libgit2.h"
+#include "index.h"
+#include "hash.h"
+
+static git_repository *g_repo;
+
+void test_index_version__initialize(void)
+{
+	cl_git_pass(git_repository_init(&g_repo, "./index_version", 0));
+}
+
+void test_index_version__cleanup(void)
+{
+	git_repository_free(g_repo);
+	g_repo = NULL;
+
+	cl_fixture_cleanup("index_version");
+}
+
+static void add_entry(git_index *index, const char *path, const git_oid *id)
+{
+	git_index_entry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.path = (char *)path;
+	entry.mode = GIT_FILEMODE_BLOB;
+	entry.file_size = (git_off_t)strlen(path);
+	entry.mtime.seconds = 1400000000;
+	git_oid_cpy(&entry.id, id);
+
+	cl_git_pass(git_index_add(index, &entry));
+}
+
+/* Paths sharing long prefixes, in several directories */
+static void add_entries(git_index *index, size_t count, git_oid *id)
+{
+	git_buf path = GIT_BUF_INIT;
+	size_t i;
+
+	cl_git_pass(git_blob_create_frombuffer(id, g_repo, "content\n", 8));
+
+	for (i = 0; i < count; i++) {
+		git_buf_clear(&path);
+		cl_git_pass(git_buf_printf(&path,
+			"assets/dir%02d/sub%02d/file%05d.png", (int)(i % 17), (int)(i % 5), (int)i));
+		add_entry(index, path.ptr, id);
+	}
+
+	git_buf_free(&path);
+}
+
+static void assert_same_entries(git_index *a, git_index *b)
+{
+	size_t i;
+
+	cl_assert_equal_i(git_index_entrycount(a), git_index_entrycount(b));
+
+	for (i = 0; i < git_index_entrycount(a); i++) {
+		const git_index_entry *ea = git_index_get_byindex(a, i);
+		const git_index_entry *eb = git_index_get_byindex(b, i);
+
+		cl_assert_equal_s(ea->path, eb->path);
+		cl_assert(git_oid_equal(&ea->id, &eb->id));
+		cl_assert_equal_i(ea->mode, eb->mode);
+		cl_assert_equal_i(ea->file_size, eb->file_size);
+		cl_assert_equal_i(ea->flags, eb->flags);
+		cl_assert_equal_i(ea->flags_extended, eb->flags_extended);
+	}
+}
+
+static void write_and_reread(git_index *index, unsigned int version)
+{
+	git_index *reread;
+
+	cl_git_pass(git_index_set_version(index, version));
+	cl_git_pass(git_index_write(index));
+
+	cl_git_pass(git_index_open(&reread, git_index_path(index)));
+	cl_assert_equal_i(version, git_index_version(reread));
+	assert_same_entries(index, reread);
+
+	git_index_free(reread);
+}
+
+void test_index_version__defaults_to_2(void)
+{
+	git_index *index;
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	cl_assert_equal_i(2, git_index_version(index));
+
+	cl_git_fail(git_index_set_version(index, 1));
+	cl_git_fail(git_index_set_version(index, 5));
+	cl_assert_equal_i(2, git_index_version(index));
+
+	git_index_free(index);
+}
+
+void test_index_version__compresses_paths_in_v4(void)
+{
+	git_index *index;
+	git_oid id;
+	git_buf long_path = GIT_BUF_INIT;
+	git_off_t v2_size, v4_size;
+	struct stat st;
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	add_entries(index, 100, &id);
+
+	/* a path too long for the length in the entry flags */
+	cl_git_pass(git_buf_puts(&long_path, "assets/long/"));
+	while (long_path.size < 5000)
+		cl_git_pass(git_buf_puts(&long_path, "abcdefghij"));
+	add_entry(index, long_path.ptr, &id);
+
+	write_and_reread(index, 2);
+	cl_git_pass(p_stat(git_index_path(index), &st));
+	v2_size = st.st_size;
+
+	write_and_reread(index, 4);
+	cl_git_pass(p_stat(git_index_path(index), &st));
+	v4_size = st.st_size;
+
+	cl_assert(v4_size < v2_size);
+
+	/* and back */
+	write_and_reread(index, 2);
+
+	git_buf_free(&long_path);
+	git_index_free(index);
+}
+
+void test_index_version__keeps_extended_flags_in_v4(void)
+{
+	git_index *index;
+	git_index_entry entry;
+	const git_index_entry *found;
+	git_oid id;
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	add_entries(index, 10, &id);
+
+	memcpy(&entry, git_index_get_bypath(index, "assets/dir03/sub03/file00003.png", 0), sizeof(entry));
+	entry.flags_extended |= GIT_IDXENTRY_INTENT_TO_ADD;
+	cl_git_pass(git_index_add(index, &entry));
+
+	write_and_reread(index, 4);
+	cl_git_pass(git_index_read(index, true));
+
+	cl_assert((found = git_index_get_bypath(index, "assets/dir03/sub03/file00003.png", 0)) != NULL);
+	cl_assert(found->flags_extended & GIT_IDXENTRY_INTENT_TO_ADD);
+
+	git_index_free(index);
+}
+
+void test_index_version__reads_large_indexes(void)
+{
+	git_index *index;
+	git_oid id;
+
+	/* enough entries to be read by several threads */
+	cl_git_pass(git_repository_index(&index, g_repo));
+	add_entries(index, 25000, &id);
+
+	write_and_reread(index, 2);
+	write_and_reread(index, 4);
+
+	git_index_free(index);
+}
+
+void test_index_version__rejects_corrupt_v4_paths(void)
+{
+	git_index *index, *reread;
+	git_buf buf = GIT_BUF_INIT;
+	git_oid id, checksum;
+	const char *first = "assets/dir00/sub00/file00000.png";
+	char *varint;
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	add_entries(index, 2, &id);
+	write_and_reread(index, 4);
+
+	/*
+	 * Make the second entry drop more than the whole first path: after
+	 * the header, each entry has 62 bytes of fixed fields before its
+	 * path, which starts with the number of bytes to drop.
+	 */
+	cl_git_pass(git_futils_readbuffer(&buf, git_index_path(index)));
+	varint = buf.ptr + 12 + 62 + 1 + strlen(first) + 1 + 62;
+	cl_assert_equal_i(strlen(first) - strlen("assets/dir0"), *varint);
+	*varint = 100;
+
+	cl_git_pass(git_hash_buf(&checksum, buf.ptr, buf.size - GIT_OID_RAWSZ));
+	memcpy(buf.ptr + buf.size - GIT_OID_RAWSZ, checksum.id, GIT_OID_RAWSZ);
+	cl_git_pass(git_futils_writebuffer(&buf, git_index_path(index), 0, 0666));
+
+	cl_git_fail(git_index_open(&reread, git_index_path(index)));
+
+	git_buf_free(&buf);
+	git_index_free(index);
+}
+
+static bool have_git(void)
+{
+	return system("git --version >/dev/null 2>&1") == 0;
+}
+
+static void git_in_repo(const char *args, const char *arg)
+{
+	git_buf cmd = GIT_BUF_INIT;
+
+	cl_git_pass(git_buf_printf(&cmd, "cd '%s' && git %s%s >/dev/null 2>&1",
+		git_repository_workdir(g_repo), args, arg));
+	cl_assert_equal_i(0, system(cmd.ptr));
+
+	git_buf_free(&cmd);
+}
+
+void test_index_version__is_compatible_with_git(void)
+{
+	git_index *index, *reread;
+	git_oid id;
+	git_buf cacheinfo = GIT_BUF_INIT;
+	char hex[GIT_OID_HEXSZ + 1];
+
+	if (!have_git())
+		cl_skip();
+
+	cl_git_pass(git_repository_index(&index, g_repo));
+	add_entries(index, 200, &id);
+	write_and_reread(index, 4);
+
+	/* git reads what we wrote... */
+	git_in_repo("ls-files --error-unmatch ", "assets/dir16/sub00/file00050.png");
+
+	git_oid_tostr(hex, sizeof(hex), &id);
+	cl_git_pass(git_buf_printf(&cacheinfo, "100644,%s,added.txt", hex));
+	git_in_repo("update-index --index-version 4 --add --cacheinfo ", cacheinfo.ptr);
+
+	/* ...and we read what it wrote */
+	cl_git_pass(git_index_open(&reread, git_index_path(index)));
+	cl_assert_equal_i(4, git_index_version(reread));
+	cl_assert_equal_i(201, git_index_entrycount(reread));
+	cl_assert(git_index_get_bypath(reread, "added.txt", 0) != NULL);
+	cl_assert(git_index_get_bypath(reread, "assets/dir16/sub00/file00050.png", 0) != NULL);
+
+	git_buf_free(&cacheinfo);
+	git_index_free(reread);
+	git_index_free(index);
+}
@@ -0,0 +1,192 @@
+#include "clar_libgit2.h"
+
+#include "buffer.h"
+#include "remote.h"
+#include "upload_pack.h"
+#include "repo/history.h"
+
+static git_repository *_source;
+static git_repository *_repo;
+
+#define BASE_TIME 1400000000
+
+void test_network_negotiate__initialize(void)
+{
+	_source = NULL;
+	_repo = NULL;
+}
+
+void test_network_negotiate__cleanup(void)
+{
+	git_repository_free(_repo);
+	_repo = NULL;
+	git_repository_free(_source);
+	_source = NULL;
+
+	cl_fixture_cleanup("negotiate_src.git");
+	cl_fixture_cleanup("negotiate_dst");
+}
+
+#ifndef GIT_WIN32
+
+typedef struct {
+	const char *refname;
+	git_time_t when;
+	int changes;
+} ref_content;
+
+static void ref_file(git_buf *out, size_t commit, size_t file, void *payload)
+{
+	ref_content *c = payload;
+
+	GIT_UNUSED(file);
+	git_buf_printf(out, "%s %d\n", c->refname,
+		(int)(c->when + (c->changes ? (git_time_t)commit : 0)));
+}
+
+/*
+ * Add `n` commits on top of `parent` (or start a history), the first
+ * at `when` and each a minute after the one before, with content of
+ * their own when `changes` is set. `refname` ends up at the last.
+ */
+static void add_commits(
+	git_oid *out,
+	git_repository *repo,
+	const char *refname,
+	const git_oid *parent_id,
+	size_t n,
+	git_time_t when,
+	int changes)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+	ref_content content;
+
+	content.refname = refname;
+	content.when = when;
+	content.changes = changes;
+
+	opts.refname = refname;
+	opts.message = "commit\n";
+	opts.time = when;
+	opts.content = ref_file;
+	opts.payload = &content;
+	cl_history_build(out, repo, parent_id, n, &opts);
+}
+
+/* A source with `n` commits, cloned over `scheme` */
+static void setup(const char *scheme, size_t n, git_oid *tip)
+{
+	git_buf url = GIT_BUF_INIT;
+
+	cl_upload_pack_register();
+
+	cl_git_pass(git_repository_init(&_source, "negotiate_src.git", true));
+	add_commits(tip, _source, "refs/heads/master", NULL, n, BASE_TIME, 1);
+
+	cl_upload_pack_url(&url, scheme, "negotiate_src.git");
+	cl_git_pass(git_clone(&_repo, url.ptr, "negotiate_dst", NULL));
+	git_buf_free(&url);
+}
+
+/* Fetch three new upstream commits and check nothing else came with them */
+static void fetch_new_work(const git_oid *tip, unsigned int latency)
+{
+	git_remote *origin;
+	git_oid id;
+	git_odb *odb;
+
+	add_commits(&id, _source, "refs/heads/master", tip, 3, BASE_TIME + 100000000, 1);
+
+	memset(&cl_upload_pack_stats, 0, sizeof(cl_upload_pack_stats));
+	cl_upload_pack_stats.latency_ms = latency;
+
+	cl_git_pass(git_remote_load(&origin, _repo, "origin"));
+	cl_git_pass(git_remote_fetch(origin, NULL, NULL));
+
+	cl_git_pass(git_repository_odb(&odb, _repo));
+	cl_assert(git_odb_exists(odb, &id));
+	git_odb_free(odb);
+
+	/* three commits, with a tree and a blob each */
+	cl_assert_equal_i(9, git_remote_stats(origin)->total_objects);
+	git_remote_free(origin);
+}
+
+/*
+ * A long line of commits the server never saw is crossed with a few
+ * haves, where one have per commit would have run out before reaching
+ * the history we share with it.
+ */
+static void skips_local_history(const char *scheme, size_t max_round_trips)
+{
+	git_oid tip, local;
+
+	setup(scheme, 50, &tip);
+	add_commits(&local, _repo, "refs/heads/master", &tip, 1000, BASE_TIME + 10000, 0);
+
+	fetch_new_work(&tip, 10);
+
+	cl_assert(cl_upload_pack_stats.haves < 48);
+	cl_assert(cl_upload_pack_stats.round_trips <= max_round_trips);
+}
+
+void test_network_negotiate__stateful_skips_local_history(void)
+{
+	skips_local_history("upload-pack", 2);
+}
+
+void test_network_negotiate__stateless_skips_local_history(void)
+{
+	skips_local_history("upload-pack-rpc", 3);
+}
+
+/*
+ * Once the server says it is ready to send the pack, the haves we
+ * still had lined up aren't worth another round trip.
+ */
+static void stops_when_the_server_is_ready(const char *scheme, size_t max_haves)
+{
+	git_buf refname = GIT_BUF_INIT;
+	git_oid tip, topic;
+	size_t i;
+
+	setup(scheme, 50, &tip);
+
+	/* a hundred local topics, each dated just before the shared tip */
+	for (i = 0; i < 100; i++) {
+		git_buf_clear(&refname);
+		cl_git_pass(git_buf_printf(&refname, "refs/heads/topic-%d", (int)i));
+		add_commits(&topic, _repo, refname.ptr, &tip, 1, BASE_TIME + 49 * 60 - 1, 1);
+	}
+	git_buf_free(&refname);
+
+	fetch_new_work(&tip, 10);
+
+	cl_assert(cl_upload_pack_stats.haves <= max_haves);
+	cl_assert(cl_upload_pack_stats.round_trips <= 3);
+}
+
+void test_network_negotiate__stateful_stops_when_the_server_is_ready(void)
+{
+	/* one batch is always on its way while we read the answer to the last */
+	stops_when_the_server_is_ready("upload-pack", 16 + 32);
+}
+
+void test_network_negotiate__stateless_stops_when_the_server_is_ready(void)
+{
+	stops_when_the_server_is_ready("upload-pack-rpc", 16 + 1);
+}
+
+/* Nothing is asked about when everything we have is in the server's history */
+void test_network_negotiate__up_to_date_clients_need_one_round_trip(void)
+{
+	git_oid tip;
+
+	setup("upload-pack-rpc", 300, &tip);
+	fetch_new_work(&tip, 10);
+
+	cl_assert(cl_upload_pack_stats.haves < 16);
+	cl_assert_equal_i(1, cl_upload_pack_stats.round_trips);
+}
+
+#endif
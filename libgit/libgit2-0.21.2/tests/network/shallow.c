@@ -0,0 +1,270 @@
+#include "clar_libgit2.h"
+
+#include "buffer.h"
+#include "fileops.h"
+#include "remote.h"
+#include "repository.h"
+#include "transports/smart.h"
+#include "upload_pack.h"
+#include "repo/history.h"
+
+static git_repository *_source;
+static git_oid _history[16];
+static size_t _history_len;
+
+static git_repository *_repo;
+
+static void revision_content(git_buf *out, size_t commit, size_t file, void *payload)
+{
+	GIT_UNUSED(commit);
+	GIT_UNUSED(file);
+	git_buf_printf(out, "revision %u\n", (unsigned)*(size_t *)payload);
+}
+
+static void add_commits(size_t n)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+
+	cl_assert(_history_len + n <= ARRAY_SIZE(_history));
+
+	opts.refname = "HEAD";
+	opts.content = revision_content;
+	opts.payload = &_history_len;
+
+	for (; n > 0; n--) {
+		opts.time = 1400000000 + (git_time_t)_history_len * 60;
+		cl_history_build(&_history[_history_len], _source,
+			_history_len > 0 ? &_history[_history_len - 1] : NULL, 1, &opts);
+		_history_len++;
+	}
+}
+
+void test_network_shallow__initialize(void)
+{
+	_history_len = 0;
+	cl_git_pass(git_repository_init(&_source, "shallow_src.git", true));
+	add_commits(10);
+}
+
+void test_network_shallow__cleanup(void)
+{
+	git_repository_free(_repo);
+	_repo = NULL;
+	git_repository_free(_source);
+	_source = NULL;
+
+	cl_fixture_cleanup("shallow_src.git");
+	cl_fixture_cleanup("shallow_dst");
+}
+
+static size_t count_history(git_repository *repo)
+{
+	git_revwalk *walk;
+	git_oid id;
+	size_t count = 0;
+	int error;
+
+	cl_git_pass(git_revwalk_new(&walk, repo));
+	cl_git_pass(git_revwalk_push_head(walk));
+
+	while ((error = git_revwalk_next(&id, walk)) == 0)
+		count++;
+
+	cl_assert_equal_i(GIT_ITEROVER, error);
+	git_revwalk_free(walk);
+
+	return count;
+}
+
+static void set_shallow_roots(git_repository *repo, const git_oid *ids, size_t n)
+{
+	git_array_oid_t roots = GIT_ARRAY_INIT;
+	git_oid *id;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		cl_assert((id = git_array_alloc(roots)) != NULL);
+		git_oid_cpy(id, &ids[i]);
+	}
+
+	cl_git_pass(git_repository__shallow_roots_write(repo, &roots));
+	git_array_clear(roots);
+}
+
+void test_network_shallow__roots_roundtrip(void)
+{
+	git_array_oid_t roots;
+	git_oid ids[3];
+
+	cl_assert_equal_i(0, git_repository_is_shallow(_source));
+	cl_git_pass(git_repository__shallow_roots(&roots, _source));
+	cl_assert_equal_i(0, git_array_size(roots));
+
+	git_oid_cpy(&ids[0], &_history[7]);
+	git_oid_cpy(&ids[1], &_history[2]);
+	git_oid_cpy(&ids[2], &_history[5]);
+	set_shallow_roots(_source, ids, 3);
+
+	cl_assert_equal_i(1, git_repository_is_shallow(_source));
+	cl_git_pass(git_repository__shallow_roots(&roots, _source));
+	cl_assert_equal_i(3, git_array_size(roots));
+	cl_assert(git_oid_cmp(git_array_get(roots, 0), git_array_get(roots, 1)) < 0);
+	cl_assert(git_oid_cmp(git_array_get(roots, 1), git_array_get(roots, 2)) < 0);
+	cl_assert(git_repository__is_shallow_root(&roots, &_history[5]));
+	cl_assert(!git_repository__is_shallow_root(&roots, &_history[6]));
+	git_array_clear(roots);
+
+	/* an empty boundary means the history is complete */
+	set_shallow_roots(_source, NULL, 0);
+	cl_assert_equal_i(0, git_repository_is_shallow(_source));
+	cl_assert(!git_path_exists("shallow_src.git/shallow"));
+}
+
+void test_network_shallow__rejects_garbage(void)
+{
+	git_array_oid_t roots;
+
+	cl_git_mkfile("shallow_src.git/shallow", "not an object id\n");
+	cl_git_fail(git_repository__shallow_roots(&roots, _source));
+}
+
+void test_network_shallow__revwalk_stops_at_the_boundary(void)
+{
+	git_oid base;
+
+	cl_assert_equal_i(10, count_history(_source));
+
+	set_shallow_roots(_source, &_history[6], 1);
+	cl_assert_equal_i(4, count_history(_source));
+
+	/* ancestry questions are answered from what the repository has */
+	cl_assert_equal_i(1, git_graph_descendant_of(_source, &_history[9], &_history[6]));
+	cl_assert_equal_i(0, git_graph_descendant_of(_source, &_history[9], &_history[5]));
+	cl_git_pass(git_merge_base(&base, _source, &_history[9], &_history[7]));
+	cl_assert(git_oid_equal(&base, &_history[7]));
+
+	/* the commit-graph cannot describe the missing parents */
+	cl_git_fail(git_graph_write_commit_graph(_source));
+}
+
+void test_network_shallow__parses_shallow_pkts(void)
+{
+	git_buf line = GIT_BUF_INIT;
+	char hex[GIT_OID_HEXSZ + 1];
+	const char *end;
+	git_pkt *pkt;
+
+	git_oid_tostr(hex, sizeof(hex), &_history[3]);
+
+	git_buf_printf(&line, "0035shallow %s\n", hex);
+	cl_git_pass(git_pkt_parse_line(&pkt, line.ptr, &end, line.size));
+	cl_assert_equal_i(GIT_PKT_SHALLOW, pkt->type);
+	cl_assert(git_oid_equal(&_history[3], &((git_pkt_shallow *)pkt)->oid));
+	cl_assert(end == line.ptr + line.size);
+	git_pkt_free(pkt);
+
+	git_buf_clear(&line);
+	git_buf_printf(&line, "0037unshallow %s\n", hex);
+	cl_git_pass(git_pkt_parse_line(&pkt, line.ptr, &end, line.size));
+	cl_assert_equal_i(GIT_PKT_UNSHALLOW, pkt->type);
+	cl_assert(git_oid_equal(&_history[3], &((git_pkt_shallow *)pkt)->oid));
+	git_pkt_free(pkt);
+
+	git_buf_clear(&line);
+	git_buf_puts(&line, "000eshallow 12\n");
+	cl_git_fail(git_pkt_parse_line(&pkt, line.ptr, &end, line.size));
+
+	git_buf_free(&line);
+}
+
+#ifndef GIT_WIN32
+
+static void fetch_origin(int depth)
+{
+	git_remote *origin;
+
+	cl_git_pass(git_remote_load(&origin, _repo, "origin"));
+	git_remote_set_depth(origin, depth);
+	cl_git_pass(git_remote_fetch(origin, NULL, NULL));
+	git_remote_free(origin);
+
+	cl_git_pass(git_repository_set_head(_repo, "refs/remotes/origin/master", NULL, NULL));
+}
+
+static void assert_shallow_roots(const git_oid *expected, size_t n)
+{
+	git_array_oid_t roots;
+	size_t i;
+
+	cl_git_pass(git_repository__shallow_roots(&roots, _repo));
+	cl_assert_equal_i(n, git_array_size(roots));
+	for (i = 0; i < n; i++)
+		cl_assert(git_repository__is_shallow_root(&roots, &expected[i]));
+	git_array_clear(roots);
+}
+
+static void shallow_clone_and_deepen(const char *scheme)
+{
+	git_clone_options opts = GIT_CLONE_OPTIONS_INIT;
+	git_buf url = GIT_BUF_INIT, content = GIT_BUF_INIT;
+	git_oid roots[2];
+	git_odb *odb;
+
+	cl_upload_pack_register();
+	cl_upload_pack_url(&url, scheme, "shallow_src.git");
+
+	opts.depth = 2;
+	cl_git_pass(git_clone(&_repo, url.ptr, "shallow_dst", &opts));
+
+	/* only the latest two commits came over */
+	cl_assert_equal_i(1, git_repository_is_shallow(_repo));
+	assert_shallow_roots(&_history[8], 1);
+	cl_assert_equal_i(2, count_history(_repo));
+
+	cl_git_pass(git_repository_odb(&odb, _repo));
+	cl_assert(git_odb_exists(odb, &_history[8]));
+	cl_assert(!git_odb_exists(odb, &_history[7]));
+	git_odb_free(odb);
+
+	cl_git_pass(git_futils_readbuffer(&content, "shallow_dst/file.txt"));
+	cl_assert_equal_s("revision 9\n", content.ptr);
+
+	/* new upstream work arrives without the history behind it */
+	add_commits(3);
+	fetch_origin(1);
+	git_oid_cpy(&roots[0], &_history[8]);
+	git_oid_cpy(&roots[1], &_history[12]);
+	assert_shallow_roots(roots, 2);
+	cl_assert_equal_i(1, count_history(_repo));
+
+	/* a fetch without a depth keeps the boundary where it is */
+	add_commits(1);
+	fetch_origin(0);
+	assert_shallow_roots(roots, 2);
+	cl_assert_equal_i(2, count_history(_repo));
+
+	/* deepening moves the boundary back */
+	fetch_origin(6);
+	assert_shallow_roots(&_history[8], 1);
+	cl_assert_equal_i(6, count_history(_repo));
+
+	/* and unshallowing fetches the rest */
+	fetch_origin(GIT_REMOTE_DEPTH_UNSHALLOW);
+	cl_assert_equal_i(0, git_repository_is_shallow(_repo));
+	cl_assert_equal_i(14, count_history(_repo));
+
+	git_buf_free(&url);
+	git_buf_free(&content);
+}
+
+void test_network_shallow__stateful_clone_and_deepen(void)
+{
+	shallow_clone_and_deepen("upload-pack");
+}
+
+void test_network_shallow__stateless_clone_and_deepen(void)
+{
+	shallow_clone_and_deepen("upload-pack-rpc");
+}
+
+#endif
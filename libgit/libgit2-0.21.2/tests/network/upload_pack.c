@@ -0,0 +1,309 @@
+#include "clar_libgit2.h"
+#include "posix.h"
+#include "upload_pack.h"
+
+#ifndef GIT_WIN32
+
+#include <signal.h>
+#include <sys/wait.h>
+
+upload_pack_stats cl_upload_pack_stats;
+
+typedef struct {
+	git_smart_subtransport_stream parent;
+	char *path;
+	pid_t pid;
+	int to_child, from_child;
+	unsigned stateless : 1,
+		advertise : 1,
+		written : 1;
+	git_buf request;
+	size_t prefix_sent;
+} upload_pack_stream;
+
+typedef struct {
+	git_smart_subtransport parent;
+	git_transport *owner;
+	unsigned stateless;
+	upload_pack_stream *current;
+} upload_pack_subtransport;
+
+static const char http_prefix[] = "001e# service=git-upload-pack\n0000";
+
+static int upload_pack_spawn(upload_pack_stream *s)
+{
+	const char *argv[6];
+	int in[2], out[2], n = 0;
+
+	argv[n++] = "git";
+	argv[n++] = "upload-pack";
+	if (s->stateless) {
+		argv[n++] = "--stateless-rpc";
+		if (s->advertise)
+			argv[n++] = "--advertise-refs";
+	}
+	argv[n++] = s->path;
+	argv[n] = NULL;
+
+	cl_must_pass(pipe(in));
+	cl_must_pass(pipe(out));
+	cl_assert((s->pid = fork()) >= 0);
+
+	if (s->pid == 0) {
+		dup2(in[0], 0);
+		dup2(out[1], 1);
+		close(in[0]); close(in[1]);
+		close(out[0]); close(out[1]);
+		execvp(argv[0], (char * const *)argv);
+		_exit(127);
+	}
+
+	close(in[0]);
+	close(out[1]);
+	s->to_child = in[1];
+	s->from_child = out[0];
+
+	return 0;
+}
+
+static int write_all(int fd, const char *buffer, size_t len)
+{
+	ssize_t written;
+
+	while (len > 0) {
+		if ((written = write(fd, buffer, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			giterr_set(GITERR_OS, "Failed to write to upload-pack");
+			return -1;
+		}
+
+		buffer += written;
+		len -= written;
+	}
+
+	return 0;
+}
+
+static int upload_pack_read(
+	git_smart_subtransport_stream *stream,
+	char *buffer,
+	size_t buf_size,
+	size_t *bytes_read)
+{
+	upload_pack_stream *s = (upload_pack_stream *)stream;
+	ssize_t n;
+
+	*bytes_read = 0;
+
+	/* What the HTTP server would have said before the advertisement */
+	if (s->stateless && s->advertise && s->prefix_sent < strlen(http_prefix)) {
+		n = strlen(http_prefix) - s->prefix_sent;
+		if ((size_t)n > buf_size)
+			n = buf_size;
+
+		memcpy(buffer, http_prefix + s->prefix_sent, n);
+		s->prefix_sent += n;
+		*bytes_read = n;
+		return 0;
+	}
+
+	/* The client waits for an answer to what it has just written */
+	if (s->written) {
+		s->written = 0;
+		cl_upload_pack_stats.round_trips++;
+		if (cl_upload_pack_stats.latency_ms)
+			usleep(cl_upload_pack_stats.latency_ms * 1000);
+	}
+
+	/* A request is complete once the client starts reading the response */
+	if (s->pid == 0) {
+		if (upload_pack_spawn(s) < 0 ||
+			write_all(s->to_child, s->request.ptr, s->request.size) < 0)
+			return -1;
+
+		close(s->to_child);
+		s->to_child = -1;
+	}
+
+	do {
+		n = read(s->from_child, buffer, buf_size);
+	} while (n < 0 && errno == EINTR);
+
+	if (n < 0) {
+		giterr_set(GITERR_OS, "Failed to read from upload-pack");
+		return -1;
+	}
+
+	*bytes_read = n;
+	return 0;
+}
+
+/* The client writes whole pkt-lines, so they can be counted as they go */
+static void count_haves(const char *buffer, size_t len)
+{
+	char hex[5] = { 0 };
+	size_t pkt_len;
+
+	while (len >= 4) {
+		memcpy(hex, buffer, 4);
+		pkt_len = strtoul(hex, NULL, 16);
+		if (pkt_len < 4)
+			pkt_len = 4;
+		else if (pkt_len > len)
+			break;
+
+		if (pkt_len > 9 && !memcmp(buffer + 4, "have ", 5))
+			cl_upload_pack_stats.haves++;
+
+		buffer += pkt_len;
+		len -= pkt_len;
+	}
+}
+
+static int upload_pack_write(
+	git_smart_subtransport_stream *stream,
+	const char *buffer,
+	size_t len)
+{
+	upload_pack_stream *s = (upload_pack_stream *)stream;
+
+	s->written = 1;
+	count_haves(buffer, len);
+
+	if (s->stateless)
+		return git_buf_put(&s->request, buffer, len);
+
+	return write_all(s->to_child, buffer, len);
+}
+
+static void upload_pack_stream_free(git_smart_subtransport_stream *stream)
+{
+	upload_pack_stream *s = (upload_pack_stream *)stream;
+	upload_pack_subtransport *t = (upload_pack_subtransport *)stream->subtransport;
+	int status;
+
+	if (t->current == s)
+		t->current = NULL;
+
+	if (s->to_child >= 0)
+		close(s->to_child);
+	if (s->from_child >= 0)
+		close(s->from_child);
+	if (s->pid > 0)
+		waitpid(s->pid, &status, 0);
+
+	git_buf_free(&s->request);
+	git__free(s->path);
+	git__free(s);
+}
+
+static int upload_pack_action(
+	git_smart_subtransport_stream **out,
+	git_smart_subtransport *subtransport,
+	const char *url,
+	git_smart_service_t action)
+{
+	upload_pack_subtransport *t = (upload_pack_subtransport *)subtransport;
+	upload_pack_stream *s;
+
+	cl_assert(action == GIT_SERVICE_UPLOADPACK_LS || action == GIT_SERVICE_UPLOADPACK);
+
+	/* A persistent connection carries on with the same process */
+	if (!t->stateless && action == GIT_SERVICE_UPLOADPACK && t->current) {
+		*out = &t->current->parent;
+		return 0;
+	}
+
+	s = git__calloc(1, sizeof(upload_pack_stream));
+	GITERR_CHECK_ALLOC(s);
+
+	s->parent.subtransport = subtransport;
+	s->parent.read = upload_pack_read;
+	s->parent.write = upload_pack_write;
+	s->parent.free = upload_pack_stream_free;
+	s->path = git__strdup(strstr(url, "://") + 3);
+	s->stateless = t->stateless;
+	s->advertise = (action == GIT_SERVICE_UPLOADPACK_LS);
+	s->to_child = s->from_child = -1;
+
+	if ((!s->stateless || s->advertise) && upload_pack_spawn(s) < 0)
+		return -1;
+
+	t->current = s;
+	*out = &s->parent;
+	return 0;
+}
+
+static int upload_pack_close(git_smart_subtransport *subtransport)
+{
+	GIT_UNUSED(subtransport);
+	return 0;
+}
+
+static void upload_pack_free(git_smart_subtransport *subtransport)
+{
+	git__free(subtransport);
+}
+
+static int upload_pack_new(git_smart_subtransport **out, git_transport *owner, unsigned stateless)
+{
+	upload_pack_subtransport *t = git__calloc(1, sizeof(upload_pack_subtransport));
+	GITERR_CHECK_ALLOC(t);
+
+	t->parent.action = upload_pack_action;
+	t->parent.close = upload_pack_close;
+	t->parent.free = upload_pack_free;
+	t->owner = owner;
+	t->stateless = stateless;
+
+	*out = &t->parent;
+	return 0;
+}
+
+static int upload_pack_stateful(git_smart_subtransport **out, git_transport *owner)
+{
+	return upload_pack_new(out, owner, 0);
+}
+
+static int upload_pack_stateless(git_smart_subtransport **out, git_transport *owner)
+{
+	return upload_pack_new(out, owner, 1);
+}
+
+static git_smart_subtransport_definition _stateful = { upload_pack_stateful, 0 };
+static git_smart_subtransport_definition _stateless = { upload_pack_stateless, 1 };
+
+static void (*_old_sigpipe)(int);
+
+static void unregister_upload_pack(void *unused)
+{
+	GIT_UNUSED(unused);
+
+	git_transport_unregister("upload-pack://", 1);
+	git_transport_unregister("upload-pack-rpc://", 1);
+	signal(SIGPIPE, _old_sigpipe);
+}
+
+void cl_upload_pack_register(void)
+{
+	if (system("git --version >/dev/null 2>&1") != 0)
+		cl_skip();
+
+	_old_sigpipe = signal(SIGPIPE, SIG_IGN);
+	cl_git_pass(git_transport_register("upload-pack://", 1, git_transport_smart, &_stateful));
+	cl_git_pass(git_transport_register("upload-pack-rpc://", 1, git_transport_smart, &_stateless));
+	cl_set_cleanup(unregister_upload_pack, NULL);
+
+	memset(&cl_upload_pack_stats, 0, sizeof(cl_upload_pack_stats));
+}
+
+void cl_upload_pack_url(git_buf *url, const char *scheme, const char *path)
+{
+	char full[GIT_PATH_MAX];
+
+	cl_assert(p_realpath(path, full) != NULL);
+	cl_git_pass(git_buf_printf(url, "%s://%s", scheme, full));
+}
+
+#endif
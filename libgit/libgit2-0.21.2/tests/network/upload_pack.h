@@ -0,0 +1,33 @@
+#ifndef INCLUDE_cl_upload_pack_h__
+#define INCLUDE_cl_upload_pack_h__
+
+#include "buffer.h"
+
+#ifndef GIT_WIN32
+
+/*
+ * A stand-in for git:// and smart HTTP: "upload-pack://<path>" runs the
+ * `git upload-pack` found in the PATH once for the whole conversation,
+ * "upload-pack-rpc://<path>" runs it once per request like an HTTP
+ * server would.
+ */
+
+typedef struct {
+	/* answers the client had to wait for, the ref advertisement aside */
+	size_t round_trips;
+	/* "have" lines the client sent */
+	size_t haves;
+	/* simulated network latency, added to each round trip */
+	unsigned int latency_ms;
+} upload_pack_stats;
+
+extern upload_pack_stats cl_upload_pack_stats;
+
+/* Register both schemes for the rest of the test; skips it without git */
+void cl_upload_pack_register(void);
+
+void cl_upload_pack_url(git_buf *url, const char *scheme, const char *path);
+
+#endif
+
+#endif
@@ -0,0 +1,195 @@
+#include "clar_libgit2.h"
+
+#include "hash.h"
+
+/*
+ * Only the builtin SHA-1 has several implementations to choose from;
+ * the tests are skipped when the library uses OpenSSL or WinCNG.
+ */
+#if !defined(OPENSSL_SHA1) && !defined(WIN32_SHA1)
+# define HASH_IMPLS
+#endif
+
+#ifdef HASH_IMPLS
+static git_hash_impl _default_impl;
+#endif
+
+void test_object_raw_hashimpl__initialize(void)
+{
+#ifdef HASH_IMPLS
+	_default_impl = git_hash_impl_get();
+#endif
+}
+
+void test_object_raw_hashimpl__cleanup(void)
+{
+#ifdef HASH_IMPLS
+	cl_git_pass(git_hash_impl_set(_default_impl));
+#endif
+}
+
+#ifdef HASH_IMPLS
+
+static void hash_in_pieces(git_oid *out, const unsigned char *data, size_t len, size_t step)
+{
+	git_hash_ctx ctx;
+	size_t off, n;
+
+	cl_git_pass(git_hash_ctx_init(&ctx));
+	for (off = 0; off < len; off += n) {
+		n = (len - off < step) ? len - off : step;
+		cl_git_pass(git_hash_update(&ctx, data + off, n));
+	}
+	cl_git_pass(git_hash_final(out, &ctx));
+	git_hash_ctx_cleanup(&ctx);
+}
+
+static void assert_hash(const char *expected, const void *data, size_t len)
+{
+	git_oid oid;
+	char str[GIT_OID_HEXSZ + 1];
+
+	cl_git_pass(git_hash_buf(&oid, data, len));
+	git_oid_tostr(str, sizeof(str), &oid);
+	cl_assert_equal_s(expected, str);
+}
+
+#endif
+
+void test_object_raw_hashimpl__default_is_fastest_supported(void)
+{
+#ifndef HASH_IMPLS
+	cl_skip();
+#else
+	int impl;
+
+	cl_assert(git_hash_impl_supported(GIT_HASH_IMPL_GENERIC));
+
+	for (impl = GIT_HASH_IMPL__COUNT - 1; impl > GIT_HASH_IMPL_GENERIC; impl--)
+		if (git_hash_impl_supported((git_hash_impl)impl))
+			break;
+
+	cl_assert_equal_i(impl, git_hash_impl_get());
+	cl_git_fail(git_hash_impl_set(GIT_HASH_IMPL__COUNT));
+#endif
+}
+
+void test_object_raw_hashimpl__known_vectors(void)
+{
+#ifndef HASH_IMPLS
+	cl_skip();
+#else
+	unsigned char *million;
+	int impl;
+
+	million = git__malloc(1000000);
+	cl_assert(million);
+	memset(million, 'a', 1000000);
+
+	for (impl = 0; impl < GIT_HASH_IMPL__COUNT; impl++) {
+		if (!git_hash_impl_supported((git_hash_impl)impl))
+			continue;
+
+		cl_git_pass(git_hash_impl_set((git_hash_impl)impl));
+
+		assert_hash("da39a3ee5e6b4b0d3255bfef95601890afd80709", "", 0);
+		assert_hash("a9993e364706816aba3e25717850c26c9cd0d89d", "abc", 3);
+		assert_hash("84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+			"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56);
+		assert_hash("a49b2446a02c645bf419f995b67091253a04a259",
+			"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 112);
+		assert_hash("34aa973cd4c4daa4f61eeb2bdbad27316534016f", million, 1000000);
+	}
+
+	git__free(million);
+#endif
+}
+
+void test_object_raw_hashimpl__matches_generic(void)
+{
+#ifndef HASH_IMPLS
+	cl_skip();
+#else
+	unsigned char data[4096 + 63];
+	git_oid expected, actual;
+	size_t i, len;
+	int impl;
+	unsigned int seed = 42;
+
+	for (i = 0; i < sizeof(data); i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (unsigned char)(seed >> 16);
+	}
+
+	for (len = 0; len < sizeof(data); len += 61) {
+		cl_git_pass(git_hash_impl_set(GIT_HASH_IMPL_GENERIC));
+		cl_git_pass(git_hash_buf(&expected, data, len));
+
+		for (impl = 1; impl < GIT_HASH_IMPL__COUNT; impl++) {
+			if (!git_hash_impl_supported((git_hash_impl)impl))
+				continue;
+
+			cl_git_pass(git_hash_impl_set((git_hash_impl)impl));
+
+			cl_git_pass(git_hash_buf(&actual, data, len));
+			cl_assert(git_oid_equal(&expected, &actual));
+
+			/* unaligned and partial updates go through the buffered path */
+			hash_in_pieces(&actual, data + 1, len, 37);
+			cl_git_pass(git_hash_impl_set(GIT_HASH_IMPL_GENERIC));
+			hash_in_pieces(&expected, data + 1, len, 200);
+			cl_assert(git_oid_equal(&expected, &actual));
+			cl_git_pass(git_hash_buf(&expected, data, len));
+		}
+	}
+#endif
+}
+
+/*
+ * Opt-in benchmark: GITTEST_SHA1_BENCH=<megabytes> hashes a buffer with
+ * every implementation the CPU supports and prints the throughput.
+ */
+void test_object_raw_hashimpl__benchmark(void)
+{
+#ifndef HASH_IMPLS
+	cl_skip();
+#else
+	const char *env = cl_getenv("GITTEST_SHA1_BENCH");
+	unsigned char *data;
+	size_t mb, len, i;
+	git_oid oid;
+	double elapsed;
+	int impl;
+
+	if (!env)
+		cl_skip();
+
+	mb = (size_t)strtoul(env, NULL, 10);
+	if (!mb)
+		mb = 256;
+
+	len = 1024 * 1024;
+	data = git__malloc(len);
+	cl_assert(data);
+	for (i = 0; i < len; i++)
+		data[i] = (unsigned char)(i * 31);
+
+	printf("\n");
+	for (impl = 0; impl < GIT_HASH_IMPL__COUNT; impl++) {
+		if (!git_hash_impl_supported((git_hash_impl)impl))
+			continue;
+
+		cl_git_pass(git_hash_impl_set((git_hash_impl)impl));
+
+		elapsed = git__timer();
+		for (i = 0; i < mb; i++)
+			cl_git_pass(git_hash_buf(&oid, data, len));
+		elapsed = git__timer() - elapsed;
+
+		printf("%-10s %8.1f MB/s\n", git_hash_impl_name((git_hash_impl)impl), mb / elapsed);
+	}
+
+	git__free(data);
+#endif
+}
@@ -0,0 +1,311 @@
+#include "clar_libgit2.h"
+#include "buffer.h"
+#include "fileops.h"
+#include "git2/odb_backend.h"
+#include "git2/sys/odb_backend.h"
+#include "repo/history.h"
+
+static git_repository *_repo;
+static git_odb *_odb;
+static git_odb_backend *_bulk;
+static git_vector _blobs;
+
+void test_odb_bulk__initialize(void)
+{
+	cl_git_pass(git_repository_init(&_repo, "bulk", false));
+	cl_git_pass(git_repository_odb(&_odb, _repo));
+	cl_git_pass(git_vector_init(&_blobs, 0, NULL));
+}
+
+void test_odb_bulk__cleanup(void)
+{
+	git_vector_free_deep(&_blobs);
+
+	git_odb_free(_odb);
+	_odb = NULL;
+	git_repository_free(_repo);
+	_repo = NULL;
+	_bulk = NULL;
+
+	cl_fixture_cleanup("bulk");
+}
+
+static void add_bulk_backend(unsigned int threads)
+{
+	git_odb_bulk_options opts = GIT_ODB_BULK_OPTIONS_INIT;
+
+	opts.threads = threads;
+	cl_git_pass(git_odb_backend_bulk(&_bulk, "bulk/.git/objects", &opts));
+	cl_git_pass(git_odb_add_backend(_odb, _bulk, 10));
+}
+
+static void asset_content(git_buf *out, size_t i, size_t file, void *payload)
+{
+	GIT_UNUSED(file);
+	GIT_UNUSED(payload);
+
+	git_buf_printf(out, "asset %u\n", (unsigned)i);
+	while (out->size < (i % 7) * 1000)
+		git_buf_printf(out, "%u ", (unsigned)(out->size * i));
+}
+
+/* Write `nblobs` distinct blobs through the repository, a commit each */
+static void write_blobs(size_t nblobs)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+
+	opts.content = asset_content;
+	opts.blobs = &_blobs;
+	cl_history_build(NULL, _repo, NULL, nblobs, &opts);
+}
+
+/* Check every blob can be read back, and hashes to its id */
+static void assert_blobs_readable(git_odb *odb)
+{
+	git_odb_object *obj;
+	git_oid *id, check;
+	size_t i;
+
+	git_vector_foreach(&_blobs, i, id) {
+		cl_git_pass(git_odb_read(&obj, odb, id));
+		cl_git_pass(git_odb_hash(&check, git_odb_object_data(obj),
+			git_odb_object_size(obj), git_odb_object_type(obj)));
+		cl_assert(git_oid_equal(id, &check));
+		git_odb_object_free(obj);
+	}
+}
+
+static int count_entry(void *payload, git_buf *path)
+{
+	GIT_UNUSED(path);
+	(*(size_t *)payload)++;
+	return 0;
+}
+
+/* Number of entries in a directory under .git/objects */
+static size_t count_in(const char *dir)
+{
+	git_buf path = GIT_BUF_INIT;
+	size_t count = 0;
+
+	cl_git_pass(git_buf_joinpath(&path, "bulk/.git/objects", dir));
+	cl_git_pass(git_path_direach(&path, 0, count_entry, &count));
+	git_buf_free(&path);
+
+	return count;
+}
+
+/* Number of loose object directories */
+static size_t count_loose(void)
+{
+	return count_in("") - 2; /* info and pack */
+}
+
+static void import_and_commit(unsigned int threads)
+{
+	git_repository *reopened;
+	git_odb *odb;
+	git_odb_object *obj;
+	git_oid name;
+
+	add_bulk_backend(threads);
+	write_blobs(500);
+
+	/* readable before the commit, without a single loose object */
+	assert_blobs_readable(_odb);
+	cl_assert_equal_sz(0, count_loose());
+
+	/* and by abbreviated id */
+	cl_git_pass(git_odb_read_prefix(&obj, _odb, git_vector_get(&_blobs, 0), 12));
+	cl_assert(git_oid_equal(git_vector_get(&_blobs, 0), git_odb_object_id(obj)));
+	git_odb_object_free(obj);
+
+	cl_git_pass(git_odb_bulk_commit(&name, _bulk));
+	cl_assert(!git_oid_iszero(&name));
+	cl_assert_equal_sz(2, count_in("pack"));
+
+	assert_blobs_readable(_odb);
+
+	cl_git_pass(git_repository_open(&reopened, "bulk"));
+	cl_git_pass(git_repository_odb(&odb, reopened));
+	assert_blobs_readable(odb);
+	git_odb_free(odb);
+	git_repository_free(reopened);
+}
+
+void test_odb_bulk__import(void)
+{
+	import_and_commit(0);
+}
+
+void test_odb_bulk__import_with_threads(void)
+{
+	import_and_commit(4);
+}
+
+void test_odb_bulk__writes_through_streams_and_trees(void)
+{
+	git_treebuilder *tb;
+	git_oid blob_id, tree_id, commit_id;
+	git_tree *tree;
+	git_signature *sig;
+	git_commit *commit;
+
+	add_bulk_backend(2);
+
+	cl_git_mkfile("bulk/asset.txt", "an asset on disk\n");
+	cl_git_pass(git_blob_create_fromworkdir(&blob_id, _repo, "asset.txt"));
+
+	cl_git_pass(git_treebuilder_create(&tb, NULL));
+	cl_git_pass(git_treebuilder_insert(NULL, tb, "asset.txt", &blob_id, GIT_FILEMODE_BLOB));
+	cl_git_pass(git_treebuilder_write(&tree_id, _repo, tb));
+	git_treebuilder_free(tb);
+
+	cl_git_pass(git_tree_lookup(&tree, _repo, &tree_id));
+	cl_git_pass(git_signature_new(&sig, "bulk", "bulk@example.com", 1234567890, 0));
+	cl_git_pass(git_commit_create(&commit_id, _repo, NULL, sig, sig,
+		NULL, "import\n", tree, 0, NULL));
+	git_signature_free(sig);
+	git_tree_free(tree);
+
+	cl_assert_equal_sz(0, count_loose());
+	cl_git_pass(git_odb_bulk_commit(NULL, _bulk));
+
+	cl_git_pass(git_commit_lookup(&commit, _repo, &commit_id));
+	cl_assert(git_oid_equal(&tree_id, git_commit_tree_id(commit)));
+	git_commit_free(commit);
+}
+
+void test_odb_bulk__duplicates_are_written_once(void)
+{
+	git_oid id, again;
+	git_indexer *idx;
+	git_transfer_progress stats;
+	git_buf pack = GIT_BUF_INIT, path = GIT_BUF_INIT;
+	char hex[GIT_OID_HEXSZ + 1];
+	git_oid name;
+
+	add_bulk_backend(0);
+
+	cl_git_pass(git_blob_create_frombuffer(&id, _repo, "same\n", 5));
+	cl_git_pass(git_blob_create_frombuffer(&again, _repo, "same\n", 5));
+	cl_assert(git_oid_equal(&id, &again));
+	cl_git_pass(git_blob_create_frombuffer(&id, _repo, "other\n", 6));
+
+	cl_git_pass(git_odb_bulk_commit(&name, _bulk));
+
+	/* the pack is well formed: index it again from scratch */
+	git_oid_tostr(hex, sizeof(hex), &name);
+	cl_git_pass(git_buf_printf(&path, "bulk/.git/objects/pack/pack-%s.pack", hex));
+	cl_git_pass(git_futils_readbuffer(&pack, path.ptr));
+
+	cl_git_pass(git_futils_mkdir("reindexed", NULL, 0777, 0));
+	memset(&stats, 0, sizeof(stats));
+	cl_git_pass(git_indexer_new(&idx, "reindexed", 0, NULL, NULL, NULL));
+	cl_git_pass(git_indexer_append(idx, pack.ptr, pack.size, &stats));
+	cl_git_pass(git_indexer_commit(idx, &stats));
+	cl_assert_equal_i(2, stats.total_objects);
+	cl_assert(git_oid_equal(&name, git_indexer_hash(idx)));
+	git_indexer_free(idx);
+
+	git_buf_free(&path);
+	git_buf_free(&pack);
+	cl_fixture_cleanup("reindexed");
+}
+
+void test_odb_bulk__discard(void)
+{
+	add_bulk_backend(2);
+	write_blobs(50);
+
+	git_odb_bulk_discard(_bulk);
+
+	cl_assert(!git_odb_exists(_odb, git_vector_get(&_blobs, 0)));
+	cl_assert_equal_sz(0, count_in("pack"));
+	cl_git_fail(git_odb_bulk_commit(NULL, _bulk));
+}
+
+void test_odb_bulk__passes_writes_on_once_committed(void)
+{
+	git_oid id;
+
+	add_bulk_backend(0);
+	cl_git_pass(git_odb_bulk_commit(NULL, _bulk));
+	cl_assert_equal_sz(0, count_in("pack"));
+
+	cl_git_pass(git_blob_create_frombuffer(&id, _repo, "later\n", 6));
+	cl_git_mkfile("bulk/later.txt", "later on disk\n");
+	cl_git_pass(git_blob_create_fromworkdir(&id, _repo, "later.txt"));
+
+	cl_assert_equal_sz(2, count_loose());
+	cl_assert(git_odb_exists(_odb, &id));
+}
+
+void test_odb_bulk__restart_reuses_the_backend(void)
+{
+	git_odb_bulk_options opts = GIT_ODB_BULK_OPTIONS_INIT;
+	git_oid id;
+	size_t backends;
+
+	add_bulk_backend(0);
+	backends = git_odb_num_backends(_odb);
+
+	/* only once the previous import is over */
+	cl_git_fail(git_odb_bulk_restart(_bulk, NULL));
+
+	write_blobs(20);
+	cl_git_pass(git_odb_bulk_commit(NULL, _bulk));
+
+	opts.threads = 4;
+	cl_git_pass(git_odb_bulk_restart(_bulk, &opts));
+	cl_git_pass(git_blob_create_frombuffer(&id, _repo, "second import\n", 14));
+	cl_assert_equal_sz(0, count_loose());
+
+	cl_git_pass(git_odb_bulk_commit(NULL, _bulk));
+	cl_assert_equal_sz(4, count_in("pack"));
+	cl_assert_equal_sz(backends, git_odb_num_backends(_odb));
+
+	assert_blobs_readable(_odb);
+	cl_assert(git_odb_exists(_odb, &id));
+}
+
+/*
+ * Opt-in benchmark: GITTEST_BULK_BENCH=<objects> writes that many blobs
+ * as loose objects, then through bulk packs with 1 and 4 threads.
+ */
+void test_odb_bulk__benchmark(void)
+{
+	const char *env = cl_getenv("GITTEST_BULK_BENCH");
+	unsigned int threads[] = { 0, 4 };
+	size_t nblobs, i;
+	double start;
+
+	if (!env)
+		cl_skip();
+
+	nblobs = (size_t)atoi(env);
+	if (nblobs == 0)
+		nblobs = 30000;
+
+	start = git__timer();
+	write_blobs(nblobs);
+	printf("\n%u blobs: loose %.3fs", (unsigned)nblobs, git__timer() - start);
+
+	for (i = 0; i < ARRAY_SIZE(threads); i++) {
+		git_odb_free(_odb);
+		git_repository_free(_repo);
+		git_vector_free_deep(&_blobs);
+		cl_fixture_cleanup("bulk");
+
+		cl_git_pass(git_repository_init(&_repo, "bulk", false));
+		cl_git_pass(git_repository_odb(&_odb, _repo));
+
+		start = git__timer();
+		add_bulk_backend(threads[i]);
+		write_blobs(nblobs);
+		cl_git_pass(git_odb_bulk_commit(NULL, _bulk));
+		printf(", bulk (%u threads) %.3fs", threads[i], git__timer() - start);
+	}
+
+	printf("\n");
+}
@@ -0,0 +1,143 @@
+#include "clar_libgit2.h"
+#include "buffer.h"
+#include "git2/odb_backend.h"
+#include "git2/indexer.h"
+
+static git_repository *_repo;
+static git_odb *_odb;
+static git_buf _content = GIT_BUF_INIT;
+
+void test_odb_streamread__initialize(void)
+{
+	unsigned int i;
+
+	cl_git_pass(git_repository_init(&_repo, "streamread.git", true));
+	cl_git_pass(git_repository_odb(&_odb, _repo));
+
+	/* big enough to span many reads and zlib input buffers */
+	for (i = 0; i < 100000; i++)
+		git_buf_printf(&_content, "line %u of a large asset\n", i * 2654435761u);
+	cl_assert(!git_buf_oom(&_content));
+}
+
+void test_odb_streamread__cleanup(void)
+{
+	git_buf_free(&_content);
+	git_odb_free(_odb);
+	_odb = NULL;
+	git_repository_free(_repo);
+	_repo = NULL;
+
+	cl_fixture_cleanup("streamread.git");
+	cl_fixture_cleanup("streamread_packed.git");
+}
+
+/* Read the whole object through a stream, `chunk` bytes at a time */
+static void stream_object(git_buf *out, git_odb *odb, const git_oid *id, size_t chunk)
+{
+	git_odb_stream *stream;
+	char buffer[65536];
+	int read;
+
+	cl_assert(chunk <= sizeof(buffer));
+
+	cl_git_pass(git_odb_open_rstream(&stream, odb, id));
+	cl_assert_equal_i(GIT_STREAM_RDONLY, stream->mode);
+
+	git_buf_clear(out);
+	while ((read = git_odb_stream_read(stream, buffer, chunk)) > 0)
+		cl_git_pass(git_buf_put(out, buffer, read));
+	cl_git_pass(read);
+
+	cl_assert_equal_sz(out->size, stream->declared_size);
+	git_odb_stream_free(stream);
+}
+
+static void assert_streams_as(git_odb *odb, const git_oid *id, const git_buf *expected)
+{
+	git_buf streamed = GIT_BUF_INIT;
+	size_t chunks[] = { 1, 7, 4096, 65536 };
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		/* byte by byte only for the beginning of big objects */
+		if (chunks[i] == 1 && expected->size > 4096)
+			continue;
+
+		stream_object(&streamed, odb, id, chunks[i]);
+		cl_assert_equal_sz(expected->size, streamed.size);
+		cl_assert(memcmp(expected->ptr, streamed.ptr, expected->size) == 0);
+	}
+
+	git_buf_free(&streamed);
+}
+
+void test_odb_streamread__loose(void)
+{
+	git_oid id;
+	git_buf small = GIT_BUF_INIT;
+
+	cl_git_pass(git_odb_write(&id, _odb, _content.ptr, _content.size, GIT_OBJ_BLOB));
+	assert_streams_as(_odb, &id, &_content);
+
+	cl_git_pass(git_buf_sets(&small, "tiny\n"));
+	cl_git_pass(git_odb_write(&id, _odb, small.ptr, small.size, GIT_OBJ_BLOB));
+	assert_streams_as(_odb, &id, &small);
+
+	git_buf_clear(&small);
+	cl_git_pass(git_odb_write(&id, _odb, small.ptr, small.size, GIT_OBJ_BLOB));
+	assert_streams_as(_odb, &id, &small);
+
+	git_buf_free(&small);
+}
+
+void test_odb_streamread__packed(void)
+{
+	git_buf edited = GIT_BUF_INIT, pack = GIT_BUF_INIT;
+	git_oid id, edited_id;
+	git_packbuilder *pb;
+	git_indexer *idx;
+	git_transfer_progress stats;
+	git_repository *packed;
+	git_odb *packed_odb;
+
+	cl_git_pass(git_odb_write(&id, _odb, _content.ptr, _content.size, GIT_OBJ_BLOB));
+
+	/* a small edit, so one of the two ends up as a delta of the other */
+	cl_git_pass(git_buf_set(&edited, _content.ptr, _content.size));
+	memcpy(edited.ptr + edited.size / 2, "EDITED", 6);
+	cl_git_pass(git_odb_write(&edited_id, _odb, edited.ptr, edited.size, GIT_OBJ_BLOB));
+
+	cl_git_pass(git_packbuilder_new(&pb, _repo));
+	cl_git_pass(git_packbuilder_insert(pb, &id, NULL));
+	cl_git_pass(git_packbuilder_insert(pb, &edited_id, NULL));
+	cl_git_pass(git_packbuilder_write_buf(&pack, pb));
+	git_packbuilder_free(pb);
+
+	cl_git_pass(git_repository_init(&packed, "streamread_packed.git", true));
+
+	memset(&stats, 0, sizeof(stats));
+	cl_git_pass(git_indexer_new(&idx, "streamread_packed.git/objects/pack", 0, NULL, NULL, NULL));
+	cl_git_pass(git_indexer_append(idx, pack.ptr, pack.size, &stats));
+	cl_git_pass(git_indexer_commit(idx, &stats));
+	cl_assert_equal_i(1, stats.indexed_deltas);
+	git_indexer_free(idx);
+
+	cl_git_pass(git_repository_odb(&packed_odb, packed));
+	assert_streams_as(packed_odb, &id, &_content);
+	assert_streams_as(packed_odb, &edited_id, &edited);
+
+	git_odb_free(packed_odb);
+	git_repository_free(packed);
+	git_buf_free(&pack);
+	git_buf_free(&edited);
+}
+
+void test_odb_streamread__missing_object(void)
+{
+	git_odb_stream *stream;
+	git_oid id;
+
+	cl_git_pass(git_oid_fromstr(&id, "deadbeefdeadbeefdeadbeefdeadbeefdeadbeef"));
+	cl_assert_equal_i(GIT_ENOTFOUND, git_odb_open_rstream(&stream, _odb, &id));
+}
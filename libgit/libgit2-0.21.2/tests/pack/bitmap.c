@@ -0,0 +1,361 @@
+#include "clar_libgit2.h"
+#include "fileops.h"
+#include "ewah.h"
+#include "pack-bitmap.h"
+#include "pack-objects.h"
+#include "posix.h"
+#include "repository.h"
+#include "repo/history.h"
+
+static git_repository *_repo;
+static git_repository *_clone;
+
+/* every file of every commit is new, so each commit brings objects of its own */
+static void line_content(git_buf *out, size_t commit, size_t file, void *payload)
+{
+	git_buf_printf(out, "%s %u file %u\n",
+		(const char *)payload, (unsigned)commit, (unsigned)file);
+}
+
+/* master and br2, forking off a shared history */
+void test_pack_bitmap__initialize(void)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+	git_oid base;
+
+	cl_git_pass(git_repository_init(&_repo, "bitmap.git", true));
+
+	opts.nfiles = 4;
+	opts.content = line_content;
+	opts.refname = "refs/heads/master";
+	opts.payload = "base";
+	cl_history_build(&base, _repo, NULL, 10, &opts);
+
+	opts.time += 10 * 60;
+	opts.payload = "master";
+	cl_history_build(NULL, _repo, &base, 10, &opts);
+
+	opts.refname = "refs/heads/br2";
+	opts.payload = "br2";
+	opts.nfiles = 3;
+	cl_history_build(NULL, _repo, &base, 5, &opts);
+}
+
+void test_pack_bitmap__cleanup(void)
+{
+	git_repository_free(_clone);
+	_clone = NULL;
+	git_repository_free(_repo);
+	_repo = NULL;
+
+	cl_fixture_cleanup("bitmap.git");
+	cl_fixture_cleanup("bitmap_clone");
+}
+
+static bool have_git(void)
+{
+	return system("git --version >/dev/null 2>&1") == 0;
+}
+
+static void assert_bitmaps_equal(const git_bitmap *a, const git_bitmap *b)
+{
+	cl_assert(git_bitmap_contains(a, b));
+	cl_assert(git_bitmap_contains(b, a));
+}
+
+void test_pack_bitmap__ewah_roundtrip(void)
+{
+	git_bitmap bitmap = GIT_BITMAP_INIT, read = GIT_BITMAP_INIT;
+	git_buf buf = GIT_BUF_INIT;
+	size_t i;
+
+	/* literals, a run of ones, a run of zeroes and a lone bit */
+	cl_git_pass(git_bitmap_set(&bitmap, 0));
+	cl_git_pass(git_bitmap_set(&bitmap, 3));
+	for (i = 64; i < 64 * 5; i++)
+		cl_git_pass(git_bitmap_set(&bitmap, i));
+	cl_git_pass(git_bitmap_set(&bitmap, 64 * 5 + 7));
+	cl_git_pass(git_bitmap_set(&bitmap, 64 * 40 + 63));
+
+	cl_git_pass(git_ewah_write(&buf, &bitmap));
+	cl_assert_equal_i(buf.size, git_ewah_size((unsigned char *)buf.ptr, buf.size));
+
+	cl_assert_equal_i(buf.size,
+		git_ewah_read(&read, (unsigned char *)buf.ptr, buf.size, 64 * 41));
+	assert_bitmaps_equal(&bitmap, &read);
+	cl_assert_equal_i(4 * 64 + 4, git_bitmap_count(&read));
+
+	/* a bitmap longer than the pack is refused */
+	git_bitmap_free(&read);
+	cl_git_fail(git_ewah_read(&read, (unsigned char *)buf.ptr, buf.size, 64 * 40));
+
+	/* as is a truncated one */
+	git_bitmap_free(&read);
+	cl_git_fail(git_ewah_read(&read, (unsigned char *)buf.ptr, buf.size - 5, 64 * 41));
+
+	git_bitmap_free(&read);
+	git_bitmap_free(&bitmap);
+	git_buf_free(&buf);
+}
+
+/* Pack every object reachable from the branches, with a bitmap index */
+static void write_bitmapped_pack(void)
+{
+	git_packbuilder *pb;
+	git_revwalk *walk;
+	git_buf path = GIT_BUF_INIT, bitmap = GIT_BUF_INIT;
+	char hex[GIT_OID_HEXSZ + 1];
+
+	cl_git_pass(git_packbuilder_new(&pb, _repo));
+	cl_git_pass(git_revwalk_new(&walk, _repo));
+
+	cl_git_pass(git_revwalk_push_glob(walk, "refs/heads/*"));
+	cl_git_pass(git_packbuilder_insert_walk(pb, walk));
+
+	git_packbuilder_set_write_bitmap(pb, 1);
+	cl_git_pass(git_buf_joinpath(&path, git_repository_path(_repo), "objects/pack"));
+	cl_git_pass(git_packbuilder_write(pb, path.ptr, 0, NULL, NULL));
+
+	git_oid_tostr(hex, sizeof(hex), git_packbuilder_hash(pb));
+	cl_git_pass(git_buf_printf(&bitmap, "%s/pack-%s.bitmap", path.ptr, hex));
+	cl_assert(git_path_isfile(bitmap.ptr));
+
+	git_buf_free(&bitmap);
+	git_buf_free(&path);
+	git_revwalk_free(walk);
+	git_packbuilder_free(pb);
+}
+
+static void assert_bitmap_opens(void)
+{
+	git_pack_bitmap *bitmap;
+	git_buf path = GIT_BUF_INIT;
+
+	cl_git_pass(git_buf_joinpath(&path, git_repository_path(_repo), "objects"));
+	cl_git_pass(git_pack_bitmap_open(&bitmap, path.ptr));
+
+	git_pack_bitmap_free(bitmap);
+	git_buf_free(&path);
+}
+
+static void set_use_bitmaps(git_repository *repo, bool use)
+{
+	git_config *cfg;
+
+	cl_git_pass(git_repository_config(&cfg, repo));
+	cl_git_pass(git_config_set_bool(cfg, "pack.useBitmaps", use));
+	git_config_free(cfg);
+}
+
+static void push(git_revwalk *walk, const char *refs, bool hide)
+{
+	if (strchr(refs, '*'))
+		cl_git_pass(hide ? git_revwalk_hide_glob(walk, refs) : git_revwalk_push_glob(walk, refs));
+	else
+		cl_git_pass(hide ? git_revwalk_hide_ref(walk, refs) : git_revwalk_push_ref(walk, refs));
+}
+
+static int oid_cmp(const void *a, const void *b)
+{
+	return git_oid_cmp(a, b);
+}
+
+/* The objects a packbuilder picks for `wants` minus `haves`, sorted */
+static void enumerate(
+	git_array_oid_t *out, bool use_bitmaps, const char *wants, const char *haves)
+{
+	git_packbuilder *pb;
+	git_revwalk *walk;
+	git_oid *id;
+	uint32_t i;
+
+	set_use_bitmaps(_repo, use_bitmaps);
+
+	cl_git_pass(git_packbuilder_new(&pb, _repo));
+	cl_git_pass(git_revwalk_new(&walk, _repo));
+
+	push(walk, wants, false);
+	if (haves)
+		push(walk, haves, true);
+	cl_git_pass(git_packbuilder_insert_walk(pb, walk));
+
+	for (i = 0; i < pb->nr_objects; i++) {
+		id = git_array_alloc(*out);
+		cl_assert(id);
+		git_oid_cpy(id, &pb->object_list[i].id);
+	}
+
+	qsort(out->ptr, out->size, sizeof(git_oid), oid_cmp);
+
+	git_revwalk_free(walk);
+	git_packbuilder_free(pb);
+}
+
+static void assert_same_objects(const char *wants, const char *haves)
+{
+	git_array_oid_t walked = GIT_ARRAY_INIT, bitmapped = GIT_ARRAY_INIT;
+	size_t i;
+
+	enumerate(&walked, false, wants, haves);
+	enumerate(&bitmapped, true, wants, haves);
+
+	cl_assert(walked.size > 0);
+	cl_assert_equal_i(walked.size, bitmapped.size);
+	for (i = 0; i < walked.size; i++)
+		cl_assert(git_oid_equal(git_array_get(walked, i), git_array_get(bitmapped, i)));
+
+	git_array_clear(walked);
+	git_array_clear(bitmapped);
+}
+
+void test_pack_bitmap__finds_the_same_objects_as_a_walk(void)
+{
+	write_bitmapped_pack();
+	assert_bitmap_opens();
+
+	assert_same_objects("refs/heads/*", NULL);
+	assert_same_objects("refs/heads/master", NULL);
+	assert_same_objects("refs/heads/*", "refs/heads/master");
+	assert_same_objects("refs/heads/master", "refs/heads/br2");
+}
+
+static void given_content(git_buf *out, size_t commit, size_t file, void *payload)
+{
+	GIT_UNUSED(commit);
+	GIT_UNUSED(file);
+	git_buf_puts(out, payload);
+}
+
+static void commit_on_branch(
+	git_oid *out, git_repository *repo, const char *branch, const char *content)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+	git_buf refname = GIT_BUF_INIT;
+	git_oid head;
+
+	cl_git_pass(git_reference_name_to_id(&head, repo, "HEAD"));
+	cl_git_pass(git_buf_printf(&refname, "refs/heads/%s", branch));
+
+	opts.refname = refname.ptr;
+	opts.content = given_content;
+	opts.payload = (void *)content;
+	cl_history_build(out, repo, &head, 1, &opts);
+
+	git_buf_free(&refname);
+}
+
+void test_pack_bitmap__covers_objects_outside_the_pack(void)
+{
+	git_oid id;
+
+	write_bitmapped_pack();
+	commit_on_branch(&id, _repo, "loose", "written after the pack\n");
+
+	assert_same_objects("refs/heads/*", NULL);
+	assert_same_objects("refs/heads/loose", "refs/heads/master");
+}
+
+void test_pack_bitmap__git_accepts_written_bitmaps(void)
+{
+	git_buf cmd = GIT_BUF_INIT;
+
+	if (!have_git())
+		cl_skip();
+
+	write_bitmapped_pack();
+
+	cl_git_pass(git_buf_printf(&cmd,
+		"cd '%s' && git rev-list --test-bitmap refs/heads/master >/dev/null 2>&1",
+		git_repository_path(_repo)));
+	cl_assert_equal_i(0, system(cmd.ptr));
+
+	git_buf_free(&cmd);
+}
+
+void test_pack_bitmap__reads_bitmaps_written_by_git(void)
+{
+	git_buf cmd = GIT_BUF_INIT;
+
+	if (!have_git())
+		cl_skip();
+
+	cl_git_pass(git_buf_printf(&cmd,
+		"cd '%s' && git repack -adbq >/dev/null 2>&1",
+		git_repository_path(_repo)));
+	cl_assert_equal_i(0, system(cmd.ptr));
+	assert_bitmap_opens();
+
+	assert_same_objects("refs/heads/*", NULL);
+	assert_same_objects("refs/heads/master", "refs/heads/br2");
+
+	git_buf_free(&cmd);
+}
+
+void test_pack_bitmap__fetch_sends_only_new_objects(void)
+{
+	git_remote *remote;
+	git_oid id;
+	git_object *blob;
+	const git_transfer_progress *stats;
+	git_clone_options opts = GIT_CLONE_OPTIONS_INIT;
+
+	write_bitmapped_pack();
+
+	opts.bare = 1;
+	cl_git_pass(git_clone(&_clone, git_repository_path(_repo), "./bitmap_clone", &opts));
+
+	commit_on_branch(&id, _repo, "fetched", "only this is new\n");
+
+	cl_git_pass(git_remote_load(&remote, _clone, "origin"));
+	cl_git_pass(git_remote_fetch(remote, NULL, NULL));
+
+	/* the commit, its tree and the new blob */
+	stats = git_remote_stats(remote);
+	cl_assert_equal_i(3, stats->total_objects);
+
+	cl_git_pass(git_revparse_single(&blob, _clone, "refs/remotes/origin/fetched:file.txt"));
+	cl_assert_equal_i(GIT_OBJ_BLOB, git_object_type(blob));
+
+	git_object_free(blob);
+	git_remote_free(remote);
+}
+
+/*
+ * Time enumerating every object of a large repository with and without
+ * its bitmaps:
+ *
+ *   GITTEST_BITMAP_BENCH=/path/to/repo.git ./libgit2_clar -spack::bitmap::bench
+ */
+void test_pack_bitmap__bench(void)
+{
+	const char *path = cl_getenv("GITTEST_BITMAP_BENCH");
+	git_repository *repo;
+	git_packbuilder *pb;
+	git_revwalk *walk;
+	double start;
+	int use;
+
+	if (!path)
+		cl_skip();
+
+	cl_git_pass(git_repository_open(&repo, path));
+
+	for (use = 0; use < 2; use++) {
+		cl_git_pass(git_packbuilder_new(&pb, repo));
+		cl_git_pass(git_revwalk_new(&walk, repo));
+		pb->use_bitmaps = !!use;
+
+		start = git__timer();
+		cl_git_pass(git_revwalk_push_glob(walk, "refs/heads/*"));
+		cl_git_pass(git_packbuilder_insert_walk(pb, walk));
+
+		fprintf(stderr, "\n%s bitmaps: %u objects in %.3fs",
+			use ? "with" : "without", git_packbuilder_object_count(pb),
+			git__timer() - start);
+
+		git_revwalk_free(walk);
+		git_packbuilder_free(pb);
+	}
+
+	git_repository_free(repo);
+}
@@ -0,0 +1,227 @@
+#include "clar_libgit2.h"
+#include "fileops.h"
+#include "posix.h"
+#include "git2/indexer.h"
+#include "repo/history.h"
+
+static git_repository *_source;
+static git_odb *_odb;
+static git_vector _blobs;
+
+#define DEFAULT_PACK_CACHE_SIZE (96 * 1024 * 1024)
+#define DEFAULT_PACK_CACHE_OBJECT_LIMIT (16 * 1024 * 1024)
+
+static void chain_content(git_buf *out, size_t v, size_t file, void *payload)
+{
+	size_t l, nlines = *(size_t *)payload;
+
+	GIT_UNUSED(file);
+	for (l = 0; l < nlines; l++)
+		git_buf_printf(out, "line %u rev %u\n",
+			(unsigned)l, (unsigned)(l <= v ? l : 0));
+}
+
+/*
+ * Write `nversions` revisions of a single file, each one a small edit
+ * of the previous, so the pack holds one long delta chain.
+ */
+static void build_chain(size_t nversions, size_t nlines)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+
+	opts.refname = "HEAD";
+	opts.content = chain_content;
+	opts.payload = &nlines;
+	opts.blobs = &_blobs;
+	cl_history_build(NULL, _source, NULL, nversions, &opts);
+}
+
+/* Pack the history and index it into a repository that has no loose objects */
+static void open_packed(void)
+{
+	git_packbuilder *pb;
+	git_indexer *idx;
+	git_repository *packed;
+	git_buf pack = GIT_BUF_INIT;
+	git_transfer_progress stats;
+	git_revwalk *walk;
+	git_oid id;
+
+	cl_git_pass(git_packbuilder_new(&pb, _source));
+	cl_git_pass(git_revwalk_new(&walk, _source));
+	cl_git_pass(git_revwalk_push_head(walk));
+	while (git_revwalk_next(&id, walk) == 0)
+		cl_git_pass(git_packbuilder_insert_commit(pb, &id));
+	cl_git_pass(git_packbuilder_write_buf(&pack, pb));
+	git_revwalk_free(walk);
+	git_packbuilder_free(pb);
+
+	cl_git_pass(git_repository_init(&packed, "packed.git", true));
+
+	memset(&stats, 0, sizeof(stats));
+	cl_git_pass(git_indexer_new(&idx, "packed.git/objects/pack", 0, NULL, NULL, NULL));
+	cl_git_pass(git_indexer_append(idx, pack.ptr, pack.size, &stats));
+	cl_git_pass(git_indexer_commit(idx, &stats));
+	cl_assert(stats.indexed_deltas > 0);
+	git_indexer_free(idx);
+
+	cl_git_pass(git_repository_odb(&_odb, packed));
+	git_repository_free(packed);
+	git_buf_free(&pack);
+}
+
+void test_pack_deltacache__initialize(void)
+{
+	cl_git_pass(git_repository_init(&_source, "chain.git", true));
+	cl_git_pass(git_vector_init(&_blobs, 0, NULL));
+	cl_git_pass(git_libgit2_opts(GIT_OPT_RESET_PACK_CACHE_STATS));
+}
+
+void test_pack_deltacache__cleanup(void)
+{
+	git_vector_free_deep(&_blobs);
+
+	git_odb_free(_odb);
+	_odb = NULL;
+	git_repository_free(_source);
+	_source = NULL;
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, (size_t)DEFAULT_PACK_CACHE_SIZE));
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_OBJECT_LIMIT, (size_t)DEFAULT_PACK_CACHE_OBJECT_LIMIT));
+
+	cl_fixture_cleanup("chain.git");
+	cl_fixture_cleanup("packed.git");
+}
+
+/* Read every revision from the pack and return the time it took */
+static double read_all(size_t *hits, size_t *misses)
+{
+	git_odb_object *obj;
+	git_oid *id;
+	size_t i, used, limit;
+	double start;
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_RESET_PACK_CACHE_STATS));
+
+	start = git__timer();
+	git_vector_foreach(&_blobs, i, id) {
+		cl_git_pass(git_odb_read(&obj, _odb, id));
+		cl_assert_equal_i(GIT_OBJ_BLOB, git_odb_object_type(obj));
+		git_odb_object_free(obj);
+	}
+	start = git__timer() - start;
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_GET_PACK_CACHE_STATS, &used, &limit, hits, misses));
+	cl_assert(used <= limit);
+
+	return start;
+}
+
+void test_pack_deltacache__options(void)
+{
+	size_t used, limit, hits, misses;
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_GET_PACK_CACHE_STATS, &used, &limit, &hits, &misses));
+	cl_assert_equal_i(DEFAULT_PACK_CACHE_SIZE, limit);
+	cl_assert_equal_i(0, hits);
+	cl_assert_equal_i(0, misses);
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, (size_t)1024));
+	cl_git_pass(git_libgit2_opts(GIT_OPT_GET_PACK_CACHE_STATS, &used, &limit, &hits, &misses));
+	cl_assert_equal_i(1024, limit);
+	cl_assert(used <= 1024);
+}
+
+void test_pack_deltacache__reuses_bases_along_a_chain(void)
+{
+	size_t hits, misses, first_misses;
+
+	build_chain(50, 200);
+	open_packed();
+
+	read_all(&hits, &first_misses);
+	cl_assert(hits > 0);
+	cl_assert(first_misses > 0);
+
+	/*
+	 * The bases are still in cache the second time around; only the
+	 * objects nothing is deltified against have to be looked up again.
+	 */
+	read_all(&hits, &misses);
+	cl_assert(hits > 0);
+	cl_assert(misses < first_misses);
+}
+
+void test_pack_deltacache__disabled(void)
+{
+	size_t hits, misses;
+
+	build_chain(20, 200);
+	open_packed();
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, (size_t)0));
+	read_all(&hits, &misses);
+	read_all(&hits, &misses);
+	cl_assert_equal_i(0, hits);
+	cl_assert(misses > 0);
+}
+
+void test_pack_deltacache__object_limit(void)
+{
+	size_t hits, misses;
+
+	build_chain(20, 200);
+	open_packed();
+
+	/* every revision is a few kilobytes, so none of them qualifies */
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_OBJECT_LIMIT, (size_t)64));
+	read_all(&hits, &misses);
+	read_all(&hits, &misses);
+	cl_assert_equal_i(0, hits);
+}
+
+void test_pack_deltacache__small_budget_evicts(void)
+{
+	size_t used, limit, hits, misses;
+
+	build_chain(50, 200);
+	open_packed();
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, (size_t)16 * 1024));
+	read_all(&hits, &misses);
+	read_all(&hits, &misses);
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_GET_PACK_CACHE_STATS, &used, &limit, &hits, &misses));
+	cl_assert(used > 0);
+	cl_assert(used <= 16 * 1024);
+}
+
+/*
+ * Opt-in benchmark: GITTEST_PACK_CACHE_BENCH=<chain length> reads a
+ * long delta chain through git_odb_read with and without the cache.
+ */
+void test_pack_deltacache__benchmark(void)
+{
+	const char *env = cl_getenv("GITTEST_PACK_CACHE_BENCH");
+	size_t nversions, hits, misses;
+	double uncached, cached;
+
+	if (!env)
+		cl_skip();
+
+	nversions = (size_t)strtoul(env, NULL, 10);
+	if (!nversions)
+		nversions = 500;
+
+	build_chain(nversions, 2000);
+	open_packed();
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, (size_t)0));
+	uncached = read_all(&hits, &misses);
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_PACK_CACHE_MAX_SIZE, (size_t)DEFAULT_PACK_CACHE_SIZE));
+	cached = read_all(&hits, &misses);
+
+	printf("\n%u revisions: uncached %.3fs, cached %.3fs (%u hits, %u misses)\n",
+		(unsigned)nversions, uncached, cached, (unsigned)hits, (unsigned)misses);
+}
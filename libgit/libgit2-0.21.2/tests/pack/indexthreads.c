@@ -0,0 +1,183 @@
+#include "clar_libgit2.h"
+#include "fileops.h"
+#include "pack.h"
+#include "posix.h"
+#include "git2/indexer.h"
+#include "repo/history.h"
+
+static git_repository *_repo;
+static git_vector _commits;
+
+void test_pack_indexthreads__initialize(void)
+{
+	cl_git_pass(git_repository_init(&_repo, "synthetic.git", true));
+	cl_git_pass(git_vector_init(&_commits, 0, NULL));
+}
+
+void test_pack_indexthreads__cleanup(void)
+{
+	git_vector_free_deep(&_commits);
+
+	git_repository_free(_repo);
+	_repo = NULL;
+
+	cl_fixture_cleanup("synthetic.git");
+	cl_fixture_cleanup("serial");
+	cl_fixture_cleanup("threaded");
+	cl_fixture_cleanup("synthetic_clone");
+}
+
+typedef struct {
+	size_t nversions, nlines;
+} history_shape;
+
+/*
+ * Every file is edited a little in every commit, so the pack ends up
+ * with long delta chains over many independent bases.
+ */
+static void edited_file(git_buf *out, size_t v, size_t f, void *payload)
+{
+	history_shape *shape = payload;
+	size_t l;
+
+	for (l = 0; l < shape->nlines; l++) {
+		size_t rev = (l % shape->nversions) <= v ? (l % shape->nversions) : 0;
+		git_buf_printf(out, "file %u line %u rev %u\n",
+			(unsigned)f, (unsigned)l, (unsigned)rev);
+	}
+}
+
+static void build_history(size_t nfiles, size_t nversions, size_t nlines)
+{
+	cl_history_options opts = CL_HISTORY_OPTIONS_INIT;
+	history_shape shape;
+
+	shape.nversions = nversions;
+	shape.nlines = nlines;
+
+	opts.refname = "HEAD";
+	opts.nfiles = nfiles;
+	opts.content = edited_file;
+	opts.payload = &shape;
+	opts.commits = &_commits;
+	cl_history_build(NULL, _repo, NULL, nversions, &opts);
+}
+
+static void build_pack(git_buf *pack)
+{
+	git_packbuilder *pb;
+	git_oid *id;
+	size_t i;
+
+	cl_git_pass(git_packbuilder_new(&pb, _repo));
+	git_vector_foreach(&_commits, i, id)
+		cl_git_pass(git_packbuilder_insert_commit(pb, id));
+	cl_git_pass(git_packbuilder_write_buf(pack, pb));
+	git_packbuilder_free(pb);
+}
+
+static double index_pack(
+	git_buf *idx_out, git_transfer_progress *stats,
+	const git_buf *pack, const char *dir, unsigned int threads)
+{
+	git_indexer *idx;
+	git_buf path = GIT_BUF_INIT;
+	char hash[GIT_OID_HEXSZ + 1] = {0};
+	double start;
+
+	memset(stats, 0, sizeof(*stats));
+	cl_git_pass(p_mkdir(dir, 0777));
+
+	start = git__timer();
+	cl_git_pass(git_indexer_new(&idx, dir, 0, NULL, NULL, NULL));
+	git_indexer_set_threads(idx, threads);
+	cl_git_pass(git_indexer_append(idx, pack->ptr, pack->size, stats));
+	cl_git_pass(git_indexer_commit(idx, stats));
+	start = git__timer() - start;
+
+	git_oid_fmt(hash, git_indexer_hash(idx));
+	cl_git_pass(git_buf_printf(&path, "%s/pack-%s.idx", dir, hash));
+	cl_git_pass(git_futils_readbuffer(idx_out, path.ptr));
+
+	git_indexer_free(idx);
+	git_buf_free(&path);
+	return start;
+}
+
+static void assert_same_index(size_t nfiles, size_t nversions, size_t nlines)
+{
+	git_buf pack = GIT_BUF_INIT, serial = GIT_BUF_INIT, threaded = GIT_BUF_INIT;
+	git_transfer_progress serial_stats, threaded_stats;
+
+	build_history(nfiles, nversions, nlines);
+	build_pack(&pack);
+
+	index_pack(&serial, &serial_stats, &pack, "serial", 1);
+	index_pack(&threaded, &threaded_stats, &pack, "threaded", 4);
+
+	cl_assert(serial_stats.indexed_deltas > 64);
+	cl_assert_equal_i(serial_stats.total_objects, threaded_stats.total_objects);
+	cl_assert_equal_i(serial_stats.indexed_objects, threaded_stats.indexed_objects);
+	cl_assert_equal_i(serial_stats.indexed_deltas, threaded_stats.indexed_deltas);
+	cl_assert_equal_i(threaded_stats.total_objects, threaded_stats.indexed_objects);
+
+	cl_assert_equal_i(serial.size, threaded.size);
+	cl_assert(memcmp(serial.ptr, threaded.ptr, serial.size) == 0);
+
+	git_buf_free(&pack);
+	git_buf_free(&serial);
+	git_buf_free(&threaded);
+}
+
+void test_pack_indexthreads__matches_serial_index(void)
+{
+	assert_same_index(24, 8, 64);
+}
+
+void test_pack_indexthreads__matches_serial_index_with_deep_chains(void)
+{
+	assert_same_index(4, 40, 128);
+}
+
+/*
+ * Opt-in benchmark: GITTEST_INDEXER_BENCH=<number of files> indexes a
+ * synthetic pack serially and threaded, then clones the repository
+ * over file:// so the transport's own indexer is timed as well.
+ */
+void test_pack_indexthreads__benchmark(void)
+{
+	git_buf pack = GIT_BUF_INIT, serial = GIT_BUF_INIT, threaded = GIT_BUF_INIT;
+	git_transfer_progress stats;
+	git_repository *clone;
+	const char *env = cl_getenv("GITTEST_INDEXER_BENCH");
+	size_t nfiles;
+	double serial_time, threaded_time, clone_time;
+
+	if (!env)
+		cl_skip();
+
+	nfiles = (size_t)strtoul(env, NULL, 10);
+	if (!nfiles)
+		nfiles = 500;
+
+	build_history(nfiles, 20, 400);
+	build_pack(&pack);
+
+	serial_time = index_pack(&serial, &stats, &pack, "serial", 1);
+	threaded_time = index_pack(&threaded, &stats, &pack, "threaded", 0);
+	cl_assert_equal_i(serial.size, threaded.size);
+	cl_assert(memcmp(serial.ptr, threaded.ptr, serial.size) == 0);
+
+	clone_time = git__timer();
+	cl_git_pass(git_clone(&clone, cl_git_path_url("synthetic.git"), "synthetic_clone", NULL));
+	clone_time = git__timer() - clone_time;
+	git_repository_free(clone);
+
+	printf("\n%u objects (%u deltas), %u bytes: serial %.3fs, threaded %.3fs, file:// clone %.3fs\n",
+		stats.total_objects, stats.indexed_deltas, (unsigned)pack.size,
+		serial_time, threaded_time, clone_time);
+
+	git_buf_free(&pack);
+	git_buf_free(&serial);
+	git_buf_free(&threaded);
+}
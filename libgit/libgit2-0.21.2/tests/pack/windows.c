@@ -0,0 +1,245 @@
+#include "clar_libgit2.h"
+#include "fileops.h"
+#include "mwindow.h"
+#include "git2/indexer.h"
+
+static git_repository *_source;
+static git_odb *_odb;
+static git_vector _blobs;
+static size_t _window_size, _mapped_limit;
+
+void test_pack_windows__initialize(void)
+{
+	cl_git_pass(git_repository_init(&_source, "windows.git", true));
+	cl_git_pass(git_vector_init(&_blobs, 0, NULL));
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_GET_MWINDOW_SIZE, &_window_size));
+	cl_git_pass(git_libgit2_opts(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT, &_mapped_limit));
+}
+
+void test_pack_windows__cleanup(void)
+{
+	git_vector_free_deep(&_blobs);
+
+	git_odb_free(_odb);
+	_odb = NULL;
+	git_repository_free(_source);
+	_source = NULL;
+
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_SIZE, _window_size));
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, _mapped_limit));
+
+	cl_fixture_cleanup("windows.git");
+	cl_fixture_cleanup("windows_packed.git");
+}
+
+/* Write `nblobs` unrelated blobs of about `size` bytes each */
+static void build_blobs(size_t nblobs, size_t size)
+{
+	git_buf content = GIT_BUF_INIT;
+	git_oid *id;
+	size_t b;
+	uint32_t seed;
+
+	for (b = 0; b < nblobs; b++) {
+		git_buf_clear(&content);
+
+		/* poorly compressible so the pack is about as big as the data */
+		for (seed = (uint32_t)b * 2654435761u; content.size < size; ) {
+			seed = seed * 1103515245 + 12345;
+			git_buf_printf(&content, "%08x", seed);
+		}
+		cl_assert(!git_buf_oom(&content));
+
+		id = git__malloc(sizeof(git_oid));
+		cl_assert(id);
+		cl_git_pass(git_blob_create_frombuffer(id, _source, content.ptr, content.size));
+		cl_git_pass(git_vector_insert(&_blobs, id));
+	}
+
+	git_buf_free(&content);
+}
+
+/* Open the packed repository again, so no window is mapped yet */
+static void reopen_packed(void)
+{
+	git_repository *packed;
+
+	git_odb_free(_odb);
+	cl_git_pass(git_repository_open(&packed, "windows_packed.git"));
+	cl_git_pass(git_repository_odb(&_odb, packed));
+	git_repository_free(packed);
+}
+
+/* Pack the blobs into a repository that has no loose objects */
+static size_t open_packed(void)
+{
+	git_packbuilder *pb;
+	git_indexer *idx;
+	git_repository *packed;
+	git_buf pack = GIT_BUF_INIT;
+	git_transfer_progress stats;
+	git_oid *id;
+	size_t i, size;
+
+	cl_git_pass(git_packbuilder_new(&pb, _source));
+	git_vector_foreach(&_blobs, i, id)
+		cl_git_pass(git_packbuilder_insert(pb, id, NULL));
+	cl_git_pass(git_packbuilder_write_buf(&pack, pb));
+	git_packbuilder_free(pb);
+
+	cl_git_pass(git_repository_init(&packed, "windows_packed.git", true));
+
+	memset(&stats, 0, sizeof(stats));
+	cl_git_pass(git_indexer_new(&idx, "windows_packed.git/objects/pack", 0, NULL, NULL, NULL));
+	cl_git_pass(git_indexer_append(idx, pack.ptr, pack.size, &stats));
+	cl_git_pass(git_indexer_commit(idx, &stats));
+	git_indexer_free(idx);
+
+	git_repository_free(packed);
+	reopen_packed();
+
+	size = pack.size;
+	git_buf_free(&pack);
+	return size;
+}
+
+/* Read (and check) every blob `rounds` times, starting at a different one per reader */
+static void *read_blobs(void *arg)
+{
+	int reader = *(int *)arg;
+	git_odb_object *obj;
+	git_oid check;
+	const git_oid *id;
+	size_t i, round, rounds = 4;
+
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < _blobs.length; i++) {
+			id = git_vector_get(&_blobs,
+				(i * 7 + (size_t)reader * 13 + round) % _blobs.length);
+
+			cl_git_pass(git_odb_read(&obj, _odb, id));
+			cl_git_pass(git_odb_hash(&check, git_odb_object_data(obj),
+				git_odb_object_size(obj), GIT_OBJ_BLOB));
+			cl_assert(git_oid_equal(id, &check));
+			git_odb_object_free(obj);
+		}
+	}
+
+	return arg;
+}
+
+static double run_readers(int nthreads)
+{
+	int t, *id = git__calloc(nthreads, sizeof(int));
+#ifdef GIT_THREADS
+	git_thread *th = git__calloc(nthreads, sizeof(git_thread));
+#endif
+	double start;
+
+	cl_assert(id != NULL);
+#ifdef GIT_THREADS
+	cl_assert(th != NULL);
+#endif
+
+	start = git__timer();
+
+	for (t = 0; t < nthreads; ++t) {
+		id[t] = t;
+#ifdef GIT_THREADS
+		cl_git_pass(git_thread_create(&th[t], NULL, read_blobs, &id[t]));
+#else
+		cl_assert(read_blobs(&id[t]) == &id[t]);
+#endif
+	}
+
+#ifdef GIT_THREADS
+	for (t = 0; t < nthreads; ++t)
+		cl_git_pass(git_thread_join(&th[t], NULL));
+	git__free(th);
+#endif
+
+	git__free(id);
+	return git__timer() - start;
+}
+
+void test_pack_windows__maps_whole_pack(void)
+{
+	unsigned int mmap_calls;
+
+	if (sizeof(void *) < 8)
+		cl_skip();
+
+	build_blobs(64, 4096);
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_SIZE, (size_t)8192));
+	open_packed();
+
+	mmap_calls = git_mwindow__mem_ctl.mmap_calls;
+	run_readers(1);
+
+	/* the window size is ignored, the pack is under the mapped limit */
+	cl_assert_equal_i(mmap_calls + 1, git_mwindow__mem_ctl.mmap_calls);
+}
+
+void test_pack_windows__parallel_readers_with_small_windows(void)
+{
+	size_t size;
+
+	build_blobs(64, 4096);
+
+	/* the pack does not fit, so windows come and go under the readers */
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_SIZE, (size_t)8192));
+	cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, (size_t)32768));
+	size = open_packed();
+	cl_assert(size > 32768);
+
+	run_readers(8);
+
+	cl_assert(git_mwindow__mem_ctl.open_windows > 0);
+}
+
+void test_pack_windows__parallel_readers_with_whole_pack(void)
+{
+	build_blobs(64, 4096);
+	open_packed();
+
+	run_readers(8);
+}
+
+/*
+ * Opt-in benchmark: GITTEST_MWINDOW_BENCH=<threads> reads every blob of
+ * a pack from 1 up to that many threads, with the pack mapped in small
+ * windows and then whole.
+ */
+void test_pack_windows__benchmark(void)
+{
+	const char *env = cl_getenv("GITTEST_MWINDOW_BENCH");
+	int nthreads, t;
+	double windowed, whole;
+
+	if (!env)
+		cl_skip();
+
+	nthreads = atoi(env);
+	if (nthreads <= 0)
+		nthreads = 8;
+
+	build_blobs(2000, 16384);
+	open_packed();
+
+	printf("\n%u blobs, 4 rounds per thread:\n", (unsigned)_blobs.length);
+
+	for (t = 1; t <= nthreads; t *= 2) {
+		cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, (size_t)4 * 1024 * 1024));
+		cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_SIZE, (size_t)1024 * 1024));
+		reopen_packed();
+		windowed = run_readers(t);
+
+		cl_git_pass(git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, _mapped_limit));
+		reopen_packed();
+		whole = run_readers(t);
+
+		printf("%3d threads: 1MB windows %.3fs, whole pack %.3fs\n",
+			t, windowed, whole);
+	}
+}
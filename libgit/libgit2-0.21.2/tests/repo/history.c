@@ -0,0 +1,111 @@
+#include "clar_libgit2.h"
+#include "posix.h"
+#include "refs.h"
+#include "history.h"
+
+static void default_content(git_buf *out, size_t commit, size_t file, void *payload)
+{
+	GIT_UNUSED(payload);
+	git_buf_printf(out, "commit %u file %u\n", (unsigned)commit, (unsigned)file);
+}
+
+static void push_id(git_vector *ids, const git_oid *id)
+{
+	git_oid *copy;
+
+	if (!ids)
+		return;
+
+	copy = git__malloc(sizeof(git_oid));
+	cl_assert(copy);
+	git_oid_cpy(copy, id);
+	cl_git_pass(git_vector_insert(ids, copy));
+}
+
+static void write_tree(
+	git_oid *out,
+	git_repository *repo,
+	size_t commit,
+	const cl_history_options *opts)
+{
+	cl_history_content_cb content_cb = opts->content ? opts->content : default_content;
+	git_buf content = GIT_BUF_INIT;
+	git_treebuilder *builder;
+	git_oid blob_id;
+	size_t f;
+	char name[32];
+
+	cl_git_pass(git_treebuilder_create(&builder, NULL));
+
+	for (f = 0; f < opts->nfiles; f++) {
+		git_buf_clear(&content);
+		content_cb(&content, commit, f, opts->payload);
+		cl_assert(!git_buf_oom(&content));
+
+		cl_git_pass(git_blob_create_frombuffer(&blob_id, repo, content.ptr, content.size));
+		push_id(opts->blobs, &blob_id);
+
+		p_snprintf(name, sizeof(name), "file%04u.txt", (unsigned)f);
+		cl_git_pass(git_treebuilder_insert(NULL, builder,
+			opts->nfiles == 1 ? "file.txt" : name, &blob_id, GIT_FILEMODE_BLOB));
+	}
+
+	cl_git_pass(git_treebuilder_write(out, repo, builder));
+	git_treebuilder_free(builder);
+	git_buf_free(&content);
+}
+
+void cl_history_build(
+	git_oid *tip,
+	git_repository *repo,
+	const git_oid *parent,
+	size_t n,
+	const cl_history_options *opts)
+{
+	const git_commit *parents[8];
+	size_t nparents = 0, i;
+	git_signature *sig = NULL;
+	git_oid tree_id, id;
+	git_tree *tree;
+
+	cl_assert(n > 0);
+	cl_assert(opts->nmerge < ARRAY_SIZE(parents));
+	cl_assert(parent || !opts->nmerge);
+
+	if (parent)
+		cl_git_pass(git_commit_lookup((git_commit **)&parents[nparents++], repo, parent));
+	for (i = 0; i < opts->nmerge; i++)
+		cl_git_pass(git_commit_lookup((git_commit **)&parents[nparents++], repo, opts->merge[i]));
+
+	for (i = 0; i < n; i++) {
+		if (opts->tree)
+			git_oid_cpy(&tree_id, opts->tree);
+		else
+			write_tree(&tree_id, repo, i, opts);
+		cl_git_pass(git_tree_lookup(&tree, repo, &tree_id));
+
+		git_signature_free(sig);
+		cl_git_pass(git_signature_new(&sig, "History", "history@example.com",
+			opts->time + (git_time_t)i * opts->time_step, 0));
+
+		cl_git_pass(git_commit_create(&id, repo, NULL, sig, sig, NULL,
+			opts->message ? opts->message : "synthetic\n",
+			tree, (int)nparents, parents));
+		push_id(opts->commits, &id);
+		git_tree_free(tree);
+
+		while (nparents > 0)
+			git_commit_free((git_commit *)parents[--nparents]);
+		cl_git_pass(git_commit_lookup((git_commit **)&parents[nparents++], repo, &id));
+	}
+
+	while (nparents > 0)
+		git_commit_free((git_commit *)parents[--nparents]);
+
+	if (opts->refname)
+		cl_git_pass(git_reference__update_terminal(repo, opts->refname, &id, sig, NULL));
+	git_signature_free(sig);
+
+	if (tip)
+		git_oid_cpy(tip, &id);
+}
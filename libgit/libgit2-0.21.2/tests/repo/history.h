@@ -0,0 +1,59 @@
+#ifndef INCLUDE_cl_history_h__
+#define INCLUDE_cl_history_h__
+
+#include "buffer.h"
+#include "vector.h"
+
+/*
+ * Synthetic histories for the tests that need more commits than a
+ * fixture can reasonably hold.
+ */
+
+/* Fill `out` with the content of file `file` in the `commit`th commit */
+typedef void (*cl_history_content_cb)(
+	git_buf *out, size_t commit, size_t file, void *payload);
+
+typedef struct {
+	/* moved to the last commit, through symbolic refs; NULL leaves refs alone */
+	const char *refname;
+	/* "synthetic\n" when NULL */
+	const char *message;
+
+	/* committer time of the first commit, and the step between two */
+	git_time_t time;
+	int time_step;
+
+	/*
+	 * Every commit gets a tree of `nfiles` files, "file.txt" when there
+	 * is only one and "file0000.txt" onwards otherwise, whose content
+	 * comes from `content` (or names the commit and the file). `tree`
+	 * is used as is instead when it is set.
+	 */
+	size_t nfiles;
+	cl_history_content_cb content;
+	void *payload;
+	const git_oid *tree;
+
+	/* further parents of the first commit */
+	const git_oid **merge;
+	size_t nmerge;
+
+	/* the commits and blobs written are appended as git__malloc'd ids */
+	git_vector *commits;
+	git_vector *blobs;
+} cl_history_options;
+
+#define CL_HISTORY_OPTIONS_INIT { NULL, NULL, 1400000000, 60, 1 }
+
+/*
+ * Write a line of `n` commits on top of `parent` (or starting a new
+ * history when it is NULL) and return the last in `tip`.
+ */
+void cl_history_build(
+	git_oid *tip,
+	git_repository *repo,
+	const git_oid *parent,
+	size_t n,
+	const cl_history_options *opts);
+
+#endif
@@ -0,0 +1,264 @@
+#include "clar_libgit2.h"
+#include "git2/sys/diff.h"
+#include "fileops.h"
+#include "fsmonitor.h"
+
+static git_repository *g_repo;
+static git_fsmonitor *g_mon;
+
+static const char *g_files[] = {
+	"README.md",
+	"src/main.c",
+	"src/util.c",
+	"src/util/str.c",
+	"docs/guide.md",
+	NULL
+};
+
+void test_status_fsmonitor__initialize(void)
+{
+	git_index *index;
+	git_buf path = GIT_BUF_INIT;
+	const char **file;
+
+	cl_git_pass(git_repository_init(&g_repo, "monitored", false));
+	cl_git_pass(git_repository_index(&index, g_repo));
+
+	for (file = g_files; *file; file++) {
+		git_buf_clear(&path);
+		cl_git_pass(git_buf_joinpath(&path, "monitored", *file));
+		cl_git_pass(git_futils_mkpath2file(path.ptr, 0777));
+		cl_git_mkfile(path.ptr, *file);
+		cl_git_pass(git_index_add_bypath(index, *file));
+	}
+
+	cl_git_pass(git_index_write(index));
+	cl_repo_commit_from_index(NULL, g_repo, NULL, 0, "files");
+
+	git_index_free(index);
+	git_buf_free(&path);
+
+	/* only available where the platform has a change notification API */
+	if (git_fsmonitor_new(&g_mon, g_repo) < 0)
+		giterr_clear();
+}
+
+void test_status_fsmonitor__cleanup(void)
+{
+	git_fsmonitor_free(g_mon);
+	g_mon = NULL;
+
+	git_repository_free(g_repo);
+	g_repo = NULL;
+	cl_fixture_cleanup("monitored");
+}
+
+static void require_monitor(void)
+{
+	if (!g_mon)
+		cl_skip();
+
+	cl_git_pass(git_repository_set_fsmonitor(g_repo, g_mon));
+}
+
+/* status as "path:flags;" for each entry, and the lstat count */
+static size_t status_of(git_buf *out)
+{
+	git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+	git_status_list *status;
+	git_diff_perfdata perf = GIT_DIFF_PERFDATA_INIT;
+	const git_status_entry *entry;
+	size_t i;
+
+	opts.flags = GIT_STATUS_OPT_DEFAULTS |
+		GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS;
+
+	git_buf_clear(out);
+	cl_git_pass(git_status_list_new(&status, g_repo, &opts));
+
+	for (i = 0; i < git_status_list_entrycount(status); ++i) {
+		entry = git_status_byindex(status, i);
+		git_buf_printf(out, "%s:%x;",
+			entry->head_to_index ? entry->head_to_index->new_file.path :
+			entry->index_to_workdir->new_file.path, entry->status);
+	}
+
+	cl_git_pass(git_status_list_get_perfdata(&perf, status));
+	git_status_list_free(status);
+
+	return perf.stat_calls;
+}
+
+/* compare a status served by the monitor to a full scan */
+static size_t check_status(const char *expected)
+{
+	git_buf monitored = GIT_BUF_INIT, scanned = GIT_BUF_INIT;
+	size_t stat_calls;
+
+	stat_calls = status_of(&monitored);
+
+	cl_git_pass(git_repository_set_fsmonitor(g_repo, NULL));
+	status_of(&scanned);
+	cl_git_pass(git_repository_set_fsmonitor(g_repo, g_mon));
+
+	cl_assert_equal_s(scanned.ptr, monitored.ptr);
+	cl_assert_equal_s(expected, monitored.ptr);
+
+	git_buf_free(&monitored);
+	git_buf_free(&scanned);
+
+	return stat_calls;
+}
+
+void test_status_fsmonitor__reuses_listings(void)
+{
+	git_buf status = GIT_BUF_INIT;
+	size_t full, cached;
+
+	require_monitor();
+
+	full = status_of(&status);
+	cl_assert_equal_s("", status.ptr);
+	cl_assert(full > 0);
+
+	cached = status_of(&status);
+	cl_assert_equal_s("", status.ptr);
+	cl_assert_equal_sz(0, cached);
+
+	git_buf_free(&status);
+}
+
+void test_status_fsmonitor__sees_modifications(void)
+{
+	git_buf status = GIT_BUF_INIT;
+	size_t full;
+
+	require_monitor();
+	full = status_of(&status);
+
+	cl_git_rewritefile("monitored/src/util/str.c", "changed");
+	cl_assert(check_status("src/util/str.c:100;") < full);
+
+	cl_git_rewritefile("monitored/src/util/str.c", "src/util/str.c");
+	check_status("");
+
+	git_buf_free(&status);
+}
+
+void test_status_fsmonitor__sees_new_and_removed_files(void)
+{
+	git_buf status = GIT_BUF_INIT;
+
+	require_monitor();
+	status_of(&status);
+
+	cl_git_mkfile("monitored/src/new.c", "new");
+	cl_must_pass(p_unlink("monitored/docs/guide.md"));
+	check_status("docs/guide.md:200;src/new.c:80;");
+
+	cl_must_pass(p_rename("monitored/src/new.c", "monitored/src/util/new.c"));
+	check_status("docs/guide.md:200;src/util/new.c:80;");
+
+	git_buf_free(&status);
+}
+
+void test_status_fsmonitor__caches_untracked_dirs(void)
+{
+	git_buf status = GIT_BUF_INIT;
+	size_t cached;
+
+	require_monitor();
+
+	cl_git_pass(git_futils_mkdir("monitored/build/obj", NULL, 0777, GIT_MKDIR_PATH));
+	cl_git_mkfile("monitored/build/obj/main.o", "obj");
+	cl_git_mkfile("monitored/build/obj/util.o", "obj");
+
+	check_status("build/obj/main.o:80;build/obj/util.o:80;");
+	cached = status_of(&status);
+	cl_assert_equal_sz(0, cached);
+
+	/* a directory moved in with its contents */
+	cl_must_pass(p_rename("monitored/build", "monitored/out"));
+	check_status("out/obj/main.o:80;out/obj/util.o:80;");
+
+	cl_must_pass(p_unlink("monitored/out/obj/util.o"));
+	check_status("out/obj/main.o:80;");
+
+	git_buf_free(&status);
+}
+
+void test_status_fsmonitor__changes_since_token(void)
+{
+	git_strarray changes;
+	uint64_t token, next;
+
+	if (!g_mon)
+		cl_skip();
+
+	cl_git_pass(git_fsmonitor_changes(&changes, &token, g_mon, 0));
+	cl_assert_equal_sz(0, changes.count);
+	git_strarray_free(&changes);
+
+	cl_git_rewritefile("monitored/README.md", "changed");
+	cl_git_rewritefile("monitored/src/util/str.c", "changed");
+	cl_git_pass(git_futils_mkdir("monitored/tmp", NULL, 0777, 0));
+
+	cl_git_pass(git_fsmonitor_changes(&changes, &next, g_mon, token));
+	cl_assert(next > token);
+	cl_assert_equal_sz(3, changes.count);
+	cl_assert_equal_s("README.md", changes.strings[0]);
+	cl_assert_equal_s("src/util/str.c", changes.strings[1]);
+	cl_assert_equal_s("tmp/", changes.strings[2]);
+	git_strarray_free(&changes);
+
+	cl_git_mkfile("monitored/tmp/file", "new");
+
+	cl_git_pass(git_fsmonitor_changes(&changes, &token, g_mon, next));
+	cl_assert_equal_sz(1, changes.count);
+	cl_assert_equal_s("tmp/file", changes.strings[0]);
+	git_strarray_free(&changes);
+
+	/* nothing changed since the last token */
+	cl_git_pass(git_fsmonitor_changes(&changes, &next, g_mon, token));
+	cl_assert_equal_sz(0, changes.count);
+	cl_assert(next == token);
+	git_strarray_free(&changes);
+}
+
+void test_status_fsmonitor__forgotten_changes(void)
+{
+	git_strarray changes;
+	uint64_t token;
+
+	if (!g_mon)
+		cl_skip();
+
+	cl_git_pass(git_fsmonitor_changes(&changes, &token, g_mon, 0));
+	git_strarray_free(&changes);
+
+	/* as if the log had been trimmed past the token */
+	g_mon->log_start = token + 1;
+	cl_assert_equal_i(GIT_ENOTFOUND,
+		git_fsmonitor_changes(&changes, &token, g_mon, token));
+	cl_assert_equal_sz(0, changes.count);
+}
+
+void test_status_fsmonitor__other_workdir(void)
+{
+	git_repository *other;
+	git_fsmonitor *mon;
+
+	cl_git_pass(git_repository_init(&other, "other", false));
+
+	if (git_fsmonitor_new(&mon, other) < 0) {
+		git_repository_free(other);
+		cl_fixture_cleanup("other");
+		cl_skip();
+	}
+
+	cl_git_fail(git_repository_set_fsmonitor(g_repo, mon));
+
+	git_fsmonitor_free(mon);
+	git_repository_free(other);
+	cl_fixture_cleanup("other");
+}
@@ -65,6 +65,11 @@ void test_structinit_structinit__compare(void)
 		git_diff_find_options, GIT_DIFF_FIND_OPTIONS_VERSION, \
 		GIT_DIFF_FIND_OPTIONS_INIT, git_diff_find_init_options);
 
+	/* lfs */
+	CHECK_MACRO_FUNC_INIT_EQUAL( \
+		git_lfs_fetch_options, GIT_LFS_FETCH_OPTIONS_VERSION, \
+		GIT_LFS_FETCH_OPTIONS_INIT, git_lfs_init_fetch_options);
+
 	/* merge_file_input */
 	CHECK_MACRO_FUNC_INIT_EQUAL( \
 		git_merge_file_input, GIT_MERGE_FILE_INPUT_VERSION, \
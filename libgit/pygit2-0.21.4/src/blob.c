@@ -149,7 +149,8 @@ Blob_is_binary__get__(Blob *self)
 
 PyDoc_STRVAR(Blob_data__doc__,
   "The contents of the blob, a bytes string. This is the same as\n"
-  "Blob.read_raw()");
+  "Blob.read_raw() and makes a copy; use `memoryview(blob)` to access\n"
+  "the data in place, or Repository.open_blob() to stream it.");
 
 PyGetSetDef Blob_getseters[] = {
     GETTER(Blob, size),
@@ -257,3 +258,250 @@ PyTypeObject BlobType = {
     0,                                         /* tp_alloc          */
     0,                                         /* tp_new            */
 };
+
+
+/*
+ * BlobReader
+ */
+
+void
+BlobReader_dealloc(BlobReader *self)
+{
+    if (self->stream)
+        git_odb_stream_free(self->stream);
+    git_odb_free(self->odb);
+    Py_CLEAR(self->repo);
+    PyObject_Del(self);
+}
+
+/* Fill `buffer` from the stream, with the GIL released */
+static Py_ssize_t
+BlobReader_fill(BlobReader *self, char *buffer, size_t len)
+{
+    size_t total = 0;
+    int read = 0;
+
+    if (self->stream == NULL) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed reader");
+        return -1;
+    }
+
+    /* the stream must not be advanced by two threads at once */
+    if (self->reading) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent read on a BlobReader");
+        return -1;
+    }
+
+    if (len > self->size - self->offset)
+        len = self->size - self->offset;
+
+    self->reading = 1;
+    Py_BEGIN_ALLOW_THREADS;
+    while (total < len) {
+        read = git_odb_stream_read(self->stream, buffer + total, len - total);
+        if (read <= 0)
+            break;
+        total += read;
+    }
+    Py_END_ALLOW_THREADS;
+    self->reading = 0;
+
+    if (read < 0) {
+        Error_set(read);
+        return -1;
+    }
+
+    self->offset += total;
+    return (Py_ssize_t)total;
+}
+
+
+PyDoc_STRVAR(BlobReader_read__doc__,
+  "read([size]) -> bytes\n"
+  "\n"
+  "Read at most size bytes of the blob, or the rest of it when size is\n"
+  "negative or omitted. Returns an empty string at the end of the blob.");
+
+PyObject *
+BlobReader_read(BlobReader *self, PyObject *args)
+{
+    Py_ssize_t size = -1, read;
+    PyObject *py_data;
+
+    if (!PyArg_ParseTuple(args, "|n", &size))
+        return NULL;
+
+    if (self->stream == NULL) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed reader");
+        return NULL;
+    }
+
+    if (size < 0 || (size_t)size > self->size - self->offset)
+        size = (Py_ssize_t)(self->size - self->offset);
+
+    py_data = PyBytes_FromStringAndSize(NULL, size);
+    if (py_data == NULL)
+        return NULL;
+
+    read = BlobReader_fill(self, PyBytes_AS_STRING(py_data), (size_t)size);
+    if (read < 0) {
+        Py_DECREF(py_data);
+        return NULL;
+    }
+
+    if (read < size && _PyBytes_Resize(&py_data, read) < 0)
+        return NULL;
+
+    return py_data;
+}
+
+
+PyDoc_STRVAR(BlobReader_readinto__doc__,
+  "readinto(buffer) -> int\n"
+  "\n"
+  "Read the next bytes of the blob into a writable buffer, such as a\n"
+  "bytearray or a memoryview, and return how many were read (0 at the\n"
+  "end of the blob).");
+
+PyObject *
+BlobReader_readinto(BlobReader *self, PyObject *py_buffer)
+{
+    Py_buffer view;
+    Py_ssize_t read;
+
+    if (PyObject_GetBuffer(py_buffer, &view, PyBUF_WRITABLE) < 0)
+        return NULL;
+
+    read = BlobReader_fill(self, view.buf, (size_t)view.len);
+    PyBuffer_Release(&view);
+
+    if (read < 0)
+        return NULL;
+
+    return PyLong_FromSsize_t(read);
+}
+
+
+PyDoc_STRVAR(BlobReader_close__doc__,
+  "close()\n"
+  "\n"
+  "Release the stream. Further reads raise a ValueError.");
+
+PyObject *
+BlobReader_close(BlobReader *self)
+{
+    if (self->reading) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent read on a BlobReader");
+        return NULL;
+    }
+
+    if (self->stream) {
+        git_odb_stream_free(self->stream);
+        self->stream = NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+PyDoc_STRVAR(BlobReader___enter____doc__, "__enter__() -> BlobReader");
+
+PyObject *
+BlobReader___enter__(BlobReader *self)
+{
+    Py_INCREF(self);
+    return (PyObject*)self;
+}
+
+
+PyDoc_STRVAR(BlobReader___exit____doc__, "__exit__(*exc_info)\n"
+  "\n"
+  "Close the reader.");
+
+PyObject *
+BlobReader___exit__(BlobReader *self, PyObject *args)
+{
+    return BlobReader_close(self);
+}
+
+
+PyDoc_STRVAR(BlobReader_size__doc__, "Size of the blob, in bytes.");
+
+PyObject *
+BlobReader_size__get__(BlobReader *self)
+{
+    return PyLong_FromSize_t(self->size);
+}
+
+
+PyDoc_STRVAR(BlobReader_closed__doc__, "True once the reader is closed.");
+
+PyObject *
+BlobReader_closed__get__(BlobReader *self)
+{
+    if (self->stream == NULL)
+        Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+PyMethodDef BlobReader_methods[] = {
+    METHOD(BlobReader, read, METH_VARARGS),
+    METHOD(BlobReader, readinto, METH_O),
+    METHOD(BlobReader, close, METH_NOARGS),
+    METHOD(BlobReader, __enter__, METH_NOARGS),
+    METHOD(BlobReader, __exit__, METH_VARARGS),
+    {NULL}
+};
+
+PyGetSetDef BlobReader_getseters[] = {
+    GETTER(BlobReader, size),
+    GETTER(BlobReader, closed),
+    {NULL}
+};
+
+
+PyDoc_STRVAR(BlobReader__doc__, "Streaming reader over the data of a blob.\n"
+  "\n"
+  "Returned by Repository.open_blob(). The blob is inflated a chunk at a\n"
+  "time, so large blobs can be copied out without holding them in memory.");
+
+PyTypeObject BlobReaderType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.BlobReader",                      /* tp_name           */
+    sizeof(BlobReader),                        /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)BlobReader_dealloc,            /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    BlobReader__doc__,                         /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    0,                                         /* tp_iter           */
+    0,                                         /* tp_iternext       */
+    BlobReader_methods,                        /* tp_methods        */
+    0,                                         /* tp_members        */
+    BlobReader_getseters,                      /* tp_getset         */
+    0,                                         /* tp_base           */
+    0,                                         /* tp_dict           */
+    0,                                         /* tp_descr_get      */
+    0,                                         /* tp_descr_set      */
+    0,                                         /* tp_dictoffset     */
+    0,                                         /* tp_init           */
+    0,                                         /* tp_alloc          */
+    0,                                         /* tp_new            */
+};
@@ -35,4 +35,9 @@
 
 PyObject* Blob_get_size(Blob *self);
 
+void BlobReader_dealloc(BlobReader *self);
+PyObject* BlobReader_read(BlobReader *self, PyObject *args);
+PyObject* BlobReader_readinto(BlobReader *self, PyObject *py_buffer);
+PyObject* BlobReader_close(BlobReader *self);
+
 #endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <git2/odb_backend.h>
+#include "error.h"
+#include "utils.h"
+#include "oid.h"
+#include "bulkimport.h"
+
+void
+BulkImport_dealloc(BulkImport *self)
+{
+    /* the backend belongs to the odb; an uncommitted pack is dropped */
+    if (!self->finished)
+        git_odb_bulk_discard(self->backend);
+    git_odb_free(self->odb);
+    Py_CLEAR(self->repo);
+    PyObject_Del(self);
+}
+
+
+PyDoc_STRVAR(BulkImport_commit__doc__,
+  "commit() -> Oid\n"
+  "\n"
+  "Index the pack holding the objects written since the import began and\n"
+  "move it into the repository. Returns the name of the pack, or None if\n"
+  "no object was written. Objects written afterwards are loose again.");
+
+PyObject *
+BulkImport_commit(BulkImport *self)
+{
+    git_oid name;
+    int err;
+
+    if (self->finished) {
+        PyErr_SetString(PyExc_ValueError,
+                        "bulk import was already committed or discarded");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS;
+    err = git_odb_bulk_commit(&name, self->backend);
+    Py_END_ALLOW_THREADS;
+    self->finished = 1;
+
+    if (err < 0)
+        return Error_set(err);
+
+    if (git_oid_iszero(&name))
+        Py_RETURN_NONE;
+
+    return git_oid_to_python(&name);
+}
+
+
+PyDoc_STRVAR(BulkImport_discard__doc__,
+  "discard()\n"
+  "\n"
+  "Throw away the objects written since the import began.");
+
+PyObject *
+BulkImport_discard(BulkImport *self)
+{
+    if (self->finished)
+        Py_RETURN_NONE;
+
+    Py_BEGIN_ALLOW_THREADS;
+    git_odb_bulk_discard(self->backend);
+    Py_END_ALLOW_THREADS;
+    self->finished = 1;
+
+    Py_RETURN_NONE;
+}
+
+
+PyDoc_STRVAR(BulkImport___enter____doc__, "__enter__() -> BulkImport");
+
+PyObject *
+BulkImport___enter__(BulkImport *self)
+{
+    Py_INCREF(self);
+    return (PyObject*)self;
+}
+
+
+PyDoc_STRVAR(BulkImport___exit____doc__, "__exit__(*exc_info)\n"
+  "\n"
+  "Commit the import, or discard it if an exception was raised.");
+
+PyObject *
+BulkImport___exit__(BulkImport *self, PyObject *args)
+{
+    PyObject *py_type = Py_None, *py_value, *py_traceback, *result;
+
+    if (!PyArg_ParseTuple(args, "|OOO", &py_type, &py_value, &py_traceback))
+        return NULL;
+
+    if (py_type != Py_None)
+        return BulkImport_discard(self);
+
+    result = BulkImport_commit(self);
+    if (result == NULL)
+        return NULL;
+
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+PyMethodDef BulkImport_methods[] = {
+    METHOD(BulkImport, commit, METH_NOARGS),
+    METHOD(BulkImport, discard, METH_NOARGS),
+    METHOD(BulkImport, __enter__, METH_NOARGS),
+    METHOD(BulkImport, __exit__, METH_VARARGS),
+    {NULL}
+};
+
+
+PyDoc_STRVAR(BulkImport__doc__, "Import of many objects into a single pack.\n"
+  "\n"
+  "Returned by Repository.bulk_import(). Until it is committed or\n"
+  "discarded, every object written to the repository is appended to a new\n"
+  "packfile instead of being stored as a loose object.");
+
+PyTypeObject BulkImportType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.BulkImport",                      /* tp_name           */
+    sizeof(BulkImport),                        /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)BulkImport_dealloc,            /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    BulkImport__doc__,                         /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    0,                                         /* tp_iter           */
+    0,                                         /* tp_iternext       */
+    BulkImport_methods,                        /* tp_methods        */
+    0,                                         /* tp_members        */
+    0,                                         /* tp_getset         */
+    0,                                         /* tp_base           */
+    0,                                         /* tp_dict           */
+    0,                                         /* tp_descr_get      */
+    0,                                         /* tp_descr_set      */
+    0,                                         /* tp_dictoffset     */
+    0,                                         /* tp_init           */
+    0,                                         /* tp_alloc          */
+    0,                                         /* tp_new            */
+};
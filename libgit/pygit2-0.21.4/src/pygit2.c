@@ -51,6 +51,8 @@ extern PyTypeObject TreeBuilderType;
 extern PyTypeObject TreeEntryType;
 extern PyTypeObject TreeIterType;
 extern PyTypeObject BlobType;
+extern PyTypeObject BlobReaderType;
+extern PyTypeObject BulkImportType;
 extern PyTypeObject TagType;
 extern PyTypeObject WalkerType;
 extern PyTypeObject ReferenceType;
@@ -93,6 +95,44 @@ discover_repository(PyObject *self, PyObject *args)
     return py_repo_path;
 };
 
+PyDoc_STRVAR(clone_repository__doc__,
+  "clone_repository(url, path[, bare, checkout_branch, depth]) -> str\n"
+  "\n"
+  "Clones the repository at url into path and returns the path of the new\n"
+  "repository.\n"
+  "\n"
+  ":param int depth: when given, create a shallow clone holding only that\n"
+  "    many commits of history. Local paths are always cloned in full.");
+
+PyObject *
+clone_repository(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    git_clone_options opts = GIT_CLONE_OPTIONS_INIT;
+    git_repository *repo;
+    const char *url, *path;
+    PyObject *py_repo_path;
+    int err;
+    char *keywords[] = {"url", "path", "bare", "checkout_branch", "depth",
+                        NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|izi", keywords,
+                                     &url, &path, &opts.bare,
+                                     &opts.checkout_branch, &opts.depth))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS;
+    err = git_clone(&repo, url, path, &opts);
+    Py_END_ALLOW_THREADS;
+
+    if (err < 0)
+        return Error_set_str(err, url);
+
+    py_repo_path = to_path(git_repository_path(repo));
+    git_repository_free(repo);
+
+    return py_repo_path;
+}
+
 PyDoc_STRVAR(hashfile__doc__,
     "hashfile(path) -> Oid\n"
     "\n"
@@ -143,6 +183,8 @@ hash(PyObject *self, PyObject *args)
 PyMethodDef module_methods[] = {
     {"discover_repository", discover_repository, METH_VARARGS,
      discover_repository__doc__},
+    {"clone_repository", (PyCFunction)clone_repository,
+     METH_VARARGS | METH_KEYWORDS, clone_repository__doc__},
     {"hashfile", hashfile, METH_VARARGS, hashfile__doc__},
     {"hash", hash, METH_VARARGS, hash__doc__},
     {"option", option, METH_VARARGS, option__doc__},
@@ -195,6 +237,8 @@ moduleinit(PyObject* m)
     INIT_TYPE(TreeIterType, NULL, NULL)
     INIT_TYPE(TreeBuilderType, NULL, NULL)
     INIT_TYPE(BlobType, &ObjectType, NULL)
+    INIT_TYPE(BlobReaderType, NULL, NULL)
+    INIT_TYPE(BulkImportType, NULL, NULL)
     INIT_TYPE(TagType, &ObjectType, NULL)
     ADD_TYPE(m, Object)
     ADD_TYPE(m, Commit)
@@ -203,6 +247,8 @@ moduleinit(PyObject* m)
     ADD_TYPE(m, TreeEntry)
     ADD_TYPE(m, TreeBuilder)
     ADD_TYPE(m, Blob)
+    ADD_TYPE(m, BlobReader)
+    ADD_TYPE(m, BulkImport)
     ADD_TYPE(m, Tag)
     ADD_CONSTANT_INT(m, GIT_OBJ_ANY)
     ADD_CONSTANT_INT(m, GIT_OBJ_COMMIT)
@@ -234,6 +280,11 @@ moduleinit(PyObject* m)
     ADD_CONSTANT_INT(m, GIT_RESET_MIXED)
     ADD_CONSTANT_INT(m, GIT_RESET_HARD)
 
+    /*
+     * Remotes
+     */
+    ADD_CONSTANT_INT(m, GIT_REMOTE_DEPTH_UNSHALLOW)
+
     /*
      * References
      */
@@ -282,6 +333,7 @@ moduleinit(PyObject* m)
     ADD_CONSTANT_INT(m, GIT_CHECKOUT_DONT_UPDATE_INDEX)
     ADD_CONSTANT_INT(m, GIT_CHECKOUT_NO_REFRESH)
     ADD_CONSTANT_INT(m, GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH)
+    ADD_CONSTANT_INT(m, GIT_CHECKOUT_THREADS_AUTO)
 
     /*
      * Diff
@@ -38,11 +38,14 @@
 #include "branch.h"
 #include "signature.h"
 #include <git2/odb_backend.h>
+#include <git2/sys/odb_backend.h>
 
 extern PyObject *GitError;
 
 extern PyTypeObject IndexType;
 extern PyTypeObject WalkerType;
+extern PyTypeObject BlobReaderType;
+extern PyTypeObject BulkImportType;
 extern PyTypeObject SignatureType;
 extern PyTypeObject ObjectType;
 extern PyTypeObject OidType;
@@ -231,6 +234,19 @@ Repository_is_bare__get__(Repository *self)
 }
 
 
+PyDoc_STRVAR(Repository_is_shallow__doc__,
+  "Check if a repository is a shallow clone.");
+
+PyObject *
+Repository_is_shallow__get__(Repository *self)
+{
+    if (git_repository_is_shallow(self->repo) > 0)
+        Py_RETURN_TRUE;
+
+    Py_RETURN_FALSE;
+}
+
+
 PyDoc_STRVAR(Repository_git_object_lookup_prefix__doc__,
   "git_object_lookup_prefix(oid) -> Object\n"
   "\n"
@@ -381,6 +397,176 @@ Repository_read(Repository *self, PyObject *py_hex)
 }
 
 
+PyDoc_STRVAR(Repository_open_blob__doc__,
+  "open_blob(oid) -> BlobReader\n"
+  "\n"
+  "Open a streaming reader over the data of a blob. Unlike Blob.data, the\n"
+  "blob is never held in memory as a whole unless it is stored as a delta\n"
+  "in a pack.\n"
+  "\n"
+  "Example:\n"
+  "\n"
+  "  >>> with repo.open_blob(entry.id) as reader, open(path, 'wb') as f:\n"
+  "  ...     buf = bytearray(65536)\n"
+  "  ...     n = reader.readinto(buf)\n"
+  "  ...     while n:\n"
+  "  ...         f.write(memoryview(buf)[:n])\n"
+  "  ...         n = reader.readinto(buf)\n");
+
+PyObject *
+Repository_open_blob(Repository *self, PyObject *py_hex)
+{
+    git_oid oid;
+    git_odb *odb;
+    git_odb_stream *stream;
+    git_otype type;
+    size_t size;
+    BlobReader *py_reader;
+    int err;
+
+    err = py_oid_to_git_oid_expand(self->repo, py_hex, &oid);
+    if (err < 0)
+        return NULL;
+
+    err = git_repository_odb(&odb, self->repo);
+    if (err < 0)
+        return Error_set(err);
+
+    err = git_odb_read_header(&size, &type, odb, &oid);
+    if (err < 0)
+        goto error;
+
+    if (type != GIT_OBJ_BLOB) {
+        git_odb_free(odb);
+        PyErr_SetString(PyExc_ValueError, "object is not a blob");
+        return NULL;
+    }
+
+    err = git_odb_open_rstream(&stream, odb, &oid);
+    if (err < 0)
+        goto error;
+
+    py_reader = PyObject_New(BlobReader, &BlobReaderType);
+    if (!py_reader) {
+        git_odb_stream_free(stream);
+        git_odb_free(odb);
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    py_reader->repo = self;
+    py_reader->odb = odb;
+    py_reader->stream = stream;
+    py_reader->size = size;
+    py_reader->offset = 0;
+    py_reader->reading = 0;
+    return (PyObject*)py_reader;
+
+error:
+    git_odb_free(odb);
+    return Error_set_oid(err, &oid, GIT_OID_HEXSZ);
+}
+
+
+/* The bulk backend is added once and reused by the imports that follow */
+static int
+Repository_add_bulk_backend(Repository *self, git_odb *odb,
+                            const git_odb_bulk_options *opts)
+{
+    git_odb_backend *backend;
+    const char *path;
+    char *objects_dir;
+    int err;
+
+    /* the repository path ends with a slash */
+    path = git_repository_path(self->repo);
+    objects_dir = malloc(strlen(path) + sizeof("objects"));
+    if (objects_dir == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+    strcpy(objects_dir, path);
+    strcat(objects_dir, "objects");
+
+    err = git_odb_backend_bulk(&backend, objects_dir, opts);
+    free(objects_dir);
+    if (err < 0)
+        return err;
+
+    /* ahead of the loose (2) and packed (1) backends */
+    err = git_odb_add_backend(odb, backend, 10);
+    if (err < 0) {
+        backend->free(backend);
+        return err;
+    }
+
+    self->bulk = backend;
+    return 0;
+}
+
+
+PyDoc_STRVAR(Repository_bulk_import__doc__,
+  "bulk_import([threads, compression]) -> BulkImport\n"
+  "\n"
+  "Start writing new objects into a single packfile instead of one loose\n"
+  "file each, until the returned BulkImport is committed or discarded.\n"
+  "Objects can be read back before the commit. Only one import can be in\n"
+  "progress at a time.\n"
+  "\n"
+  ":param int threads: number of threads compressing objects; with 0 or 1\n"
+  "   they are compressed by the thread writing them.\n"
+  "\n"
+  ":param int compression: zlib compression level, -1 for the default.\n"
+  "\n"
+  "Example:\n"
+  "\n"
+  "  >>> with repo.bulk_import(threads=4):\n"
+  "  ...     for path in assets:\n"
+  "  ...         repo.create_blob_fromworkdir(path)\n");
+
+PyObject *
+Repository_bulk_import(Repository *self, PyObject *args, PyObject *kwds)
+{
+    git_odb_bulk_options opts = GIT_ODB_BULK_OPTIONS_INIT;
+    git_odb *odb;
+    BulkImport *py_import;
+    char *keywords[] = {"threads", "compression", NULL};
+    int err;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Ii", keywords,
+                                     &opts.threads, &opts.compression_level))
+        return NULL;
+
+    err = git_repository_odb(&odb, self->repo);
+    if (err < 0)
+        return Error_set(err);
+
+    if (self->bulk == NULL)
+        err = Repository_add_bulk_backend(self, odb, &opts);
+    else
+        err = git_odb_bulk_restart(self->bulk, &opts);
+
+    if (err < 0) {
+        git_odb_free(odb);
+        return Error_set(err);
+    }
+
+    py_import = PyObject_New(BulkImport, &BulkImportType);
+    if (!py_import) {
+        git_odb_bulk_discard(self->bulk);
+        git_odb_free(odb);
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    py_import->repo = self;
+    py_import->odb = odb;
+    py_import->backend = self->bulk;
+    py_import->finished = 0;
+    return (PyObject*)py_import;
+}
+
+
 PyDoc_STRVAR(Repository_write__doc__,
     "write(type, data) -> Oid\n"
     "\n"
@@ -1382,6 +1568,157 @@ Repository_reset(Repository *self, PyObject* args)
     Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR(Repository_checkout_head__doc__,
+  "checkout_head([strategy, threads])\n"
+  "\n"
+  "Updates the working directory and the index to match the commit\n"
+  "pointed at by HEAD.\n"
+  "\n"
+  ":param int strategy: a combination of GIT_CHECKOUT_* flags, defaults to\n"
+  "    GIT_CHECKOUT_SAFE_CREATE.\n"
+  "\n"
+  ":param int threads: number of threads writing files; 0 or 1 writes them\n"
+  "    one by one, GIT_CHECKOUT_THREADS_AUTO uses one thread per CPU.\n");
+
+PyObject *
+Repository_checkout_head(Repository *self, PyObject *args, PyObject *kwds)
+{
+    git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+    int err;
+    char *keywords[] = {"strategy", "threads", NULL};
+
+    opts.checkout_strategy = GIT_CHECKOUT_SAFE_CREATE;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|II", keywords,
+                                     &opts.checkout_strategy, &opts.threads))
+        return NULL;
+
+    err = git_checkout_head(self->repo, &opts);
+
+    if (err < 0)
+        return Error_set(err);
+
+    Py_RETURN_NONE;
+}
+
+
+PyDoc_STRVAR(Repository_checkout_index__doc__,
+  "checkout_index([strategy, threads])\n"
+  "\n"
+  "Updates the working directory to match the content of the index.\n"
+  "\n"
+  "See checkout_head() for the meaning of the arguments.\n");
+
+PyObject *
+Repository_checkout_index(Repository *self, PyObject *args, PyObject *kwds)
+{
+    git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+    int err;
+    char *keywords[] = {"strategy", "threads", NULL};
+
+    opts.checkout_strategy = GIT_CHECKOUT_SAFE_CREATE;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|II", keywords,
+                                     &opts.checkout_strategy, &opts.threads))
+        return NULL;
+
+    err = git_checkout_index(self->repo, NULL, &opts);
+
+    if (err < 0)
+        return Error_set(err);
+
+    Py_RETURN_NONE;
+}
+
+
+PyDoc_STRVAR(Repository_checkout_tree__doc__,
+  "checkout_tree(treeish[, strategy, threads])\n"
+  "\n"
+  "Updates the working directory and the index to match the given tree,\n"
+  "commit or tag.\n"
+  "\n"
+  "See checkout_head() for the meaning of the other arguments.\n");
+
+PyObject *
+Repository_checkout_tree(Repository *self, PyObject *args, PyObject *kwds)
+{
+    git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+    Object *py_treeish;
+    int err;
+    char *keywords[] = {"treeish", "strategy", "threads", NULL};
+
+    opts.checkout_strategy = GIT_CHECKOUT_SAFE_CREATE;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|II", keywords,
+                                     &ObjectType, &py_treeish,
+                                     &opts.checkout_strategy, &opts.threads))
+        return NULL;
+
+    err = git_checkout_tree(self->repo, py_treeish->obj, &opts);
+
+    if (err < 0)
+        return Error_set(err);
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(Repository_write_commit_graph__doc__,
+  "write_commit_graph()\n"
+  "\n"
+  "Writes objects/info/commit-graph for every commit reachable from HEAD\n"
+  "or a reference, so walks and merge-base computations no longer have to\n"
+  "read each commit object.");
+
+PyObject *
+Repository_write_commit_graph(Repository *self)
+{
+    int err;
+
+    err = git_graph_write_commit_graph(self->repo);
+    if (err < 0)
+        return Error_set(err);
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(Repository_fetch__doc__,
+  "fetch([remote, depth])\n"
+  "\n"
+  "Downloads new objects and updates the remote-tracking references of the\n"
+  "given remote, 'origin' by default.\n"
+  "\n"
+  ":param int depth: fetch only this many commits of each branch. Fetching\n"
+  "    into a shallow repository with a larger depth deepens it, and\n"
+  "    GIT_REMOTE_DEPTH_UNSHALLOW fetches the complete history. 0 (the\n"
+  "    default) keeps whatever history the repository already has.\n");
+
+PyObject *
+Repository_fetch(Repository *self, PyObject *args, PyObject *kwds)
+{
+    git_remote *remote;
+    const char *name = "origin";
+    int depth = 0;
+    int err;
+    char *keywords[] = {"remote", "depth", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|si", keywords,
+                                     &name, &depth))
+        return NULL;
+
+    err = git_remote_load(&remote, self->repo, name);
+    if (err < 0)
+        return Error_set_str(err, name);
+
+    git_remote_set_depth(remote, depth);
+
+    Py_BEGIN_ALLOW_THREADS;
+    err = git_remote_fetch(remote, NULL, NULL);
+    Py_END_ALLOW_THREADS;
+
+    git_remote_free(remote);
+    if (err < 0)
+        return Error_set(err);
+
+    Py_RETURN_NONE;
+}
+
 PyMethodDef Repository_methods[] = {
     METHOD(Repository, create_blob, METH_VARARGS),
     METHOD(Repository, create_blob_fromworkdir, METH_VARARGS),
@@ -1394,6 +1731,8 @@ PyMethodDef Repository_methods[] = {
     METHOD(Repository, merge_analysis, METH_O),
     METHOD(Repository, merge, METH_O),
     METHOD(Repository, read, METH_O),
+    METHOD(Repository, open_blob, METH_O),
+    METHOD(Repository, bulk_import, METH_VARARGS | METH_KEYWORDS),
     METHOD(Repository, write, METH_VARARGS),
     METHOD(Repository, create_reference_direct, METH_VARARGS),
     METHOD(Repository, create_reference_symbolic, METH_VARARGS),
@@ -1410,6 +1749,11 @@ PyMethodDef Repository_methods[] = {
     METHOD(Repository, listall_branches, METH_VARARGS),
     METHOD(Repository, create_branch, METH_VARARGS),
     METHOD(Repository, reset, METH_VARARGS),
+    METHOD(Repository, checkout_head, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Repository, checkout_index, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Repository, checkout_tree, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Repository, write_commit_graph, METH_NOARGS),
+    METHOD(Repository, fetch, METH_VARARGS | METH_KEYWORDS),
     {NULL}
 };
 
@@ -1420,6 +1764,7 @@ PyGetSetDef Repository_getseters[] = {
     GETTER(Repository, head_is_unborn),
     GETTER(Repository, is_empty),
     GETTER(Repository, is_bare),
+    GETTER(Repository, is_shallow),
     GETSET(Repository, workdir),
     GETTER(Repository, default_signature),
     GETTER(Repository, _pointer),
@@ -44,6 +44,8 @@ Repository_read_raw(git_repository *repo, const git_oid *oid, size_t len);
 PyObject* Repository_head(Repository *self);
 PyObject* Repository_getitem(Repository *self, PyObject *value);
 PyObject* Repository_read(Repository *self, PyObject *py_hex);
+PyObject* Repository_open_blob(Repository *self, PyObject *py_hex);
+PyObject* Repository_bulk_import(Repository *self, PyObject *args, PyObject *kwds);
 PyObject* Repository_write(Repository *self, PyObject *args);
 PyObject* Repository_get_index(Repository *self, void *closure);
 PyObject* Repository_get_path(Repository *self, void *closure);
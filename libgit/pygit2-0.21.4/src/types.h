@@ -47,6 +47,7 @@ typedef struct {
     git_repository *repo;
     PyObject *index;  /* It will be None for a bare repository */
     PyObject *config; /* It will be None for a bare repository */
+    git_odb_backend *bulk; /* owned by the odb, reused by every bulk_import() */
 } Repository;
 
 
@@ -74,6 +75,26 @@ SIMPLE_TYPE(Tree, git_tree, tree)
 SIMPLE_TYPE(Blob, git_blob, blob)
 SIMPLE_TYPE(Tag, git_tag, tag)
 
+/* bulk import backend of the repository's odb */
+typedef struct {
+    PyObject_HEAD
+    Repository *repo;
+    git_odb *odb;
+    git_odb_backend *backend;
+    int finished; /* the backend may be running a later import by now */
+} BulkImport;
+
+/* git_odb_stream over a blob */
+typedef struct {
+    PyObject_HEAD
+    Repository *repo;
+    git_odb *odb;
+    git_odb_stream *stream;
+    size_t size;
+    size_t offset;
+    int reading;
+} BlobReader;
+
 /* git_note */
 typedef struct {
     PyObject_HEAD
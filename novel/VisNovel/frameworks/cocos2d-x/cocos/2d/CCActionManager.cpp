@@ -396,6 +396,19 @@ ssize_t ActionManager::getNumberOfRunningActionsInTarget(const Node *target) con
     return 0;
 }
 
+ssize_t ActionManager::getNumberOfRunningActions() const
+{
+    ssize_t count = 0;
+    for (tHashElement *element = _targets; element != nullptr; element = (tHashElement*)element->hh.next)
+    {
+        if (!element->paused && element->actions)
+        {
+            count += element->actions->num;
+        }
+    }
+    return count;
+}
+
 // main loop
 void ActionManager::update(float dt)
 {
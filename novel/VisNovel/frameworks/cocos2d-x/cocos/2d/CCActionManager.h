@@ -145,6 +145,14 @@ public:
      */
     CC_DEPRECATED_ATTRIBUTE inline ssize_t numberOfRunningActionsInTarget(Node *target) const { return getNumberOfRunningActionsInTarget(target); }
 
+    /** Returns the numbers of actions that are running in all the targets which are not paused.
+     * Composable actions are counted as 1 action.
+     *
+     * @return  The numbers of running actions.
+     * @js NA
+     */
+    ssize_t getNumberOfRunningActions() const;
+
     /** Pauses the target: all running actions and newly added actions will be paused.
      *
      * @param target    A certain target.
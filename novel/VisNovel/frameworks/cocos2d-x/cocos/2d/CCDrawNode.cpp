@@ -122,9 +122,18 @@ DrawNode::DrawNode()
 , _bufferCapacityGLLine(0)
 , _bufferCountGLLine(0)
 , _bufferGLLine(nullptr)
+, _vboCapacity(0)
+, _vboCapacityGLPoint(0)
+, _vboCapacityGLLine(0)
+, _batchVerts(nullptr)
+, _batchIndices(nullptr)
+, _batchCapacity(0)
 , _dirty(false)
 , _dirtyGLPoint(false)
 , _dirtyGLLine(false)
+, _dirtyBatch(false)
+, _retained(false)
+, _batchingEnabled(false)
 , _lineWidth(DEFAULT_LINE_WIDTH)
 {
     _blendFunc = BlendFunc::ALPHA_PREMULTIPLIED;
@@ -138,6 +147,10 @@ DrawNode::~DrawNode()
     _bufferGLPoint = nullptr;
     free(_bufferGLLine);
     _bufferGLLine = nullptr;
+    free(_batchVerts);
+    _batchVerts = nullptr;
+    free(_batchIndices);
+    _batchIndices = nullptr;
     
     glDeleteBuffers(1, &_vbo);
     glDeleteBuffers(1, &_vboGLLine);
@@ -284,9 +297,15 @@ bool DrawNode::init()
     
     CHECK_GL_ERROR_DEBUG();
     
+    // retained nodes reallocate as static buffers on their next upload
+    _vboCapacity = _retained ? 0 : _bufferCapacity;
+    _vboCapacityGLLine = _retained ? 0 : _bufferCapacityGLLine;
+    _vboCapacityGLPoint = _retained ? 0 : _bufferCapacityGLPoint;
+    
     _dirty = true;
     _dirtyGLLine = true;
     _dirtyGLPoint = true;
+    _dirtyBatch = true;
     
 #if CC_ENABLE_CACHE_TEXTURE_DATA
     // Need to listen the event only when not use batchnode, because it will use VBO
@@ -301,13 +320,104 @@ bool DrawNode::init()
     return true;
 }
 
+void DrawNode::uploadBuffer(GLuint vbo, GLsizei &vboCapacity, int bufferCapacity, const V2F_C4B_T2F *buffer, GLsizei count)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    
+    if (count > vboCapacity)
+    {
+        if (_retained)
+        {
+            // static buffer of exactly the geometry's size
+            vboCapacity = count;
+            glBufferData(GL_ARRAY_BUFFER, sizeof(V2F_C4B_T2F)*count, buffer, GL_STATIC_DRAW);
+            return;
+        }
+        // reserve the whole CPU capacity so appending doesn't reallocate every frame
+        vboCapacity = bufferCapacity;
+        glBufferData(GL_ARRAY_BUFFER, sizeof(V2F_C4B_T2F)*bufferCapacity, nullptr, GL_STREAM_DRAW);
+    }
+    
+    // only the used part changed, no need to send the whole capacity
+    if (count > 0)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(V2F_C4B_T2F)*count, buffer);
+    }
+}
+
+bool DrawNode::canBatchTriangles()
+{
+    // the batched path draws with the noMVP variant of the default shader,
+    // nodes with a custom shader keep their own draw call
+    if (getGLProgram() != GLProgramCache::getInstance()->getGLProgram(GLProgram::SHADER_NAME_POSITION_LENGTH_TEXTURE_COLOR))
+        return false;
+    
+    return _bufferCount < Renderer::VBO_SIZE && _bufferCount < Renderer::INDEX_VBO_SIZE;
+}
+
+void DrawNode::updateBatchTriangles()
+{
+    if (!_dirtyBatch)
+        return;
+    
+    if (_bufferCount > _batchCapacity)
+    {
+        _batchCapacity = _bufferCapacity;
+        _batchVerts = (V3F_C4B_T2F*)realloc(_batchVerts, _batchCapacity*sizeof(V3F_C4B_T2F));
+        _batchIndices = (unsigned short*)realloc(_batchIndices, _batchCapacity*sizeof(unsigned short));
+    }
+    
+    for (GLsizei i = 0; i < _bufferCount; i++)
+    {
+        _batchVerts[i].vertices.set(_buffer[i].vertices.x, _buffer[i].vertices.y, 0.0f);
+        _batchVerts[i].colors = _buffer[i].colors;
+        _batchVerts[i].texCoords = _buffer[i].texCoords;
+        _batchIndices[i] = (unsigned short)i;
+    }
+    
+    _dirtyBatch = false;
+}
+
+void DrawNode::setRetained(bool retained)
+{
+    if (_retained != retained)
+    {
+        _retained = retained;
+        // force the buffers to be reallocated with the new usage
+        _vboCapacity = _vboCapacityGLPoint = _vboCapacityGLLine = 0;
+        _dirty = _dirtyGLPoint = _dirtyGLLine = true;
+    }
+}
+
+void DrawNode::setBatchingEnabled(bool enabled)
+{
+    _batchingEnabled = enabled;
+}
+
 void DrawNode::draw(Renderer *renderer, const Mat4 &transform, uint32_t flags)
 {
     if(_bufferCount)
     {
-        _customCommand.init(_globalZOrder, transform, flags);
-        _customCommand.func = CC_CALLBACK_0(DrawNode::onDraw, this, transform, flags);
-        renderer->addCommand(&_customCommand);
+        if (_batchingEnabled && canBatchTriangles())
+        {
+            updateBatchTriangles();
+            
+            TrianglesCommand::Triangles triangles;
+            triangles.verts = _batchVerts;
+            triangles.indices = _batchIndices;
+            triangles.vertCount = _bufferCount;
+            triangles.indexCount = _bufferCount;
+            
+            auto glProgramState = GLProgramState::getOrCreateWithGLProgramName(GLProgram::SHADER_NAME_POSITION_LENGTH_TEXTURE_COLOR_NO_MVP);
+            _trianglesCommand.init(_globalZOrder, 0, glProgramState, _blendFunc, triangles, transform, flags);
+            renderer->addCommand(&_trianglesCommand);
+        }
+        else
+        {
+            _customCommand.init(_globalZOrder, transform, flags);
+            _customCommand.func = CC_CALLBACK_0(DrawNode::onDraw, this, transform, flags);
+            renderer->addCommand(&_customCommand);
+        }
     }
     
     if(_bufferCountGLPoint)
@@ -335,9 +445,7 @@ void DrawNode::onDraw(const Mat4 &transform, uint32_t flags)
 
     if (_dirty)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(V2F_C4B_T2F)*_bufferCapacity, _buffer, GL_STREAM_DRAW);
-        
+        uploadBuffer(_vbo, _vboCapacity, _bufferCapacity, _buffer, _bufferCount);
         _dirty = false;
     }
     if (Configuration::getInstance()->supportsShareableVAO())
@@ -379,8 +487,7 @@ void DrawNode::onDrawGLLine(const Mat4 &transform, uint32_t flags)
 
     if (_dirtyGLLine)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, _vboGLLine);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(V2F_C4B_T2F)*_bufferCapacityGLLine, _bufferGLLine, GL_STREAM_DRAW);
+        uploadBuffer(_vboGLLine, _vboCapacityGLLine, _bufferCapacityGLLine, _bufferGLLine, _bufferCountGLLine);
         _dirtyGLLine = false;
     }
     if (Configuration::getInstance()->supportsShareableVAO())
@@ -422,9 +529,7 @@ void DrawNode::onDrawGLPoint(const Mat4 &transform, uint32_t flags)
 
     if (_dirtyGLPoint)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, _vboGLPoint);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(V2F_C4B_T2F)*_bufferCapacityGLPoint, _bufferGLPoint, GL_STREAM_DRAW);
-        
+        uploadBuffer(_vboGLPoint, _vboCapacityGLPoint, _bufferCapacityGLPoint, _bufferGLPoint, _bufferCountGLPoint);
         _dirtyGLPoint = false;
     }
     
@@ -686,6 +791,7 @@ void DrawNode::drawDot(const Vec2 &pos, float radius, const Color4F &color)
     _bufferCount += vertex_count;
     
     _dirty = true;
+    _dirtyBatch = true;
 }
 
 void DrawNode::drawRect(const Vec2 &p1, const Vec2 &p2, const Vec2 &p3, const Vec2& p4, const Color4F &color)
@@ -767,6 +873,7 @@ void DrawNode::drawSegment(const Vec2 &from, const Vec2 &to, float radius, const
     _bufferCount += vertex_count;
     
     _dirty = true;
+    _dirtyBatch = true;
 }
 
 void DrawNode::drawPolygon(const Vec2 *verts, int count, const Color4F &fillColor, float borderWidth, const Color4F &borderColor)
@@ -850,6 +957,7 @@ void DrawNode::drawPolygon(const Vec2 *verts, int count, const Color4F &fillColo
     _bufferCount += vertex_count;
     
     _dirty = true;
+    _dirtyBatch = true;
 }
 
 void DrawNode::drawSolidRect(const Vec2 &origin, const Vec2 &destination, const Color4F &color)
@@ -913,6 +1021,7 @@ void DrawNode::drawTriangle(const Vec2 &p1, const Vec2 &p2, const Vec2 &p3, cons
 
     _bufferCount += vertex_count;
     _dirty = true;
+    _dirtyBatch = true;
 }
 
 void DrawNode::drawQuadraticBezier(const Vec2& from, const Vec2& control, const Vec2& to, unsigned int segments, const Color4F &color)
@@ -924,6 +1033,7 @@ void DrawNode::clear()
 {
     _bufferCount = 0;
     _dirty = true;
+    _dirtyBatch = true;
     _bufferCountGLLine = 0;
     _dirtyGLLine = true;
     _bufferCountGLPoint = 0;
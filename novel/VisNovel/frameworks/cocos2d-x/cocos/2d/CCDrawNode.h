@@ -34,6 +34,7 @@
 #include "2d/CCNode.h"
 #include "base/ccTypes.h"
 #include "renderer/CCCustomCommand.h"
+#include "renderer/CCTrianglesCommand.h"
 #include "math/CCMath.h"
 
 NS_CC_BEGIN
@@ -312,6 +313,23 @@ public:
     virtual void draw(Renderer *renderer, const Mat4 &transform, uint32_t flags) override;
     
     void setLineWidth(int lineWidth);
+
+    /** Hints that the geometry rarely changes once drawn.
+     * Retained nodes upload their vertices into GL_STATIC_DRAW buffers sized to fit,
+     * which are only touched again after the geometry is modified. Default is false.
+     */
+    void setRetained(bool retained);
+    /** Whether the geometry is kept in static buffers. */
+    bool isRetained() const { return _retained; }
+
+    /** Submits the triangles through a TrianglesCommand instead of a CustomCommand.
+     * Consecutive DrawNodes with the same blend function are then drawn by the renderer
+     * in a single batch. Only applies while the node uses its default shader; points and
+     * lines always keep their own draw calls. Default is false.
+     */
+    void setBatchingEnabled(bool enabled);
+    /** Whether the triangles are submitted for batching. */
+    bool isBatchingEnabled() const { return _batchingEnabled; }
     
 CC_CONSTRUCTOR_ACCESS:
     DrawNode();
@@ -322,6 +340,9 @@ protected:
     void ensureCapacity(int count);
     void ensureCapacityGLPoint(int count);
     void ensureCapacityGLLine(int count);
+    void uploadBuffer(GLuint vbo, GLsizei &vboCapacity, int bufferCapacity, const V2F_C4B_T2F *buffer, GLsizei count);
+    bool canBatchTriangles();
+    void updateBatchTriangles();
 
     GLuint      _vao;
     GLuint      _vbo;
@@ -348,10 +369,23 @@ protected:
     CustomCommand _customCommand;
     CustomCommand _customCommandGLPoint;
     CustomCommand _customCommandGLLine;
+    TrianglesCommand _trianglesCommand;
+
+    GLsizei     _vboCapacity;
+    GLsizei     _vboCapacityGLPoint;
+    GLsizei     _vboCapacityGLLine;
+
+    V3F_C4B_T2F *_batchVerts;
+    unsigned short *_batchIndices;
+    int         _batchCapacity;
 
     bool        _dirty;
     bool        _dirtyGLPoint;
     bool        _dirtyGLLine;
+    bool        _dirtyBatch;
+
+    bool        _retained;
+    bool        _batchingEnabled;
     
     int         _lineWidth;
 
@@ -0,0 +1,421 @@
+/****************************************************************************
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "2d/CCInstancedSpriteBatchNode.h"
+
+#include <math.h>
+
+#include "base/CCDirector.h"
+#include "base/CCConfiguration.h"
+#include "renderer/CCTexture2D.h"
+#include "renderer/CCTextureCache.h"
+#include "renderer/CCRenderer.h"
+#include "renderer/CCGLProgram.h"
+#include "renderer/CCGLProgramCache.h"
+#include "renderer/CCGLProgramState.h"
+#include "renderer/ccGLStateCache.h"
+#include "renderer/ccShaders.h"
+#include "deprecated/CCString.h" // For StringUtils::format
+
+NS_CC_BEGIN
+
+InstancedSpriteBatchNode::Instance::Instance()
+: position(Vec2::ZERO)
+, scale(Vec2::ONE)
+, rotation(0.0f)
+, color(Color4B::WHITE)
+, rect(Rect::ZERO)
+{
+}
+
+/*
+* creation with Texture2D
+*/
+
+InstancedSpriteBatchNode* InstancedSpriteBatchNode::createWithTexture(Texture2D* tex, ssize_t capacity/* = DEFAULT_CAPACITY*/)
+{
+    InstancedSpriteBatchNode *batchNode = new (std::nothrow) InstancedSpriteBatchNode();
+    if (batchNode && batchNode->initWithTexture(tex, capacity))
+    {
+        batchNode->autorelease();
+        return batchNode;
+    }
+
+    CC_SAFE_DELETE(batchNode);
+    return nullptr;
+}
+
+/*
+* creation with File Image
+*/
+
+InstancedSpriteBatchNode* InstancedSpriteBatchNode::create(const std::string& fileImage, ssize_t capacity/* = DEFAULT_CAPACITY*/)
+{
+    InstancedSpriteBatchNode *batchNode = new (std::nothrow) InstancedSpriteBatchNode();
+    if (batchNode && batchNode->initWithFile(fileImage, capacity))
+    {
+        batchNode->autorelease();
+        return batchNode;
+    }
+
+    CC_SAFE_DELETE(batchNode);
+    return nullptr;
+}
+
+InstancedSpriteBatchNode::InstancedSpriteBatchNode()
+: _texture(nullptr)
+, _blendFunc(BlendFunc::ALPHA_PREMULTIPLIED)
+, _dirty(true)
+, _instancedProgram(nullptr)
+, _attribCorner(-1)
+, _attribTransform(-1)
+, _attribRotation(-1)
+, _attribColor(-1)
+, _attribTexRect(-1)
+{
+    _buffersVBO[0] = _buffersVBO[1] = 0;
+}
+
+InstancedSpriteBatchNode::~InstancedSpriteBatchNode()
+{
+    if (_buffersVBO[0])
+    {
+        glDeleteBuffers(2, _buffersVBO);
+    }
+    CC_SAFE_RELEASE(_instancedProgram);
+    CC_SAFE_RELEASE(_texture);
+}
+
+bool InstancedSpriteBatchNode::initWithTexture(Texture2D *tex, ssize_t capacity/* = DEFAULT_CAPACITY*/)
+{
+    if (tex == nullptr)
+    {
+        return false;
+    }
+
+    setTexture(tex);
+    _instances.reserve(capacity);
+
+    setGLProgramState(GLProgramState::getOrCreateWithGLProgramName(GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP));
+    setupInstancing();
+
+    return true;
+}
+
+bool InstancedSpriteBatchNode::initWithFile(const std::string& fileImage, ssize_t capacity/* = DEFAULT_CAPACITY*/)
+{
+    Texture2D *texture2D = Director::getInstance()->getTextureCache()->addImage(fileImage);
+    return initWithTexture(texture2D, capacity);
+}
+
+void InstancedSpriteBatchNode::setupInstancing()
+{
+#if CC_USE_GL_INSTANCING
+    if (!Configuration::getInstance()->supportsInstancing())
+    {
+        return;
+    }
+
+    // only compiled the first time it is needed, not with the default programs
+    auto programCache = GLProgramCache::getInstance();
+    auto program = programCache->getGLProgram(GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED);
+    if (program == nullptr)
+    {
+        program = GLProgram::createWithByteArrays(ccPositionTextureColor_Instanced_vert, ccPositionTextureColor_frag);
+        if (program == nullptr)
+        {
+            CCLOG("cocos2d: InstancedSpriteBatchNode: failed to create the instanced program, using QuadCommand");
+            return;
+        }
+        programCache->addGLProgram(program, GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED);
+    }
+
+    _attribCorner = program->getAttribLocation("a_corner");
+    _attribTransform = program->getAttribLocation("a_instanceTransform");
+    _attribRotation = program->getAttribLocation("a_instanceRotation");
+    _attribColor = program->getAttribLocation("a_instanceColor");
+    _attribTexRect = program->getAttribLocation("a_instanceTexRect");
+    if (_attribCorner < 0 || _attribTransform < 0 || _attribRotation < 0 || _attribColor < 0 || _attribTexRect < 0)
+    {
+        return;
+    }
+
+    _instancedProgram = program;
+    _instancedProgram->retain();
+
+    // triangle strip: bottom left, bottom right, top left, top right
+    static const GLfloat corners[] = { 0, 0,  1, 0,  0, 1,  1, 1 };
+
+    glGenBuffers(2, _buffersVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, _buffersVBO[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    CHECK_GL_ERROR_DEBUG();
+#endif
+}
+
+ssize_t InstancedSpriteBatchNode::addInstance(const Instance& instance)
+{
+    _instances.push_back(instance);
+    _dirty = true;
+    return (ssize_t)_instances.size() - 1;
+}
+
+void InstancedSpriteBatchNode::setInstance(ssize_t index, const Instance& instance)
+{
+    CCASSERT(index >= 0 && index < (ssize_t)_instances.size(), "Invalid index");
+    _instances[index] = instance;
+    _dirty = true;
+}
+
+void InstancedSpriteBatchNode::removeInstance(ssize_t index)
+{
+    CCASSERT(index >= 0 && index < (ssize_t)_instances.size(), "Invalid index");
+    _instances[index] = _instances.back();
+    _instances.pop_back();
+    _dirty = true;
+}
+
+void InstancedSpriteBatchNode::removeAllInstances()
+{
+    _instances.clear();
+    _dirty = true;
+}
+
+void InstancedSpriteBatchNode::setTexture(Texture2D *texture)
+{
+    if (_texture != texture)
+    {
+        CC_SAFE_RETAIN(texture);
+        CC_SAFE_RELEASE(_texture);
+        _texture = texture;
+        updateBlendFunc();
+        _dirty = true;
+    }
+}
+
+void InstancedSpriteBatchNode::updateBlendFunc()
+{
+    if (_texture && !_texture->hasPremultipliedAlpha())
+    {
+        _blendFunc = BlendFunc::ALPHA_NON_PREMULTIPLIED;
+    }
+    else
+    {
+        _blendFunc = BlendFunc::ALPHA_PREMULTIPLIED;
+    }
+}
+
+void InstancedSpriteBatchNode::updateDisplayedColor(const Color3B& parentColor)
+{
+    Node::updateDisplayedColor(parentColor);
+    _dirty = true;
+}
+
+void InstancedSpriteBatchNode::updateDisplayedOpacity(GLubyte parentOpacity)
+{
+    Node::updateDisplayedOpacity(parentOpacity);
+    _dirty = true;
+}
+
+void InstancedSpriteBatchNode::computeInstance(const Instance& instance, GLfloat* size, GLfloat* texRect, Color4B* color) const
+{
+    Rect rect = instance.rect.equals(Rect::ZERO) ? Rect(Vec2::ZERO, _texture->getContentSize()) : instance.rect;
+    Rect pixels = CC_RECT_POINTS_TO_PIXELS(rect);
+    float atlasWidth = (float)_texture->getPixelsWide();
+    float atlasHeight = (float)_texture->getPixelsHigh();
+
+    size[0] = rect.size.width * instance.scale.x;
+    size[1] = rect.size.height * instance.scale.y;
+
+    // left, bottom, right, top
+    texRect[0] = pixels.origin.x / atlasWidth;
+    texRect[1] = (pixels.origin.y + pixels.size.height) / atlasHeight;
+    texRect[2] = (pixels.origin.x + pixels.size.width) / atlasWidth;
+    texRect[3] = pixels.origin.y / atlasHeight;
+
+    GLubyte opacity = instance.color.a * _displayedOpacity / 255;
+    color->r = instance.color.r * _displayedColor.r / 255;
+    color->g = instance.color.g * _displayedColor.g / 255;
+    color->b = instance.color.b * _displayedColor.b / 255;
+    color->a = opacity;
+    if (_texture->hasPremultipliedAlpha())
+    {
+        color->r = color->r * opacity / 255;
+        color->g = color->g * opacity / 255;
+        color->b = color->b * opacity / 255;
+    }
+}
+
+void InstancedSpriteBatchNode::fillInstanceVertices()
+{
+    _instanceVertices.resize(_instances.size());
+
+    for (size_t i = 0; i < _instances.size(); ++i)
+    {
+        const auto& instance = _instances[i];
+        auto& vertex = _instanceVertices[i];
+
+        computeInstance(instance, &vertex.transform[2], vertex.texRect, &vertex.color);
+        vertex.transform[0] = instance.position.x;
+        vertex.transform[1] = instance.position.y;
+
+        float radians = CC_DEGREES_TO_RADIANS(instance.rotation);
+        vertex.rotation[0] = cosf(radians);
+        vertex.rotation[1] = sinf(radians);
+    }
+}
+
+void InstancedSpriteBatchNode::fillQuads()
+{
+    _quads.resize(_instances.size());
+
+    for (size_t i = 0; i < _instances.size(); ++i)
+    {
+        const auto& instance = _instances[i];
+        auto& quad = _quads[i];
+
+        GLfloat size[2];
+        GLfloat texRect[4];
+        Color4B color;
+        computeInstance(instance, size, texRect, &color);
+
+        float radians = CC_DEGREES_TO_RADIANS(instance.rotation);
+        float c = cosf(radians);
+        float s = sinf(radians);
+        float hw = size[0] * 0.5f;
+        float hh = size[1] * 0.5f;
+
+        // same math as ccShader_PositionTextureColor_Instanced.vert
+        auto corner = [&](float x, float y) {
+            return Vec3(x * c + y * s + instance.position.x, y * c - x * s + instance.position.y, 0.0f);
+        };
+
+        quad.bl.vertices = corner(-hw, -hh);
+        quad.br.vertices = corner(hw, -hh);
+        quad.tl.vertices = corner(-hw, hh);
+        quad.tr.vertices = corner(hw, hh);
+
+        quad.bl.texCoords = Tex2F(texRect[0], texRect[1]);
+        quad.br.texCoords = Tex2F(texRect[2], texRect[1]);
+        quad.tl.texCoords = Tex2F(texRect[0], texRect[3]);
+        quad.tr.texCoords = Tex2F(texRect[2], texRect[3]);
+
+        quad.bl.colors = quad.br.colors = quad.tl.colors = quad.tr.colors = color;
+    }
+}
+
+void InstancedSpriteBatchNode::draw(Renderer *renderer, const Mat4 &transform, uint32_t flags)
+{
+    if (_instances.empty() || _texture == nullptr)
+    {
+        return;
+    }
+
+    if (_instancedProgram)
+    {
+        _customCommand.init(_globalZOrder, transform, flags);
+        _customCommand.func = CC_CALLBACK_0(InstancedSpriteBatchNode::onDrawInstanced, this, transform, flags);
+        renderer->addCommand(&_customCommand);
+    }
+    else
+    {
+        if (_dirty)
+        {
+            fillQuads();
+            _dirty = false;
+        }
+
+        // the renderer takes fewer than VBO_SIZE vertices per QuadCommand
+        const ssize_t quadsPerCommand = Renderer::VBO_SIZE / 4 - 1;
+        ssize_t count = (ssize_t)_quads.size();
+        _quadCommands.resize((count + quadsPerCommand - 1) / quadsPerCommand);
+
+        for (size_t i = 0; i < _quadCommands.size(); ++i)
+        {
+            ssize_t first = i * quadsPerCommand;
+            ssize_t quads = std::min(quadsPerCommand, count - first);
+            _quadCommands[i].init(_globalZOrder, _texture->getName(), getGLProgramState(), _blendFunc, _quads.data() + first, quads, transform, flags);
+            renderer->addCommand(&_quadCommands[i]);
+        }
+    }
+}
+
+void InstancedSpriteBatchNode::onDrawInstanced(const Mat4 &transform, uint32_t flags)
+{
+#if CC_USE_GL_INSTANCING
+    _instancedProgram->use();
+    _instancedProgram->setUniformsForBuiltins(transform);
+
+    GL::blendFunc(_blendFunc.src, _blendFunc.dst);
+    GL::bindTexture2D(_texture->getName());
+
+    if (Configuration::getInstance()->supportsShareableVAO())
+    {
+        GL::bindVAO(0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, _buffersVBO[1]);
+    if (_dirty)
+    {
+        fillInstanceVertices();
+        glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceVertex) * _instanceVertices.size(), _instanceVertices.data(), GL_STREAM_DRAW);
+        _dirty = false;
+    }
+
+    GL::enableVertexAttribs((1 << _attribCorner) | (1 << _attribTransform) | (1 << _attribRotation) | (1 << _attribColor) | (1 << _attribTexRect));
+
+    // per instance
+    glVertexAttribPointer(_attribTransform, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), (GLvoid*) offsetof(InstanceVertex, transform));
+    glVertexAttribPointer(_attribRotation, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), (GLvoid*) offsetof(InstanceVertex, rotation));
+    glVertexAttribPointer(_attribColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceVertex), (GLvoid*) offsetof(InstanceVertex, color));
+    glVertexAttribPointer(_attribTexRect, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), (GLvoid*) offsetof(InstanceVertex, texRect));
+    glVertexAttribDivisor(_attribTransform, 1);
+    glVertexAttribDivisor(_attribRotation, 1);
+    glVertexAttribDivisor(_attribColor, 1);
+    glVertexAttribDivisor(_attribTexRect, 1);
+
+    // per vertex
+    glBindBuffer(GL_ARRAY_BUFFER, _buffersVBO[0]);
+    glVertexAttribPointer(_attribCorner, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) 0);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)_instances.size());
+
+    // the other commands use the same attribute locations without divisor
+    glVertexAttribDivisor(_attribTransform, 0);
+    glVertexAttribDivisor(_attribRotation, 0);
+    glVertexAttribDivisor(_attribColor, 0);
+    glVertexAttribDivisor(_attribTexRect, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(1, _instances.size() * 4);
+    CHECK_GL_ERROR_DEBUG();
+#endif
+}
+
+std::string InstancedSpriteBatchNode::getDescription() const
+{
+    return StringUtils::format("<InstancedSpriteBatchNode | tag = %d | instances = %d | instanced = %d>", _tag, (int)_instances.size(), _instancedProgram != nullptr);
+}
+
+NS_CC_END
@@ -0,0 +1,191 @@
+/****************************************************************************
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CC_INSTANCED_SPRITE_BATCH_NODE_H__
+#define __CC_INSTANCED_SPRITE_BATCH_NODE_H__
+
+#include <vector>
+
+#include "2d/CCNode.h"
+#include "base/CCProtocols.h"
+#include "renderer/CCCustomCommand.h"
+#include "renderer/CCQuadCommand.h"
+
+NS_CC_BEGIN
+
+class Texture2D;
+class GLProgram;
+
+/**
+ * @addtogroup _2d
+ * @{
+ */
+
+/** @class InstancedSpriteBatchNode
+ * @brief Draws many copies of one texture (petals, rain streaks, snow, grids of icons) without creating a Sprite for each.
+ *
+ * Every instance has its own position, scale, rotation, color and texture rect.
+ * When the context supports OpenGL 3.3 (see Configuration::supportsInstancing()) the instance data is uploaded
+ * to a VBO and all the instances are drawn with one glDrawArraysInstanced call, the GPU builds the quads.
+ * On OpenGL ES 2.0 the quads are built on the CPU and submitted with a QuadCommand, like Sprite does.
+ *
+ * The instances are not nodes: they are not visited, can't run actions and don't receive events.
+ * Update them from an update() callback with setInstance().
+ */
+class CC_DLL InstancedSpriteBatchNode : public Node, public TextureProtocol
+{
+    static const int DEFAULT_CAPACITY = 64;
+
+public:
+    /** The state of an instance, in the node space. */
+    struct Instance
+    {
+        /** The center of the quad. */
+        Vec2 position;
+        /** The scale applied to the size of the texture rect. */
+        Vec2 scale;
+        /** The clockwise rotation, in degrees. */
+        float rotation;
+        /** The color and opacity, multiplied by the displayed color of the node. */
+        Color4B color;
+        /** The rect of the texture, in points. A zero rect means the whole texture. */
+        Rect rect;
+
+        Instance();
+    };
+
+    /** Creates an InstancedSpriteBatchNode with a texture2d.
+     *
+     * @param tex A texture2d.
+     * @param capacity The number of instances to reserve memory for.
+     * @return Return an autorelease object.
+     */
+    static InstancedSpriteBatchNode* createWithTexture(Texture2D* tex, ssize_t capacity = DEFAULT_CAPACITY);
+
+    /** Creates an InstancedSpriteBatchNode with a file image (.png, .jpeg, .pvr, etc).
+     * The file will be loaded using the TextureCache.
+     *
+     * @param fileImage A file image (.png, .jpeg, .pvr, etc).
+     * @param capacity The number of instances to reserve memory for.
+     * @return Return an autorelease object.
+     */
+    static InstancedSpriteBatchNode* create(const std::string& fileImage, ssize_t capacity = DEFAULT_CAPACITY);
+
+    /** Adds an instance.
+     *
+     * @return The index of the new instance.
+     */
+    ssize_t addInstance(const Instance& instance);
+
+    /** Replaces the instance at a certain index. */
+    void setInstance(ssize_t index, const Instance& instance);
+
+    /** Returns the instance at a certain index. */
+    const Instance& getInstance(ssize_t index) const { return _instances[index]; }
+
+    /** Removes the instance at a certain index. The last instance takes its index. */
+    void removeInstance(ssize_t index);
+
+    /** Removes all the instances. */
+    void removeAllInstances();
+
+    /** Returns the number of instances. */
+    ssize_t getInstanceCount() const { return (ssize_t)_instances.size(); }
+
+    /** Whether the instances are drawn with glDrawArraysInstanced or with the QuadCommand fallback. */
+    bool isDrawingInstanced() const { return _instancedProgram != nullptr; }
+
+    // Overrides
+    virtual Texture2D* getTexture() const override { return _texture; }
+    virtual void setTexture(Texture2D *texture) override;
+    /**
+    * @code
+    * When this function bound into js or lua,the parameter will be changed
+    * In js: var setBlendFunc(var src, var dst)
+    * @endcode
+    * @lua NA 
+    */
+    virtual void setBlendFunc(const BlendFunc &blendFunc) override { _blendFunc = blendFunc; }
+    /**
+    * @js NA
+    * @lua NA
+    */
+    virtual const BlendFunc& getBlendFunc() const override { return _blendFunc; }
+    virtual void draw(Renderer *renderer, const Mat4 &transform, uint32_t flags) override;
+    virtual void updateDisplayedColor(const Color3B& parentColor) override;
+    virtual void updateDisplayedOpacity(GLubyte parentOpacity) override;
+    virtual std::string getDescription() const override;
+
+CC_CONSTRUCTOR_ACCESS:
+    InstancedSpriteBatchNode();
+    virtual ~InstancedSpriteBatchNode();
+
+    bool initWithTexture(Texture2D *tex, ssize_t capacity = DEFAULT_CAPACITY);
+    bool initWithFile(const std::string& fileImage, ssize_t capacity = DEFAULT_CAPACITY);
+
+protected:
+    // per instance attributes uploaded for glDrawArraysInstanced
+    struct InstanceVertex
+    {
+        GLfloat transform[4];   // center x, center y, width, height
+        GLfloat rotation[2];    // cos, sin
+        Color4B color;
+        GLfloat texRect[4];     // left, bottom, right, top
+    };
+
+    void setupInstancing();
+    void updateBlendFunc();
+    void onDrawInstanced(const Mat4 &transform, uint32_t flags);
+    void fillInstanceVertices();
+    void fillQuads();
+    void computeInstance(const Instance& instance, GLfloat* halfSize, GLfloat* texRect, Color4B* color) const;
+
+    Texture2D* _texture;
+    BlendFunc _blendFunc;
+    std::vector<Instance> _instances;
+    bool _dirty;
+
+    // instanced path
+    GLProgram* _instancedProgram;
+    GLint _attribCorner;
+    GLint _attribTransform;
+    GLint _attribRotation;
+    GLint _attribColor;
+    GLint _attribTexRect;
+    GLuint _buffersVBO[2]; //0: corners  1: instances
+    std::vector<InstanceVertex> _instanceVertices;
+    CustomCommand _customCommand;
+
+    // QuadCommand fallback, one command per renderer VBO worth of quads
+    std::vector<V3F_C4B_T2F_Quad> _quads;
+    std::vector<QuadCommand> _quadCommands;
+
+private:
+    CC_DISALLOW_COPY_AND_ASSIGN(InstancedSpriteBatchNode);
+};
+
+// end of _2d group
+/// @}
+
+NS_CC_END
+
+#endif // __CC_INSTANCED_SPRITE_BATCH_NODE_H__
@@ -41,6 +41,7 @@ cocos2d.cpp \
 2d/CCComponent.cpp \
 2d/CCComponentContainer.cpp \
 2d/CCDrawNode.cpp \
+2d/CCInstancedSpriteBatchNode.cpp \
 2d/CCDrawingPrimitives.cpp \
 2d/CCFastTMXLayer.cpp \
 2d/CCFastTMXTiledMap.cpp \
@@ -49,6 +49,7 @@ Configuration::Configuration()
 , _supportsBGRA8888(false)
 , _supportsDiscardFramebuffer(false)
 , _supportsShareableVAO(false)
+, _supportsInstancing(false)
 , _maxSamplesAllowed(0)
 , _maxTextureUnits(0)
 , _glExtensions(nullptr)
@@ -150,6 +151,17 @@ void Configuration::gatherGPUInfo()
     _supportsShareableVAO = checkForGLExtension("vertex_array_object");
 	_valueDict["gl.supports_vertex_array_object"] = Value(_supportsShareableVAO);
 
+#if CC_USE_GL_INSTANCING
+    // glVertexAttribDivisor is core since OpenGL 3.3
+    int glMajor = 0, glMinor = 0;
+    const char* glVersion = (const char*)glGetString(GL_VERSION);
+    if (glVersion && sscanf(glVersion, "%d.%d", &glMajor, &glMinor) == 2)
+    {
+        _supportsInstancing = glMajor > 3 || (glMajor == 3 && glMinor >= 3);
+    }
+#endif
+	_valueDict["gl.supports_instancing"] = Value(_supportsInstancing);
+
     CHECK_GL_ERROR_DEBUG();
 }
 
@@ -259,6 +271,11 @@ bool Configuration::supportsShareableVAO() const
 #endif
 }
 
+bool Configuration::supportsInstancing() const
+{
+    return _supportsInstancing;
+}
+
 int Configuration::getMaxSupportDirLightInShader() const
 {
     return _maxDirLightInShader;
@@ -145,6 +145,12 @@ public:
      * @since v2.0.0
      */
 	bool supportsShareableVAO() const;
+
+    /** Whether or not glDrawArraysInstanced and glVertexAttribDivisor can be used (OpenGL 3.3).
+     *
+     * @return Is true if supports instanced drawing.
+     */
+    bool supportsInstancing() const;
     
     /** Max support directional light in shader, for Sprite3D.
      *
@@ -232,6 +238,7 @@ protected:
     bool            _supportsBGRA8888;
     bool            _supportsDiscardFramebuffer;
     bool            _supportsShareableVAO;
+    bool            _supportsInstancing;
     GLint           _maxSamplesAllowed;
     GLint           _maxTextureUnits;
     char *          _glExtensions;
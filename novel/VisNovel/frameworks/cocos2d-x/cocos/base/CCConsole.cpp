@@ -30,6 +30,8 @@
 #include <cctype>
 #include <locale>
 #include <sstream>
+#include <map>
+#include <unordered_map>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -65,6 +67,7 @@
 #include "2d/CCScene.h"
 #include "platform/CCFileUtils.h"
 #include "renderer/CCTextureCache.h"
+#include "renderer/CCRenderer.h"
 #include "base/base64.h"
 #include "base/ccUtils.h"
 #include "base/allocator/CCAllocatorDiagnostics.h"
@@ -137,6 +140,21 @@ static void sendPrompt(int fd)
     send(fd, prompt, strlen(prompt),0);
 }
 
+// mydprintf() truncates its output, long reports are sent with this one
+static void sendString(int fd, const std::string& str)
+{
+    const char* ptr = str.c_str();
+    size_t left = str.size();
+    while (left > 0)
+    {
+        auto sent = send(fd, ptr, left, 0);
+        if (sent <= 0)
+            break;
+        ptr += sent;
+        left -= sent;
+    }
+}
+
 static int printSceneGraph(int fd, Node* node, int level)
 {
     int total = 1;
@@ -160,6 +178,72 @@ static void printSceneGraphBoot(int fd)
     sendPrompt(fd);
 }
 
+static void collectTextureOwners(Node* node, const std::string& owner, std::unordered_map<Texture2D*, std::string>& owners)
+{
+    auto textureNode = dynamic_cast<TextureProtocol*>(node);
+    if (textureNode && textureNode->getTexture())
+    {
+        // a texture shared by several owners is accounted to the first one
+        owners.insert(std::make_pair(textureNode->getTexture(), owner));
+    }
+
+    for (const auto& child : node->getChildren())
+        collectTextureOwners(child, owner, owners);
+}
+
+static void printTextureOwners(int fd)
+{
+    // owners are the direct children of the running scene
+    std::unordered_map<Texture2D*, std::string> owners;
+    auto scene = Director::getInstance()->getRunningScene();
+    if (scene)
+    {
+        for (const auto& child : scene->getChildren())
+        {
+            collectTextureOwners(child, child->getName().empty() ? child->getDescription() : child->getName(), owners);
+        }
+    }
+
+    struct OwnerInfo { int count; size_t bytes; };
+    std::map<std::string, OwnerInfo> groups;
+    auto textureCache = Director::getInstance()->getTextureCache();
+    size_t cachedOwnedBytes = 0;
+
+    for (const auto& it : owners)
+    {
+        auto tex = it.first;
+        size_t bytes = tex->getPixelsWide() * tex->getPixelsHigh() * tex->getBitsPerPixelForFormat() / 8;
+        auto& group = groups[it.second];
+        group.count++;
+        group.bytes += bytes;
+        if (!textureCache->getTextureFilePath(tex).empty())
+            cachedOwnedBytes += bytes;
+    }
+
+    std::vector<std::pair<std::string, OwnerInfo>> sorted(groups.begin(), groups.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, OwnerInfo>& a, const std::pair<std::string, OwnerInfo>& b) {
+        return a.second.bytes > b.second.bytes;
+    });
+
+    std::string buffer;
+    char buftmp[512];
+    for (const auto& group : sorted)
+    {
+        snprintf(buftmp, sizeof(buftmp), "%8lu KB %4d textures  %s\n", (unsigned long)(group.second.bytes / 1024), group.second.count, group.first.c_str());
+        buffer += buftmp;
+    }
+
+    size_t cachedBytes = textureCache->getCachedTextureBytes();
+    size_t unownedBytes = cachedBytes > cachedOwnedBytes ? cachedBytes - cachedOwnedBytes : 0;
+    snprintf(buftmp, sizeof(buftmp), "%8lu KB in TextureCache not used by the running scene\n", (unsigned long)(unownedBytes / 1024));
+    buffer += buftmp;
+    snprintf(buftmp, sizeof(buftmp), "TextureCache: %lu KB (%.2f MB)\n", (unsigned long)(cachedBytes / 1024), cachedBytes / (1024.0f*1024.0f));
+    buffer += buftmp;
+
+    sendString(fd, buffer);
+    sendPrompt(fd);
+}
+
 static void printFileUtils(int fd)
 {
     FileUtils* fu = FileUtils::getInstance();
@@ -347,9 +431,12 @@ Console::Console()
         } },
         { "help", "Print this message", std::bind(&Console::commandHelp, this, std::placeholders::_1, std::placeholders::_2) },
         { "projection", "Change or print the current projection. Args: [2d | 3d]", std::bind(&Console::commandProjection, this, std::placeholders::_1, std::placeholders::_2) },
+        { "renderer", "renderer commands, type -h or [renderer help] to list supported directives", std::bind(&Console::commandRenderer, this, std::placeholders::_1, std::placeholders::_2) },
         { "resolution", "Change or print the window resolution. Args: [width height resolution_policy | ]", std::bind(&Console::commandResolution, this, std::placeholders::_1, std::placeholders::_2) },
         { "scenegraph", "Print the scene graph", std::bind(&Console::commandSceneGraph, this, std::placeholders::_1, std::placeholders::_2) },
-        { "texture", "Flush or print the TextureCache info. Args: [flush | ] ", std::bind(&Console::commandTextures, this, std::placeholders::_1, std::placeholders::_2) },
+        { "scheduler", "Profile the scheduled callbacks. Args: [on | off | top [count] | ]", std::bind(&Console::commandScheduler, this, std::placeholders::_1, std::placeholders::_2) },
+        { "texture", "Flush or print the TextureCache info. Args: [flush | owner | ] ", std::bind(&Console::commandTextures, this, std::placeholders::_1, std::placeholders::_2) },
+        { "trace", "Record the frame timings, stop sends them in the chrome://tracing format. Args: [start | stop | ]", std::bind(&Console::commandTrace, this, std::placeholders::_1, std::placeholders::_2) },
         { "director", "director commands, type -h or [director help] to list supported directives", std::bind(&Console::commandDirector, this, std::placeholders::_1, std::placeholders::_2) },
         { "touch", "simulate touch event via console, type -h or [touch help] to list supported directives", std::bind(&Console::commandTouch, this, std::placeholders::_1, std::placeholders::_2) },
         { "upload", "upload file. Args: [filename base64_encoded_data]", std::bind(&Console::commandUpload, this, std::placeholders::_1) },
@@ -648,6 +735,10 @@ void Console::commandTextures(int fd, const std::string& args)
         }
                                             );
     }
+    else if( args.compare("owner")== 0)
+    {
+        sched->performFunctionInCocosThread( std::bind(&printTextureOwners, fd) );
+    }
     else if(args.empty())
     {
         sched->performFunctionInCocosThread( [=](){
@@ -658,7 +749,141 @@ void Console::commandTextures(int fd, const std::string& args)
     }
     else
     {
-        mydprintf(fd, "Unsupported argument: '%s'. Supported arguments: 'flush' or nothing", args.c_str());
+        mydprintf(fd, "Unsupported argument: '%s'. Supported arguments: 'flush', 'owner' or nothing", args.c_str());
+    }
+}
+
+void Console::commandTrace(int fd, const std::string& args)
+{
+    Scheduler *sched = Director::getInstance()->getScheduler();
+
+    if( args.compare("start")== 0)
+    {
+        sched->performFunctionInCocosThread( [](){
+            Director::getInstance()->startFrameTrace();
+        }
+                                            );
+    }
+    else if( args.compare("stop")== 0)
+    {
+        sched->performFunctionInCocosThread( [=](){
+            sendString(fd, Director::getInstance()->stopFrameTrace());
+            sendPrompt(fd);
+        }
+                                            );
+    }
+    else if(args.empty())
+    {
+        mydprintf(fd, "Frame trace is: %s\n", Director::getInstance()->isFrameTraceEnabled() ? "on" : "off");
+    }
+    else
+    {
+        mydprintf(fd, "Unsupported argument: '%s'. Supported arguments: 'start', 'stop' or nothing", args.c_str());
+    }
+}
+
+void Console::commandScheduler(int fd, const std::string& args)
+{
+    Scheduler *sched = Director::getInstance()->getScheduler();
+    auto argv = split(args, ' ');
+
+    if(args == "on" || args == "off")
+    {
+        bool state = (args == "on");
+        sched->performFunctionInCocosThread( [=](){
+            Director::getInstance()->getScheduler()->setProfilingEnabled(state);
+        }
+                                            );
+    }
+    else if(argv.size() >= 1 && argv[0] == "top")
+    {
+        int count = (argv.size() == 2 && isFloat(argv[1])) ? atoi(argv[1].c_str()) : 20;
+        sched->performFunctionInCocosThread( [=](){
+            auto scheduler = Director::getInstance()->getScheduler();
+            if (scheduler->isProfilingEnabled())
+                sendString(fd, scheduler->getSlowestCallbacksInfo(count));
+            else
+                mydprintf(fd, "Scheduler profiling is off, type 'scheduler on' first\n");
+            sendPrompt(fd);
+        }
+                                            );
+    }
+    else if(args.empty())
+    {
+        mydprintf(fd, "Scheduler profiling is: %s\n", sched->isProfilingEnabled() ? "on" : "off");
+    }
+    else
+    {
+        mydprintf(fd, "Unsupported argument: '%s'. Supported arguments: 'on', 'off', 'top [count]' or nothing", args.c_str());
+    }
+}
+
+void Console::commandRenderer(int fd, const std::string& args)
+{
+    auto director = Director::getInstance();
+    Scheduler *sched = director->getScheduler();
+    auto argv = split(args, ' ');
+
+    if(args == "help" || args == "-h")
+    {
+        const char help[] = "available renderer directives:\n"
+                            "\tstats, print the render commands of the last frame by type and material\n"
+                            "\tstats on|off, collect the render command stats\n"
+                            "\tbatching on|off, batch the quad and triangles commands\n"
+                            "\tondemand on|off, only render the scene when something changed\n";
+        send(fd, help, sizeof(help) - 1,0);
+    }
+    else if(argv.size() == 1 && argv[0] == "stats")
+    {
+        sched->performFunctionInCocosThread( [=](){
+            auto renderer = Director::getInstance()->getRenderer();
+            if (renderer->isCommandStatsEnabled())
+                sendString(fd, renderer->getCommandStatsInfo());
+            else
+                mydprintf(fd, "Render command stats are off, type 'renderer stats on' first\n");
+            sendPrompt(fd);
+        }
+                                            );
+    }
+    else if(argv.size() == 2 && (argv[1] == "on" || argv[1] == "off"))
+    {
+        bool state = (argv[1] == "on");
+        if(argv[0] == "stats")
+        {
+            sched->performFunctionInCocosThread( [=](){
+                Director::getInstance()->getRenderer()->setCommandStatsEnabled(state);
+            }
+                                                );
+        }
+        else if(argv[0] == "batching")
+        {
+            sched->performFunctionInCocosThread( [=](){
+                Director::getInstance()->getRenderer()->setBatchingEnabled(state);
+            }
+                                                );
+        }
+        else if(argv[0] == "ondemand")
+        {
+            sched->performFunctionInCocosThread( [=](){
+                Director::getInstance()->setRenderOnDemand(state);
+            }
+                                                );
+        }
+        else
+        {
+            mydprintf(fd, "Unsupported argument: '%s'. Type 'renderer help' to list supported directives\n", args.c_str());
+        }
+    }
+    else if(args.empty())
+    {
+        mydprintf(fd, "Render command stats: %s\nBatching: %s\nRender on demand: %s\n",
+                  director->getRenderer()->isCommandStatsEnabled() ? "on" : "off",
+                  director->getRenderer()->isBatchingEnabled() ? "on" : "off",
+                  director->isRenderOnDemand() ? "on" : "off");
+    }
+    else
+    {
+        mydprintf(fd, "Unsupported argument: '%s'. Type 'renderer help' to list supported directives\n", args.c_str());
     }
 }
 
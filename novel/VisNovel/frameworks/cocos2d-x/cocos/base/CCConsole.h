@@ -129,6 +129,9 @@ protected:
     void commandTouch(int fd, const std::string &args);
     void commandUpload(int fd);
     void commandAllocator(int fd, const std::string &args);
+    void commandTrace(int fd, const std::string &args);
+    void commandScheduler(int fd, const std::string &args);
+    void commandRenderer(int fd, const std::string &args);
     // file descriptor: socket, console, etc.
     int _listenfd;
     int _maxfd;
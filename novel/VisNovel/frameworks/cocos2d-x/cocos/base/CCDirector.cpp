@@ -91,6 +91,7 @@ const char *Director::EVENT_AFTER_DRAW = "director_after_draw";
 const char *Director::EVENT_AFTER_VISIT = "director_after_visit";
 const char *Director::EVENT_BEFORE_UPDATE = "director_before_update";
 const char *Director::EVENT_AFTER_UPDATE = "director_after_update";
+const char *Director::EVENT_RESET = "director_reset";
 
 Director* Director::getInstance()
 {
@@ -132,6 +133,13 @@ bool Director::init(void)
     // paused ?
     _paused = false;
 
+    // render on demand ?
+    _renderOnDemand = false;
+    _redrawRequested = true;
+
+    // frame trace
+    _frameTraceEnabled = false;
+
     // purge ?
     _purgeDirectorInNextLoop = false;
     
@@ -164,6 +172,8 @@ bool Director::init(void)
     _eventAfterUpdate->setUserData(this);
     _eventProjectionChanged = new (std::nothrow) EventCustom(EVENT_PROJECTION_CHANGED);
     _eventProjectionChanged->setUserData(this);
+    _eventResetDirector = new (std::nothrow) EventCustom(EVENT_RESET);
+    _eventResetDirector->setUserData(this);
     //init TextureCache
     initTextureCache();
     initMatrixStack();
@@ -193,6 +203,7 @@ Director::~Director(void)
     delete _eventAfterDraw;
     delete _eventAfterVisit;
     delete _eventProjectionChanged;
+    delete _eventResetDirector;
 
     delete _renderer;
 
@@ -266,6 +277,15 @@ void Director::drawScene()
         _openGLView->pollEvents();
     }
 
+    // "trace start" runs from the scheduler in the middle of a frame, so a
+    // frame is only recorded when tracing was already on as it began
+    const bool traceFrame = _frameTraceEnabled;
+    std::chrono::steady_clock::time_point frameStart, updateEnd, renderEnd;
+    if (traceFrame)
+    {
+        frameStart = std::chrono::steady_clock::now();
+    }
+
     //tick before glClear: issue #533
     if (! _paused)
     {
@@ -274,6 +294,33 @@ void Director::drawScene()
         _eventDispatcher->dispatchEvent(_eventAfterUpdate);
     }
 
+    if (traceFrame)
+    {
+        updateEnd = std::chrono::steady_clock::now();
+    }
+
+    // nothing changed: keep the last frame on screen, only the draw is skipped
+    if (_renderOnDemand && !_redrawRequested && !_nextScene && _actionManager->getNumberOfRunningActions() == 0)
+    {
+#if (CC_USE_PHYSICS || (CC_USE_3D_PHYSICS && CC_ENABLE_BULLET_INTEGRATION) || CC_USE_NAVMESH)
+        if (_runningScene)
+        {
+            _runningScene->stepPhysicsAndNavigation(_deltaTime);
+        }
+#endif
+        if (_displayStats)
+        {
+            calculateMPF();
+        }
+
+        if (traceFrame)
+        {
+            recordFrameTrace(frameStart, updateEnd, updateEnd, false);
+        }
+        return;
+    }
+    _redrawRequested = false;
+
     _renderer->clear();
     experimental::FrameBuffer::clearAllFBOs();
     /* to avoid flickr, nextScene MUST be here: after tick and before draw.
@@ -318,6 +365,11 @@ void Director::drawScene()
 
     _totalFrames++;
 
+    if (traceFrame)
+    {
+        renderEnd = std::chrono::steady_clock::now();
+    }
+
     // swap buffers
     if (_openGLView)
     {
@@ -328,6 +380,91 @@ void Director::drawScene()
     {
         calculateMPF();
     }
+
+    if (traceFrame)
+    {
+        recordFrameTrace(frameStart, updateEnd, renderEnd, true);
+    }
+}
+
+void Director::setRenderOnDemand(bool renderOnDemand)
+{
+    _renderOnDemand = renderOnDemand;
+    _redrawRequested = true;
+}
+
+// 10 minutes at 60 fps
+static const size_t FRAME_TRACE_MAX_FRAMES = 36000;
+
+void Director::startFrameTrace()
+{
+    _frameTrace.clear();
+    _frameTrace.reserve(1024);
+    _frameTraceStart = std::chrono::steady_clock::now();
+    _frameTraceEnabled = true;
+}
+
+void Director::recordFrameTrace(const std::chrono::steady_clock::time_point& frameStart,
+                                const std::chrono::steady_clock::time_point& updateEnd,
+                                const std::chrono::steady_clock::time_point& renderEnd,
+                                bool rendered)
+{
+    if (_frameTrace.size() >= FRAME_TRACE_MAX_FRAMES)
+        return;
+
+    typedef std::chrono::duration<double, std::micro> Microseconds;
+    auto now = std::chrono::steady_clock::now();
+
+    FrameTraceRecord record;
+    record.frame = _totalFrames;
+    record.start = Microseconds(frameStart - _frameTraceStart).count();
+    record.updateTime = Microseconds(updateEnd - frameStart).count();
+    record.renderTime = Microseconds(renderEnd - updateEnd).count();
+    record.swapTime = Microseconds(now - renderEnd).count();
+    record.drawnBatches = rendered ? _renderer->getDrawnBatches() : 0;
+    record.drawnVertices = rendered ? _renderer->getDrawnVertices() : 0;
+    record.rendered = rendered;
+    _frameTrace.push_back(record);
+}
+
+std::string Director::stopFrameTrace()
+{
+    _frameTraceEnabled = false;
+
+    std::string buffer = "{\"traceEvents\":[\n";
+    char buftmp[512];
+    bool first = true;
+
+    for (const auto& record : _frameTrace)
+    {
+        double updateStart = record.start;
+        double renderStart = updateStart + record.updateTime;
+        double swapStart = renderStart + record.renderTime;
+
+        snprintf(buftmp, sizeof(buftmp),
+                 "%s{\"name\":\"update\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"frame\":%u}}",
+                 first ? "" : ",\n", updateStart, record.updateTime, record.frame);
+        buffer += buftmp;
+        first = false;
+
+        if (!record.rendered)
+            continue;
+
+        snprintf(buftmp, sizeof(buftmp),
+                 ",\n{\"name\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"frame\":%u}}"
+                 ",\n{\"name\":\"swap\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"frame\":%u}}"
+                 ",\n{\"name\":\"draw\",\"ph\":\"C\",\"pid\":1,\"ts\":%.1f,\"args\":{\"batches\":%ld,\"vertices\":%ld}}",
+                 renderStart, record.renderTime, record.frame,
+                 swapStart, record.swapTime, record.frame,
+                 renderStart, (long)record.drawnBatches, (long)record.drawnVertices);
+        buffer += buftmp;
+    }
+
+    buffer += "\n]}\n";
+
+    _frameTrace.clear();
+    _frameTrace.shrink_to_fit();
+    return buffer;
 }
 
 void Director::calculateDeltaTime()
@@ -930,6 +1067,11 @@ void Director::reset()
     _runningScene = nullptr;
     _nextScene = nullptr;
 
+    if (_eventDispatcher)
+    {
+        _eventDispatcher->dispatchEvent(_eventResetDirector);
+    }
+
     // cleanup scheduler
     getScheduler()->unscheduleAll();
     
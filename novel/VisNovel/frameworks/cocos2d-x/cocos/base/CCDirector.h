@@ -30,6 +30,9 @@ THE SOFTWARE.
 
 #include <stack>
 #include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
 
 #include "platform/CCPlatformMacros.h"
 #include "base/CCRef.h"
@@ -106,6 +109,8 @@ public:
     static const char* EVENT_AFTER_VISIT;
     /** Director will trigger an event after a scene is drawn, the data is sent to GPU. */
     static const char* EVENT_AFTER_DRAW;
+    /** Director will trigger an event when it is reset by end() or restart(), before any cache is purged. */
+    static const char* EVENT_RESET;
 
     /**
      * @brief Possible OpenGL projections used by director
@@ -167,6 +172,29 @@ public:
     /** Get seconds per frame. */
     inline float getSecondsPerFrame() { return _secondsPerFrame; }
 
+    /** Whether or not the scene is only rendered when a redraw is needed. */
+    inline bool isRenderOnDemand() const { return _renderOnDemand; }
+    /**
+     * Enables or disables render on demand.
+     * When enabled the scheduler keeps ticking every frame, but the scene is only visited, rendered and swapped
+     * when a redraw was requested, the scene is replaced, actions are running or input events were dispatched.
+     * Code changing nodes outside of actions must call `requestRedraw()`.
+     * @note Only useful on platforms where the GLView owns the buffer swap (desktop), it saves power on static screens.
+     */
+    void setRenderOnDemand(bool renderOnDemand);
+    /** Requests the scene to be rendered in the next frame. Only needed when render on demand is enabled. */
+    inline void requestRedraw() { _redrawRequested = true; }
+
+    /** Starts recording the update, render and swap time and the draw stats of every frame. */
+    void startFrameTrace();
+    /** 
+     * Stops recording the frames.
+     * @return The recorded frames in the Chrome trace event format, can be loaded in chrome://tracing.
+     */
+    std::string stopFrameTrace();
+    /** Whether or not the frames are being recorded. */
+    inline bool isFrameTraceEnabled() const { return _frameTraceEnabled; }
+
     /** 
      * Get the GLView.
      * @lua NA
@@ -516,6 +544,12 @@ protected:
     /** calculates delta time since last time it was called */    
     void calculateDeltaTime();
 
+    /** records a frame of the trace started by startFrameTrace() */
+    void recordFrameTrace(const std::chrono::steady_clock::time_point& frameStart,
+                          const std::chrono::steady_clock::time_point& updateEnd,
+                          const std::chrono::steady_clock::time_point& renderEnd,
+                          bool rendered);
+
     //textureCache creation or release
     void initTextureCache();
     void destroyTextureCache();
@@ -540,7 +574,7 @@ protected:
      @since v3.0
      */
     EventDispatcher* _eventDispatcher;
-    EventCustom *_eventProjectionChanged, *_eventAfterDraw, *_eventAfterVisit, *_eventBeforeUpdate, *_eventAfterUpdate;
+    EventCustom *_eventProjectionChanged, *_eventAfterDraw, *_eventAfterVisit, *_eventBeforeUpdate, *_eventAfterUpdate, *_eventResetDirector;
         
     /* delta time since last tick to main loop */
 	float _deltaTime;
@@ -615,6 +649,26 @@ protected:
 
     bool _isStatusLabelUpdated;
 
+    /* render on demand */
+    bool _renderOnDemand;
+    bool _redrawRequested;
+
+    /* frame trace, times are in microseconds since the trace started */
+    struct FrameTraceRecord
+    {
+        unsigned int frame;
+        double start;
+        double updateTime;
+        double renderTime;
+        double swapTime;
+        ssize_t drawnBatches;
+        ssize_t drawnVertices;
+        bool rendered;
+    };
+    bool _frameTraceEnabled;
+    std::chrono::steady_clock::time_point _frameTraceStart;
+    std::vector<FrameTraceRecord> _frameTrace;
+
     /* cocos2d thread id */
     std::thread::id _cocos2d_thread_id;
 
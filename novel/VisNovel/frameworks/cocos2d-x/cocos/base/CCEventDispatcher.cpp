@@ -898,6 +898,13 @@ void EventDispatcher::dispatchEvent(Event* event)
     
     DispatchGuard guard(_inDispatch);
     
+    // input usually changes the scene, render it even when render on demand is enabled
+    auto eventType = event->getType();
+    if (eventType == Event::Type::TOUCH || eventType == Event::Type::MOUSE || eventType == Event::Type::KEYBOARD)
+    {
+        Director::getInstance()->requestRedraw();
+    }
+    
     if (event->getType() == Event::Type::TOUCH)
     {
         dispatchTouchEvent(static_cast<EventTouch*>(event));
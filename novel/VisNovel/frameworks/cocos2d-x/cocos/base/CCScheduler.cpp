@@ -32,6 +32,9 @@ THE SOFTWARE.
 #include "base/ccCArray.h"
 #include "base/CCScriptSupport.h"
 
+#include <algorithm>
+#include <typeinfo>
+
 NS_CC_BEGIN
 
 // data structures
@@ -256,6 +259,7 @@ Scheduler::Scheduler(void)
 #if CC_ENABLE_SCRIPT_BINDING
 , _scriptHandlerEntries(20)
 #endif
+, _profilingEnabled(false)
 {
     // I don't expect to have more than 30 functions to all per frame
     _functionsToPerform.reserve(30);
@@ -825,6 +829,100 @@ void Scheduler::performFunctionInCocosThread(const std::function<void ()> &funct
     _performMutex.unlock();
 }
 
+// profiling
+
+void Scheduler::setProfilingEnabled(bool enabled)
+{
+    _profilingEnabled = enabled;
+    _callbackProfiles.clear();
+}
+
+std::string Scheduler::getSlowestCallbacksInfo(int count) const
+{
+    std::vector<const CallbackProfile*> profiles;
+    profiles.reserve(_callbackProfiles.size());
+    for (const auto& it : _callbackProfiles)
+    {
+        profiles.push_back(&it.second);
+    }
+
+    std::sort(profiles.begin(), profiles.end(), [](const CallbackProfile* a, const CallbackProfile* b) {
+        return a->totalTime > b->totalTime;
+    });
+
+    std::string buffer;
+    char buftmp[512];
+    for (int i = 0; i < count && i < (int)profiles.size(); ++i)
+    {
+        const auto profile = profiles[i];
+        snprintf(buftmp, sizeof(buftmp), "%8.2f ms total %8u calls %8.3f ms avg %8.3f ms max  %s\n",
+                 profile->totalTime,
+                 profile->calls,
+                 profile->totalTime / profile->calls,
+                 profile->maxTime,
+                 profile->name.c_str());
+        buffer += buftmp;
+    }
+
+    snprintf(buftmp, sizeof(buftmp), "Scheduler profiling: %ld callbacks recorded\n", (long)_callbackProfiles.size());
+    buffer += buftmp;
+    return buffer;
+}
+
+void Scheduler::profileCallback(tListEntry *entry, const std::chrono::steady_clock::time_point& start)
+{
+    addCallbackTime(entry->target, [entry]() {
+        char name[64];
+        snprintf(name, sizeof(name), "update target=%p priority=%d", entry->target, entry->priority);
+        return std::string(name);
+    }, start);
+}
+
+void Scheduler::profileCallback(Timer *timer, const std::chrono::steady_clock::time_point& start)
+{
+    addCallbackTime(timer, [timer]() {
+        char name[256];
+        if (auto callbackTimer = dynamic_cast<TimerTargetCallback*>(timer))
+        {
+            snprintf(name, sizeof(name), "callback key=%s", callbackTimer->getKey().c_str());
+        }
+        else if (auto selectorTimer = dynamic_cast<TimerTargetSelector*>(timer))
+        {
+            snprintf(name, sizeof(name), "selector target=%s(%p)",
+                     selectorTimer->getTarget() ? typeid(*selectorTimer->getTarget()).name() : "null",
+                     selectorTimer->getTarget());
+        }
+#if CC_ENABLE_SCRIPT_BINDING
+        else if (auto scriptTimer = dynamic_cast<TimerScriptHandler*>(timer))
+        {
+            snprintf(name, sizeof(name), "script handler=%d", scriptTimer->getScriptHandler());
+        }
+#endif
+        else
+        {
+            snprintf(name, sizeof(name), "timer %p", timer);
+        }
+        return std::string(name);
+    }, start);
+}
+
+void Scheduler::addCallbackTime(const void *key, const std::function<std::string()>& name, const std::chrono::steady_clock::time_point& start)
+{
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto it = _callbackProfiles.find(key);
+    if (it == _callbackProfiles.end())
+    {
+        CallbackProfile profile = { name(), 0, 0.0, 0.0 };
+        it = _callbackProfiles.insert(std::make_pair(key, profile)).first;
+    }
+
+    auto& profile = it->second;
+    profile.calls++;
+    profile.totalTime += elapsed;
+    profile.maxTime = std::max(profile.maxTime, elapsed);
+}
+
 // main loop
 void Scheduler::update(float dt)
 {
@@ -835,6 +933,10 @@ void Scheduler::update(float dt)
         dt *= _timeScale;
     }
 
+    // read once, the flag may be toggled by a callback
+    bool profiling = _profilingEnabled;
+    std::chrono::steady_clock::time_point start;
+
     //
     // Selector callbacks
     //
@@ -847,7 +949,9 @@ void Scheduler::update(float dt)
     {
         if ((! entry->paused) && (! entry->markedForDeletion))
         {
+            if (profiling) start = std::chrono::steady_clock::now();
             entry->callback(dt);
+            if (profiling) profileCallback(entry, start);
         }
     }
 
@@ -856,7 +960,9 @@ void Scheduler::update(float dt)
     {
         if ((! entry->paused) && (! entry->markedForDeletion))
         {
+            if (profiling) start = std::chrono::steady_clock::now();
             entry->callback(dt);
+            if (profiling) profileCallback(entry, start);
         }
     }
 
@@ -865,7 +971,9 @@ void Scheduler::update(float dt)
     {
         if ((! entry->paused) && (! entry->markedForDeletion))
         {
+            if (profiling) start = std::chrono::steady_clock::now();
             entry->callback(dt);
+            if (profiling) profileCallback(entry, start);
         }
     }
 
@@ -883,7 +991,9 @@ void Scheduler::update(float dt)
                 elt->currentTimer = (Timer*)(elt->timers->arr[elt->timerIndex]);
                 elt->currentTimerSalvaged = false;
 
+                if (profiling) start = std::chrono::steady_clock::now();
                 elt->currentTimer->update(dt);
+                if (profiling) profileCallback(elt->currentTimer, start);
 
                 if (elt->currentTimerSalvaged)
                 {
@@ -956,7 +1066,9 @@ void Scheduler::update(float dt)
             }
             else if (!eachEntry->isPaused())
             {
+                if (profiling) start = std::chrono::steady_clock::now();
                 eachEntry->getTimer()->update(dt);
+                if (profiling) profileCallback(eachEntry->getTimer(), start);
             }
         }
     }
@@ -31,6 +31,9 @@ THE SOFTWARE.
 #include <functional>
 #include <mutex>
 #include <set>
+#include <chrono>
+#include <string>
+#include <unordered_map>
 
 #include "base/CCRef.h"
 #include "base/CCVector.h"
@@ -85,6 +88,7 @@ public:
     bool initWithSelector(Scheduler* scheduler, SEL_SCHEDULE selector, Ref* target, float seconds, unsigned int repeat, float delay);
     
     inline SEL_SCHEDULE getSelector() const { return _selector; };
+    inline Ref* getTarget() const { return _target; };
     
     virtual void trigger(float dt) override;
     virtual void cancel() override;
@@ -429,6 +433,24 @@ public:
      @js NA
      */
     void performFunctionInCocosThread( const std::function<void()> &function);
+
+    /** Enables or disables measuring the time spent in every scheduled callback.
+     Enabling it resets the collected statistics. It is used by the Console 'scheduler' command.
+     @param enabled True to time the callbacks.
+     @js NA
+     */
+    void setProfilingEnabled(bool enabled);
+
+    /** Returns whether or not the scheduled callbacks are being timed.
+     @js NA
+     */
+    bool isProfilingEnabled() const { return _profilingEnabled; }
+
+    /** Returns a report of the scheduled callbacks that took the most time since the profiling was enabled.
+     @param count The maximum number of callbacks in the report.
+     @js NA
+     */
+    std::string getSlowestCallbacksInfo(int count) const;
     
     /////////////////////////////////////
     
@@ -507,6 +529,12 @@ protected:
     void priorityIn(struct _listEntry **list, const ccSchedulerFunc& callback, void *target, int priority, bool paused);
     void appendIn(struct _listEntry **list, const ccSchedulerFunc& callback, void *target, bool paused);
 
+    // profiling specific
+
+    void profileCallback(struct _listEntry *entry, const std::chrono::steady_clock::time_point& start);
+    void profileCallback(Timer *timer, const std::chrono::steady_clock::time_point& start);
+    void addCallbackTime(const void *key, const std::function<std::string()>& name, const std::chrono::steady_clock::time_point& start);
+
 
     float _timeScale;
 
@@ -532,6 +560,17 @@ protected:
     // Used for "perform Function"
     std::vector<std::function<void()>> _functionsToPerform;
     std::mutex _performMutex;
+
+    // Used for profiling the callbacks, keyed by update target or timer
+    struct CallbackProfile
+    {
+        std::string name;
+        unsigned int calls;
+        double totalTime;
+        double maxTime;
+    };
+    bool _profilingEnabled;
+    std::unordered_map<const void*, CallbackProfile> _callbackProfiles;
 };
 
 // end of base group
@@ -172,6 +172,20 @@ THE SOFTWARE.
 #endif
 
 
+/** @def CC_USE_GL_INSTANCING
+ * If enabled, InstancedSpriteBatchNode draws all its instances with a single glDrawArraysInstanced call
+ * when the context supports OpenGL 3.3. Otherwise it falls back to a batched QuadCommand.
+ * The mobile platforms are built against the OpenGL ES 2.0 headers, so it is only enabled on desktop by default.
+ * To disable it set it to 0.
+ */
+#ifndef CC_USE_GL_INSTANCING
+    #if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+        #define CC_USE_GL_INSTANCING 1
+    #else
+        #define CC_USE_GL_INSTANCING 0
+    #endif
+#endif
+
 /** @def CC_USE_LA88_LABELS
  * If enabled, it will use LA88 (Luminance Alpha 16-bit textures) for LabelTTF objects.
  * If it is disabled, it will use A8 (Alpha 8-bit textures).
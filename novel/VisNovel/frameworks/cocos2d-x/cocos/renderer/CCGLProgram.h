@@ -157,6 +157,8 @@ public:
     static const char* SHADER_NAME_POSITION_TEXTURE_COLOR;
     /**Built in shader for 2d. Support Position, Texture and Color vertex attribute, but without multiply vertex by MVP matrix.*/
     static const char* SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP;
+    /**Built in shader for 2d instanced quads, used by InstancedSpriteBatchNode. Only loaded when instancing is supported.*/
+    static const char* SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED;
     /**Built in shader for 2d. Support Position, Texture vertex attribute, but include alpha test.*/
     static const char* SHADER_NAME_POSITION_TEXTURE_ALPHA_TEST;
     /**Built in shader for 2d. Support Position, Texture and Color vertex attribute, include alpha test and without multiply vertex by MVP matrix.*/
@@ -177,6 +179,8 @@ public:
     static const char* SHADER_NAME_POSITION_U_COLOR;
     /**Built in shader for draw a sector with 90 degrees with center at bottom left point.*/
     static const char* SHADER_NAME_POSITION_LENGTH_TEXTURE_COLOR;
+    /**Built in shader for DrawNode triangles batched by the renderer, without MVP matrix.*/
+    static const char* SHADER_NAME_POSITION_LENGTH_TEXTURE_COLOR_NO_MVP;
 
     /**Built in shader for ui effects */
     static const char* SHADER_NAME_POSITION_GRAYSCALE;
@@ -207,6 +207,10 @@ Renderer::Renderer()
 ,_filledIndex(0)
 ,_numberQuads(0)
 ,_glViewAssigned(false)
+,_drawnBatches(0)
+,_drawnVertices(0)
+,_commandStatsEnabled(false)
+,_batchingEnabled(true)
 ,_isRendering(false)
 ,_isDepthTestFor2D(false)
 #if CC_ENABLE_CACHE_TEXTURE_DATA
@@ -415,6 +419,18 @@ int Renderer::createRenderQueue()
 void Renderer::processRenderCommand(RenderCommand* command)
 {
     auto commandType = command->getType();
+    if (_commandStatsEnabled)
+    {
+        uint32_t materialID = 0;
+        if (RenderCommand::Type::TRIANGLES_COMMAND == commandType)
+            materialID = static_cast<TrianglesCommand*>(command)->getMaterialID();
+        else if (RenderCommand::Type::QUAD_COMMAND == commandType)
+            materialID = static_cast<QuadCommand*>(command)->getMaterialID();
+        else if (RenderCommand::Type::MESH_COMMAND == commandType)
+            materialID = static_cast<MeshCommand*>(command)->getMaterialID();
+        _commandStats[((uint64_t)commandType << 32) | materialID]++;
+    }
+
     if( RenderCommand::Type::TRIANGLES_COMMAND == commandType)
     {
         //Draw if we have batched other commands which are not triangle command
@@ -423,9 +439,10 @@ void Renderer::processRenderCommand(RenderCommand* command)
         
         //Process triangle command
         auto cmd = static_cast<TrianglesCommand*>(command);
+        bool skipBatching = cmd->isSkipBatching() || !_batchingEnabled;
         
         //Draw batched Triangles if necessary
-        if(cmd->isSkipBatching() || _filledVertex + cmd->getVertexCount() > VBO_SIZE || _filledIndex + cmd->getIndexCount() > INDEX_VBO_SIZE)
+        if(skipBatching || _filledVertex + cmd->getVertexCount() > VBO_SIZE || _filledIndex + cmd->getIndexCount() > INDEX_VBO_SIZE)
         {
             CCASSERT(cmd->getVertexCount()>= 0 && cmd->getVertexCount() < VBO_SIZE, "VBO for vertex is not big enough, please break the data down or use customized render command");
             CCASSERT(cmd->getIndexCount()>= 0 && cmd->getIndexCount() < INDEX_VBO_SIZE, "VBO for index is not big enough, please break the data down or use customized render command");
@@ -438,7 +455,7 @@ void Renderer::processRenderCommand(RenderCommand* command)
         
         fillVerticesAndIndices(cmd);
         
-        if(cmd->isSkipBatching())
+        if(skipBatching)
         {
             drawBatchedTriangles();
         }
@@ -452,9 +469,10 @@ void Renderer::processRenderCommand(RenderCommand* command)
         
         //Process quad command
         auto cmd = static_cast<QuadCommand*>(command);
+        bool skipBatching = cmd->isSkipBatching() || !_batchingEnabled;
         
         //Draw batched quads if necessary
-        if(cmd->isSkipBatching()|| (_numberQuads + cmd->getQuadCount()) * 4 > VBO_SIZE )
+        if(skipBatching || (_numberQuads + cmd->getQuadCount()) * 4 > VBO_SIZE )
         {
             CCASSERT(cmd->getQuadCount()>= 0 && cmd->getQuadCount() * 4 < VBO_SIZE, "VBO for vertex is not big enough, please break the data down or use customized render command");
             //Draw batched quads if VBO is full
@@ -466,7 +484,7 @@ void Renderer::processRenderCommand(RenderCommand* command)
         
         fillQuads(cmd);
         
-        if(cmd->isSkipBatching())
+        if(skipBatching)
         {
             drawBatchedQuads();
         }
@@ -750,6 +768,40 @@ void Renderer::clear()
     RenderState::StateBlock::_defaultState->setDepthWrite(false);
 }
 
+void Renderer::setCommandStatsEnabled(bool enabled)
+{
+    _commandStatsEnabled = enabled;
+    _commandStats.clear();
+}
+
+std::string Renderer::getCommandStatsInfo() const
+{
+    static const char* typeNames[] = {
+        "unknown", "quad", "custom", "batch", "group", "mesh", "primitive", "triangles"
+    };
+
+    std::string buffer;
+    char buftmp[256];
+    unsigned int total = 0;
+
+    for (const auto& stat : _commandStats)
+    {
+        auto type = (size_t)(stat.first >> 32);
+        auto materialID = (uint32_t)(stat.first & 0xffffffff);
+        snprintf(buftmp, sizeof(buftmp), "%-10s material=%-10u %u\n",
+                 type < sizeof(typeNames)/sizeof(typeNames[0]) ? typeNames[type] : "?",
+                 materialID,
+                 stat.second);
+        buffer += buftmp;
+        total += stat.second;
+    }
+
+    snprintf(buftmp, sizeof(buftmp), "Render commands: %u in %ld groups, %ld draw calls, %ld vertices\n",
+             total, (long)_commandStats.size(), (long)_drawnBatches, (long)_drawnVertices);
+    buffer += buftmp;
+    return buffer;
+}
+
 void Renderer::setDepthTest(bool enable)
 {
     if (enable)
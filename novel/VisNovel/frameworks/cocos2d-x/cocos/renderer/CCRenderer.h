@@ -28,6 +28,8 @@
 
 #include <vector>
 #include <stack>
+#include <map>
+#include <string>
 
 #include "platform/CCPlatformMacros.h"
 #include "renderer/CCRenderCommand.h"
@@ -175,7 +177,22 @@ public:
     /* RenderCommands (except) QuadCommand should update this value */
     void addDrawnVertices(ssize_t number) { _drawnVertices += number; };
     /* clear draw stats */
-    void clearDrawStats() { _drawnBatches = _drawnVertices = 0; }
+    void clearDrawStats() { _drawnBatches = _drawnVertices = 0; if (_commandStatsEnabled) _commandStats.clear(); }
+
+    /** Enable/Disable counting the processed render commands per type and material id. Used by the Console. */
+    void setCommandStatsEnabled(bool enabled);
+    /** returns whether the render command statistics are collected */
+    bool isCommandStatsEnabled() const { return _commandStatsEnabled; }
+    /** returns the render commands processed since the last `clearDrawStats()`, grouped by type and material id */
+    std::string getCommandStatsInfo() const;
+
+    /**
+     * Enable/Disable batching of QuadCommand and TrianglesCommand.
+     * When disabled every command is drawn with its own draw call, which is useful to measure the benefit of batching.
+     */
+    void setBatchingEnabled(bool enabled) { _batchingEnabled = enabled; }
+    /** returns whether QuadCommand and TrianglesCommand are batched */
+    bool isBatchingEnabled() const { return _batchingEnabled; }
 
     /**
      * Enable/Disable depth test
@@ -250,6 +267,10 @@ protected:
     // stats
     ssize_t _drawnBatches;
     ssize_t _drawnVertices;
+    // render command stats: key is (type << 32 | material id)
+    bool _commandStatsEnabled;
+    std::map<uint64_t, unsigned int> _commandStats;
+    bool _batchingEnabled;
     //the flag for checking whether renderer is rendering
     bool _isRendering;
     
@@ -598,6 +598,17 @@ std::string TextureCache::getCachedTextureInfo() const
     return buffer;
 }
 
+size_t TextureCache::getCachedTextureBytes() const
+{
+    size_t totalBytes = 0;
+    for (const auto& texture : _textures)
+    {
+        Texture2D* tex = texture.second;
+        totalBytes += tex->getPixelsWide() * tex->getPixelsHigh() * tex->getBitsPerPixelForFormat() / 8;
+    }
+    return totalBytes;
+}
+
 #if CC_ENABLE_CACHE_TEXTURE_DATA
 
 std::list<VolatileTexture*> VolatileTextureMgr::_textures;
@@ -191,6 +191,9 @@ public:
     */
     std::string getCachedTextureInfo() const;
 
+    /** Returns the memory used by all the cached textures, in bytes. */
+    size_t getCachedTextureBytes() const;
+
     //Wait for texture cache to quit before destroy instance.
     /**Called by director, please do not called outside.*/
     void waitForQuit();
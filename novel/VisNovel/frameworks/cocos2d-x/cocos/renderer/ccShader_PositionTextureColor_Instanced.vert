@@ -0,0 +1,52 @@
+/****************************************************************************
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+// one quad per instance: a_corner is the per vertex corner (0..1) of the quad,
+// the a_instance* attributes advance once per instance (glVertexAttribDivisor)
+const char* ccPositionTextureColor_Instanced_vert = STRINGIFY(
+attribute vec2 a_corner;
+attribute vec4 a_instanceTransform;
+attribute vec2 a_instanceRotation;
+attribute vec4 a_instanceColor;
+attribute vec4 a_instanceTexRect;
+
+\n#ifdef GL_ES\n
+varying lowp vec4 v_fragmentColor;
+varying mediump vec2 v_texCoord;
+\n#else\n
+varying vec4 v_fragmentColor;
+varying vec2 v_texCoord;
+\n#endif\n
+
+void main()
+{
+    // a_instanceTransform: center x, center y, width, height
+    // a_instanceRotation: cos, sin of the clockwise rotation
+    vec2 local = (a_corner - vec2(0.5, 0.5)) * a_instanceTransform.zw;
+    vec2 rotated = vec2(local.x * a_instanceRotation.x + local.y * a_instanceRotation.y,
+                        local.y * a_instanceRotation.x - local.x * a_instanceRotation.y);
+    gl_Position = CC_MVPMatrix * vec4(rotated + a_instanceTransform.xy, 0.0, 1.0);
+    v_fragmentColor = a_instanceColor;
+    // a_instanceTexRect: left, bottom, right, top
+    v_texCoord = mix(a_instanceTexRect.xy, a_instanceTexRect.zw, a_corner);
+}
+);
@@ -58,6 +58,9 @@ NS_CC_BEGIN
 #include "ccShader_PositionTextureColor_noMVP.frag"
 #include "ccShader_PositionTextureColor_noMVP.vert"
 
+//
+#include "ccShader_PositionTextureColor_Instanced.vert"
+
 //
 #include "ccShader_PositionTextureColorAlphaTest.frag"
 
@@ -67,6 +70,7 @@ NS_CC_BEGIN
 
 #include "ccShader_PositionColorLengthTexture.frag"
 #include "ccShader_PositionColorLengthTexture.vert"
+#include "ccShader_PositionColorLengthTexture_noMVP.vert"
 
 #include "ccShader_UI_Gray.frag"
 //
@@ -58,6 +58,8 @@ extern CC_DLL const GLchar * ccPositionTextureColor_vert;
 extern CC_DLL const GLchar * ccPositionTextureColor_noMVP_frag;
 extern CC_DLL const GLchar * ccPositionTextureColor_noMVP_vert;
 
+extern CC_DLL const GLchar * ccPositionTextureColor_Instanced_vert;
+
 extern CC_DLL const GLchar * ccPositionTextureColorAlphaTest_frag;
 
 extern CC_DLL const GLchar * ccPositionTexture_uColor_frag;
@@ -65,6 +67,7 @@ extern CC_DLL const GLchar * ccPositionTexture_uColor_vert;
 
 extern CC_DLL const GLchar * ccPositionColorLengthTexture_frag;
 extern CC_DLL const GLchar * ccPositionColorLengthTexture_vert;
+extern CC_DLL const GLchar * ccPositionColorLengthTexture_noMVP_vert;
 
 extern CC_DLL const GLchar * ccPositionTexture_GrayScale_frag;
 
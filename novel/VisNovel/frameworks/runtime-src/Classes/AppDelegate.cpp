@@ -23,6 +23,9 @@
 #include "AudioEngine.h"
 
 #include "AsyncLoaderManager.h"
+#include "TextureStreamer.h"
+#include "ThumbnailAtlas.h"
+#include "AssetBinary.h"
 
 using namespace CocosDenshion;
 
@@ -106,6 +109,9 @@ AppDelegate::~AppDelegate()
 	if (FileUtils::getInstance()->isDirectoryExist(path + "tmp/"))
 		FileUtils::getInstance()->removeDirectory(path + "tmp/");
 	AsyncLoaderManager::purge();
+	TextureStreamer::purge();
+	ThumbnailAtlas::purge();
+	AssetBinary::purge();
 }
 
 //if you want a different context,just modify the value of glContextAttrs
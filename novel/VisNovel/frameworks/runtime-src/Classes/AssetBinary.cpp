@@ -0,0 +1,222 @@
+#include "AssetBinary.h"
+
+AssetBinary* assetBinaryInst = nullptr;
+AssetBinary* AssetBinary::getInstance(){
+	if (assetBinaryInst == nullptr){
+		assetBinaryInst = new AssetBinary;
+	}
+	return assetBinaryInst;
+}
+
+bool AssetBinary::hasInstance(){
+	return assetBinaryInst != nullptr;
+}
+
+void AssetBinary::purge(){
+	delete assetBinaryInst;
+	assetBinaryInst = nullptr;
+}
+
+AssetBinary::AssetBinary(){
+}
+
+AssetBinary::~AssetBinary(){
+	clear();
+}
+
+const PiniAsset::Asset* AssetBinary::getAsset(const std::string& filename){
+	auto it = _files.find(filename);
+	if (it != _files.end()){
+		return PiniAsset::GetAsset(it->second.getBytes());
+	}
+
+	Data data = FileUtils::getInstance()->getDataFromFile(filename);
+	if (data.isNull()){
+		CCLOG("AssetBinary: can't read %s", filename.c_str());
+		return nullptr;
+	}
+
+	// checked once here so every later access can trust the offsets
+	flatbuffers::Verifier verifier(data.getBytes(), data.getSize());
+	if (!PiniAsset::AssetBufferHasIdentifier(data.getBytes()) || !PiniAsset::VerifyAssetBuffer(verifier)){
+		CCLOG("AssetBinary: %s is not an asset file", filename.c_str());
+		return nullptr;
+	}
+
+	const PiniAsset::Asset* asset = PiniAsset::GetAsset(data.getBytes());
+	if (asset->version() > ASSET_BINARY_VERSION){
+		CCLOG("AssetBinary: %s is version %d, this build reads %d", filename.c_str(), asset->version(), ASSET_BINARY_VERSION);
+		return nullptr;
+	}
+
+	Data& stored = _files[filename];
+	stored = std::move(data);
+	return PiniAsset::GetAsset(stored.getBytes());
+}
+
+static Color4F toColor(const PiniAsset::Color* c){
+	return c ? Color4F(c->r(), c->g(), c->b(), c->a()) : Color4F(0, 0, 0, 0);
+}
+
+static Vec2 toVec2(const PiniAsset::Vec2* v){
+	return v ? Vec2(v->x(), v->y()) : Vec2::ZERO;
+}
+
+// images sit next to the file that names them
+static std::string directoryOf(const std::string& filename){
+	size_t slash = filename.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+}
+
+ParticleSystemQuad* AssetBinary::createParticle(const std::string& filename){
+	const PiniAsset::Asset* asset = getAsset(filename);
+	if (asset == nullptr || asset->particle() == nullptr){
+		return nullptr;
+	}
+
+	const PiniAsset::Particle* p = asset->particle();
+	ParticleSystemQuad* ps = ParticleSystemQuad::createWithTotalParticles(p->total_particles());
+	if (ps == nullptr){
+		return nullptr;
+	}
+
+	ps->setDuration(p->duration());
+	ps->setEmissionRate(p->emission_rate());
+	ps->setSourcePosition(toVec2(p->source_position()));
+	ps->setPosVar(toVec2(p->position_var()));
+
+	ps->setEmitterMode(ParticleSystem::Mode::GRAVITY);
+	ps->setGravity(toVec2(p->gravity()));
+	ps->setSpeed(p->speed());
+	ps->setSpeedVar(p->speed_var());
+	ps->setTangentialAccel(p->tangential_accel());
+	ps->setTangentialAccelVar(p->tangential_accel_var());
+	ps->setRadialAccel(p->radial_accel());
+	ps->setRadialAccelVar(p->radial_accel_var());
+	ps->setRotationIsDir(p->rotation_is_dir() != 0);
+
+	ps->setAngle(p->angle());
+	ps->setAngleVar(p->angle_var());
+	ps->setLife(p->life());
+	ps->setLifeVar(p->life_var());
+
+	ps->setStartSize(p->start_size());
+	ps->setStartSizeVar(p->start_size_var());
+	ps->setEndSize(p->end_size());
+	ps->setEndSizeVar(p->end_size_var());
+
+	ps->setStartColor(toColor(p->start_color()));
+	ps->setStartColorVar(toColor(p->start_color_var()));
+	ps->setEndColor(toColor(p->end_color()));
+	ps->setEndColorVar(toColor(p->end_color_var()));
+
+	ps->setStartSpin(p->start_spin());
+	ps->setStartSpinVar(p->start_spin_var());
+	ps->setEndSpin(p->end_spin());
+	ps->setEndSpinVar(p->end_spin_var());
+
+	if (p->texture() && p->texture()->size() > 0){
+		Texture2D* texture = Director::getInstance()->getTextureCache()->addImage(directoryOf(filename) + p->texture()->c_str());
+		if (texture){
+			ps->setTexture(texture);
+		}
+	}
+
+	// after the texture, which would otherwise pick its own default
+	BlendFunc blend = { (GLenum)p->blend_src(), (GLenum)p->blend_dst() };
+	ps->setBlendFunc(blend);
+
+	return ps;
+}
+
+const PiniAsset::Actor* AssetBinary::getActor(const std::string& filename, const std::string& name){
+	const PiniAsset::Asset* asset = getAsset(filename);
+	if (asset == nullptr || asset->actors() == nullptr){
+		return nullptr;
+	}
+
+	for (flatbuffers::uoffset_t i = 0; i < asset->actors()->size(); i++){
+		const PiniAsset::Actor* actor = asset->actors()->Get(i);
+		if (actor->name() && name == actor->name()->c_str()){
+			return actor;
+		}
+	}
+	return nullptr;
+}
+
+Node* AssetBinary::createActorState(const std::string& filename, const std::string& actor, const std::string& state){
+	const PiniAsset::Actor* a = getActor(filename, actor);
+	if (a == nullptr || a->states() == nullptr){
+		return nullptr;
+	}
+
+	const PiniAsset::State* s = nullptr;
+	for (flatbuffers::uoffset_t i = 0; i < a->states()->size(); i++){
+		const PiniAsset::State* candidate = a->states()->Get(i);
+		if (candidate->name() && state == candidate->name()->c_str()){
+			s = candidate;
+			break;
+		}
+	}
+	if (s == nullptr){
+		CCLOG("AssetBinary: %s has no state %s for %s", filename.c_str(), state.c_str(), actor.c_str());
+		return nullptr;
+	}
+
+	Node* node = Node::create();
+	if (s->layers()){
+		for (flatbuffers::uoffset_t i = 0; i < s->layers()->size(); i++){
+			Sprite* layer = createActorLayer(filename, s->layers()->Get(i));
+			if (layer){
+				node->addChild(layer);
+			}
+		}
+	}
+	return node;
+}
+
+Sprite* AssetBinary::createActorLayer(const std::string& filename, const PiniAsset::Layer* layer){
+	if (layer == nullptr || layer->name() == nullptr){
+		return nullptr;
+	}
+
+	std::string path = directoryOf(filename) + layer->name()->c_str();
+	Texture2D* texture = Director::getInstance()->getTextureCache()->addImage(path);
+	if (texture == nullptr){
+		return nullptr;
+	}
+
+	Sprite* sprite = Sprite::createWithTexture(texture);
+	sprite->setName(layer->name()->c_str());
+
+	// drawn at the size the tool saw, even if the image was scaled since
+	Vec2 sizeScale(1, 1);
+	const Size& textureSize = texture->getContentSize();
+	if (layer->width() > 0 && layer->height() > 0 && textureSize.width > 0 && textureSize.height > 0){
+		sizeScale.set(layer->width() / textureSize.width, layer->height() / textureSize.height);
+	}
+
+	const PiniAsset::KeyFrame* frame = nullptr;
+	if (layer->key_frames() && layer->key_frames()->size() > 0){
+		frame = layer->key_frames()->Get(0);
+	}
+
+	if (frame){
+		sprite->setPosition(toVec2(&frame->position()));
+		sprite->setRotation(frame->rotation());
+		sprite->setScale(frame->scale().x() * sizeScale.x, frame->scale().y() * sizeScale.y);
+	}
+	else {
+		sprite->setScale(sizeScale.x, sizeScale.y);
+	}
+
+	return sprite;
+}
+
+void AssetBinary::remove(const std::string& filename){
+	_files.erase(filename);
+}
+
+void AssetBinary::clear(){
+	_files.clear();
+}
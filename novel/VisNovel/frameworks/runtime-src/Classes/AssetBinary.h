@@ -0,0 +1,43 @@
+#ifndef _ASSET_BINARY_H_
+#define _ASSET_BINARY_H_
+
+#include "cocos2d.h"
+#include "AssetBinaryFormat.h"
+
+using namespace std;
+using namespace cocos2d;
+
+// Particle and character definitions exported by the Qt tools as
+// flatbuffers (see AssetBinary.fbs). A file is read once, checked, and
+// then used straight from memory: creating an effect copies a few dozen
+// numbers into a ParticleSystemQuad, there is no text or key lookup.
+
+class AssetBinary{
+private:
+	std::unordered_map<string, Data> _files;
+
+	AssetBinary();
+	~AssetBinary();
+
+public:
+	// nullptr if the file is missing, damaged or from a newer exporter
+	const PiniAsset::Asset* getAsset(const std::string& filename);
+
+	ParticleSystemQuad* createParticle(const std::string& filename);
+	const PiniAsset::Actor* getActor(const std::string& filename, const std::string& name);
+
+	// A node holding the layers of an actor's state in drawing order, each
+	// a sprite named after its image and posed at its first key frame.
+	Node* createActorState(const std::string& filename, const std::string& actor, const std::string& state);
+	Sprite* createActorLayer(const std::string& filename, const PiniAsset::Layer* layer);
+
+	void remove(const std::string& filename);
+	void clear();
+
+public:
+	static AssetBinary* getInstance();
+	static bool hasInstance();
+	static void purge();
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _ASSET_BINARY_FORMAT_H_
+#define _ASSET_BINARY_FORMAT_H_
+
+// Shared with the Qt tools, so nothing from cocos2d belongs here.
+
+#include "AssetBinary_generated.h"
+
+#define ASSET_BINARY_VERSION 1
+
+#endif
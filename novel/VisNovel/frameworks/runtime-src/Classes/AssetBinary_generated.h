@@ -0,0 +1,449 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+#ifndef FLATBUFFERS_GENERATED_ASSETBINARY_PINIASSET_H_
+#define FLATBUFFERS_GENERATED_ASSETBINARY_PINIASSET_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+
+namespace PiniAsset {
+
+struct Vec2;
+struct Color;
+struct Particle;
+struct KeyFrame;
+struct Layer;
+struct State;
+struct Actor;
+struct Asset;
+
+MANUALLY_ALIGNED_STRUCT(4) Vec2 {
+ private:
+  float x_;
+  float y_;
+
+ public:
+  Vec2(float x, float y)
+    : x_(flatbuffers::EndianScalar(x)), y_(flatbuffers::EndianScalar(y)) { }
+
+  float x() const { return flatbuffers::EndianScalar(x_); }
+  float y() const { return flatbuffers::EndianScalar(y_); }
+};
+STRUCT_END(Vec2, 8);
+
+MANUALLY_ALIGNED_STRUCT(4) Color {
+ private:
+  float r_;
+  float g_;
+  float b_;
+  float a_;
+
+ public:
+  Color(float r, float g, float b, float a)
+    : r_(flatbuffers::EndianScalar(r)), g_(flatbuffers::EndianScalar(g)), b_(flatbuffers::EndianScalar(b)), a_(flatbuffers::EndianScalar(a)) { }
+
+  float r() const { return flatbuffers::EndianScalar(r_); }
+  float g() const { return flatbuffers::EndianScalar(g_); }
+  float b() const { return flatbuffers::EndianScalar(b_); }
+  float a() const { return flatbuffers::EndianScalar(a_); }
+};
+STRUCT_END(Color, 16);
+
+MANUALLY_ALIGNED_STRUCT(4) KeyFrame {
+ private:
+  int32_t frame_index_;
+  float rotation_;
+  Vec2 position_;
+  Vec2 scale_;
+
+ public:
+  KeyFrame(int32_t frame_index, float rotation, const Vec2 &position, const Vec2 &scale)
+    : frame_index_(flatbuffers::EndianScalar(frame_index)), rotation_(flatbuffers::EndianScalar(rotation)), position_(position), scale_(scale) { }
+
+  int32_t frame_index() const { return flatbuffers::EndianScalar(frame_index_); }
+  float rotation() const { return flatbuffers::EndianScalar(rotation_); }
+  const Vec2 &position() const { return position_; }
+  const Vec2 &scale() const { return scale_; }
+};
+STRUCT_END(KeyFrame, 24);
+
+struct Particle : private flatbuffers::Table {
+  int32_t total_particles() const { return GetField<int32_t>(4, 0); }
+  float duration() const { return GetField<float>(6, -1); }
+  float emission_rate() const { return GetField<float>(8, 0); }
+  const Vec2 *source_position() const { return GetStruct<const Vec2 *>(10); }
+  const Vec2 *position_var() const { return GetStruct<const Vec2 *>(12); }
+  const Vec2 *gravity() const { return GetStruct<const Vec2 *>(14); }
+  float speed() const { return GetField<float>(16, 0); }
+  float speed_var() const { return GetField<float>(18, 0); }
+  float angle() const { return GetField<float>(20, 0); }
+  float angle_var() const { return GetField<float>(22, 0); }
+  float life() const { return GetField<float>(24, 0); }
+  float life_var() const { return GetField<float>(26, 0); }
+  float start_size() const { return GetField<float>(28, 0); }
+  float start_size_var() const { return GetField<float>(30, 0); }
+  float end_size() const { return GetField<float>(32, -1); }
+  float end_size_var() const { return GetField<float>(34, 0); }
+  const Color *start_color() const { return GetStruct<const Color *>(36); }
+  const Color *start_color_var() const { return GetStruct<const Color *>(38); }
+  const Color *end_color() const { return GetStruct<const Color *>(40); }
+  const Color *end_color_var() const { return GetStruct<const Color *>(42); }
+  float start_spin() const { return GetField<float>(44, 0); }
+  float start_spin_var() const { return GetField<float>(46, 0); }
+  float end_spin() const { return GetField<float>(48, 0); }
+  float end_spin_var() const { return GetField<float>(50, 0); }
+  float tangential_accel() const { return GetField<float>(52, 0); }
+  float tangential_accel_var() const { return GetField<float>(54, 0); }
+  float radial_accel() const { return GetField<float>(56, 0); }
+  float radial_accel_var() const { return GetField<float>(58, 0); }
+  uint8_t rotation_is_dir() const { return GetField<uint8_t>(60, 0); }
+  int32_t blend_src() const { return GetField<int32_t>(62, 1); }
+  int32_t blend_dst() const { return GetField<int32_t>(64, 771); }
+  const flatbuffers::String *texture() const { return GetPointer<const flatbuffers::String *>(66); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, 4 /* total_particles */) &&
+           VerifyField<float>(verifier, 6 /* duration */) &&
+           VerifyField<float>(verifier, 8 /* emission_rate */) &&
+           VerifyField<Vec2>(verifier, 10 /* source_position */) &&
+           VerifyField<Vec2>(verifier, 12 /* position_var */) &&
+           VerifyField<Vec2>(verifier, 14 /* gravity */) &&
+           VerifyField<float>(verifier, 16 /* speed */) &&
+           VerifyField<float>(verifier, 18 /* speed_var */) &&
+           VerifyField<float>(verifier, 20 /* angle */) &&
+           VerifyField<float>(verifier, 22 /* angle_var */) &&
+           VerifyField<float>(verifier, 24 /* life */) &&
+           VerifyField<float>(verifier, 26 /* life_var */) &&
+           VerifyField<float>(verifier, 28 /* start_size */) &&
+           VerifyField<float>(verifier, 30 /* start_size_var */) &&
+           VerifyField<float>(verifier, 32 /* end_size */) &&
+           VerifyField<float>(verifier, 34 /* end_size_var */) &&
+           VerifyField<Color>(verifier, 36 /* start_color */) &&
+           VerifyField<Color>(verifier, 38 /* start_color_var */) &&
+           VerifyField<Color>(verifier, 40 /* end_color */) &&
+           VerifyField<Color>(verifier, 42 /* end_color_var */) &&
+           VerifyField<float>(verifier, 44 /* start_spin */) &&
+           VerifyField<float>(verifier, 46 /* start_spin_var */) &&
+           VerifyField<float>(verifier, 48 /* end_spin */) &&
+           VerifyField<float>(verifier, 50 /* end_spin_var */) &&
+           VerifyField<float>(verifier, 52 /* tangential_accel */) &&
+           VerifyField<float>(verifier, 54 /* tangential_accel_var */) &&
+           VerifyField<float>(verifier, 56 /* radial_accel */) &&
+           VerifyField<float>(verifier, 58 /* radial_accel_var */) &&
+           VerifyField<uint8_t>(verifier, 60 /* rotation_is_dir */) &&
+           VerifyField<int32_t>(verifier, 62 /* blend_src */) &&
+           VerifyField<int32_t>(verifier, 64 /* blend_dst */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 66 /* texture */) &&
+           verifier.Verify(texture()) &&
+           verifier.EndTable();
+  }
+};
+
+struct ParticleBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_total_particles(int32_t total_particles) { fbb_.AddElement<int32_t>(4, total_particles, 0); }
+  void add_duration(float duration) { fbb_.AddElement<float>(6, duration, -1); }
+  void add_emission_rate(float emission_rate) { fbb_.AddElement<float>(8, emission_rate, 0); }
+  void add_source_position(const Vec2 *source_position) { fbb_.AddStruct(10, source_position); }
+  void add_position_var(const Vec2 *position_var) { fbb_.AddStruct(12, position_var); }
+  void add_gravity(const Vec2 *gravity) { fbb_.AddStruct(14, gravity); }
+  void add_speed(float speed) { fbb_.AddElement<float>(16, speed, 0); }
+  void add_speed_var(float speed_var) { fbb_.AddElement<float>(18, speed_var, 0); }
+  void add_angle(float angle) { fbb_.AddElement<float>(20, angle, 0); }
+  void add_angle_var(float angle_var) { fbb_.AddElement<float>(22, angle_var, 0); }
+  void add_life(float life) { fbb_.AddElement<float>(24, life, 0); }
+  void add_life_var(float life_var) { fbb_.AddElement<float>(26, life_var, 0); }
+  void add_start_size(float start_size) { fbb_.AddElement<float>(28, start_size, 0); }
+  void add_start_size_var(float start_size_var) { fbb_.AddElement<float>(30, start_size_var, 0); }
+  void add_end_size(float end_size) { fbb_.AddElement<float>(32, end_size, -1); }
+  void add_end_size_var(float end_size_var) { fbb_.AddElement<float>(34, end_size_var, 0); }
+  void add_start_color(const Color *start_color) { fbb_.AddStruct(36, start_color); }
+  void add_start_color_var(const Color *start_color_var) { fbb_.AddStruct(38, start_color_var); }
+  void add_end_color(const Color *end_color) { fbb_.AddStruct(40, end_color); }
+  void add_end_color_var(const Color *end_color_var) { fbb_.AddStruct(42, end_color_var); }
+  void add_start_spin(float start_spin) { fbb_.AddElement<float>(44, start_spin, 0); }
+  void add_start_spin_var(float start_spin_var) { fbb_.AddElement<float>(46, start_spin_var, 0); }
+  void add_end_spin(float end_spin) { fbb_.AddElement<float>(48, end_spin, 0); }
+  void add_end_spin_var(float end_spin_var) { fbb_.AddElement<float>(50, end_spin_var, 0); }
+  void add_tangential_accel(float tangential_accel) { fbb_.AddElement<float>(52, tangential_accel, 0); }
+  void add_tangential_accel_var(float tangential_accel_var) { fbb_.AddElement<float>(54, tangential_accel_var, 0); }
+  void add_radial_accel(float radial_accel) { fbb_.AddElement<float>(56, radial_accel, 0); }
+  void add_radial_accel_var(float radial_accel_var) { fbb_.AddElement<float>(58, radial_accel_var, 0); }
+  void add_rotation_is_dir(uint8_t rotation_is_dir) { fbb_.AddElement<uint8_t>(60, rotation_is_dir, 0); }
+  void add_blend_src(int32_t blend_src) { fbb_.AddElement<int32_t>(62, blend_src, 1); }
+  void add_blend_dst(int32_t blend_dst) { fbb_.AddElement<int32_t>(64, blend_dst, 771); }
+  void add_texture(flatbuffers::Offset<flatbuffers::String> texture) { fbb_.AddOffset(66, texture); }
+  ParticleBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  ParticleBuilder &operator=(const ParticleBuilder &);
+  flatbuffers::Offset<Particle> Finish() {
+    auto o = flatbuffers::Offset<Particle>(fbb_.EndTable(start_, 32));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Particle> CreateParticle(flatbuffers::FlatBufferBuilder &_fbb,
+   int32_t total_particles = 0,
+   float duration = -1,
+   float emission_rate = 0,
+   const Vec2 *source_position = 0,
+   const Vec2 *position_var = 0,
+   const Vec2 *gravity = 0,
+   float speed = 0,
+   float speed_var = 0,
+   float angle = 0,
+   float angle_var = 0,
+   float life = 0,
+   float life_var = 0,
+   float start_size = 0,
+   float start_size_var = 0,
+   float end_size = -1,
+   float end_size_var = 0,
+   const Color *start_color = 0,
+   const Color *start_color_var = 0,
+   const Color *end_color = 0,
+   const Color *end_color_var = 0,
+   float start_spin = 0,
+   float start_spin_var = 0,
+   float end_spin = 0,
+   float end_spin_var = 0,
+   float tangential_accel = 0,
+   float tangential_accel_var = 0,
+   float radial_accel = 0,
+   float radial_accel_var = 0,
+   uint8_t rotation_is_dir = 0,
+   int32_t blend_src = 1,
+   int32_t blend_dst = 771,
+   flatbuffers::Offset<flatbuffers::String> texture = 0) {
+  ParticleBuilder builder_(_fbb);
+  builder_.add_texture(texture);
+  builder_.add_blend_dst(blend_dst);
+  builder_.add_blend_src(blend_src);
+  builder_.add_radial_accel_var(radial_accel_var);
+  builder_.add_radial_accel(radial_accel);
+  builder_.add_tangential_accel_var(tangential_accel_var);
+  builder_.add_tangential_accel(tangential_accel);
+  builder_.add_end_spin_var(end_spin_var);
+  builder_.add_end_spin(end_spin);
+  builder_.add_start_spin_var(start_spin_var);
+  builder_.add_start_spin(start_spin);
+  builder_.add_end_color_var(end_color_var);
+  builder_.add_end_color(end_color);
+  builder_.add_start_color_var(start_color_var);
+  builder_.add_start_color(start_color);
+  builder_.add_end_size_var(end_size_var);
+  builder_.add_end_size(end_size);
+  builder_.add_start_size_var(start_size_var);
+  builder_.add_start_size(start_size);
+  builder_.add_life_var(life_var);
+  builder_.add_life(life);
+  builder_.add_angle_var(angle_var);
+  builder_.add_angle(angle);
+  builder_.add_speed_var(speed_var);
+  builder_.add_speed(speed);
+  builder_.add_gravity(gravity);
+  builder_.add_position_var(position_var);
+  builder_.add_source_position(source_position);
+  builder_.add_emission_rate(emission_rate);
+  builder_.add_duration(duration);
+  builder_.add_total_particles(total_particles);
+  builder_.add_rotation_is_dir(rotation_is_dir);
+  return builder_.Finish();
+}
+
+struct Layer : private flatbuffers::Table {
+  const flatbuffers::String *name() const { return GetPointer<const flatbuffers::String *>(4); }
+  uint8_t premultiplied() const { return GetField<uint8_t>(6, 0); }
+  int32_t width() const { return GetField<int32_t>(8, 0); }
+  int32_t height() const { return GetField<int32_t>(10, 0); }
+  const flatbuffers::Vector<const KeyFrame *> *key_frames() const { return GetPointer<const flatbuffers::Vector<const KeyFrame *> *>(12); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* name */) &&
+           verifier.Verify(name()) &&
+           VerifyField<uint8_t>(verifier, 6 /* premultiplied */) &&
+           VerifyField<int32_t>(verifier, 8 /* width */) &&
+           VerifyField<int32_t>(verifier, 10 /* height */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* key_frames */) &&
+           verifier.Verify(key_frames()) &&
+           verifier.EndTable();
+  }
+};
+
+struct LayerBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_name(flatbuffers::Offset<flatbuffers::String> name) { fbb_.AddOffset(4, name); }
+  void add_premultiplied(uint8_t premultiplied) { fbb_.AddElement<uint8_t>(6, premultiplied, 0); }
+  void add_width(int32_t width) { fbb_.AddElement<int32_t>(8, width, 0); }
+  void add_height(int32_t height) { fbb_.AddElement<int32_t>(10, height, 0); }
+  void add_key_frames(flatbuffers::Offset<flatbuffers::Vector<const KeyFrame *>> key_frames) { fbb_.AddOffset(12, key_frames); }
+  LayerBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  LayerBuilder &operator=(const LayerBuilder &);
+  flatbuffers::Offset<Layer> Finish() {
+    auto o = flatbuffers::Offset<Layer>(fbb_.EndTable(start_, 5));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Layer> CreateLayer(flatbuffers::FlatBufferBuilder &_fbb,
+   flatbuffers::Offset<flatbuffers::String> name = 0,
+   uint8_t premultiplied = 0,
+   int32_t width = 0,
+   int32_t height = 0,
+   flatbuffers::Offset<flatbuffers::Vector<const KeyFrame *>> key_frames = 0) {
+  LayerBuilder builder_(_fbb);
+  builder_.add_key_frames(key_frames);
+  builder_.add_height(height);
+  builder_.add_width(width);
+  builder_.add_name(name);
+  builder_.add_premultiplied(premultiplied);
+  return builder_.Finish();
+}
+
+struct State : private flatbuffers::Table {
+  const flatbuffers::String *name() const { return GetPointer<const flatbuffers::String *>(4); }
+  const flatbuffers::String *on_finish() const { return GetPointer<const flatbuffers::String *>(6); }
+  int32_t total_frame() const { return GetField<int32_t>(8, 0); }
+  int32_t frame_delay() const { return GetField<int32_t>(10, 0); }
+  const flatbuffers::Vector<flatbuffers::Offset<Layer>> *layers() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Layer>> *>(12); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* name */) &&
+           verifier.Verify(name()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* on_finish */) &&
+           verifier.Verify(on_finish()) &&
+           VerifyField<int32_t>(verifier, 8 /* total_frame */) &&
+           VerifyField<int32_t>(verifier, 10 /* frame_delay */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* layers */) &&
+           verifier.Verify(layers()) &&
+           verifier.VerifyVectorOfTables(layers()) &&
+           verifier.EndTable();
+  }
+};
+
+struct StateBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_name(flatbuffers::Offset<flatbuffers::String> name) { fbb_.AddOffset(4, name); }
+  void add_on_finish(flatbuffers::Offset<flatbuffers::String> on_finish) { fbb_.AddOffset(6, on_finish); }
+  void add_total_frame(int32_t total_frame) { fbb_.AddElement<int32_t>(8, total_frame, 0); }
+  void add_frame_delay(int32_t frame_delay) { fbb_.AddElement<int32_t>(10, frame_delay, 0); }
+  void add_layers(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Layer>>> layers) { fbb_.AddOffset(12, layers); }
+  StateBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  StateBuilder &operator=(const StateBuilder &);
+  flatbuffers::Offset<State> Finish() {
+    auto o = flatbuffers::Offset<State>(fbb_.EndTable(start_, 5));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<State> CreateState(flatbuffers::FlatBufferBuilder &_fbb,
+   flatbuffers::Offset<flatbuffers::String> name = 0,
+   flatbuffers::Offset<flatbuffers::String> on_finish = 0,
+   int32_t total_frame = 0,
+   int32_t frame_delay = 0,
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Layer>>> layers = 0) {
+  StateBuilder builder_(_fbb);
+  builder_.add_layers(layers);
+  builder_.add_frame_delay(frame_delay);
+  builder_.add_total_frame(total_frame);
+  builder_.add_on_finish(on_finish);
+  builder_.add_name(name);
+  return builder_.Finish();
+}
+
+struct Actor : private flatbuffers::Table {
+  const flatbuffers::String *name() const { return GetPointer<const flatbuffers::String *>(4); }
+  const flatbuffers::String *font_color() const { return GetPointer<const flatbuffers::String *>(6); }
+  const flatbuffers::Vector<flatbuffers::Offset<State>> *states() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<State>> *>(8); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* name */) &&
+           verifier.Verify(name()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* font_color */) &&
+           verifier.Verify(font_color()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* states */) &&
+           verifier.Verify(states()) &&
+           verifier.VerifyVectorOfTables(states()) &&
+           verifier.EndTable();
+  }
+};
+
+struct ActorBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_name(flatbuffers::Offset<flatbuffers::String> name) { fbb_.AddOffset(4, name); }
+  void add_font_color(flatbuffers::Offset<flatbuffers::String> font_color) { fbb_.AddOffset(6, font_color); }
+  void add_states(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<State>>> states) { fbb_.AddOffset(8, states); }
+  ActorBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  ActorBuilder &operator=(const ActorBuilder &);
+  flatbuffers::Offset<Actor> Finish() {
+    auto o = flatbuffers::Offset<Actor>(fbb_.EndTable(start_, 3));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Actor> CreateActor(flatbuffers::FlatBufferBuilder &_fbb,
+   flatbuffers::Offset<flatbuffers::String> name = 0,
+   flatbuffers::Offset<flatbuffers::String> font_color = 0,
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<State>>> states = 0) {
+  ActorBuilder builder_(_fbb);
+  builder_.add_states(states);
+  builder_.add_font_color(font_color);
+  builder_.add_name(name);
+  return builder_.Finish();
+}
+
+struct Asset : private flatbuffers::Table {
+  int32_t version() const { return GetField<int32_t>(4, 0); }
+  const Particle *particle() const { return GetPointer<const Particle *>(6); }
+  const flatbuffers::Vector<flatbuffers::Offset<Actor>> *actors() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Actor>> *>(8); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, 4 /* version */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* particle */) &&
+           verifier.VerifyTable(particle()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* actors */) &&
+           verifier.Verify(actors()) &&
+           verifier.VerifyVectorOfTables(actors()) &&
+           verifier.EndTable();
+  }
+};
+
+struct AssetBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_version(int32_t version) { fbb_.AddElement<int32_t>(4, version, 0); }
+  void add_particle(flatbuffers::Offset<Particle> particle) { fbb_.AddOffset(6, particle); }
+  void add_actors(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Actor>>> actors) { fbb_.AddOffset(8, actors); }
+  AssetBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  AssetBuilder &operator=(const AssetBuilder &);
+  flatbuffers::Offset<Asset> Finish() {
+    auto o = flatbuffers::Offset<Asset>(fbb_.EndTable(start_, 3));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Asset> CreateAsset(flatbuffers::FlatBufferBuilder &_fbb,
+   int32_t version = 0,
+   flatbuffers::Offset<Particle> particle = 0,
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Actor>>> actors = 0) {
+  AssetBuilder builder_(_fbb);
+  builder_.add_actors(actors);
+  builder_.add_particle(particle);
+  builder_.add_version(version);
+  return builder_.Finish();
+}
+
+inline const Asset *GetAsset(const void *buf) { return flatbuffers::GetRoot<Asset>(buf); }
+
+inline bool VerifyAssetBuffer(flatbuffers::Verifier &verifier) { return verifier.VerifyBuffer<Asset>(); }
+
+inline void FinishAssetBuffer(flatbuffers::FlatBufferBuilder &fbb, flatbuffers::Offset<Asset> root) { fbb.Finish(root, "PNAS"); }
+
+inline bool AssetBufferHasIdentifier(const void *buf) { return flatbuffers::BufferHasIdentifier(buf, "PNAS"); }
+
+}  // namespace PiniAsset
+
+#endif  // FLATBUFFERS_GENERATED_ASSETBINARY_PINIASSET_H_
@@ -0,0 +1,220 @@
+#include "StreamingSprite.h"
+#include "TextureStreamer.h"
+#include "utils.h"
+
+#include <math.h>
+
+// frames a coarser level has to be enough before finer ones are dropped
+#define STREAM_EVICT_DELAY 120
+
+StreamingSprite::StreamingSprite():
+	Sprite(),
+	_levels(1),
+	_currentLevel(-1),
+	_wantedLevel(-1),
+	_requestedLevel(-1),
+	_wantedSince(0),
+	_lastVisibleFrame(0)
+{
+}
+
+StreamingSprite::~StreamingSprite(){
+	if (TextureStreamer::hasInstance()){
+		TextureStreamer::getInstance()->unregistSprite(this);
+	}
+	for (auto& it : _resident){
+		it.second->release();
+	}
+}
+
+StreamingSprite* StreamingSprite::create(const char* filename, const char* zipfile, const char* password, int levels, const Size& fullSize){
+	StreamingSprite* sprite = new StreamingSprite();
+	if (sprite && sprite->initWithPyramid(filename, zipfile, password, levels, fullSize)){
+		sprite->autorelease();
+		return sprite;
+	}
+	delete sprite;
+	return nullptr;
+}
+
+bool StreamingSprite::initWithPyramid(const char* filename, const char* zipfile, const char* password, int levels, const Size& fullSize){
+	Sprite::init();
+
+	_filename = filename;
+	_zipname = zipfile;
+	_password = password;
+	_levels = MAX(levels, 1);
+
+	// the coarsest level is uploaded right away so the sprite can be laid out
+	// and drawn before anything has streamed in
+	int lowest = _levels - 1;
+	Texture2D* texture = TextureStreamer::getInstance()->loadLevelSync(_filename, _zipname, _password, lowest);
+	if (texture == nullptr){
+		return false;
+	}
+	texture->retain();
+	_resident[lowest] = texture;
+
+	_fullSize = fullSize;
+	if (_fullSize.width <= 0 || _fullSize.height <= 0){
+		_fullSize = TextureStreamer::loadFullSize(_filename, _zipname, _password);
+	}
+	if (_fullSize.width <= 0 || _fullSize.height <= 0){
+		// no .mip.txt: off by up to a pixel per level for odd sizes
+		CCLOG("StreamingSprite: %s has no size, guessing it from the coarsest level", filename);
+		float scale = (float)(1 << lowest);
+		_fullSize = texture->getContentSize() * scale;
+	}
+
+	applyLevel(lowest);
+	TextureStreamer::getInstance()->registSprite(this);
+	return true;
+}
+
+void StreamingSprite::onExit(){
+	Sprite::onExit();
+	TextureStreamer::getInstance()->cancel(this);
+	_requestedLevel = -1;
+	evictFinerThan(_levels - 1);
+}
+
+void StreamingSprite::setTextureRect(const Rect& rect, bool rotated, const Size& untrimmedSize){
+	Sprite::setTextureRect(rect, rotated, untrimmedSize);
+	if (_currentLevel < 0 || _batchNode){
+		return;
+	}
+
+	// every level covers the full resolution footprint, whatever its own size;
+	// flipping is already handled by the texture coordinates
+	_quad.bl.vertices.set(0.0f, 0.0f, 0.0f);
+	_quad.br.vertices.set(_fullSize.width, 0.0f, 0.0f);
+	_quad.tl.vertices.set(0.0f, _fullSize.height, 0.0f);
+	_quad.tr.vertices.set(_fullSize.width, _fullSize.height, 0.0f);
+	_polyInfo.setQuad(&_quad);
+}
+
+void StreamingSprite::applyLevel(int level){
+	auto fn = _resident.find(level);
+	if (fn == _resident.end()){
+		return;
+	}
+	Texture2D* texture = fn->second;
+
+	_currentLevel = level;
+	Sprite::setTexture(texture);
+
+	Rect rect = Rect::ZERO;
+	rect.size = texture->getContentSize();
+	setTextureRect(rect, false, _fullSize);
+}
+
+int StreamingSprite::computeLevel(const Mat4& transform){
+	float sx = sqrtf(transform.m[0] * transform.m[0] + transform.m[1] * transform.m[1]);
+	float sy = sqrtf(transform.m[4] * transform.m[4] + transform.m[5] * transform.m[5]);
+
+	auto glview = Director::getInstance()->getOpenGLView();
+	float screenW = _fullSize.width * sx * (glview ? glview->getScaleX() : 1.0f);
+	float screenH = _fullSize.height * sy * (glview ? glview->getScaleY() : 1.0f);
+	if (screenW <= 0 || screenH <= 0){
+		return _levels - 1;
+	}
+
+	float pixelsW = _fullSize.width * CC_CONTENT_SCALE_FACTOR();
+	float pixelsH = _fullSize.height * CC_CONTENT_SCALE_FACTOR();
+	float ratio = MIN(pixelsW / screenW, pixelsH / screenH);
+	if (ratio <= 1.0f){
+		return 0;
+	}
+	int level = (int)floorf(log2f(ratio));
+	return MIN(MAX(level, 0), _levels - 1);
+}
+
+void StreamingSprite::draw(Renderer *renderer, const Mat4 &transform, uint32_t flags){
+	Sprite::draw(renderer, transform, flags);
+#if CC_USE_CULLING
+	if (!_insideBounds){
+		return;
+	}
+#endif
+
+	unsigned int frame = Director::getInstance()->getTotalFrames();
+	_lastVisibleFrame = frame;
+
+	int level = computeLevel(transform);
+	if (level != _wantedLevel){
+		_wantedLevel = level;
+		_wantedSince = frame;
+	}
+
+	if (level < _currentLevel){
+		level = loadableLevel(level);
+	}
+	if (level < _currentLevel){
+		if (_resident.find(level) != _resident.end()){
+			applyLevel(level);
+		}
+		else if (_requestedLevel != level){
+			_requestedLevel = level;
+			TextureStreamer::getInstance()->request(this, level);
+		}
+	}
+	else if (level > _currentLevel && frame - _wantedSince > STREAM_EVICT_DELAY){
+		evictFinerThan(level);
+	}
+}
+
+// the finest level no finer than 'level' that is resident or still worth
+// loading; _currentLevel when every one in between has failed
+int StreamingSprite::loadableLevel(int level){
+	for (; level < _currentLevel; level++){
+		if (_resident.find(level) != _resident.end() || _failedLevels.find(level) == _failedLevels.end()){
+			break;
+		}
+	}
+	return level;
+}
+
+void StreamingSprite::onLevelLoaded(int level, Texture2D* texture){
+	if (level == _requestedLevel){
+		_requestedLevel = -1;
+	}
+	if (texture == nullptr){
+		// a missing or broken file stays that way, don't decode it every frame
+		CCLOG("StreamingSprite: cannot load level %d of %s", level, _filename.c_str());
+		_failedLevels.insert(level);
+		return;
+	}
+	if (_resident.find(level) == _resident.end()){
+		texture->retain();
+		_resident[level] = texture;
+	}
+	// only switch if it still helps, the sprite may have shrunk meanwhile
+	if (level < _currentLevel && level >= _wantedLevel){
+		applyLevel(level);
+	}
+}
+
+size_t StreamingSprite::evictFinerThan(int level){
+	size_t freed = 0;
+	for (auto it = _resident.begin(); it != _resident.end();){
+		if (it->first < level && it->first != _levels - 1){
+			freed += TextureStreamer::textureBytes(it->second);
+			it->second->release();
+			it = _resident.erase(it);
+			continue;
+		}
+		++it;
+	}
+
+	if (_resident.find(_currentLevel) == _resident.end()){
+		// fall back to the finest level that is still resident
+		int best = _levels - 1;
+		for (auto& it : _resident){
+			if (it.first >= level && it.first < best){
+				best = it.first;
+			}
+		}
+		applyLevel(best);
+	}
+	return freed;
+}
@@ -0,0 +1,60 @@
+#ifndef _STREAMING_SPRITE_H_
+#define _STREAMING_SPRITE_H_
+
+#include "cocos2d.h"
+
+#include <set>
+
+using namespace cocos2d;
+
+// Sprite for oversized CGs stored as a mip pyramid (see TextureStreamer.h).
+// The coarsest level is shown immediately, finer levels are requested from the
+// streamer according to the size the sprite covers on screen and dropped again
+// once they are no longer needed.
+class StreamingSprite : public Sprite{
+private:
+	std::string _filename;
+	std::string _zipname;
+	std::string _password;
+
+	int _levels;
+	Size _fullSize;
+
+	std::map<int, Texture2D*> _resident;
+	// levels that could not be loaded, never asked for again
+	std::set<int> _failedLevels;
+	int _currentLevel;
+	int _wantedLevel;
+	int _requestedLevel;
+	unsigned int _wantedSince;
+	unsigned int _lastVisibleFrame;
+
+	int computeLevel(const Mat4& transform);
+	int loadableLevel(int level);
+	void applyLevel(int level);
+
+public:
+	StreamingSprite();
+	virtual ~StreamingSprite();
+
+	static StreamingSprite* create(const char* filename, const char* zipfile = "", const char* password = "", int levels = 3, const Size& fullSize = Size::ZERO);
+	virtual bool initWithPyramid(const char* filename, const char* zipfile, const char* password, int levels, const Size& fullSize);
+
+	virtual void onExit();
+	virtual void draw(Renderer *renderer, const Mat4 &transform, uint32_t flags) override;
+	virtual void setTextureRect(const Rect& rect, bool rotated, const Size& untrimmedSize) override;
+
+	void onLevelLoaded(int level, Texture2D* texture);
+
+	// drop every resident level finer than 'level'; returns the freed bytes
+	size_t evictFinerThan(int level);
+
+	const std::string& getFilename() const { return _filename; }
+	const std::string& getZipname() const { return _zipname; }
+	const std::string& getPassword() const { return _password; }
+	int getLevelCount() const { return _levels; }
+	int getCurrentLevel() const { return _currentLevel; }
+	unsigned int getLastVisibleFrame() const { return _lastVisibleFrame; }
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include "TextureStreamer.h"
+#include "StreamingSprite.h"
+#include "lua_utils.h"
+#include "utils.h"
+
+#include <algorithm>
+
+#define STREAM_DEFAULT_BUDGET (64 * 1024 * 1024)
+
+TextureStreamer* textureStreamerInst = nullptr;
+TextureStreamer* TextureStreamer::getInstance(){
+	if (textureStreamerInst == nullptr){
+		textureStreamerInst = new TextureStreamer;
+	}
+	return textureStreamerInst;
+}
+
+bool TextureStreamer::hasInstance(){
+	return textureStreamerInst != nullptr;
+}
+
+void TextureStreamer::purge(){
+	delete textureStreamerInst;
+	textureStreamerInst = nullptr;
+}
+
+TextureStreamer::TextureStreamer():
+_closeStreamThread(false),
+_streamThread(nullptr),
+_loadingSprite(nullptr),
+_resetListener(nullptr),
+_budget(STREAM_DEFAULT_BUDGET),
+_residentBytes(0)
+{
+	_streamThread = new std::thread(&TextureStreamer::loadThread, this);
+	Director::getInstance()->getScheduler()->schedule(CC_SCHEDULE_SELECTOR(TextureStreamer::update), this, 0, false);
+
+	// go with the director, while it and the GL context are still there
+	_resetListener = Director::getInstance()->getEventDispatcher()->addCustomEventListener(Director::EVENT_RESET, [](EventCustom*){
+		TextureStreamer::purge();
+	});
+}
+
+TextureStreamer::~TextureStreamer(){
+	Director::getInstance()->getScheduler()->unschedule(CC_SCHEDULE_SELECTOR(TextureStreamer::update), this);
+	Director::getInstance()->getEventDispatcher()->removeEventListener(_resetListener);
+	if (_streamThread){
+		_closeStreamThread = true;
+		_streamSleepCondition.notify_one();
+		_streamThread->join();
+		CC_SAFE_DELETE(_streamThread);
+	}
+	for (auto& response : _responses){
+		CC_SAFE_RELEASE(response.image);
+	}
+	// the TextureCache drops its own reference when the director goes
+	for (auto& it : _levelCache){
+		it.second->release();
+	}
+}
+
+std::string TextureStreamer::levelFileName(const std::string& filename, int level){
+	if (level <= 0){
+		return filename;
+	}
+	char suffix[16];
+	sprintf(suffix, ".mip%d", level);
+
+	size_t dot = filename.find_last_of('.');
+	size_t slash = filename.find_last_of("/\\");
+	if (dot == string::npos || (slash != string::npos && dot < slash)){
+		return filename + suffix;
+	}
+	return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+
+Data TextureStreamer::loadFile(const std::string& path, const std::string& zipname, const std::string& password){
+	if (zipname.length() == 0){
+		return FileUtils::getInstance()->getDataFromFile(path);
+	}
+
+	ssize_t pSize = 0;
+	unsigned char * tdata = nullptr;
+	if (password.length() > 0){
+		tdata = getFileDataFromZipWithPassword(zipname, path, password, &pSize);
+	}
+	else{
+		tdata = FileUtils::getInstance()->getFileDataFromZip(zipname, path, &pSize);
+	}
+
+	Data data;
+	if (tdata){
+		if (pSize > 0){
+			data.fastSet(tdata, pSize);
+			return data;
+		}
+		free(tdata);
+	}
+	return data;
+}
+
+Image* TextureStreamer::loadLevelImage(const std::string& filename, const std::string& zipname, const std::string& password, int level){
+	Data data = loadFile(levelFileName(filename, level), zipname, password);
+	if (data.isNull()){
+		return nullptr;
+	}
+
+	Image* image = new (std::nothrow) Image();
+	if (image && !image->initWithImageData(data.getBytes(), data.getSize())){
+		CC_SAFE_RELEASE_NULL(image);
+	}
+	return image;
+}
+
+Size TextureStreamer::loadFullSize(const std::string& filename, const std::string& zipname, const std::string& password){
+	string path = filename;
+	size_t dot = filename.find_last_of('.');
+	size_t slash = filename.find_last_of("/\\");
+	if (dot != string::npos && (slash == string::npos || dot > slash)){
+		path = filename.substr(0, dot);
+	}
+
+	Data data = loadFile(path + ".mip.txt", zipname, password);
+	int width = 0, height = 0;
+	if (data.isNull() || sscanf(string((const char*)data.getBytes(), data.getSize()).c_str(), "%d %d", &width, &height) != 2){
+		return Size::ZERO;
+	}
+	return Size(width, height);
+}
+
+size_t TextureStreamer::textureBytes(Texture2D* texture){
+	return (size_t)texture->getPixelsWide() * texture->getPixelsHigh() * texture->getBitsPerPixelForFormat() / 8;
+}
+
+Texture2D* TextureStreamer::loadLevelSync(const std::string& filename, const std::string& zipname, const std::string& password, int level){
+	string path = levelFileName(filename, level);
+
+	Texture2D* texture = TextureCache::getInstance()->getTextureForKey(path);
+	if (texture){
+		return texture;
+	}
+
+	Image* image = loadLevelImage(filename, zipname, password, level);
+	if (image){
+		texture = TextureCache::getInstance()->addImage(image, path);
+		// VolatileTextureMgr may keep the image to restore the texture
+		image->release();
+	}
+	return texture;
+}
+
+Texture2D* TextureStreamer::getCachedLevel(const std::string& filename, int level){
+	auto fn = _levelCache.find(levelFileName(filename, level));
+	if (fn == _levelCache.end()){
+		return nullptr;
+	}
+	return fn->second;
+}
+
+void TextureStreamer::request(StreamingSprite* sprite, int level){
+	Texture2D* texture = getCachedLevel(sprite->getFilename(), level);
+	if (texture){
+		sprite->onLevelLoaded(level, texture);
+		return;
+	}
+
+	_streamQueueMutex.lock();
+	for (auto& r : _requests){
+		if (r.sprite == sprite){
+			r.level = level;
+			_streamQueueMutex.unlock();
+			return;
+		}
+	}
+	StreamRequest req = { sprite, sprite->getFilename(), sprite->getZipname(), sprite->getPassword(), level };
+	_requests.push_back(req);
+	_streamQueueMutex.unlock();
+
+	_streamSleepCondition.notify_one();
+}
+
+void TextureStreamer::cancel(StreamingSprite* sprite){
+	_streamQueueMutex.lock();
+	_requests.erase(std::remove_if(_requests.begin(), _requests.end(), [sprite](const StreamRequest& r){
+		return r.sprite == sprite;
+	}), _requests.end());
+	for (auto& response : _responses){
+		if (response.request.sprite == sprite){
+			response.request.sprite = nullptr;
+		}
+	}
+	if (_loadingSprite == sprite){
+		_loadingSprite = nullptr;
+	}
+	_streamQueueMutex.unlock();
+}
+
+void TextureStreamer::registSprite(StreamingSprite* sprite){
+	if (std::find(_sprites.begin(), _sprites.end(), sprite) == _sprites.end()){
+		_sprites.push_back(sprite);
+	}
+}
+
+void TextureStreamer::unregistSprite(StreamingSprite* sprite){
+	cancel(sprite);
+	_sprites.erase(std::remove(_sprites.begin(), _sprites.end(), sprite), _sprites.end());
+}
+
+void TextureStreamer::setBudget(size_t bytes){
+	_budget = bytes;
+}
+
+void TextureStreamer::trimCache(){
+	_residentBytes = 0;
+	for (auto it = _levelCache.begin(); it != _levelCache.end();){
+		// held only by this cache and the TextureCache
+		if (it->second->getReferenceCount() == 2){
+			TextureCache::getInstance()->removeTexture(it->second);
+			it->second->release();
+			it = _levelCache.erase(it);
+			continue;
+		}
+		_residentBytes += textureBytes(it->second);
+		++it;
+	}
+}
+
+void TextureStreamer::enforceBudget(){
+	if (_residentBytes <= _budget){
+		return;
+	}
+
+	// evict the sprites that have been off screen the longest first and never
+	// touch what was drawn last frame, that would just stream it back in
+	unsigned int frame = Director::getInstance()->getTotalFrames();
+	std::vector<StreamingSprite*> candidates = _sprites;
+	std::sort(candidates.begin(), candidates.end(), [](StreamingSprite* a, StreamingSprite* b){
+		return a->getLastVisibleFrame() < b->getLastVisibleFrame();
+	});
+
+	for (auto sprite : candidates){
+		if (sprite->getLastVisibleFrame() + 1 >= frame){
+			break;
+		}
+		if (sprite->evictFinerThan(sprite->getLevelCount() - 1) > 0){
+			trimCache();
+			if (_residentBytes <= _budget){
+				break;
+			}
+		}
+	}
+}
+
+void TextureStreamer::update(float dt){
+	if (_responses.size() > 0){
+		_streamQueueMutex.lock();
+		StreamResponse response = _responses.front();
+		_responses.pop_front();
+		_streamQueueMutex.unlock();
+
+		string path = levelFileName(response.request.filename, response.request.level);
+		Texture2D* texture = nullptr;
+		auto fn = _levelCache.find(path);
+		if (fn != _levelCache.end()){
+			texture = fn->second;
+		}
+		else if (response.image){
+			// through the TextureCache so the level is restored after a lost GL context
+			texture = TextureCache::getInstance()->getTextureForKey(path);
+			if (texture == nullptr){
+				texture = TextureCache::getInstance()->addImage(response.image, path);
+			}
+			if (texture){
+				texture->retain();
+				_levelCache[path] = texture;
+			}
+		}
+		CC_SAFE_RELEASE(response.image);
+
+		if (response.request.sprite){
+			response.request.sprite->onLevelLoaded(response.request.level, texture);
+		}
+	}
+
+	trimCache();
+	enforceBudget();
+}
+
+void TextureStreamer::loadThread(){
+	while (1){
+		Sleep(1);
+		if (_closeStreamThread){
+			break;
+		}
+		_streamQueueMutex.lock();
+		if (_requests.size() == 0){
+			_streamQueueMutex.unlock();
+			std::unique_lock<std::mutex> lk(_streamSleepMutex);
+			_streamSleepCondition.wait_for(lk, std::chrono::milliseconds(100));
+			continue;
+		}
+		StreamRequest req = _requests.front();
+		_requests.pop_front();
+		_loadingSprite = req.sprite;
+		_streamQueueMutex.unlock();
+
+		Image* image = loadLevelImage(req.filename, req.zipname, req.password, req.level);
+
+		_streamQueueMutex.lock();
+		// the sprite may have been released while the level was decoding
+		req.sprite = _loadingSprite;
+		_loadingSprite = nullptr;
+		StreamResponse response = { req, image };
+		_responses.push_back(response);
+		_streamQueueMutex.unlock();
+	}
+}
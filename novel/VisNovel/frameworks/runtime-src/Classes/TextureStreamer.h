@@ -0,0 +1,97 @@
+#ifndef _TEXTURE_STREAMER_H_
+#define _TEXTURE_STREAMER_H_
+
+#include "cocos2d.h"
+
+#include <deque>
+
+using namespace std;
+using namespace cocos2d;
+
+class StreamingSprite;
+
+// Mip pyramid layout in the package:
+//   cg/ev01.png        level 0 (full resolution)
+//   cg/ev01.mip1.png   level 1 (1/2)
+//   cg/ev01.mip2.png   level 2 (1/4)
+//   ...
+//   cg/ev01.mip.txt    "<width> <height>" of level 0
+// tool/mippyramid.py writes the levels from the full resolution image. Levels
+// round odd sizes up, so the full size is read from the .mip.txt file rather
+// than derived from the coarsest level.
+// The coarsest level is loaded synchronously and kept in the TextureCache,
+// finer levels are decoded on the streamer thread, added to the TextureCache
+// (so they survive a lost GL context) and shared between sprites through the
+// streamer's own cache until nothing else references them any more.
+
+typedef struct StreamRequest_{
+	StreamingSprite* sprite;
+	std::string filename;
+	std::string zipname;
+	std::string password;
+	int level;
+} StreamRequest;
+
+typedef struct StreamResponse_{
+	StreamRequest request;
+	Image* image;
+} StreamResponse;
+
+class TextureStreamer : public Ref{
+private:
+	bool _closeStreamThread;
+	std::thread* _streamThread;
+
+	std::deque<StreamRequest> _requests;
+	std::deque<StreamResponse> _responses;
+	std::map<string, Texture2D*> _levelCache;
+	std::vector<StreamingSprite*> _sprites;
+	StreamingSprite* _loadingSprite;
+	EventListenerCustom* _resetListener;
+
+	size_t _budget;
+	size_t _residentBytes;
+
+	std::mutex _streamQueueMutex;
+	std::mutex _streamSleepMutex;
+	std::condition_variable _streamSleepCondition;
+
+	void trimCache();
+	void enforceBudget();
+
+	static Data loadFile(const std::string& path, const std::string& zipname, const std::string& password);
+
+public:
+	TextureStreamer();
+	virtual ~TextureStreamer();
+
+	static std::string levelFileName(const std::string& filename, int level);
+	static Image* loadLevelImage(const std::string& filename, const std::string& zipname, const std::string& password, int level);
+	// Size::ZERO when the pyramid has no .mip.txt
+	static Size loadFullSize(const std::string& filename, const std::string& zipname, const std::string& password);
+	static size_t textureBytes(Texture2D* texture);
+
+	Texture2D* loadLevelSync(const std::string& filename, const std::string& zipname, const std::string& password, int level);
+	Texture2D* getCachedLevel(const std::string& filename, int level);
+
+	void request(StreamingSprite* sprite, int level);
+	void cancel(StreamingSprite* sprite);
+
+	void registSprite(StreamingSprite* sprite);
+	void unregistSprite(StreamingSprite* sprite);
+
+	// bytes of streamed (non coarsest) levels allowed to stay resident
+	void setBudget(size_t bytes);
+	size_t getBudget() const { return _budget; }
+	size_t getResidentBytes() const { return _residentBytes; }
+
+	void loadThread();
+	virtual void update(float dt);
+
+public:
+	static TextureStreamer* getInstance();
+	static bool hasInstance();
+	static void purge();
+};
+
+#endif
@@ -0,0 +1,612 @@
+#include "ThumbnailAtlas.h"
+#include "TextureStreamer.h"
+#include "lua_utils.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <sstream>
+#include <sys/stat.h>
+
+// padding between thumbnails so linear filtering never picks up a neighbour
+#define THUMBNAIL_PADDING 2
+// seconds without new thumbnails before dirty pages are written out
+#define THUMBNAIL_FLUSH_DELAY 1.0f
+
+#define THUMBNAIL_PAGE_BYTES (THUMBNAIL_PAGE_SIZE * THUMBNAIL_PAGE_SIZE * 4)
+
+ThumbnailAtlas* thumbnailAtlasInst = nullptr;
+ThumbnailAtlas* ThumbnailAtlas::getInstance(){
+	if (thumbnailAtlasInst == nullptr){
+		thumbnailAtlasInst = new ThumbnailAtlas;
+	}
+	return thumbnailAtlasInst;
+}
+
+bool ThumbnailAtlas::hasInstance(){
+	return thumbnailAtlasInst != nullptr;
+}
+
+void ThumbnailAtlas::purge(){
+	delete thumbnailAtlasInst;
+	thumbnailAtlasInst = nullptr;
+}
+
+ThumbnailAtlas::ThumbnailAtlas():
+_indexLoaded(false),
+_dirty(false),
+_idleTime(0),
+_resetListener(nullptr),
+_closeThread(false),
+_thread(nullptr)
+{
+	_directory = FileUtils::getInstance()->getWritablePath() + "thumbs/";
+	_thread = new std::thread(&ThumbnailAtlas::loadThread, this);
+	Director::getInstance()->getScheduler()->schedule(CC_SCHEDULE_SELECTOR(ThumbnailAtlas::update), this, 0, false);
+
+	// go with the director, while it and the GL context are still there
+	_resetListener = Director::getInstance()->getEventDispatcher()->addCustomEventListener(Director::EVENT_RESET, [](EventCustom*){
+		ThumbnailAtlas::purge();
+	});
+
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	// pages are not in the TextureCache, so VolatileTextureMgr does not restore them
+	_rendererRecreatedListener = EventListenerCustom::create(EVENT_RENDERER_RECREATED, [this](EventCustom* event){
+		reloadPages();
+	});
+	Director::getInstance()->getEventDispatcher()->addEventListenerWithFixedPriority(_rendererRecreatedListener, -1);
+#endif
+}
+
+ThumbnailAtlas::~ThumbnailAtlas(){
+	Director::getInstance()->getScheduler()->unschedule(CC_SCHEDULE_SELECTOR(ThumbnailAtlas::update), this);
+	Director::getInstance()->getEventDispatcher()->removeEventListener(_resetListener);
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	Director::getInstance()->getEventDispatcher()->removeEventListener(_rendererRecreatedListener);
+#endif
+	if (_thread){
+		_closeThread = true;
+		_sleepCondition.notify_one();
+		_thread->join();
+		CC_SAFE_DELETE(_thread);
+	}
+	for (auto& response : _responses){
+		free(response.pixels);
+	}
+	for (auto& it : _waiting){
+		it.second->release();
+	}
+
+	flush();
+	for (auto& page : _pages){
+		CC_SAFE_RELEASE(page.texture);
+		free(page.pixels);
+	}
+}
+
+std::string ThumbnailAtlas::makeKey(const std::string& filename, const std::string& zipname, int width, int height){
+	std::stringstream ss;
+	ss << zipname << "|" << filename << "|" << width << "x" << height;
+	return ss.str();
+}
+
+// changes whenever the source is replaced, without reading the image itself
+std::string ThumbnailAtlas::sourceStamp(const std::string& filename, const std::string& zipname){
+	std::stringstream ss;
+	if (zipname.length() > 0){
+		unsigned long crc = 0, size = 0;
+		if (getFileInfoFromZip(zipname, filename, &crc, &size)){
+			ss << std::hex << crc << "-" << size;
+		}
+		return ss.str();
+	}
+
+	string path = FileUtils::getInstance()->fullPathForFilename(filename);
+	struct stat info;
+	if (stat(FileUtils::getInstance()->getSuitableFOpen(path).c_str(), &info) == 0){
+		ss << (long long)info.st_mtime << "-" << (long long)info.st_size;
+	}
+	else{
+		// packaged assets (apk) have no file time, they only change with the app
+		ss << FileUtils::getInstance()->getFileSize(path);
+	}
+	return ss.str();
+}
+
+std::string ThumbnailAtlas::pagePath(int page){
+	std::stringstream ss;
+	ss << _directory << "page" << page << ".rgba";
+	return ss.str();
+}
+
+// index.txt
+//   pages <count> <shelfX> <shelfY> <shelfHeight>   (shelf of the last page)
+//   <key>\t<page>\t<x>\t<y>\t<w>\t<h>
+void ThumbnailAtlas::loadIndex(){
+	_indexLoaded = true;
+
+	string path = _directory + "index.txt";
+	if (!FileUtils::getInstance()->isFileExist(path)){
+		return;
+	}
+
+	std::stringstream ss(FileUtils::getInstance()->getStringFromFile(path));
+	string line;
+	int count = 0;
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	if (!std::getline(ss, line) || sscanf(line.c_str(), "pages %d %d %d %d", &count, &shelfX, &shelfY, &shelfHeight) != 4){
+		return;
+	}
+	for (int i = 0; i < count; i++){
+		if (!FileUtils::getInstance()->isFileExist(pagePath(i))){
+			// a page went missing, nothing in the index can be trusted
+			_pages.clear();
+			return;
+		}
+		ThumbnailPage page = { nullptr, nullptr, 0, THUMBNAIL_PAGE_SIZE, 0, false };
+		_pages.push_back(page);
+	}
+	if (count > 0){
+		ThumbnailPage& last = _pages.back();
+		last.shelfX = shelfX;
+		last.shelfY = shelfY;
+		last.shelfHeight = shelfHeight;
+	}
+
+	while (std::getline(ss, line)){
+		size_t tab = line.find('\t');
+		if (tab == string::npos){
+			continue;
+		}
+		ThumbnailEntry entry;
+		int x, y, w, h;
+		if (sscanf(line.c_str() + tab + 1, "%d\t%d\t%d\t%d\t%d", &entry.page, &x, &y, &w, &h) != 5){
+			continue;
+		}
+		if (entry.page < 0 || entry.page >= count){
+			continue;
+		}
+		entry.rect = Rect(x, y, w, h);
+		_entries[line.substr(0, tab)] = entry;
+	}
+}
+
+Texture2D* ThumbnailAtlas::loadPage(int index){
+	ThumbnailPage& page = _pages[index];
+	if (page.texture){
+		return page.texture;
+	}
+
+	page.texture = new Texture2D;
+	if (!uploadPage(index)){
+		CC_SAFE_RELEASE_NULL(page.texture);
+	}
+	return page.texture;
+}
+
+// (re)fills the page texture from the pixels kept in memory or the page file
+bool ThumbnailAtlas::uploadPage(int index){
+	ThumbnailPage& page = _pages[index];
+
+	bool last = (index == (int)_pages.size() - 1);
+	if (page.pixels == nullptr){
+		Data data = FileUtils::getInstance()->getDataFromFile(pagePath(index));
+		if (data.getSize() != THUMBNAIL_PAGE_BYTES){
+			return false;
+		}
+		if (last){
+			page.pixels = (unsigned char*)malloc(THUMBNAIL_PAGE_BYTES);
+			memcpy(page.pixels, data.getBytes(), THUMBNAIL_PAGE_BYTES);
+		}
+		page.texture->initWithData(data.getBytes(), THUMBNAIL_PAGE_BYTES, Texture2D::PixelFormat::RGBA8888,
+			THUMBNAIL_PAGE_SIZE, THUMBNAIL_PAGE_SIZE, Size(THUMBNAIL_PAGE_SIZE, THUMBNAIL_PAGE_SIZE));
+	}
+	else{
+		page.texture->initWithData(page.pixels, THUMBNAIL_PAGE_BYTES, Texture2D::PixelFormat::RGBA8888,
+			THUMBNAIL_PAGE_SIZE, THUMBNAIL_PAGE_SIZE, Size(THUMBNAIL_PAGE_SIZE, THUMBNAIL_PAGE_SIZE));
+	}
+	page.texture->setAntiAliasTexParameters();
+	return true;
+}
+
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+void ThumbnailAtlas::reloadPages(){
+	for (size_t i = 0; i < _pages.size(); i++){
+		if (_pages[i].texture && !uploadPage(i)){
+			CCLOG("ThumbnailAtlas: cannot restore %s", pagePath(i).c_str());
+		}
+	}
+}
+#endif
+
+bool ThumbnailAtlas::allocate(int w, int h, int* pageIndex, Rect* rect){
+	int pw = w + THUMBNAIL_PADDING;
+	int ph = h + THUMBNAIL_PADDING;
+	if (pw > THUMBNAIL_PAGE_SIZE || ph > THUMBNAIL_PAGE_SIZE){
+		return false;
+	}
+
+	if (_pages.size() > 0){
+		ThumbnailPage& page = _pages.back();
+		if (page.shelfX + pw > THUMBNAIL_PAGE_SIZE){
+			page.shelfX = 0;
+			page.shelfY += page.shelfHeight;
+			page.shelfHeight = 0;
+		}
+		if (page.shelfY + ph <= THUMBNAIL_PAGE_SIZE){
+			*pageIndex = _pages.size() - 1;
+			*rect = Rect(page.shelfX, page.shelfY, w, h);
+			page.shelfX += pw;
+			page.shelfHeight = MAX(page.shelfHeight, ph);
+			return true;
+		}
+
+		// the page is full; flush() drops its pixels once they are written
+		page.shelfY = THUMBNAIL_PAGE_SIZE;
+		_dirty = true;
+	}
+
+	ThumbnailPage page = { nullptr, (unsigned char*)calloc(1, THUMBNAIL_PAGE_BYTES), pw, 0, ph, true };
+	_pages.push_back(page);
+	*pageIndex = _pages.size() - 1;
+	*rect = Rect(0, 0, w, h);
+	return true;
+}
+
+bool ThumbnailAtlas::downscale(Image* src, unsigned char* dst, int dstStride, int w, int h){
+	int bpp;
+	switch (src->getRenderFormat()){
+	case Texture2D::PixelFormat::RGBA8888: bpp = 4; break;
+	case Texture2D::PixelFormat::RGB888: bpp = 3; break;
+	case Texture2D::PixelFormat::AI88: bpp = 2; break;
+	case Texture2D::PixelFormat::I8: bpp = 1; break;
+	default: return false;
+	}
+
+	const unsigned char* data = src->getData();
+	int sw = src->getWidth();
+	int sh = src->getHeight();
+	bool hasAlpha = (bpp == 4 || bpp == 2);
+	bool premultiplied = (hasAlpha && src->hasPremultipliedAlpha());
+
+	// box filter; every destination pixel averages the source block it covers
+	for (int y = 0; y < h; y++){
+		int y0 = y * sh / h;
+		int y1 = MAX((y + 1) * sh / h, y0 + 1);
+		unsigned char* out = dst + y * dstStride;
+		for (int x = 0; x < w; x++){
+			int x0 = x * sw / w;
+			int x1 = MAX((x + 1) * sw / w, x0 + 1);
+			unsigned int sum[4] = { 0, 0, 0, 0 };
+			for (int sy = y0; sy < y1; sy++){
+				const unsigned char* p = data + ((size_t)sy * sw + x0) * bpp;
+				for (int sx = x0; sx < x1; sx++, p += bpp){
+					// grayscale sources expand to rgba like the rest
+					if (bpp >= 3){
+						sum[0] += p[0];
+						sum[1] += p[1];
+						sum[2] += p[2];
+					}
+					else{
+						sum[0] += p[0];
+						sum[1] += p[0];
+						sum[2] += p[0];
+					}
+					sum[3] += hasAlpha ? p[bpp - 1] : 255;
+				}
+			}
+			unsigned int n = (y1 - y0) * (x1 - x0);
+			unsigned int a = sum[3] / n;
+			for (int c = 0; c < 3; c++){
+				unsigned int v = sum[c] / n;
+				if (premultiplied){
+					v = a ? MIN(v * 255 / a, 255u) : 0;
+				}
+				out[x * 4 + c] = (unsigned char)v;
+			}
+			out[x * 4 + 3] = (unsigned char)a;
+		}
+	}
+	return true;
+}
+
+SpriteFrame* ThumbnailAtlas::findThumbnail(const std::string& key){
+	auto fn = _entries.find(key);
+	if (fn == _entries.end()){
+		return nullptr;
+	}
+	Texture2D* texture = loadPage(fn->second.page);
+	if (texture == nullptr){
+		_entries.erase(fn);
+		return nullptr;
+	}
+	return SpriteFrame::createWithTexture(texture, CC_RECT_PIXELS_TO_POINTS(fn->second.rect));
+}
+
+void ThumbnailAtlas::request(const std::string& filename, const std::string& zipname, const std::string& password, int width, int height, const std::string& key, const std::string& prefix){
+	if (!_pending.insert(key).second){
+		return;
+	}
+
+	ThumbnailRequest req = { key, prefix, filename, zipname, password, width, height };
+	_queueMutex.lock();
+	_requests.push_back(req);
+	_queueMutex.unlock();
+	_sleepCondition.notify_one();
+}
+
+SpriteFrame* ThumbnailAtlas::getThumbnail(const std::string& filename, const std::string& zipname, const std::string& password, int width, int height){
+	if (!_indexLoaded){
+		loadIndex();
+	}
+
+	string prefix = makeKey(filename, zipname, width, height);
+	string key = prefix + "|" + sourceStamp(filename, zipname);
+	SpriteFrame* frame = findThumbnail(key);
+	if (frame == nullptr){
+		request(filename, zipname, password, width, height, key, prefix);
+	}
+	return frame;
+}
+
+void ThumbnailAtlas::setThumbnail(Sprite* sprite, const std::string& filename, const std::string& zipname, const std::string& password, int width, int height){
+	if (!_indexLoaded){
+		loadIndex();
+	}
+
+	string prefix = makeKey(filename, zipname, width, height);
+	string key = prefix + "|" + sourceStamp(filename, zipname);
+	SpriteFrame* frame = findThumbnail(key);
+	if (frame){
+		sprite->setSpriteFrame(frame);
+		return;
+	}
+
+	sprite->retain();
+	_waiting.insert(std::make_pair(key, sprite));
+	request(filename, zipname, password, width, height, key, prefix);
+}
+
+// on the GL thread: packs a thumbnail made by loadThread into a page
+SpriteFrame* ThumbnailAtlas::addThumbnail(const ThumbnailResponse& response){
+	int w = response.w;
+	int h = response.h;
+	int pageIndex;
+	Rect rect;
+	if (response.pixels == nullptr || !allocate(w, h, &pageIndex, &rect)){
+		return nullptr;
+	}
+
+	Texture2D* texture = loadPage(pageIndex);
+	ThumbnailPage& page = _pages[pageIndex];
+	if (texture == nullptr || page.pixels == nullptr){
+		return nullptr;
+	}
+	int x = (int)rect.origin.x;
+	int y = (int)rect.origin.y;
+	for (int row = 0; row < h; row++){
+		memcpy(page.pixels + ((size_t)(y + row) * THUMBNAIL_PAGE_SIZE + x) * 4, response.pixels + row * w * 4, w * 4);
+	}
+	texture->updateWithData(response.pixels, x, y, w, h);
+
+	// thumbnails of an older version of the source are never asked for again
+	const string& prefix = response.request.prefix;
+	for (auto it = _entries.lower_bound(prefix); it != _entries.end() && it->first.compare(0, prefix.length(), prefix) == 0;){
+		if (it->first.length() == prefix.length() || it->first[prefix.length()] == '|'){
+			it = _entries.erase(it);
+		}
+		else{
+			++it;
+		}
+	}
+
+	ThumbnailEntry entry = { pageIndex, rect };
+	_entries[response.request.key] = entry;
+	page.dirty = true;
+	_dirty = true;
+	_idleTime = 0;
+
+	return SpriteFrame::createWithTexture(texture, CC_RECT_PIXELS_TO_POINTS(rect));
+}
+
+void ThumbnailAtlas::loadThread(){
+	while (1){
+		if (_closeThread){
+			break;
+		}
+		_queueMutex.lock();
+		if (_requests.size() == 0){
+			_queueMutex.unlock();
+			std::unique_lock<std::mutex> lk(_sleepMutex);
+			_sleepCondition.wait_for(lk, std::chrono::milliseconds(100));
+			continue;
+		}
+		ThumbnailRequest req = _requests.front();
+		_requests.pop_front();
+		_queueMutex.unlock();
+
+		ThumbnailResponse response = { req, nullptr, 0, 0 };
+		Image* image = TextureStreamer::loadLevelImage(req.filename, req.zipname, req.password, 0);
+		if (image){
+			float scale = MIN(MIN((float)req.width / image->getWidth(), (float)req.height / image->getHeight()), 1.0f);
+			response.w = MAX((int)(image->getWidth() * scale + 0.5f), 1);
+			response.h = MAX((int)(image->getHeight() * scale + 0.5f), 1);
+			response.pixels = (unsigned char*)malloc(response.w * response.h * 4);
+			if (!downscale(image, response.pixels, response.w * 4, response.w, response.h)){
+				free(response.pixels);
+				response.pixels = nullptr;
+			}
+			image->release();
+		}
+
+		_queueMutex.lock();
+		_responses.push_back(response);
+		_queueMutex.unlock();
+	}
+}
+
+// Live thumbnails against the area the shelves have used up so far
+bool ThumbnailAtlas::needsCompaction(){
+	if (_pages.size() < 2){
+		return false;
+	}
+
+	size_t live = 0;
+	for (auto& it : _entries){
+		live += (size_t)(it.second.rect.size.width + THUMBNAIL_PADDING) * (it.second.rect.size.height + THUMBNAIL_PADDING);
+	}
+	const ThumbnailPage& last = _pages.back();
+	size_t used = (_pages.size() - 1) * (size_t)THUMBNAIL_PAGE_SIZE * THUMBNAIL_PAGE_SIZE
+		+ (size_t)MIN(last.shelfY + last.shelfHeight, THUMBNAIL_PAGE_SIZE) * THUMBNAIL_PAGE_SIZE;
+	return live * 2 < used;
+}
+
+void ThumbnailAtlas::compact(){
+	// every old page has to be in memory, the new ones are written over them
+	std::vector<ThumbnailPage> old;
+	old.swap(_pages);
+	for (size_t i = 0; i < old.size(); i++){
+		if (old[i].pixels == nullptr){
+			Data data = FileUtils::getInstance()->getDataFromFile(pagePath(i));
+			if (data.getSize() == THUMBNAIL_PAGE_BYTES){
+				old[i].pixels = (unsigned char*)malloc(THUMBNAIL_PAGE_BYTES);
+				memcpy(old[i].pixels, data.getBytes(), THUMBNAIL_PAGE_BYTES);
+			}
+		}
+	}
+
+	// tallest first keeps the shelves tight
+	std::vector<std::pair<string, ThumbnailEntry> > live(_entries.begin(), _entries.end());
+	std::sort(live.begin(), live.end(), [](const std::pair<string, ThumbnailEntry>& a, const std::pair<string, ThumbnailEntry>& b){
+		return a.second.rect.size.height > b.second.rect.size.height;
+	});
+
+	_entries.clear();
+	for (auto& it : live){
+		const unsigned char* src = old[it.second.page].pixels;
+		int w = (int)it.second.rect.size.width;
+		int h = (int)it.second.rect.size.height;
+		ThumbnailEntry entry;
+		if (src == nullptr || !allocate(w, h, &entry.page, &entry.rect)){
+			continue;
+		}
+
+		ThumbnailPage& page = _pages[entry.page];
+		int sx = (int)it.second.rect.origin.x, sy = (int)it.second.rect.origin.y;
+		int dx = (int)entry.rect.origin.x, dy = (int)entry.rect.origin.y;
+		for (int row = 0; row < h; row++){
+			memcpy(page.pixels + ((size_t)(dy + row) * THUMBNAIL_PAGE_SIZE + dx) * 4,
+				src + ((size_t)(sy + row) * THUMBNAIL_PAGE_SIZE + sx) * 4, w * 4);
+		}
+		page.dirty = true;
+		_entries[it.first] = entry;
+	}
+
+	// frames handed out before keep the old textures alive until they go
+	for (auto& page : old){
+		CC_SAFE_RELEASE(page.texture);
+		free(page.pixels);
+	}
+	for (size_t i = _pages.size(); i < old.size(); i++){
+		FileUtils::getInstance()->removeFile(pagePath(i));
+	}
+	_dirty = true;
+}
+
+void ThumbnailAtlas::flush(){
+	if (!_dirty){
+		return;
+	}
+	if (!FileUtils::getInstance()->isDirectoryExist(_directory)){
+		FileUtils::getInstance()->createDirectory(_directory);
+	}
+
+	for (size_t i = 0; i < _pages.size(); i++){
+		ThumbnailPage& page = _pages[i];
+		if (!page.dirty || page.pixels == nullptr){
+			continue;
+		}
+		FILE* fp = fopen(FileUtils::getInstance()->getSuitableFOpen(pagePath(i)).c_str(), "wb");
+		if (fp == nullptr){
+			CCLOG("ThumbnailAtlas: cannot write %s", pagePath(i).c_str());
+			return;
+		}
+		fwrite(page.pixels, 1, THUMBNAIL_PAGE_BYTES, fp);
+		fclose(fp);
+		page.dirty = false;
+	}
+
+	// full pages only need their file from now on
+	for (size_t i = 0; i + 1 < _pages.size(); i++){
+		ThumbnailPage& page = _pages[i];
+		if (!page.dirty && page.pixels){
+			free(page.pixels);
+			page.pixels = nullptr;
+		}
+	}
+
+	std::stringstream ss;
+	if (_pages.size() > 0){
+		ThumbnailPage& last = _pages.back();
+		ss << "pages " << _pages.size() << " " << last.shelfX << " " << last.shelfY << " " << last.shelfHeight << "\n";
+	}
+	else{
+		ss << "pages 0 0 0 0\n";
+	}
+	for (auto& it : _entries){
+		ss << it.first << "\t" << it.second.page << "\t"
+			<< (int)it.second.rect.origin.x << "\t" << (int)it.second.rect.origin.y << "\t"
+			<< (int)it.second.rect.size.width << "\t" << (int)it.second.rect.size.height << "\n";
+	}
+	FileUtils::getInstance()->writeStringToFile(ss.str(), _directory + "index.txt");
+
+	_dirty = false;
+}
+
+void ThumbnailAtlas::clear(){
+	for (auto& page : _pages){
+		CC_SAFE_RELEASE(page.texture);
+		free(page.pixels);
+	}
+	_pages.clear();
+	_entries.clear();
+	_dirty = false;
+	_indexLoaded = true;
+
+	if (FileUtils::getInstance()->isDirectoryExist(_directory)){
+		FileUtils::getInstance()->removeDirectory(_directory);
+	}
+}
+
+void ThumbnailAtlas::update(float dt){
+	if (_responses.size() > 0){
+		_queueMutex.lock();
+		ThumbnailResponse response = _responses.front();
+		_responses.pop_front();
+		_queueMutex.unlock();
+
+		SpriteFrame* frame = addThumbnail(response);
+		free(response.pixels);
+
+		const string& key = response.request.key;
+		_pending.erase(key);
+		auto range = _waiting.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it){
+			if (frame){
+				it->second->setSpriteFrame(frame);
+			}
+			it->second->release();
+		}
+		_waiting.erase(range.first, range.second);
+	}
+
+	if (!_dirty){
+		return;
+	}
+	_idleTime += dt;
+	if (_idleTime >= THUMBNAIL_FLUSH_DELAY){
+		if (needsCompaction()){
+			compact();
+		}
+		flush();
+	}
+}
@@ -0,0 +1,121 @@
+#ifndef _THUMBNAIL_ATLAS_H_
+#define _THUMBNAIL_ATLAS_H_
+
+#include "cocos2d.h"
+
+#include <deque>
+#include <set>
+
+using namespace std;
+using namespace cocos2d;
+
+// Downscaled copies of CGs packed into shared atlas pages, so gallery and
+// save/load screens bind one or two textures instead of decoding every full
+// image. A thumbnail is generated on a background thread the first time it is
+// asked for; pages and their index are kept under <writable path>/thumbs/ and
+// reused afterwards. Once thumbnails of replaced sources leave more than half
+// of the pages unused, the rest are packed again into fewer pages.
+//
+// Pages are stored as raw, non premultiplied RGBA8888 so loading them back is
+// a plain read + upload with no image decoding at all. Keys carry a stamp of
+// the source (zip entry crc, or file time and size) so a CG replaced by an
+// update gets a new thumbnail.
+
+#define THUMBNAIL_PAGE_SIZE 1024
+
+typedef struct ThumbnailEntry_{
+	int page;
+	Rect rect;	// in pixels
+} ThumbnailEntry;
+
+typedef struct ThumbnailPage_{
+	Texture2D* texture;
+	unsigned char* pixels;	// kept while the page has room or is not written yet
+	int shelfX;
+	int shelfY;
+	int shelfHeight;
+	bool dirty;
+} ThumbnailPage;
+
+typedef struct ThumbnailRequest_{
+	std::string key;
+	std::string prefix;	// the key without the source stamp
+	std::string filename;
+	std::string zipname;
+	std::string password;
+	int width;
+	int height;
+} ThumbnailRequest;
+
+typedef struct ThumbnailResponse_{
+	ThumbnailRequest request;
+	unsigned char* pixels;	// w x h RGBA8888, nullptr when the source failed
+	int w;
+	int h;
+} ThumbnailResponse;
+
+class ThumbnailAtlas : public Ref{
+private:
+	std::string _directory;
+	std::map<string, ThumbnailEntry> _entries;
+	std::vector<ThumbnailPage> _pages;
+	bool _indexLoaded;
+	bool _dirty;
+	float _idleTime;
+	EventListenerCustom* _resetListener;
+
+	bool _closeThread;
+	std::thread* _thread;
+	std::deque<ThumbnailRequest> _requests;
+	std::deque<ThumbnailResponse> _responses;
+	std::mutex _queueMutex;
+	std::mutex _sleepMutex;
+	std::condition_variable _sleepCondition;
+
+	// keys queued or being generated, and the sprites waiting for them
+	std::set<string> _pending;
+	std::multimap<string, Sprite*> _waiting;
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+	EventListenerCustom* _rendererRecreatedListener;
+	void reloadPages();
+#endif
+
+	void loadIndex();
+	Texture2D* loadPage(int page);
+	bool uploadPage(int page);
+	bool allocate(int w, int h, int* page, Rect* rect);
+	std::string pagePath(int page);
+	SpriteFrame* findThumbnail(const std::string& key);
+	SpriteFrame* addThumbnail(const ThumbnailResponse& response);
+	void request(const std::string& filename, const std::string& zipname, const std::string& password, int width, int height, const std::string& key, const std::string& prefix);
+	bool needsCompaction();
+	void compact();
+	void loadThread();
+
+	static std::string makeKey(const std::string& filename, const std::string& zipname, int width, int height);
+	static std::string sourceStamp(const std::string& filename, const std::string& zipname);
+	static Image* loadSource(const std::string& filename, const std::string& zipname, const std::string& password);
+	static bool downscale(Image* src, unsigned char* dst, int dstStride, int w, int h);
+
+public:
+	ThumbnailAtlas();
+	virtual ~ThumbnailAtlas();
+
+	// returns a frame no larger than width x height, keeping the aspect ratio,
+	// or nullptr while it is still being generated
+	SpriteFrame* getThumbnail(const std::string& filename, const std::string& zipname, const std::string& password, int width, int height);
+	// shows the thumbnail on 'sprite' now or as soon as it is generated
+	void setThumbnail(Sprite* sprite, const std::string& filename, const std::string& zipname, const std::string& password, int width, int height);
+
+	void flush();
+	void clear();
+
+	virtual void update(float dt);
+
+public:
+	static ThumbnailAtlas* getInstance();
+	static bool hasInstance();
+	static void purge();
+};
+
+#endif
@@ -15,6 +15,10 @@ extern "C" {
 
 #include "ATL.h"
 #include "SpriteAsync.h"
+#include "StreamingSprite.h"
+#include "TextureStreamer.h"
+#include "ThumbnailAtlas.h"
+#include "AssetBinary.h"
 
 #include <cctype>
 #include <locale>
@@ -69,6 +73,9 @@ public:
 		for (; b != e;b++){
 			unzClose(b->second);
 		}
+		for (auto buffer : _buffers){
+			delete []buffer;
+		}
 	}
 
 	unzFile fileptr(string str){
@@ -81,8 +88,14 @@ public:
 	void add(string str, unzFile f){
 		_cache[str] = f;
 	}
+
+	// a zip opened from memory reads from the buffer for as long as it is open
+	void keep(const unsigned char* buffer){
+		_buffers.push_back(buffer);
+	}
 private:
 	map <string, unzFile> _cache;
+	vector <const unsigned char*> _buffers;
 };
 
 _ZIP_LOAD_ ZIP_LOAD;
@@ -90,6 +103,64 @@ std::mutex _ZIP_LOAD_MUTEX;
 
 using namespace cocos2d;
 
+// the handle stays in ZIP_LOAD; call with _ZIP_LOAD_MUTEX held
+static unzFile openZipCached(const std::string& zipFilePath)
+{
+	unzFile file = ZIP_LOAD.fileptr(zipFilePath);
+	if (file == nullptr){
+		if (zipFilePath.at(0) == '/'){
+			file = unzOpen(zipFilePath.c_str());
+		}
+		else{
+			auto files = FileUtils::getInstance();
+			if (files->isFileExist(files->getWritablePath() + zipFilePath)){
+				string __file = files->getWritablePath() + zipFilePath;
+				file = unzOpen(__file.c_str());
+			}
+			else{
+				ssize_t __size;
+				const unsigned char* pBuffer = FileUtils::getInstance()->getFileData(zipFilePath, "rb", &__size);
+				file = unzOpenBuffer(pBuffer, __size);
+				ZIP_LOAD.keep(pBuffer);
+			}
+		}
+		ZIP_LOAD.add(zipFilePath, file);
+	}
+	return file;
+}
+
+bool getFileInfoFromZip(const std::string& zipFilePath, const std::string& filename, unsigned long* crc, unsigned long* size)
+{
+	_ZIP_LOAD_MUTEX.lock();
+
+	bool found = false;
+	do
+	{
+		CC_BREAK_IF(zipFilePath.empty());
+		unzFile file = openZipCached(zipFilePath);
+		CC_BREAK_IF(!file);
+
+#ifdef MINIZIP_FROM_SYSTEM
+		int ret = unzLocateFile(file, filename.c_str(), NULL);
+#else
+		int ret = unzLocateFile(file, filename.c_str(), 1);
+#endif
+		CC_BREAK_IF(UNZ_OK != ret);
+
+		unz_file_info fileInfo;
+		ret = unzGetCurrentFileInfo(file, &fileInfo, nullptr, 0, nullptr, 0, nullptr, 0);
+		CC_BREAK_IF(UNZ_OK != ret);
+
+		*crc = fileInfo.crc;
+		*size = fileInfo.uncompressed_size;
+		found = true;
+	} while (0);
+
+	_ZIP_LOAD_MUTEX.unlock();
+
+	return found;
+}
+
 unsigned char* getFileDataFromZipWithPassword(const std::string& zipFilePath, const std::string& filename, const std::string& password, ssize_t *size)
 {
 	_ZIP_LOAD_MUTEX.lock();
@@ -100,36 +171,10 @@ unsigned char* getFileDataFromZipWithPassword(const std::string& zipFilePath, co
 	unzFile file = nullptr;
 	*size = 0;
 
-	const unsigned char * pBuffer = nullptr;
 	do
 	{
 		CC_BREAK_IF(zipFilePath.empty());
-		file = ZIP_LOAD.fileptr(zipFilePath);
-		if (file == nullptr){
-			//CCLog("###getFileDataFromZipWithPassword > 2 > %f", utils::gettime() - start);
-			if (zipFilePath.at(0) == '/'){
-				file = unzOpen(zipFilePath.c_str());
-				//CCLog("###getFileDataFromZipWithPassword > 3-1 > %f", utils::gettime() - start);
-			}
-			else{
-				auto files = FileUtils::getInstance();
-				if (files->isFileExist(files->getWritablePath() + zipFilePath)){
-					string __file = files->getWritablePath() + zipFilePath;
-					file = unzOpen(__file.c_str());
-					//CCLog("###getFileDataFromZipWithPassword > 3-2 > %f", utils::gettime() - start);
-				}
-				else{
-					ssize_t __size;
-					pBuffer = FileUtils::getInstance()->getFileData(zipFilePath, "rb", &__size);
-					//CCLog("###getFileDataFromZipWithPassword > 3-3 > %f", utils::gettime() - start);
-					file = unzOpenBuffer(pBuffer, __size);
-					//CCLog("###getFileDataFromZipWithPassword > 3-31 > %f", utils::gettime() - start);
-				}
-			}
-			ZIP_LOAD.add(zipFilePath, file);
-		}
-
-		
+		file = openZipCached(zipFilePath);
 		CC_BREAK_IF(!file);
 		//CCLog("###getFileDataFromZipWithPassword > 4 > %f", utils::gettime() - start);
 
@@ -163,8 +208,6 @@ unsigned char* getFileDataFromZipWithPassword(const std::string& zipFilePath, co
 		//CCLog("###getFileDataFromZipWithPassword > 9 > %f", utils::gettime() - start);
 	} while (0);
 
-	if (pBuffer)
-		delete []pBuffer;
 	_ZIP_LOAD_MUTEX.unlock();
 
 	return buffer;
@@ -339,6 +382,98 @@ int CreateSpriteAsync(lua_State *L){
 	toluafix_pushusertype_ccobject(L, nID, pLuaID, (void*)tolua_ret, "cc.Sprite");
 	return 1;
 }
+
+int CreateStreamingSprite(lua_State *L){
+	const char *filename = luaL_checklstring(L, 1, NULL);
+	string ZIP = tolua_tocppstring(L, 2, "");
+	string password = tolua_tocppstring(L, 3, "");
+	int levels = (int)luaL_optinteger(L, 4, 3);
+	Size fullSize(luaL_optnumber(L, 5, 0), luaL_optnumber(L, 6, 0));
+
+	StreamingSprite* tolua_ret = StreamingSprite::create(filename, ZIP.c_str(), password.c_str(), levels, fullSize);
+
+	int nID = (tolua_ret) ? (int)tolua_ret->_ID : -1;
+	int* pLuaID = (tolua_ret) ? &tolua_ret->_luaID : NULL;
+	toluafix_pushusertype_ccobject(L, nID, pLuaID, (void*)tolua_ret, "cc.Sprite");
+	return 1;
+}
+
+int SetTextureStreamingBudget(lua_State *L){
+	double mbytes = luaL_checknumber(L, 1);
+	TextureStreamer::getInstance()->setBudget((size_t)(mbytes * 1024 * 1024));
+	return 0;
+}
+
+int GetThumbnail(lua_State *L){
+	const char *filename = luaL_checklstring(L, 1, NULL);
+	string ZIP = tolua_tocppstring(L, 2, "");
+	string password = tolua_tocppstring(L, 3, "");
+	int width = (int)luaL_checkinteger(L, 4);
+	int height = (int)luaL_checkinteger(L, 5);
+
+	// nil while the thumbnail is generated in the background
+	SpriteFrame* tolua_ret = ThumbnailAtlas::getInstance()->getThumbnail(filename, ZIP, password, width, height);
+
+	int nID = (tolua_ret) ? (int)tolua_ret->_ID : -1;
+	int* pLuaID = (tolua_ret) ? &tolua_ret->_luaID : NULL;
+	toluafix_pushusertype_ccobject(L, nID, pLuaID, (void*)tolua_ret, "cc.SpriteFrame");
+	return 1;
+}
+
+int CreateThumbnailSprite(lua_State *L){
+	const char *filename = luaL_checklstring(L, 1, NULL);
+	string ZIP = tolua_tocppstring(L, 2, "");
+	string password = tolua_tocppstring(L, 3, "");
+	int width = (int)luaL_checkinteger(L, 4);
+	int height = (int)luaL_checkinteger(L, 5);
+
+	// empty until the thumbnail is generated, if it isn't yet
+	Sprite* tolua_ret = Sprite::create();
+	ThumbnailAtlas::getInstance()->setThumbnail(tolua_ret, filename, ZIP, password, width, height);
+
+	int nID = (tolua_ret) ? (int)tolua_ret->_ID : -1;
+	int* pLuaID = (tolua_ret) ? &tolua_ret->_luaID : NULL;
+	toluafix_pushusertype_ccobject(L, nID, pLuaID, (void*)tolua_ret, "cc.Sprite");
+	return 1;
+}
+
+int FlushThumbnails(lua_State *L){
+	ThumbnailAtlas::getInstance()->flush();
+	return 0;
+}
+
+int ClearThumbnails(lua_State *L){
+	ThumbnailAtlas::getInstance()->clear();
+	return 0;
+}
+int CreateParticleFromBinary(lua_State *L){
+	const char *filename = luaL_checklstring(L, 1, NULL);
+
+	ParticleSystemQuad* tolua_ret = AssetBinary::getInstance()->createParticle(filename);
+
+	int nID = (tolua_ret) ? (int)tolua_ret->_ID : -1;
+	int* pLuaID = (tolua_ret) ? &tolua_ret->_luaID : NULL;
+	toluafix_pushusertype_ccobject(L, nID, pLuaID, (void*)tolua_ret, "cc.ParticleSystemQuad");
+	return 1;
+}
+
+int CreateActorFromBinary(lua_State *L){
+	const char *filename = luaL_checklstring(L, 1, NULL);
+	const char *actor = luaL_checklstring(L, 2, NULL);
+	const char *state = luaL_checklstring(L, 3, NULL);
+
+	Node* tolua_ret = AssetBinary::getInstance()->createActorState(filename, actor, state);
+
+	int nID = (tolua_ret) ? (int)tolua_ret->_ID : -1;
+	int* pLuaID = (tolua_ret) ? &tolua_ret->_luaID : NULL;
+	toluafix_pushusertype_ccobject(L, nID, pLuaID, (void*)tolua_ret, "cc.Node");
+	return 1;
+}
+
+int ClearAssetBinaries(lua_State *L){
+	AssetBinary::getInstance()->clear();
+	return 0;
+}
 int loadSpriteFromZip(lua_State *L){
 	double start = utils::gettime();
 
@@ -936,6 +1071,15 @@ extern "C" {
 		{ "extractZipTempFile", ExtractZipTempFile },
 		{ "updateBlend", updateBlend },
 		{ "CreateSpriteAsync", CreateSpriteAsync },
+		{ "CreateStreamingSprite", CreateStreamingSprite },
+		{ "SetTextureStreamingBudget", SetTextureStreamingBudget },
+		{ "GetThumbnail", GetThumbnail },
+		{ "CreateThumbnailSprite", CreateThumbnailSprite },
+		{ "FlushThumbnails", FlushThumbnails },
+		{ "ClearThumbnails", ClearThumbnails },
+		{ "CreateParticleFromBinary", CreateParticleFromBinary },
+		{ "CreateActorFromBinary", CreateActorFromBinary },
+		{ "ClearAssetBinaries", ClearAssetBinaries },
 		
 		//ATL FOR LUA
 		{ "FAL_registAnimation", FAL_registAnimation },
@@ -12,5 +12,7 @@ extern "C" {
 }
 
 extern unsigned char* getFileDataFromZipWithPassword(const std::string& zipFilePath, const std::string& filename, const std::string& password, ssize_t *size);
+// crc-32 and size from the zip directory, without inflating the entry
+extern bool getFileInfoFromZip(const std::string& zipFilePath, const std::string& filename, unsigned long* crc, unsigned long* size);
 
 #endif
\ No newline at end of file
@@ -31,17 +31,18 @@ SOURCES += main.cpp\
     controller/emotionsetvaluecmd.cpp \
      view/widget/frameinfowidget.cpp \
     view/components/mygraphicsview.cpp \
-    view/components/graphicsscene.cpp \
+    view/components/timelineview.cpp \
+    view/components/previewwidget.cpp \
     model/currentlayermodel.cpp \
     model/currentframemodel.cpp \
     model/layerlistmodel.cpp \
     model/components/layer.cpp \
     lib/geoLib.cpp \
+    lib/characterexporter.cpp \
     model/components/emotion.cpp \
     controller/layeraddcmd.cpp \
     controller/keyframeaddcmd.cpp \
     controller/layerdeletecmd.cpp \
-    view/components/customgraphicsitem.cpp \
     controller/keyframedeletecmd.cpp \
     controller/layerselectcmd.cpp \
     controller/keyframeselectcmd.cpp
@@ -66,17 +67,18 @@ HEADERS  += mainwindow.h\
     controller/emotionsetvaluecmd.h \
      view/widget/frameinfowidget.h \
     view/components/mygraphicsview.h \
-    view/components/graphicsscene.h \
+    view/components/timelineview.h \
+    view/components/previewwidget.h \
     model/currentlayermodel.h \
     model/currentframemodel.h \
     model/layerlistmodel.h \
     model/components/layer.h \
     lib/geoLib.h \
+    lib/characterexporter.h \
     model/components/emotion.h \
     controller/layeraddcmd.h \
     controller/keyframeaddcmd.h \
     controller/layerdeletecmd.h \
-    view/components/customgraphicsitem.h \
     controller/keyframedeletecmd.h \
     controller/layerselectcmd.h \
     controller/keyframeselectcmd.h
@@ -87,4 +89,6 @@ FORMS    += mainwindow.ui \
     frameinfowidget.ui \
 
 INCLUDEPATH += \
-    view/components
+    view/components \
+    ../../novel/VisNovel/frameworks/runtime-src/Classes \
+    ../../novel/VisNovel/frameworks/cocos2d-x/external
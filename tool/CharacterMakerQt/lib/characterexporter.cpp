@@ -0,0 +1,284 @@
+#include "characterexporter.h"
+#include <lib/lib.h>
+
+CharacterExporter::CharacterExporter(QString imageDir, QString outDir)
+	: _imageDir(imageDir),
+	  _outDir(outDir)
+{
+}
+
+bool CharacterExporter::exportTo(QString fileName)
+{
+	QDomDocument document;
+	document.appendChild(document.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"UTF-8\""));
+	QDomElement root = document.createElement("actorList");
+	document.appendChild(root);
+
+	_builder.Clear();
+	std::vector<flatbuffers::Offset<PiniAsset::Actor> > actors;
+
+	for(int i = 0; i < CharacterListModel::shared()->getCharacterListCount(); i++)
+	{
+		Character* pChar = CharacterListModel::shared()->getCharacterByIndex(i);
+		QDomElement cNode = document.createElement("actor");
+		cNode.setAttribute("name", pChar->getCharName());
+		cNode.setAttribute("fontColor",pChar->getFontColor());
+		root.appendChild(cNode);
+
+		std::vector<flatbuffers::Offset<PiniAsset::State> > states;
+		for(int j = 0; j < pChar->getEmotionCount(); j++)
+		{
+			Emotion* pEmotion = pChar->getEmotionByIndex(j);
+			QDomElement eNode = document.createElement("state");
+			eNode.setAttribute("name", pEmotion->getStartState());
+			eNode.setAttribute("onFinish", pEmotion->getFinishState());
+			eNode.setAttribute("totalFrame", pEmotion->getTotalFrame());
+			eNode.setAttribute("frameDelay", pEmotion->getFrameDelay());
+			cNode.appendChild(eNode);
+
+			_layers.clear();
+			exportEmotion(document, eNode, pChar->getCharName() + "_" + pEmotion->getStartState(), pEmotion);
+
+			flatbuffers::Offset<flatbuffers::String> name = _builder.CreateString(pEmotion->getStartState().toStdString());
+			flatbuffers::Offset<flatbuffers::String> onFinish = _builder.CreateString(pEmotion->getFinishState().toStdString());
+			flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<PiniAsset::Layer> > > layers = _builder.CreateVector(_layers);
+			states.push_back(PiniAsset::CreateState(_builder, name, onFinish, pEmotion->getTotalFrame(), pEmotion->getFrameDelay(), layers));
+		}
+
+		flatbuffers::Offset<flatbuffers::String> name = _builder.CreateString(pChar->getCharName().toStdString());
+		flatbuffers::Offset<flatbuffers::String> fontColor = _builder.CreateString(pChar->getFontColor().toStdString());
+		actors.push_back(PiniAsset::CreateActor(_builder, name, fontColor, _builder.CreateVector(states)));
+	}
+
+	flatbuffers::Offset<PiniAsset::Asset> asset = PiniAsset::CreateAsset(_builder, ASSET_BINARY_VERSION, 0, _builder.CreateVector(actors));
+	if(!writeBinary(QFileInfo(fileName).completeBaseName() + ".pnas", asset))
+		return false;
+
+	QFile file(QDir(_outDir).filePath(fileName));
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qDebug() << "Failed to open file";
+		return false;
+	}
+
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	stream << document.toString();
+	file.close();
+	return true;
+}
+
+// Layers keep their order, so only neighbouring static layers can share an
+// image without an animated one ending up above or below the wrong part.
+void CharacterExporter::exportEmotion(QDomDocument &document, QDomElement &eNode, QString prefix, Emotion* pEmotion)
+{
+	QList<Layer*> run;
+	int flatCount = 0;
+
+	for(int i = 0; i <= pEmotion->getLayerCount(); i++)
+	{
+		Layer* pLayer = i < pEmotion->getLayerCount() ? pEmotion->getLayerByIndex(i) : NULL;
+
+		// without keyframes a layer is never drawn
+		if(pLayer && 0 == pLayer->getkeyFrameCount())
+			continue;
+
+		if(pLayer && isStatic(pLayer))
+		{
+			run.append(pLayer);
+			continue;
+		}
+
+		if(run.count() > 1 &&
+		   flatten(document, eNode, prefix + QString("_flat%1.png").arg(flatCount), run))
+		{
+			flatCount++;
+		}
+		else
+		{
+			for(int j = 0; j < run.count(); j++)
+				appendLayer(document, eNode, run[j]);
+		}
+		run.clear();
+
+		if(pLayer)
+			appendLayer(document, eNode, pLayer);
+	}
+}
+
+void CharacterExporter::appendLayer(QDomDocument &document, QDomElement &eNode, Layer* pLayer)
+{
+	QDomElement lNode = document.createElement("layer");
+	lNode.setAttribute("name", pLayer->getFileName());
+	eNode.appendChild(lNode);
+
+	std::vector<PiniAsset::KeyFrame> keyFrames;
+	for(int i = 0; i < pLayer->getkeyFrameCount(); i++)
+	{
+		KeyFrame* pKeyFrame = pLayer->getKeyFrameByindex(i);
+		QDomElement kNode = document.createElement("keyframe");
+		kNode.setAttribute("frameIndex", pKeyFrame->frameIndex);
+		kNode.setAttribute("rotation", pKeyFrame->rotation);
+		kNode.setAttribute("positionX", pKeyFrame->position.x);
+		kNode.setAttribute("positionY", pKeyFrame->position.y);
+		kNode.setAttribute("scaleX", pKeyFrame->scale.x);
+		kNode.setAttribute("scaleY", pKeyFrame->scale.y);
+		lNode.appendChild(kNode);
+
+		keyFrames.push_back(PiniAsset::KeyFrame(pKeyFrame->frameIndex, pKeyFrame->rotation,
+			PiniAsset::Vec2(pKeyFrame->position.x, pKeyFrame->position.y),
+			PiniAsset::Vec2(pKeyFrame->scale.x, pKeyFrame->scale.y)));
+	}
+
+	appendBinaryLayer(pLayer->getFileName(), false, 0, 0, keyFrames);
+}
+
+void CharacterExporter::appendBinaryLayer(QString name, bool premultiplied, int width, int height, const std::vector<PiniAsset::KeyFrame> &keyFrames)
+{
+	flatbuffers::Offset<flatbuffers::String> nameOffset = _builder.CreateString(name.toStdString());
+	flatbuffers::Offset<flatbuffers::Vector<const PiniAsset::KeyFrame*> > keyFramesOffset = _builder.CreateVectorOfStructs(keyFrames);
+	_layers.push_back(PiniAsset::CreateLayer(_builder, nameOffset, premultiplied, width, height, keyFramesOffset));
+}
+
+bool CharacterExporter::writeBinary(QString fileName, flatbuffers::Offset<PiniAsset::Asset> asset)
+{
+	PiniAsset::FinishAssetBuffer(_builder, asset);
+
+	QFile file(QDir(_outDir).filePath(fileName));
+	if(!file.open(QIODevice::WriteOnly))
+	{
+		qDebug() << "Failed to open file";
+		return false;
+	}
+
+	file.write((const char*)_builder.GetBufferPointer(), _builder.GetSize());
+	file.close();
+	return true;
+}
+
+/*
+ * Draws the layers in stage space (y up, anchors in the middle, rotation
+ * clockwise), trims the transparent border and writes a layer that places
+ * the result where the parts were. Returns false when there is nothing to
+ * draw, the caller then keeps the layers as they are.
+ */
+bool CharacterExporter::flatten(QDomDocument &document, QDomElement &eNode, QString fileName, QList<Layer*> layers)
+{
+	QList<QImage> images;
+	QList<QTransform> transforms;
+	QRectF bounds;
+
+	for(int i = 0; i < layers.count(); i++)
+	{
+		QImage image(QDir(_imageDir).filePath(layers[i]->getFileName()));
+		if(image.isNull())
+		{
+			qDebug() << "Failed to load " << layers[i]->getFileName();
+			return false;
+		}
+
+		// QPainter is y down, so the stage y flips and clockwise stays positive
+		KeyFrame* pKeyFrame = layers[i]->getKeyFrameByindex(0);
+		QTransform transform;
+		transform.translate(pKeyFrame->position.x, -pKeyFrame->position.y);
+		transform.rotate(pKeyFrame->rotation);
+		transform.scale(pKeyFrame->scale.x, pKeyFrame->scale.y);
+		transform.translate(-image.width() / 2.0, -image.height() / 2.0);
+
+		bounds |= transform.mapRect(QRectF(image.rect()));
+		images.append(image);
+		transforms.append(transform);
+	}
+
+	QRect canvasRect = bounds.toAlignedRect();
+	if(canvasRect.isEmpty())
+		return false;
+
+	QImage canvas(canvasRect.size(), QImage::Format_ARGB32_Premultiplied);
+	canvas.fill(Qt::transparent);
+
+	QPainter painter(&canvas);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	for(int i = 0; i < images.count(); i++)
+	{
+		painter.setTransform(transforms[i] * QTransform::fromTranslate(-canvasRect.left(), -canvasRect.top()));
+		painter.drawImage(0, 0, images[i]);
+	}
+	painter.end();
+
+	// trim to the pixels that are not fully transparent
+	int left = canvas.width(), top = canvas.height(), right = -1, bottom = -1;
+	for(int y = 0; y < canvas.height(); y++)
+	{
+		const QRgb* line = (const QRgb*)canvas.constScanLine(y);
+		for(int x = 0; x < canvas.width(); x++)
+		{
+			if(qAlpha(line[x]))
+			{
+				left = qMin(left, x);
+				right = qMax(right, x);
+				top = qMin(top, y);
+				bottom = qMax(bottom, y);
+			}
+		}
+	}
+
+	if(right < 0)
+		return false;
+
+	// PNG stores straight alpha, the runtime loader multiplies it again
+	QRect trim(QPoint(left, top), QPoint(right, bottom));
+	QImage flat = canvas.copy(trim).convertToFormat(QImage::Format_ARGB32);
+	if(!flat.save(QDir(_outDir).filePath(fileName), "PNG"))
+	{
+		qDebug() << "Failed to save " << fileName;
+		return false;
+	}
+
+	QPointF center = QRectF(trim.translated(canvasRect.topLeft())).center();
+	QDomElement lNode = document.createElement("layer");
+	lNode.setAttribute("name", fileName);
+	lNode.setAttribute("width", trim.width());
+	lNode.setAttribute("height", trim.height());
+	eNode.appendChild(lNode);
+
+	QDomElement kNode = document.createElement("keyframe");
+	kNode.setAttribute("frameIndex", 0);
+	kNode.setAttribute("rotation", 0);
+	kNode.setAttribute("positionX", center.x());
+	kNode.setAttribute("positionY", -center.y());
+	kNode.setAttribute("scaleX", 1);
+	kNode.setAttribute("scaleY", 1);
+	lNode.appendChild(kNode);
+
+	std::vector<PiniAsset::KeyFrame> keyFrames;
+	keyFrames.push_back(PiniAsset::KeyFrame(0, 0, PiniAsset::Vec2(center.x(), -center.y()), PiniAsset::Vec2(1, 1)));
+	appendBinaryLayer(fileName, false, trim.width(), trim.height(), keyFrames);
+
+	// the parts that went in, for tools reading the export back
+	for(int i = 0; i < layers.count(); i++)
+	{
+		QDomElement sNode = document.createElement("source");
+		sNode.setAttribute("name", layers[i]->getFileName());
+		lNode.appendChild(sNode);
+	}
+
+	return true;
+}
+
+// Every keyframe holds the same values, so nothing moves across the emotion
+bool CharacterExporter::isStatic(Layer* pLayer)
+{
+	KeyFrame* pFirst = pLayer->getKeyFrameByindex(0);
+
+	for(int i = 1; i < pLayer->getkeyFrameCount(); i++)
+	{
+		KeyFrame* pKeyFrame = pLayer->getKeyFrameByindex(i);
+		if(pKeyFrame->rotation != pFirst->rotation ||
+		   pKeyFrame->position.x != pFirst->position.x || pKeyFrame->position.y != pFirst->position.y ||
+		   pKeyFrame->scale.x != pFirst->scale.x || pKeyFrame->scale.y != pFirst->scale.y)
+			return false;
+	}
+
+	return true;
+}
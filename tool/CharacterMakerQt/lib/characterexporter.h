@@ -0,0 +1,40 @@
+#ifndef CHARACTEREXPORTER_H
+#define CHARACTEREXPORTER_H
+
+#include <QtCore>
+#include <QtXml>
+#include <vector>
+#include "AssetBinaryFormat.h"
+
+class Emotion;
+class Layer;
+
+// Writes the character list for the runtime. Runs of layers that never
+// move within an emotion are drawn into one trimmed image
+// so the runtime draws them as a single sprite. The same list is also
+// written as a flatbuffer (.pnas) that the runtime reads without parsing.
+class CharacterExporter
+{
+public:
+	CharacterExporter(QString imageDir, QString outDir);
+
+	bool exportTo(QString fileName);
+
+private:
+	void exportEmotion(QDomDocument &document, QDomElement &eNode, QString prefix, Emotion* pEmotion);
+	void appendLayer(QDomDocument &document, QDomElement &eNode, Layer* pLayer);
+	void appendBinaryLayer(QString name, bool premultiplied, int width, int height, const std::vector<PiniAsset::KeyFrame> &keyFrames);
+	bool writeBinary(QString fileName, flatbuffers::Offset<PiniAsset::Asset> asset);
+	bool flatten(QDomDocument &document, QDomElement &eNode, QString fileName, QList<Layer*> layers);
+
+	static bool isStatic(Layer* pLayer);
+
+	QString _imageDir;
+	QString _outDir;
+
+	// the layers of the emotion being exported, in the binary
+	flatbuffers::FlatBufferBuilder _builder;
+	std::vector<flatbuffers::Offset<PiniAsset::Layer> > _layers;
+};
+
+#endif // CHARACTEREXPORTER_H
@@ -7,6 +7,8 @@
 #define KEYFRAMESTARTY	30
 #define KEYFRAMESIZEX	15
 #define KEYFRAMESIZEY	30
+#define TIMELINEFRAMES	60
+#define PREVIEWTICKRATE	60	// runtime ticks per second, frameDelay counts these
 
 enum NOTIS{
     UPDATE_CHARACTER,
@@ -19,10 +19,11 @@
 
 #include <lib/consts.h>
 #include <lib/geoLib.h>
+#include <lib/characterexporter.h>
 #include <view/components/iobserver.h>
 #include <view/components/mygraphicsview.h>
-#include <view/components/graphicsscene.h>
-#include <view/components/customgraphicsitem.h>
+#include <view/components/timelineview.h>
+#include <view/components/previewwidget.h>
 
 #include <model/notifier.h>
 #include <model/components/layer.h>
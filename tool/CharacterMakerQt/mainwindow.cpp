@@ -17,6 +17,10 @@ MainWindow::MainWindow(QWidget *parent) :
     frameInfoWidget = new FrameInfoWidget;
     this->addDockWidget(Qt::RightDockWidgetArea, frameInfoWidget);
 
+	previewWidget = new PreviewWidget;
+	ui->scrollArea->setWidget(previewWidget);
+	ui->mainToolBar->addAction(ui->actionPlay);
+
 	QObject::connect(ui->actionExit, SIGNAL(triggered()), this, SLOT(close()));
 
     //ui->verticalLayout->addWidget(timeLineWidget, 0, Qt::AlignBottom);
@@ -76,6 +80,9 @@ void MainWindow::on_actionOpen_triggered()
 		file.close();
 	}
 
+	documentDir = QFileInfo(path).absolutePath();
+	previewWidget->setImageDir(documentDir);
+
 	QDomElement root = document.firstChildElement();
 
 	QDomNodeList actors = root.elementsByTagName("actor");
@@ -212,3 +219,20 @@ void MainWindow::on_actionSave_triggered()
 	}
 
 }
+
+void MainWindow::on_actionExport_triggered()
+{
+	qDebug() << "on_actionExport_triggered" << endl;
+
+	QString dir = QFileDialog::getExistingDirectory(this, "export");
+	if(dir.isEmpty())
+		return;
+
+	CharacterExporter exporter(documentDir, dir);
+	exporter.exportTo("actorList.xml");
+}
+
+void MainWindow::on_actionPlay_toggled(bool checked)
+{
+	previewWidget->setPlaying(checked);
+}
@@ -23,6 +23,8 @@ private slots:
 
 	void on_actionOpen_triggered();
 	void on_actionSave_triggered();
+	void on_actionExport_triggered();
+	void on_actionPlay_toggled(bool checked);
 
 private:
     Ui::MainWindow *ui;
@@ -30,6 +32,9 @@ private:
     Characterlistwidget*    charListWidget;
     TimelineWidget*           timeLineWidget;
     FrameInfoWidget*        frameInfoWidget;
+    PreviewWidget*          previewWidget;
+
+    QString documentDir;
 };
 
 #endif // MAINWINDOW_H
@@ -1,7 +1,20 @@
 #include "layer.h"
 
+#include <algorithm>
+
+static bool keyFrameLess(const KeyFrame* pKeyFrame, int frameIndex)
+{
+	return pKeyFrame->frameIndex < frameIndex;
+}
+
+static bool keyFrameGreater(int frameIndex, const KeyFrame* pKeyFrame)
+{
+	return frameIndex < pKeyFrame->frameIndex;
+}
+
 Layer::Layer(QString fileName)
-    : _fileName(fileName)
+	: _fileName(fileName),
+	  _revision(0)
 {
     _keyFrameList.clear();
 
@@ -9,13 +22,14 @@ Layer::Layer(QString fileName)
 }
 
 Layer::Layer(Layer* pLayerData)
+	: _revision(0)
 {
 	_keyFrameList.clear();
 
 	_fileName = pLayerData->getFileName();
 
-	QLinkedList<KeyFrame*> *pKeyFrameList = pLayerData->getKeyFrameList();
-	QLinkedList<KeyFrame*>::iterator iter = pKeyFrameList->begin();
+	QVector<KeyFrame*> *pKeyFrameList = pLayerData->getKeyFrameList();
+	QVector<KeyFrame*>::iterator iter = pKeyFrameList->begin();
 
 	for(; iter != pKeyFrameList->end(); iter++)
 	{
@@ -27,26 +41,8 @@ Layer::Layer(Layer* pLayerData)
 
 Layer::~Layer()
 {
-	if(!_keyFrameList.empty())
-	{
-		QLinkedList<KeyFrame*>::iterator iter = _keyFrameList.begin();
-		for(; iter != _keyFrameList.end(); iter++)
-		{
-			KeyFrame* pKeyFrame = (*iter);
-			if(pKeyFrame != NULL)
-			{
-				delete pKeyFrame;
-				pKeyFrame = NULL;
-				_keyFrameList.erase(iter);
-			}
-			else
-			{
-				_keyFrameList.erase(iter);
-			}
-
-			iter--;
-		}
-	}
+	qDeleteAll(_keyFrameList);
+	_keyFrameList.clear();
 }
 
 void Layer::setLayerNum(int num)
@@ -71,38 +67,19 @@ QString Layer::getFileName()
 
 KeyFrame* Layer::getKeyFrameByindex(int index)
 {
-    if(_keyFrameList.isEmpty())
+	if(index < 0 || index >= _keyFrameList.count())
         return NULL;
 
-    int i = 0;
-    QLinkedList<KeyFrame*>::iterator iter = _keyFrameList.begin();
-
-    for(; iter != _keyFrameList.end(); iter++)
-    {
-        KeyFrame* pKeyFrame = (*iter);
-
-        if(i == index)
-            return pKeyFrame;
-
-        i++;
-    }
-    return NULL;
+	return _keyFrameList.at(index);
 }
 
 KeyFrame* Layer::getKeyFrameByFrameIndex(int index)
 {
-	if(_keyFrameList.isEmpty())
-		return NULL;
+	int pos = getKeyFrameLowerBound(index);
 
-	QLinkedList<KeyFrame*>::iterator iter = _keyFrameList.begin();
-
-	for(; iter != _keyFrameList.end(); iter++)
-	{
-		KeyFrame* pKeyFrame = (*iter);
+	if(pos < _keyFrameList.count() && _keyFrameList.at(pos)->frameIndex == index)
+		return _keyFrameList.at(pos);
 
-		if(pKeyFrame->frameIndex == index)
-			return pKeyFrame;
-	}
 	return NULL;
 }
 
@@ -111,16 +88,27 @@ int Layer::getkeyFrameCount()
 	return _keyFrameList.count();
 }
 
+// Position of the first keyframe at or after frameIndex
+int Layer::getKeyFrameLowerBound(int frameIndex)
+{
+	return std::lower_bound(_keyFrameList.begin(), _keyFrameList.end(), frameIndex, keyFrameLess)
+			- _keyFrameList.begin();
+}
+
 KeyFrame* Layer::createKeyFrame(int index)
 {
 	KeyFrame* pKeyFrame = new KeyFrame(index);
-	_keyFrameList.append(pKeyFrame);
+	addKeyFrame(pKeyFrame);
 	return pKeyFrame;
 }
 
 void Layer::addKeyFrame(KeyFrame* pkeyFrame)
 {
-    _keyFrameList.append( pkeyFrame);
+	QVector<KeyFrame*>::iterator iter =
+			std::upper_bound(_keyFrameList.begin(), _keyFrameList.end(), pkeyFrame->frameIndex, keyFrameGreater);
+
+	_keyFrameList.insert(iter, pkeyFrame);
+	_revision++;
 }
 
 void Layer::deleteKeyFrame(int index)
@@ -132,10 +120,45 @@ void Layer::deleteKeyFrame(int index)
         _keyFrameList.removeOne(pKeyFrame);
         delete pKeyFrame;
         pKeyFrame = NULL;
+		_revision++;
 	}
 }
 
-QLinkedList<KeyFrame *> *Layer::getKeyFrameList()
+// Values at frameIndex, linear between the keyframes around it the way
+// the runtime ATL plays them, held before the first and after the last.
+bool Layer::getFrameValue(int frameIndex, KeyFrame* pOut)
+{
+	if(_keyFrameList.isEmpty())
+		return false;
+
+	int pos = getKeyFrameLowerBound(frameIndex);
+
+	if(pos == _keyFrameList.count())
+		pos--;
+
+	KeyFrame* pRight = _keyFrameList.at(pos);
+	KeyFrame* pLeft = (pos > 0 && pRight->frameIndex > frameIndex) ? _keyFrameList.at(pos - 1) : pRight;
+
+	float time = 1.0f;
+	int length = pRight->frameIndex - pLeft->frameIndex;
+	if(length != 0)
+		time = qBound(0.0f, (float)(frameIndex - pLeft->frameIndex) / length, 1.0f);
+
+	pOut->frameIndex = frameIndex;
+	pOut->rotation = (1.0f - time) * pLeft->rotation + time * pRight->rotation;
+	pOut->position.x = (1.0f - time) * pLeft->position.x + time * pRight->position.x;
+	pOut->position.y = (1.0f - time) * pLeft->position.y + time * pRight->position.y;
+	pOut->scale.x = (1.0f - time) * pLeft->scale.x + time * pRight->scale.x;
+	pOut->scale.y = (1.0f - time) * pLeft->scale.y + time * pRight->scale.y;
+	return true;
+}
+
+int Layer::getRevision()
+{
+	return _revision;
+}
+
+QVector<KeyFrame *> *Layer::getKeyFrameList()
 {
 	return &_keyFrameList;
 }
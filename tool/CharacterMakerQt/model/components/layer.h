@@ -19,18 +19,25 @@ public:
     KeyFrame* getKeyFrameByindex(int index);
 	KeyFrame* getKeyFrameByFrameIndex(int index);
 	int	getkeyFrameCount();
+	int getKeyFrameLowerBound(int frameIndex);
     void addKeyFrame(KeyFrame* pkeyFrame);
 	KeyFrame* createKeyFrame(int index);
     void deleteKeyFrame(int index);
+	bool getFrameValue(int frameIndex, KeyFrame* pOut);
 
-	QLinkedList<KeyFrame*> *getKeyFrameList();
+	// bumped on every keyframe change, so views can tell what to redraw
+	int getRevision();
+
+	QVector<KeyFrame*> *getKeyFrameList();
 
 private:
 	int _layerNum;
     QString _fileName;
     QString _emotionName;
+	int _revision;
 
-    QLinkedList<KeyFrame*> _keyFrameList;
+	// sorted by frameIndex
+	QVector<KeyFrame*> _keyFrameList;
 };
 
 #endif // LAYER_H
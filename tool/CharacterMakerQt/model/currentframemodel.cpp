@@ -1,6 +1,8 @@
 #include "currentframemodel.h"
 
-CurrentFrameModel::CurrentFrameModel()
+CurrentFrameModel::CurrentFrameModel() :
+	_keyFrameIndex(0),
+	_pKeyFrame(NULL)
 {
 }
 
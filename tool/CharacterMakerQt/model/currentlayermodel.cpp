@@ -1,6 +1,7 @@
 #include "currentlayermodel.h"
 
-CurrentLayerModel::CurrentLayerModel()
+CurrentLayerModel::CurrentLayerModel() :
+	_pLayer(NULL)
 {
 }
 void CurrentLayerModel::setLayer(Layer* pLayer)
@@ -0,0 +1,220 @@
+#include "previewwidget.h"
+#include <lib/lib.h>
+
+static const char* vertexShader =
+	"attribute vec2 a_position;\n"
+	"attribute vec2 a_texCoord;\n"
+	"uniform mat4 u_matrix;\n"
+	"varying vec2 v_texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	v_texCoord = a_texCoord;\n"
+	"	gl_Position = u_matrix * vec4(a_position, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* fragmentShader =
+	"#ifdef GL_ES\n"
+	"precision mediump float;\n"
+	"#endif\n"
+	"uniform sampler2D u_texture;\n"
+	"varying vec2 v_texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture2D(u_texture, v_texCoord);\n"
+	"}\n";
+
+// unit quad around the anchor, v flipped since QImage rows start at the top
+static const GLfloat quadVertices[] = {
+	-0.5f, -0.5f,	0.0f, 1.0f,
+	 0.5f, -0.5f,	1.0f, 1.0f,
+	-0.5f,  0.5f,	0.0f, 0.0f,
+	 0.5f,  0.5f,	1.0f, 0.0f,
+};
+
+PreviewWidget::PreviewWidget(QWidget *parent) :
+	QOpenGLWidget(parent),
+	_quad(QOpenGLBuffer::VertexBuffer),
+	_playing(false),
+	_startFrame(0)
+{
+	CurrentEmotionModel::shared()->addListener(this);
+	CurrentLayerModel::shared()->addListener(this);
+	CurrentFrameModel::shared()->addListener(this);
+
+	connect(this, SIGNAL(frameSwapped()), this, SLOT(onFrameSwapped()));
+}
+
+PreviewWidget::~PreviewWidget()
+{
+	makeCurrent();
+	clearTextures();
+	_quad.destroy();
+	doneCurrent();
+}
+
+void PreviewWidget::setImageDir(QString dir)
+{
+	_imageDir = dir;
+
+	makeCurrent();
+	clearTextures();
+	doneCurrent();
+	update();
+}
+
+void PreviewWidget::setPlaying(bool playing)
+{
+	if(playing == _playing)
+		return;
+
+	if(playing)
+	{
+		_startFrame = getFrameIndex();
+		_clock.start();
+	}
+
+	_playing = playing;
+	update();
+}
+
+bool PreviewWidget::isPlaying()
+{
+	return _playing;
+}
+
+void PreviewWidget::initializeGL()
+{
+	initializeOpenGLFunctions();
+
+	_program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader);
+	_program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader);
+	_program.bindAttributeLocation("a_position", 0);
+	_program.bindAttributeLocation("a_texCoord", 1);
+	if(!_program.link())
+		qDebug() << "preview shader : " << _program.log();
+
+	_quad.create();
+	_quad.bind();
+	_quad.allocate(quadVertices, sizeof(quadVertices));
+	_quad.release();
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void PreviewWidget::resizeGL(int w, int h)
+{
+	// origin in the middle, y up, one unit per pixel like the runtime
+	_projection.setToIdentity();
+	_projection.ortho(-w / 2.0f, w / 2.0f, -h / 2.0f, h / 2.0f, -1.0f, 1.0f);
+}
+
+void PreviewWidget::paintGL()
+{
+	glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	Emotion* pEmotion = CurrentEmotionModel::shared()->getEmotion();
+	if(NULL == pEmotion || 0 == pEmotion->getLayerCount())
+		return;
+
+	int frameIndex = getFrameIndex();
+
+	_program.bind();
+	_program.setUniformValue("u_texture", 0);
+	_quad.bind();
+	_program.enableAttributeArray(0);
+	_program.enableAttributeArray(1);
+	_program.setAttributeBuffer(0, GL_FLOAT, 0, 2, 4 * sizeof(GLfloat));
+	_program.setAttributeBuffer(1, GL_FLOAT, 2 * sizeof(GLfloat), 2, 4 * sizeof(GLfloat));
+
+	for(int i = 0; i < pEmotion->getLayerCount(); i++)
+	{
+		Layer* pLayer = pEmotion->getLayerByIndex(i);
+		KeyFrame value(frameIndex);
+
+		if(!pLayer->getFrameValue(frameIndex, &value))
+			continue;
+
+		QOpenGLTexture* pTexture = getTexture(pLayer->getFileName());
+
+		// rotation is clockwise in the runtime
+		QMatrix4x4 matrix = _projection;
+		matrix.translate(value.position.x, value.position.y);
+		matrix.rotate(-value.rotation, 0.0f, 0.0f, 1.0f);
+		matrix.scale(pTexture->width() * value.scale.x, pTexture->height() * value.scale.y);
+
+		_program.setUniformValue("u_matrix", matrix);
+		pTexture->bind(0);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	_program.disableAttributeArray(0);
+	_program.disableAttributeArray(1);
+	_quad.release();
+	_program.release();
+}
+
+void PreviewWidget::onFrameSwapped()
+{
+	// keep drawing once per vsync while playing
+	if(_playing)
+		update();
+}
+
+void PreviewWidget::onNotice(NOTIS e)
+{
+	Q_UNUSED(e);
+	if(!_playing)
+		update();
+}
+
+int PreviewWidget::getFrameIndex()
+{
+	if(!_playing)
+	{
+		if(CurrentFrameModel::shared()->getKeyFrame())
+			return CurrentFrameModel::shared()->getKeyFrame()->frameIndex;
+
+		return CurrentFrameModel::shared()->getKeyFrameIndex();
+	}
+
+	// counted from the start every time, so late frames never add up to drift
+	Emotion* pEmotion = CurrentEmotionModel::shared()->getEmotion();
+	qint64 ticks = _clock.elapsed() * PREVIEWTICKRATE / 1000;
+	int frameIndex = _startFrame + (int)(ticks / qMax(1, pEmotion->getFrameDelay()));
+
+	if(pEmotion->getTotalFrame() > 0)
+		frameIndex %= pEmotion->getTotalFrame();
+
+	return frameIndex;
+}
+
+QOpenGLTexture* PreviewWidget::getTexture(QString fileName)
+{
+	QOpenGLTexture* pTexture = _textures.value(fileName);
+	if(pTexture)
+		return pTexture;
+
+	QImage image(QDir(_imageDir).filePath(fileName));
+	if(image.isNull())
+	{
+		// keep the part visible until its image is found
+		image = QImage(64, 64, QImage::Format_ARGB32);
+		image.fill(QColor(255, 255, 255, 128));
+	}
+
+	pTexture = new QOpenGLTexture(image, QOpenGLTexture::DontGenerateMipMaps);
+	pTexture->setMinificationFilter(QOpenGLTexture::Linear);
+	pTexture->setMagnificationFilter(QOpenGLTexture::Linear);
+	pTexture->setWrapMode(QOpenGLTexture::ClampToEdge);
+
+	_textures.insert(fileName, pTexture);
+	return pTexture;
+}
+
+void PreviewWidget::clearTextures()
+{
+	qDeleteAll(_textures);
+	_textures.clear();
+}
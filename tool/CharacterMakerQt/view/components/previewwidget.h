@@ -0,0 +1,55 @@
+#ifndef PREVIEWWIDGET_H
+#define PREVIEWWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
+#include <QOpenGLTexture>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <view/components/iobserver.h>
+
+// Draws the current emotion at the selected frame, or plays it back at
+// the emotion's frame delay. Layer images are uploaded once and kept.
+class PreviewWidget : public QOpenGLWidget, protected QOpenGLFunctions, IObserver
+{
+	Q_OBJECT
+
+public:
+	explicit PreviewWidget(QWidget *parent = 0);
+	~PreviewWidget();
+
+	// Where layer file names are looked up, drops the cached textures
+	void setImageDir(QString dir);
+
+	void setPlaying(bool playing);
+	bool isPlaying();
+
+protected:
+	void initializeGL();
+	void resizeGL(int w, int h);
+	void paintGL();
+
+private slots:
+	void onFrameSwapped();
+
+private:
+	void onNotice(NOTIS e);
+	int getFrameIndex();
+	QOpenGLTexture* getTexture(QString fileName);
+	void clearTextures();
+
+	QOpenGLShaderProgram _program;
+	QOpenGLBuffer _quad;
+	QHash<QString, QOpenGLTexture*> _textures;
+	QString _imageDir;
+	QMatrix4x4 _projection;
+
+	bool _playing;
+	int _startFrame;
+	QElapsedTimer _clock;
+};
+
+#endif // PREVIEWWIDGET_H
@@ -0,0 +1,244 @@
+#include "timelineview.h"
+#include <lib/lib.h>
+
+#include <QScrollBar>
+
+TimelineView::TimelineView(QWidget *parent) :
+	QAbstractScrollArea(parent),
+	_pEmotion(NULL),
+	_frameCount(0),
+	_pCurrentLayer(NULL),
+	_currentFrame(-1)
+{
+	viewport()->setBackgroundRole(QPalette::Base);
+	horizontalScrollBar()->setSingleStep(KEYFRAMESIZEX);
+	verticalScrollBar()->setSingleStep(KEYFRAMESIZEY);
+}
+
+int TimelineView::getFrameCount()
+{
+	Emotion* pEmotion = CurrentEmotionModel::shared()->getEmotion();
+	if(NULL == pEmotion)
+		return 0;
+
+	return qMax(TIMELINEFRAMES, pEmotion->getTotalFrame());
+}
+
+int TimelineView::getCurrentFrame()
+{
+	if(NULL == CurrentLayerModel::shared()->getLayer())
+		return -1;
+
+	if(CurrentFrameModel::shared()->getKeyFrame())
+		return CurrentFrameModel::shared()->getKeyFrame()->frameIndex;
+
+	return CurrentFrameModel::shared()->getKeyFrameIndex();
+}
+
+QRect TimelineView::rowRect(int layerIndex)
+{
+	int y = KEYFRAMESTARTY + layerIndex * KEYFRAMESIZEY - verticalScrollBar()->value();
+	return QRect(0, y, viewport()->width(), KEYFRAMESIZEY);
+}
+
+QRect TimelineView::columnRect(int frameIndex)
+{
+	int x = KEYFRAMESTARTX + frameIndex * KEYFRAMESIZEX - horizontalScrollBar()->value();
+	return QRect(x, 0, KEYFRAMESIZEX, viewport()->height());
+}
+
+void TimelineView::updateScrollBars()
+{
+	int width = KEYFRAMESTARTX + _frameCount * KEYFRAMESIZEX;
+	int height = KEYFRAMESTARTY + _rows.count() * KEYFRAMESIZEY;
+	QSize size = viewport()->size();
+
+	horizontalScrollBar()->setPageStep(size.width());
+	horizontalScrollBar()->setRange(0, qMax(0, width - size.width()));
+	verticalScrollBar()->setPageStep(size.height());
+	verticalScrollBar()->setRange(0, qMax(0, height - size.height()));
+}
+
+void TimelineView::refresh()
+{
+	Emotion* pEmotion = CurrentEmotionModel::shared()->getEmotion();
+	int layerCount = pEmotion ? pEmotion->getLayerCount() : 0;
+	int frameCount = getFrameCount();
+	bool all = false;
+
+	// another emotion, or layers came and went: everything moves
+	if(pEmotion != _pEmotion || frameCount != _frameCount || layerCount != _rows.count())
+	{
+		_pEmotion = pEmotion;
+		_frameCount = frameCount;
+		_rows.resize(layerCount);
+		_revisions.resize(layerCount);
+		all = true;
+	}
+
+	for(int i = 0; i < layerCount; i++)
+	{
+		Layer* pLayer = pEmotion->getLayerByIndex(i);
+		if(all || _rows[i] != pLayer || _revisions[i] != pLayer->getRevision())
+		{
+			viewport()->update(rowRect(i));
+			_rows[i] = pLayer;
+			_revisions[i] = pLayer->getRevision();
+		}
+	}
+
+	Layer* pCurrentLayer = CurrentLayerModel::shared()->getLayer();
+	if(pCurrentLayer != _pCurrentLayer)
+	{
+		// the highlighted name
+		int oldIndex = _rows.indexOf(_pCurrentLayer);
+		int newIndex = _rows.indexOf(pCurrentLayer);
+		if(oldIndex >= 0)
+			viewport()->update(rowRect(oldIndex));
+		if(newIndex >= 0)
+			viewport()->update(rowRect(newIndex));
+		_pCurrentLayer = pCurrentLayer;
+	}
+
+	int currentFrame = getCurrentFrame();
+	if(currentFrame != _currentFrame)
+	{
+		if(_currentFrame >= 0)
+			viewport()->update(columnRect(_currentFrame));
+		if(currentFrame >= 0)
+			viewport()->update(columnRect(currentFrame));
+		_currentFrame = currentFrame;
+	}
+
+	if(all)
+	{
+		updateScrollBars();
+		viewport()->update();
+	}
+}
+
+bool TimelineView::cellAt(const QPoint &pos, int *layerIndex, int *frameIndex)
+{
+	int y = pos.y() - KEYFRAMESTARTY + verticalScrollBar()->value();
+	if(pos.y() < KEYFRAMESTARTY || y / KEYFRAMESIZEY >= _rows.count())
+		return false;
+
+	*layerIndex = y / KEYFRAMESIZEY;
+
+	if(pos.x() < KEYFRAMESTARTX)
+	{
+		*frameIndex = -1;
+		return true;
+	}
+
+	int x = pos.x() - KEYFRAMESTARTX + horizontalScrollBar()->value();
+	if(x / KEYFRAMESIZEX >= _frameCount)
+		return false;
+
+	*frameIndex = x / KEYFRAMESIZEX;
+	return true;
+}
+
+void TimelineView::paintEvent(QPaintEvent *event)
+{
+	QPainter painter(viewport());
+	QRect dirty = event->rect();
+	int scrollX = horizontalScrollBar()->value();
+	int scrollY = verticalScrollBar()->value();
+	int width = viewport()->width();
+	int height = viewport()->height();
+
+	if(NULL == _pEmotion || _rows.isEmpty())
+		return;
+
+	// only the cells inside the dirty rectangle
+	int firstLayer = qMax(0, (dirty.top() - KEYFRAMESTARTY + scrollY) / KEYFRAMESIZEY);
+	int lastLayer = qMin(_rows.count() - 1, (dirty.bottom() - KEYFRAMESTARTY + scrollY) / KEYFRAMESIZEY);
+	int firstFrame = qMax(0, (qMax(dirty.left(), KEYFRAMESTARTX) - KEYFRAMESTARTX + scrollX) / KEYFRAMESIZEX);
+	int lastFrame = qMin(_frameCount - 1, (dirty.right() - KEYFRAMESTARTX + scrollX) / KEYFRAMESIZEX);
+
+	painter.setClipRect(QRect(KEYFRAMESTARTX, KEYFRAMESTARTY, width, height) & dirty);
+
+	for(int i = firstLayer; i <= lastLayer; i++)
+	{
+		Layer* pLayer = _rows[i];
+		int y = KEYFRAMESTARTY + i * KEYFRAMESIZEY - scrollY;
+
+		// keyframes are sorted, so walk them alongside the cells
+		int key = pLayer->getKeyFrameLowerBound(firstFrame);
+		int keyCount = pLayer->getkeyFrameCount();
+
+		for(int j = firstFrame; j <= lastFrame; j++)
+		{
+			QRect cell(KEYFRAMESTARTX + j * KEYFRAMESIZEX - scrollX, y, KEYFRAMESIZEX, KEYFRAMESIZEY);
+
+			while(key < keyCount && pLayer->getKeyFrameByindex(key)->frameIndex < j)
+				key++;
+
+			painter.setPen(Qt::black);
+			painter.setBrush(Qt::white);
+			painter.drawRect(cell);
+
+			if(key < keyCount && pLayer->getKeyFrameByindex(key)->frameIndex == j)
+			{
+				painter.setOpacity(0.2);
+				painter.fillRect(cell, Qt::blue);
+				painter.setOpacity(1.0);
+			}
+			else
+			{
+				painter.drawText(cell, Qt::AlignCenter, QString::number(j));
+			}
+		}
+	}
+
+	// names stay put when scrolling sideways
+	painter.setClipRect(QRect(0, KEYFRAMESTARTY, KEYFRAMESTARTX, height) & dirty);
+
+	for(int i = firstLayer; i <= lastLayer; i++)
+	{
+		QRect name(0, KEYFRAMESTARTY + i * KEYFRAMESIZEY - scrollY, KEYFRAMESTARTX, KEYFRAMESIZEY);
+
+		painter.setPen(Qt::black);
+		painter.setBrush(Qt::white);
+		painter.drawRect(name);
+		painter.drawText(name, Qt::AlignCenter, _rows[i]->getFileName());
+
+		if(_rows[i] == _pCurrentLayer)
+		{
+			painter.setOpacity(0.2);
+			painter.fillRect(name, Qt::red);
+			painter.setOpacity(1.0);
+		}
+	}
+
+	if(_currentFrame >= 0)
+	{
+		int x = KEYFRAMESTARTX + _currentFrame * KEYFRAMESIZEX + KEYFRAMESIZEX / 2 - scrollX;
+
+		painter.setClipRect(QRect(KEYFRAMESTARTX, 0, width, height) & dirty);
+		painter.setPen(QPen(Qt::red, 1));
+		painter.drawLine(x, 0, x, height);
+	}
+}
+
+void TimelineView::mousePressEvent(QMouseEvent *event)
+{
+	int layerIndex, frameIndex;
+
+	if(event->button() != Qt::LeftButton || !cellAt(event->pos(), &layerIndex, &frameIndex))
+	{
+		QAbstractScrollArea::mousePressEvent(event);
+		return;
+	}
+
+	CommandListModel::shared()->runCommand(new LayerSelectCmd(layerIndex));
+	if(frameIndex >= 0)
+		CommandListModel::shared()->runCommand(new KeyFrameSelectCmd(frameIndex));
+}
+
+void TimelineView::resizeEvent(QResizeEvent *event)
+{
+	QAbstractScrollArea::resizeEvent(event);
+	updateScrollBars();
+}
@@ -0,0 +1,46 @@
+#ifndef TIMELINEVIEW_H
+#define TIMELINEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QVector>
+
+class Emotion;
+class Layer;
+
+// Paints the layer names and keyframe cells of the current emotion
+// itself, only what is visible, and only what changed since last time.
+class TimelineView : public QAbstractScrollArea
+{
+	Q_OBJECT
+
+public:
+	explicit TimelineView(QWidget *parent = 0);
+
+	// Compare the models with what is on screen and schedule repaints
+	void refresh();
+
+	// Layer and frame under a viewport position, false if it is no cell.
+	// Over the names the frame is -1.
+	bool cellAt(const QPoint &pos, int *layerIndex, int *frameIndex);
+
+protected:
+	void paintEvent(QPaintEvent *event);
+	void mousePressEvent(QMouseEvent *event);
+	void resizeEvent(QResizeEvent *event);
+
+private:
+	int getFrameCount();
+	int getCurrentFrame();
+	QRect rowRect(int layerIndex);
+	QRect columnRect(int frameIndex);
+	void updateScrollBars();
+
+	Emotion *_pEmotion;
+	int _frameCount;
+	QVector<Layer*> _rows;
+	QVector<int> _revisions;
+	Layer *_pCurrentLayer;
+	int _currentFrame;
+};
+
+#endif // TIMELINEVIEW_H
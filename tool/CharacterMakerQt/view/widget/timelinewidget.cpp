@@ -12,6 +12,8 @@ TimelineWidget::TimelineWidget(QWidget *parent) :
 	CurrentFrameModel::shared()->addListener(this);
 
     fileNum = 0;
+    _menuLayerIndex = -1;
+    _menuFrameIndex = -1;
     _ptimeLineMenu = new QMenu;
 
     QAction *act1 = new QAction("키프레임 추가", ui->timelineView);
@@ -28,12 +30,6 @@ TimelineWidget::TimelineWidget(QWidget *parent) :
     connect(act2, SIGNAL(triggered()), this, SLOT(deleteKeyFrame()));
     connect(act3, SIGNAL(triggered()), this, SLOT(insertLayer()));
 	//connect(act4, SIGNAL(triggered()), this, SLOT(deleteLayer()));
-
-    scene = new GraphicsScene(0, 0, 1000,180, this);
-    ui->timelineView->setScene(scene);
-
-    QGraphicsTextItem* text = new QGraphicsTextItem("TEXT");
-    scene->addItem(text);
 }
 
 TimelineWidget::~TimelineWidget()
@@ -41,59 +37,6 @@ TimelineWidget::~TimelineWidget()
     delete ui;
 }
 
-void TimelineWidget::drawTimelineLayer()
-{
-	int offsetX = KEYFRAMESIZEX;
-	int offsetY = KEYFRAMESIZEY;
-
-
-    Emotion* pEmotion = CurrentEmotionModel::shared()->getEmotion();
-
-	QString type = "RECT";
-
-	for(int i = 0; i < pEmotion->getLayerCount(); i++)
-    {
-		Layer* pLayer = pEmotion->getLayerByIndex(i);
-		qDebug() << "pLayer->getkeyFrameCount() : " << pLayer->getkeyFrameCount();
-
-		for(int j = 0; j < 60; j++)
-        {
-			type = "RECT";
-
-			for(int k = 0; k < pLayer->getkeyFrameCount(); k++)
-			{
-				KeyFrame* pKeyFrame = pLayer->getKeyFrameByindex(k);
-				if(pKeyFrame->frameIndex == j)
-				{
-					type = "FILLRECT";
-					break;
-				}
-			}
-
-			CustomGraphicsItem* item = new CustomGraphicsItem((offsetX*j)+KEYFRAMESTARTX, (offsetY*i)+KEYFRAMESTARTY, offsetX, offsetY);
-			item->setLayerIndex(i);
-			item->setItemIndex(j);
-			item->setShapeType(type);
-			scene->addItem(item);
-        }
-    }
-	//	scene->update();
-}
-
-void TimelineWidget::drawTimelineName()
-{
-	Emotion* pEmotion = CurrentEmotionModel::shared()->getEmotion();
-	for(int i = 0; i < pEmotion->getLayerCount(); i++)
-	{
-		Layer* pLayer = pEmotion->getLayerByIndex(i);
-		CustomGraphicsItem* timelineName = new CustomGraphicsItem(0,(KEYFRAMESIZEY*i)+KEYFRAMESTARTY, 80, KEYFRAMESIZEY);
-		timelineName->setLayerIndex(i);
-		timelineName->setTextInfo(pLayer->getFileName());
-		timelineName->setShapeType("SELECT_TIMELINE_NAME");
-		scene->addItem(timelineName);
-	}
-}
-
 void TimelineWidget::onNotice(NOTIS e)
 {
     if(e == UPDATE_EMOTION)
@@ -124,25 +67,11 @@ void TimelineWidget::onNotice(NOTIS e)
         ui->sb_totalFrame->blockSignals(false);
         ui->sb_frameDelay->blockSignals(false);
     }
-	else if(e == UPDATE_LAYER || e == UPDATE_FRAME)
+
+	if(e == UPDATE_EMOTION || e == UPDATE_LAYER || e == UPDATE_FRAME)
 	{
-		scene->clear();
-		drawTimelineName();
-		drawTimelineLayer();
-
-		if(CurrentFrameModel::shared()->getKeyFrame())
-		{
-			int keyFrameIndex = CurrentFrameModel::shared()->getKeyFrame()->frameIndex;
-			scene->keyFrameLineUpdate(keyFrameIndex);
-		}
-		else
-		{
-			int keyFrameIndex = CurrentFrameModel::shared()->getKeyFrameIndex();
-			scene->keyFrameLineUpdate(keyFrameIndex);
-		}
-
-		scene->update();
-    }
+		ui->timelineView->refresh();
+	}
 }
 
 void TimelineWidget::on_sb_totalFrame_valueChanged(int arg1)
@@ -213,7 +142,13 @@ void TimelineWidget::mouseMoveEvent(QMouseEvent * event)
 
 void TimelineWidget::on_timelineView_customContextMenuRequested(const QPoint &pos)
 {
-    QPoint globalPos = ui->timelineView->mapToGlobal(pos);
+	if(!ui->timelineView->cellAt(pos, &_menuLayerIndex, &_menuFrameIndex))
+	{
+		_menuLayerIndex = -1;
+		_menuFrameIndex = -1;
+	}
+
+    QPoint globalPos = ui->timelineView->viewport()->mapToGlobal(pos);
     _ptimeLineMenu->exec(globalPos);
 }
 
@@ -222,13 +157,10 @@ void TimelineWidget::insertKeyFrame()
     if(NULL == CurrentLayerModel::shared()->getLayer())
         return;
 
-	CustomGraphicsItem *item = (CustomGraphicsItem*)scene->itemAt(scene->getTimelineMousePos(),QTransform());
-	if(item)
+	if(_menuFrameIndex >= 0)
 	{
-		int layerIndex = item->getLayerIndex();
-		int keyFrameIndex = item->getItemIndex();
-		qDebug() << "keyFrameIndex : " << keyFrameIndex << endl;
-		CommandListModel::shared()->runCommand(new KeyFrameAddCmd(layerIndex, keyFrameIndex));
+		qDebug() << "keyFrameIndex : " << _menuFrameIndex << endl;
+		CommandListModel::shared()->runCommand(new KeyFrameAddCmd(_menuLayerIndex, _menuFrameIndex));
 	}
 }
 
@@ -238,15 +170,10 @@ void TimelineWidget::deleteKeyFrame()
 	if(NULL == CurrentLayerModel::shared()->getLayer())
 		return;
 
-	CustomGraphicsItem *item = (CustomGraphicsItem*)scene->itemAt(scene->getTimelineMousePos(),QTransform());
-
-	if(item)
+	if(_menuFrameIndex >= 0)
 	{
-		int layerIndex = item->getLayerIndex();
-		int keyFrameIndex = item->getItemIndex();
-
-		Layer* pLayer = CurrentEmotionModel::shared()->getEmotion()->getLayerByIndex(layerIndex);
-		KeyFrame* pkeyFrame = pLayer->getKeyFrameByFrameIndex(keyFrameIndex);
+		Layer* pLayer = CurrentEmotionModel::shared()->getEmotion()->getLayerByIndex(_menuLayerIndex);
+		KeyFrame* pkeyFrame = pLayer->getKeyFrameByFrameIndex(_menuFrameIndex);
 
 		if(pkeyFrame)
 			CommandListModel::shared()->runCommand(new KeyFrameDeleteCmd(pLayer->getFileName(), pkeyFrame));
@@ -276,12 +203,9 @@ void TimelineWidget::deleteLayer()
 	if(NULL == CurrentCharacterModel::shared()->getCharacter() || NULL == CurrentEmotionModel::shared()->getEmotion())
 		return;
 
-	CustomGraphicsItem *item = (CustomGraphicsItem*)scene->itemAt(scene->getTimelineMousePos(),QTransform());
-
-	if(item)
+	if(_menuLayerIndex >= 0)
 	{
-		int layerIndex = item->getLayerIndex();
-		Layer* pLayer = CurrentEmotionModel::shared()->getEmotion()->getLayerByIndex(layerIndex);
+		Layer* pLayer = CurrentEmotionModel::shared()->getEmotion()->getLayerByIndex(_menuLayerIndex);
 		CommandListModel::shared()->runCommand(new LayerDeleteCmd(pLayer->getFileName(),
 											  CurrentEmotionModel::shared()->getEmotion()->getStartState()));
 	}
@@ -7,8 +7,6 @@ namespace Ui {
 class TimelineWidget;
 }
 
-class GraphicsScene;
-
 class TimelineWidget : public QDockWidget, IObserver
 {
     Q_OBJECT
@@ -16,8 +14,6 @@ class TimelineWidget : public QDockWidget, IObserver
 public:
     explicit TimelineWidget(QWidget *parent = 0);
     ~TimelineWidget();
-    void drawTimelineLayer();
-	void drawTimelineName();
 
 private slots:
     void on_sb_totalFrame_valueChanged(int arg1);
@@ -36,11 +32,11 @@ protected:
 
 private:
     Ui::TimelineWidget *ui;
-    GraphicsScene* scene;
-    QGraphicsEllipseItem *ellipse;
-    QGraphicsRectItem *rectangle;
 
     QMenu *_ptimeLineMenu;
+    // cell the context menu was opened on
+    int _menuLayerIndex;
+    int _menuFrameIndex;
 
     void onNotice(NOTIS e);
     int fileNum;
@@ -66,7 +66,9 @@ INCLUDEPATH += \
     view/windows \
     view/property \
     view/components \
-    lib
+    lib \
+    ../../novel/VisNovel/frameworks/runtime-src/Classes \
+    ../../novel/VisNovel/frameworks/cocos2d-x/external
 
 RESOURCES += \
     resourse/res.qrc
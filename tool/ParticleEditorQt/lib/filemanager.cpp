@@ -12,6 +12,8 @@
 
 #include <QString>
 #include "ParticleSettingModel.h"
+#include "particlelistmodel.h"
+#include <QFileInfo>
 
 FileManager g_fileManager;
 FileManager* FileManager::shared(){
@@ -57,5 +59,37 @@ bool FileManager::open(QString path)
     ParticleSettingModel::shared()->setData(root);
 
 
+    return true;
+}
+
+// Writes what the runtime loads (AssetBinary.fbs) and puts the texture next
+// to it. The json document stays the editor's own format.
+bool FileManager::exportBinary(QString path)
+{
+    ParticleSystem* pSystem = ParticleListModel::shared()->getParticleSystem();
+    if (pSystem == NULL)
+        return false;
+
+    flatbuffers::FlatBufferBuilder builder;
+    flatbuffers::Offset<PiniAsset::Particle> particle = pSystem->writeBinary(builder);
+    PiniAsset::FinishAssetBuffer(builder, PiniAsset::CreateAsset(builder, ASSET_BINARY_VERSION, particle));
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write((const char*)builder.GetBufferPointer(), builder.GetSize());
+    file.close();
+
+    QFileInfo texture(pSystem->getTexturePath());
+    if (texture.exists())
+    {
+        QString target = QFileInfo(path).dir().filePath(texture.fileName());
+        if (QFileInfo(target) != texture)
+        {
+            QFile::remove(target);
+            QFile::copy(texture.filePath(), target);
+        }
+    }
+
     return true;
 }
@@ -13,6 +13,7 @@ public:
 
     bool save(QString path);
     bool open(QString path);
+    bool exportBinary(QString path);
     bool saveAs();
     bool newFile();
 };
@@ -5,6 +5,7 @@
 #include <time.h>
 #include <QColor>
 #include <QDebug>
+#include <QFileInfo>
 
 #define PI 3.1415926535
 
@@ -181,10 +182,11 @@ void ParticleSystem::updateParticleSystemInfo(QJsonObject data)
     }
 
     deleteParticle();
+    m_particles.resize(m_TotalParticle);
 
-    for(int i=0; i<m_TotalParticle;i++)
+    for(int i=0; i<m_particles.size();i++)
     {
-        Particle * p = new Particle;
+        Particle * p = &m_particles[i];
 
         p->isFixedRotation = m_IsFixedRotation;
         p->x = m_SourcePositionX;
@@ -254,7 +256,7 @@ void ParticleSystem::updateParticleSystemInfo(QJsonObject data)
         if (m_EndSizeVar != 0)
             sizeDt += (rand()%m_EndSizeVar)-(m_EndSizeVar/2);
 
-        sizeDt = (sizeDt - size)/life*0.016;
+        sizeDt = (sizeDt - size)/life;
 
         p->sizeDt = sizeDt;
 
@@ -333,7 +335,6 @@ void ParticleSystem::updateParticleSystemInfo(QJsonObject data)
 
         p->visible = false;
         p->lifeTime = 0;
-        m_particleList.append(p);
 
         p->pos = Vector2d(p->x, p->y);
 
@@ -356,24 +357,20 @@ void ParticleSystem::updateParticleSystemInfo(QJsonObject data)
 
 void ParticleSystem::deleteParticle()
 {
-
-    for(int i=0; i<m_TotalParticle;i++)
-    {
-        Particle * p = m_particleList.value(i);
-        delete p;
-    }
-
-    m_particleList.clear();
+    m_particles.clear();
 }
 
 int ParticleSystem::getTotalPaticle()
 {
-    return m_TotalParticle;
+    return m_particles.size();
 }
 
 Particle * ParticleSystem::getParticleAt(int index)
 {
-    return m_particleList.value(index);
+    if (index < 0 || index >= m_particles.size())
+        return NULL;
+
+    return &m_particles[index];
 }
 
 QString ParticleSystem::getTexturePath()
@@ -391,14 +388,65 @@ QString ParticleSystem::getSrcBlendFunc()
     return m_SrcBlendFunc;
 }
 
+int ParticleSystem::getBlendFuncValue(QString option)
+{
+    if(option == "GL_ZERO" )
+    {
+        return 0;
+    }
+    else if(option == "GL_ONE")
+    {
+        return 1;
+    }
+    else if(option == "GL_SRC_COLOR")
+    {
+        return 0x0300;
+    }
+    else if(option == "GL_ONE_MINUS_SRC_COLOR")
+    {
+        return 0x0301;
+    }
+    else if(option == "GL_DST_COLOR")
+    {
+        return 0x0306;
+    }
+    else if(option == "GL_ONE_MINUS_DST_COLOR")
+    {
+        return 0x0307;
+    }
+    else if(option == "GL_SRC_ALPHA")
+    {
+        return 0x0302;
+    }
+    else if(option == "GL_ONE_MINUS_SRC_ALPHA")
+    {
+        return 0x0303;
+    }
+    else if(option == "GL_DST_ALPHA")
+    {
+        return 0x0304;
+    }
+    else if(option == "GL_ONE_MINUS_DST_ALPHA")
+    {
+        return 0x0305;
+    }
+    else if(option == "GL_SRC_ALPHA_SATURATE")
+    {
+        return 0x0308;
+    }
+
+    // not a blend factor
+    return -1;
+}
+
 void ParticleSystem::updateParticleSystem(float dt)
 {
 
     m_EmissionRateTimeDt += dt;
 
-    for(int i=0; i<m_TotalParticle;i++)
+    for(int i=0; i<m_particles.size();i++)
     {
-        Particle* p = m_particleList.value(i);
+        Particle* p = &m_particles[i];
         if (p->visible == false && m_EmissionRateTime < m_EmissionRateTimeDt)
         {
             p->visible = true;
@@ -434,12 +482,9 @@ void ParticleSystem::updateParticleSystem(float dt)
 //            p->velocity *= p->speed;
 
             float degree = atan2((p->pos).y,(p->pos).x)*180/PI;
-            qDebug()<< degree<<endl;
             degree+=90;
 
             degree= degree*(PI/180);
-            qDebug()<< degree<<endl;
-            qDebug()<< "----------"<<endl;
 
 //            p->velocity = Vector2d(cos(degree), sin(degree));
 //            p->velocity *= p->speed;
@@ -469,7 +514,7 @@ void ParticleSystem::updateParticleSystem(float dt)
 //            p->pos += Vector2d(cos(180*(PI/180)),sin(180*(PI/180)));
 
 
-            p->currentSize += p->sizeDt;
+            p->currentSize += p->sizeDt*dt;
 
             p->lifeTime +=dt;//dt로 변경해주세요.
 
@@ -512,3 +557,66 @@ void ParticleSystem::updateParticleSystem(float dt)
 }
 
 
+
+static PiniAsset::Color toBinaryColor(QString name, float alpha, float scale)
+{
+    QColor color(name);
+    return PiniAsset::Color(color.red()/255.0f*scale, color.green()/255.0f*scale, color.blue()/255.0f*scale, alpha);
+}
+
+/*
+ * The editor spreads a variance over its whole width (value +- var/2), draws
+ * currentSize as half the quad and turns counterclockwise; the runtime spreads
+ * +- var, sizes whole quads and turns clockwise.
+ */
+flatbuffers::Offset<PiniAsset::Particle> ParticleSystem::writeBinary(flatbuffers::FlatBufferBuilder &builder)
+{
+    flatbuffers::Offset<flatbuffers::String> texture = builder.CreateString(QFileInfo(m_TexturePath).fileName().toStdString());
+
+    PiniAsset::Vec2 sourcePosition(m_SourcePositionX, m_SourcePositionY);
+    PiniAsset::Vec2 positionVar(m_PosVarX/2.0f, m_PosVarY/2.0f);
+    PiniAsset::Vec2 gravity(cos(m_GravityAngle)*m_GravitySpeed, sin(m_GravityAngle)*m_GravitySpeed);
+    PiniAsset::Color startColor = toBinaryColor(m_StartColor, 1, 1);
+    PiniAsset::Color startColorVar = toBinaryColor(m_StartColorVar, 0, 0.5f);
+    PiniAsset::Color endColor = toBinaryColor(m_EndColor, 1, 1);
+    PiniAsset::Color endColorVar = toBinaryColor(m_EndColorVar, 0, 0.5f);
+
+    int blendSrc = getBlendFuncValue(m_SrcBlendFunc);
+    int blendDst = getBlendFuncValue(m_DestBlendFunc);
+
+    PiniAsset::ParticleBuilder particle(builder);
+    particle.add_total_particles(m_TotalParticle);
+    particle.add_duration(-1);
+    particle.add_emission_rate(m_EmissionRate);
+    particle.add_source_position(&sourcePosition);
+    particle.add_position_var(&positionVar);
+    particle.add_gravity(&gravity);
+    particle.add_speed(m_Speed);
+    particle.add_speed_var(m_SpeedVar/2.0f);
+    particle.add_angle(m_Angle);
+    particle.add_angle_var(m_AngleVar/2.0f);
+    particle.add_life(m_Life);
+    particle.add_life_var(m_LifeVar/2.0f);
+    particle.add_start_size(m_StartSize*2.0f);
+    particle.add_start_size_var(m_StartSizeVar);
+    particle.add_end_size(m_EndSize*2.0f);
+    particle.add_end_size_var(m_EndSizeVar);
+    particle.add_start_color(&startColor);
+    particle.add_start_color_var(&startColorVar);
+    particle.add_end_color(&endColor);
+    particle.add_end_color_var(&endColorVar);
+    particle.add_start_spin(-m_StartSpin);
+    particle.add_start_spin_var(m_StartSpinVar/2.0f);
+    particle.add_end_spin(-m_EndSpin);
+    particle.add_end_spin_var(m_EndSpinVar/2.0f);
+    particle.add_tangential_accel(m_TangentialAccel);
+    particle.add_tangential_accel_var(m_TangentialAccelVar/2.0f);
+    particle.add_rotation_is_dir(m_IsFixedRotation);
+    // unknown names keep the schema defaults
+    if (blendSrc >= 0)
+        particle.add_blend_src(blendSrc);
+    if (blendDst >= 0)
+        particle.add_blend_dst(blendDst);
+    particle.add_texture(texture);
+    return particle.Finish();
+}
@@ -3,8 +3,9 @@
 
 #include "QPoint"
 #include "geoLib.h"
-#include "QList"
+#include "QVector"
 #include <QJsonObject>
+#include "AssetBinaryFormat.h"
 
 struct Particle
 {
@@ -67,6 +68,11 @@ public:
     QString getDestBlendFunc();
     QString getSrcBlendFunc();
 
+    // the settings in runtime units, for the binary export
+    flatbuffers::Offset<PiniAsset::Particle> writeBinary(flatbuffers::FlatBufferBuilder &builder);
+
+    static int getBlendFuncValue(QString option);
+
 //private slots:
     void updateParticleSystem(float dt);
     void updateParticleSystemInfo(QJsonObject data);
@@ -121,7 +127,8 @@ private:
 
 //    QTimer _timer;
 
-    QList<Particle *> m_particleList;
+    // one block for every particle, reused until the settings change
+    QVector<Particle> m_particles;
 };
 
 #endif // PARTICLESYSTEM_H
@@ -2,27 +2,71 @@
 #include "qmath.h"
 #include "math.h"
 #include <QFile.h>
+#include <stddef.h>
+#include <string.h>
 #include "particlelistmodel.h"
 #include "ParticleSettingModel.h"
 #include<QDebug>
 
+// the stage the effect is designed on, centered in the widget
+#define STAGE_WIDTH 800
+#define STAGE_HEIGHT 600
+
+// quads one GLushort index buffer can address
+#define QUADS_PER_BATCH (65536/4)
+
+static const char* vertexShader =
+    "attribute vec2 a_position;\n"
+    "attribute vec2 a_texCoord;\n"
+    "attribute vec4 a_color;\n"
+    "uniform mat4 u_matrix;\n"
+    "varying vec2 v_texCoord;\n"
+    "varying vec4 v_color;\n"
+    "void main()\n"
+    "{\n"
+    "    v_texCoord = a_texCoord;\n"
+    "    v_color = a_color;\n"
+    "    gl_Position = u_matrix * vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* fragmentShader =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D u_texture;\n"
+    "varying vec2 v_texCoord;\n"
+    "varying vec4 v_color;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = texture2D(u_texture, v_texCoord) * v_color;\n"
+    "}\n";
 
 GLDrawer::GLDrawer(QWidget *parent) :
-    QGLWidget(parent)
+    QOpenGLWidget(parent),
+    m_QuadBuffer(QOpenGLBuffer::VertexBuffer),
+    m_IndexBuffer(QOpenGLBuffer::IndexBuffer),
+    m_BackBuffer(QOpenGLBuffer::VertexBuffer),
+    m_Texture(NULL),
+    m_BackTexture(NULL),
+    m_TexturePath("fire.png"),
+    m_TextureDirty(true)
 {
-    connect(&_timer,SIGNAL(timeout()),this,SLOT(updateGL()));
-    _timer.start(16);
-    _timer.setInterval(16);
-    pixmap = QPixmap("fire.png");
-//    m_BackImage = QPixmap("sell_pet_bg.png");
-
+    // a new frame is asked for as soon as the last one reached the screen,
+    // so the preview runs at the display's refresh rate
+    connect(this,SIGNAL(frameSwapped()),this,SLOT(onFrameSwapped()));
 
     ParticleSettingModel::shared()->addListener(this);
 }
 
 GLDrawer::~GLDrawer()
 {
-
+    makeCurrent();
+    delete m_Texture;
+    delete m_BackTexture;
+    m_QuadBuffer.destroy();
+    m_IndexBuffer.destroy();
+    m_BackBuffer.destroy();
+    doneCurrent();
 }
 
 void GLDrawer::onNotice(NOTIS e){
@@ -34,307 +78,224 @@ void GLDrawer::onNotice(NOTIS e){
     {
         QString path = ParticleSettingModel::shared()->getBackGroundImagePath();
         qDebug()<<path<<endl;
-        m_BackImage = QPixmap(path);
-
-
+        m_BackImagePath = path;
+        m_TextureDirty = true;
     }
 
 }
 
-int angle = 0;
-GLfloat transX = 0;
-GLfloat transY = 0;
-float num = 50;
-float radius = 0;
-float maxValue = 0;
-bool isbool = true;
-
+void GLDrawer::onFrameSwapped()
+{
+    update();
+}
 
 void GLDrawer::chageTexture(QString path)
 {
-    pixmap = QPixmap(path);
+    m_TexturePath = path;
+    m_TextureDirty = true;
 }
 
-int GLDrawer::getGlBlendFuncOption(QString option)
+int GLDrawer::getGlBlendFuncOption(QString option, int fallback)
 {
-    if(option == "GL_ZERO" )
-    {
-        return 0;
-    }
-    else if(option == "GL_ONE")
-    {
-        return 1;
-    }
-    else if(option == "GL_SRC_COLOR")
-    {
-        return 0x0300;
-    }
-    else if(option == "GL_ONE_MINUS_SRC_COLOR")
-    {
-        return 0x0301;
-    }
-    else if(option == "GL_DST_COLOR")
-    {
-        return 0x0306;
-    }
-    else if(option == "GL_ONE_MINUS_DST_COLOR")
-    {
-        return 0x0307;
-    }
-    else if(option == "GL_SRC_ALPHA")
-    {
-        return 0x0302;
-    }
-    else if(option == "GL_ONE_MINUS_SRC_ALPHA")
-    {
-        return 0x0303;
-    }
-    else if(option == "GL_DST_ALPHA")
-    {
-        return 0x0304;
-    }
-    else if(option == "GL_ONE_MINUS_DST_ALPHA")
-    {
-        return 0x0305;
-    }
-    else if(option == "GL_SRC_ALPHA_SATURATE")
-    {
-        return 0x0308;
-    }
+    // an unknown name would make glBlendFunc fail with GL_INVALID_ENUM
+    int value = ParticleSystem::getBlendFuncValue(option);
+    return value < 0 ? fallback : value;
 }
 
 
 void GLDrawer::initializeGL()
 {
+    initializeOpenGLFunctions();
     glClearColor(0,0,0,1);
-}
 
+    m_Program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader);
+    m_Program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader);
+    m_Program.bindAttributeLocation("a_position", 0);
+    m_Program.bindAttributeLocation("a_texCoord", 1);
+    m_Program.bindAttributeLocation("a_color", 2);
+    if(!m_Program.link())
+        qDebug()<<m_Program.log()<<endl;
+
+    // every quad is two triangles over its four corners
+    QVector<GLushort> indices(QUADS_PER_BATCH*6);
+    for(int i =0; i<QUADS_PER_BATCH;i++)
+    {
+        indices[i*6+0] = i*4+0;
+        indices[i*6+1] = i*4+1;
+        indices[i*6+2] = i*4+2;
+        indices[i*6+3] = i*4+2;
+        indices[i*6+4] = i*4+3;
+        indices[i*6+5] = i*4+0;
+    }
+    m_IndexBuffer.create();
+    m_IndexBuffer.bind();
+    m_IndexBuffer.allocate(indices.constData(), indices.size()*sizeof(GLushort));
+    m_IndexBuffer.release();
+
+    ParticleVertex back[4] = {
+        { -STAGE_WIDTH/2.0f,  STAGE_HEIGHT/2.0f, 0.0f, 1.0f, 255, 255, 255, 255 },
+        {  STAGE_WIDTH/2.0f,  STAGE_HEIGHT/2.0f, 1.0f, 1.0f, 255, 255, 255, 255 },
+        {  STAGE_WIDTH/2.0f, -STAGE_HEIGHT/2.0f, 1.0f, 0.0f, 255, 255, 255, 255 },
+        { -STAGE_WIDTH/2.0f, -STAGE_HEIGHT/2.0f, 0.0f, 0.0f, 255, 255, 255, 255 },
+    };
+    m_BackBuffer.create();
+    m_BackBuffer.bind();
+    m_BackBuffer.allocate(back, sizeof(back));
+    m_BackBuffer.release();
+
+    m_QuadBuffer.create();
+    m_QuadBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+
+    m_Projection.setToIdentity();
+    m_Projection.ortho(-STAGE_WIDTH/2.0f, STAGE_WIDTH/2.0f, -STAGE_HEIGHT/2.0f, STAGE_HEIGHT/2.0f, -1.0f, 1.0f);
+
+    m_Clock.start();
+}
 
-void GLDrawer::drawRect(float x, float y, float w, float h)
+// Images are uploaded once, and again only when a path changes
+void GLDrawer::updateTextures()
 {
-    glPushMatrix();
-    glLoadIdentity();
-    glTranslatef(-w/2,-h/2,0);
-    glScalef(w, h, 1);
-    glBegin(GL_QUADS);
+    if (m_TextureDirty == false)
+        return;
 
+    delete m_Texture;
+    delete m_BackTexture;
+    m_Texture = NULL;
+    m_BackTexture = NULL;
 
-        glColor3f(0.0f,0.0f,0.0f);
+    // flipped so the top of the image sits at t = 1, like bindTexture did
+    QImage image(m_TexturePath);
+    if (image.isNull() == false)
+        m_Texture = new QOpenGLTexture(image.mirrored());
 
+    QImage back(m_BackImagePath);
+    if (m_BackImagePath.isEmpty() == false && back.isNull() == false)
+        m_BackTexture = new QOpenGLTexture(back.mirrored());
 
-        glVertex3f(0.0, 1,0.0);
-
-        glVertex3f(1, 1,0.0);
-
-        glVertex3f(1, 0,0.0);
-
-        glVertex3f(0, 0,0.0);
-    glEnd();
-    glPopMatrix();
+    m_TextureDirty = false;
 }
 
-void GLDrawer::drawImage(QPixmap img,float x, float y, float w, float h)
+// Writes the corners of every visible particle, returns how many quads
+int GLDrawer::fillQuads(int count)
 {
-    glEnable(GL_TEXTURE_2D);
-    bindTexture ( img, GL_TEXTURE_2D, GL_RGBA );
-
-    glPushMatrix();
-
-    glLoadIdentity();
-
-    glTranslatef(x,y,0);
-    glScalef(w/2, h/2, 1);
+    m_Vertices.resize(count*4);
 
+    ParticleVertex* v = m_Vertices.data();
+    int quads = 0;
 
-    glBegin(GL_QUADS);
-        glColor3f(1.0f,1.0f,1.0f);
-
-        glTexCoord2f(0.0, 1.0);
-        glVertex3f(-1.0, 1,0.0);
-
-        glTexCoord2f(1.0, 1.0);
-        glVertex3f(1.0, 1.0,0.0);
+    for(int i =0; i<count;i++)
+    {
+        Particle* p = ParticleListModel::shared()->getParticleAt(i);
+        if (p->visible == false)
+            continue;
+
+        // half extent of currentSize, rotated counterclockwise in degrees
+        float rad = p->currentRotate*(M_PI/180);
+        float c = cos(rad)*p->currentSize;
+        float s = sin(rad)*p->currentSize;
+        float x = p->pos.x;
+        float y = p->pos.y;
+
+        GLubyte r = qBound(0, (int)p->currentColor.red, 255);
+        GLubyte g = qBound(0, (int)p->currentColor.green, 255);
+        GLubyte b = qBound(0, (int)p->currentColor.blue, 255);
+
+        ParticleVertex corners[4] = {
+            { x - c - s, y - s + c, 0.0f, 1.0f, r, g, b, 255 },
+            { x + c - s, y + s + c, 1.0f, 1.0f, r, g, b, 255 },
+            { x + c + s, y + s - c, 1.0f, 0.0f, r, g, b, 255 },
+            { x - c + s, y - s - c, 0.0f, 0.0f, r, g, b, 255 },
+        };
+        memcpy(v, corners, sizeof(corners));
+        v += 4;
+        quads++;
+    }
 
-        glTexCoord2f(1.0, 0.0);
-        glVertex3f(1.0, -1.0,0.0);
+    return quads;
+}
 
-        glTexCoord2f(0.0, 0.0);
-        glVertex3f(-1.0, -1.0,0.0);
-    glEnd();
-    glPopMatrix();
-    glDisable(GL_TEXTURE_2D);
+void GLDrawer::drawBackground()
+{
+    if (m_BackTexture == NULL)
+        return;
+
+    m_BackBuffer.bind();
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, x));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, u));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, r));
+    m_BackTexture->bind(0);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+    m_BackBuffer.release();
 }
 
-void GLDrawer::drawRect(QPixmap img,int a, float x, float y, float w, float h)
+void GLDrawer::drawParticles(int count)
 {
+    int quads = fillQuads(count);
+    if (quads == 0 || m_Texture == NULL)
+        return;
 
-    glEnable(GL_TEXTURE_2D);
     glEnable(GL_BLEND);
-    int src = getGlBlendFuncOption(ParticleListModel::shared()->getParticleSystem()->getSrcBlendFunc());
-    int dest = getGlBlendFuncOption(ParticleListModel::shared()->getParticleSystem()->getDestBlendFunc());
-//    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    int src = getGlBlendFuncOption(ParticleListModel::shared()->getParticleSystem()->getSrcBlendFunc(), GL_SRC_ALPHA);
+    int dest = getGlBlendFuncOption(ParticleListModel::shared()->getParticleSystem()->getDestBlendFunc(), GL_ONE_MINUS_SRC_ALPHA);
     glBlendFunc(src, dest);
-    bindTexture ( img, GL_TEXTURE_2D, GL_RGBA );
-
-    glPushMatrix();
-//    glLoadIdentity();
-
-
-    glTranslatef(x,y,0);
-    glScalef(w, h, 1);
-
-    glRotatef(a,0,0,1);
-
 
-//    glRotatef();
-    glBegin(GL_QUADS);
-
-
-//        glColor3f(rand()%100/100.0f,rand()%100/100.0f,rand()%100/100.0f);
-//        glColor3f(1.0f,1.0f,1.0f);
-
-        glTexCoord2f(0.0, 1.0);
-        glVertex3f(-1.0, 1,0.0);
-
-        glTexCoord2f(1.0, 1.0);
-        glVertex3f(1.0, 1.0,0.0);
-
-        glTexCoord2f(1.0, 0.0);
-        glVertex3f(1.0, -1.0,0.0);
-
-        glTexCoord2f(0.0, 0.0);
-        glVertex3f(-1.0, -1.0,0.0);
-    glEnd();
+    // one upload and a draw call per batch, instead of one per particle
+    m_QuadBuffer.bind();
+    m_QuadBuffer.allocate(m_Vertices.constData(), quads*4*sizeof(ParticleVertex));
+    m_Texture->bind(0);
 
+    for(int first =0; first<quads; first+=QUADS_PER_BATCH)
+    {
+        int n = qMin(QUADS_PER_BATCH, quads-first);
+        size_t base = first*4*sizeof(ParticleVertex);
 
-    glPopMatrix();
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(base + offsetof(ParticleVertex, x)));
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(base + offsetof(ParticleVertex, u)));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleVertex), (void*)(base + offsetof(ParticleVertex, r)));
+        glDrawElements(GL_TRIANGLES, n*6, GL_UNSIGNED_SHORT, 0);
+    }
 
-    glDisable(GL_TEXTURE_2D);
+    m_QuadBuffer.release();
     glDisable(GL_BLEND);
 }
 
-
 void GLDrawer::paintGL()
 {
-
     glClear(GL_COLOR_BUFFER_BIT| GL_DEPTH_BUFFER_BIT);
 
-    glMatrixMode(GL_MODELVIEW);
-    angle+=1;
+    int ratio = devicePixelRatio();
+    glViewport((width()-STAGE_WIDTH)/2*ratio, (height()-STAGE_HEIGHT)/2*ratio, STAGE_WIDTH*ratio, STAGE_HEIGHT*ratio);
 
-    if (m_BackImage.isNull() == false)
-        drawImage(m_BackImage,0,0,800,600);
-    else
-        drawRect(0,0,800,600);
+    // the real time since the last frame, capped so a stall is not one huge step
+    float dt = qMin(m_Clock.nsecsElapsed()/1000000000.0f, 0.1f);
+    m_Clock.restart();
 
-    glLoadIdentity();
-    float dt = (float)_timer.interval()/1000;
-    ParticleListModel::shared()->getParticleSystem()->updateParticleSystem(dt);
-
-    int num = ParticleListModel::shared()->getTotalPaticle();
-    for(int i =0; i<num;i++)
-    {
-        Particle* p = ParticleListModel::shared()->getParticleAt(i);
-        if (p->visible)
-        {
+    ParticleSystem* pSystem = ParticleListModel::shared()->getParticleSystem();
+    if (pSystem)
+        pSystem->updateParticleSystem(dt);
 
-            glPushMatrix();
+    updateTextures();
 
-            float a = (1.0/255.0);
-            glColor3f(a*(float)p->currentColor.red,a*(float)p->currentColor.green,a*(float)p->currentColor.blue);
+    m_Program.bind();
+    m_Program.setUniformValue("u_matrix", m_Projection);
+    m_Program.setUniformValue("u_texture", 0);
+    m_IndexBuffer.bind();
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
 
+    drawBackground();
+    if (pSystem)
+        drawParticles(pSystem->getTotalPaticle());
 
-
-            drawRect(pixmap,p->currentRotate,p->pos.x,p->pos.y,p->currentSize,p->currentSize);
-            glPopMatrix();
-        }
-    }
-
-
-    setAutoBufferSwap(true);
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
+    m_IndexBuffer.release();
+    m_Program.release();
 }
 
-//void GLDrawer::paintGL()
-//{
-
-//    glClear(GL_COLOR_BUFFER_BIT| GL_DEPTH_BUFFER_BIT);
-
-//    glMatrixMode(GL_MODELVIEW);
-
-
-//    drawRect(0,0,800,600);
-
-//    glLoadIdentity();
-
-
-//    angle=angle+1;
-
-//    if (radius >250 && isbool == true)
-//        isbool = false;
-//    else if(radius <0 && isbool == false)
-//        isbool = true;
-
-
-//    if (isbool)
-//    {
-//        maxValue=maxValue+0.3;
-//        radius++;
-//    }
-//    else
-//    {
-//        maxValue=maxValue-0.3;
-//        radius--;
-//    }
-
-//    glTranslatef(400,300,0);
-
-//    for(int j =0; j<5;j++)
-//    {
-//        glPushMatrix();
-//        glTranslatef(rand()%50,rand()%50,0);
-//        for(int i =0; i<num;i++)
-//        {
-//            glPushMatrix();
-
-//            float r = sin(((i/num)+angle )*10*3.14*2)*maxValue;
-//            transX = sin(((i/num)+angle ) * (3.14*2))*(r+radius);
-//            transY = cos(((i/num)+angle )* (3.14*2))*(r+radius);
-
-//            drawRect(pixmap,transX,transY,25,25);
-//            glPopMatrix();
-
-//        }
-//        glPopMatrix();
-//    }
-
-//    setAutoBufferSwap(true);
-//}
-
-
 void GLDrawer::resizeGL(int w, int h)
 {
-
-
-    GLint width = (GLint)w;
-    GLint height = (GLint)h;
-
-    GLint x=0,y=0;
-
-
-    x = (width-800)/2;
-    y = (height-600)/2;
-
-
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-
-    glOrtho(-400.0, 400.0, -300.0,300.0 , 1.0, -1.0);
-
-
-    glViewport(x,y,800,600);
-
-
+    // the viewport is set per frame, QOpenGLWidget resets it before paintGL
 }
-
-
@@ -2,12 +2,24 @@
 #define GLDRAWER_H
 
 #include <QWidget>
-#include <QGLWidget>
-#include <QTimer>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
+#include <QOpenGLTexture>
+#include <QElapsedTimer>
+#include <QVector>
 #include "iobserver.h"
 
+// one corner of a particle quad, filled on the cpu and streamed each frame
+struct ParticleVertex
+{
+    GLfloat x, y;
+    GLfloat u, v;
+    GLubyte r, g, b, a;
+};
 
-class GLDrawer : public QGLWidget , IObserver
+class GLDrawer : public QOpenGLWidget , protected QOpenGLFunctions, IObserver
 {
     Q_OBJECT
 
@@ -15,27 +27,37 @@ public:
     explicit GLDrawer(QWidget *parent = 0);
     ~GLDrawer();
 
-    void drawRect(float x, float y, float w, float h);
-    void drawRect(QPixmap img, int angle, float x, float y, float w, float h);
-    void drawImage(QPixmap img,float x, float y, float w, float h);
-
     void chageTexture(QString path);
     void onNotice(NOTIS e);
-    int getGlBlendFuncOption(QString option);
+    int getGlBlendFuncOption(QString option, int fallback);
+
+private slots:
+    void onFrameSwapped();
 
 private:
-    QTimer _timer;
-    QPixmap pixmap;
-    QPixmap m_BackImage;
+    void updateTextures();
+    int fillQuads(int count);
+    void drawBackground();
+    void drawParticles(int count);
+
+    QOpenGLShaderProgram m_Program;
+    QOpenGLBuffer m_QuadBuffer;
+    QOpenGLBuffer m_IndexBuffer;
+    QOpenGLBuffer m_BackBuffer;
+    QVector<ParticleVertex> m_Vertices;
+
+    QOpenGLTexture *m_Texture;
+    QOpenGLTexture *m_BackTexture;
+    QString m_TexturePath;
+    QString m_BackImagePath;
+    bool m_TextureDirty;
+
+    QElapsedTimer m_Clock;
+    QMatrix4x4 m_Projection;
 protected:
     void initializeGL();
-//    void initializeOverlayGL();
-//    void glDraw();
-//    void glInit();
     void paintGL();
-//    void paintOverlayGL();
     void resizeGL(int w, int h);
-//    void resizeOverlayGL();
 
 
 
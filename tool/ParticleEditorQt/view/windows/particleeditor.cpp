@@ -6,6 +6,9 @@
 #include <QFileDialog>
 #include <QGridLayout>
 #include <QVBoxLayout>
+#include <QMenu>
+#include <QMenuBar>
+#include <QMessageBox>
 #include "hierarchydock.h"
 #include "animationdock.h"
 
@@ -29,6 +32,23 @@ particleEditor::particleEditor(QWidget *parent) :
 
     m_GLDrawer = new GLDrawer();
     ui->tabWidget->addTab(m_GLDrawer,"particle");
+
+    // next to save, in whichever menu the form put it
+    QAction* pExport = new QAction("Export Binary...", this);
+    pExport->setShortcut(QKeySequence("Ctrl+E"));
+    connect(pExport, SIGNAL(triggered()), this, SLOT(onExportTriggered()));
+
+    QMenu* pFileMenu = NULL;
+    foreach (QWidget* pWidget, ui->actionSave->associatedWidgets())
+    {
+        pFileMenu = qobject_cast<QMenu*>(pWidget);
+        if (pFileMenu)
+            break;
+    }
+    if (pFileMenu)
+        pFileMenu->addAction(pExport);
+    else
+        menuBar()->addAction(pExport);
 }
 
 particleEditor::~particleEditor()
@@ -65,4 +85,12 @@ void particleEditor::on_action_triggered()
     ParticleSettingModel::shared()->setBackGroundImagePath(path);
 }
 
+void particleEditor::onExportTriggered()
+{
+    QString path = QFileDialog::getSaveFileName(this, "export", QString(), "Particle binary (*.pnas)");
+    if (path.isEmpty())
+        return;
 
+    if (!FileManager::shared()->exportBinary(path))
+        QMessageBox::warning(this, "export", "Failed to write " + path);
+}
@@ -32,6 +32,8 @@ private slots:
 
     void on_action_triggered();
 
+    void onExportTriggered();
+
 private:
 
 
@@ -0,0 +1,76 @@
+# -*- coding: utf-8 -*-
+# Writes the mip pyramid TextureStreamer / CreateStreamingSprite load:
+#   cg/ev01.png  ->  cg/ev01.mip1.png (1/2), cg/ev01.mip2.png (1/4), ...
+#                    cg/ev01.mip.txt ("<width> <height>" of the full image)
+#
+# usage: python mippyramid.py <image or directory> [levels]
+#
+# levels counts the full resolution image too and has to match the levels
+# argument given to CreateStreamingSprite (3 by default). Run it on the
+# folder of streamed CGs before it is zipped; existing .mipN and .mip.txt
+# files are rewritten.
+from __future__ import print_function
+
+import os
+import re
+import sys
+
+from PIL import Image
+
+MIP_NAME = re.compile(r"\.mip\d+$")
+EXTENSIONS = (".png", ".jpg", ".jpeg")
+# ANTIALIAS is the old PIL name of the same filter
+RESAMPLE = getattr(Image, "LANCZOS", None) or Image.ANTIALIAS
+
+def levelFileName(filename, level):
+	root, ext = os.path.splitext(filename)
+	return "%s.mip%d%s" % (root, level, ext)
+
+def sizeFileName(filename):
+	return os.path.splitext(filename)[0] + ".mip.txt"
+
+def writePyramid(filename, levels):
+	image = Image.open(filename)
+	image.load()
+
+	# levels round odd sizes up, so the runtime can't derive this from them
+	with open(sizeFileName(filename), "w") as f:
+		f.write("%d %d\n" % image.size)
+	if image.mode not in ("RGB", "RGBA"):
+		image = image.convert("RGBA")
+
+	for level in range(1, levels):
+		# halve the previous level, rounding up so odd edges keep their pixels
+		width = max(1, (image.size[0] + 1) // 2)
+		height = max(1, (image.size[1] + 1) // 2)
+		image = image.resize((width, height), RESAMPLE)
+		image.save(levelFileName(filename, level))
+
+	print("%s: %d levels" % (filename, levels))
+
+def isSource(filename):
+	root, ext = os.path.splitext(filename)
+	return ext.lower() in EXTENSIONS and not MIP_NAME.search(root)
+
+def main():
+	if len(sys.argv) < 2:
+		print("usage: python mippyramid.py <image or directory> [levels]")
+		return 1
+
+	target = sys.argv[1]
+	levels = int(sys.argv[2]) if len(sys.argv) > 2 else 3
+	if levels < 1:
+		print("levels must be 1 or more")
+		return 1
+
+	if os.path.isdir(target):
+		for dirpath, dirnames, filenames in os.walk(target):
+			for name in filenames:
+				if isSource(name):
+					writePyramid(os.path.join(dirpath, name), levels)
+	else:
+		writePyramid(target, levels)
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())